@@ -0,0 +1,2094 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Headless (no window, no GPU) CPU micro-benchmarks for Core and Scene hot paths. Every case is deterministic (fixed
+// seeds), warm-up length is detected per case (MSER-5, see vaBenchmarkTool::DetectWarmupLength) and the results are
+// written in the vaBenchmarkTool JSON format so that nightly runs can be compared against a stored baseline:
+//
+//   Benchmarks.exe [--test] [--list] [--filter <substring>] [--samples <n>] [--out <results.json>] [--baseline <baseline.json>] [--report <report.json>]
+//
+// With --baseline the exit code is 1 if any metric regressed (Mann-Whitney U, see vaBenchmarkTool::CompareResults).
+// --test runs the correctness tests of the benchmarked code instead of the timed cases; failed checks give exit code 3.
+// If vaMemory allocation tracking is compiled in, the number of heap allocations per run is reported as well.
+// Whole-frame CPU cost (scene selection, draw list sorting, material/render item setup) and particle system Tick/Sort
+// are measured on the null render device (see vaRenderDeviceNull.h), which needs no GPU either.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Core/vaCore.h"
+#include "Core/vaMath.h"
+#include "Core/vaGeometry.h"
+#include "Core/vaRandom.h"
+#include "Core/vaStringTools.h"
+#include "Core/vaMemory.h"
+#include "Core/vaFrameArena.h"
+#include "Core/vaUploadRingAllocator.h"
+#include "Core/vaUIDObject.h"
+#include "Core/System/vaMemoryStream.h"
+#include "Core/System/vaThreading.h"
+#include "Core/System/vaCompressionStream.h"
+#include "Core/System/vaFileStream.h"
+#include "Core/System/vaFileTools.h"
+#include "Core/Misc/vaXXHash.h"
+#include "Core/Misc/vaBenchmarkTool.h"
+#include "Core/Misc/vaImageMetrics.h"
+#include "Core/Misc/vaPoissonDiskGenerator.h"
+#include "Core/Misc/vaLargeBitmapFile.h"
+#include "Core/Misc/vaSphericalHarmonics.h"
+
+#include "Rendering/vaTriangleMesh.h"
+#include "Rendering/vaShaderCache.h"
+#include "Rendering/vaPipelineStateCache.h"
+#include "Rendering/vaRenderMesh.h"
+#include "Rendering/vaRenderMaterial.h"
+#include "Rendering/vaLightClusters.h"
+#include "Rendering/Null/vaRenderDeviceNull.h"
+#include "Rendering/Effects/vaSimpleParticles.h"
+
+#include "Scene/vaScene.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <array>
+#include <thread>
+
+using namespace Vanilla;
+
+namespace
+{
+    // results get folded into this so that the optimizer can't throw the benchmarked work away
+    volatile uint64     s_sink = 0;
+
+    inline void         Sink( uint64 value )    { s_sink = s_sink ^ value; }
+    inline void         Sink( float value )     { uint32 bits; memcpy( &bits, &value, sizeof( bits ) ); Sink( (uint64)bits ); }
+
+    // failed correctness checks; tests run with --test, independent of --filter and of the timed cases
+    int                 s_failedChecks = 0;
+
+    inline void         Check( bool condition, const char * what )     { if( !condition ) { VA_LOG_ERROR( "Check failed: %s", what ); s_failedChecks++; } }
+
+    struct TestCase
+    {
+        string                      Name;
+        std::function<void( )>      Run;
+    };
+
+    struct BenchmarkCase
+    {
+        string                      Name;
+        string                      Info;
+        int64                       BytesPerRun     = 0;        // if non-zero, a throughput metric is also reported
+        std::function<void( )>      Setup;
+        std::function<void( )>      Run;
+        std::function<void( )>      Teardown;
+    };
+
+    struct Settings
+    {
+        int                         Samples             = 60;
+        int                         MinWarmupSamples    = 20;
+        int                         MaxWarmupSamples    = 500;
+        float                       MaxWarmupTime       = 5.0f;
+    };
+
+    static double RunTimed( const BenchmarkCase & bcase )
+    {
+        double timeStart = vaCore::TimeFromAppStart( );
+        bcase.Run( );
+        return vaCore::TimeFromAppStart( ) - timeStart;
+    }
+
+    static vaBenchmarkTool::RunResults RunCase( const BenchmarkCase & bcase, const Settings & settings )
+    {
+        vaBenchmarkTool::RunResults results;
+        results.Name        = bcase.Name;
+        results.LongInfo    = bcase.Info;
+
+        if( bcase.Setup )
+            bcase.Setup( );
+
+        // warm-up: keep running until the sample series looks stationary (or we give up)
+        std::vector<float> warmupSamples;
+        double warmupStart = vaCore::TimeFromAppStart( );
+        for( ;; )
+        {
+            warmupSamples.push_back( (float)( RunTimed( bcase ) * 1000.0 ) );
+            if( (int)warmupSamples.size( ) < settings.MinWarmupSamples )
+                continue;
+            int discard = 0;
+            if( vaBenchmarkTool::DetectWarmupLength( warmupSamples, discard ) && ( discard < (int)warmupSamples.size( ) / 4 ) )
+                break;
+            if( (int)warmupSamples.size( ) >= settings.MaxWarmupSamples || ( vaCore::TimeFromAppStart( ) - warmupStart ) > settings.MaxWarmupTime )
+            {
+                VA_LOG_WARNING( "Benchmark '%s' did not reach steady state during warm-up, results might be noisy", bcase.Name.c_str( ) );
+                break;
+            }
+        }
+        results.WarmupSamplesDiscarded  = (int)warmupSamples.size( );
+        results.WarmupTime              = (float)( vaCore::TimeFromAppStart( ) - warmupStart );
+
+        vaBenchmarkTool::MetricResults timeMetric;
+        timeMetric.Name             = "time_ms";
+        timeMetric.HigherIsBetter   = false;
+
+        vaBenchmarkTool::MetricResults throughputMetric;
+        throughputMetric.Name           = "throughput_MBps";
+        throughputMetric.HigherIsBetter = true;
+
+        // heap allocations made by a single run (only if vaMemory tracking is available)
+        vaBenchmarkTool::MetricResults allocationsMetric;
+        allocationsMetric.Name              = "heap_allocations";
+        allocationsMetric.HigherIsBetter    = false;
+        const bool trackAllocations         = vaMemory::IsTrackingEnabled( );
+
+        for( int i = 0; i < settings.Samples; i++ )
+        {
+            int64 allocationsBefore = 0, allocationsAfter = 0, bytes, live;
+            if( trackAllocations )
+                vaMemory::GetTotals( allocationsBefore, bytes, live );
+            double time = RunTimed( bcase );
+            if( trackAllocations )
+            {
+                vaMemory::GetTotals( allocationsAfter, bytes, live );
+                allocationsMetric.Samples.push_back( (float)( allocationsAfter - allocationsBefore ) );
+            }
+            timeMetric.Samples.push_back( (float)( time * 1000.0 ) );
+            if( bcase.BytesPerRun > 0 )
+                throughputMetric.Samples.push_back( (float)( bcase.BytesPerRun / ( 1024.0 * 1024.0 ) / vaMath::Max( time, 1e-9 ) ) );
+        }
+
+        if( bcase.Teardown )
+            bcase.Teardown( );
+
+        vaBenchmarkTool::StatisticsSettings statsSettings;
+        vaBenchmarkTool::ComputeStatistics( timeMetric.Samples, statsSettings, timeMetric.Stats );
+        results.Metrics.push_back( std::move( timeMetric ) );
+        if( bcase.BytesPerRun > 0 )
+        {
+            vaBenchmarkTool::ComputeStatistics( throughputMetric.Samples, statsSettings, throughputMetric.Stats );
+            results.Metrics.push_back( std::move( throughputMetric ) );
+        }
+        if( trackAllocations )
+        {
+            vaBenchmarkTool::ComputeStatistics( allocationsMetric.Samples, statsSettings, allocationsMetric.Stats );
+            results.Metrics.push_back( std::move( allocationsMetric ) );
+        }
+
+        return results;
+    }
+
+    // standard camera used by the culling cases
+    static void BenchmarkFrustumPlanes( vaPlane outPlanes[6] )
+    {
+        vaMatrix4x4 view = vaMatrix4x4::LookAtLH( vaVector3( -50.0f, -50.0f, 20.0f ), vaVector3( 0.0f, 0.0f, 0.0f ), vaVector3( 0.0f, 0.0f, 1.0f ) );
+        vaMatrix4x4 proj = vaMatrix4x4::PerspectiveFovLH( VA_PIf * 0.35f, 16.0f / 9.0f, 0.1f, 200.0f );
+        vaGeometry::CalculateFrustumPlanes( outPlanes, view * proj );
+    }
+
+    static void AddGeometryCases( std::vector<BenchmarkCase> & cases )
+    {
+        // shared between the geometry cases; setup is cheap so each case re-creates it
+        struct GeometryData
+        {
+            std::vector<vaMatrix4x4>            Matrices;
+            std::vector<vaVector3>              Positions;
+            std::vector<vaBoundingBox>          Boxes;
+            std::vector<vaOrientedBoundingBox>  OBBs;
+            vaPlane                             Planes[6];
+        };
+        auto data = std::make_shared<GeometryData>( );
+
+        auto setup = [data]( )
+        {
+            vaRandom rnd( 1 );
+            data->Matrices.resize( 4096 );
+            for( auto & m : data->Matrices )
+                m = vaMatrix4x4::FromScaleRotationTranslation( vaVector3( rnd.NextFloatRange( 0.5f, 2.0f ), rnd.NextFloatRange( 0.5f, 2.0f ), rnd.NextFloatRange( 0.5f, 2.0f ) ),
+                    vaQuaternion::FromYawPitchRoll( rnd.NextFloatRange( -VA_PIf, VA_PIf ), rnd.NextFloatRange( -VA_PIf, VA_PIf ), rnd.NextFloatRange( -VA_PIf, VA_PIf ) ),
+                    vaVector3( rnd.NextFloatRange( -100.0f, 100.0f ), rnd.NextFloatRange( -100.0f, 100.0f ), rnd.NextFloatRange( -100.0f, 100.0f ) ) );
+            data->Positions.resize( 65536 );
+            for( auto & p : data->Positions )
+                p = vaVector3( rnd.NextFloatRange( -100.0f, 100.0f ), rnd.NextFloatRange( -100.0f, 100.0f ), rnd.NextFloatRange( -100.0f, 100.0f ) );
+            data->Boxes.resize( 65536 );
+            data->OBBs.resize( data->Boxes.size( ) );
+            for( size_t i = 0; i < data->Boxes.size( ); i++ )
+            {
+                data->Boxes[i] = vaBoundingBox( data->Positions[i], vaVector3( rnd.NextFloatRange( 0.1f, 5.0f ), rnd.NextFloatRange( 0.1f, 5.0f ), rnd.NextFloatRange( 0.1f, 5.0f ) ) );
+                data->OBBs[i]  = vaOrientedBoundingBox::FromAABBAndTransform( data->Boxes[i], data->Matrices[i % data->Matrices.size( )] );
+            }
+            BenchmarkFrustumPlanes( data->Planes );
+        };
+        auto teardown = [data]( ) { *data = GeometryData( ); };
+
+        BenchmarkCase bc;
+        bc.Setup    = setup;
+        bc.Teardown = teardown;
+
+        bc.Name     = "geometry_matrix_multiply";
+        bc.Info     = "4096 chained vaMatrix4x4 multiplies";
+        bc.Run      = [data]( )
+        {
+            vaMatrix4x4 acc = vaMatrix4x4::Identity;
+            for( const auto & m : data->Matrices )
+                acc = m * acc * ( 1.0f / 64.0f );       // keep it from blowing up
+            Sink( acc.m[3][0] + acc.m[2][2] );
+        };
+        cases.push_back( bc );
+
+        bc.Name     = "geometry_transform_coord";
+        bc.Info     = "65536 vaVector3::TransformCoord";
+        bc.Run      = [data]( )
+        {
+            const vaMatrix4x4 & m = data->Matrices[0];
+            float acc = 0.0f;
+            for( const auto & p : data->Positions )
+                acc += vaVector3::TransformCoord( p, m ).x;
+            Sink( acc );
+        };
+        cases.push_back( bc );
+
+        bc.Name     = "culling_aabb_frustum";
+        bc.Info     = "65536 vaBoundingBox::IntersectFrustum";
+        bc.Run      = [data]( )
+        {
+            uint64 inside = 0;
+            for( auto & box : data->Boxes )
+                inside += ( box.IntersectFrustum( data->Planes, 6 ) != vaIntersectType::Outside ) ? ( 1 ) : ( 0 );
+            Sink( inside );
+        };
+        cases.push_back( bc );
+
+        bc.Name     = "culling_obb_frustum";
+        bc.Info     = "65536 vaOrientedBoundingBox::IntersectFrustum";
+        bc.Run      = [data]( )
+        {
+            uint64 inside = 0;
+            for( auto & obb : data->OBBs )
+                inside += ( obb.IntersectFrustum( data->Planes, 6 ) != vaIntersectType::Outside ) ? ( 1 ) : ( 0 );
+            Sink( inside );
+        };
+        cases.push_back( bc );
+    }
+
+    static void AddSceneCases( std::vector<BenchmarkCase> & cases )
+    {
+        auto scene = std::make_shared<shared_ptr<vaScene>>( );
+
+        // 4 levels deep, 8-way branching hierarchy -> 4680 objects
+        auto setup = [scene]( )
+        {
+            vaRandom rnd( 2 );
+            *scene = std::make_shared<vaScene>( "Benchmark" );
+            std::function<void( const shared_ptr<vaSceneObject> &, int )> addChildren = [&]( const shared_ptr<vaSceneObject> & parent, int depth )
+            {
+                if( depth == 0 )
+                    return;
+                for( int i = 0; i < 8; i++ )
+                {
+                    vaVector3 pos( rnd.NextFloatRange( -40.0f, 40.0f ), rnd.NextFloatRange( -40.0f, 40.0f ), rnd.NextFloatRange( -10.0f, 10.0f ) );
+                    vaQuaternion rot = vaQuaternion::FromYawPitchRoll( rnd.NextFloatRange( -VA_PIf, VA_PIf ), 0.0f, 0.0f );
+                    auto obj = (*scene)->CreateObject( vaStringTools::Format( "obj_%d_%d", depth, i ), vaVector3( 1.0f, 1.0f, 1.0f ), rot, pos / (float)( 5 - depth ), parent );
+                    addChildren( obj, depth - 1 );
+                }
+            };
+            addChildren( nullptr, 4 );
+            (*scene)->Tick( 1.0f / 60.0f );  // flush deferred object actions
+        };
+        auto teardown = [scene]( ) { (*scene)->Clear( ); *scene = nullptr; };
+
+        BenchmarkCase bc;
+        bc.Setup    = setup;
+        bc.Teardown = teardown;
+
+        bc.Name     = "scene_tick";
+        bc.Info     = "vaScene::Tick, 4680 objects in a 4 level hierarchy";
+        bc.Run      = [scene]( ) { (*scene)->Tick( 1.0f / 60.0f ); };
+        cases.push_back( bc );
+
+        // no meshes here (that needs a render device) so this measures hierarchy traversal + bounds culling only
+        bc.Name     = "scene_select_frustum";
+        bc.Info     = "vaScene::SelectForRendering with frustum culling, 4680 objects, no meshes";
+        bc.Run      = [scene]( )
+        {
+            vaRenderSelection::FilterSettings filter;
+            filter.FrustumPlanes.resize( 6 );
+            BenchmarkFrustumPlanes( &filter.FrustumPlanes[0] );
+            Sink( (uint64)(*scene)->SelectForRendering( nullptr, nullptr, filter ) );
+        };
+        cases.push_back( bc );
+    }
+
+    class BenchmarkUIDObject : public vaUIDObject, public std::enable_shared_from_this<BenchmarkUIDObject>
+    {
+    public:
+        BenchmarkUIDObject( ) : vaUIDObject( vaGUID::Create( ) ) { }
+    };
+
+    // GUID -> object resolves, as done for every mesh/material reference during scene selection
+    static void AddUIDRegistrarCases( std::vector<BenchmarkCase> & cases )
+    {
+        struct Data
+        {
+            std::vector<shared_ptr<BenchmarkUIDObject>>     Objects;
+            std::vector<vaGUID>                             IDs;
+            std::vector<std::weak_ptr<BenchmarkUIDObject>>  Cache;
+        };
+        auto data = std::make_shared<Data>( );
+
+        BenchmarkCase bc;
+        bc.Setup    = [data]( )
+        {
+            for( int i = 0; i < 16384; i++ )
+            {
+                auto obj = std::make_shared<BenchmarkUIDObject>( );
+                obj->UIDObject_Track( );
+                data->IDs.push_back( obj->UIDObject_GetUID( ) );
+                data->Objects.push_back( obj );
+            }
+            data->Cache.resize( data->IDs.size( ) );
+        };
+        bc.Teardown = [data]( )
+        {
+            for( auto & obj : data->Objects )
+                obj->UIDObject_Untrack( );
+            data->Objects.clear( ); data->IDs.clear( ); data->Cache.clear( );
+        };
+
+        bc.Name     = "uid_find";
+        bc.Info     = "vaUIDObjectRegistrar::Find, 16384 tracked objects";
+        bc.Run      = [data]( )
+        {
+            uint64 found = 0;
+            for( const vaGUID & id : data->IDs )
+                found += ( vaUIDObjectRegistrar::Find<BenchmarkUIDObject>( id ) != nullptr ) ? 1 : 0;
+            Sink( found );
+        };
+        cases.push_back( bc );
+
+        bc.Name     = "uid_find_cached";
+        bc.Info     = "vaUIDObjectRegistrar::FindCached (warm weak_ptr cache), 16384 tracked objects";
+        bc.Run      = [data]( )
+        {
+            uint64 found = 0;
+            for( size_t i = 0; i < data->IDs.size( ); i++ )
+                found += ( vaUIDObjectRegistrar::GetInstance( ).FindCached<BenchmarkUIDObject>( data->IDs[i], data->Cache[i] ) != nullptr ) ? 1 : 0;
+            Sink( found );
+        };
+        cases.push_back( bc );
+    }
+
+    // per-frame transient containers (draw list / sort keys / indices sized), rebuilt from scratch every 'frame'
+    static void AddFrameArenaCases( std::vector<BenchmarkCase> & cases )
+    {
+        struct Data
+        {
+            shared_ptr<vaFrameArena>    Arena;
+            int64                       Frame   = 0;
+        };
+        auto data = std::make_shared<Data>( );
+        const int c_itemCount = 8192;
+
+        auto fill = []( vaFrameArena * arena, int itemCount )
+        {
+            vaFrameArenaVector<vaMatrix4x4>         transforms( ( vaFrameArenaAllocator<vaMatrix4x4>( arena ) ) );
+            vaFrameArenaVector<pair<int,float>>     sortKeys( ( vaFrameArenaAllocator<pair<int,float>>( arena ) ) );
+            vaFrameArenaVector<int>                 indices( ( vaFrameArenaAllocator<int>( arena ) ) );
+            for( int i = 0; i < itemCount; i++ )
+            {
+                transforms.push_back( vaMatrix4x4::Identity );
+                sortKeys.push_back( { i & 3, (float)( ( i * 7919 ) % itemCount ) } );
+                indices.push_back( i );
+            }
+            Sink( (uint64)( transforms.size( ) + sortKeys.size( ) + indices.size( ) ) );
+        };
+
+        BenchmarkCase bc;
+        bc.Name     = "transient_vectors_heap";
+        bc.Info     = "3 growing std::vectors, 8192 items each, general heap";
+        bc.Run      = [fill, c_itemCount]( ) { fill( nullptr, c_itemCount ); };
+        cases.push_back( bc );
+
+        bc.Name     = "transient_vectors_arena";
+        bc.Info     = "3 growing std::vectors, 8192 items each, vaFrameArena (3 frames in flight) reset every run";
+        bc.Setup    = [data]( ) { data->Arena = std::make_shared<vaFrameArena>( 3 ); data->Frame = 0; };
+        bc.Teardown = [data]( ) { data->Arena = nullptr; };
+        bc.Run      = [data, fill, c_itemCount]( ) { data->Arena->BeginFrame( ++data->Frame ); fill( data->Arena.get( ), c_itemCount ); };
+        cases.push_back( bc );
+    }
+
+    static void AddUploadRingTests( std::vector<TestCase> & tests )
+    {
+        TestCase tc;
+        tc.Name = "upload_ring";
+        tc.Run  = [ ]( )
+        {
+            uint64 offset = 0, offset2 = 0;
+            vaUploadRingAllocator ring( 1024, 2 );
+            ring.BeginFrame( 0 );
+            Check( ring.Allocate( 100, 256, offset ) && offset == 0, "upload ring first allocation" );
+            Check( ring.Allocate( 100, 256, offset ) && offset == 256, "upload ring alignment" );
+            Check( ring.Allocate( 512, 256, offset ) && offset == 512, "upload ring fills to the end" );
+            Check( !ring.Allocate( 1, 1, offset ) && ring.GetStats( ).TotalFailedAllocations == 1, "upload ring fails when full" );
+            ring.BeginFrame( 1 );
+            Check( !ring.Allocate( 1, 1, offset ), "upload ring keeps slices of frames in flight" );
+            ring.BeginFrame( 2 );
+            Check( ring.GetStats( ).LastFrameUsedBytes == 0 && ring.GetStats( ).InFlightBytes == 0, "upload ring releases after frames in flight" );
+            Check( ring.Allocate( 512, 256, offset ) && offset == 0, "upload ring reuse after release" );
+            ring.BeginFrame( 3 );
+            Check( ring.Allocate( 256, 256, offset ) && offset == 512 && !ring.Allocate( 512, 256, offset2 ), "upload ring doesn't overwrite frames in flight" );
+            ring.BeginFrame( 4 );
+            // 256 bytes left before the end - a 384 byte slice doesn't fit so it must wrap to the start and skip the remainder
+            Check( ring.Allocate( 384, 128, offset ) && offset == 0 && ring.GetStats( ).InFlightBytes == 256 + 256 + 384, "upload ring wraps without straddling the end" );
+            ring.BeginFrame( 10 );
+            Check( ring.GetStats( ).InFlightBytes == 0 && ring.Allocate( 1024, 256, offset ) && offset == 0, "upload ring handles skipped frames" );
+        };
+        tests.push_back( tc );
+    }
+
+    static void AddUploadRingCases( std::vector<BenchmarkCase> & cases )
+    {
+        struct Data
+        {
+            shared_ptr<vaUploadRingAllocator>   Ring;
+            std::vector<uint8>                  Memory;         // stands in for the mapped upload buffer
+            int64                               Frame   = 0;
+        };
+        auto data = std::make_shared<Data>( );
+        const int       c_drawCount     = 4096;
+        const uint64    c_capacity      = 4 * 1024 * 1024;
+
+        BenchmarkCase bc;
+        bc.Name     = "upload_ring_constants";
+        bc.Info     = "4096 per-draw constant uploads (176 bytes, 256 aligned) into a 4MB vaUploadRingAllocator, 2 frames in flight";
+        bc.Setup    = [data, c_capacity]( )
+        {
+            data->Ring      = std::make_shared<vaUploadRingAllocator>( c_capacity, 2 );
+            data->Memory.resize( (size_t)c_capacity );
+            data->Frame     = 0;
+        };
+        bc.Teardown = [data]( ) { data->Ring = nullptr; data->Memory.clear( ); data->Memory.shrink_to_fit( ); };
+        bc.Run      = [data, c_drawCount]( )
+        {
+            data->Ring->BeginFrame( ++data->Frame );
+            uint8 constants[176];
+            for( int i = 0; i < c_drawCount; i++ )
+            {
+                constants[0] = (uint8)i;
+                uint64 offset;
+                if( !data->Ring->Allocate( sizeof( constants ), 256, offset ) )
+                {
+                    VA_LOG_ERROR( "Benchmark upload ring out of space" );
+                    break;
+                }
+                memcpy( &data->Memory[(size_t)offset], constants, sizeof( constants ) );
+            }
+            Sink( data->Ring->GetStats( ).InFlightBytes );
+        };
+        cases.push_back( bc );
+    }
+
+    static void AddImageMetricsCases( std::vector<BenchmarkCase> & cases )
+    {
+        struct Data
+        {
+            std::vector<uint8>          Reference;
+            std::vector<uint8>          Test;
+        };
+        auto data = std::make_shared<Data>( );
+        const int c_width = 1920, c_height = 1080;
+
+        // gradients + noise for the reference, and a slightly blurred/noisier copy for the test image (roughly what a
+        // coarse VRS rate does to it)
+        auto setup = [data, c_width, c_height]( )
+        {
+            vaRandom rnd( 5 );
+            data->Reference.resize( (size_t)c_width * c_height * 4 );
+            data->Test.resize( data->Reference.size( ) );
+            for( int y = 0; y < c_height; y++ )
+                for( int x = 0; x < c_width; x++ )
+                {
+                    uint8 * p = &data->Reference[( (size_t)y * c_width + x ) * 4];
+                    p[0] = (uint8)( ( x * 255 ) / c_width );
+                    p[1] = (uint8)( ( y * 255 ) / c_height );
+                    p[2] = (uint8)( rnd.NextIntRange( 256 ) );
+                    p[3] = 255;
+                }
+            for( int y = 0; y < c_height; y++ )
+                for( int x = 0; x < c_width; x++ )
+                    for( int c = 0; c < 4; c++ )
+                    {
+                        int xn = vaMath::Min( x + 1, c_width - 1 );
+                        int val = ( data->Reference[( (size_t)y * c_width + x ) * 4 + c] + data->Reference[( (size_t)y * c_width + xn ) * 4 + c] ) / 2 + rnd.NextIntRange( -2, 3 );
+                        data->Test[( (size_t)y * c_width + x ) * 4 + c] = (uint8)vaMath::Clamp( val, 0, 255 );
+                    }
+        };
+        auto teardown = [data]( ) { *data = Data( ); };
+
+        auto compare = [data, c_width, c_height]( const vaImageMetrics::Settings & settings )
+        {
+            vaImageMetrics::Image reference( data->Reference.data( ), c_width, c_height, c_width * 4, vaResourceFormat::R8G8B8A8_UNORM );
+            vaImageMetrics::Image test( data->Test.data( ), c_width, c_height, c_width * 4, vaResourceFormat::R8G8B8A8_UNORM );
+            vaImageMetrics::Results results;
+            vaImageMetrics::Compare( reference, test, settings, results );
+            Sink( (float)results.MSE );
+            Sink( (float)results.SSIM );
+            Sink( (float)results.MSSSIM );
+        };
+
+        BenchmarkCase bc;
+        bc.Setup        = setup;
+        bc.Teardown     = teardown;
+        bc.BytesPerRun  = (int64)c_width * c_height * 4 * 2;
+
+        bc.Name     = "image_metrics_psnr";
+        bc.Info     = "vaImageMetrics::Compare MSE/PSNR only, 1920x1080 RGBA8";
+        bc.Run      = [compare]( ) { vaImageMetrics::Settings settings; settings.SSIM = false; settings.MSSSIM = false; compare( settings ); };
+        cases.push_back( bc );
+
+        bc.Name     = "image_metrics_ssim";
+        bc.Info     = "vaImageMetrics::Compare MSE/PSNR + SSIM + MS-SSIM, 1920x1080 RGBA8";
+        bc.Run      = [compare]( ) { vaImageMetrics::Settings settings; compare( settings ); };
+        cases.push_back( bc );
+    }
+
+    // float RGBA image owning its pixels
+    static vaImageMetrics::Image MakeFloatImage( int width, int height, const std::function<vaVector3( int x, int y )> & texel )
+    {
+        auto storage = std::make_shared<std::vector<uint8>>( (size_t)width * height * 4 * sizeof( float ) );
+        float * dst = (float *)storage->data( );
+        for( int y = 0; y < height; y++ )
+            for( int x = 0; x < width; x++ )
+            {
+                vaVector3 value = texel( x, y );
+                float * p = &dst[( (size_t)y * width + x ) * 4];
+                p[0] = value.x; p[1] = value.y; p[2] = value.z; p[3] = 1.0f;
+            }
+        vaImageMetrics::Image image( storage->data( ), width, height, width * 4 * (int)sizeof( float ), vaResourceFormat::R32G32B32A32_FLOAT );
+        image.Storage = storage;
+        return image;
+    }
+
+    // probes filled with radiance( direction ), sampled at texel centers
+    static vaSphericalHarmonics::Probe MakeSHCubeProbe( int dim, const std::function<vaVector3( const vaVector3 & )> & radiance )
+    {
+        vaImageMetrics::Image faces[6];
+        for( int face = 0; face < 6; face++ )
+            faces[face] = MakeFloatImage( dim, dim, [&]( int x, int y )
+            {
+                // D3D cube map face layout, s and t in [-1, 1] with t going down
+                float s = ( x + 0.5f ) * 2.0f / dim - 1.0f, t = ( y + 0.5f ) * 2.0f / dim - 1.0f;
+                const vaVector3 dirs[6] = { { 1.0f, -t, -s }, { -1.0f, -t, s }, { s, 1.0f, t }, { s, -1.0f, -t }, { s, -t, 1.0f }, { -s, -t, -1.0f } };
+                return radiance( dirs[face].Normalized( ) );
+            } );
+        return vaSphericalHarmonics::Probe( faces );
+    }
+    static vaSphericalHarmonics::Probe MakeSHEquirectProbe( int width, const std::function<vaVector3( const vaVector3 & )> & radiance )
+    {
+        return vaSphericalHarmonics::Probe( MakeFloatImage( width, width / 2, [&]( int x, int y )
+        {
+            // DirToRectilinear in vaIBL.hlsl: u = ( phi / PI + 1 ) / 2, v = ( 1 - lat * 2 / PI ) / 2
+            float phi = ( ( x + 0.5f ) * 2.0f / width - 1.0f ) * VA_PIf;
+            float lat = ( 1.0f - ( y + 0.5f ) * 4.0f / width ) * VA_PIf * 0.5f;
+            return radiance( vaVector3( std::cos( lat ) * std::sin( phi ), -std::cos( lat ) * std::cos( phi ), std::sin( lat ) ) );
+        } ) );
+    }
+
+    static void AddSphericalHarmonicsTests( std::vector<TestCase> & tests )
+    {
+        TestCase tc;
+        tc.Name = "spherical_harmonics";
+        tc.Run  = [ ]( )
+        {
+            // raw SH against the analytic integrals of radiance * basis (1, -y, z, -x, 6xy, -3yz, 1.5z^2-0.5, -3xz, 3(x^2-y^2))
+            auto matches = [ ]( const vaSphericalHarmonics::SH3 & sh, const vaSphericalHarmonics::SH3 & expected, float tolerance )
+            {
+                for( int i = 0; i < vaSphericalHarmonics::c_numCoefs; i++ )
+                    for( int c = 0; c < 3; c++ )
+                        if( !( std::abs( sh[i][c] - expected[i][c] ) <= tolerance ) )
+                            return false;
+                return true;
+            };
+            const vaVector3 zero( 0.0f, 0.0f, 0.0f );
+
+            // constant radiance: only the constant term is left, 4*PI*color, and the irradiance / PI the shader gets back is the color;
+            // the equirectangular rows sample z^2 at their center latitude, hence the larger tolerance there
+            const vaVector3 color( 1.0f, 0.5f, 0.25f );
+            auto constant = [color]( const vaVector3 & ) { return color; };
+            vaSphericalHarmonics::SH3 expected;
+            expected.fill( zero );
+            expected[0] = color * ( 4.0f * VA_PIf );
+            vaSphericalHarmonics::SH3 cubeSH, equirectSH;
+            Check( vaSphericalHarmonics::Project( MakeSHCubeProbe( 32, constant ), cubeSH ), "constant SH cube probe is valid" );
+            Check( vaSphericalHarmonics::Project( MakeSHEquirectProbe( 128, constant ), equirectSH ), "constant SH equirectangular probe is valid" );
+            Check( matches( cubeSH, expected, 1e-3f ), "constant radiance cube projects to the constant term" );
+            Check( matches( equirectSH, expected, 5e-3f ), "constant radiance equirectangular image projects to the constant term" );
+
+            vaSphericalHarmonics::SH3 shaderSH = vaSphericalHarmonics::PreprocessForShader( cubeSH );
+            vaRandom rnd( 7 );
+            bool irradianceMatches = true;
+            for( int i = 0; i < 64; i++ )
+            {
+                vaVector3 normal = vaVector3( rnd.NextFloatRange( -1.0f, 1.0f ), rnd.NextFloatRange( -1.0f, 1.0f ), rnd.NextFloatRange( -1.0f, 1.0f ) + 0.01f ).Normalized( );
+                vaVector3 irradiance = vaSphericalHarmonics::EvaluateIrradiance( shaderSH, normal );
+                for( int c = 0; c < 3; c++ )
+                    irradianceMatches &= std::abs( irradiance[c] - color[c] ) <= 0.01f * color[c];
+            }
+            Check( irradianceMatches, "constant radiance irradiance equals radiance" );
+
+            // clamped cosine lobe max( 0, dot( dir, axis ) ) around +X, +Y and +Z; the lobe edges fall on texel edges of both
+            // layouts so the texel center sampling stays accurate
+            const float pi = VA_PIf;
+            const vaVector3 axes[3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+            const float lobeSH[3][vaSphericalHarmonics::c_numCoefs] =
+            {
+                { pi, 0.0f, 0.0f, -2.0f * pi / 3.0f, 0.0f, 0.0f, -pi / 8.0f, 0.0f, 3.0f * pi / 4.0f },
+                { pi, -2.0f * pi / 3.0f, 0.0f, 0.0f, 0.0f, 0.0f, -pi / 8.0f, 0.0f, -3.0f * pi / 4.0f },
+                { pi, 0.0f, 2.0f * pi / 3.0f, 0.0f, 0.0f, 0.0f, pi / 4.0f, 0.0f, 0.0f },
+            };
+            for( int a = 0; a < 3; a++ )
+            {
+                const vaVector3 axis = axes[a];
+                auto lobe = [axis]( const vaVector3 & dir ) { float v = std::max( 0.0f, vaVector3::Dot( dir, axis ) ); return vaVector3( v, v, v ); };
+                for( int i = 0; i < vaSphericalHarmonics::c_numCoefs; i++ )
+                    expected[i] = vaVector3( lobeSH[a][i], lobeSH[a][i], lobeSH[a][i] );
+                Check( vaSphericalHarmonics::Project( MakeSHCubeProbe( 64, lobe ), cubeSH ) && matches( cubeSH, expected, 2e-3f ), "single lobe cube projects to its analytic SH" );
+                Check( vaSphericalHarmonics::Project( MakeSHEquirectProbe( 256, lobe ), equirectSH ) && matches( equirectSH, expected, 2e-3f ), "single lobe equirectangular image projects to its analytic SH" );
+            }
+
+            // mismatched cube face sizes get rejected
+            vaImageMetrics::Image faces[6];
+            for( int face = 0; face < 6; face++ )
+                faces[face] = MakeFloatImage( ( face == 5 ) ? ( 16 ) : ( 32 ), ( face == 5 ) ? ( 16 ) : ( 32 ), [color]( int, int ) { return color; } );
+            Check( !vaSphericalHarmonics::Project( vaSphericalHarmonics::Probe( faces ), cubeSH ) && cubeSH[0] == zero, "invalid SH probe is rejected" );
+        };
+        tests.push_back( tc );
+    }
+
+    static void AddPoissonDiskCases( std::vector<BenchmarkCase> & cases )
+    {
+        auto sinkPoints = []( const vector<vaVector2> & points )
+        {
+            Sink( (uint64)points.size( ) );
+            if( !points.empty( ) )
+                Sink( points.back( ).x );
+        };
+
+        BenchmarkCase bc;
+
+        bc.Name     = "poisson_rect_dart_throwing";
+        bc.Info     = "vaPoissonDiskGenerator::SampleRectangle (original), 100x100, min distance 1 (~6k points)";
+        bc.Run      = [sinkPoints]( ) { vector<vaVector2> points; vaPoissonDiskGenerator::SampleRectangle( { 0, 0 }, { 100, 100 }, 1.0f, points ); sinkPoints( points ); };
+        cases.push_back( bc );
+
+        bc.Name     = "poisson_rect_bridson";
+        bc.Info     = "vaPoissonDiskGenerator::SampleRectangleBridson, 100x100, min distance 1 (~6k points)";
+        bc.Run      = [sinkPoints]( ) { vector<vaVector2> points; vaPoissonDiskGenerator::SampleRectangleBridson( { 0, 0 }, { 100, 100 }, 1.0f, 1, points ); sinkPoints( points ); };
+        cases.push_back( bc );
+
+        bc.Name     = "poisson_large_bridson";
+        bc.Info     = "vaPoissonDiskGenerator::SampleRectangleBridson, 400x400, min distance 1 (~100k points)";
+        bc.Run      = [sinkPoints]( ) { vector<vaVector2> points; vaPoissonDiskGenerator::SampleRectangleBridson( { 0, 0 }, { 400, 400 }, 1.0f, 1, points ); sinkPoints( points ); };
+        cases.push_back( bc );
+
+        bc.Name     = "poisson_large_tiled";
+        bc.Info     = "vaPoissonDiskGenerator::SampleRectangleTiled, 400x400, min distance 1 (~100k points), vaParallel";
+        bc.Run      = [sinkPoints]( ) { vector<vaVector2> points; vaPoissonDiskGenerator::SampleRectangleTiled( { 0, 0 }, { 400, 400 }, 1.0f, 1, points ); sinkPoints( points ); };
+        cases.push_back( bc );
+
+        // typical SSAO / DoF kernel: 32 points in the unit circle, with the center point removed
+        bc.Name     = "poisson_search_params";
+        bc.Info     = "vaPoissonDiskGenerator::SearchCircleByParams (original), 32 points in a unit circle";
+        bc.Run      = [sinkPoints]( ) { vector<vaVector2> points; float minDist; vaPoissonDiskGenerator::SearchCircleByParams( { 0, 0 }, 1.0f, 32, true, true, points, minDist ); sinkPoints( points ); };
+        cases.push_back( bc );
+
+        bc.Name     = "poisson_search_bisection";
+        bc.Info     = "vaPoissonDiskGenerator::SearchCircleByBisection, 32 points in a unit circle";
+        bc.Run      = [sinkPoints]( ) { vector<vaVector2> points; float minDist; vaPoissonDiskGenerator::SearchCircleByBisection( { 0, 0 }, 1.0f, 32, true, true, 1, points, minDist ); sinkPoints( points ); };
+        cases.push_back( bc );
+    }
+
+    static void AddDataCases( std::vector<BenchmarkCase> & cases )
+    {
+        struct Data
+        {
+            std::vector<byte>           Source;
+            std::vector<byte>           Decompressed;
+            shared_ptr<vaMemoryStream>  Compressed;
+        };
+        auto data = std::make_shared<Data>( );
+
+        // semi-compressible data: mix of runs, small-alphabet noise and float ramps; 16MB
+        auto setup = [data]( )
+        {
+            vaRandom rnd( 3 );
+            data->Source.resize( 16 * 1024 * 1024 );
+            size_t i = 0;
+            while( i < data->Source.size( ) )
+            {
+                size_t chunk = vaMath::Min( data->Source.size( ) - i, (size_t)rnd.NextIntRange( 64, 4096 ) );
+                int type = rnd.NextIntRange( 3 );
+                for( size_t j = 0; j < chunk; j++ )
+                {
+                    byte val;
+                    if( type == 0 )         val = (byte)( chunk & 0xFF );
+                    else if( type == 1 )    val = (byte)( rnd.NextIntRange( 16 ) );
+                    else                    val = (byte)( ( j * 7 ) & 0xFF );
+                    data->Source[i+j] = val;
+                }
+                i += chunk;
+            }
+            data->Decompressed.resize( data->Source.size( ) );
+
+            // pre-compressed copy for the decompression case
+            data->Compressed = std::make_shared<vaMemoryStream>( (int64)0, (int64)data->Source.size( ) );
+            vaCompressionStream compressor( false, data->Compressed.get( ) );
+            compressor.Write( data->Source.data( ), (int64)data->Source.size( ) );
+            compressor.Close( );
+        };
+        auto teardown = [data]( ) { *data = Data( ); };
+
+        BenchmarkCase bc;
+        bc.Setup        = setup;
+        bc.Teardown     = teardown;
+        bc.BytesPerRun  = 16 * 1024 * 1024;
+
+        bc.Name     = "xxhash64";
+        bc.Info     = "vaXXHash64::Compute, 16MB";
+        bc.Run      = [data]( ) { Sink( vaXXHash64::Compute( data->Source.data( ), (int64)data->Source.size( ) ) ); };
+        cases.push_back( bc );
+
+        bc.Name     = "compression_stream_compress";
+        bc.Info     = "vaCompressionStream write (default profile), 16MB";
+        bc.Run      = [data]( )
+        {
+            vaMemoryStream output( (int64)0, (int64)data->Source.size( ) );
+            vaCompressionStream compressor( false, &output );
+            compressor.Write( data->Source.data( ), (int64)data->Source.size( ) );
+            compressor.Close( );
+            Sink( (uint64)output.GetLength( ) );
+        };
+        cases.push_back( bc );
+
+        bc.Name     = "compression_stream_decompress";
+        bc.Info     = "vaCompressionStream read (default profile), 16MB";
+        bc.Run      = [data]( )
+        {
+            data->Compressed->Seek( 0 );
+            vaCompressionStream decompressor( true, data->Compressed.get( ) );
+            decompressor.Read( data->Decompressed.data( ), (int64)data->Decompressed.size( ) );
+            decompressor.Close( );
+            Sink( (uint64)data->Decompressed[data->Decompressed.size( ) / 2] );
+        };
+        cases.push_back( bc );
+    }
+
+    static void AddMeshToolsCases( std::vector<BenchmarkCase> & cases )
+    {
+        struct Data
+        {
+            std::vector<vaVector3>      Triangles;      // 3 per triangle, unwelded
+            std::vector<vaVector3>      Vertices;
+            std::vector<uint32>         Indices;
+            std::vector<vaVector3>      Normals;
+        };
+        auto data = std::make_shared<Data>( );
+
+        // 48x48 quad height-field grid, 4608 triangles
+        auto setup = [data]( )
+        {
+            vaRandom rnd( 4 );
+            const int gridSize = 48;
+            std::vector<float> heights( ( gridSize + 1 ) * ( gridSize + 1 ) );
+            for( auto & h : heights )
+                h = rnd.NextFloatRange( 0.0f, 0.5f );
+            auto vert = [&]( int x, int y ) { return vaVector3( (float)x, (float)y, heights[x + y * ( gridSize + 1 )] ); };
+            for( int y = 0; y < gridSize; y++ )
+                for( int x = 0; x < gridSize; x++ )
+                {
+                    data->Triangles.push_back( vert( x, y ) );     data->Triangles.push_back( vert( x + 1, y ) );     data->Triangles.push_back( vert( x + 1, y + 1 ) );
+                    data->Triangles.push_back( vert( x, y ) );     data->Triangles.push_back( vert( x + 1, y + 1 ) ); data->Triangles.push_back( vert( x, y + 1 ) );
+                }
+            // welded version for the normals case
+            for( size_t i = 0; i < data->Triangles.size( ); i += 3 )
+                vaTriangleMeshTools::AddTriangle_MergeSamePositionVertices( data->Vertices, data->Indices, data->Triangles[i+0], data->Triangles[i+1], data->Triangles[i+2], gridSize * 2 + 4 );
+        };
+        auto teardown = [data]( ) { *data = Data( ); };
+
+        BenchmarkCase bc;
+        bc.Setup    = setup;
+        bc.Teardown = teardown;
+
+        bc.Name     = "meshtools_weld";
+        bc.Info     = "vaTriangleMeshTools::AddTriangle_MergeSamePositionVertices, 48x48 grid, 4608 triangles";
+        bc.Run      = [data]( )
+        {
+            std::vector<vaVector3> vertices;
+            std::vector<uint32> indices;
+            vertices.reserve( data->Triangles.size( ) );
+            indices.reserve( data->Triangles.size( ) );
+            for( size_t i = 0; i < data->Triangles.size( ); i += 3 )
+                vaTriangleMeshTools::AddTriangle_MergeSamePositionVertices( vertices, indices, data->Triangles[i+0], data->Triangles[i+1], data->Triangles[i+2], 48 * 2 + 4 );
+            Sink( (uint64)vertices.size( ) );
+        };
+        cases.push_back( bc );
+
+        bc.Name     = "meshtools_generate_normals";
+        bc.Info     = "vaTriangleMeshTools::GenerateNormals, 48x48 grid, 4608 triangles";
+        bc.Run      = [data]( )
+        {
+            vaTriangleMeshTools::GenerateNormals( data->Normals, data->Vertices, data->Indices, vaWindingOrder::Clockwise );
+            Sink( data->Normals[data->Normals.size( ) / 2].z );
+        };
+        cases.push_back( bc );
+    }
+
+    // 1500x1100 RGBA (odd sized mips and partial edge blocks) written as version 0 (hand written, 128 blocks), version 1
+    // and version 2 with and without compression; the reference mip pyramid is box filtered the same way the files are
+    struct LargeBitmapFixture
+    {
+        static const int                    c_width     = 1500;
+        static const int                    c_height    = 1100;
+        static const int                    c_overviewLevel = 3;        // 1/8 - what a zoomed out view would read
+
+        enum FileType { V0, V1, V2, V2Compressed, FileTypeCount };
+
+        wstring                             Paths[FileTypeCount];
+        std::vector<std::vector<uint8>>     Levels;         // reference pyramid, RGBA, tightly packed
+        std::vector<std::pair<int, int>>    LevelSizes;
+
+        static void Downsample( const std::vector<uint8> & src, int srcWidth, int srcHeight, std::vector<uint8> & dst )
+        {
+            const int dstWidth = ( srcWidth + 1 ) / 2, dstHeight = ( srcHeight + 1 ) / 2;
+            dst.resize( (size_t)dstWidth * dstHeight * 4 );
+            for( int y = 0; y < dstHeight; y++ )
+                for( int x = 0; x < dstWidth; x++ )
+                {
+                    const int sx0 = x * 2, sx1 = vaMath::Min( x * 2 + 1, srcWidth - 1 ), sy0 = y * 2, sy1 = vaMath::Min( y * 2 + 1, srcHeight - 1 );
+                    for( int c = 0; c < 4; c++ )
+                        dst[( (size_t)y * dstWidth + x ) * 4 + c] = (uint8)( ( (int)src[( (size_t)sy0 * srcWidth + sx0 ) * 4 + c] + src[( (size_t)sy0 * srcWidth + sx1 ) * 4 + c] 
+                            + src[( (size_t)sy1 * srcWidth + sx0 ) * 4 + c] + src[( (size_t)sy1 * srcWidth + sx1 ) * 4 + c] + 2 ) / 4 );
+                }
+        }
+
+        void Create( )
+        {
+            // smooth gradients with a bit of noise, compresses somewhat like real imagery
+            vaRandom rnd( 4 );
+            Levels.resize( 1 );
+            Levels[0].resize( (size_t)c_width * c_height * 4 );
+            for( int y = 0; y < c_height; y++ )
+                for( int x = 0; x < c_width; x++ )
+                {
+                    uint8 * p = &Levels[0][( (size_t)y * c_width + x ) * 4];
+                    p[0] = (uint8)( x / 6 );
+                    p[1] = (uint8)( y / 5 );
+                    p[2] = (uint8)( ( ( x + y ) / 9 ) ^ ( rnd.NextUINT32( ) & 3 ) );
+                    p[3] = 255;
+                }
+            LevelSizes = { { c_width, c_height } };
+            while( LevelSizes.back( ).first > 1 || LevelSizes.back( ).second > 1 )
+            {
+                std::vector<uint8> next;
+                Downsample( Levels.back( ), LevelSizes.back( ).first, LevelSizes.back( ).second, next );
+                LevelSizes.push_back( { vaMath::Max( 1, ( LevelSizes.back( ).first + 1 ) / 2 ), vaMath::Max( 1, ( LevelSizes.back( ).second + 1 ) / 2 ) } );
+                Levels.push_back( std::move( next ) );
+            }
+
+            wstring basePath = vaCore::GetExecutableDirectory( ) + L".cache\\";
+            vaFileTools::EnsureDirectoryExists( basePath );
+            const wchar_t * names[FileTypeCount] = { L"lbf_test_v0.lbf", L"lbf_test_v1.lbf", L"lbf_test_v2.lbf", L"lbf_test_v2_compressed.lbf" };
+            for( int i = 0; i < FileTypeCount; i++ )
+                Paths[i] = basePath + names[i];
+
+            // version 0: header (format, width, height, version) and 128x128 blocks back to back, row by row
+            {
+                const int blockDim = 128;
+                vaFileStream file;
+                Check( file.Open( Paths[V0], FileCreationMode::Create, FileAccessMode::Write ), "large bitmap v0 create" );
+                uint8 header[vaLargeBitmapFile::c_TotalHeaderSize] = { };
+                const int32 headerValues[4] = { (int32)vaLargeBitmapFile::Format32BitRGBA, c_width, c_height, 0 };
+                memcpy( header, headerValues, sizeof( headerValues ) );
+                file.Write( header, sizeof( header ) );
+                std::vector<uint8> block;
+                for( int by = 0; by * blockDim < c_height; by++ )
+                    for( int bx = 0; bx * blockDim < c_width; bx++ )
+                    {
+                        const int bw = vaMath::Min( blockDim, c_width - bx * blockDim ), bh = vaMath::Min( blockDim, c_height - by * blockDim );
+                        block.resize( (size_t)bw * bh * 4 );
+                        for( int y = 0; y < bh; y++ )
+                            memcpy( &block[(size_t)y * bw * 4], &Levels[0][( (size_t)( by * blockDim + y ) * c_width + bx * blockDim ) * 4], (size_t)bw * 4 );
+                        file.Write( block.data( ), (int64)block.size( ) );
+                    }
+                file.Close( );
+            }
+
+            const vaLargeBitmapFile::StorageFlags flags[FileTypeCount] = { vaLargeBitmapFile::StorageFlags::None, vaLargeBitmapFile::StorageFlags::None, 
+                vaLargeBitmapFile::StorageFlags::MipPyramid, vaLargeBitmapFile::StorageFlags::MipPyramid | vaLargeBitmapFile::StorageFlags::Compressed };
+            for( int i = V1; i < FileTypeCount; i++ )
+            {
+                shared_ptr<vaLargeBitmapFile> file = vaLargeBitmapFile::Create( Paths[i], vaLargeBitmapFile::Format32BitRGBA, c_width, c_height, flags[i] );
+                Check( file != nullptr, "large bitmap create" );
+                if( file == nullptr )
+                    continue;
+                Check( file->WriteRect( Levels[0].data( ), c_width * 4, 0, 0, c_width, c_height ), "large bitmap write" );
+                file->Close( );
+            }
+        }
+
+        void Destroy( )
+        {
+            for( const wstring & path : Paths )
+                if( path != L"" )
+                    vaFileTools::DeleteFile( path );
+            Levels.clear( );
+            LevelSizes.clear( );
+        }
+
+        // level 0 read + CPU box filter down to the overview level - the only way to get an overview out of a v0/v1 file
+        static void ReadOverviewFromLevel0( vaLargeBitmapFile & file, std::vector<uint8> & scratch, std::vector<uint8> & outOverview )
+        {
+            int width = file.GetWidth( ), height = file.GetHeight( );
+            scratch.resize( (size_t)width * height * 4 );
+            file.ReadRect( scratch.data( ), width * 4, (int64)scratch.size( ), 0, 0, width, height );
+            for( int level = 0; level < c_overviewLevel; level++ )
+            {
+                Downsample( scratch, width, height, outOverview );
+                width = ( width + 1 ) / 2; height = ( height + 1 ) / 2;
+                std::swap( scratch, outOverview );
+            }
+            std::swap( scratch, outOverview );
+        }
+    };
+
+    static void AddLargeBitmapTests( std::vector<TestCase> & tests )
+    {
+        TestCase tc;
+        tc.Name = "large_bitmap_roundtrip";
+        tc.Run  = [ ]( )
+        {
+            LargeBitmapFixture data;
+            data.Create( );
+
+            auto compareRect = [ &data ]( vaLargeBitmapFile & file, int level, int x, int y, int width, int height ) -> bool
+            {
+                std::vector<uint8> read( (size_t)width * height * 4 );
+                if( !file.ReadRect( read.data( ), width * 4, (int64)read.size( ), x, y, width, height, level ) )
+                    return false;
+                const int levelWidth = data.LevelSizes[level].first;
+                for( int row = 0; row < height; row++ )
+                    if( memcmp( &read[(size_t)row * width * 4], &data.Levels[level][( (size_t)( y + row ) * levelWidth + x ) * 4], (size_t)width * 4 ) != 0 )
+                        return false;
+                return true;
+            };
+
+            for( int i = 0; i < LargeBitmapFixture::FileTypeCount; i++ )
+            {
+                // memory mapped and through the block cache (positional reads)
+                for( bool memoryMap : { true, false } )
+                {
+                    shared_ptr<vaLargeBitmapFile> file = vaLargeBitmapFile::Open( data.Paths[i], true, memoryMap );
+                    Check( file != nullptr, "large bitmap reopen" );
+                    if( file == nullptr )
+                        continue;
+                    file->SetPrefetchEnabled( false );
+                    Check( compareRect( *file, 0, 0, 0, LargeBitmapFixture::c_width, LargeBitmapFixture::c_height ), "large bitmap level 0 matches what was written" );
+                    Check( compareRect( *file, 0, 200, 250, 333, 600 ), "large bitmap level 0 rect across blocks" );
+                    if( i >= LargeBitmapFixture::V2 )
+                    {
+                        bool levelsMatch = file->GetLevelCount( ) == (int)data.Levels.size( );
+                        for( int level = 1; levelsMatch && level < (int)data.Levels.size( ); level++ )
+                            levelsMatch = compareRect( *file, level, 0, 0, data.LevelSizes[level].first, data.LevelSizes[level].second );
+                        Check( levelsMatch, "large bitmap mip levels match the box filtered reference" );
+                    }
+                    else
+                        Check( file->GetLevelCount( ) == 1, "large bitmap v0/v1 have no mips" );
+                    file->Close( );
+                }
+            }
+
+            // report disk size and overview read time (level 0 read + CPU downsample for v1, straight mip level read for v2)
+            int64 sizes[LargeBitmapFixture::FileTypeCount] = { };
+            for( int i = 0; i < LargeBitmapFixture::FileTypeCount; i++ )
+            {
+                vaFileStream stream;
+                if( stream.Open( data.Paths[i], FileCreationMode::Open, FileAccessMode::Read ) )
+                    sizes[i] = stream.GetLength( );
+            }
+            Check( sizes[LargeBitmapFixture::V2Compressed] < sizes[LargeBitmapFixture::V2], "large bitmap compression reduces the file size" );
+
+            double overviewTimes[2] = { };
+            const int overviewFiles[2] = { LargeBitmapFixture::V1, LargeBitmapFixture::V2Compressed };
+            for( int i = 0; i < 2; i++ )
+            {
+                shared_ptr<vaLargeBitmapFile> file = vaLargeBitmapFile::Open( data.Paths[overviewFiles[i]], true );
+                if( file == nullptr )
+                    continue;
+                file->SetPrefetchEnabled( false );
+                std::vector<uint8> scratch, overview;
+                double timeStart = vaCore::TimeFromAppStart( );
+                if( i == 0 )
+                    LargeBitmapFixture::ReadOverviewFromLevel0( *file, scratch, overview );
+                else
+                {
+                    const int level = LargeBitmapFixture::c_overviewLevel;
+                    overview.resize( (size_t)data.LevelSizes[level].first * data.LevelSizes[level].second * 4 );
+                    file->ReadRect( overview.data( ), data.LevelSizes[level].first * 4, (int64)overview.size( ), 0, 0, data.LevelSizes[level].first, data.LevelSizes[level].second, level );
+                }
+                overviewTimes[i] = ( vaCore::TimeFromAppStart( ) - timeStart ) * 1000.0;
+                Check( overview == data.Levels[LargeBitmapFixture::c_overviewLevel], "large bitmap overview matches the reference" );
+                file->Close( );
+            }
+            wprintf( L"  large bitmap: v1 %.2fMB, v2 %.2fMB, v2 compressed %.2fMB (%.0f%% of v1); 1/8 overview read: v1 %.2fms, v2 %.2fms\n",
+                sizes[LargeBitmapFixture::V1] / ( 1024.0 * 1024.0 ), sizes[LargeBitmapFixture::V2] / ( 1024.0 * 1024.0 ), sizes[LargeBitmapFixture::V2Compressed] / ( 1024.0 * 1024.0 ),
+                100.0 * (double)sizes[LargeBitmapFixture::V2Compressed] / (double)vaMath::Max( (int64)1, sizes[LargeBitmapFixture::V1] ), overviewTimes[0], overviewTimes[1] );
+
+            data.Destroy( );
+        };
+        tests.push_back( tc );
+    }
+
+    static void AddLargeBitmapCases( std::vector<BenchmarkCase> & cases )
+    {
+        struct Data
+        {
+            LargeBitmapFixture                  Fixture;
+            shared_ptr<vaLargeBitmapFile>       File;
+            std::vector<uint8>                  Scratch;
+            std::vector<uint8>                  Overview;
+        };
+        auto data = std::make_shared<Data>( );
+
+        BenchmarkCase bc;
+        bc.Teardown = [data]( ) { data->File = nullptr; data->Fixture.Destroy( ); data->Scratch.clear( ); data->Overview.clear( ); };
+
+        bc.Name     = "large_bitmap_overview_v1";
+        bc.Info     = "1/8 overview of a 1500x1100 RGBA v1 vaLargeBitmapFile: level 0 read (memory mapped) + 3 CPU box filter passes";
+        bc.Setup    = [data]( ) { data->Fixture.Create( ); data->File = vaLargeBitmapFile::Open( data->Fixture.Paths[LargeBitmapFixture::V1], true ); data->File->SetPrefetchEnabled( false ); };
+        bc.Run      = [data]( )
+        {
+            LargeBitmapFixture::ReadOverviewFromLevel0( *data->File, data->Scratch, data->Overview );
+            Sink( (uint64)data->Overview[0] );
+        };
+        cases.push_back( bc );
+
+        bc.Name     = "large_bitmap_overview_v2";
+        bc.Info     = "1/8 overview of a 1500x1100 RGBA compressed v2 vaLargeBitmapFile: mip level 3 read (blocks in the block cache)";
+        bc.Setup    = [data]( ) { data->Fixture.Create( ); data->File = vaLargeBitmapFile::Open( data->Fixture.Paths[LargeBitmapFixture::V2Compressed], true ); data->File->SetPrefetchEnabled( false ); };
+        bc.Run      = [data]( )
+        {
+            const int level = LargeBitmapFixture::c_overviewLevel;
+            const int width = data->Fixture.LevelSizes[level].first, height = data->Fixture.LevelSizes[level].second;
+            data->Overview.resize( (size_t)width * height * 4 );
+            data->File->ReadRect( data->Overview.data( ), width * 4, (int64)data->Overview.size( ), 0, 0, width, height, level );
+            Sink( (uint64)data->Overview[0] );
+        };
+        cases.push_back( bc );
+    }
+
+    // 4096 entries with 4KB blobs and a fake file system for the dependency checks
+    struct ShaderCacheFixture
+    {
+        wstring                             BasePath;
+        std::vector<vaShaderCacheKey>       Keys;
+        std::map<wstring, int64>            TimeStamps;
+
+        void Reset( const wchar_t * name )
+        {
+            BasePath = vaCore::GetExecutableDirectory( ) + L".cache\\" + name;
+            Keys.resize( 4096 );
+            for( int i = 0; i < (int)Keys.size( ); i++ )
+                Keys[i].StringPart = vaStringTools::Format( "1 VARIANT %d vs_5_0 main shaders\\test%d.hlsl ", i, i % 4 );
+            TimeStamps = { { L"common.hlsl", 100 }, { L"shader0.hlsl", 200 }, { L"shader1.hlsl", 300 }, { L"shader2.hlsl", 400 }, { L"shader3.hlsl", 500 } };
+        }
+        vaShaderFileDependency::TimeStampResolver Resolver( )
+        {
+            return [this]( const wstring & filePath, int64 & outTimeStamp )
+            {
+                auto it = TimeStamps.find( filePath );
+                if( it == TimeStamps.end( ) )
+                    return false;
+                outTimeStamp = it->second;
+                return true;
+            };
+        }
+        std::vector<vaShaderFileDependency> Dependencies( int index )
+        {
+            wstring shaderFile = vaStringTools::Format( L"shader%d.hlsl", index % 4 );
+            return { vaShaderFileDependency( L"common.hlsl", TimeStamps[L"common.hlsl"] ), vaShaderFileDependency( shaderFile, TimeStamps[shaderFile] ) };
+        }
+        std::vector<uint8> Blob( int index )
+        {
+            std::vector<uint8> blob( 4096 );
+            for( size_t j = 0; j < blob.size( ); j++ )
+                blob[j] = (uint8)( index * 31 + (int)j );
+            return blob;
+        }
+        // creates (or recreates) the cache files with all the entries
+        bool Create( )
+        {
+            vaShaderCacheStore store;
+            if( !store.Open( BasePath ) )
+                return false;
+            store.Clear( );
+            for( int i = 0; i < (int)Keys.size( ); i++ )
+            {
+                std::vector<uint8> blob = Blob( i );
+                store.Add( Keys[i], Dependencies( i ), blob.data( ), (int64)blob.size( ) );
+            }
+            store.Close( );
+            return true;
+        }
+    };
+
+    static void AddShaderCacheTests( std::vector<TestCase> & tests )
+    {
+        TestCase tc;
+        tc.Name = "shader_cache";
+        tc.Run  = [ ]( )
+        {
+            ShaderCacheFixture data;
+            data.Reset( L"test_shader_cache" );
+            Check( data.Create( ), "shader cache open" );
+
+            vaShaderCacheStore store;
+            bool modified = false;
+            Check( store.Open( data.BasePath ), "shader cache reopen" );
+            Check( store.GetStatistics( ).EntryCount == 4096 && store.GetStatistics( ).LoadedEntryCount == 0, "shader cache entries are loaded lazily" );
+            auto entry = store.Find( data.Keys[7], data.Resolver( ), modified );
+            Check( entry != nullptr && !modified && entry->Blob == data.Blob( 7 ) && entry->Dependencies.size( ) == 2, "shader cache find" );
+            Check( store.GetStatistics( ).LoadedEntryCount == 1, "shader cache loads only what was looked up" );
+
+            // touching a dependency invalidates (and removes) the entry; re-adding it works
+            data.TimeStamps[L"shader1.hlsl"]++;
+            Check( store.Find( data.Keys[5], data.Resolver( ), modified ) == nullptr && modified, "shader cache modified dependency" );
+            Check( store.Find( data.Keys[5], data.Resolver( ), modified ) == nullptr && !modified, "shader cache modified entry removed" );
+            std::vector<uint8> blob = data.Blob( 5 );
+            store.Add( data.Keys[5], data.Dependencies( 5 ), blob.data( ), (int64)blob.size( ) );
+            store.Close( );
+            Check( store.Open( data.BasePath ), "shader cache reopen" );
+            entry = store.Find( data.Keys[5], data.Resolver( ), modified );
+            Check( entry != nullptr && entry->Blob == blob && store.GetStatistics( ).EntryCount == 4096, "shader cache re-added entry persists" );
+
+            // invalidate 3/4 of the entries, compact and make sure the rest survives
+            data.TimeStamps[L"shader1.hlsl"]++; data.TimeStamps[L"shader2.hlsl"]++; data.TimeStamps[L"shader3.hlsl"]++;
+            for( int i = 0; i < (int)data.Keys.size( ); i++ )
+                store.Find( data.Keys[i], data.Resolver( ), modified );
+            Check( store.GetStatistics( ).EntryCount == 1024 && store.NeedsCompaction( ), "shader cache dead space tracking" );
+            Check( store.Compact( ), "shader cache compaction" );
+            Check( store.GetStatistics( ).BlobFileSize == store.GetStatistics( ).LiveBytes, "shader cache compaction removes dead space" );
+            store.Close( );
+            Check( store.Open( data.BasePath ), "shader cache reopen" );
+            entry = store.Find( data.Keys[4], data.Resolver( ), modified );
+            Check( entry != nullptr && entry->Blob == data.Blob( 4 ) && store.GetStatistics( ).EntryCount == 1024, "shader cache entries survive compaction" );
+            Check( store.Find( data.Keys[6], data.Resolver( ), modified ) == nullptr, "shader cache invalidated entries gone after compaction" );
+            store.Clear( );
+        };
+        tests.push_back( tc );
+    }
+
+    static void AddShaderCacheCases( std::vector<BenchmarkCase> & cases )
+    {
+        auto data = std::make_shared<ShaderCacheFixture>( );
+        auto setup = [data]( )
+        {
+            data->Reset( L"benchmark_shader_cache" );
+            if( !data->Create( ) )
+                VA_LOG_ERROR( L"Unable to create '%s'", data->BasePath.c_str( ) );
+        };
+
+        BenchmarkCase bc;
+        bc.Setup    = setup;
+
+        bc.Name     = "shader_cache_open";
+        bc.Info     = "vaShaderCacheStore::Open + Close, 4096 entries (should not depend on the entry count)";
+        bc.Run      = [data]( )
+        {
+            vaShaderCacheStore store;
+            store.Open( data->BasePath );
+            Sink( (uint64)store.GetStatistics( ).EntryCount );
+        };
+        cases.push_back( bc );
+
+        bc.Name     = "shader_cache_lookup_cold";
+        bc.Info     = "vaShaderCacheStore::Open + 256 lazily loaded Find-s, 4096 entries";
+        bc.Run      = [data]( )
+        {
+            vaShaderCacheStore store;
+            store.Open( data->BasePath );
+            auto resolver = data->Resolver( );
+            bool modified;
+            for( int i = 0; i < (int)data->Keys.size( ); i += 16 )
+            {
+                auto entry = store.Find( data->Keys[i], resolver, modified );
+                Sink( (uint64)( ( entry != nullptr ) ? ( entry->Blob[0] ) : ( 0 ) ) );
+            }
+        };
+        cases.push_back( bc );
+    }
+
+    // stand-in for vaGraphicsPSODescDX12 with a similar amount of state
+    struct BenchmarkPSODesc
+    {
+        int64                               ShaderIDs[5]        = { -1, -1, -1, -1, -1 };
+        int32                               States[6]           = { };      // blend, fill, cull, depth func, topology, render target count
+        int32                               RTVFormats[8]       = { };
+        int32                               DSVFormat           = 0;
+        uint32                              SampleCount         = 1;
+        uint64                              Hash                = 0;
+
+        void                                UpdateHash( )
+        {
+            Hash = vaXXHash64::Compute( this, offsetof( BenchmarkPSODesc, Hash ), 0 );
+            if( Hash == 0 )
+                Hash = 1;
+        }
+        bool                                KeyEquals( const BenchmarkPSODesc & other ) const { return Hash == other.Hash && memcmp( this, &other, offsetof( BenchmarkPSODesc, Hash ) ) == 0; }
+    };
+
+    struct BenchmarkPSO
+    {
+        int                                 StateIndex          = -1;
+    };
+
+    typedef vaPipelineStateCache<BenchmarkPSODesc, BenchmarkPSO>  BenchmarkPSOCache;
+
+    static void AddBackgroundTaskTests( std::vector<TestCase> & tests )
+    {
+        typedef vaBackgroundTaskManager::SpawnFlags     SpawnFlags;
+        typedef vaBackgroundTaskManager::TaskContext    TaskContext;
+        static const int c_taskCount = 64;
+
+        // priority ordering & inline running of waiting tasks; all pool threads get blocked first so that the waiting list is deterministic
+        TestCase tc;
+        tc.Name = "background_tasks";
+        tc.Run  = [ ]( )
+        {
+            vaBackgroundTaskManager & manager = vaBackgroundTaskManager::GetInstance( );
+
+            // spawn blockers until one of them has to wait - that one gets the lowest priority so it's started last
+            vector<shared_ptr<vaBackgroundTaskManager::Task>>   blockers;
+            vector<shared_ptr<std::atomic_bool>>                releases;
+            while( manager.GetWaitingPooledTaskCount( ) == 0 )
+            {
+                auto release = std::make_shared<std::atomic_bool>( false );
+                releases.push_back( release );
+                blockers.push_back( manager.Spawn( "blocker", SpawnFlags::UseThreadPool, [release]( TaskContext & ) { while( !*release ) std::this_thread::sleep_for( std::chrono::microseconds( 100 ) ); return true; }, -1.0f ) );
+            }
+
+            std::thread::id ranOn;
+            auto inlineTask = manager.Spawn( "inline", SpawnFlags::UseThreadPool, [&ranOn]( TaskContext & ) { ranOn = std::this_thread::get_id( ); return true; } );
+            manager.WaitUntilFinished( inlineTask );
+            Check( ranOn == std::this_thread::get_id( ), "waiting pooled task runs on the thread that waits for it" );
+
+            // scrambled priorities (37 and 64 are coprime); the one pool thread released below has to run them from the highest down
+            std::atomic_int startCounter = 0;
+            std::array<int, c_taskCount> startOrder;
+            vector<shared_ptr<vaBackgroundTaskManager::Task>> tasks;
+            for( int i = 0; i < c_taskCount; i++ )
+            {
+                int priority = ( i * 37 ) % c_taskCount;
+                tasks.push_back( manager.Spawn( "prioritized", SpawnFlags::UseThreadPool, [&startCounter, &startOrder, priority]( TaskContext & ) { startOrder[priority] = startCounter++; return true; }, (float)priority ) );
+            }
+            manager.RaisePriority( tasks[0], (float)c_taskCount );     // priority 0 -> highest
+            manager.RaisePriority( tasks[1], 0.0f );                   // never lowers
+
+            // (polling instead of WaitUntilFinished which would run the still waiting ones right here)
+            *releases.front( )  = true;
+            *releases.back( )   = true;
+            while( startCounter < c_taskCount )
+                std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+            for( auto & task : tasks )
+                manager.WaitUntilFinished( task );
+            bool ordered = startOrder[0] == 0;
+            for( int priority = 1; priority < c_taskCount; priority++ )
+                ordered &= startOrder[priority] == c_taskCount - priority;
+            Check( ordered, "waiting pooled tasks start in priority order" );
+
+            for( auto & release : releases )
+                *release = true;
+            for( auto & blocker : blockers )
+                manager.WaitUntilFinished( blocker );
+        };
+        tests.push_back( tc );
+    }
+
+    static void AddBackgroundTaskCases( std::vector<BenchmarkCase> & cases )
+    {
+        typedef vaBackgroundTaskManager::SpawnFlags     SpawnFlags;
+        typedef vaBackgroundTaskManager::TaskContext    TaskContext;
+        static const int c_taskCount = 64;
+
+        BenchmarkCase bc;
+        bc.Name     = "background_tasks_prioritized";
+        bc.Info     = "64 empty thread pool tasks with scrambled priorities, spawn + wait for all";
+        bc.Teardown = [ ]( ) { vaBackgroundTaskManager::GetInstance( ).ClearAndRestart( ); };
+        bc.Run      = [ ]( ) 
+        {
+            vaBackgroundTaskManager & manager = vaBackgroundTaskManager::GetInstance( );
+            shared_ptr<vaBackgroundTaskManager::Task> tasks[c_taskCount];
+            for( int i = 0; i < c_taskCount; i++ )
+                tasks[i] = manager.Spawn( "empty", SpawnFlags::UseThreadPool, [ ]( TaskContext & ) { return true; }, (float)( ( i * 37 ) % c_taskCount ) );
+            for( int i = 0; i < c_taskCount; i++ )
+                manager.WaitUntilFinished( tasks[i] );
+        };
+        cases.push_back( bc );
+    }
+
+    static const int c_benchmarkPSOStateCount  = 1024;
+    static const int c_benchmarkPSODrawCount   = 65536;
+
+    static shared_ptr<BenchmarkPSO> CreateBenchmarkPSO( const BenchmarkPSODesc & desc ) { auto pso = std::make_shared<BenchmarkPSO>( ); pso->StateIndex = (int)desc.ShaderIDs[0]; return pso; }
+
+    // 1024 states (shader ID 0 doubles as the state index), draws come in short runs of the same state and most of
+    // them use a small 'hot' subset, like a sorted opaque pass with some variety
+    struct PSOCacheFixture
+    {
+        std::vector<BenchmarkPSODesc>   States;
+        std::vector<int>                DrawStream;         // indices into States, one per draw
+
+        void Create( )
+        {
+            if( !States.empty( ) )
+                return;
+            vaRandom rnd( 7 );
+            States.resize( c_benchmarkPSOStateCount );
+            for( int i = 0; i < c_benchmarkPSOStateCount; i++ )
+            {
+                BenchmarkPSODesc & desc = States[i];
+                desc.ShaderIDs[0]   = i;
+                desc.ShaderIDs[1]   = 1000 + i / 4;
+                for( int j = 0; j < _countof( desc.States ); j++ )
+                    desc.States[j]  = (int32)( rnd.NextUINT32( ) % 4 );
+                desc.RTVFormats[0]  = 28;
+                desc.DSVFormat      = 40;
+            }
+            while( (int)DrawStream.size( ) < c_benchmarkPSODrawCount )
+            {
+                int state   = ( rnd.NextUINT32( ) % 8 != 0 ) ? ( rnd.NextUINT32( ) % 48 ) : ( rnd.NextUINT32( ) % c_benchmarkPSOStateCount );
+                int runSize = 1 + rnd.NextUINT32( ) % 8;
+                for( int i = 0; i < runSize && (int)DrawStream.size( ) < c_benchmarkPSODrawCount; i++ )
+                    DrawStream.push_back( state );
+            }
+        }
+    };
+
+    static void AddPipelineStateCacheTests( std::vector<TestCase> & tests )
+    {
+        TestCase tc;
+        tc.Name = "pso_cache";
+        tc.Run  = [ ]( )
+        {
+            PSOCacheFixture data;
+            data.Create( );
+
+            BenchmarkPSOCache cache;
+            BenchmarkPSOCache::FrontCache<> frontCache;
+            bool allMatch = true;
+            for( int index : data.DrawStream )
+            {
+                BenchmarkPSODesc desc = data.States[index];
+                desc.UpdateHash( );
+                BenchmarkPSO * pso = frontCache.FindOrCreate( cache, desc, CreateBenchmarkPSO );
+                allMatch &= pso != nullptr && pso->StateIndex == index && cache.Find( desc ) == pso;
+            }
+            Check( allMatch, "pso cache front cache and shared table agree" );
+            Check( cache.GetStatistics( ).Rebuilds > 0 && (int64)cache.GetCount( ) == cache.GetStatistics( ).Creations, "pso cache grows and creates each state once" );
+            Check( frontCache.GetHitCount( ) > frontCache.GetMissCount( ), "pso cache front cache hit rate" );
+
+            // same hash, different key - has to end up as two entries
+            BenchmarkPSODesc a = data.States[0], b = data.States[1];
+            a.Hash = b.Hash = 0x1234;
+            BenchmarkPSO * psoA = cache.FindOrCreate( a, CreateBenchmarkPSO );
+            BenchmarkPSO * psoB = frontCache.FindOrCreate( cache, b, CreateBenchmarkPSO );
+            Check( psoA != psoB && psoA->StateIndex == 0 && psoB->StateIndex == 1 && frontCache.FindOrCreate( cache, a, CreateBenchmarkPSO ) == psoA, "pso cache hash collisions" );
+
+            // remove every other state; front cache must not hand out removed entries
+            int removed = cache.IncrementalCleanup( c_benchmarkPSOStateCount * 2, []( shared_ptr<BenchmarkPSO> & pso ) { if( pso->StateIndex % 2 == 0 ) { pso = nullptr; return true; } return false; } );
+            BenchmarkPSODesc desc = data.States[data.DrawStream[0]];
+            desc.UpdateHash( );
+            BenchmarkPSO * pso = frontCache.FindOrCreate( cache, desc, CreateBenchmarkPSO );
+            Check( removed > 0 && cache.Find( desc ) == pso && pso->StateIndex == data.DrawStream[0], "pso cache removal invalidates front caches" );
+            int released = 0;
+            cache.Clear( [&released]( shared_ptr<BenchmarkPSO> & pso ) { pso = nullptr; released++; } );
+            Check( cache.GetCount( ) == 0 && released > 0, "pso cache clear" );
+
+            // 4 threads racing to create the same states: each must be created exactly once and everyone gets the same one
+            std::atomic<int> creations( 0 );
+            auto countingCreate = [&creations]( const BenchmarkPSODesc & desc ) { creations++; return CreateBenchmarkPSO( desc ); };
+            std::atomic<bool> mismatch( false );
+            std::vector<std::thread> threads;
+            for( int t = 0; t < 4; t++ )
+                threads.push_back( std::thread( [&, t]( )
+                {
+                    BenchmarkPSOCache::FrontCache<> threadFrontCache;
+                    for( int i = 0; i < c_benchmarkPSOStateCount; i++ )
+                    {
+                        BenchmarkPSODesc desc = data.States[ ( i * ( t + 1 ) ) % c_benchmarkPSOStateCount ];
+                        desc.UpdateHash( );
+                        if( threadFrontCache.FindOrCreate( cache, desc, countingCreate )->StateIndex != (int)desc.ShaderIDs[0] )
+                            mismatch = true;
+                    }
+                } ) );
+            for( std::thread & thread : threads )
+                thread.join( );
+            Check( !mismatch && creations == c_benchmarkPSOStateCount && (int)cache.GetCount( ) == c_benchmarkPSOStateCount, "pso cache concurrent creation" );
+            cache.Clear( []( shared_ptr<BenchmarkPSO> & pso ) { pso = nullptr; } );
+        };
+        tests.push_back( tc );
+    }
+
+    static void AddPipelineStateCacheCases( std::vector<BenchmarkCase> & cases )
+    {
+        struct Data : PSOCacheFixture
+        {
+            shared_ptr<BenchmarkPSOCache>   Cache;
+            BenchmarkPSOCache::FrontCache<> FrontCache;
+
+            // what the device used to do: serialized key in a std::map under a global mutex
+            typedef std::array<uint8, offsetof( BenchmarkPSODesc, Hash )> MapKey;
+            std::map<MapKey, shared_ptr<BenchmarkPSO>> Map;
+            std::mutex                      MapMutex;
+        };
+        auto data = std::make_shared<Data>( );
+
+        auto createPSO = CreateBenchmarkPSO;
+
+        // every run is 'a frame' of draws against an already warm cache: build the desc, hash it, look it up
+        BenchmarkCase bc;
+        bc.Setup    = [data]( ) { data->Create( ); data->Cache = std::make_shared<BenchmarkPSOCache>( ); data->FrontCache.Reset( ); };
+        bc.Teardown = [data]( ) { data->Cache = nullptr; data->Map.clear( ); };
+
+        bc.Name     = "pso_cache_map_mutex";
+        bc.Info     = "65536 draws, 1024 states: serialized key, std::map lookup under a mutex (previous DX12 device scheme)";
+        bc.Run      = [data, createPSO]( )
+        {
+            uint64 sum = 0;
+            for( int index : data->DrawStream )
+            {
+                BenchmarkPSODesc desc = data->States[index];
+                Data::MapKey key;
+                memcpy( key.data( ), &desc, key.size( ) );
+                std::unique_lock<std::mutex> lock( data->MapMutex );
+                auto it = data->Map.find( key );
+                if( it == data->Map.end( ) )
+                    it = data->Map.insert( std::make_pair( key, createPSO( desc ) ) ).first;
+                sum += it->second->StateIndex;
+            }
+            Sink( sum );
+        };
+        cases.push_back( bc );
+
+        bc.Name     = "pso_cache_shared_table";
+        bc.Info     = "65536 draws, 1024 states: UpdateHash + lock-free vaPipelineStateCache lookup";
+        bc.Run      = [data, createPSO]( )
+        {
+            uint64 sum = 0;
+            for( int index : data->DrawStream )
+            {
+                BenchmarkPSODesc desc = data->States[index];
+                desc.UpdateHash( );
+                sum += data->Cache->FindOrCreate( desc, createPSO )->StateIndex;
+            }
+            Sink( sum );
+        };
+        cases.push_back( bc );
+
+        bc.Name     = "pso_cache_front_cache";
+        bc.Info     = "65536 draws, 1024 states: UpdateHash + 64 slot per-context front cache over vaPipelineStateCache";
+        bc.Run      = [data, createPSO]( )
+        {
+            uint64 sum = 0;
+            for( int index : data->DrawStream )
+            {
+                BenchmarkPSODesc desc = data->States[index];
+                desc.UpdateHash( );
+                sum += data->FrontCache.FindOrCreate( *data->Cache, desc, createPSO )->StateIndex;
+            }
+            Sink( sum );
+        };
+        cases.push_back( bc );
+    }
+
+    // vaLightClusters: spot/point lights culled into view frustum clusters
+    static const int c_benchmarkLightCount = ShaderLightSpot::MaxLights - 1;
+
+    // half spot, half point lights scattered around a 60x60m area in front of the camera
+    static void MakeBenchmarkLights( std::vector<ShaderLightSpot> & lights, int count, float minRange, float maxRange )
+    {
+        vaRandom rnd( 2 );
+        lights.resize( count );
+        for( int i = 0; i < count; i++ )
+        {
+            ShaderLightSpot & light = lights[i];
+            memset( &light, 0, sizeof( light ) );
+            light.Color             = vaVector3( 1.0f, 1.0f, 1.0f );
+            light.Intensity         = 1.0f;
+            light.Position          = vaVector3( rnd.NextFloatRange( -30.0f, 30.0f ), rnd.NextFloatRange( -30.0f, 30.0f ), rnd.NextFloatRange( 0.0f, 5.0f ) );
+            light.Range             = rnd.NextFloatRange( minRange, maxRange );
+            light.Size              = 0.1f;
+            light.CubeShadowIndex   = -1.0f;
+            if( ( i % 2 ) == 0 )
+            {
+                light.Direction         = vaVector3( rnd.NextFloatRange( -1.0f, 1.0f ), rnd.NextFloatRange( -1.0f, 1.0f ), rnd.NextFloatRange( -1.0f, 0.0f ) ).Normalized( );
+                light.SpotInnerAngle    = 0.2f;
+                light.SpotOuterAngle    = rnd.NextFloatRange( 0.3f, 1.2f );
+            }
+            else
+            {
+                // same dummy angles vaLighting uses for point lights
+                light.SpotInnerAngle    = VA_PIf + VA_EPSf;
+                light.SpotOuterAngle    = VA_PIf + 2 * VA_EPSf;
+            }
+        }
+    }
+
+    static void SetupLightClusterCamera( vaCameraBase & camera )
+    {
+        camera.SetYFOV( 65.0f / 180.0f * VA_PIf );
+        camera.SetPosition( vaVector3( -20.0f, -20.0f, 10.0f ) );
+        camera.SetOrientationLookAt( vaVector3( 0.0f, 0.0f, 0.0f ) );
+        camera.SetViewportSize( 1920, 1080 );
+        camera.Tick( 0.0f, false );
+    }
+
+    static void AddLightClusterTests( std::vector<TestCase> & tests )
+    {
+        TestCase tc;
+        tc.Name = "light_clusters";
+        tc.Run  = [ ]( )
+        {
+            vaCameraBase camera;
+            SetupLightClusterCamera( camera );
+
+            // every light that reaches a point (within range and, for spots, within the outer cone) must be in
+            // the list of the point's cluster; positions are relative to worldBase just like in LightingShaderConstants
+            const vaVector3 worldBase( 1.0f, 2.0f, 3.0f );
+            vaLightClusters clusters;
+            std::vector<ShaderLightSpot> lights;
+            MakeBenchmarkLights( lights, c_benchmarkLightCount, 2.0f, 8.0f );
+            std::vector<ShaderLightSpot> relativeLights = lights;
+            for( ShaderLightSpot & light : relativeLights )
+                light.Position -= worldBase;
+            Check( clusters.Build( camera, worldBase, relativeLights.data( ), (int)relativeLights.size( ) ), "light clusters build reports changes" );
+            Check( clusters.GetStats( ).OverflowedClusters == 0 && clusters.GetStats( ).TotalIndices > 0, "light clusters fit the index budget" );
+            Check( !clusters.Build( camera, worldBase, relativeLights.data( ), (int)relativeLights.size( ) ), "unchanged light clusters build is skipped" );
+            const uint32 usedSize = clusters.GetConstantsUsedSize( );
+            Check( usedSize < sizeof( LightClustersShaderConstants ) && usedSize % 16 == 0
+                && usedSize >= offsetof( LightClustersShaderConstants, LightIndices ) + (uint32)clusters.GetStats( ).TotalIndices, "light clusters used constants size" );
+
+            vaRandom rnd( 3 );
+            std::vector<int> clusterLights;
+            bool allFound = true;
+            int64 listedTotal = 0, samples = 0;
+            const float tanHalfY = std::tan( camera.GetYFOV( ) * 0.5f ), tanHalfX = tanHalfY * camera.GetAspect( );
+            for( int i = 0; i < 20000; i++ )
+            {
+                float depth = rnd.NextFloatRange( 0.5f, 50.0f );
+                vaVector3 viewPos( rnd.NextFloatRange( -1.0f, 1.0f ) * tanHalfX * depth, rnd.NextFloatRange( -1.0f, 1.0f ) * tanHalfY * depth, depth );
+                vaVector3 worldPos = vaVector3::TransformCoord( viewPos, camera.GetInvViewMatrix( ) );
+                if( !clusters.FindClusterLights( worldPos, clusterLights ) )
+                {
+                    allFound = false;
+                    break;
+                }
+                for( int li = 0; li < (int)lights.size( ); li++ )
+                {
+                    const ShaderLightSpot & light = lights[li];
+                    vaVector3 toPos = worldPos - light.Position;
+                    float distance = toPos.Length( );
+                    bool reaches = distance < light.Range;
+                    if( reaches && light.SpotOuterAngle < VA_PIf * 0.5f )
+                        reaches = std::acos( vaMath::Clamp( vaVector3::Dot( light.Direction, toPos / distance ), -1.0f, 1.0f ) ) < light.SpotOuterAngle;
+                    if( ( reaches || distance < light.Size ) && std::find( clusterLights.begin( ), clusterLights.end( ), li ) == clusterLights.end( ) )
+                        allFound = false;
+                }
+                listedTotal += (int64)clusterLights.size( );
+                samples++;
+            }
+            Check( allFound, "light clusters contain all lights reaching their points" );
+            Check( samples > 0 && listedTotal < samples * (int64)lights.size( ) / 8, "light clusters cull most lights" );
+
+            // lights covering everything can't fit into the index list; those clusters must fall back to all lights
+            MakeBenchmarkLights( lights, c_benchmarkLightCount, 100.0f, 100.0f );
+            clusters.Build( camera, vaVector3( 0.0f, 0.0f, 0.0f ), lights.data( ), (int)lights.size( ) );
+            Check( clusters.GetStats( ).OverflowedClusters > 0 && clusters.GetStats( ).TotalIndices <= LIGHTCLUSTERS_MAX_INDICES, "light clusters overflow" );
+            Check( !clusters.FindClusterLights( camera.GetPosition( ) + camera.GetDirection( ) * 90.0f, clusterLights ), "overflowed light clusters use all lights" );
+
+            Check( clusters.BuildUnculled( ) && !clusters.BuildUnculled( ), "unculled light clusters build reports changes once" );
+            Check( !clusters.FindClusterLights( camera.GetPosition( ) + camera.GetDirection( ) * 10.0f, clusterLights ), "unculled light clusters use all lights" );
+            Check( clusters.GetConstantsUsedSize( ) == offsetof( LightClustersShaderConstants, LightIndices ), "unculled light clusters upload no indices" );
+        };
+        tests.push_back( tc );
+    }
+
+    static void AddLightClusterCases( std::vector<BenchmarkCase> & cases )
+    {
+        struct Data
+        {
+            shared_ptr<vaLightClusters>     Clusters;
+            vaCameraBase                    Camera;
+            std::vector<ShaderLightSpot>    Lights;
+            int64                           Iteration   = 0;
+        };
+        auto data = std::make_shared<Data>( );
+
+        BenchmarkCase bc;
+        bc.Name     = "light_clusters_build";
+        bc.Info     = "vaLightClusters: 255 spot/point lights (2-8m range) culled into 16x8x16 clusters, one light changing every build";
+        bc.Setup    = [data]( )
+        {
+            SetupLightClusterCamera( data->Camera );
+            data->Clusters = std::make_shared<vaLightClusters>( );
+            MakeBenchmarkLights( data->Lights, c_benchmarkLightCount, 2.0f, 8.0f );
+            data->Iteration = 0;
+        };
+        bc.Teardown = [data]( ) { data->Clusters = nullptr; data->Lights.clear( ); };
+        bc.Run      = [data]( )
+        {
+            // move one light so that the build doesn't get skipped as unchanged
+            data->Iteration++;
+            data->Lights[0].Position.z = (float)( data->Iteration & 1 );
+            data->Clusters->Build( data->Camera, vaVector3( 0.0f, 0.0f, 0.0f ), data->Lights.data( ), (int)data->Lights.size( ) );
+            Sink( (uint64)data->Clusters->GetStats( ).TotalIndices );
+        };
+        cases.push_back( bc );
+    }
+
+    // 32x32 cubes and 4 materials on the null render device, with a depth pre-pass + forward frame
+    struct NullDeviceFixture
+    {
+        static const int                        c_gridSize = 32;
+
+        shared_ptr<vaRenderDeviceNull>          Device;
+        shared_ptr<vaTexture>                   Depth;
+        shared_ptr<vaCameraBase>                Camera;
+        shared_ptr<vaScene>                     Scene;
+        std::vector<shared_ptr<vaRenderMesh>>   Meshes;
+        std::vector<shared_ptr<vaRenderMaterial>> Materials;
+        vaRenderMaterialManager::ShaderPermutationStats PermutationStatsBeforeMaterials;
+
+        vaDrawResultFlags Frame( float deltaTime )
+        {
+            vaRenderDeviceNull & device = *Device;
+            vaCameraBase & camera = *Camera;
+            vaDrawResultFlags drawResults = vaDrawResultFlags::None;
+
+            device.BeginFrame( deltaTime );
+            vaRenderDeviceContext & renderContext = *device.GetMainContext( );
+            camera.Tick( deltaTime, false );
+
+            vaRenderSelection selection;
+            drawResults |= Scene->SelectForRendering( &selection, nullptr, vaRenderSelection::FilterSettings::FrustumCull( camera ) );
+            auto sortSettings = vaRenderSelection::SortSettings::Standard( camera, true, false );
+
+            Depth->ClearDSV( renderContext, true, camera.GetUseReversedZ( ) ? ( 0.0f ) : ( 1.0f ), false, 0 );
+            renderContext.SetRenderTarget( nullptr, Depth, true );
+            {
+                vaSceneDrawContext drawContext( renderContext, camera, vaDrawContextOutputType::DepthOnly );
+                drawResults |= device.GetMeshManager( ).Draw( drawContext, *selection.MeshList, vaBlendMode::Opaque, vaRenderMeshDrawFlags::EnableDepthTest | vaRenderMeshDrawFlags::EnableDepthWrite | vaRenderMeshDrawFlags::DisableVRS, sortSettings );
+            }
+
+            device.GetCurrentBackbuffer( )->ClearRTV( renderContext, vaVector4( 0.0f, 0.0f, 0.0f, 0.0f ) );
+            renderContext.SetRenderTarget( device.GetCurrentBackbuffer( ), Depth, true );
+            {
+                vaSceneDrawContext drawContext( renderContext, camera, vaDrawContextOutputType::Forward );
+                drawResults |= device.GetMeshManager( ).Draw( drawContext, *selection.MeshList, vaBlendMode::Opaque, vaRenderMeshDrawFlags::EnableDepthTest | vaRenderMeshDrawFlags::DepthTestIncludesEqual, sortSettings );
+            }
+
+            device.EndAndPresentFrame( );
+            return drawResults;
+        }
+
+        // either one mesh per cube so that each one is a separate draw, or one mesh per material so that the cubes
+        // get merged into instanced draws
+        void Create( bool sharedMeshes )
+        {
+            Device = std::make_shared<vaRenderDeviceNull>( 1920, 1080 );
+            vaRenderDeviceNull & device = *Device;
+            Depth = vaTexture::Create2D( device, vaResourceFormat::D32_FLOAT, 1920, 1080, 1, 1, 1, vaResourceBindSupportFlags::DepthStencil );
+
+            Camera = std::make_shared<vaCameraBase>( );
+            Camera->SetYFOV( 65.0f / 180.0f * VA_PIf );
+            Camera->SetPosition( vaVector3( -40.0f, -40.0f, 25.0f ) );
+            Camera->SetOrientationLookAt( vaVector3( 0.0f, 0.0f, 0.0f ) );
+            Camera->SetViewportSize( 1920, 1080 );
+
+            PermutationStatsBeforeMaterials = device.GetMaterialManager( ).GetShaderPermutationStats( );
+            for( int i = 0; i < 4; i++ )
+            {
+                Materials.push_back( device.GetMaterialManager( ).CreateRenderMaterial( ) );
+                Materials.back( )->SetupFromPreset( "FilamentStandard" );
+            }
+
+            if( sharedMeshes )
+            {
+                for( auto & material : Materials )
+                {
+                    Meshes.push_back( vaRenderMesh::CreateCube( device, vaMatrix4x4::Identity, false, 0.4f ) );
+                    Meshes.back( )->SetMaterial( material );
+                }
+            }
+            Scene = std::make_shared<vaScene>( "NullDeviceBenchmark" );
+            for( int y = 0; y < c_gridSize; y++ )
+                for( int x = 0; x < c_gridSize; x++ )
+                {
+                    shared_ptr<vaRenderMesh> mesh;
+                    if( sharedMeshes )
+                        mesh = Meshes[ ( x + y ) % Materials.size( ) ];
+                    else
+                    {
+                        mesh = vaRenderMesh::CreateCube( device, vaMatrix4x4::Identity, false, 0.4f );
+                        mesh->SetMaterial( Materials[ ( x + y ) % Materials.size( ) ] );
+                        Meshes.push_back( mesh );
+                    }
+                    vaVector3 pos( ( x - c_gridSize / 2 ) * 2.0f, ( y - c_gridSize / 2 ) * 2.0f, 0.0f );
+                    auto obj = Scene->CreateObject( vaStringTools::Format( "cube_%d_%d", x, y ), vaVector3( 1.0f, 1.0f, 1.0f ), vaQuaternion::Identity, pos );
+                    obj->AddRenderMeshRef( mesh );
+                }
+            Scene->Tick( 1.0f / 60.0f );  // flush deferred object actions
+
+            // first frames create material shaders, constant buffers, etc.
+            for( int i = 0; i < 100; i++ )
+            {
+                if( Frame( 0.0f ) == vaDrawResultFlags::None && vaShader::GetNumberOfCompilingShaders( ) == 0 )
+                    break;
+            }
+        }
+
+        void Destroy( )
+        {
+            Scene->Clear( );
+            Scene = nullptr;
+            Meshes.clear( );
+            Materials.clear( );
+            Depth = nullptr;
+            Camera = nullptr;
+            Device->SetDisabled( );
+            Device = nullptr;
+        }
+    };
+
+    static void AddNullDeviceTests( std::vector<TestCase> & tests )
+    {
+        TestCase tc;
+        tc.Name = "null_device_recording";
+        tc.Run  = [ ]( )
+        {
+            NullDeviceFixture data;
+            data.Create( false );
+
+            // two identical frames must submit identical work, recording survives a save/load round trip
+            vaRenderRecording & recording = data.Device->GetRecording( );
+            recording.SetRecordingEnabled( true );
+            recording.Reset( );
+            Check( data.Frame( 0.0f ) == vaDrawResultFlags::None, "null device frame draws everything" );
+            uint64 firstHash = recording.ComputeHash( );
+            vaRenderRecording::Counters firstCounters = recording.GetCounters( );
+            recording.Reset( );
+            data.Frame( 0.0f );
+            Check( firstCounters.Draws > 0 && firstCounters.IndexedDraws == firstCounters.Draws, "null device records draws" );
+            Check( firstCounters.InstancedDraws == 0, "no instancing across different meshes" );
+            Check( firstHash == recording.ComputeHash( ) && firstCounters.Draws == recording.GetCounters( ).Draws, "null device frames are deterministic" );
+
+            vaMemoryStream stream;
+            Check( recording.Save( stream ), "null device recording save" );
+            stream.Seek( 0 );
+            vaRenderRecording loaded;
+            Check( loaded.Load( stream ) && loaded.ComputeHash( ) == firstHash && loaded.GetCounters( ).Draws == firstCounters.Draws
+                && loaded.GetCounters( ).ConstantBufferBytes == firstCounters.ConstantBufferBytes, "null device recording load" );
+
+            data.Destroy( );
+        };
+        tests.push_back( tc );
+
+        tc.Name = "material_shader_permutations";
+        tc.Run  = [ ]( )
+        {
+            NullDeviceFixture data;
+            data.Create( false );
+
+            // all 4 materials are the same permutation so its shaders must only get created once
+            const vaRenderMaterialManager::ShaderPermutationStats & before = data.PermutationStatsBeforeMaterials;
+            const vaRenderMaterialManager::ShaderPermutationStats & after = data.Device->GetMaterialManager( ).GetShaderPermutationStats( );
+            Check( after.Misses - before.Misses <= 1 && after.Hits - before.Hits >= 3, "material shader permutations shared across materials" );
+
+            data.Destroy( );
+        };
+        tests.push_back( tc );
+
+        tc.Name = "null_device_auto_instancing";
+        tc.Run  = [ ]( )
+        {
+            NullDeviceFixture data;
+            data.Create( true );
+            vaRenderDeviceNull & device = *data.Device;
+            vaRenderRecording & recording = device.GetRecording( );
+            recording.SetRecordingEnabled( true );
+
+            // automatic instancing must draw exactly the same instances as drawing every cube separately, just with fewer draws
+            recording.Reset( );
+            data.Frame( 0.0f );
+            vaRenderRecording::Counters instancedCounters = recording.GetCounters( );
+            device.GetMeshManager( ).SetAutoInstancing( false );
+            recording.Reset( );
+            data.Frame( 0.0f );
+            vaRenderRecording::Counters separateCounters = recording.GetCounters( );
+            device.GetMeshManager( ).SetAutoInstancing( true );
+            Check( separateCounters.InstancedDraws == 0 && separateCounters.Draws == instancedCounters.Instances
+                && separateCounters.Indices == instancedCounters.Indices, "auto instancing draws the same instances" );
+            Check( instancedCounters.InstancedDraws > 0 && instancedCounters.Draws * 8 <= separateCounters.Draws, "auto instancing merges draws" );
+
+            // both runs upload per-draw ShaderInstanceConstants, the rest of the difference is the instance arrays which should
+            // only contain the used transforms
+            int64 arrayBytes = instancedCounters.ConstantBufferBytes - separateCounters.ConstantBufferBytes - ( instancedCounters.Draws - separateCounters.Draws ) * (int64)sizeof( ShaderInstanceConstants );
+            int64 arrayInstances = instancedCounters.Instances - ( instancedCounters.Draws - instancedCounters.InstancedDraws );
+            Check( arrayBytes <= arrayInstances * (int64)sizeof( ShaderInstanceTransform ), "auto instancing uploads only the used instance transforms" );
+
+            data.Destroy( );
+        };
+        tests.push_back( tc );
+    }
+
+    // full CPU side of a frame on the null render device: scene selection, depth pre-pass and forward pass draw lists
+    static void AddNullDeviceCases( std::vector<BenchmarkCase> & cases )
+    {
+        auto data = std::make_shared<NullDeviceFixture>( );
+
+        auto setup = [data]( bool recordingEnabled, bool sharedMeshes )
+        {
+            data->Create( sharedMeshes );
+            vaRenderDeviceNull & device = *data->Device;
+
+            vaRenderRecording & recording = device.GetRecording( );
+            recording.SetRecordingEnabled( recordingEnabled );
+            recording.Reset( );
+        };
+        auto teardown = [data]( ) { data->Destroy( ); };
+
+        BenchmarkCase bc;
+        bc.Teardown = teardown;
+        bc.Run      = [data]( )
+        {
+            data->Device->GetRecording( ).Reset( );
+            Sink( (uint64)data->Frame( 1.0f / 60.0f ) );
+            Sink( (uint64)data->Device->GetRecording( ).GetCounters( ).Draws );
+        };
+
+        bc.Name     = "null_device_frame";
+        bc.Info     = "1024 cubes, 4 materials: select + depth pre-pass + forward on the null device, counters only";
+        bc.Setup    = [setup]( ) { setup( false, false ); };
+        cases.push_back( bc );
+
+        bc.Name     = "null_device_frame_recorded";
+        bc.Info     = "1024 cubes, 4 materials: select + depth pre-pass + forward on the null device, full command recording";
+        bc.Setup    = [setup]( ) { setup( true, false ); };
+        cases.push_back( bc );
+
+        bc.Name     = "null_device_frame_instanced";
+        bc.Info     = "1024 cubes sharing 4 meshes/materials: same as null_device_frame but cubes get merged into instanced draws";
+        bc.Setup    = [setup]( ) { setup( false, true ); };
+        cases.push_back( bc );
+    }
+
+    // vaSimpleParticleSystem on the null device fixture: ~100k particles from one emitter (4 +/- 1s life), in steady state
+    static void AddParticleCases( std::vector<BenchmarkCase> & cases )
+    {
+        struct Data
+        {
+            NullDeviceFixture                           Fixture;
+            shared_ptr<vaSimpleParticleSystem>          Particles;
+            shared_ptr<vaSimpleParticleEmitter>         Emitter;
+        };
+        auto data = std::make_shared<Data>( );
+
+        const float c_deltaTime = 1.0f / 60.0f;
+        auto setup = [data, c_deltaTime]( )
+        {
+            data->Fixture.Create( true );
+            data->Particles = std::make_shared<vaSimpleParticleSystem>( vaRenderingModuleParams( *data->Fixture.Device ) );
+
+            // emitters use the global random generator
+            vaRandom::Singleton.Seed( 11 );
+            data->Emitter = data->Particles->CreateEmitter( L"benchmark" );
+            vaSimpleParticleEmitter::EmitterSettings & settings = data->Emitter->Settings;
+            settings.SpawnAreaBoundingBox       = vaOrientedBoundingBox( vaVector3( 0.0f, 0.0f, 2.5f ), vaVector3( 20.0f, 20.0f, 2.5f ), vaMatrix3x3::Identity );
+            settings.SpawnFrequencyPerSecond    = 25000.0f;
+            settings.SpawnSize                  = 0.2f;
+            settings.SpawnSizeRandomAddSub      = 0.1f;
+            settings.SpawnVelocity              = vaVector3( 0.0f, 0.0f, 1.0f );
+            settings.SpawnVelocityRandomAddSub  = vaVector3( 0.5f, 0.5f, 0.5f );
+            settings.SpawnAngularVelocityRandomAddSub = 1.0f;
+            settings.SpawnAffectedByGravityK    = 0.1f;
+            settings.SpawnLife                  = 4.0f;
+            settings.SpawnLifeRandomAddSub      = 1.0f;
+
+            // fill up to the steady state particle count
+            for( int i = 0; i < (int)( 6.0f / c_deltaTime ); i++ )
+                data->Particles->Tick( c_deltaTime );
+        };
+        auto teardown = [data]( )
+        {
+            data->Emitter = nullptr;
+            data->Particles = nullptr;
+            data->Fixture.Destroy( );
+        };
+
+        BenchmarkCase bc;
+        bc.Setup    = setup;
+        bc.Teardown = teardown;
+
+        bc.Name     = "particles_tick";
+        bc.Info     = "vaSimpleParticleSystem::Tick, ~100k particles (spawn, simulate, bounds and dead particle removal)";
+        bc.Run      = [data, c_deltaTime]( )
+        {
+            data->Particles->Tick( c_deltaTime );
+            Sink( (uint64)data->Particles->GetParticles( ).size( ) );
+        };
+        cases.push_back( bc );
+
+        bc.Name     = "particles_sort";
+        bc.Info     = "vaSimpleParticleSystem::Sort back to front, ~100k particles";
+        bc.Run      = [data]( )
+        {
+            data->Particles->Sort( data->Fixture.Camera->GetPosition( ), true );
+            Sink( (uint64)data->Particles->GetSortedIndices( ).front( ) );
+        };
+        cases.push_back( bc );
+    }
+
+    static void PrintUsage( )
+    {
+        wprintf( L"Usage: Benchmarks [--test] [--list] [--filter <substring>] [--samples <n>] [--out <results.json>] [--baseline <baseline.json>] [--report <report.json>]\n" );
+    }
+}
+
+int wmain( int argc, wchar_t * argv[] )
+{
+    Settings settings;
+    wstring outFile;
+    wstring baselineFile;
+    wstring reportFile;
+    string  filter;
+    bool    listOnly = false;
+    bool    testOnly = false;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        wstring arg = argv[i];
+        bool hasValue = ( i + 1 ) < argc;
+        if( arg == L"--list" )                          listOnly = true;
+        else if( arg == L"--test" )                     testOnly = true;
+        else if( arg == L"--filter" && hasValue )       filter = vaStringTools::SimpleNarrow( argv[++i] );
+        else if( arg == L"--samples" && hasValue )      settings.Samples = vaMath::Max( 5, _wtoi( argv[++i] ) );
+        else if( arg == L"--out" && hasValue )          outFile = argv[++i];
+        else if( arg == L"--baseline" && hasValue )     baselineFile = argv[++i];
+        else if( arg == L"--report" && hasValue )       reportFile = argv[++i];
+        else { PrintUsage( ); return 2; }
+    }
+
+    int exitCode = 0;
+    {
+        vaCoreInitDeinit core;
+
+        // allocation counts are part of the results so that regressions in heap churn show up too
+        vaMemory::SetTrackingEnabled( true );
+
+        // correctness tests: always all of them, --filter doesn't apply
+        if( testOnly )
+        {
+            std::vector<TestCase> tests;
+            AddUploadRingTests( tests );
+            AddLargeBitmapTests( tests );
+            AddSphericalHarmonicsTests( tests );
+            AddShaderCacheTests( tests );
+            AddBackgroundTaskTests( tests );
+            AddPipelineStateCacheTests( tests );
+            AddNullDeviceTests( tests );
+            AddLightClusterTests( tests );
+
+            for( const auto & test : tests )
+            {
+                int failedBefore = s_failedChecks;
+                test.Run( );
+                wprintf( L"%-36hs %s\n", test.Name.c_str( ), ( s_failedChecks == failedBefore ) ? ( L"passed" ) : ( L"FAILED" ) );
+            }
+            if( s_failedChecks > 0 )
+                wprintf( L"%d check(s) failed\n", s_failedChecks );
+            return ( s_failedChecks > 0 ) ? ( 3 ) : ( 0 );
+        }
+
+        std::vector<BenchmarkCase> cases;
+        AddGeometryCases( cases );
+        AddSceneCases( cases );
+        AddUIDRegistrarCases( cases );
+        AddFrameArenaCases( cases );
+        AddUploadRingCases( cases );
+        AddImageMetricsCases( cases );
+        AddPoissonDiskCases( cases );
+        AddDataCases( cases );
+        AddMeshToolsCases( cases );
+        AddLargeBitmapCases( cases );
+        AddShaderCacheCases( cases );
+        AddBackgroundTaskCases( cases );
+        AddPipelineStateCacheCases( cases );
+        AddNullDeviceCases( cases );
+        AddParticleCases( cases );
+        AddLightClusterCases( cases );
+
+        if( listOnly )
+        {
+            for( const auto & bcase : cases )
+                wprintf( L"%-36hs %hs\n", bcase.Name.c_str( ), bcase.Info.c_str( ) );
+            return 0;
+        }
+
+        std::vector<vaBenchmarkTool::RunResults> allResults;
+        for( const auto & bcase : cases )
+        {
+            if( !filter.empty( ) && bcase.Name.find( filter ) == string::npos )
+                continue;
+
+            allResults.push_back( RunCase( bcase, settings ) );
+            const auto & stats = allResults.back( ).Metrics[0].Stats;
+            wprintf( L"%-36hs median %10.4f ms  mean %10.4f ms  p90 %10.4f ms  (warm-up %d, outliers %d)\n", bcase.Name.c_str( ), stats.Median, stats.Mean, stats.P90, allResults.back( ).WarmupSamplesDiscarded, stats.OutliersRejected );
+        }
+
+        if( outFile.empty( ) && !baselineFile.empty( ) )
+            outFile = vaCore::GetExecutableDirectory( ) + L"benchmark_results.json";
+
+        if( !outFile.empty( ) && !vaBenchmarkTool::WriteResultsJSON( outFile, allResults ) )
+        {
+            VA_LOG_ERROR( L"Unable to write benchmark results to '%s'", outFile.c_str( ) );
+            exitCode = 2;
+        }
+        else if( !baselineFile.empty( ) )
+        {
+            int regressions = vaBenchmarkTool::CompareResultsJSON( baselineFile, outFile, reportFile );
+            if( regressions < 0 )
+                exitCode = 2;
+            else if( regressions > 0 )
+            {
+                wprintf( L"%d regression(s) compared to baseline '%s'\n", regressions, baselineFile.c_str( ) );
+                exitCode = 1;
+            }
+        }
+    }
+    return exitCode;
+}
@@ -19,7 +19,14 @@
 
 #include "vaBenchmarkTool.h"
 #include "..\System\vaFileStream.h"
+#include "..\System\vaFileTools.h"
 #include "..\vaStringTools.h"
+#include "..\vaRandom.h"
+#include "..\vaLog.h"
+#include "..\vaMemory.h"
+
+// header-only and already in the include paths (comes with assimp)
+#include "rapidjson/document.h"
 
 using namespace Vanilla;
 
@@ -28,6 +35,14 @@ vaBenchmarkTool::vaBenchmarkTool( ) : m_currentRunIndex( 0 ), m_currentRunSetupD
     m_active                = false;
     m_timeFromStart         = 0.0f;
     m_currentSampleCount    = 0;
+    m_warmupDone            = true;
+    m_warmupSamplesDiscarded= 0;
+    m_warmupTime            = 0.0f;
+    m_samplesTaken          = 0;
+    m_heapTracking          = false;
+    m_heapAllocationsAtLastTick         = 0;
+    m_heapAllocationsSinceLastSample    = 0;
+    m_framesSinceLastSample = 0;
 }
 vaBenchmarkTool::~vaBenchmarkTool( )
 {
@@ -41,6 +56,7 @@ bool vaBenchmarkTool::Run(  const std::vector<RunDefinition> & benchmarks )
         return false;
 
     m_benchmarkRuns         = benchmarks;
+    m_allResults.clear();
 
     m_currentRunIndex       = -1;
 
@@ -66,8 +82,18 @@ void vaBenchmarkTool::Tick( float deltaTime )
 
     m_timeFromStart += deltaTime;
 
-    int sampleCountExpected = vaMath::Min( (int)(m_timeFromStart / m_currentRun.SamplingPeriod), m_currentRun.SamplingTotalCount );
-    while( m_currentSampleCount < sampleCountExpected )
+    if( m_heapTracking )
+    {
+        int64 totalAllocations, totalBytes, liveBytes;
+        vaMemory::GetTotals( totalAllocations, totalBytes, liveBytes );
+        m_heapAllocationsSinceLastSample   += totalAllocations - m_heapAllocationsAtLastTick;
+        m_heapAllocationsAtLastTick         = totalAllocations;
+        m_framesSinceLastSample++;
+    }
+
+    // samples are taken at SamplingPeriod intervals from the end of DelayStartTime, through the (optional) warm-up and onwards
+    int samplesTakenExpected = (int)(m_timeFromStart / m_currentRun.SamplingPeriod);
+    while( m_samplesTaken < samplesTakenExpected && ( !m_warmupDone || m_currentSampleCount < m_currentRun.SamplingTotalCount ) )
     {
         m_currentRun.CollectSamplesCallback( m_currentRun, m_sampleCache );
         assert( m_sampleCache.size() == m_currentRun.MetricNames.size() );  // not allowed to change number of metrics!
@@ -82,11 +108,25 @@ void vaBenchmarkTool::Tick( float deltaTime )
         {
             m_currentMetricsSampleLog[i].push_back( m_sampleCache[i] );
         }
+        if( m_heapTracking )
+        {
+            // if more than one sample gets taken in a frame, they all get the same value
+            if( m_framesSinceLastSample > 0 || m_heapAllocationsLog.size() == 0 )
+                m_heapAllocationsLog.push_back( (float)m_heapAllocationsSinceLastSample / (float)vaMath::Max( 1, m_framesSinceLastSample ) );
+            else
+                m_heapAllocationsLog.push_back( m_heapAllocationsLog.back() );
+            m_heapAllocationsSinceLastSample    = 0;
+            m_framesSinceLastSample             = 0;
+        }
 
         m_currentSampleCount++;
+        m_samplesTaken++;
+
+        if( !m_warmupDone )
+            UpdateWarmup( );
     }
 
-    if( m_currentSampleCount >= m_currentRun.SamplingTotalCount )
+    if( m_warmupDone && m_currentSampleCount >= m_currentRun.SamplingTotalCount )
     {
         assert( m_currentSampleCount == m_currentRun.SamplingTotalCount );
         FinishCurrent();
@@ -106,11 +146,21 @@ void vaBenchmarkTool::StartNextOrStop( )
         m_timeFromStart         = -m_currentRun.DelayStartTime;
         m_currentSampleCount    = 0;
         m_currentRunSetupDone   = false;
-
+        m_samplesTaken          = 0;
+        m_warmupDone            = !m_currentRun.AutoWarmup;
+        m_warmupSamplesDiscarded= 0;
+        m_warmupTime            = m_currentRun.DelayStartTime;
 
         m_sampleCache.resize( m_currentRun.MetricNames.size() );
         m_avgMinMaxCache.resize( m_currentRun.MetricNames.size() );
         m_currentMetricsSampleLog.resize( m_currentRun.MetricNames.size() );
+
+        m_heapTracking          = vaMemory::IsTrackingEnabled( );
+        m_heapAllocationsLog.clear( );
+        int64 totalBytes, liveBytes;
+        vaMemory::GetTotals( m_heapAllocationsAtLastTick, totalBytes, liveBytes );
+        m_heapAllocationsSinceLastSample    = 0;
+        m_framesSinceLastSample             = 0;
     }
 }
 
@@ -145,14 +195,88 @@ void vaBenchmarkTool::FinishCurrent( )
 
     // report results
     if( !incorrectSampleCount )
-        m_currentRun.FinishedCallback( m_currentRun, m_currentRunIndex, (int)m_benchmarkRuns.size(), m_currentMetricsSampleLog, m_avgMinMaxCache );
+    {
+        RunResults results;
+        results.Name                    = m_currentRun.Name;
+        results.LongInfo                = m_currentRun.LongInfo;
+        results.WarmupSamplesDiscarded  = m_warmupSamplesDiscarded;
+        results.WarmupTime              = m_warmupTime;
+        results.Metrics.resize( m_currentRun.MetricNames.size() );
+        for( size_t i = 0; i < results.Metrics.size(); i++ )
+        {
+            MetricResults & metric = results.Metrics[i];
+            metric.Name             = m_currentRun.MetricNames[i];
+            metric.HigherIsBetter   = ( i < m_currentRun.MetricHigherIsBetter.size() ) && m_currentRun.MetricHigherIsBetter[i];
+            metric.Samples          = m_currentMetricsSampleLog[i];
+            ComputeStatistics( metric.Samples, m_currentRun.StatsSettings, metric.Stats );
+        }
+        if( m_heapTracking && (int)m_heapAllocationsLog.size() == m_currentSampleCount )
+        {
+            MetricResults metric;
+            metric.Name             = "heap_allocations_per_frame";
+            metric.HigherIsBetter   = false;
+            metric.Samples          = m_heapAllocationsLog;
+            ComputeStatistics( metric.Samples, m_currentRun.StatsSettings, metric.Stats );
+            results.Metrics.push_back( std::move( metric ) );
+        }
+
+        if( m_currentRun.FinishedCallback )
+            m_currentRun.FinishedCallback( m_currentRun, m_currentRunIndex, (int)m_benchmarkRuns.size(), m_currentMetricsSampleLog, m_avgMinMaxCache );
+        if( m_currentRun.FinishedResultsCallback )
+            m_currentRun.FinishedResultsCallback( m_currentRun, m_currentRunIndex, (int)m_benchmarkRuns.size(), results );
+
+        m_allResults.push_back( std::move( results ) );
+    }
 
     m_currentRun            = RunDefinition();
     m_timeFromStart         = 0.0f;
     m_currentSampleCount    = 0;
     m_currentRunSetupDone   = false;
+    m_samplesTaken          = 0;
     m_sampleCache.clear();
     m_currentMetricsSampleLog.clear();
+    m_heapAllocationsLog.clear();
+}
+
+void vaBenchmarkTool::UpdateWarmup( )
+{
+    assert( !m_warmupDone );
+
+    // need at least this many samples before MSER gives anything meaningful
+    const int c_minWarmupCheckSamples = 20;
+
+    const int metricIndex   = vaMath::Clamp( m_currentRun.WarmupMetricIndex, 0, (int)m_currentMetricsSampleLog.size() - 1 );
+    const std::vector<float> & log = m_currentMetricsSampleLog[metricIndex];
+    const int sampleCount   = (int)log.size();
+    const bool timedOut     = ( m_timeFromStart + m_currentRun.DelayStartTime ) > m_currentRun.MaxWarmupTime;
+
+    if( sampleCount < c_minWarmupCheckSamples && !timedOut )
+        return;
+
+    int discard;
+    if( !DetectWarmupLength( log, discard ) && !timedOut )
+        return;
+
+    if( timedOut )
+        VA_LOG_WARNING( "vaBenchmarkTool - '%s' did not reach steady state within %.1fs, using the samples as they are", m_currentRun.Name.c_str(), m_currentRun.MaxWarmupTime );
+
+    for( size_t i = 0; i < m_currentMetricsSampleLog.size(); i++ )
+    {
+        m_currentMetricsSampleLog[i].erase( m_currentMetricsSampleLog[i].begin(), m_currentMetricsSampleLog[i].begin() + discard );
+        // if warm-up went for longer than the whole sampling run, only keep the earliest steady state ones
+        if( (int)m_currentMetricsSampleLog[i].size() > m_currentRun.SamplingTotalCount )
+            m_currentMetricsSampleLog[i].resize( m_currentRun.SamplingTotalCount );
+    }
+    if( m_heapTracking )
+    {
+        m_heapAllocationsLog.erase( m_heapAllocationsLog.begin(), m_heapAllocationsLog.begin() + vaMath::Min( discard, (int)m_heapAllocationsLog.size() ) );
+        if( (int)m_heapAllocationsLog.size() > m_currentRun.SamplingTotalCount )
+            m_heapAllocationsLog.resize( m_currentRun.SamplingTotalCount );
+    }
+    m_currentSampleCount        = (int)m_currentMetricsSampleLog[metricIndex].size();
+    m_warmupSamplesDiscarded    = discard;
+    m_warmupTime                = m_currentRun.DelayStartTime + discard * m_currentRun.SamplingPeriod;
+    m_warmupDone                = true;
 }
 
 void vaBenchmarkTool::Stop( )
@@ -226,3 +350,437 @@ void vaBenchmarkTool::WriteResultsCSV( const wstring & fileName, bool append, co
 
     //outFile.WriteTXT( )
 }
+
+// linear interpolation between closest ranks
+static double PercentileSorted( const std::vector<double> & sorted, double percentile )
+{
+    assert( sorted.size() > 0 );
+    double position = percentile * (double)( sorted.size() - 1 );
+    size_t index    = (size_t)position;
+    if( index + 1 >= sorted.size() )
+        return sorted.back();
+    double frac     = position - (double)index;
+    return sorted[index] * ( 1.0 - frac ) + sorted[index+1] * frac;
+}
+
+// partially reorders 'values'!
+static double MedianInPlace( std::vector<double> & values )
+{
+    assert( values.size() > 0 );
+    size_t half = values.size() / 2;
+    std::nth_element( values.begin(), values.begin() + half, values.end() );
+    double median = values[half];
+    if( ( values.size() % 2 ) == 0 )
+        median = 0.5 * ( median + *std::max_element( values.begin(), values.begin() + half ) );
+    return median;
+}
+
+void vaBenchmarkTool::ComputeStatistics( const std::vector<float> & samples, const StatisticsSettings & settings, Statistics & outStats )
+{
+    outStats = Statistics();
+    if( samples.size() == 0 )
+        return;
+
+    std::vector<double> data( samples.begin(), samples.end() );
+    std::sort( data.begin(), data.end() );
+
+    // outlier rejection based on median absolute deviation - unlike stddev it isn't itself skewed by the outliers
+    if( settings.OutlierRejectionK > 0 && data.size() >= 3 )
+    {
+        double median = PercentileSorted( data, 0.5 );
+        std::vector<double> deviations( data.size() );
+        for( size_t i = 0; i < data.size(); i++ )
+            deviations[i] = std::abs( data[i] - median );
+        double sigma = 1.4826 * MedianInPlace( deviations );    // MAD scaled to match stddev for normally distributed data
+        if( sigma > 0 )
+        {
+            double threshold = settings.OutlierRejectionK * sigma;
+            auto newEnd = std::remove_if( data.begin(), data.end(), [median, threshold]( double v ) { return std::abs( v - median ) > threshold; } );
+            outStats.OutliersRejected = (int)( data.end() - newEnd );
+            data.erase( newEnd, data.end() );
+        }
+    }
+
+    const size_t n  = data.size();
+    outStats.Count  = (int)n;
+
+    double sum = 0.0;
+    for( double v : data )
+        sum += v;
+    outStats.Mean   = sum / (double)n;
+    double sqDiffSum = 0.0;
+    for( double v : data )
+        sqDiffSum += ( v - outStats.Mean ) * ( v - outStats.Mean );
+    outStats.StdDev = ( n > 1 ) ? ( std::sqrt( sqDiffSum / (double)( n - 1 ) ) ) : ( 0.0 );
+
+    outStats.Median     = PercentileSorted( data, 0.5 );
+    outStats.P90        = PercentileSorted( data, 0.90 );
+    outStats.P99        = PercentileSorted( data, 0.99 );
+    outStats.Minimum    = data.front();
+    outStats.Maximum    = data.back();
+
+    outStats.MeanCILow  = outStats.MeanCIHigh   = outStats.Mean;
+    outStats.MedianCILow= outStats.MedianCIHigh = outStats.Median;
+    if( settings.BootstrapResamples > 0 && n > 1 )
+    {
+        // percentile bootstrap
+        vaRandom rnd( settings.BootstrapSeed );
+        std::vector<double> resample( n );
+        std::vector<double> means( settings.BootstrapResamples );
+        std::vector<double> medians( settings.BootstrapResamples );
+        for( int b = 0; b < settings.BootstrapResamples; b++ )
+        {
+            double resampleSum = 0.0;
+            for( size_t i = 0; i < n; i++ )
+            {
+                resample[i] = data[ rnd.NextIntRange( (int32)n ) ];
+                resampleSum += resample[i];
+            }
+            means[b]    = resampleSum / (double)n;
+            medians[b]  = MedianInPlace( resample );
+        }
+        std::sort( means.begin(), means.end() );
+        std::sort( medians.begin(), medians.end() );
+        double alpha = 1.0 - vaMath::Clamp( (double)settings.ConfidenceLevel, 0.0, 1.0 );
+        outStats.MeanCILow      = PercentileSorted( means,   alpha * 0.5 );
+        outStats.MeanCIHigh     = PercentileSorted( means,   1.0 - alpha * 0.5 );
+        outStats.MedianCILow    = PercentileSorted( medians, alpha * 0.5 );
+        outStats.MedianCIHigh   = PercentileSorted( medians, 1.0 - alpha * 0.5 );
+    }
+}
+
+bool vaBenchmarkTool::DetectWarmupLength( const std::vector<float> & samples, int & outDiscardCount )
+{
+    // MSER-5 (White, 1997): pick the truncation point d (in batches of 5) that minimizes the standard error of the remaining 
+    // batch means, var(Y[d..b]) / (b - d). Only the first half is searched as the statistic becomes meaningless with few 
+    // batches left; if the minimum is at the end of that range, the series is most likely still trending.
+    const int c_batchSize   = 5;
+    const int batchCount    = (int)samples.size( ) / c_batchSize;
+    outDiscardCount = 0;
+    if( batchCount < 4 )
+        return false;
+
+    std::vector<double> batchMeans( batchCount );
+    for( int b = 0; b < batchCount; b++ )
+    {
+        double sum = 0.0;
+        for( int i = 0; i < c_batchSize; i++ )
+            sum += samples[b * c_batchSize + i];
+        batchMeans[b] = sum / c_batchSize;
+    }
+
+    // go from the back, accumulating suffix sums
+    const int maxD = batchCount / 2;
+    double sum = 0.0, sumSq = 0.0;
+    double bestValue = std::numeric_limits<double>::max( );
+    int bestD = 0;
+    for( int d = batchCount - 1; d >= 0; d-- )
+    {
+        sum     += batchMeans[d];
+        sumSq   += batchMeans[d] * batchMeans[d];
+        if( d > maxD )
+            continue;
+        const int remaining = batchCount - d;
+        // sum of squared deviations / remaining^2
+        double value = ( sumSq - sum * sum / remaining ) / ( (double)remaining * (double)remaining );
+        if( value <= bestValue )    // '<=' prefers earlier truncation on ties
+        {
+            bestValue   = value;
+            bestD       = d;
+        }
+    }
+    outDiscardCount = bestD * c_batchSize;
+    return bestD < maxD;
+}
+
+static string JSONEscape( const string & text )
+{
+    string ret;
+    ret.reserve( text.size() + 2 );
+    for( char c : text )
+    {
+        switch( c )
+        {
+        case( '"' ):    ret += "\\\""; break;
+        case( '\\' ):   ret += "\\\\"; break;
+        case( '\n' ):   ret += "\\n";  break;
+        case( '\r' ):   ret += "\\r";  break;
+        case( '\t' ):   ret += "\\t";  break;
+        default:
+            if( (unsigned char)c < 0x20 )
+                ret += vaStringTools::Format( "\\u%04x", (int)c );
+            else
+                ret += c;
+        }
+    }
+    return ret;
+}
+
+bool vaBenchmarkTool::WriteResultsJSON( const wstring & fileName, const std::vector<RunResults> & results )
+{
+    vaFileStream outFile;
+    if( !outFile.Open( fileName, FileCreationMode::Create, FileAccessMode::Write ) )
+    {
+        VA_LOG_ERROR( L"vaBenchmarkTool - unable to open '%s' for writing", fileName.c_str() );
+        return false;
+    }
+
+    string out;
+    out += "{\n";
+    out += "  \"format\": \"vaBenchmarkTool\",\n";
+    out += "  \"version\": 1,\n";
+    out += "  \"cpu\": \"" + JSONEscape( vaCore::GetCPUIDName() ) + "\",\n";
+    out += vaStringTools::Format( "  \"time\": %lld,\n", (long long)std::time( nullptr ) );
+    out += "  \"runs\": [\n";
+    for( size_t r = 0; r < results.size(); r++ )
+    {
+        const RunResults & run = results[r];
+        out += "    {\n";
+        out += "      \"name\": \"" + JSONEscape( run.Name ) + "\",\n";
+        out += "      \"info\": \"" + JSONEscape( run.LongInfo ) + "\",\n";
+        out += vaStringTools::Format( "      \"warmup_samples_discarded\": %d,\n", run.WarmupSamplesDiscarded );
+        out += vaStringTools::Format( "      \"warmup_time\": %.6g,\n", run.WarmupTime );
+        out += "      \"metrics\": [\n";
+        for( size_t m = 0; m < run.Metrics.size(); m++ )
+        {
+            const MetricResults & metric = run.Metrics[m];
+            const Statistics & st = metric.Stats;
+            out += "        {\n";
+            out += "          \"name\": \"" + JSONEscape( metric.Name ) + "\",\n";
+            out += string( "          \"higher_is_better\": " ) + ( ( metric.HigherIsBetter ) ? ( "true" ) : ( "false" ) ) + ",\n";
+            out += vaStringTools::Format( "          \"stats\": { \"count\": %d, \"outliers_rejected\": %d, \"mean\": %.9g, \"stddev\": %.9g, \"median\": %.9g, \"p90\": %.9g, \"p99\": %.9g, \"min\": %.9g, \"max\": %.9g, \"mean_ci\": [ %.9g, %.9g ], \"median_ci\": [ %.9g, %.9g ] },\n",
+                st.Count, st.OutliersRejected, st.Mean, st.StdDev, st.Median, st.P90, st.P99, st.Minimum, st.Maximum, st.MeanCILow, st.MeanCIHigh, st.MedianCILow, st.MedianCIHigh );
+            out += "          \"samples\": [";
+            for( size_t i = 0; i < metric.Samples.size(); i++ )
+                out += vaStringTools::Format( ( i == 0 ) ? ( " %.9g" ) : ( ", %.9g" ), metric.Samples[i] );
+            out += " ]\n";
+            out += ( m + 1 < run.Metrics.size() ) ? ( "        },\n" ) : ( "        }\n" );
+        }
+        out += "      ]\n";
+        out += ( r + 1 < results.size() ) ? ( "    },\n" ) : ( "    }\n" );
+    }
+    out += "  ]\n";
+    out += "}\n";
+
+    if( !outFile.WriteTXT( out ) )
+    {
+        VA_LOG_ERROR( L"vaBenchmarkTool - error writing to '%s'", fileName.c_str() );
+        return false;
+    }
+    return true;
+}
+
+bool vaBenchmarkTool::ReadResultsJSON( const wstring & fileName, std::vector<RunResults> & outResults )
+{
+    outResults.clear();
+
+    string text = vaFileTools::LoadFileAsText( fileName );
+    if( text == "" )
+    {
+        VA_LOG_ERROR( L"vaBenchmarkTool - unable to read '%s'", fileName.c_str() );
+        return false;
+    }
+
+    rapidjson::Document doc;
+    doc.Parse( text.c_str() );
+    if( doc.HasParseError() || !doc.IsObject() || !doc.HasMember( "runs" ) || !doc["runs"].IsArray() )
+    {
+        VA_LOG_ERROR( L"vaBenchmarkTool - '%s' is not a valid benchmark results file", fileName.c_str() );
+        return false;
+    }
+
+    auto getNumber = []( const rapidjson::Value & obj, const char * name, double defaultValue ) -> double 
+    { 
+        auto it = obj.FindMember( name ); 
+        return ( it != obj.MemberEnd() && it->value.IsNumber() ) ? ( it->value.GetDouble() ) : ( defaultValue ); 
+    };
+    auto getString = []( const rapidjson::Value & obj, const char * name ) -> string
+    { 
+        auto it = obj.FindMember( name ); 
+        return ( it != obj.MemberEnd() && it->value.IsString() ) ? ( string( it->value.GetString(), it->value.GetStringLength() ) ) : ( "" ); 
+    };
+    auto getRange = [&getNumber]( const rapidjson::Value & obj, const char * name, double & outLow, double & outHigh )
+    {
+        auto it = obj.FindMember( name ); 
+        if( it != obj.MemberEnd() && it->value.IsArray() && it->value.Size() == 2 && it->value[0].IsNumber() && it->value[1].IsNumber() )
+        {
+            outLow  = it->value[0].GetDouble();
+            outHigh = it->value[1].GetDouble();
+        }
+    };
+
+    for( const rapidjson::Value & runValue : doc["runs"].GetArray() )
+    {
+        if( !runValue.IsObject() )
+            continue;
+        RunResults run;
+        run.Name                    = getString( runValue, "name" );
+        run.LongInfo                = getString( runValue, "info" );
+        run.WarmupSamplesDiscarded  = (int)getNumber( runValue, "warmup_samples_discarded", 0 );
+        run.WarmupTime              = (float)getNumber( runValue, "warmup_time", 0 );
+
+        auto metricsIt = runValue.FindMember( "metrics" );
+        if( metricsIt != runValue.MemberEnd() && metricsIt->value.IsArray() )
+        {
+            for( const rapidjson::Value & metricValue : metricsIt->value.GetArray() )
+            {
+                if( !metricValue.IsObject() )
+                    continue;
+                MetricResults metric;
+                metric.Name             = getString( metricValue, "name" );
+                auto hibIt              = metricValue.FindMember( "higher_is_better" );
+                metric.HigherIsBetter   = hibIt != metricValue.MemberEnd() && hibIt->value.IsBool() && hibIt->value.GetBool();
+
+                auto samplesIt = metricValue.FindMember( "samples" );
+                if( samplesIt != metricValue.MemberEnd() && samplesIt->value.IsArray() )
+                    for( const rapidjson::Value & sample : samplesIt->value.GetArray() )
+                        if( sample.IsNumber() )
+                            metric.Samples.push_back( (float)sample.GetDouble() );
+
+                auto statsIt = metricValue.FindMember( "stats" );
+                if( statsIt != metricValue.MemberEnd() && statsIt->value.IsObject() )
+                {
+                    const rapidjson::Value & st = statsIt->value;
+                    metric.Stats.Count              = (int)getNumber( st, "count", 0 );
+                    metric.Stats.OutliersRejected   = (int)getNumber( st, "outliers_rejected", 0 );
+                    metric.Stats.Mean               = getNumber( st, "mean", 0 );
+                    metric.Stats.StdDev             = getNumber( st, "stddev", 0 );
+                    metric.Stats.Median             = getNumber( st, "median", 0 );
+                    metric.Stats.P90                = getNumber( st, "p90", 0 );
+                    metric.Stats.P99                = getNumber( st, "p99", 0 );
+                    metric.Stats.Minimum            = getNumber( st, "min", 0 );
+                    metric.Stats.Maximum            = getNumber( st, "max", 0 );
+                    getRange( st, "mean_ci", metric.Stats.MeanCILow, metric.Stats.MeanCIHigh );
+                    getRange( st, "median_ci", metric.Stats.MedianCILow, metric.Stats.MedianCIHigh );
+                }
+                else
+                    ComputeStatistics( metric.Samples, StatisticsSettings(), metric.Stats );
+
+                run.Metrics.push_back( std::move( metric ) );
+            }
+        }
+        outResults.push_back( std::move( run ) );
+    }
+    return true;
+}
+
+// two-sided p-value of the Mann-Whitney U test (normal approximation with tie correction) - doesn't assume normally 
+// distributed samples, which frame timings never are
+static double MannWhitneyUPValue( const std::vector<float> & a, const std::vector<float> & b )
+{
+    const size_t n1 = a.size(), n2 = b.size();
+    if( n1 == 0 || n2 == 0 )
+        return 1.0;
+
+    std::vector<std::pair<float, int>> all;
+    all.reserve( n1 + n2 );
+    for( float v : a ) all.push_back( std::make_pair( v, 0 ) );
+    for( float v : b ) all.push_back( std::make_pair( v, 1 ) );
+    std::sort( all.begin(), all.end(), []( const std::pair<float, int> & l, const std::pair<float, int> & r ) { return l.first < r.first; } );
+
+    const double n = (double)all.size();
+    double rankSumA = 0.0, tieCorrection = 0.0;
+    for( size_t i = 0; i < all.size(); )
+    {
+        size_t j = i;
+        while( j + 1 < all.size() && all[j + 1].first == all[i].first )
+            j++;
+        double averageRank = 0.5 * (double)( i + j ) + 1.0;  // ranks are 1-based
+        double tieCount = (double)( j - i + 1 );
+        tieCorrection += tieCount * tieCount * tieCount - tieCount;
+        for( size_t k = i; k <= j; k++ )
+            if( all[k].second == 0 )
+                rankSumA += averageRank;
+        i = j + 1;
+    }
+
+    const double u      = rankSumA - (double)n1 * ( n1 + 1 ) * 0.5;
+    const double mu     = (double)n1 * (double)n2 * 0.5;
+    const double sigma  = std::sqrt( (double)n1 * (double)n2 / 12.0 * ( ( n + 1.0 ) - tieCorrection / ( n * ( n - 1.0 ) ) ) );
+    if( sigma <= 0 )
+        return 1.0;
+    const double z      = vaMath::Max( 0.0, std::abs( u - mu ) - 0.5 ) / sigma;     // with continuity correction
+    return std::erfc( z / std::sqrt( 2.0 ) );
+}
+
+void vaBenchmarkTool::CompareResults( const std::vector<RunResults> & baseline, const std::vector<RunResults> & current, std::vector<MetricComparison> & outComparisons, double pValueThreshold, double minRelativeChange )
+{
+    outComparisons.clear();
+    for( const RunResults & currentRun : current )
+    {
+        auto baselineRun = std::find_if( baseline.begin(), baseline.end(), [&currentRun]( const RunResults & r ) { return r.Name == currentRun.Name; } );
+        if( baselineRun == baseline.end() )
+            continue;
+
+        for( const MetricResults & currentMetric : currentRun.Metrics )
+        {
+            auto baselineMetric = std::find_if( baselineRun->Metrics.begin(), baselineRun->Metrics.end(), [&currentMetric]( const MetricResults & m ) { return m.Name == currentMetric.Name; } );
+            if( baselineMetric == baselineRun->Metrics.end() )
+                continue;
+
+            MetricComparison comp;
+            comp.RunName        = currentRun.Name;
+            comp.MetricName     = currentMetric.Name;
+            comp.BaselineMedian = baselineMetric->Stats.Median;
+            comp.CurrentMedian  = currentMetric.Stats.Median;
+            comp.RelativeChange = ( comp.BaselineMedian != 0 ) ? ( ( comp.CurrentMedian - comp.BaselineMedian ) / std::abs( comp.BaselineMedian ) ) : ( 0.0 );
+            comp.PValue         = MannWhitneyUPValue( baselineMetric->Samples, currentMetric.Samples );
+            comp.Significant    = comp.PValue < pValueThreshold && std::abs( comp.RelativeChange ) > minRelativeChange;
+            bool gotWorse      = ( currentMetric.HigherIsBetter ) ? ( comp.RelativeChange < 0 ) : ( comp.RelativeChange > 0 );
+            comp.Regression     = comp.Significant && gotWorse;
+            comp.Improvement    = comp.Significant && !gotWorse;
+            outComparisons.push_back( comp );
+        }
+    }
+}
+
+int vaBenchmarkTool::CompareResultsJSON( const wstring & baselineFileName, const wstring & currentFileName, const wstring & reportFileName, double pValueThreshold, double minRelativeChange )
+{
+    std::vector<RunResults> baseline, current;
+    if( !ReadResultsJSON( baselineFileName, baseline ) || !ReadResultsJSON( currentFileName, current ) )
+        return -1;
+
+    std::vector<MetricComparison> comparisons;
+    CompareResults( baseline, current, comparisons, pValueThreshold, minRelativeChange );
+
+    int regressions = 0, improvements = 0;
+    for( const MetricComparison & comp : comparisons )
+    {
+        if( comp.Regression )
+        {
+            regressions++;
+            VA_LOG_WARNING( "vaBenchmarkTool - REGRESSION '%s' / '%s': median %.4g -> %.4g (%+.2f%%, p=%.2g)", comp.RunName.c_str(), comp.MetricName.c_str(), comp.BaselineMedian, comp.CurrentMedian, comp.RelativeChange * 100.0, comp.PValue );
+        }
+        else if( comp.Improvement )
+        {
+            improvements++;
+            VA_LOG_SUCCESS( "vaBenchmarkTool - improvement '%s' / '%s': median %.4g -> %.4g (%+.2f%%, p=%.2g)", comp.RunName.c_str(), comp.MetricName.c_str(), comp.BaselineMedian, comp.CurrentMedian, comp.RelativeChange * 100.0, comp.PValue );
+        }
+    }
+    VA_LOG( "vaBenchmarkTool - compared %d metrics: %d regressions, %d improvements", (int)comparisons.size(), regressions, improvements );
+
+    if( reportFileName != L"" )
+    {
+        vaFileStream outFile;
+        if( !outFile.Open( reportFileName, FileCreationMode::Create, FileAccessMode::Write ) )
+            VA_LOG_ERROR( L"vaBenchmarkTool - unable to open '%s' for writing", reportFileName.c_str() );
+        else
+        {
+            string out = "{\n";
+            out += vaStringTools::Format( "  \"regressions\": %d,\n  \"improvements\": %d,\n  \"p_value_threshold\": %g,\n  \"min_relative_change\": %g,\n", regressions, improvements, pValueThreshold, minRelativeChange );
+            out += "  \"comparisons\": [\n";
+            for( size_t i = 0; i < comparisons.size(); i++ )
+            {
+                const MetricComparison & comp = comparisons[i];
+                out += vaStringTools::Format( "    { \"run\": \"%s\", \"metric\": \"%s\", \"baseline_median\": %.9g, \"current_median\": %.9g, \"relative_change\": %.6g, \"p_value\": %.6g, \"significant\": %s, \"regression\": %s, \"improvement\": %s }%s\n",
+                    JSONEscape( comp.RunName ).c_str(), JSONEscape( comp.MetricName ).c_str(), comp.BaselineMedian, comp.CurrentMedian, comp.RelativeChange, comp.PValue, 
+                    (comp.Significant)?("true"):("false"), (comp.Regression)?("true"):("false"), (comp.Improvement)?("true"):("false"), ( i + 1 < comparisons.size() ) ? ( "," ) : ( "" ) );
+            }
+            out += "  ]\n}\n";
+            if( !outFile.WriteTXT( out ) )
+                VA_LOG_ERROR( L"vaBenchmarkTool - error writing to '%s'", reportFileName.c_str() );
+        }
+    }
+
+    return regressions;
+}
@@ -21,6 +21,7 @@
 
 #include "..\vaCore.h"
 #include "..\vaSingleton.h"
+#include "..\vaMath.h"
 
 #include <ctime>
 
@@ -37,6 +38,34 @@ namespace Vanilla
             float                           Maximum;
         };
 
+        // Robust per-metric statistics; computed after warm-up samples were discarded and outliers rejected
+        struct Statistics
+        {
+            int                             Count               = 0;        // samples used (after outlier rejection)
+            int                             OutliersRejected    = 0;
+            double                          Mean                = 0.0;
+            double                          StdDev              = 0.0;      // sample standard deviation (n-1)
+            double                          Median              = 0.0;
+            double                          P90                 = 0.0;
+            double                          P99                 = 0.0;
+            double                          Minimum             = 0.0;
+            double                          Maximum             = 0.0;
+            double                          MeanCILow           = 0.0;      // bootstrap confidence interval of the mean (see StatisticsSettings::ConfidenceLevel)
+            double                          MeanCIHigh          = 0.0;
+            double                          MedianCILow         = 0.0;      // bootstrap confidence interval of the median
+            double                          MedianCIHigh        = 0.0;
+        };
+
+        struct StatisticsSettings
+        {
+            float                           OutlierRejectionK   = 5.0f;     // reject samples further than K * MAD (scaled to sigma) from median; 0 to disable
+            int                             BootstrapResamples  = 1000;     // 0 to disable confidence intervals
+            float                           ConfidenceLevel     = 0.95f;
+            int                             BootstrapSeed       = 0;        // fixed seed so the same samples always give the same intervals
+        };
+
+        struct RunResults;
+
         struct RunDefinition
         {
             std::string                                                         Name;
@@ -46,6 +75,16 @@ namespace Vanilla
             int                                                                 SamplingTotalCount;
             float                                                               DelayStartTime;
             std::vector<std::string>                                            MetricNames;
+            std::vector<bool>                                                   MetricHigherIsBetter;   // optional, per metric; default (missing) is lower is better (timings)
+
+            // Automatic warm-up: after DelayStartTime (which then becomes the minimum warm-up), keep sampling until the metric 
+            // at WarmupMetricIndex reaches steady state (MSER-5 truncation rule) or MaxWarmupTime runs out, discard the warm-up 
+            // part and only then collect SamplingTotalCount samples.
+            bool                                                                AutoWarmup              = false;
+            float                                                               MaxWarmupTime           = 10.0f;
+            int                                                                 WarmupMetricIndex       = 0;
+
+            StatisticsSettings                                                  StatsSettings;
 
             std::function< void( const RunDefinition & ) >                      SettingsSetupCallback;
             std::function< void( const RunDefinition &, std::vector<float> & ) >  
@@ -54,10 +93,45 @@ namespace Vanilla
             std::function< void( const RunDefinition &, int, int, const std::vector< std::vector<float> > &, const std::vector<AverageMinMax> & ) > 
                                                                                 FinishedCallback;
 
+            // same as above but with full results, including statistics (called after FinishedCallback)
+            std::function< void( const RunDefinition &, int, int, const RunResults & ) > 
+                                                                                FinishedResultsCallback;
+
             RunDefinition( ) { SamplingPeriod = 0.0f; SamplingTotalCount = 0; DelayStartTime = 1.0f; }
 
         };
 
+        struct MetricResults
+        {
+            std::string                     Name;
+            bool                            HigherIsBetter      = false;
+            std::vector<float>              Samples;                        // all samples after warm-up (including outliers)
+            Statistics                      Stats;
+        };
+
+        struct RunResults
+        {
+            std::string                     Name;
+            std::string                     LongInfo;
+            int                             WarmupSamplesDiscarded  = 0;
+            float                           WarmupTime              = 0.0f; // total time spent before sampling started (DelayStartTime or detected)
+            std::vector<MetricResults>      Metrics;
+        };
+
+        // comparison of a single metric between two results files (see CompareResults)
+        struct MetricComparison
+        {
+            std::string                     RunName;
+            std::string                     MetricName;
+            double                          BaselineMedian      = 0.0;
+            double                          CurrentMedian       = 0.0;
+            double                          RelativeChange      = 0.0;      // (current - baseline) / baseline
+            double                          PValue              = 1.0;      // two-sided Mann-Whitney U test
+            bool                            Significant         = false;    // PValue below threshold AND change larger than the minimum relative change
+            bool                            Regression          = false;    // significant and in the 'worse' direction
+            bool                            Improvement         = false;    // significant and in the 'better' direction
+        };
+
     private:
         bool                                m_active;
 
@@ -69,6 +143,18 @@ namespace Vanilla
         std::vector< float >                m_sampleCache;
         std::vector< std::vector<float> >   m_currentMetricsSampleLog;
         std::vector< AverageMinMax >        m_avgMinMaxCache;
+        std::vector< RunResults >           m_allResults;                   // all finished runs from the last Run( )
+        bool                                m_warmupDone;
+        int                                 m_warmupSamplesDiscarded;
+        float                               m_warmupTime;
+        int                                 m_samplesTaken;                 // including warm-up
+
+        // if vaMemory allocation tracking is enabled when a run starts, heap allocations per frame get logged as an extra metric
+        bool                                m_heapTracking;
+        std::vector<float>                  m_heapAllocationsLog;
+        int64                               m_heapAllocationsAtLastTick;
+        int64                               m_heapAllocationsSinceLastSample;
+        int                                 m_framesSinceLastSample;
 
         std::time_t                         m_runStartTime;
 
@@ -91,12 +177,32 @@ namespace Vanilla
         int                                                 GetTotalRunCount( ) const                   { return (int)m_benchmarkRuns.size(); }
         time_t                                              GetRunStartTime( ) const                    { return m_runStartTime; }
 
-        float                                               GetRemainingBenchmarkTime( )                { return m_currentRun.SamplingPeriod * m_currentRun.SamplingTotalCount - m_timeFromStart; }
+        // (during auto warm-up this is only an estimate as the warm-up length is not known up front)
+        float                                               GetRemainingBenchmarkTime( )                { return m_currentRun.SamplingPeriod * ( m_currentRun.SamplingTotalCount - ( ( m_warmupDone ) ? ( m_currentSampleCount ) : ( 0 ) ) ) + vaMath::Max( 0.0f, -m_timeFromStart ); }
+
+        // results of all finished runs from the last Run( ) (kept after it finishes, until the next one starts)
+        const std::vector<RunResults> &                     GetResults( ) const                         { return m_allResults; }
 
         static void                                         WriteResultsCSV( const wstring & fileName, bool append, const RunDefinition & runDef, int currentIndex, int totalCount, const std::vector< std::vector<float> > & metricsSamples, const std::vector<AverageMinMax> & metricsAverages );
 
+        // statistics
+        static void                                         ComputeStatistics( const std::vector<float> & samples, const StatisticsSettings & settings, Statistics & outStats );
+        // MSER-5 truncation point - number of initial samples to discard as warm-up; returns false if the series has most 
+        // likely not reached steady state yet (outDiscardCount is then the best guess)
+        static bool                                         DetectWarmupLength( const std::vector<float> & samples, int & outDiscardCount );
+
+        // machine readable output & comparison (for nightly runs)
+        static bool                                         WriteResultsJSON( const wstring & fileName, const std::vector<RunResults> & results );
+        static bool                                         ReadResultsJSON( const wstring & fileName, std::vector<RunResults> & outResults );
+        // compares all metrics present (by run and metric name) in both; a change is significant if the Mann-Whitney U test 
+        // p-value is below pValueThreshold and the medians differ by more than minRelativeChange
+        static void                                         CompareResults( const std::vector<RunResults> & baseline, const std::vector<RunResults> & current, std::vector<MetricComparison> & outComparisons, double pValueThreshold = 0.01, double minRelativeChange = 0.01 );
+        // loads both files, compares them, logs the findings and (optionally) writes a JSON report; returns the number of regressions or -1 on error
+        static int                                          CompareResultsJSON( const wstring & baselineFileName, const wstring & currentFileName, const wstring & reportFileName = L"", double pValueThreshold = 0.01, double minRelativeChange = 0.01 );
+
     protected:
         void                                                StartNextOrStop( );
         void                                                FinishCurrent( );
+        void                                                UpdateWarmup( );
     };
 }
\ No newline at end of file
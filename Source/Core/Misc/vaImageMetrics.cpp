@@ -0,0 +1,758 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "vaImageMetrics.h"
+
+#include "Core/Misc/vaLargeBitmapFile.h"
+#include "Core/Misc/vaProfiler.h"
+#include "Core/System/vaFileTools.h"
+#include "Core/System/vaMemoryStream.h"
+
+#include <algorithm>
+#include <mutex>
+
+// x64 always has SSE2; the scalar path is there for everything else (and handles the row tails)
+#if defined( _M_X64 ) || defined( __SSE2__ )
+#define VA_IMAGE_METRICS_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace Vanilla;
+
+namespace
+{
+    static const int        c_ssimWindow        = 11;
+    static const int        c_ssimRadius        = c_ssimWindow / 2;
+    static const float      c_ssimC1            = 0.01f * 0.01f;   // (K1 * L)^2, L = 1
+    static const float      c_ssimC2            = 0.03f * 0.03f;   // (K2 * L)^2, L = 1
+    static const int        c_msssimMaxScales   = 5;
+    static const double     c_msssimWeights[c_msssimMaxScales] = { 0.0448, 0.2856, 0.3001, 0.2363, 0.1333 };
+
+    // rows per vaParallel chunk; big enough to amortize the 2*radius halo rows each SSIM band has to filter again
+    static const int        c_rowsPerChunk      = 32;
+
+    struct GaussianKernel
+    {
+        float               Weights[c_ssimWindow];
+
+        GaussianKernel( )
+        {
+            const float sigma = 1.5f;
+            float sum = 0.0f;
+            for( int i = 0; i < c_ssimWindow; i++ )
+            {
+                float d = (float)( i - c_ssimRadius );
+                Weights[i] = ::expf( -( d * d ) / ( 2.0f * sigma * sigma ) );
+                sum += Weights[i];
+            }
+            for( int i = 0; i < c_ssimWindow; i++ )
+                Weights[i] /= sum;
+        }
+    };
+    static const GaussianKernel s_gaussian;
+
+    inline float HalfToFloat( uint16 h )
+    {
+        uint32 sign     = ( h >> 15 ) & 0x1;
+        uint32 exponent = ( h >> 10 ) & 0x1F;
+        uint32 mantissa = h & 0x3FF;
+        float value;
+        if( exponent == 0 )
+            value = ::ldexpf( (float)mantissa, -24 );                           // denormal
+        else if( exponent == 31 )
+            value = ( mantissa == 0 ) ? ( std::numeric_limits<float>::infinity( ) ) : ( 0.0f ); // NaNs count as black
+        else
+            value = ::ldexpf( (float)( mantissa | 0x400 ), (int)exponent - 25 );
+        return ( sign != 0 ) ? ( -value ) : ( value );
+    }
+
+    // unsigned 11 (R, G) or 10 (B) bit float with a 5 bit exponent and 6 or 5 bit mantissa
+    inline float SmallFloatToFloat( uint32 bits, int mantissaBits )
+    {
+        uint32 exponent = bits >> mantissaBits;
+        uint32 mantissa = bits & ( ( 1 << mantissaBits ) - 1 );
+        if( exponent == 0 )
+            return ::ldexpf( (float)mantissa, -14 - mantissaBits );
+        if( exponent == 31 )
+            return ( mantissa == 0 ) ? ( std::numeric_limits<float>::infinity( ) ) : ( 0.0f );
+        return ::ldexpf( (float)( mantissa | ( 1 << mantissaBits ) ), (int)exponent - 15 - mantissaBits );
+    }
+
+    // float formats hold linear values; for display-comparable results they get saturated and sRGB encoded
+    inline float LinearToCompareSpace( float val, bool toSRGB )
+    {
+        if( !( val > 0.0f ) )   // also catches NaN
+            return 0.0f;
+        if( toSRGB )
+            return vaMath::LinearToSRGB( std::min( val, 1.0f ) );
+        return val;
+    }
+
+    // decodes one row into 3 floats per pixel
+    void DecodeRow( const vaImageMetrics::Image & image, int y, bool toSRGB, float * outRGB )
+    {
+        const uint8 * row = image.Data + (size_t)y * image.RowPitch;
+        const int width = image.Width;
+        const float k8  = 1.0f / 255.0f;
+        const float k10 = 1.0f / 1023.0f;
+        const float k16 = 1.0f / 65535.0f;
+
+        switch( image.Format )
+        {
+        case( vaResourceFormat::R8G8B8A8_TYPELESS ):
+        case( vaResourceFormat::R8G8B8A8_UNORM ):
+        case( vaResourceFormat::R8G8B8A8_UNORM_SRGB ):
+            for( int x = 0; x < width; x++, row += 4 )
+            {
+                outRGB[x*3+0] = row[0] * k8; outRGB[x*3+1] = row[1] * k8; outRGB[x*3+2] = row[2] * k8;
+            }
+            break;
+        case( vaResourceFormat::B8G8R8A8_UNORM ):
+        case( vaResourceFormat::B8G8R8X8_UNORM ):
+        case( vaResourceFormat::B8G8R8A8_UNORM_SRGB ):
+            for( int x = 0; x < width; x++, row += 4 )
+            {
+                outRGB[x*3+0] = row[2] * k8; outRGB[x*3+1] = row[1] * k8; outRGB[x*3+2] = row[0] * k8;
+            }
+            break;
+        case( vaResourceFormat::R10G10B10A2_UNORM ):
+            for( int x = 0; x < width; x++ )
+            {
+                uint32 p = ( (const uint32 *)row )[x];
+                outRGB[x*3+0] = ( p & 0x3FF ) * k10; outRGB[x*3+1] = ( ( p >> 10 ) & 0x3FF ) * k10; outRGB[x*3+2] = ( ( p >> 20 ) & 0x3FF ) * k10;
+            }
+            break;
+        case( vaResourceFormat::R8_UNORM ):
+            for( int x = 0; x < width; x++ )
+                outRGB[x*3+0] = outRGB[x*3+1] = outRGB[x*3+2] = row[x] * k8;
+            break;
+        case( vaResourceFormat::R16_UNORM ):
+            for( int x = 0; x < width; x++ )
+                outRGB[x*3+0] = outRGB[x*3+1] = outRGB[x*3+2] = ( (const uint16 *)row )[x] * k16;
+            break;
+        case( vaResourceFormat::R16G16B16A16_FLOAT ):
+            for( int x = 0; x < width; x++ )
+            {
+                const uint16 * p = (const uint16 *)row + x * 4;
+                for( int c = 0; c < 3; c++ )
+                    outRGB[x*3+c] = LinearToCompareSpace( HalfToFloat( p[c] ), toSRGB );
+            }
+            break;
+        case( vaResourceFormat::R32G32B32A32_FLOAT ):
+            for( int x = 0; x < width; x++ )
+            {
+                const float * p = (const float *)row + x * 4;
+                for( int c = 0; c < 3; c++ )
+                    outRGB[x*3+c] = LinearToCompareSpace( p[c], toSRGB );
+            }
+            break;
+        case( vaResourceFormat::R11G11B10_FLOAT ):
+            for( int x = 0; x < width; x++ )
+            {
+                uint32 p = ( (const uint32 *)row )[x];
+                outRGB[x*3+0] = LinearToCompareSpace( SmallFloatToFloat( p & 0x7FF, 6 ), toSRGB );
+                outRGB[x*3+1] = LinearToCompareSpace( SmallFloatToFloat( ( p >> 11 ) & 0x7FF, 6 ), toSRGB );
+                outRGB[x*3+2] = LinearToCompareSpace( SmallFloatToFloat( ( p >> 22 ) & 0x3FF, 5 ), toSRGB );
+            }
+            break;
+        default:
+            assert( false ); // IsFormatSupported out of sync
+            break;
+        }
+    }
+
+    inline float LabF( float t )
+    {
+        const float delta3 = 216.0f / 24389.0f;   // (6/29)^3
+        return ( t > delta3 ) ? ( ::cbrtf( t ) ) : ( t * ( 24389.0f / 27.0f ) + 16.0f ) / 116.0f;
+    }
+
+    // sRGB primaries, D65 white
+    inline void LinearRGBToLab( const float * rgb, float * lab )
+    {
+        float X = 0.4124564f * rgb[0] + 0.3575761f * rgb[1] + 0.1804375f * rgb[2];
+        float Y = 0.2126729f * rgb[0] + 0.7151522f * rgb[1] + 0.0721750f * rgb[2];
+        float Z = 0.0193339f * rgb[0] + 0.1191920f * rgb[1] + 0.9503041f * rgb[2];
+        float fx = LabF( X / 0.95047f );
+        float fy = LabF( Y );
+        float fz = LabF( Z / 1.08883f );
+        lab[0] = 116.0f * fy - 16.0f;
+        lab[1] = 500.0f * ( fx - fy );
+        lab[2] = 200.0f * ( fy - fz );
+    }
+
+    struct LumaPlane
+    {
+        vector<float>       Data;
+        int                 Width   = 0;
+        int                 Height  = 0;
+
+        void                Resize( int width, int height )     { Width = width; Height = height; Data.resize( (size_t)width * height ); }
+        float *             Row( int y )                        { return Data.data( ) + (size_t)y * Width; }
+        const float *       Row( int y ) const                  { return Data.data( ) + (size_t)y * Width; }
+    };
+
+    // 2x2 box filter
+    void Downsample( const LumaPlane & src, LumaPlane & dst )
+    {
+        dst.Resize( src.Width / 2, src.Height / 2 );
+        vaParallel::For( 0, dst.Height, c_rowsPerChunk, [&src, &dst]( int64 begin, int64 end )
+        {
+            for( int y = (int)begin; y < (int)end; y++ )
+            {
+                const float * s0 = src.Row( y * 2 );
+                const float * s1 = src.Row( y * 2 + 1 );
+                float * d = dst.Row( y );
+                for( int x = 0; x < dst.Width; x++ )
+                    d[x] = 0.25f * ( s0[x*2] + s0[x*2+1] + s1[x*2] + s1[x*2+1] );
+            }
+        } );
+    }
+
+    struct SSIMBandBuffers
+    {
+        // horizontally filtered mu_x, mu_y, x^2, y^2 and xy for all input rows of the band
+        vector<float>       Horizontal[5];
+    };
+
+    // mean SSIM and mean contrast-structure term over all fully covered 11x11 windows
+    void ComputeSSIM( const LumaPlane & ref, const LumaPlane & test, double & outSSIM, double & outCS )
+    {
+        assert( ref.Width == test.Width && ref.Height == test.Height );
+        const int outWidth  = ref.Width - c_ssimWindow + 1;
+        const int outHeight = ref.Height - c_ssimWindow + 1;
+        assert( outWidth > 0 && outHeight > 0 );
+
+        std::mutex mergeMutex;
+        double totalSSIM = 0.0;
+        double totalCS = 0.0;
+
+        vaParallel::For( 0, outHeight, c_rowsPerChunk, [&]( int64 begin, int64 end )
+        {
+            static thread_local SSIMBandBuffers buffers;
+
+            const float * g = s_gaussian.Weights;
+            const int bandRows  = (int)( end - begin );
+            const int inRows    = bandRows + c_ssimWindow - 1;
+            for( int i = 0; i < 5; i++ )
+                buffers.Horizontal[i].resize( (size_t)inRows * outWidth );
+
+            // horizontal pass
+            for( int r = 0; r < inRows; r++ )
+            {
+                const float * xRow = ref.Row( (int)begin + r );
+                const float * yRow = test.Row( (int)begin + r );
+                float * hmx = buffers.Horizontal[0].data( ) + (size_t)r * outWidth;
+                float * hmy = buffers.Horizontal[1].data( ) + (size_t)r * outWidth;
+                float * hxx = buffers.Horizontal[2].data( ) + (size_t)r * outWidth;
+                float * hyy = buffers.Horizontal[3].data( ) + (size_t)r * outWidth;
+                float * hxy = buffers.Horizontal[4].data( ) + (size_t)r * outWidth;
+
+                int c = 0;
+#ifdef VA_IMAGE_METRICS_SSE2
+                for( ; c + 4 <= outWidth; c += 4 )
+                {
+                    __m128 mx = _mm_setzero_ps( ), my = _mm_setzero_ps( ), xx = _mm_setzero_ps( ), yy = _mm_setzero_ps( ), xy = _mm_setzero_ps( );
+                    for( int k = 0; k < c_ssimWindow; k++ )
+                    {
+                        __m128 w    = _mm_set1_ps( g[k] );
+                        __m128 vx   = _mm_loadu_ps( xRow + c + k );
+                        __m128 vy   = _mm_loadu_ps( yRow + c + k );
+                        __m128 wx   = _mm_mul_ps( w, vx );
+                        __m128 wy   = _mm_mul_ps( w, vy );
+                        mx = _mm_add_ps( mx, wx );
+                        my = _mm_add_ps( my, wy );
+                        xx = _mm_add_ps( xx, _mm_mul_ps( wx, vx ) );
+                        yy = _mm_add_ps( yy, _mm_mul_ps( wy, vy ) );
+                        xy = _mm_add_ps( xy, _mm_mul_ps( wx, vy ) );
+                    }
+                    _mm_storeu_ps( hmx + c, mx ); _mm_storeu_ps( hmy + c, my );
+                    _mm_storeu_ps( hxx + c, xx ); _mm_storeu_ps( hyy + c, yy ); _mm_storeu_ps( hxy + c, xy );
+                }
+#endif
+                for( ; c < outWidth; c++ )
+                {
+                    float mx = 0, my = 0, xx = 0, yy = 0, xy = 0;
+                    for( int k = 0; k < c_ssimWindow; k++ )
+                    {
+                        float vx = xRow[c + k], vy = yRow[c + k];
+                        mx += g[k] * vx; my += g[k] * vy;
+                        xx += g[k] * vx * vx; yy += g[k] * vy * vy; xy += g[k] * vx * vy;
+                    }
+                    hmx[c] = mx; hmy[c] = my; hxx[c] = xx; hyy[c] = yy; hxy[c] = xy;
+                }
+            }
+
+            // vertical pass + SSIM; accumulate per row in double to not lose precision on big images
+            double bandSSIM = 0.0, bandCS = 0.0;
+            for( int r = 0; r < bandRows; r++ )
+            {
+                const float * src[5];
+                for( int i = 0; i < 5; i++ )
+                    src[i] = buffers.Horizontal[i].data( ) + (size_t)r * outWidth;
+
+                float rowSSIM = 0.0f, rowCS = 0.0f;
+                int c = 0;
+#ifdef VA_IMAGE_METRICS_SSE2
+                __m128 sumSSIM = _mm_setzero_ps( ), sumCS = _mm_setzero_ps( );
+                const __m128 C1 = _mm_set1_ps( c_ssimC1 ), C2 = _mm_set1_ps( c_ssimC2 ), two = _mm_set1_ps( 2.0f );
+                for( ; c + 4 <= outWidth; c += 4 )
+                {
+                    __m128 v[5] = { _mm_setzero_ps( ), _mm_setzero_ps( ), _mm_setzero_ps( ), _mm_setzero_ps( ), _mm_setzero_ps( ) };
+                    for( int k = 0; k < c_ssimWindow; k++ )
+                    {
+                        __m128 w = _mm_set1_ps( g[k] );
+                        size_t offset = (size_t)k * outWidth + c;
+                        for( int i = 0; i < 5; i++ )
+                            v[i] = _mm_add_ps( v[i], _mm_mul_ps( w, _mm_loadu_ps( src[i] + offset ) ) );
+                    }
+                    __m128 mxmy     = _mm_mul_ps( v[0], v[1] );
+                    __m128 mx2      = _mm_mul_ps( v[0], v[0] );
+                    __m128 my2      = _mm_mul_ps( v[1], v[1] );
+                    __m128 sxx      = _mm_sub_ps( v[2], mx2 );
+                    __m128 syy      = _mm_sub_ps( v[3], my2 );
+                    __m128 sxy      = _mm_sub_ps( v[4], mxmy );
+                    __m128 csNum    = _mm_add_ps( _mm_mul_ps( two, sxy ), C2 );
+                    __m128 csDen    = _mm_add_ps( _mm_add_ps( sxx, syy ), C2 );
+                    __m128 lNum     = _mm_add_ps( _mm_mul_ps( two, mxmy ), C1 );
+                    __m128 lDen     = _mm_add_ps( _mm_add_ps( mx2, my2 ), C1 );
+                    __m128 cs       = _mm_div_ps( csNum, csDen );
+                    sumCS   = _mm_add_ps( sumCS, cs );
+                    sumSSIM = _mm_add_ps( sumSSIM, _mm_mul_ps( _mm_div_ps( lNum, lDen ), cs ) );
+                }
+                alignas( 16 ) float lanes[4];
+                _mm_store_ps( lanes, sumSSIM );
+                rowSSIM = ( lanes[0] + lanes[1] ) + ( lanes[2] + lanes[3] );
+                _mm_store_ps( lanes, sumCS );
+                rowCS = ( lanes[0] + lanes[1] ) + ( lanes[2] + lanes[3] );
+#endif
+                for( ; c < outWidth; c++ )
+                {
+                    float v[5] = { 0, 0, 0, 0, 0 };
+                    for( int k = 0; k < c_ssimWindow; k++ )
+                    {
+                        size_t offset = (size_t)k * outWidth + c;
+                        for( int i = 0; i < 5; i++ )
+                            v[i] += g[k] * src[i][offset];
+                    }
+                    float sxx = v[2] - v[0] * v[0];
+                    float syy = v[3] - v[1] * v[1];
+                    float sxy = v[4] - v[0] * v[1];
+                    float cs  = ( 2.0f * sxy + c_ssimC2 ) / ( sxx + syy + c_ssimC2 );
+                    float l   = ( 2.0f * v[0] * v[1] + c_ssimC1 ) / ( v[0] * v[0] + v[1] * v[1] + c_ssimC1 );
+                    rowCS   += cs;
+                    rowSSIM += l * cs;
+                }
+                bandSSIM    += rowSSIM;
+                bandCS      += rowCS;
+            }
+
+            std::lock_guard<std::mutex> lock( mergeMutex );
+            totalSSIM   += bandSSIM;
+            totalCS     += bandCS;
+        } );
+
+        double count = (double)outWidth * (double)outHeight;
+        outSSIM = totalSSIM / count;
+        outCS   = totalCS / count;
+    }
+}
+
+bool vaImageMetrics::IsFormatSupported( vaResourceFormat format )
+{
+    switch( format )
+    {
+    case( vaResourceFormat::R8G8B8A8_TYPELESS ):
+    case( vaResourceFormat::R8G8B8A8_UNORM ):
+    case( vaResourceFormat::R8G8B8A8_UNORM_SRGB ):
+    case( vaResourceFormat::B8G8R8A8_UNORM ):
+    case( vaResourceFormat::B8G8R8X8_UNORM ):
+    case( vaResourceFormat::B8G8R8A8_UNORM_SRGB ):
+    case( vaResourceFormat::R10G10B10A2_UNORM ):
+    case( vaResourceFormat::R8_UNORM ):
+    case( vaResourceFormat::R16_UNORM ):
+    case( vaResourceFormat::R16G16B16A16_FLOAT ):
+    case( vaResourceFormat::R32G32B32A32_FLOAT ):
+    case( vaResourceFormat::R11G11B10_FLOAT ):
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool vaImageMetrics::Compare( const Image & reference, const Image & test, const Settings & settings, Results & outResults )
+{
+    VA_TRACE_CPU_SCOPE( vaImageMetrics_Compare );
+
+    outResults = Results( );
+    if( !reference.IsValid( ) || !test.IsValid( ) )
+    {
+        VA_LOG_ERROR( "vaImageMetrics::Compare - invalid image or unsupported format" );
+        return false;
+    }
+    if( reference.Width != test.Width || reference.Height != test.Height )
+    {
+        VA_LOG_ERROR( "vaImageMetrics::Compare - image sizes don't match (%d x %d vs %d x %d)", reference.Width, reference.Height, test.Width, test.Height );
+        return false;
+    }
+
+    const int width     = reference.Width;
+    const int height    = reference.Height;
+    const bool needLuma = settings.SSIM || settings.MSSSIM;
+
+    LumaPlane refLuma, testLuma;
+    if( needLuma )
+    {
+        refLuma.Resize( width, height );
+        testLuma.Resize( width, height );
+    }
+    if( settings.PerceptualErrorMap )
+    {
+        outResults.ErrorMap.resize( (size_t)width * height );
+        outResults.ErrorMapWidth    = width;
+        outResults.ErrorMapHeight   = height;
+    }
+
+    // pass 1: decode, squared error, luma and (optionally) deltaE
+    std::mutex mergeMutex;
+    double sumSq[3]     = { 0, 0, 0 };
+    double sumDeltaE    = 0.0;
+    double maxDeltaE    = 0.0;
+    vaParallel::For( 0, height, c_rowsPerChunk, [&]( int64 begin, int64 end )
+    {
+        static thread_local vector<float> rowRef, rowTest;
+        rowRef.resize( (size_t)width * 3 );
+        rowTest.resize( (size_t)width * 3 );
+
+        double chunkSq[3]       = { 0, 0, 0 };
+        double chunkDeltaE      = 0.0;
+        double chunkMaxDeltaE   = 0.0;
+        for( int y = (int)begin; y < (int)end; y++ )
+        {
+            DecodeRow( reference, y, settings.CompareInSRGB, rowRef.data( ) );
+            DecodeRow( test, y, settings.CompareInSRGB, rowTest.data( ) );
+
+            float rowSq[3] = { 0, 0, 0 };
+            for( int x = 0; x < width; x++ )
+            {
+                for( int c = 0; c < 3; c++ )
+                {
+                    float d = rowRef[x*3+c] - rowTest[x*3+c];
+                    rowSq[c] += d * d;
+                }
+            }
+            for( int c = 0; c < 3; c++ )
+                chunkSq[c] += rowSq[c];
+
+            if( needLuma )
+            {
+                float * lr = refLuma.Row( y );
+                float * lt = testLuma.Row( y );
+                for( int x = 0; x < width; x++ )
+                {
+                    lr[x] = 0.2126f * rowRef[x*3+0] + 0.7152f * rowRef[x*3+1] + 0.0722f * rowRef[x*3+2];
+                    lt[x] = 0.2126f * rowTest[x*3+0] + 0.7152f * rowTest[x*3+1] + 0.0722f * rowTest[x*3+2];
+                }
+            }
+
+            if( settings.PerceptualErrorMap )
+            {
+                float * errRow = outResults.ErrorMap.data( ) + (size_t)y * width;
+                float rowDeltaE = 0.0f;
+                for( int x = 0; x < width; x++ )
+                {
+                    float linRef[3], linTest[3], labRef[3], labTest[3];
+                    for( int c = 0; c < 3; c++ )
+                    {
+                        linRef[c]   = ( settings.CompareInSRGB ) ? ( vaMath::SRGBToLinear( rowRef[x*3+c] ) ) : ( rowRef[x*3+c] );
+                        linTest[c]  = ( settings.CompareInSRGB ) ? ( vaMath::SRGBToLinear( rowTest[x*3+c] ) ) : ( rowTest[x*3+c] );
+                    }
+                    LinearRGBToLab( linRef, labRef );
+                    LinearRGBToLab( linTest, labTest );
+                    float dL = labRef[0] - labTest[0], da = labRef[1] - labTest[1], db = labRef[2] - labTest[2];
+                    float deltaE = ::sqrtf( dL * dL + da * da + db * db );
+                    errRow[x] = deltaE;
+                    rowDeltaE += deltaE;
+                    chunkMaxDeltaE = std::max( chunkMaxDeltaE, (double)deltaE );
+                }
+                chunkDeltaE += rowDeltaE;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock( mergeMutex );
+        for( int c = 0; c < 3; c++ )
+            sumSq[c] += chunkSq[c];
+        sumDeltaE   += chunkDeltaE;
+        maxDeltaE   = std::max( maxDeltaE, chunkMaxDeltaE );
+    } );
+
+    const double pixelCount = (double)width * (double)height;
+    for( int c = 0; c < 3; c++ )
+        outResults.MSEPerChannel[c] = sumSq[c] / pixelCount;
+    outResults.MSE  = ( outResults.MSEPerChannel[0] + outResults.MSEPerChannel[1] + outResults.MSEPerChannel[2] ) / 3.0;
+    outResults.PSNR = vaMath::PSNR( outResults.MSE, 1.0 );
+    if( settings.PerceptualErrorMap )
+    {
+        outResults.MeanDeltaE   = sumDeltaE / pixelCount;
+        outResults.MaxDeltaE    = maxDeltaE;
+    }
+
+    // SSIM / MS-SSIM; scale 0 SSIM is shared
+    if( needLuma && width >= c_ssimWindow && height >= c_ssimWindow )
+    {
+        double ssim, cs;
+        ComputeSSIM( refLuma, testLuma, ssim, cs );
+        if( settings.SSIM )
+            outResults.SSIM = ssim;
+
+        if( settings.MSSSIM )
+        {
+            // use as many scales as fit the window; weights get renormalized if there are fewer than 5
+            int scales = 1;
+            while( scales < c_msssimMaxScales && ( width >> scales ) >= c_ssimWindow && ( height >> scales ) >= c_ssimWindow )
+                scales++;
+
+            double weightSum = 0.0;
+            for( int s = 0; s < scales; s++ )
+                weightSum += c_msssimWeights[s];
+
+            double msssim = 1.0;
+            LumaPlane downRef, downTest;
+            for( int s = 0; s < scales; s++ )
+            {
+                if( s > 0 )
+                {
+                    LumaPlane tmpRef, tmpTest;
+                    Downsample( refLuma, tmpRef );
+                    Downsample( testLuma, tmpTest );
+                    refLuma     = std::move( tmpRef );
+                    testLuma    = std::move( tmpTest );
+                    ComputeSSIM( refLuma, testLuma, ssim, cs );
+                }
+                // negative values (anticorrelated structure) would make the product meaningless
+                double term = ( s == scales - 1 ) ? ( ssim ) : ( cs );
+                msssim *= ::pow( std::max( 0.0, term ), c_msssimWeights[s] / weightSum );
+            }
+            outResults.MSSSIM       = msssim;
+            outResults.MSSSIMScales = scales;
+        }
+    }
+
+    outResults.Valid = true;
+    return true;
+}
+
+void vaImageMetrics::CompareBatch( const vector<pair<Image, Image>> & pairs, const Settings & settings, vector<Results> & outResults )
+{
+    VA_TRACE_CPU_SCOPE( vaImageMetrics_CompareBatch );
+
+    outResults.clear( );
+    outResults.resize( pairs.size( ) );
+
+    // one pair per task; comparisons themselves then run serially on each worker, which scales better than splitting
+    // each image when there are enough of them
+    vaParallel::For( 0, (int64)pairs.size( ), 1, [&]( int64 begin, int64 end )
+    {
+        for( int64 i = begin; i < end; i++ )
+            Compare( pairs[i].first, pairs[i].second, settings, outResults[i] );
+    } );
+}
+
+void vaImageMetrics::CompareBatch( const vector<pair<wstring, wstring>> & largeBitmapFilePairs, const Settings & settings, vector<Results> & outResults )
+{
+    VA_TRACE_CPU_SCOPE( vaImageMetrics_CompareBatchFiles );
+
+    outResults.clear( );
+    outResults.resize( largeBitmapFilePairs.size( ) );
+
+    vaParallel::For( 0, (int64)largeBitmapFilePairs.size( ), 1, [&]( int64 begin, int64 end )
+    {
+        for( int64 i = begin; i < end; i++ )
+        {
+            Image reference, test;
+            if( !LoadLargeBitmap( largeBitmapFilePairs[i].first, reference ) || !LoadLargeBitmap( largeBitmapFilePairs[i].second, test ) )
+                continue;
+            Compare( reference, test, settings, outResults[i] );
+        }
+    } );
+}
+
+bool vaImageMetrics::LoadLargeBitmap( const wstring & filePath, Image & outImage )
+{
+    VA_TRACE_CPU_SCOPE( vaImageMetrics_LoadLargeBitmap );
+
+    outImage = Image( );
+    shared_ptr<vaLargeBitmapFile> file = vaLargeBitmapFile::Open( filePath, true );
+    if( file == nullptr )
+    {
+        VA_LOG_ERROR( L"vaImageMetrics::LoadLargeBitmap - unable to open '%s'", filePath.c_str( ) );
+        return false;
+    }
+
+    vaResourceFormat format;
+    int bytesPerPixel;
+    switch( file->GetPixelFormat( ) )
+    {
+    case( vaLargeBitmapFile::Format32BitRGBA ):
+    case( vaLargeBitmapFile::Format24BitRGB ):          format = vaResourceFormat::R8G8B8A8_UNORM;  bytesPerPixel = 4;   break;
+    case( vaLargeBitmapFile::Format8BitGrayScale ):     format = vaResourceFormat::R8_UNORM;        bytesPerPixel = 1;   break;
+    case( vaLargeBitmapFile::Format16BitGrayScale ):    format = vaResourceFormat::R16_UNORM;       bytesPerPixel = 2;   break;
+    default:
+        VA_LOG_ERROR( L"vaImageMetrics::LoadLargeBitmap - '%s' has an unsupported pixel format", filePath.c_str( ) );
+        return false;
+    }
+
+    const int width     = file->GetWidth( );
+    const int height    = file->GetHeight( );
+    const int filePitch = width * file->GetBytesPerPixel( );
+    shared_ptr<vector<uint8>> storage = std::make_shared<vector<uint8>>( (size_t)filePitch * height );
+    if( !file->ReadRect( storage->data( ), filePitch, (int64)storage->size( ), 0, 0, width, height ) )
+    {
+        VA_LOG_ERROR( L"vaImageMetrics::LoadLargeBitmap - error reading '%s'", filePath.c_str( ) );
+        return false;
+    }
+
+    // expand RGB to RGBA so that the decoder doesn't need a 24bit path
+    if( file->GetPixelFormat( ) == vaLargeBitmapFile::Format24BitRGB )
+    {
+        shared_ptr<vector<uint8>> expanded = std::make_shared<vector<uint8>>( (size_t)width * height * 4 );
+        const uint8 * src = storage->data( );
+        uint8 * dst = expanded->data( );
+        for( size_t i = 0, count = (size_t)width * height; i < count; i++, src += 3, dst += 4 )
+        {
+            dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255;
+        }
+        storage = expanded;
+    }
+
+    outImage            = Image( storage->data( ), width, height, width * bytesPerPixel, format );
+    outImage.Storage    = storage;
+    return true;
+}
+
+void vaImageMetrics::DecodeRowLinear( const Image & image, int y, float * outRGB )
+{
+    assert( image.IsValid( ) && y >= 0 && y < image.Height );
+    DecodeRow( image, y, false, outRGB );
+    if( vaResourceFormatHelpers::IsSRGB( image.Format ) )
+    {
+        for( int i = 0, count = image.Width * 3; i < count; i++ )
+            outRGB[i] = vaMath::SRGBToLinear( outRGB[i] );
+    }
+}
+
+bool vaImageMetrics::LoadRadianceHDR( const wstring & filePath, Image & outImage )
+{
+    VA_TRACE_CPU_SCOPE( vaImageMetrics_LoadRadianceHDR );
+
+    outImage = Image( );
+    shared_ptr<vaMemoryStream> file = vaFileTools::LoadFileToMemoryStream( filePath );
+    if( file == nullptr )
+    {
+        VA_LOG_ERROR( L"vaImageMetrics::LoadRadianceHDR - unable to open '%s'", filePath.c_str( ) );
+        return false;
+    }
+    const uint8 * data  = file->GetBuffer( );
+    const uint8 * end   = data + file->GetLength( );
+
+    auto readLine = [&]( string & line ) -> bool
+    {
+        line.clear( );
+        while( data < end && *data != '\n' )
+            line += (char)*data++;
+        if( data >= end )
+            return false;
+        data++;
+        return true;
+    };
+
+    // header: magic, 'KEY=value' lines until an empty one, then the resolution string; only the standard
+    // '-Y height +X width' (top-to-bottom, left-to-right) orientation is supported
+    string line;
+    if( !readLine( line ) || ( line.compare( 0, 10, "#?RADIANCE" ) != 0 && line.compare( 0, 6, "#?RGBE" ) != 0 ) )
+    {
+        VA_LOG_ERROR( L"vaImageMetrics::LoadRadianceHDR - '%s' is not a Radiance HDR file", filePath.c_str( ) );
+        return false;
+    }
+    bool formatOK = true;
+    while( readLine( line ) && !line.empty( ) )
+    {
+        if( line.compare( 0, 7, "FORMAT=" ) == 0 && line != "FORMAT=32-bit_rle_rgbe" )
+            formatOK = false;
+    }
+    int width = 0, height = 0;
+    if( !formatOK || !readLine( line ) || sscanf_s( line.c_str( ), "-Y %d +X %d", &height, &width ) != 2 || width <= 0 || height <= 0 )
+    {
+        VA_LOG_ERROR( L"vaImageMetrics::LoadRadianceHDR - '%s' has an unsupported format or orientation", filePath.c_str( ) );
+        return false;
+    }
+
+    shared_ptr<vector<uint8>> storage = std::make_shared<vector<uint8>>( (size_t)width * height * 4 * sizeof( float ) );
+    float * outPixels = (float *)storage->data( );
+    vector<uint8> scanline( (size_t)width * 4 );
+    bool ok = true;
+    for( int y = 0; y < height && ok; y++ )
+    {
+        // new style RLE: 2, 2, width (big endian) followed by the 4 channels, each one run-length encoded separately
+        const bool rle = width >= 8 && width < 0x8000 && ( end - data ) >= 4 && data[0] == 2 && data[1] == 2 && ( ( data[2] << 8 ) | data[3] ) == width;
+        if( rle )
+        {
+            data += 4;
+            for( int c = 0; c < 4 && ok; c++ )
+            {
+                for( int x = 0; x < width && ok; )
+                {
+                    if( data >= end ) { ok = false; break; }
+                    int count = *data++;
+                    const bool run = count > 128;
+                    if( run )
+                        count -= 128;
+                    if( count == 0 || x + count > width || ( end - data ) < ( run ? 1 : count ) ) { ok = false; break; }
+                    for( int i = 0; i < count; i++, x++ )
+                        scanline[x * 4 + c] = ( run ) ? ( data[0] ) : ( data[i] );
+                    data += ( run ) ? ( 1 ) : ( count );
+                }
+            }
+        }
+        else
+        {
+            // flat scanline (old style RLE isn't supported - no current tools write it)
+            if( ( end - data ) < width * 4 ) { ok = false; break; }
+            memcpy( scanline.data( ), data, (size_t)width * 4 );
+            data += width * 4;
+        }
+
+        float * dst = outPixels + (size_t)y * width * 4;
+        for( int x = 0; x < width; x++, dst += 4 )
+        {
+            const uint8 * rgbe = &scanline[x * 4];
+            const float scale = ( rgbe[3] != 0 ) ? ( ::ldexpf( 1.0f, (int)rgbe[3] - ( 128 + 8 ) ) ) : ( 0.0f );
+            dst[0] = rgbe[0] * scale; dst[1] = rgbe[1] * scale; dst[2] = rgbe[2] * scale; dst[3] = 1.0f;
+        }
+    }
+    if( !ok )
+    {
+        VA_LOG_ERROR( L"vaImageMetrics::LoadRadianceHDR - '%s' is truncated or corrupt", filePath.c_str( ) );
+        return false;
+    }
+
+    outImage            = Image( storage->data( ), width, height, width * 4 * (int)sizeof( float ), vaResourceFormat::R32G32B32A32_FLOAT );
+    outImage.Storage    = storage;
+    return true;
+}
@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Core/vaCoreIncludes.h"
+#include "Core/Misc/vaResourceFormats.h"
+
+namespace Vanilla
+{
+    // CPU image quality metrics (MSE/PSNR, SSIM, MS-SSIM and a per-pixel perceptual error map) for comparing rendered
+    // frames against a reference, for ex. when evaluating VRS modes. Works on any CPU-side pixel data (mapped readback
+    // textures, vaLargeBitmapFile images, ...) so it doesn't need the GPU; the work is split into row bands that run on
+    // vaParallel workers with SSE inner loops.
+    //
+    // MSE/PSNR match vaPostProcess::CompareImages: average of the per-channel RGB MSE, values in [0, 1], compared in sRGB
+    // space. 8 and 10 bit UNORM formats are taken as already display (sRGB) encoded; float formats are linear and get
+    // converted to sRGB and saturated first (unless Settings::CompareInSRGB is off).
+    // SSIM/MS-SSIM are computed on Rec.709 luma with the usual 11x11 gaussian window (sigma 1.5) and 5 scale weights
+    // from Wang et al.; only fully covered windows are considered (no border handling).
+    class vaImageMetrics
+    {
+    public:
+        // Description of 2D pixel data; optional Storage keeps the data alive for images that own it (see LoadLargeBitmap)
+        struct Image
+        {
+            const uint8 *                   Data            = nullptr;
+            int                             Width           = 0;
+            int                             Height          = 0;
+            int                             RowPitch        = 0;        // in bytes
+            vaResourceFormat                Format          = vaResourceFormat::Unknown;
+            shared_ptr<vector<uint8>>       Storage;
+
+            Image( ) { }
+            Image( const void * data, int width, int height, int rowPitch, vaResourceFormat format ) : Data( (const uint8 *)data ), Width( width ), Height( height ), RowPitch( rowPitch ), Format( format ) { }
+
+            bool                            IsValid( ) const        { return Data != nullptr && Width > 0 && Height > 0 && IsFormatSupported( Format ); }
+        };
+
+        struct Settings
+        {
+            bool                            CompareInSRGB       = true;
+            bool                            SSIM                = true;
+            bool                            MSSSIM              = true;
+            bool                            PerceptualErrorMap  = false;    // per-pixel CIELAB deltaE (CIE76); also fills MeanDeltaE/MaxDeltaE
+        };
+
+        struct Results
+        {
+            bool                            Valid               = false;
+            double                          MSE                 = 0.0;      // same as vaPostProcess::CompareImages .x
+            double                          PSNR                = 0.0;      // same as vaPostProcess::CompareImages .y
+            double                          MSEPerChannel[3]    = { 0, 0, 0 };
+            double                          SSIM                = -1.0;     // -1 if not computed (disabled or image too small)
+            double                          MSSSIM              = -1.0;     // -1 if not computed (disabled or image too small)
+            int                             MSSSIMScales        = 0;        // can be less than 5 for small images
+            double                          MeanDeltaE          = 0.0;
+            double                          MaxDeltaE           = 0.0;
+            vector<float>                   ErrorMap;                       // Width * Height deltaE values if Settings::PerceptualErrorMap
+            int                             ErrorMapWidth       = 0;
+            int                             ErrorMapHeight      = 0;
+        };
+
+    private:
+        vaImageMetrics( ) { }
+
+    public:
+        static bool                         IsFormatSupported( vaResourceFormat format );
+
+        // images must be of the same size (formats can differ)
+        static bool                         Compare( const Image & reference, const Image & test, const Settings & settings, Results & outResults );
+
+        // compares all pairs, spread across worker threads; outResults[i] belongs to pairs[i]
+        static void                         CompareBatch( const vector<pair<Image, Image>> & pairs, const Settings & settings, vector<Results> & outResults );
+
+        // same as above but loads the images from vaLargeBitmapFile files (loading is also done on the worker threads,
+        // so only a few images are in memory at any time); pairs that fail to load get Valid == false
+        static void                         CompareBatch( const vector<pair<wstring, wstring>> & largeBitmapFilePairs, const Settings & settings, vector<Results> & outResults );
+
+        // loads the whole vaLargeBitmapFile into an Image that owns its data (RGB images get expanded to RGBA)
+        static bool                         LoadLargeBitmap( const wstring & filePath, Image & outImage );
+
+        // loads a Radiance RGBE (.hdr) file (flat or RLE scanlines) into an R32G32B32A32_FLOAT Image that owns its data
+        static bool                         LoadRadianceHDR( const wstring & filePath, Image & outImage );
+
+        // decodes one row into 3 linear floats per pixel (outRGB must hold Width * 3 values); _SRGB formats are converted
+        // to linear, other UNORM formats are taken as-is and float formats are not saturated (negatives and NaNs become 0)
+        static void                         DecodeRowLinear( const Image & image, int y, float * outRGB );
+    };
+}
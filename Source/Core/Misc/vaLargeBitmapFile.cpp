@@ -21,9 +21,13 @@
 
 #include "Core/Misc/vaProfiler.h"
 
+#include "IntegratedExternals/vaZlibIntegration.h"
+
 using namespace Vanilla;
 
-int vaLargeBitmapFile::s_TotalUsedMemory = 0;
+int64                               vaLargeBitmapFile::s_TotalUsedMemory   = 0;
+int64                               vaLargeBitmapFile::s_CacheBudget       = vaLargeBitmapFile::c_DefaultCacheBudget;
+vaLargeBitmapFile::CachedBlockList  vaLargeBitmapFile::s_CachedBlocks;
 
 // for temporary compatibility
 namespace enki
@@ -91,9 +95,8 @@ namespace enki
     };
 }
 
-VA_LBF_THREADSAFE_LINE( mutex vaLargeBitmapFile::s_TotalUsedMemoryMutex; )
+VA_LBF_THREADSAFE_LINE( mutex vaLargeBitmapFile::s_CacheMutex; )
 
-#pragma warning ( suppress: 4505 ) // unreferenced local function has been removed
 static bool CreateNewStorageFile( vaFileStream & fileStream, const wstring & filePath, int64 size )
 {
     if( fileStream.IsOpen( ) )
@@ -144,26 +147,19 @@ static bool CreateNewStorageFile( vaFileStream & fileStream, const wstring & fil
 
 #pragma warning( disable : 4996 )
 
-static void WriteInt32( FILE * file, int val )
+static void WriteInt32( vaFileStream & file, int val )
 {
-    int count = (int)fwrite( &val, 1, sizeof(val), file );
-    assert( count == sizeof(val) );
-    count; // to suppress compiler warning
-    //for( int i = 0; i < 4; i++ )
-    //{
-    //   stream.WriteByte( (byte)( val & 0xFF ) );
-    //   val = val >> 8;
-    //}
+    bool ok = file.WriteValue<int32>( val );
+    assert( ok );
+    ok; // to suppress compiler warning
 }
 
-static int ReadInt32( FILE * file )
+static int ReadInt32( vaFileStream & file )
 {
-    int ret;
-    int count = (int)fread( &ret, 1, sizeof(ret), file );
-    assert( count == sizeof(ret) );
-    count; // to suppress compiler warning
-    //for( int i = 0; i < 4; i++ )
-    //   ret |= stream.ReadByte() << ( 8 * i );
+    int32 ret = 0;
+    bool ok = file.ReadValue<int32>( ret );
+    assert( ok );
+    ok; // to suppress compiler warning
     return ret;
 }
 
@@ -187,23 +183,86 @@ int vaLargeBitmapFile::GetPixelFormatBPP( vaLargeBitmapFile::PixelFormat  pixelF
 }
 
 
-vaLargeBitmapFile::vaLargeBitmapFile( FILE * file, const wstring & filePath, vaLargeBitmapFile::PixelFormat  pixelFormat, int width, int height, int blockDim, bool readOnly )
+static_assert( sizeof( int64 ) + 2 * sizeof( uint32 ) == 16, "BlockIndexEntry is stored in the file and must stay 16 bytes" );
+
+static int ComputeLevelCount( int width, int height, vaLargeBitmapFile::StorageFlags storageFlags )
+{
+    int levelCount = 1;
+    if( ( storageFlags & vaLargeBitmapFile::StorageFlags::MipPyramid ) != 0 )
+    {
+        while( width > 1 || height > 1 )
+        {
+            width   = vaMath::Max( 1, ( width + 1 ) / 2 );
+            height  = vaMath::Max( 1, ( height + 1 ) / 2 );
+            levelCount++;
+        }
+    }
+    return levelCount;
+}
+
+// 2x2 downsample of a whole block into (srcWidth+1)/2 x (srcHeight+1)/2 pixels; odd edges reuse the last row/column
+static void DownsampleBlock( vaLargeBitmapFile::PixelFormat pixelFormat, int bytesPerPixel, const char * src, int srcWidth, int srcHeight, char * dst, int dstPitchInBytes )
+{
+    int dstWidth    = ( srcWidth + 1 ) / 2;
+    int dstHeight   = ( srcHeight + 1 ) / 2;
+    for( int y = 0; y < dstHeight; y++ )
+    {
+        int sy0 = y * 2;
+        int sy1 = vaMath::Min( y * 2 + 1, srcHeight - 1 );
+        for( int x = 0; x < dstWidth; x++ )
+        {
+            int sx0 = x * 2;
+            int sx1 = vaMath::Min( x * 2 + 1, srcWidth - 1 );
+            const uint8 * p00 = (const uint8 *)src + ( sy0 * srcWidth + sx0 ) * bytesPerPixel;
+            const uint8 * p10 = (const uint8 *)src + ( sy0 * srcWidth + sx1 ) * bytesPerPixel;
+            const uint8 * p01 = (const uint8 *)src + ( sy1 * srcWidth + sx0 ) * bytesPerPixel;
+            const uint8 * p11 = (const uint8 *)src + ( sy1 * srcWidth + sx1 ) * bytesPerPixel;
+            uint8 * d = (uint8 *)dst + y * dstPitchInBytes + x * bytesPerPixel;
+
+            switch( pixelFormat )
+            {
+            case( vaLargeBitmapFile::Format8BitGrayScale ):
+            case( vaLargeBitmapFile::Format24BitRGB ):
+            case( vaLargeBitmapFile::Format32BitRGBA ):
+                for( int c = 0; c < bytesPerPixel; c++ )
+                    d[c] = (uint8)( ( (int)p00[c] + p10[c] + p01[c] + p11[c] + 2 ) / 4 );
+                break;
+            case( vaLargeBitmapFile::Format16BitGrayScale ):
+                *(uint16*)d = (uint16)( ( (int)*(const uint16*)p00 + *(const uint16*)p10 + *(const uint16*)p01 + *(const uint16*)p11 + 2 ) / 4 );
+                break;
+            case( vaLargeBitmapFile::Format16BitA4R4G4B4 ):
+            {
+                uint16 a = *(const uint16*)p00, b = *(const uint16*)p10, c = *(const uint16*)p01, e = *(const uint16*)p11;
+                uint16 result = 0;
+                for( int shift = 0; shift < 16; shift += 4 )
+                    result |= (uint16)( ( ( ( ( a >> shift ) & 0xF ) + ( ( b >> shift ) & 0xF ) + ( ( c >> shift ) & 0xF ) + ( ( e >> shift ) & 0xF ) + 2 ) / 4 ) << shift );
+                *(uint16*)d = result;
+            } break;
+            default:
+                // FormatGenericXXX - no idea what's in there so just point sample
+                memcpy( d, p00, bytesPerPixel );
+                break;
+            }
+        }
+    }
+}
+
+vaLargeBitmapFile::vaLargeBitmapFile( const shared_ptr<vaFileStream> & file, const wstring & filePath, vaLargeBitmapFile::PixelFormat  pixelFormat, int width, int height, int blockDim, bool readOnly, bool memoryMap, int version, StorageFlags storageFlags )
 {
     VA_LBF_THREADSAFE_LINE( std::unique_lock<std::shared_mutex> lock( m_GlobalMutex ); )
     m_filePath          = filePath;
     m_File              = file;
+    m_MappedData        = nullptr;
+    m_DirectMapped      = false;
     m_PixelFormat       = pixelFormat;
     m_Width             = width;
     m_Height            = height;
     m_BlockDim          = blockDim;
     m_ReadOnly          = readOnly;
+    m_Version           = version;
+    m_StorageFlags      = ( version >= 2 ) ? ( storageFlags ) : ( StorageFlags::None );
     m_BytesPerPixel     = vaLargeBitmapFile::GetPixelFormatBPP( pixelFormat );
-    m_UsedMemory        = 0;
-
-    m_BlocksX           = ( width - 1 ) / blockDim + 1;
-    m_BlocksY           = ( height - 1 ) / blockDim + 1;
-    m_EdgeBlockWidth    = width - ( m_BlocksX - 1 ) * blockDim;
-    m_EdgeBlockHeight   = height - ( m_BlocksY - 1 ) * blockDim;
+    m_MipsDirty         = false;
 
     if( ( ( blockDim - 1 ) & blockDim ) != 0 ) 
     {
@@ -214,27 +273,90 @@ vaLargeBitmapFile::vaLargeBitmapFile( FILE * file, const wstring & filePath, vaL
     m_BlockDimBits = 0; int a = blockDim;
     while( a > 1 ) { m_BlockDimBits++; a /= 2; }
 
-    // this storage is a bit weird, but that's the way I built it initially so there it is
-    m_BigDataBlocksArray = new DataBlock[m_BlocksX*m_BlocksY];
-    m_DataBlocks = new DataBlock*[m_BlocksX];
-    for( int x = 0; x < m_BlocksX; x++ )
+    int levelWidth = width, levelHeight = height;
+    int indexEntryCount = 0;
+    m_Levels.resize( ComputeLevelCount( width, height, m_StorageFlags ) );
+    for( MipLevel & level : m_Levels )
     {
-        m_DataBlocks[x] = &m_BigDataBlocksArray[m_BlocksY * x];
-        for( int y = 0; y < m_BlocksY; y++ )
+        level.Width             = levelWidth;
+        level.Height            = levelHeight;
+        level.BlocksX           = ( levelWidth - 1 ) / blockDim + 1;
+        level.BlocksY           = ( levelHeight - 1 ) / blockDim + 1;
+        level.EdgeBlockWidth    = levelWidth - ( level.BlocksX - 1 ) * blockDim;
+        level.EdgeBlockHeight   = levelHeight - ( level.BlocksY - 1 ) * blockDim;
+        level.FirstIndexEntry   = indexEntryCount;
+        indexEntryCount += level.BlocksX * level.BlocksY;
+
+        // this storage is a bit weird, but that's the way I built it initially so there it is
+        level.BigDataBlocksArray = new DataBlock[level.BlocksX*level.BlocksY];
+        level.DataBlocks = new DataBlock*[level.BlocksX];
+        for( int x = 0; x < level.BlocksX; x++ )
         {
-        m_DataBlocks[x][y].pData = 0;
-        m_DataBlocks[x][y].Width = (unsigned short)( ( x == ( m_BlocksX - 1 ) ) ? ( m_EdgeBlockWidth ) : ( blockDim ) );
-        m_DataBlocks[x][y].Height = (unsigned short)( ( y == ( m_BlocksY - 1 ) ) ? ( m_EdgeBlockHeight ) : ( blockDim ) );
-        m_DataBlocks[x][y].Modified = false;
+            level.DataBlocks[x] = &level.BigDataBlocksArray[level.BlocksY * x];
+            for( int y = 0; y < level.BlocksY; y++ )
+            {
+            level.DataBlocks[x][y].pData = 0;
+            level.DataBlocks[x][y].Width = (unsigned short)( ( x == ( level.BlocksX - 1 ) ) ? ( level.EdgeBlockWidth ) : ( blockDim ) );
+            level.DataBlocks[x][y].Height = (unsigned short)( ( y == ( level.BlocksY - 1 ) ) ? ( level.EdgeBlockHeight ) : ( blockDim ) );
+            level.DataBlocks[x][y].Modified = false;
+            level.DataBlocks[x][y].Referenced = false;
+            }
         }
+
+        levelWidth  = vaMath::Max( 1, ( levelWidth + 1 ) / 2 );
+        levelHeight = vaMath::Max( 1, ( levelHeight + 1 ) / 2 );
     }
-    // tempBuffer = new byte[BytesPerPixel * BlockDim * BlockDim];
 
-    VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> fileAccessMutex( m_fileAccessMutex ); )
-    _fseeki64( m_File, c_TotalHeaderSize, SEEK_SET );
+    // version 2 block index follows the header; a freshly created file doesn't have it yet
+    if( m_Version >= 2 )
+    {
+        m_BlockIndex.resize( indexEntryCount );
+        int64 indexSize = (int64)indexEntryCount * sizeof( BlockIndexEntry );
+        int64 fileLength = m_File->GetLength( );
+        if( fileLength >= c_TotalHeaderSize + indexSize )
+        {
+            if( !m_File->ReadAt( c_TotalHeaderSize, m_BlockIndex.data( ), indexSize ) )
+            {
+                assert( false );
+                VA_LOG_ERROR( L"vaLargeBitmapFile - error reading block index from '%s'", filePath.c_str() );
+            }
+        }
+        else
+        {
+            assert( !readOnly );
+            memset( m_BlockIndex.data( ), 0, indexSize );
+            m_File->WriteAt( c_TotalHeaderSize, m_BlockIndex.data( ), indexSize );
+        }
+        m_FileEnd = vaMath::Max( fileLength, c_TotalHeaderSize + indexSize );
+    }
+    else
+        m_FileEnd = m_File->GetLength( );
+
+    if( readOnly && memoryMap )
+    {
+        m_MappedData = (const char *)m_File->MapForReading( );
+        if( m_MappedData != nullptr )
+        {
+            // version 0/1 blocks are stored raw and contiguously so they can all just point into the view and never 
+            // need loading (the OS does the caching); version 2 blocks still get loaded (decompressed) from the view 
+            if( m_Version < 2 )
+            {
+                m_DirectMapped = true;
+                for( int x = 0; x < m_Levels[0].BlocksX; x++ )
+                    for( int y = 0; y < m_Levels[0].BlocksY; y++ )
+                        m_Levels[0].DataBlocks[x][y].pData = const_cast<char*>( m_MappedData + GetBlockStartPos( x, y ) );
+            }
+        }
+        else
+            VA_LOG( L"vaLargeBitmapFile - unable to memory map '%s', using the block cache instead", filePath.c_str() );
+    }
 
     m_AsyncOpRunningCount = 0;
 
+    m_PrefetchEnabled   = true;
+    m_PrefetchInFlight  = false;
+    for( int i = 0; i < _countof( m_LastReadBlocks ); i++ )
+        m_LastReadBlocks[i] = -1;
 }
 
 vaLargeBitmapFile::~vaLargeBitmapFile()
@@ -242,7 +364,7 @@ vaLargeBitmapFile::~vaLargeBitmapFile()
     Close();
 }
 
-shared_ptr<vaLargeBitmapFile> vaLargeBitmapFile::Create( const wstring & filePath, vaLargeBitmapFile::PixelFormat  pixelFormat, int width, int height )
+shared_ptr<vaLargeBitmapFile> vaLargeBitmapFile::Create( const wstring & filePath, vaLargeBitmapFile::PixelFormat  pixelFormat, int width, int height, StorageFlags storageFlags )
 {
     int bytesPerPixel = GetPixelFormatBPP( pixelFormat );
     if( bytesPerPixel < 0 || bytesPerPixel > 8 ) 
@@ -252,89 +374,95 @@ shared_ptr<vaLargeBitmapFile> vaLargeBitmapFile::Create( const wstring & filePat
         return nullptr;
     }
 
-    FILE * file = _wfopen( filePath.c_str(), L"w+b" ); // File.Open( path, FileMode.Create, FileAccess.ReadWrite, FileShare.None );
-    if( file == 0 )
+    // version 1 files get pre-allocated and initialized to zero; version 2 only has the header at this point, the
+    // block index gets created by the constructor and the blocks are added as they get written
+    int version = ( storageFlags == 0 ) ? ( 1 ) : ( c_FormatVersion );
+    int64 fileSize = c_TotalHeaderSize;
+    if( version == 1 )
+        fileSize += (int64)bytesPerPixel * width * height;
+
+    shared_ptr<vaFileStream> file = std::make_shared<vaFileStream>( );
+    if( !CreateNewStorageFile( *file, filePath, fileSize ) )
     {
         VA_LOG( "vaLargeBitmapFile::Create failed, error creating file" );
         return nullptr;
     }
 
-    // pre-allocate file and initialize to zero
-    int64 fileSize = (int64)bytesPerPixel * width * height + c_TotalHeaderSize;
-    int64 remainingSize = fileSize;
-    byte allZeroes[ 1024 * 32 ];
-    memset( allZeroes, 0, sizeof(allZeroes) );
-    while( remainingSize > 0 )
-    {
-        int toWrite = vaMath::Min( (int)remainingSize, (int)sizeof( allZeroes ) );
-        int count = (int)fwrite( &allZeroes, 1, toWrite, file );
-        if( count != toWrite )
-        {
-            VA_LOG( "vaLargeBitmapFile::CreateNewStorageFile failed, error initializing file" );
-            fclose( file );
-            return nullptr;
-        }
-        remainingSize -= sizeof(allZeroes);
-    }
-
-    _fseeki64( file, fileSize-1, SEEK_SET );
-    char dummy = 0;
-    fwrite( &dummy, 1, 1, file );
-
-    _fseeki64( file, 0, SEEK_SET );
+    file->Seek( 0 );
 
-    WriteInt32( file, (int)pixelFormat );
-    WriteInt32( file, width );
-    WriteInt32( file, height );
+    WriteInt32( *file, (int)pixelFormat );
+    WriteInt32( *file, width );
+    WriteInt32( *file, height );
 
     int blockDim = 256;
 
-    int version = c_FormatVersion;
-    WriteInt32( file, version );
-    WriteInt32( file, blockDim );
+    WriteInt32( *file, version );
+    WriteInt32( *file, blockDim );
 
-    int64 pos = _ftelli64(file);
-    for( ; pos < c_TotalHeaderSize; pos++ )
-        fwrite( &dummy, 1, 1, file );
+    if( version >= 2 )
+    {
+        WriteInt32( *file, (int)storageFlags );
+        WriteInt32( *file, ComputeLevelCount( width, height, storageFlags ) );
+    }
 
-    return shared_ptr<vaLargeBitmapFile>( new vaLargeBitmapFile( file, filePath, pixelFormat, width, height, blockDim, false ) );
+    // rest of the header is already zeroed
+
+    return shared_ptr<vaLargeBitmapFile>( new vaLargeBitmapFile( file, filePath, pixelFormat, width, height, blockDim, false, false, version, storageFlags ) );
 }
 
-shared_ptr<vaLargeBitmapFile> vaLargeBitmapFile::Open( const wstring & filePath, bool readOnly )
+shared_ptr<vaLargeBitmapFile> vaLargeBitmapFile::Open( const wstring & filePath, bool readOnly, bool memoryMap )
 {
-    FILE * file;
+    shared_ptr<vaFileStream> file = std::make_shared<vaFileStream>( );
+    bool opened;
     if( readOnly )
-        file = _wfopen(filePath.c_str(), L"rb"); // File.Open( path, FileMode.Open, FileAccess.Read, FileShare.Read );
+        opened = file->Open( filePath, FileCreationMode::Open, FileAccessMode::Read, FileShareMode::Read );
     else
-        file = _wfopen(filePath.c_str(), L"r+b"); // File.Open( path, FileMode.Open, FileAccess.ReadWrite, FileShare.None );
+        opened = file->Open( filePath, FileCreationMode::Open, FileAccessMode::ReadWrite, FileShareMode::None );
 
-    if( file == 0 )
+    if( !opened )
     {
         VA_LOG( "vaLargeBitmapFile::Open failed, error opening file" );
         return nullptr;
     }
 
-    vaLargeBitmapFile::PixelFormat  pixelFormat = (vaLargeBitmapFile::PixelFormat )ReadInt32( file );
+    vaLargeBitmapFile::PixelFormat  pixelFormat = (vaLargeBitmapFile::PixelFormat )ReadInt32( *file );
     int bytesPerPixel =  GetPixelFormatBPP( pixelFormat );
-    int width         = ReadInt32( file );
-    int height        = ReadInt32( file );
-    int version       = ReadInt32( file );
+    int width         = ReadInt32( *file );
+    int height        = ReadInt32( *file );
+    int version       = ReadInt32( *file );
+
+    if( version > c_FormatVersion )
+    {
+        VA_LOG_ERROR( L"vaLargeBitmapFile::Open failed, '%s' is format version %d and only up to %d is supported", filePath.c_str(), version, c_FormatVersion );
+        return nullptr;
+    }
 
     int blockDim = 128;
     if( version > 0 )
-        blockDim = ReadInt32( file );
+        blockDim = ReadInt32( *file );
 
-    int64 current = _ftelli64(file);
-    _fseeki64(file, 0, SEEK_END);
-    int64 filelength = _ftelli64(file);
-    _fseeki64(file, current, SEEK_SET);
-      
-    if( ( (int64)bytesPerPixel * width * height + c_TotalHeaderSize ) != filelength )
+    StorageFlags storageFlags = StorageFlags::None;
+    if( version >= 2 )
     {
-        assert( false ); // file is probably corrupt
+        storageFlags = (StorageFlags)ReadInt32( *file );
+        int levelCount = ReadInt32( *file );
+        if( levelCount != ComputeLevelCount( width, height, storageFlags ) )
+        {
+            assert( false ); // file is probably corrupt
+            VA_LOG_ERROR( L"vaLargeBitmapFile::Open failed, '%s' has unexpected mip level count", filePath.c_str() );
+            return nullptr;
+        }
+    }
+    else
+    {
+        int64 filelength = file->GetLength( );
+        if( ( (int64)bytesPerPixel * width * height + c_TotalHeaderSize ) != filelength )
+        {
+            assert( false ); // file is probably corrupt
+        }
     }
 
-    return shared_ptr<vaLargeBitmapFile>( new vaLargeBitmapFile( file, filePath, pixelFormat, width, height, blockDim, readOnly ) );
+    return shared_ptr<vaLargeBitmapFile>( new vaLargeBitmapFile( file, filePath, pixelFormat, width, height, blockDim, readOnly, memoryMap, version, storageFlags ) );
 }
 
 void vaLargeBitmapFile::Close()
@@ -343,226 +471,473 @@ void vaLargeBitmapFile::Close()
 
     VA_LBF_THREADSAFE_LINE( std::unique_lock<std::shared_mutex> lock( m_GlobalMutex ); )
 
-    if( m_File == 0 ) 
+    // no new ReadRect-s (and so no new prefetches) can start now; the prefetch doesn't take m_GlobalMutex so it's safe to wait here
+    while( m_PrefetchInFlight.load( ) )
+        vaThreading::Sleep( 1 );
+
+    if( m_File == nullptr ) 
     {
-        assert( m_UsedMemory == 0 );
-        assert( m_DataBlocks == nullptr );
-        assert( m_BigDataBlocksArray == nullptr );
+        assert( m_Levels.empty( ) );
         return;
     }
 
-// #define TRACK_BLOCKS
-#ifdef TRACK_BLOCKS
-    int dataBlocksTotal     = 0;
-    int usedMemoryBefore    = 0;
-    int releasedBlocks      = 0;
-    {
-        VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> usedMemoryMutexLock( m_UsedMemoryMutex ); )
-        dataBlocksTotal = m_BlocksX * m_BlocksY;
-        usedMemoryBefore = m_UsedMemory;
-    }
-#endif
+    // after this only the last level can have modified blocks and those don't generate any further updates
+    if( !m_ReadOnly )
+        UpdateMipsInternal( );
 
-    if( m_DataBlocks )
+    for( int levelIndex = 0; levelIndex < (int)m_Levels.size( ); levelIndex++ )
     {
-        for( int x = 0; x < m_BlocksX; x++ )
+        MipLevel & level = m_Levels[levelIndex];
+        for( int x = 0; x < level.BlocksX; x++ )
         {
-            for( int y = 0; y < m_BlocksY; y++ )
+            for( int y = 0; y < level.BlocksY; y++ )
             { 
-                DataBlock & db = m_DataBlocks[x][y];
+                DataBlock & db = level.DataBlocks[x][y];
                 VA_LBF_THREADSAFE_LINE( std::unique_lock<std::shared_mutex> uniqueBlockLock( db.Mutex ); )
-                if( m_DataBlocks[x][y].pData != 0 ) 
+                if( m_DirectMapped )
+                {
+                    db.pData = 0;
+                    continue;
+                }
+                if( db.pData != 0 ) 
                 {
-#ifdef TRACK_BLOCKS
-                    releasedBlocks++;
-#endif
-                    ReleaseBlock( x, y ); 
                     {
-                        int blockSize = db.Width * db.Height * m_BytesPerPixel;
-                        VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> usedMemoryMutexLock( m_UsedMemoryMutex ); )
-                        m_UsedMemory -= blockSize;
-
-                        {
-                            VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> totalUsedMemoryMutexLock( s_TotalUsedMemoryMutex ); )
-                            s_TotalUsedMemory -= blockSize;
-                        }
+                        VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> cacheLock( s_CacheMutex ); )
+                        s_TotalUsedMemory -= db.CacheEntry->Size;
+                        s_CachedBlocks.erase( db.CacheEntry );
                     }
+                    ReleaseBlock( levelIndex, x, y ); 
                 }
             }
         }
-        delete[] m_DataBlocks;
-        delete[] m_BigDataBlocksArray;
-        m_DataBlocks = nullptr;
-        m_BigDataBlocksArray = nullptr;
+        delete[] level.DataBlocks;
+        delete[] level.BigDataBlocksArray;
+        level.DataBlocks = nullptr;
+        level.BigDataBlocksArray = nullptr;
+    }
+    m_Levels.clear( );
+    m_BlockIndex.clear( );
+    {
+        std::unique_lock<mutex> pendingLock( m_PendingMipUpdatesMutex );
+        m_PendingMipUpdates.clear( );
     }
 
-    VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> fileAccessMutex( m_fileAccessMutex ); )
-    fclose( m_File );
-    m_File = 0;
+    m_MappedData = nullptr;
+    m_DirectMapped = false;
+    m_File->Close( );
+    m_File = nullptr;
+}
+
+void vaLargeBitmapFile::SetGlobalCacheBudget( int64 budgetInBytes )
+{
     {
-        VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> usedMemoryMutexLock( m_UsedMemoryMutex ); )
-        assert( m_UsedMemory == 0 );
-        m_UsedBlocks.clear();
+        VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> cacheLock( s_CacheMutex ); )
+        s_CacheBudget = vaMath::Max( budgetInBytes, (int64)0 );
+    }
+    EvictBlocks( 0 );
+}
+
+int64 vaLargeBitmapFile::GetGlobalCacheBudget( )
+{
+    VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> cacheLock( s_CacheMutex ); )
+    return s_CacheBudget;
+}
+
+int64 vaLargeBitmapFile::GetGlobalCacheUsedMemory( )
+{
+    VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> cacheLock( s_CacheMutex ); )
+    return s_TotalUsedMemory;
+}
+
+void vaLargeBitmapFile::EvictBlocks( int64 bytesNeeded )
+{
+    // blocks are picked while holding the cache lock but released (and saved if modified) after it's dropped, so 
+    // disk writes don't block other threads' cache access
+    struct Victim
+    {
+        vaLargeBitmapFile *                     File;
+        int                                     Level;
+        int                                     Bx;
+        int                                     By;
+        VA_LBF_THREADSAFE_LINE( std::unique_lock<std::shared_mutex> Lock; )
+    };
+    vector<Victim> victims;
+
+    {
+        VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> cacheLock( s_CacheMutex ); )
+
+        int64 toFree = s_TotalUsedMemory + bytesNeeded - s_CacheBudget;
+
+        // every block gets at most one 'second chance' so this is bounded; in-use blocks (locked by someone else, 
+        // including the block being loaded by the caller) are skipped
+        size_t tryCount = 0;
+        const size_t maxTries = s_CachedBlocks.size( ) * 2;
+        while( (toFree > 0) && !s_CachedBlocks.empty( ) && (tryCount < maxTries) )
+        {
+            tryCount++;
+            CachedBlockList::iterator it = std::prev( s_CachedBlocks.end( ) );
+            DataBlock & db = it->File->GetBlock( it->Level, it->Bx, it->By );
+
+            if( db.Referenced.exchange( false ) )
+            {
+                s_CachedBlocks.splice( s_CachedBlocks.begin( ), s_CachedBlocks, it );
+                continue;
+            }
+#ifdef VA_LBF_THREADSAFE
+            std::unique_lock<std::shared_mutex> blockLock( db.Mutex, std::try_to_lock );
+            if( !blockLock.owns_lock( ) )
+            {
+                s_CachedBlocks.splice( s_CachedBlocks.begin( ), s_CachedBlocks, it );
+                continue;
+            }
+#endif
+            toFree              -= it->Size;
+            s_TotalUsedMemory   -= it->Size;
+            Victim victim = { it->File, it->Level, it->Bx, it->By };
+            VA_LBF_THREADSAFE_LINE( victim.Lock = std::move( blockLock ); )
+            victims.push_back( std::move( victim ) );
+            s_CachedBlocks.erase( it );
+        }
+        // can't remove enough? too small budget or everything's in use - just go over budget then
     }
-    assert( m_DataBlocks == nullptr );
-    assert( m_BigDataBlocksArray == nullptr );
+
+    for( Victim & victim : victims )
+        victim.File->ReleaseBlock( victim.Level, victim.Bx, victim.By );
 }
 
-void vaLargeBitmapFile::ReleaseBlock( int bx, int by )
+void vaLargeBitmapFile::ReleaseBlock( int level, int bx, int by )
 {
-    DataBlock & db = m_DataBlocks[bx][by];
+    DataBlock & db = GetBlock( level, bx, by );
     if( db.pData == 0 ) 
     {
         assert( false ); // "block not loaded"
         VA_ERROR( "block not loaded" );
     }
+    assert( !m_DirectMapped );
 
     if( db.Modified ) 
-        SaveBlock( bx, by );
+        SaveBlock( level, bx, by );
 
     free( db.pData );
     db.Modified = false;
     db.pData = 0;
 }
 
-// #include <sstream>
-
-void vaLargeBitmapFile::LoadBlock( int bx, int by, bool skipFileRead )
+bool vaLargeBitmapFile::LoadBlock( int level, int bx, int by, bool skipFileRead, bool noEvict )
 {
-    DataBlock & db = m_DataBlocks[bx][by];
+    DataBlock & db = GetBlock( level, bx, by );
     if( db.pData != 0 ) 
     {
         assert( false ); // "Block already loaded"
         VA_ERROR( "block already loaded" );
     }
+    assert( !m_DirectMapped );
 
-    // std::stringstream ss;
-    // ss << std::this_thread::get_id();
-    // string threadID = ss.str();
-    // VA_LOG( "Loading block %d, %d, this: %llx, thread: %s", bx, by, this, threadID.c_str() );
+    int blockSize = db.Width * db.Height * m_BytesPerPixel;
 
-    //load
+    if( noEvict )
     {
-        VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> usedMemoryMutexLock( m_UsedMemoryMutex ); )
-        int tryCount = 0;
-        while( (m_UsedMemory > c_MemoryLimit) && (m_UsedBlocks.size() > 0) )
+        // budget check and reservation under the same lock so that concurrent loads can't push it over
+        VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> cacheLock( s_CacheMutex ); )
+        if( s_TotalUsedMemory + blockSize > s_CacheBudget )
+            return false;
+        s_TotalUsedMemory += blockSize;
+    }
+    else
+    {
+        // make room first
+        EvictBlocks( blockSize );
+    }
+
+    assert( db.pData == nullptr );
+    db.pData = (char*)malloc( blockSize );
+
+    if( !skipFileRead )
+    {
+        if( m_Version < 2 )
         {
-            DataBlockID dbid = (DataBlockID)m_UsedBlocks.back();
-            if( tryCount > (int)m_UsedBlocks.size() )
+            assert( level == 0 );
+            // positional read, no file lock needed
+            if( !m_File->ReadAt( GetBlockStartPos( bx, by ), db.pData, blockSize ) )
             {
-                // can't remove any? too small memory limit then, drop out
                 assert( false );
-                break;
             }
-        
-            if( (dbid.Bx == bx) && (dbid.By == by) )
-            {
-                // skip ourselves
-                m_UsedBlocks.pop_back();
-                m_UsedBlocks.push_front( dbid );
-                tryCount++;
-                continue;
-            }
-        
-            DataBlock & blockToRelease = m_DataBlocks[dbid.Bx][dbid.By];
-            #ifdef VA_LBF_THREADSAFE
-            std::unique_lock<std::shared_mutex> uniqueBlockLock( blockToRelease.Mutex, std::defer_lock ); 
-            if( !uniqueBlockLock.try_lock() )
-            {
-                // ok drop it for now and try another
-                m_UsedBlocks.pop_back();
-                m_UsedBlocks.push_front( dbid );
-                tryCount++;
-                continue;
-            }
-            #endif
-
-            // VA_LOG( "Releasing block %d, %d, this: %llx, thread: %s", dbid.Bx, dbid.By, this, threadID.c_str() );
-            ReleaseBlock( dbid.Bx, dbid.By );
+        }
+        else
+        {
+            const BlockIndexEntry & entry = GetBlockIndexEntry( level, bx, by );
+            if( entry.Offset == 0 )
+                memset( db.pData, 0, blockSize );   // never written
+            else
             {
-                int removedBlockSize = blockToRelease.Width * blockToRelease.Height * m_BytesPerPixel;
-                m_UsedMemory -= removedBlockSize;
+                static thread_local vector<char> readBuffer;
+                const char * storedData;
+                if( m_MappedData != nullptr )
+                    storedData = m_MappedData + entry.Offset;
+                else
+                {
+                    readBuffer.resize( entry.StoredSize );
+                    if( !m_File->ReadAt( entry.Offset, readBuffer.data( ), entry.StoredSize ) )
+                    {
+                        assert( false );
+                    }
+                    storedData = readBuffer.data( );
+                }
 
+                if( entry.StoredSize == (uint32)blockSize )
+                    memcpy( db.pData, storedData, blockSize );
+                else
                 {
-                    VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> totalUsedMemoryMutexLock( s_TotalUsedMemoryMutex ); )
-                    s_TotalUsedMemory -= removedBlockSize;
+                    Zlib::uLongf decompressedSize = (Zlib::uLongf)blockSize;
+                    if( Zlib::uncompress( (Zlib::Bytef *)db.pData, &decompressedSize, (const Zlib::Bytef *)storedData, (Zlib::uLong)entry.StoredSize ) != Z_OK || decompressedSize != (Zlib::uLongf)blockSize )
+                    {
+                        assert( false );
+                        VA_LOG_ERROR( L"vaLargeBitmapFile - error decompressing block (%d, %d, level %d) from '%s'", bx, by, level, m_filePath.c_str() );
+                        memset( db.pData, 0, blockSize );
+                    }
                 }
             }
-            m_UsedBlocks.pop_back();
         }
     }
+    db.Modified     = false;
+    db.Referenced   = false;
 
-    int blockSize = db.Width * db.Height * m_BytesPerPixel;
-
-    assert( db.pData == nullptr );
-    db.pData = (char*)malloc( blockSize );
-
-    if( !skipFileRead )
     {
-        VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> fileAccessMutex( m_fileAccessMutex ); )
-      
-        _fseeki64( m_File, GetBlockStartPos( bx, by ), SEEK_SET );
-        if( (int)fread( db.pData, 1, blockSize, m_File ) != blockSize )
-        {
-            assert( false );
-        }
+        VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> cacheLock( s_CacheMutex ); )
+        s_CachedBlocks.push_front( { this, level, bx, by, blockSize } );
+        db.CacheEntry = s_CachedBlocks.begin( );
+        if( !noEvict )
+            s_TotalUsedMemory += blockSize;
     }
-    db.Modified = false;
-    // VA_LOG( "Block %d, %d loaded, this: %llx, thread: %s", bx, by, this, threadID.c_str() );
+    return true;
+}
 
+void vaLargeBitmapFile::SaveBlock( int level, int bx, int by )
+{
+    DataBlock & db = GetBlock( level, bx, by );
+    if( db.pData == 0 )
     {
-        VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> usedMemoryMutexLock( m_UsedMemoryMutex ); )
+        assert( false ); // "block not loaded"
+        VA_ERROR( "block not loaded" );
+    }
 
-        for( int i = 0; i < m_UsedBlocks.size(); i++ )
+    int blockSize = db.Width * db.Height * m_BytesPerPixel;
+
+    bool ok;
+    if( m_Version < 2 )
+    {
+        assert( level == 0 );
+        ok = m_File->WriteAt( GetBlockStartPos( bx, by ), db.pData, blockSize );
+    }
+    else
+    {
+        const char * storeData = db.pData;
+        uint32 storeSize = (uint32)blockSize;
+        static thread_local vector<Zlib::Bytef> compressBuffer;
+        if( IsCompressed( ) )
         {
-            if( (m_UsedBlocks[i].Bx == bx) && (m_UsedBlocks[i].By == by) )
+            Zlib::uLongf compressedSize = Zlib::compressBound( (Zlib::uLong)blockSize );
+            compressBuffer.resize( compressedSize );
+            if( Zlib::compress2( compressBuffer.data( ), &compressedSize, (const Zlib::Bytef *)db.pData, (Zlib::uLong)blockSize, Z_BEST_SPEED ) == Z_OK && compressedSize < (Zlib::uLongf)blockSize )
             {
-                assert( false );
+                storeData = (const char *)compressBuffer.data( );
+                storeSize = (uint32)compressedSize;
             }
         }
 
-        m_UsedBlocks.push_front( DataBlockID( bx, by ) );
-        m_UsedMemory += blockSize;
-    
+        // rewrite in place if it fits, otherwise append (with a bit of slack for compressed blocks that grow later)
+        BlockIndexEntry & entry = GetBlockIndexEntry( level, bx, by );
+        if( entry.Offset == 0 || storeSize > entry.Capacity )
         {
-            VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> totalUsedMemoryMutexLock( s_TotalUsedMemoryMutex ); )
-            s_TotalUsedMemory += blockSize;
+            entry.Capacity  = vaMath::Min( (uint32)blockSize, storeSize + storeSize / 8 );
+            entry.Offset    = m_FileEnd.fetch_add( entry.Capacity );
         }
-    }
-}
+        entry.StoredSize = storeSize;
 
-void vaLargeBitmapFile::SaveBlock( int bx, int by )
-{
-    DataBlock & db = m_DataBlocks[bx][by];
-    if( db.pData == 0 )
+        int64 entryPos = c_TotalHeaderSize + (int64)( &entry - m_BlockIndex.data( ) ) * sizeof( BlockIndexEntry );
+        ok = m_File->WriteAt( entry.Offset, storeData, storeSize );
+        ok &= m_File->WriteAt( entryPos, &entry, sizeof( entry ) );
+    }
+    if( !ok )
     {
-        assert( false ); // "block not loaded"
-        VA_ERROR( "block not loaded" );
+        assert( false );
+        VA_LOG_ERROR( L"vaLargeBitmapFile - error writing block to '%s'", m_filePath.c_str() );
     }
-
-    int blockSize = db.Width * db.Height * m_BytesPerPixel;
-      
-    VA_LBF_THREADSAFE_LINE( std::unique_lock<mutex> fileAccessMutex( m_fileAccessMutex ); )
-    _fseeki64( m_File, GetBlockStartPos( bx, by ), SEEK_SET );
-    fwrite( db.pData, 1, blockSize, m_File );
     db.Modified = false;
+
+    QueueMipUpdate( level, bx, by );
 }
 
 int64 vaLargeBitmapFile::GetBlockStartPos( int bx, int by )
 {
+    assert( m_Version < 2 );
+    const MipLevel & level = m_Levels[0];
     int64 pos = c_TotalHeaderSize;
 
-    pos += (int64)by * ( m_BlocksX - 1 ) * ( (int64)m_BlockDim * m_BlockDim * m_BytesPerPixel );
-    pos += (int64)by * ( (int64)m_BlockDim * m_EdgeBlockWidth * m_BytesPerPixel );
+    pos += (int64)by * ( level.BlocksX - 1 ) * ( (int64)m_BlockDim * m_BlockDim * m_BytesPerPixel );
+    pos += (int64)by * ( (int64)m_BlockDim * level.EdgeBlockWidth * m_BytesPerPixel );
 
-    if( by == ( m_BlocksY - 1 ) )
-        pos += ( (int64)bx ) * ( (int64)m_BlockDim * m_EdgeBlockHeight * m_BytesPerPixel );
+    if( by == ( level.BlocksY - 1 ) )
+        pos += ( (int64)bx ) * ( (int64)m_BlockDim * level.EdgeBlockHeight * m_BytesPerPixel );
     else
         pos += ( (int64)bx ) * ( (int64)m_BlockDim * m_BlockDim * m_BytesPerPixel );
 
     return pos;
 }
 
+void vaLargeBitmapFile::QueueMipUpdate( int level, int bx, int by )
+{
+    if( !HasMips( ) || ( level + 1 ) >= (int)m_Levels.size( ) )
+        return;
+
+    // the block's downsampled contents go into one quadrant of the block above it (block dimensions are powers of 
+    // two so 2x2 footprints never straddle blocks); the parent isn't touched here as the caller is holding locks
+    const DataBlock & db = GetBlock( level, bx, by );
+    PendingMipUpdate update;
+    update.Level    = level + 1;
+    update.Bx       = bx / 2;
+    update.By       = by / 2;
+    update.OffsetX  = ( bx % 2 ) * ( m_BlockDim / 2 );
+    update.OffsetY  = ( by % 2 ) * ( m_BlockDim / 2 );
+    update.Width    = ( db.Width + 1 ) / 2;
+    update.Height   = ( db.Height + 1 ) / 2;
+    update.Data.resize( (size_t)update.Width * update.Height * m_BytesPerPixel );
+    DownsampleBlock( m_PixelFormat, m_BytesPerPixel, db.pData, db.Width, db.Height, update.Data.data( ), update.Width * m_BytesPerPixel );
+
+    int64 key = ( (int64)level << 48 ) | ( (int64)by << 24 ) | (int64)bx;
+    std::unique_lock<mutex> pendingLock( m_PendingMipUpdatesMutex );
+    m_PendingMipUpdates[key] = std::move( update );
+}
+
+void vaLargeBitmapFile::ApplyPendingMipUpdates( )
+{
+    {
+        std::unique_lock<mutex> pendingLock( m_PendingMipUpdatesMutex );
+        if( m_PendingMipUpdates.empty( ) )
+            return;
+    }
+
+    std::unique_lock<mutex> applyLock( m_MipApplyMutex );
+    for( ;; )
+    {
+        std::map<int64, PendingMipUpdate> updates;
+        {
+            std::unique_lock<mutex> pendingLock( m_PendingMipUpdatesMutex );
+            updates.swap( m_PendingMipUpdates );
+        }
+        if( updates.empty( ) )
+            break;
+
+        // in order of levels; loading parents can evict (and save) other modified blocks which queues more updates, 
+        // but always for higher levels so this ends
+        for( auto & it : updates )
+        {
+            const PendingMipUpdate & update = it.second;
+            DataBlock & parent = GetBlock( update.Level, update.Bx, update.By );
+            VA_LBF_THREADSAFE_LINE( std::unique_lock<std::shared_mutex> uniqueBlockLock( parent.Mutex ); )
+            if( parent.pData == 0 )
+                LoadBlock( update.Level, update.Bx, update.By );
+            parent.Touch( );
+
+            assert( update.OffsetX + update.Width <= parent.Width && update.OffsetY + update.Height <= parent.Height );
+            for( int y = 0; y < update.Height; y++ )
+                memcpy( &parent.pData[ ( parent.Width * ( update.OffsetY + y ) + update.OffsetX ) * m_BytesPerPixel ], &update.Data[ (size_t)y * update.Width * m_BytesPerPixel ], update.Width * m_BytesPerPixel );
+            parent.Modified = true;
+        }
+    }
+}
+
+void vaLargeBitmapFile::UpdateMips( )
+{
+    VA_LBF_THREADSAFE_LINE( std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); )
+    UpdateMipsInternal( );
+}
+
+void vaLargeBitmapFile::UpdateMipsInternal( )
+{
+    if( !HasMips( ) || m_ReadOnly )
+        return;
+
+    VA_TRACE_CPU_SCOPE( LargeBitmapUpdateMips );
+
+    // cleared before starting so any writes that happen in the meantime will trigger another update
+    m_MipsDirty = false;
+
+    for( int levelIndex = 0; levelIndex < (int)m_Levels.size( ) - 1; levelIndex++ )
+    {
+        MipLevel & level = m_Levels[levelIndex];
+        for( int y = 0; y < level.BlocksY; y++ )
+        {
+            for( int x = 0; x < level.BlocksX; x++ )
+            {
+                DataBlock & db = level.DataBlocks[x][y];
+                VA_LBF_THREADSAFE_LINE( std::unique_lock<std::shared_mutex> uniqueBlockLock( db.Mutex ); )
+                if( db.pData != 0 && db.Modified )
+                    SaveBlock( levelIndex, x, y );
+            }
+        }
+        ApplyPendingMipUpdates( );
+    }
+}
+
+void vaLargeBitmapFile::Prefetch( int level, int blockXFrom, int blockYFrom, int blockXTo, int blockYTo )
+{
+    if( !m_PrefetchEnabled || m_DirectMapped || !vaBackgroundTaskManager::GetInstanceValid( ) )
+        return;
+
+    int dx, dy;
+    {
+        std::unique_lock<mutex> prefetchLock( m_PrefetchMutex );
+        int * last = m_LastReadBlocks;
+        bool sameLevel = last[0] == level;
+        dx = ( !sameLevel ) ? ( 0 ) : ( ( blockXFrom > last[1] ) ? ( 1 ) : ( ( blockXFrom < last[1] ) ? ( -1 ) : ( 0 ) ) );
+        dy = ( !sameLevel ) ? ( 0 ) : ( ( blockYFrom > last[2] ) ? ( 1 ) : ( ( blockYFrom < last[2] ) ? ( -1 ) : ( 0 ) ) );
+        last[0] = level; last[1] = blockXFrom; last[2] = blockYFrom; last[3] = blockXTo; last[4] = blockYTo;
+    }
+    if( dx == 0 && dy == 0 )
+        return;
+
+    // next rect of blocks in the direction of travel
+    const MipLevel & lvl = m_Levels[level];
+    int sizeX = blockXTo - blockXFrom + 1;
+    int sizeY = blockYTo - blockYFrom + 1;
+    int pfXFrom = vaMath::Max( 0, blockXFrom + dx * sizeX );
+    int pfYFrom = vaMath::Max( 0, blockYFrom + dy * sizeY );
+    int pfXTo   = vaMath::Min( lvl.BlocksX - 1, blockXTo + dx * sizeX );
+    int pfYTo   = vaMath::Min( lvl.BlocksY - 1, blockYTo + dy * sizeY );
+    if( pfXFrom > pfXTo || pfYFrom > pfYTo )
+        return;
+
+    // only one in flight per file - if the previous one is still going we're reading faster than the disk anyway
+    bool expected = false;
+    if( !m_PrefetchInFlight.compare_exchange_strong( expected, true ) )
+        return;
+
+    vaBackgroundTaskManager::GetInstance( ).Spawn( "vaLargeBitmapFile_Prefetch", vaBackgroundTaskManager::SpawnFlags::UseThreadPool, 
+        [this, level, pfXFrom, pfYFrom, pfXTo, pfYTo]( vaBackgroundTaskManager::TaskContext & context )
+    {
+        VA_TRACE_CPU_SCOPE( LargeBitmapPrefetch );
+        for( int by = pfYFrom; by <= pfYTo && !context.ForceStop; by++ )
+        {
+            for( int bx = pfXFrom; bx <= pfXTo && !context.ForceStop; bx++ )
+            {
+                DataBlock & db = GetBlock( level, bx, by );
+                // if someone else has it locked they're already loading/using it
+                VA_LBF_THREADSAFE_LINE( std::unique_lock<std::shared_mutex> blockLock( db.Mutex, std::try_to_lock ); )
+                VA_LBF_THREADSAFE_LINE( if( !blockLock.owns_lock( ) ) continue; )
+                // never evict anything for prefetching - give up once the cache is full
+                if( db.pData == 0 && !LoadBlock( level, bx, by, false, true ) )
+                {
+                    m_PrefetchInFlight = false;
+                    return true;
+                }
+            }
+        }
+        m_PrefetchInFlight = false;
+        return true;
+    } );
+}
+
 void vaLargeBitmapFile::GetPixel( int x, int y, void* pPixel )
 {
 #ifdef VA_LBF_THREADSAFE
@@ -574,7 +949,7 @@ void vaLargeBitmapFile::GetPixel( int x, int y, void* pPixel )
     int by = y >> m_BlockDimBits;
     x -= bx << m_BlockDimBits;
     y -= by << m_BlockDimBits;
-    DataBlock & db = m_DataBlocks[bx][by];
+    DataBlock & db = GetBlock( 0, bx, by );
 #ifdef VA_LBF_THREADSAFE
     std::shared_lock<std::shared_mutex> sharedBlockLock( db.Mutex ); 
     std::unique_lock<std::shared_mutex> uniqueBlockLock( db.Mutex, std::defer_lock ); 
@@ -587,7 +962,7 @@ void vaLargeBitmapFile::GetPixel( int x, int y, void* pPixel )
 #endif
         if( db.pData == 0 )
         {
-            LoadBlock( bx, by );
+            LoadBlock( 0, bx, by );
         }
 //        else
 //        {
@@ -595,6 +970,7 @@ void vaLargeBitmapFile::GetPixel( int x, int y, void* pPixel )
 //            dbg++;
 //        }
     }
+    db.Touch( );
     memcpy( pPixel, db.pData + ( ( db.Width * y + x ) * m_BytesPerPixel ), m_BytesPerPixel );
 }
 
@@ -611,14 +987,15 @@ void vaLargeBitmapFile::SetPixel( int x, int y, void* pPixel )
     int by = y >> m_BlockDimBits;
     x -= bx << m_BlockDimBits;
     y -= by << m_BlockDimBits;
-    DataBlock & db = m_DataBlocks[bx][by];
+    DataBlock & db = GetBlock( 0, bx, by );
 #ifdef VA_LBF_THREADSAFE
     std::unique_lock<std::shared_mutex> uniqueBlockLock( db.Mutex ); 
 #endif
     if( db.pData == 0 )
     {
-        LoadBlock( bx, by );
+        LoadBlock( 0, bx, by );
     }
+    db.Touch( );
 
     char* pTo = db.pData + ( ( db.Width * y + x ) * m_BytesPerPixel );
     char* pFrom = (char*)pPixel;
@@ -629,6 +1006,8 @@ void vaLargeBitmapFile::SetPixel( int x, int y, void* pPixel )
     }
 
     db.Modified = true;
+    if( HasMips( ) )
+        m_MipsDirty = true;
 }
 
 namespace 
@@ -642,7 +1021,7 @@ namespace
     typedef vaStackVector< BlockOp, 2048 >  BlockOpStackVector; 
 }
 
-bool vaLargeBitmapFile::ReadRect( void * dstBuffer, int dstPitchInBytes, int64 dstSizeInBytes, int rectPosX, int rectPosY, int rectSizeX, int rectSizeY
+bool vaLargeBitmapFile::ReadRect( void * dstBuffer, int dstPitchInBytes, int64 dstSizeInBytes, int rectPosX, int rectPosY, int rectSizeX, int rectSizeY, int level
 #ifdef VA_ENKITS_INTEGRATION_ENABLED
     , vaEnkiTS * threadScheduler, shared_ptr<enki::ITaskSet> * outPtrTaskSetToWaitOn 
 #endif
@@ -658,6 +1037,13 @@ bool vaLargeBitmapFile::ReadRect( void * dstBuffer, int dstPitchInBytes, int64 d
         return false;
     }
 
+    if( level < 0 || level >= (int)m_Levels.size( ) )
+    {
+        assert( false );    // no such level (file created without StorageFlags::MipPyramid?)
+        return false;
+    }
+    const MipLevel & lvl = m_Levels[level];
+
     if( dstPitchInBytes < ( rectSizeX * m_BytesPerPixel ) )
     {
         assert( false );    // destination stride looks too small
@@ -670,71 +1056,29 @@ bool vaLargeBitmapFile::ReadRect( void * dstBuffer, int dstPitchInBytes, int64 d
         return false;
     }
 
-    if( ( rectPosX < 0 ) || ( ( rectPosX + rectSizeX ) > m_Width ) || ( rectPosY < 0 ) || ( ( rectPosY + rectSizeY ) > m_Height ) || ( rectSizeX < 0 ) || ( rectSizeY < 0 ) )
+    if( ( rectPosX < 0 ) || ( ( rectPosX + rectSizeX ) > lvl.Width ) || ( rectPosY < 0 ) || ( ( rectPosY + rectSizeY ) > lvl.Height ) || ( rectSizeX < 0 ) || ( rectSizeY < 0 ) )
     {
         assert( false );    // invalid lock region (out of range)
         return false;
     }
 
+    // pick up any writes since the last update
+    if( level > 0 && m_MipsDirty )
+        UpdateMipsInternal( );
+
     int blockXFrom = rectPosX / m_BlockDim;
     int blockYFrom = rectPosY / m_BlockDim;
     int blockXTo = ( rectPosX + rectSizeX - 1 ) / m_BlockDim;
     int blockYTo = ( rectPosY + rectSizeY - 1 ) / m_BlockDim;
 
-    assert( blockXTo < m_BlocksX );
-    assert( blockYTo < m_BlocksY );
-
-#if 0
-    for( int by = blockYFrom; by <= blockYTo; by++ )
-    {
-        for( int bx = blockXFrom; bx <= blockXTo; bx++ )
-        {
-            int bw = ( bx == ( m_BlocksX - 1 ) ) ? ( m_EdgeBlockWidth ) : ( m_BlockDim );
-            int bh = ( by == ( m_BlocksY - 1 ) ) ? ( m_EdgeBlockHeight ) : ( m_BlockDim );
-
-            DataBlock & db = m_DataBlocks[bx][by];
-            VA_LBF_THREADSAFE_LINE( std::shared_lock<std::shared_mutex> sharedBlockLock( db.Mutex ); )
-            VA_LBF_THREADSAFE_LINE( std::unique_lock<std::shared_mutex> uniqueBlockLock( db.Mutex, std::defer_lock ); )
-            if( db.pData == 0 )
-            {
-                // upgrade the lock to unique so we can load from disk
-                VA_LBF_THREADSAFE_LINE( sharedBlockLock.unlock(); )
-                VA_LBF_THREADSAFE_LINE( uniqueBlockLock.lock(); )
-                {
-                    // could have been loaded by someone else in the meantime 
-                    if( db.pData == 0 )
-                    {
-                        LoadBlock( bx, by );
-                    }
-                }
-                // continue this block with unique lock!
-            }
-            int fromX = vaMath::Max( bx * m_BlockDim, rectPosX );
-            int fromY = vaMath::Max( by * m_BlockDim, rectPosY );
-            int toX = vaMath::Min( bx * m_BlockDim + bw, rectPosX + rectSizeX );
-            int toY = vaMath::Min( by * m_BlockDim + bh, rectPosY + rectSizeY );
-
-            for( int y = fromY; y < toY; y++ )
-            {
-                int lly = y - rectPosY;
-                int llxf = fromX - rectPosX;
-                int llxt = toX - rectPosX;
-                void * dstTo = (char*)dstBuffer + (dstPitchInBytes * lly + llxf * m_BytesPerPixel);
-                int bytesCount = (toX-fromX) * m_BytesPerPixel;
-
-                int bly = y - ( by * m_BlockDim );
-                int blxf = fromX - ( bx * m_BlockDim );
-
-                memcpy( dstTo, &db.pData[( db.Width * bly + blxf ) * m_BytesPerPixel], bytesCount );
-            }
-        }
-    }
-#else
+    assert( blockXTo < lvl.BlocksX );
+    assert( blockYTo < lvl.BlocksY );
 
     struct BlockOpTaskSet : enki::ITaskSet
     {
         BlockOpStackVector                  blockOpVector;
         vaLargeBitmapFile &                 _this;
+        const int                           level;
         const void *                        dstBuffer;
         const int                           dstPitchInBytes;
         const int                           rectPosX;
@@ -742,9 +1086,9 @@ bool vaLargeBitmapFile::ReadRect( void * dstBuffer, int dstPitchInBytes, int64 d
         const int                           rectSizeX;
         const int                           rectSizeY;
 
-        BlockOpTaskSet( vaLargeBitmapFile & _this, void * dstBuffer, int dstPitchInBytes, int rectPosX, int rectPosY, int rectSizeX, int rectSizeY, int blockXFrom, int blockYFrom, int blockXTo, int blockYTo ) : 
+        BlockOpTaskSet( vaLargeBitmapFile & _this, int level, void * dstBuffer, int dstPitchInBytes, int rectPosX, int rectPosY, int rectSizeX, int rectSizeY, int blockXFrom, int blockYFrom, int blockXTo, int blockYTo ) : 
             ITaskSet( (uint32_t) (blockXTo-blockXFrom+1) * (blockYTo-blockYFrom+1) ),
-            _this(_this), dstBuffer( dstBuffer ), dstPitchInBytes( dstPitchInBytes ), rectPosX( rectPosX ), rectPosY( rectPosY ), rectSizeX( rectSizeX ), rectSizeY( rectSizeY ) 
+            _this(_this), level( level ), dstBuffer( dstBuffer ), dstPitchInBytes( dstPitchInBytes ), rectPosX( rectPosX ), rectPosY( rectPosY ), rectSizeX( rectSizeX ), rectSizeY( rectSizeY ) 
         { 
             _this.m_AsyncOpRunningCount++;
 
@@ -776,15 +1120,16 @@ bool vaLargeBitmapFile::ReadRect( void * dstBuffer, int dstPitchInBytes, int64 d
 
             threadnum; // unreferenced
 
+            const MipLevel & lvl = _this.m_Levels[level];
             for( uint32 i = range.start; i < range.end; i++ )
             {
                 BlockOp & blockOp = blockOpVector[i];
                 int bx = blockOp.bx;
                 int by = blockOp.by;
-                int bw = ( bx == ( _this.m_BlocksX - 1 ) ) ? ( _this.m_EdgeBlockWidth ) : ( _this.m_BlockDim );
-                int bh = ( by == ( _this.m_BlocksY - 1 ) ) ? ( _this.m_EdgeBlockHeight ) : ( _this.m_BlockDim );
+                int bw = ( bx == ( lvl.BlocksX - 1 ) ) ? ( lvl.EdgeBlockWidth ) : ( _this.m_BlockDim );
+                int bh = ( by == ( lvl.BlocksY - 1 ) ) ? ( lvl.EdgeBlockHeight ) : ( _this.m_BlockDim );
 
-                DataBlock & db = _this.m_DataBlocks[bx][by];
+                DataBlock & db = lvl.DataBlocks[bx][by];
                 VA_LBF_THREADSAFE_LINE( std::shared_lock<std::shared_mutex> sharedBlockLock( db.Mutex ); )
                 VA_LBF_THREADSAFE_LINE( std::unique_lock<std::shared_mutex> uniqueBlockLock( db.Mutex, std::defer_lock ); )
                 if( db.pData == 0 )
@@ -796,7 +1141,7 @@ bool vaLargeBitmapFile::ReadRect( void * dstBuffer, int dstPitchInBytes, int64 d
                         // could have been loaded by someone else in the meantime 
                         if( db.pData == 0 )
                         {
-                            _this.LoadBlock( bx, by );
+                            _this.LoadBlock( level, bx, by );
                         }
                         // else
                         // {
@@ -806,6 +1151,7 @@ bool vaLargeBitmapFile::ReadRect( void * dstBuffer, int dstPitchInBytes, int64 d
                     }
                     // continue this block with unique lock!
                 }
+                db.Touch( );
                 int fromX = vaMath::Max( bx * _this.m_BlockDim, rectPosX );
                 int fromY = vaMath::Max( by * _this.m_BlockDim, rectPosY );
                 int toX = vaMath::Min( bx * _this.m_BlockDim + bw, rectPosX + rectSizeX );
@@ -833,7 +1179,7 @@ bool vaLargeBitmapFile::ReadRect( void * dstBuffer, int dstPitchInBytes, int64 d
 #endif
     {
         // non-threaded
-        BlockOpTaskSet opSet( *this, dstBuffer, dstPitchInBytes, rectPosX, rectPosY, rectSizeX, rectSizeY, blockXFrom, blockYFrom, blockXTo, blockYTo );
+        BlockOpTaskSet opSet( *this, level, dstBuffer, dstPitchInBytes, rectPosX, rectPosY, rectSizeX, rectSizeY, blockXFrom, blockYFrom, blockXTo, blockYTo );
         opSet.ExecuteRange( enki::TaskSetPartition( 0, opSet.m_SetSize ), 0 );
     }
 #ifdef VA_ENKITS_INTEGRATION_ENABLED
@@ -842,19 +1188,21 @@ bool vaLargeBitmapFile::ReadRect( void * dstBuffer, int dstPitchInBytes, int64 d
         if( outPtrTaskSetToWaitOn == nullptr )
         {
             // threaded but non-async
-            BlockOpTaskSet opSet( *this, dstBuffer, dstPitchInBytes, rectPosX, rectPosY, rectSizeX, rectSizeY, blockXFrom, blockYFrom, blockXTo, blockYTo );
+            BlockOpTaskSet opSet( *this, level, dstBuffer, dstPitchInBytes, rectPosX, rectPosY, rectSizeX, rectSizeY, blockXFrom, blockYFrom, blockXTo, blockYTo );
             threadScheduler->AddTaskSetToPipe( &opSet );
             threadScheduler->WaitforTaskSet( &opSet );
         }
         else
         {
-            (*outPtrTaskSetToWaitOn) = std::make_shared<BlockOpTaskSet>( *this, dstBuffer, dstPitchInBytes, rectPosX, rectPosY, rectSizeX, rectSizeY, blockXFrom, blockYFrom, blockXTo, blockYTo );
+            (*outPtrTaskSetToWaitOn) = std::make_shared<BlockOpTaskSet>( *this, level, dstBuffer, dstPitchInBytes, rectPosX, rectPosY, rectSizeX, rectSizeY, blockXFrom, blockYFrom, blockXTo, blockYTo );
             threadScheduler->AddTaskSetToPipe( (*outPtrTaskSetToWaitOn).get() );
         }
     }
-#endif
 #endif
 
+    // start loading the next blocks in the direction the reads are moving (if there's room in the cache)
+    Prefetch( level, blockXFrom, blockYFrom, blockXTo, blockYTo );
+
     return true;
 }
 
@@ -891,48 +1239,9 @@ bool vaLargeBitmapFile::WriteRect( void * srcBuffer, int srcPitchInBytes, int re
     int blockXTo = ( rectPosX + rectSizeX - 1 ) / m_BlockDim;
     int blockYTo = ( rectPosY + rectSizeY - 1 ) / m_BlockDim;
 
-    assert( blockXTo < m_BlocksX );
-    assert( blockYTo < m_BlocksY );
+    assert( blockXTo < m_Levels[0].BlocksX );
+    assert( blockYTo < m_Levels[0].BlocksY );
 
-#if 0
-    for( int by = blockYFrom; by <= blockYTo; by++ )
-    {
-        for( int bx = blockXFrom; bx <= blockXTo; bx++ )
-        {
-            int bw = ( bx == ( m_BlocksX - 1 ) ) ? ( m_EdgeBlockWidth ) : ( m_BlockDim );
-            int bh = ( by == ( m_BlocksY - 1 ) ) ? ( m_EdgeBlockHeight ) : ( m_BlockDim );
-
-            DataBlock & db = m_DataBlocks[bx][by];
-            VA_LBF_THREADSAFE_LINE( std::unique_lock<std::shared_mutex> uniqueBlockLock( db.Mutex ); )
-
-            if( db.pData == 0 )
-                LoadBlock( bx, by );
-
-            // memcpy( pPixel, db.pData + ( ( db.Width * y + x ) * m_BytesPerPixel ), m_BytesPerPixel );
-
-            int fromX = vaMath::Max( bx * m_BlockDim, rectPosX );
-            int fromY = vaMath::Max( by * m_BlockDim, rectPosY );
-            int toX = vaMath::Min( bx * m_BlockDim + bw, rectPosX + rectSizeX );
-            int toY = vaMath::Min( by * m_BlockDim + bh, rectPosY + rectSizeY );
-
-            for( int y = fromY; y < toY; y++ )
-            {
-                int lly = y - rectPosY;
-                int llxf = fromX - rectPosX;
-                int llxt = toX - rectPosX;
-                void * srcFrom = (char*)srcBuffer + (srcPitchInBytes * lly + llxf * m_BytesPerPixel);
-                int bytesCount = (toX-fromX) * m_BytesPerPixel;
-
-                int bly = y - ( by * m_BlockDim );
-                int blxf = fromX - ( bx * m_BlockDim );
-
-                memcpy( &db.pData[( db.Width * bly + blxf ) * m_BytesPerPixel], srcFrom, bytesCount );
-            }
-            db.Modified = true;
-        }
-    }
-
-#else
 
     struct BlockOpTaskSet : enki::ITaskSet
     {
@@ -978,19 +1287,21 @@ bool vaLargeBitmapFile::WriteRect( void * srcBuffer, int srcPitchInBytes, int re
 
             threadnum; // unreferenced
 
+            const MipLevel & lvl = _this.m_Levels[0];
             for( uint32 i = range.start; i < range.end; i++ )
             {
                 BlockOp & blockOp = blockOpVector[i];
                 int bx = blockOp.bx;
                 int by = blockOp.by;
-                int bw = ( bx == ( _this.m_BlocksX - 1 ) ) ? ( _this.m_EdgeBlockWidth ) : ( _this.m_BlockDim );
-                int bh = ( by == ( _this.m_BlocksY - 1 ) ) ? ( _this.m_EdgeBlockHeight ) : ( _this.m_BlockDim );
-                DataBlock & db = _this.m_DataBlocks[bx][by];
+                int bw = ( bx == ( lvl.BlocksX - 1 ) ) ? ( lvl.EdgeBlockWidth ) : ( _this.m_BlockDim );
+                int bh = ( by == ( lvl.BlocksY - 1 ) ) ? ( lvl.EdgeBlockHeight ) : ( _this.m_BlockDim );
+                DataBlock & db = lvl.DataBlocks[bx][by];
                 VA_LBF_THREADSAFE_LINE( std::unique_lock<std::shared_mutex> uniqueBlockLock( db.Mutex ); )
                 if( db.pData == 0 )
                 {
-                    _this.LoadBlock( bx, by );
+                    _this.LoadBlock( 0, bx, by );
                 }
+                db.Touch( );
 
                 // memcpy( pPixel, db.pData + ( ( db.Width * y + x ) * m_BytesPerPixel ), m_BytesPerPixel );
 
@@ -1043,11 +1354,17 @@ bool vaLargeBitmapFile::WriteRect( void * srcBuffer, int srcPitchInBytes, int re
     }
 #endif
 
-#endif
+    if( HasMips( ) )
+    {
+        m_MipsDirty = true;
+        // keep the queue short: move downsampled data of blocks that got evicted (and saved) along the way up
+        ApplyPendingMipUpdates( );
+    }
 
     return true;
 }
 
+
 template< typename T >
 static void ClampBorders( void * _dstBuffer, int dstPitchInBytes, int dstRectSizeX, int dstRectSizeY, int offLeft, int offTop, int offRight, int offBottom
 #ifdef VA_ENKITS_INTEGRATION_ENABLED
@@ -1146,7 +1463,7 @@ bool vaLargeBitmapFile::ReadRectClampBorders( void * _dstBuffer, int dstPitchInB
     }
 
     byte * dstBufferOffsettedTL = ((byte*)dstBuffer) + offLeft * m_BytesPerPixel + offTop * dstPitchInBytes;
-    bool ret = ReadRect( dstBufferOffsettedTL, dstPitchInBytes, dstSizeInBytes - (dstBufferOffsettedTL-dstBuffer), dstRectPosX + offLeft, dstRectPosY + offTop, readRectSizeX, readRectSizeY
+    bool ret = ReadRect( dstBufferOffsettedTL, dstPitchInBytes, dstSizeInBytes - (dstBufferOffsettedTL-dstBuffer), dstRectPosX + offLeft, dstRectPosY + offTop, readRectSizeX, readRectSizeY, 0
 #ifdef VA_ENKITS_INTEGRATION_ENABLED
         , threadScheduler 
 #endif
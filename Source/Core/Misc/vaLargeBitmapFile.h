@@ -39,6 +39,7 @@
 
 #include "Core/vaCoreIncludes.h"
 #include "Core/Misc/vaResourceFormats.h"
+#include "Core/System/vaFileStream.h"
 
 #ifdef VA_LIBTIFF_INTEGRATION_ENABLED
 #include "IntegratedExternals/vaLibTIFFIntegration.h"
@@ -62,8 +63,18 @@ namespace Vanilla
     /// Access it also thread-safe with per-block granularity so different threads can read&write at the same time 
     /// (although if the operation covers multiple blocks, access order is not guaranteed)
     /// 
-    /// Current file format version is 1 (specified in FormatVersion field): supports reading and writing 
-    /// of versions 0, 1.
+    /// Current file format version is 2 (specified in FormatVersion field): supports reading and writing 
+    /// of versions 0, 1, 2. Create only writes version 2 if any StorageFlags are used, otherwise version 1.
+    /// Versions 0 and 1 are raw blocks stored back to back. Version 2 has a block index after the header and blocks 
+    /// are stored wherever there was room when they were written, optionally zlib compressed (per block), and can 
+    /// contain a mip pyramid (see ReadRect 'level'): levels above 0 are generated from the level below whenever a 
+    /// block gets written to disk (on eviction, UpdateMips or Close) - they can't be written to directly.
+    /// 
+    /// Read-only files are memory mapped by default so blocks are read straight from the OS file cache (for version 
+    /// 0/1 files they point directly into the mapped view). Otherwise blocks get loaded into a process-wide LRU block 
+    /// cache shared by all open files (see SetGlobalCacheBudget), using positional reads/writes so different blocks 
+    /// can be loaded in parallel. ReadRect also prefetches the next blocks in the direction of travel (if the calls 
+    /// move across the image) on a background task.
     /// </summary>
     class vaLargeBitmapFile
     {
@@ -85,58 +96,102 @@ namespace Vanilla
             FormatGeneric128Bit     = 14,
         };
 
+        // version 2 storage options (stored in the file)
+        enum class StorageFlags : uint32
+        {
+            None                    = 0,
+            Compressed              = ( 1 << 0 ),   // zlib (fastest setting) per block; blocks that don't compress are stored raw
+            MipPyramid              = ( 1 << 1 ),   // full mip chain down to 1x1; box filtered for the known formats, point sampled for the FormatGenericXXX ones
+        };
+
 
     public:
         static int                    GetPixelFormatBPP( PixelFormat pixelFormat );
 
-        static const int              c_FormatVersion       = 1;
-        static const int              c_MemoryLimit         = 32 * 1024 * 1024; // allow xMB of memory usage per instance (this could be upgraded to add a global memory limit as well - see s_TotalUsedMemory)
+        static const int              c_FormatVersion       = 2;
+        static const int64            c_DefaultCacheBudget  = 512 * 1024 * 1024;    // default for the global block cache shared by all instances (see SetGlobalCacheBudget)
         static const int              c_UserHeaderSize      = 224;
         static const int              c_TotalHeaderSize     = 256;
 
     private:
 
+        // entry in the global block cache list (most recently loaded at the front)
+        struct CachedBlock
+        {
+            vaLargeBitmapFile * File;
+            int                 Level;
+            int                 Bx;
+            int                 By;
+            int                 Size;
+        };
+        typedef std::list<CachedBlock>              CachedBlockList;
+
         struct DataBlock
         {
-#ifdef VA_LBF_THREADSAFE
-            char *              pData;
-#else
             char *              pData;
-#endif
             unsigned short      Width;
             unsigned short      Height;
             bool                Modified;
+            std::atomic_bool    Referenced;         // set on access, cleared by the cache eviction (CLOCK-style 'second chance' so that hits don't need the global cache lock)
+            CachedBlockList::iterator
+                                CacheEntry;         // valid if pData != nullptr and not directly mapped
             VA_LBF_THREADSAFE_LINE( std::shared_mutex   Mutex; )
+
+            void                Touch( )            { if( !Referenced.load( std::memory_order_relaxed ) ) Referenced.store( true, std::memory_order_relaxed ); }
         };
 
-        struct DataBlockID
+        // level 0 is the image itself, others only exist with StorageFlags::MipPyramid
+        struct MipLevel
         {
-            int                 Bx;
-            int                 By;
+            int                 Width;
+            int                 Height;
+            int                 BlocksX;
+            int                 BlocksY;
+            int                 EdgeBlockWidth;
+            int                 EdgeBlockHeight;
+            DataBlock **        DataBlocks;         // [x][y]
+            DataBlock *         BigDataBlocksArray;
+            int                 FirstIndexEntry;    // this level's first entry in m_BlockIndex
+        };
 
-            DataBlockID( int bx, int by ) { this->Bx = bx; this->By = by; }
+        // version 2 block index entry (as stored in the file)
+        struct BlockIndexEntry
+        {
+            int64               Offset;             // 0 if never written (reads as all zeroes)
+            uint32              StoredSize;         // == block size in bytes if stored uncompressed
+            uint32              Capacity;           // space reserved at Offset; rewrites that don't fit get appended to the end of the file
         };
 
-        static int                                  s_TotalUsedMemory;
-        VA_LBF_THREADSAFE_LINE( static mutex        s_TotalUsedMemoryMutex; )
+        // downsampled quadrant of a written block waiting to be copied into its parent (see ApplyPendingMipUpdates)
+        struct PendingMipUpdate
+        {
+            int                 Level;              // of the parent
+            int                 Bx;
+            int                 By;
+            int                 OffsetX;
+            int                 OffsetY;
+            int                 Width;
+            int                 Height;
+            vector<char>        Data;
+        };
 
-        int                                         m_UsedMemory;
-        deque<DataBlockID>                          m_UsedBlocks;
-        VA_LBF_THREADSAFE_LINE( mutable mutex       m_UsedMemoryMutex; )
+        // global block cache, shared by all instances
+        static int64                                s_TotalUsedMemory;
+        static int64                                s_CacheBudget;
+        static CachedBlockList                      s_CachedBlocks;
+        VA_LBF_THREADSAFE_LINE( static mutex        s_CacheMutex; )
 
-        VA_LBF_THREADSAFE_LINE( mutex               m_fileAccessMutex; )
-        FILE *                                      m_File;
+        shared_ptr<vaFileStream>                    m_File;
+        const char *                                m_MappedData;       // only for read-only files, nullptr if not memory mapped
+        bool                                        m_DirectMapped;     // all blocks point into m_MappedData (version 0/1 files)
         wstring                                     m_filePath;
 
         bool                                        m_ReadOnly;
+        int                                         m_Version;
+        StorageFlags                                m_StorageFlags;
 
         int                                         m_BlockDimBits;
-        int                                         m_BlocksX;
-        int                                         m_BlocksY;
-        int                                         m_EdgeBlockWidth;
-        int                                         m_EdgeBlockHeight;
-        DataBlock **                                m_DataBlocks;
-        DataBlock *                                 m_BigDataBlocksArray;
+        vector<MipLevel>                            m_Levels;
 
         PixelFormat                                 m_PixelFormat;
         int                                         m_Width;
@@ -144,10 +199,26 @@ namespace Vanilla
         int                                         m_BlockDim;
         int                                         m_BytesPerPixel;
 
+        // version 2 only
+        vector<BlockIndexEntry>                     m_BlockIndex;
+        std::atomic<int64>                          m_FileEnd;          // blocks that don't fit their old place get appended here
+
+        // mip pyramid updates
+        std::map<int64, PendingMipUpdate>           m_PendingMipUpdates;    // keyed by the source block so only the latest version is kept
+        mutex                                       m_PendingMipUpdatesMutex;
+        mutex                                       m_MipApplyMutex;        // applying is serialized so updates of the same block can't land out of order
+        std::atomic_bool                            m_MipsDirty;
+
         VA_LBF_THREADSAFE_LINE( mutable std::shared_mutex m_GlobalMutex; )
 
         std::atomic<int32>                          m_AsyncOpRunningCount;
 
+        // ReadRect prefetching
+        bool                                        m_PrefetchEnabled;
+        std::atomic_bool                            m_PrefetchInFlight;
+        mutex                                       m_PrefetchMutex;
+        int                                         m_LastReadBlocks[5];    // level, blockXFrom, blockYFrom, blockXTo, blockYTo of the last ReadRect
+
     public:
 #ifdef VA_LBF_THREADSAFE
         PixelFormat                                 GetPixelFormat( ) const     { std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); return m_PixelFormat; }
@@ -155,35 +226,71 @@ namespace Vanilla
         int                                         GetWidth( ) const           { std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); return m_Width; }
         int                                         GetHeight( ) const          { std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); return m_Height; }
         const wstring &                             GetFilePath( ) const        { std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); return m_filePath; }
-        bool                                        IsOpen( ) const             { std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); return m_File != 0; }
+        bool                                        IsOpen( ) const             { std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); return m_File != nullptr; }
+        bool                                        IsMemoryMapped( ) const     { std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); return m_MappedData != nullptr; }
+        StorageFlags                                GetStorageFlags( ) const    { std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); return m_StorageFlags; }
+        int                                         GetLevelCount( ) const      { std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); return (int)m_Levels.size(); }
+        int                                         GetLevelWidth( int level ) const    { std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); return m_Levels[level].Width; }
+        int                                         GetLevelHeight( int level ) const   { std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); return m_Levels[level].Height; }
 #else
         PixelFormat                                 GetPixelFormat( ) const     { return m_PixelFormat;     }
         int                                         GetBytesPerPixel( ) const   { return m_BytesPerPixel;   }
         int                                         GetWidth( ) const           { return m_Width;           }
         int                                         GetHeight( ) const          { return m_Height;          }
         const wstring &                             GetFilePath( ) const        { return m_filePath;        }
-        bool                                        IsOpen( ) const             { return m_File != 0;       }
+        bool                                        IsOpen( ) const             { return m_File != nullptr; }
+        bool                                        IsMemoryMapped( ) const     { return m_MappedData != nullptr; }
+        StorageFlags                                GetStorageFlags( ) const    { return m_StorageFlags;    }
+        int                                         GetLevelCount( ) const      { return (int)m_Levels.size(); }
+        int                                         GetLevelWidth( int level ) const    { return m_Levels[level].Width; }
+        int                                         GetLevelHeight( int level ) const   { return m_Levels[level].Height; }
 #endif
 
     protected:
-        vaLargeBitmapFile( FILE * file, const wstring & filePath, PixelFormat pixelFormat, int width, int height, int blockDim, bool readOnly );
+        vaLargeBitmapFile( const shared_ptr<vaFileStream> & file, const wstring & filePath, PixelFormat pixelFormat, int width, int height, int blockDim, bool readOnly, bool memoryMap, int version, StorageFlags storageFlags );
 
     public:
         ~vaLargeBitmapFile( );
 
     public:
-        static shared_ptr<vaLargeBitmapFile>        Create( const wstring & filePath, PixelFormat pixelFormat, int width, int height );
-        static shared_ptr<vaLargeBitmapFile>        Open( const wstring & filePath, bool readOnly );
+        static shared_ptr<vaLargeBitmapFile>        Create( const wstring & filePath, PixelFormat pixelFormat, int width, int height, StorageFlags storageFlags = StorageFlags::None );
+        // memoryMap is only used for read-only files (falls back to the block cache if mapping fails)
+        static shared_ptr<vaLargeBitmapFile>        Open( const wstring & filePath, bool readOnly, bool memoryMap = true );
 
         static vaLargeBitmapFile::PixelFormat       GetMatchingPixelFormat( vaResourceFormat format );
 
         void                                        Close( );
 
+        // Budget (in bytes) of the block cache shared by all open files that aren't memory mapped; when a block load 
+        // would go over it, least recently used blocks (from any file) get evicted, modified ones saved first.
+        static void                                 SetGlobalCacheBudget( int64 budgetInBytes );
+        static int64                                GetGlobalCacheBudget( );
+        static int64                                GetGlobalCacheUsedMemory( );
+
+        // ReadRect prefetching of neighbouring blocks (on by default; only done when there's free room in the cache budget)
+        void                                        SetPrefetchEnabled( bool enabled )      { m_PrefetchEnabled = enabled; }
+
+        // Brings the mip pyramid up to date with all writes so far (writes all modified blocks to disk, level by level). 
+        // Done automatically by Close and by ReadRect with level > 0, so there's usually no need to call it.
+        void                                        UpdateMips( );
+
     private:
-        void                                        ReleaseBlock( int bx, int by );
-        void                                        LoadBlock( int bx, int by, bool skipFileRead = false );
-        void                                        SaveBlock( int bx, int by );
+        DataBlock &                                 GetBlock( int level, int bx, int by )  { return m_Levels[level].DataBlocks[bx][by]; }
+        void                                        ReleaseBlock( int level, int bx, int by );
+        // with noEvict the block is only loaded if it fits into the cache budget as is (returns false otherwise)
+        bool                                        LoadBlock( int level, int bx, int by, bool skipFileRead = false, bool noEvict = false );
+        void                                        SaveBlock( int level, int bx, int by );
         int64                                       GetBlockStartPos( int bx, int by );
+        BlockIndexEntry &                           GetBlockIndexEntry( int level, int bx, int by ) { return m_BlockIndex[ m_Levels[level].FirstIndexEntry + by * m_Levels[level].BlocksX + bx ]; }
+        bool                                        HasMips( ) const                       { return ( (uint32)m_StorageFlags & (uint32)StorageFlags::MipPyramid ) != 0; }
+        bool                                        IsCompressed( ) const                  { return ( (uint32)m_StorageFlags & (uint32)StorageFlags::Compressed ) != 0; }
+
+        void                                        QueueMipUpdate( int level, int bx, int by );
+        void                                        ApplyPendingMipUpdates( );
+        void                                        UpdateMipsInternal( );
+
+        static void                                 EvictBlocks( int64 bytesNeeded );
+        void                                        Prefetch( int level, int blockXFrom, int blockYFrom, int blockXTo, int blockYTo );
 
     public:
         void                                        GetPixel( int x, int y, void* pPixel );
@@ -193,7 +300,8 @@ namespace Vanilla
         template< typename T >
         T                                           GetPixelSafe( int x, int y );
 
-        bool                                        ReadRect( void * dstBuffer, int dstPitchInBytes, int64 dstSizeInBytes, int rectPosX, int rectPosY, int rectSizeX, int rectSizeY
+        // level > 0 reads from the mip pyramid (rect is in that level's pixels, see GetLevelWidth/GetLevelHeight)
+        bool                                        ReadRect( void * dstBuffer, int dstPitchInBytes, int64 dstSizeInBytes, int rectPosX, int rectPosY, int rectSizeX, int rectSizeY, int level = 0
 #ifdef VA_ENKITS_INTEGRATION_ENABLED
             , vaEnkiTS * threadScheduler = nullptr, shared_ptr<enki::ITaskSet> * outPtrTaskSetToWaitOn = nullptr 
 #endif
@@ -219,6 +327,8 @@ namespace Vanilla
 
     };
 
+    BITFLAG_ENUM_CLASS_HELPER( vaLargeBitmapFile::StorageFlags );
+
     template< typename T >
     inline T vaLargeBitmapFile::GetPixelSafe( int x, int y )
     {
@@ -239,6 +349,7 @@ namespace Vanilla
     void vaLargeBitmapFile::SetAllPixels( const T & value )
     {
         VA_LBF_THREADSAFE_LINE( std::shared_lock<std::shared_mutex> lock( m_GlobalMutex ); )
+        assert( !m_ReadOnly );
         if( sizeof( T ) != m_BytesPerPixel )
         {
             assert( false );       // type size must match - otherwise there will be issues
@@ -249,14 +360,16 @@ namespace Vanilla
         for( int i = 0; i < m_BlockDim * m_BlockDim; i++ )
             oneBlock[i] = value;
 
-        for( int y = 0; y < m_BlocksY; y++ )
+        const MipLevel & level = m_Levels[0];
+        for( int y = 0; y < level.BlocksY; y++ )
         {
-            for( int x = 0; x < m_BlocksX; x++ )
+            for( int x = 0; x < level.BlocksX; x++ )
             {
-                DataBlock & db = m_DataBlocks[x][y];
+                DataBlock & db = level.DataBlocks[x][y];
                 VA_LBF_THREADSAFE_LINE( std::unique_lock<std::shared_mutex> uniqueBlockLock( db.Mutex ); ) 
                 if( db.pData == 0 )
-                    LoadBlock( x, y, true );
+                    LoadBlock( 0, x, y, true );
+                db.Touch( );
 
                 int size = db.Width * db.Height * m_BytesPerPixel;
                 assert( size <= (sizeof(T)*m_BlockDim * m_BlockDim) );
@@ -265,6 +378,8 @@ namespace Vanilla
                 db.Modified = true;
             }
         }
+        if( HasMips( ) )
+            m_MipsDirty = true;
 
         delete[] oneBlock;
     }
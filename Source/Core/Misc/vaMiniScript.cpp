@@ -20,6 +20,7 @@
 #include "vaMiniScript.h"
 #include "..\System\vaFileStream.h"
 #include "..\vaStringTools.h"
+#include "..\vaLog.h"
 
 using namespace Vanilla;
 
@@ -47,11 +48,41 @@ bool vaMiniScript::Start( const std::function< void( vaMiniScriptInterface & ) >
     m_scriptFunction    = scriptFunction;
     m_UIFunction        = nullptr;
     m_lastDeltaTime     = 0.0f;
+    m_stopRequested     = false;
+    m_runningMode       = m_executionMode;
 
     // start with execution being owned by script thread - it will give it back as soon as it starts up
     assert( m_currentOwnership == vaMiniScript::EO_Inactive );
     m_currentOwnership  = EO_ScriptThread;
 
+    if( m_runningMode == ExecutionMode::Inline )
+    {
+        m_scriptThreadID    = std::this_thread::get_id();
+        m_mainFiber         = vaThreading::FiberConvertCurrentThread( m_mainFiberConverted );
+        m_scriptFiber       = (m_mainFiber != nullptr)?(vaThreading::FiberCreate( 0, &vaMiniScript::ScriptFiber, this )):(nullptr);
+        if( m_scriptFiber == nullptr )
+        {
+            VA_LOG_ERROR( "vaMiniScript - unable to create script fiber" );
+            if( m_mainFiberConverted )
+                vaThreading::FiberRevertCurrentThread( );
+            m_mainFiber         = nullptr;
+            m_mainFiberConverted= false;
+            m_scriptFunction    = nullptr;
+            m_currentOwnership  = EO_Inactive;
+            return false;
+        }
+
+        {
+            std::unique_lock<std::mutex> lk( m_mutex );
+            m_active            = true;
+        }
+
+        // run up to the first YieldExecution (in ScriptMain) to get back ownership
+        vaThreading::FiberSwitchTo( m_scriptFiber );
+        assert( m_currentOwnership == EO_MainThread );
+        return true;
+    }
+
     m_scriptThread      = std::thread( &vaMiniScript::ScriptThread, this );
     m_scriptThreadID    = m_scriptThread.get_id();
 
@@ -83,6 +114,27 @@ void vaMiniScript::TickScript( float deltaTime )
         m_currentOwnership = vaMiniScript::EO_ScriptThread;
     }
 
+    if( m_runningMode == ExecutionMode::Inline )
+    {
+        // run the script on its fiber until it yields or finishes
+        vaThreading::FiberSwitchTo( m_scriptFiber );
+
+        std::unique_lock<std::mutex> lk( m_mutex );
+        assert( m_currentOwnership == EO_MainThread );
+        if( !m_active )
+        {
+            m_currentOwnership = EO_Inactive;
+            vaThreading::FiberDelete( m_scriptFiber );
+            m_scriptFiber = nullptr;
+            if( m_mainFiberConverted )
+                vaThreading::FiberRevertCurrentThread( );
+            m_mainFiber = nullptr;
+            m_mainFiberConverted = false;
+            m_scriptThreadID = std::thread::id( );
+        }
+        return;
+    }
+
     // notify/wake script thread if needed
     m_cv.notify_one( );
     
@@ -134,6 +186,14 @@ bool vaMiniScript::YieldExecution( )
         m_currentOwnership = vaMiniScript::EO_MainThread;
     }
 
+    if( m_runningMode == ExecutionMode::Inline )
+    {
+        // back to TickScript; we get resumed here on the next one
+        vaThreading::FiberSwitchTo( m_mainFiber );
+        assert( m_currentOwnership == EO_ScriptThread );
+        return !m_stopRequested;
+    }
+
     // notify/wake main thread if needed
     m_cv.notify_one( );
     
@@ -170,6 +230,25 @@ void vaMiniScript::ScriptThread( )
 {
     m_scriptThreadID    = std::this_thread::get_id();
 
+    ScriptMain( );
+
+    // notify/wake main thread if needed
+    m_cv.notify_one( );
+}
+
+void vaMiniScript::ScriptFiber( void * userData )
+{
+    vaMiniScript & self = *reinterpret_cast<vaMiniScript*>( userData );
+
+    self.ScriptMain( );
+
+    // finished - TickScript will delete this fiber so we never get back here
+    vaThreading::FiberSwitchTo( self.m_mainFiber );
+    assert( false );
+}
+
+void vaMiniScript::ScriptMain( )
+{
     // wait for our turn (first call to TickScript)
     YieldExecution();
 
@@ -185,7 +264,4 @@ void vaMiniScript::ScriptThread( )
         assert( m_currentOwnership == EO_ScriptThread );
         m_currentOwnership = vaMiniScript::EO_MainThread;
     }
-
-    // notify/wake main thread if needed
-    m_cv.notify_one( );
 }
\ No newline at end of file
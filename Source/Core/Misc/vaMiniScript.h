@@ -20,16 +20,20 @@
 #pragma once
 
 #include "..\vaCore.h"
+#include "..\System\vaThreading.h"
 
 #include <ctime>
 
 namespace Vanilla
 {
-    // vaMiniScript implements a way to run c++ script code as a coroutine - they each get their own thread,
-    // but are never run in parallel with the main thread (the one that created vaMiniScript), and they hand
-    // over / yield execution each other.
-    // The main thread calls TickScript() which unblocks the script thread (if any) and waits until it
-    // calls YieldExecution(), and so on.
+    // vaMiniScript implements a way to run c++ script code as a coroutine - they are never run in parallel with the 
+    // main thread (the one that created vaMiniScript), and they hand over / yield execution each other.
+    // The main thread calls TickScript() which resumes the script (if any) and waits until it calls YieldExecution(), 
+    // and so on. There are two ways of running the script:
+    //  * ExecutionMode::Inline - the script runs on its own fiber (own stack) on the main thread, so TickScript and
+    //    YieldExecution are just a user-mode stack switch; this is the default as it adds no per-frame scheduling jitter.
+    //  * ExecutionMode::Threaded - the script gets its own thread and the ownership is handed back and forth with a
+    //    mutex & condition variable (two OS context switches per frame).
 
     class vaMiniScriptInterface
     {
@@ -55,6 +59,13 @@ namespace Vanilla
 
     class vaMiniScript : public vaMiniScriptInterface
     {
+    public:
+        enum class ExecutionMode
+        {
+            Inline,
+            Threaded
+        };
+
     private:
         enum ExecutionOwnership
         {
@@ -67,12 +78,19 @@ namespace Vanilla
         bool                                m_active            = false;
         bool                                m_stopRequested     = false;
 
+        ExecutionMode                       m_executionMode     = ExecutionMode::Inline;
+        ExecutionMode                       m_runningMode       = ExecutionMode::Inline;    // mode of the currently running script (if any)
+
         std::function< void( vaMiniScriptInterface & ) >
                                             m_scriptFunction;
         std::function< void( ) >            m_UIFunction;
 
         std::thread                         m_scriptThread;
 
+        vaThreading::FiberHandle            m_mainFiber         = nullptr;
+        vaThreading::FiberHandle            m_scriptFiber       = nullptr;
+        bool                                m_mainFiberConverted= false;
+
         std::mutex                          m_mutex;
         std::condition_variable             m_cv;
         
@@ -95,8 +113,14 @@ namespace Vanilla
         void                                TickUI( );
         void                                Stop( );
 
+        // takes effect on next Start( )
+        void                                SetExecutionMode( ExecutionMode mode )  { assert( std::this_thread::get_id() == m_mainThreadID ); m_executionMode = mode; }
+        ExecutionMode                       GetExecutionMode( ) const               { return m_executionMode; }
+
     private:
         void                                ScriptThread( );
+        static void                         ScriptFiber( void * userData );
+        void                                ScriptMain( );
 
         virtual void                        SetUICallback( const std::function< void( ) > & UIFunction ) override   { assert( std::this_thread::get_id() == m_scriptThreadID ); std::unique_lock<std::mutex> lk( m_mutex ); m_UIFunction = UIFunction; }
         virtual bool                        YieldExecution( ) override;
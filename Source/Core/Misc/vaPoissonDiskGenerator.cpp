@@ -19,12 +19,370 @@
 
 #include "vaPoissonDiskGenerator.h"
 
+#include "Core/Misc/vaProfiler.h"
+
 // #include "Core/System/vaThreadPool.h"
 
+#include <algorithm>
+
 using namespace Vanilla;
 
 std::atomic_int32_t vaPoissonDiskGenerator::s_lastRandomSeed = 0;
 
+namespace
+{
+    // background grid shared by the Bridson samplers; empty cells hold VA_FLOAT_HIGHEST
+    struct BridsonGrid
+    {
+        vaVector2           TopLeft;
+        vaVector2           LowerRight;
+        vaVector2           Center;
+        float               MinimumDistance;
+        float               MinimumSqDistance;
+        float               RejectionSqDistance;        // 0 for no rejection (rectangle)
+        float               CellSize;
+        int                 Width;
+        int                 Height;
+        vector<vaVector2>   Cells;
+
+        BridsonGrid( vaVector2 topLeft, vaVector2 lowerRight, float minimumDistance, float rejectionDistance )
+        {
+            TopLeft             = topLeft;
+            LowerRight          = lowerRight;
+            Center              = ( topLeft + lowerRight ) * 0.5f;
+            MinimumDistance     = minimumDistance;
+            MinimumSqDistance   = minimumDistance * minimumDistance;
+            RejectionSqDistance = rejectionDistance * rejectionDistance;
+            CellSize            = minimumDistance / vaMath::Sqrt( 2.0f );
+            Width               = (int)( ( lowerRight.x - topLeft.x ) / CellSize ) + 1;
+            Height              = (int)( ( lowerRight.y - topLeft.y ) / CellSize ) + 1;
+            Cells.resize( (size_t)Width * Height, vaVector2( VA_FLOAT_HIGHEST, VA_FLOAT_HIGHEST ) );
+        }
+
+        bool                IsEmpty( int x, int y ) const               { return Cells[ (size_t)x + (size_t)y * Width ].x == VA_FLOAT_HIGHEST; }
+        const vaVector2 &   At( int x, int y ) const                    { return Cells[ (size_t)x + (size_t)y * Width ]; }
+
+        bool                InDomain( const vaVector2 & p ) const
+        {
+            return p.x >= TopLeft.x && p.x < LowerRight.x && p.y >= TopLeft.y && p.y < LowerRight.y 
+                && ( RejectionSqDistance == 0.0f || ( Center - p ).LengthSq( ) <= RejectionSqDistance );
+        }
+
+        vaVector2i          CellOf( const vaVector2 & p ) const
+        {
+            return vaVector2i( vaMath::Min( (int)( ( p.x - TopLeft.x ) / CellSize ), Width - 1 ), vaMath::Min( (int)( ( p.y - TopLeft.y ) / CellSize ), Height - 1 ) );
+        }
+
+        // cell size is r/sqrt(2) so anything closer than r is at most 2 cells away
+        bool                Fits( const vaVector2 & p, const vaVector2i & cell ) const
+        {
+            int xFrom = vaMath::Max( 0, cell.x - 2 ), xTo = vaMath::Min( Width, cell.x + 3 );
+            int yFrom = vaMath::Max( 0, cell.y - 2 ), yTo = vaMath::Min( Height, cell.y + 3 );
+            for( int y = yFrom; y < yTo; y++ )
+                for( int x = xFrom; x < xTo; x++ )
+                {
+                    const vaVector2 & other = At( x, y );
+                    if( other.x != VA_FLOAT_HIGHEST && ( other - p ).LengthSq( ) < MinimumSqDistance )
+                        return false;
+                }
+            return true;
+        }
+
+        void                Insert( const vaVector2 & p, const vaVector2i & cell )
+        {
+            Cells[ (size_t)cell.x + (size_t)cell.y * Width ] = p;
+        }
+    };
+
+    // rectangle of grid cells [From, To) that a single fill is allowed to write into
+    struct BridsonRegion
+    {
+        vaVector2i          From;
+        vaVector2i          To;
+
+        bool                Contains( const vaVector2i & cell ) const   { return cell.x >= From.x && cell.x < To.x && cell.y >= From.y && cell.y < To.y; }
+    };
+
+    // scrambles the user seed (plus optional tile/step coordinates) into a vaRandom seed so that nearby seeds don't
+    // give correlated streams
+    static int MixSeed( uint32 seed, uint32 a = 0, uint32 b = 0 )
+    {
+        uint32 h = seed ^ ( a * 0x9E3779B1u ) ^ ( b * 0x85EBCA77u );
+        h ^= h >> 16; h *= 0x7FEB352Du;
+        h ^= h >> 15; h *= 0x846CA68Bu;
+        h ^= h >> 16;
+        return (int)h;
+    }
+
+    // vaRandom::NextFloat is in [0, 1] - keep it out of the upper bound
+    static float NextFloatExclusive( vaRandom & random )
+    {
+        return vaMath::Min( random.NextFloat( ), 0.99999994f );
+    }
+
+    // Bridson's algorithm restricted to 'region'; 'active' can come pre-filled with existing points (from neighbouring
+    // regions or a forced first point) to grow from. If tryRandomStart is set, a random starting point is also attempted
+    // (a few times, as the region can already be partially covered).
+    static void BridsonFill( BridsonGrid & grid, const BridsonRegion & region, vaRandom & random, int pointsPerIteration, bool tryRandomStart, vector<vaVector2> & active, vector<vaVector2> & outPoints )
+    {
+        if( tryRandomStart )
+        {
+            vaVector2 regionFrom    = grid.TopLeft + vaVector2( (float)region.From.x, (float)region.From.y ) * grid.CellSize;
+            vaVector2 regionTo      = grid.TopLeft + vaVector2( (float)region.To.x, (float)region.To.y ) * grid.CellSize;
+            regionTo = vaVector2( vaMath::Min( regionTo.x, grid.LowerRight.x ), vaMath::Min( regionTo.y, grid.LowerRight.y ) );
+
+            for( int attempt = 0; attempt < pointsPerIteration; attempt++ )
+            {
+                vaVector2 p( regionFrom.x + ( regionTo.x - regionFrom.x ) * NextFloatExclusive( random ), regionFrom.y + ( regionTo.y - regionFrom.y ) * NextFloatExclusive( random ) );
+                if( !grid.InDomain( p ) )
+                    continue;
+                vaVector2i cell = grid.CellOf( p );
+                if( !region.Contains( cell ) || !grid.Fits( p, cell ) )
+                    continue;
+                grid.Insert( p, cell );
+                active.push_back( p );
+                outPoints.push_back( p );
+                break;
+            }
+        }
+
+        while( !active.empty( ) )
+        {
+            int listIndex = random.NextIntRange( (int)active.size( ) );
+            vaVector2 point = active[listIndex];
+
+            bool found = false;
+            for( int k = 0; k < pointsPerIteration; k++ )
+            {
+                // uniform by area over the [r, 2r] annulus
+                float radius    = grid.MinimumDistance * vaMath::Sqrt( 1.0f + 3.0f * random.NextFloat( ) );
+                float angle     = VA_PIf * 2.0f * random.NextFloat( );
+                vaVector2 q( point.x + radius * vaMath::Cos( angle ), point.y + radius * vaMath::Sin( angle ) );
+
+                if( !grid.InDomain( q ) )
+                    continue;
+                vaVector2i cell = grid.CellOf( q );
+                if( !region.Contains( cell ) || !grid.Fits( q, cell ) )
+                    continue;
+
+                grid.Insert( q, cell );
+                active.push_back( q );
+                outPoints.push_back( q );
+                found = true;
+                break;
+            }
+
+            if( !found )
+            {
+                active[listIndex] = active.back( );
+                active.pop_back( );
+            }
+        }
+    }
+}
+
+void vaPoissonDiskGenerator::SampleRectangleBridson( vaVector2 topLeft, vaVector2 lowerRight, float minimumDistance, uint32 seed, vector<vaVector2> & outResults, int pointsPerIteration )
+{
+    outResults.clear( );
+    assert( minimumDistance > 0.0f );
+    if( minimumDistance <= 0.0f || !( lowerRight.x > topLeft.x && lowerRight.y > topLeft.y ) )
+        return;
+
+    BridsonGrid grid( topLeft, lowerRight, minimumDistance, 0.0f );
+    BridsonRegion region = { vaVector2i( 0, 0 ), vaVector2i( grid.Width, grid.Height ) };
+    vaRandom random( MixSeed( seed ) );
+
+    vector<vaVector2> active;
+    BridsonFill( grid, region, random, pointsPerIteration, true, active, outResults );
+}
+
+void vaPoissonDiskGenerator::SampleCircleBridson( vaVector2 center, float radius, float minimumDistance, uint32 seed, bool firstPointAtCenter, vector<vaVector2> & outResults, int pointsPerIteration )
+{
+    outResults.clear( );
+    assert( minimumDistance > 0.0f );
+    if( minimumDistance <= 0.0f || radius <= 0.0f )
+        return;
+
+    BridsonGrid grid( center - vaVector2( radius, radius ), center + vaVector2( radius, radius ), minimumDistance, radius );
+    BridsonRegion region = { vaVector2i( 0, 0 ), vaVector2i( grid.Width, grid.Height ) };
+    vaRandom random( MixSeed( seed ) );
+
+    vector<vaVector2> active;
+    if( firstPointAtCenter )
+    {
+        grid.Insert( center, grid.CellOf( center ) );
+        active.push_back( center );
+        outResults.push_back( center );
+    }
+    BridsonFill( grid, region, random, pointsPerIteration, !firstPointAtCenter, active, outResults );
+}
+
+void vaPoissonDiskGenerator::SampleRectangleTiled( vaVector2 topLeft, vaVector2 lowerRight, float minimumDistance, uint32 seed, vector<vaVector2> & outResults, int tileCellCount, int pointsPerIteration )
+{
+    VA_TRACE_CPU_SCOPE( PoissonSampleRectangleTiled );
+
+    outResults.clear( );
+    assert( minimumDistance > 0.0f );
+    if( minimumDistance <= 0.0f || !( lowerRight.x > topLeft.x && lowerRight.y > topLeft.y ) )
+        return;
+
+    // same-pass tiles are one tile apart and a fill reads 2 cells outside of its tile, so tiles need to be wider than that
+    tileCellCount = vaMath::Max( 4, tileCellCount );
+
+    BridsonGrid grid( topLeft, lowerRight, minimumDistance, 0.0f );
+    const int tilesX = ( grid.Width + tileCellCount - 1 ) / tileCellCount;
+    const int tilesY = ( grid.Height + tileCellCount - 1 ) / tileCellCount;
+
+    vector<vector<vaVector2>> tilePoints( (size_t)tilesX * tilesY );
+
+    auto fillTile = [&]( int tx, int ty )
+    {
+        BridsonRegion region;
+        region.From = vaVector2i( tx * tileCellCount, ty * tileCellCount );
+        region.To   = vaVector2i( vaMath::Min( region.From.x + tileCellCount, grid.Width ), vaMath::Min( region.From.y + tileCellCount, grid.Height ) );
+
+        // continue from whatever the previous passes placed just outside of this tile; scanned in a fixed order to
+        // keep the result deterministic
+        vector<vaVector2> active;
+        for( int y = vaMath::Max( 0, region.From.y - 2 ); y < vaMath::Min( grid.Height, region.To.y + 2 ); y++ )
+            for( int x = vaMath::Max( 0, region.From.x - 2 ); x < vaMath::Min( grid.Width, region.To.x + 2 ); x++ )
+                if( !region.Contains( vaVector2i( x, y ) ) && !grid.IsEmpty( x, y ) )
+                    active.push_back( grid.At( x, y ) );
+
+        vaRandom random( MixSeed( seed, (uint32)tx + 1, (uint32)ty + 1 ) );
+        BridsonFill( grid, region, random, pointsPerIteration, true, active, tilePoints[ (size_t)tx + (size_t)ty * tilesX ] );
+    };
+
+    for( int pass = 0; pass < 4; pass++ )
+    {
+        const int offsetX = pass & 1, offsetY = pass >> 1;
+        const int passTilesX = ( tilesX - offsetX + 1 ) / 2;
+        const int passTilesY = ( tilesY - offsetY + 1 ) / 2;
+
+        vaParallel::For( 0, (int64)passTilesX * passTilesY, 1, [&]( int64 begin, int64 end )
+        {
+            for( int64 i = begin; i < end; i++ )
+                fillTile( offsetX + 2 * (int)( i % passTilesX ), offsetY + 2 * (int)( i / passTilesX ) );
+        } );
+    }
+
+    size_t totalCount = 0;
+    for( const auto & points : tilePoints )
+        totalCount += points.size( );
+    outResults.reserve( totalCount );
+    for( const auto & points : tilePoints )
+        outResults.insert( outResults.end( ), points.begin( ), points.end( ) );
+}
+
+bool vaPoissonDiskGenerator::SearchCircleByBisection( vaVector2 center, float radius, int searchTarget, bool firstPointAtCenter, bool deleteCenterPoint, uint32 seed, vector<vaVector2> & outResults, float & outMinDistance )
+{
+    VA_TRACE_CPU_SCOPE( PoissonSearchCircleByBisection );
+
+    outResults.clear( );
+    outMinDistance = 0.0f;
+    assert( searchTarget > 0 && radius > 0.0f );
+    if( searchTarget <= 0 || radius <= 0.0f )
+        return false;
+
+    if( !firstPointAtCenter )
+        deleteCenterPoint = false;
+    if( deleteCenterPoint )
+        searchTarget++;
+
+    const int c_seedsPerStep        = 8;
+    const int c_maxSteps            = 200;
+
+    // Bridson's algorithm covers about 0.6 of the area with r/2 disks, which gives a good initial guess
+    float estimate = radius * vaMath::Sqrt( 2.4f / (float)searchTarget );
+    float distLow  = estimate * 0.5f;      // gives more than searchTarget (or equal)
+    float distHigh = estimate * 2.0f;      // gives fewer than searchTarget (or equal)
+
+    struct Attempt
+    {
+        vector<vaVector2>   Points;
+        float               MinDistance     = 0.0f;
+    };
+    Attempt attempts[c_seedsPerStep];
+    Attempt closest;
+
+    uint32 seedStep = 0;
+    auto sampleAll = [&]( float minDistance ) -> int
+    {
+        vaParallel::For( 0, c_seedsPerStep, 1, [&]( int64 begin, int64 end )
+        {
+            for( int64 i = begin; i < end; i++ )
+            {
+                SampleCircleBridson( center, radius, minDistance, (uint32)MixSeed( seed, seedStep, (uint32)i ), firstPointAtCenter, attempts[i].Points );
+                attempts[i].MinDistance = minDistance;
+            }
+        } );
+        seedStep++;
+
+        // lowest index exact match wins (deterministic regardless of thread timing), otherwise remember the closest
+        int counts[c_seedsPerStep];
+        for( int i = 0; i < c_seedsPerStep; i++ )
+        {
+            counts[i] = (int)attempts[i].Points.size( );
+            if( counts[i] == searchTarget )
+            {
+                closest = std::move( attempts[i] );
+                return searchTarget;
+            }
+            if( closest.Points.empty( ) || std::abs( counts[i] - searchTarget ) < std::abs( (int)closest.Points.size( ) - searchTarget ) )
+                closest = attempts[i];
+        }
+        std::nth_element( counts, counts + c_seedsPerStep / 2, counts + c_seedsPerStep );
+        return counts[c_seedsPerStep / 2];
+    };
+
+    // make sure the target is actually bracketed (any exact hit on the way is good too)
+    bool found = false;
+    for( int i = 0; i < 16 && !found; i++ )
+    {
+        int medianCount = sampleAll( distLow );
+        found = medianCount == searchTarget;
+        if( medianCount > searchTarget )
+            break;
+        distHigh = distLow; distLow *= 0.5f;
+    }
+    for( int i = 0; i < 16 && !found; i++ )
+    {
+        int medianCount = sampleAll( distHigh );
+        found = medianCount == searchTarget;
+        if( medianCount < searchTarget )
+            break;
+        distLow = distHigh; distHigh *= 2.0f;
+    }
+
+    for( int step = 0; step < c_maxSteps && !found; step++ )
+    {
+        float minDistance = ( distLow + distHigh ) * 0.5f;
+        int medianCount = sampleAll( minDistance );
+        if( medianCount == searchTarget )
+            found = true;
+        else if( medianCount > searchTarget )
+            distLow = minDistance;
+        else
+            distHigh = minDistance;
+
+        // the count is only statistically monotonic in the distance; once the bracket collapses without a hit, reopen
+        // it a bit and keep going with new seeds
+        if( ( distHigh - distLow ) < minDistance * 1e-4f )
+        {
+            distLow  = minDistance * 0.98f;
+            distHigh = minDistance * 1.02f;
+        }
+    }
+
+    outResults      = std::move( closest.Points );
+    outMinDistance  = closest.MinDistance;
+
+    if( deleteCenterPoint && outResults.size( ) > 0 )
+        outResults.erase( outResults.begin( ) + 0 );
+
+    return found;
+}
+
 void vaPoissonDiskGenerator::PoissonThreadProc( void * threadParam )
 {
     SearchThreadState * ptsPtr = static_cast<SearchThreadState*>( threadParam );
@@ -194,6 +194,27 @@ namespace Vanilla
 
         static void SearchCircleByParams( vaVector2 center, float radius, int searchTarget, bool firstPointAtCenter, bool deleteCenterPoint, vector<vaVector2> & outResults, float & outMinDistance );
 
+        // Grid based Bridson sampler, O(n) in the number of points: background grid of r/sqrt(2) cells (so at most one point
+        // per cell and only the 5x5 neighbourhood needs checking), active list with swap-remove and candidates drawn
+        // uniformly from the [r, 2r] annulus. Unlike the above, which seed from s_lastRandomSeed, these take an explicit
+        // seed and always return the same points for the same seed and parameters.
+        static void SampleRectangleBridson( vaVector2 topLeft, vaVector2 lowerRight, float minimumDistance, uint32 seed, vector<vaVector2> & outResults, int pointsPerIteration = c_defaultPointsPerIteration );
+        static void SampleCircleBridson( vaVector2 center, float radius, float minimumDistance, uint32 seed, bool firstPointAtCenter, vector<vaVector2> & outResults, int pointsPerIteration = c_defaultPointsPerIteration );
+
+        // Same as SampleRectangleBridson but for large domains: the grid is split into tiles of tileCellCount x tileCellCount
+        // cells that are filled on vaParallel workers in 4 passes (2x2 checkerboard, so that tiles running at the same time
+        // never touch each other's cells); each tile continues from the points that earlier passes left along its border so
+        // there are no visible seams. Every tile has its own random stream derived from the seed, so the output does not
+        // depend on the number of threads. Points are not in the same order as the single-threaded version (and not the
+        // same points either).
+        static void SampleRectangleTiled( vaVector2 topLeft, vaVector2 lowerRight, float minimumDistance, uint32 seed, vector<vaVector2> & outResults, int tileCellCount = 64, int pointsPerIteration = c_defaultPointsPerIteration );
+
+        // Finds a minimum distance for which SampleCircleBridson returns exactly searchTarget points, by bisection on the
+        // minimum distance; each step samples a few seeds (derived from 'seed') in parallel and the bisection follows their
+        // median count, so it converges in a handful of steps. Deterministic for the same arguments. Returns false (and the
+        // closest set found) if no exact match was found.
+        static bool SearchCircleByBisection( vaVector2 center, float radius, int searchTarget, bool firstPointAtCenter, bool deleteCenterPoint, uint32 seed, vector<vaVector2> & outResults, float & outMinDistance );
+
     private:
 
         static vaVector2i Denormalize( vaVector2 point, vaVector2 origin, double cellSize )
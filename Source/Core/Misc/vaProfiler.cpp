@@ -20,7 +20,9 @@
 #pragma once
 
 #include "Core/Misc/vaProfiler.h"
+#include "Core/Misc/vaTracerStream.h"
 #include "Core/System/vaThreading.h"
+#include "Core/vaMemory.h"
 
 #include "Core/vaApplicationBase.h"
 
@@ -81,6 +83,11 @@ std::mutex                                                              vaTracer
 //std::map< std::thread::id, std::weak_ptr<vaTracer::ThreadContext> >     vaTracer::s_threadContexts;
 std::vector< std::weak_ptr<vaTracer::ThreadContext> >                   vaTracer::s_threadContexts;
 std::weak_ptr<vaTracer::ThreadContext>                                  vaTracer::s_mainThreadContext;
+std::atomic_bool                                                        vaTracer::s_streamingActive = false;
+shared_ptr<vaTracerStreamWriter>                                        vaTracer::s_streamWriter;
+std::mutex                                                              vaTracer::s_streamMutex;
+string                                                                  vaTracer::s_lastStreamFilePath;
+std::atomic_bool                                                        vaTracer::s_HWCountersEnabled = false;
 
 vaTracer::ThreadContext::ThreadContext( const char * name, const std::thread::id & threadID, bool automaticFrameIncrement ) : Name( name ), ThreadID( threadID ), AutomaticFrameIncrement( automaticFrameIncrement )
 {
@@ -196,6 +203,21 @@ string vaTracer::CreateChromeTracingReport( double duration, bool reset )
             os << "\"ts\":" << double( (entryIt->Beginning - now)*1000000.0 ) // -> microseconds (used to be std::chrono::duration_cast<std::chrono::microseconds>...)
                << ','
                << "\"dur\":" << double( (entryIt->End - entryIt->Beginning)*1000000.0 );
+#ifdef VA_TRACER_HW_COUNTERS
+            if( entryIt->HWCounterMask != 0 )
+            {
+                os << ",\"args\":{";
+                bool firstArg = true;
+                for( int i = 0; i < vaHWCounters::Count; i++ )
+                {
+                    if( ( entryIt->HWCounterMask & ( 1 << i ) ) == 0 )
+                        continue;
+                    os << ( ( firstArg ) ? ( "" ) : ( "," ) ) << '\"' << vaHWCounters::GetCounterName( i ) << "\":" << entryIt->HWCounters[i];
+                    firstArg = false;
+                }
+                os << '}';
+            }
+#endif
 
             entryIt++;
             if( entryIt != threadIt->Timeline.end() )
@@ -209,6 +231,81 @@ string vaTracer::CreateChromeTracingReport( double duration, bool reset )
     return os.str();
 }
 
+bool vaTracer::StartStreamingCapture( const string & _filePath )
+{
+    std::lock_guard<std::mutex> streamLock( s_streamMutex );
+    assert( s_streamWriter == nullptr );
+    if( s_streamWriter != nullptr )
+        return false;
+
+    string filePath = _filePath;
+    if( filePath == "" )
+    {
+        static int captureIndex = 0; captureIndex++;
+        filePath = vaStringTools::SimpleNarrow( vaCore::GetExecutableDirectory( ) ) + vaStringTools::Format( "TracerCapture%03d.vatb", captureIndex );
+    }
+
+    // drop anything left over from a previous capture
+    {
+        std::lock_guard<std::mutex> lock( s_globalMutex );
+        for( auto & weakContext : s_threadContexts )
+        {
+            std::shared_ptr<ThreadContext> context = weakContext.lock( );
+            if( context == nullptr )
+                continue;
+            std::lock_guard<std::mutex> timelineLock( context->TimelineMutex );
+            context->StreamPending.clear( );
+            context->StreamDroppedCount = 0;
+        }
+    }
+
+    shared_ptr<vaTracerStreamWriter> writer = std::make_shared<vaTracerStreamWriter>( );
+    if( !writer->Start( filePath ) )
+        return false;
+
+    s_streamWriter          = writer;
+    s_lastStreamFilePath    = filePath;
+    s_streamingActive       = true;
+    VA_LOG( "Tracer streaming capture started, writing to '%s'", filePath.c_str() );
+    return true;
+}
+
+void vaTracer::StopStreamingCapture( )
+{
+    std::lock_guard<std::mutex> streamLock( s_streamMutex );
+    if( s_streamWriter == nullptr )
+        return;
+
+    s_streamingActive = false;
+    s_streamWriter->Stop( );
+    VA_LOG_SUCCESS( "Tracer streaming capture stopped, %d entries (%.2fMB) written to '%s'", (int)s_streamWriter->GetTotalEntriesWritten(), 
+        s_streamWriter->GetTotalBytesWritten() / (1024.0 * 1024.0), s_streamWriter->GetFilePath().c_str() );
+    s_streamWriter = nullptr;
+}
+
+void vaTracer::SetHWCountersEnabled( bool enable )
+{
+#ifdef VA_TRACER_HW_COUNTERS
+    if( enable && !IsHWCountersEnabled( ) )
+    {
+        uint32 mask = vaHWCounters::GetAvailableMask( );
+        if( mask == 0 )
+        {
+            VA_LOG_WARNING( "vaTracer - no CPU hardware counters available on this platform / with current permissions" );
+            return;
+        }
+        string names;
+        for( int i = 0; i < vaHWCounters::Count; i++ )
+            if( mask & ( 1 << i ) )
+                names += string( ( names == "" ) ? ( "" ) : ( ", " ) ) + vaHWCounters::GetCounterName( i );
+        VA_LOG( "vaTracer - capturing CPU hardware counters: %s", names.c_str() );
+    }
+    s_HWCountersEnabled = enable;
+#else
+    assert( !enable ); enable;
+#endif
+}
+
 void vaTracer::ListAllThreadNames( vector<string> & outNames )
 {
     outNames.clear();
@@ -239,6 +336,9 @@ bool                        vaTracer::m_UI_TracerViewingEnabled = true;
 
 void vaTracer::Cleanup( bool soft )
 {
+    if( !soft )
+        StopStreamingCapture( );
+
     m_UI_TracerViewActiveCollect = nullptr;
     m_UI_TracerViewDisplay = nullptr;
     m_UI_ProfilingTimeToNextUpdate = 0.0f;
@@ -262,6 +362,7 @@ void vaTracer::Cleanup( bool soft )
 void vaTracer::TickImGui( vaApplicationBase & application, float deltaTime )
 {
     VA_TRACE_CPU_SCOPE( Tracer_UpdateAndDrawAndAll );
+    VA_MEMORY_TAG_SCOPE( "Tracer" );
     assert( vaThreading::IsMainThread() );
 
     if( !m_UI_TracerViewingEnabled )
@@ -274,6 +375,42 @@ void vaTracer::TickImGui( vaApplicationBase & application, float deltaTime )
         vaTracer::DumpChromeTracingReportToFile();
     if( ImGui::IsItemHovered() )  ImGui::SetTooltip( "This writes out a chrome tracing report to a file located \nin the same folder as executable - to view open Chrome tab, \nnavigate to 'chrome://tracing/' and drag & drop file into it" );
 
+    if( !IsStreamingCapture( ) )
+    {
+        if( ImGui::Button( "Start streaming capture to file", {-1, 0} ) )
+            vaTracer::StartStreamingCapture( );
+        if( ImGui::IsItemHovered() )  ImGui::SetTooltip( "Continuously captures all threads into a compact binary file located \nin the same folder as executable, with no time limit" );
+    }
+    else
+    {
+        if( ImGui::Button( "Stop streaming capture", {-1, 0} ) )
+            vaTracer::StopStreamingCapture( );
+    }
+    string lastStreamFilePath;
+    {
+        std::lock_guard<std::mutex> streamLock( s_streamMutex );
+        lastStreamFilePath = s_lastStreamFilePath;
+    }
+    if( !IsStreamingCapture( ) && lastStreamFilePath != "" )
+    {
+        if( ImGui::Button( "Convert last streaming capture to chrome tracing json", {-1, 0} ) )
+            vaTracerStreamReader::ConvertToChromeTracingJSON( lastStreamFilePath, lastStreamFilePath + ".json" );
+        if( ImGui::IsItemHovered() )  ImGui::SetTooltip( "Converts '%s' to json - to view open Chrome tab, \nnavigate to 'chrome://tracing/' (or https://ui.perfetto.dev) and drag & drop file into it", lastStreamFilePath.c_str() );
+    }
+
+#ifdef VA_TRACER_HW_COUNTERS
+    bool HWCountersEnabled = IsHWCountersEnabled( );
+    if( ImGui::Checkbox( "Capture CPU hardware counters", &HWCountersEnabled ) )
+        SetHWCountersEnabled( HWCountersEnabled );
+    if( ImGui::IsItemHovered() )  ImGui::SetTooltip( "Captures cycles, instructions, last level cache misses and branch mispredictions \n(where available on the platform) for every CPU scope; hover over a scope below to see them" );
+#endif
+
+    if( vaMemory::IsTrackingAvailable( ) && ImGui::TreeNode( "Heap allocations" ) )
+    {
+        vaMemory::TickImGui( );
+        ImGui::TreePop( );
+    }
+
     ImGui::Separator();
     
     // first time initialize 
@@ -620,6 +757,17 @@ void vaTracerView::UpdateCallback( vaTracer::Entry * timelineChunk, int timeline
                 dstNode->TimeTotalMax = ( dstNode->TimeTotalMax == -0.0 ) ? ( spanTime ) : ( std::max( dstNode->TimeTotalMax, spanTime ) );
                 dstNode->TimeTotalMin = ( dstNode->TimeTotalMin == -0.0 ) ? ( spanTime ) : ( std::min( dstNode->TimeTotalMin, spanTime ) );
                 dstNode->Instances++;
+#ifdef VA_TRACER_HW_COUNTERS
+                if( srcNode.HWCounterMask != 0 )
+                {
+                    for( int i = 0; i < vaHWCounters::Count; i++ )
+                        if( srcNode.HWCounterMask & ( 1 << i ) )
+                        {
+                            dstNode->HWTotal[i] += srcNode.HWCounters[i];
+                            dstNode->HWInstances[i]++;
+                        }
+                }
+#endif
                 dstNode->RecursionDepth = (int)currentDstStack.size( ) - 1;
                 dstNode->LastSeenAge = 0;
                 dstNode->SortOrder = m_frameSortCounter;
@@ -670,6 +818,21 @@ void vaTracerView::TickImGuiRecursive( Node* node )
             node->Opened = !node->Opened;
         node->Selected = !node->Selected;
     }
+    if( ImGui::IsItemHovered( ) )
+    {
+        string HWText;
+        for( int i = 0; i < vaHWCounters::Count; i++ )
+            if( node->HWInstances[i] > 0 )
+                HWText += vaStringTools::Format( "%-14s %12.0f per call\n", vaHWCounters::GetCounterName( i ), (double)node->HWTotal[i] / (double)node->HWInstances[i] );
+        if( node->HWInstances[vaHWCounters::Cycles] > 0 && node->HWInstances[vaHWCounters::Instructions] > 0 && node->HWTotal[vaHWCounters::Cycles] > 0 )
+        {
+            double instructions = (double)node->HWTotal[vaHWCounters::Instructions] / (double)node->HWInstances[vaHWCounters::Instructions];
+            double cycles       = (double)node->HWTotal[vaHWCounters::Cycles] / (double)node->HWInstances[vaHWCounters::Cycles];
+            HWText += vaStringTools::Format( "%-14s %12.2f\n", "IPC", instructions / cycles );
+        }
+        if( HWText != "" )
+            ImGui::SetTooltip( "%s", HWText.c_str( ) );
+    }
 
     ImGui::NextColumn( );
 
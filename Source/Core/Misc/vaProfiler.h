@@ -24,6 +24,8 @@
 
 #include "Core/vaCoreIncludes.h"
 
+#include "Core/System/vaHWCounters.h"
+
 namespace Vanilla
 {
     class vaRenderDeviceContext;
@@ -31,7 +33,13 @@ namespace Vanilla
 // enable this to use any temporary string for naming traces (name gets copied) - slower but works with custom formatting and etc.
 #define VA_TRACER_ALLOW_NON_CONST_NAMES
 
+// enable this to compile in support for capturing CPU hardware counters (cycles, instructions, cache & branch misses) for 
+// each scope; they are still only captured when enabled at runtime with vaTracer::SetHWCountersEnabled - off by default
+// as it grows every Entry by the mask + counters (40 bytes), captured or not
+// #define VA_TRACER_HW_COUNTERS
+
     class vaTracerView;
+    class vaTracerStreamWriter;
 
     // multithreaded timeline-based begin<->end tracing with built-in json output for chrome://tracing!
     // for details and extension ideas, see https://aras-p.info/blog/2017/01/23/Chrome-Tracing-as-Profiler-Frontend/ and 
@@ -51,6 +59,11 @@ namespace Vanilla
 #endif
             int                                                 Depth;          // depth used to determine inner/outer if Beginning/End-s are same
 
+#ifdef VA_TRACER_HW_COUNTERS
+            uint32                                              HWCounterMask   = 0;                // which HWCounters are valid (1 << vaHWCounters::Counter)
+            uint64                                              HWCounters[vaHWCounters::Count];    // while open these are the values at Beginning, after closing the deltas
+#endif
+
 #ifdef VA_TRACER_ALLOW_NON_CONST_NAMES
             Entry( const string & name, int depth, const double & beginning ) : Name(name), Depth(depth), Beginning(beginning), End(beginning) { }
 #endif
@@ -76,6 +89,9 @@ namespace Vanilla
 
             std::weak_ptr<vaTracerView>                         AttachedViewer;         // secured with TimelineMutex!!!
 
+            std::vector<Entry>                                  StreamPending;          // secured with TimelineMutex!!! only filled while vaTracer::IsStreamingCapture(), emptied by vaTracerStreamWriter
+            int64                                               StreamDroppedCount = 0; // secured with TimelineMutex!!!
+
             ThreadContext( const char * name, const std::thread::id & id = std::thread::id(), bool automaticFrameIncrement = true );
             ~ThreadContext( );
 
@@ -96,6 +112,14 @@ namespace Vanilla
                 auto now = vaCore::TimeFromAppStart();
                 LocalTimeline.emplace_back( name, (int)CurrentOpenStack.size( ), now );
                 CurrentOpenStack.push_back( (int)LocalTimeline.size( ) - 1 );
+#ifdef VA_TRACER_HW_COUNTERS
+                // read last so that as little of our own overhead as possible gets counted
+                if( s_HWCountersEnabled.load( std::memory_order_relaxed ) )
+                {
+                    Entry & entry = LocalTimeline.back( );
+                    entry.HWCounterMask = vaHWCounters::ReadThread( entry.HWCounters );
+                }
+#endif
             }
 
 #ifdef _DEBUG
@@ -106,6 +130,11 @@ namespace Vanilla
 
             inline void                                         BatchAddFrame( Entry * entries, int count );
 
+        private:
+            // must be called with TimelineMutex locked
+            inline void                                         StreamAppend( const Entry * entries, int count );
+        public:
+
             inline void                                         Capture( std::deque<Entry> & outEntries, bool move = true )
             {
                 std::lock_guard<std::mutex> lock( TimelineMutex );
@@ -130,6 +159,7 @@ namespace Vanilla
 
     private:
         friend class vaTracerView;
+        friend class vaTracerStreamWriter;
 
         static std::mutex                                       s_globalMutex;
         static //std::map< std::thread::id, std::weak_ptr<ThreadContext> >
@@ -137,6 +167,15 @@ namespace Vanilla
                                                                 s_threadContexts;
         static weak_ptr<ThreadContext>                          s_mainThreadContext;
         static constexpr double                                 c_maxCaptureDuration  = 5.0; // 5 seconds
+
+        // streaming capture (see vaTracerStream.h) - not limited by c_maxCaptureDuration
+        static std::atomic_bool                                 s_streamingActive;
+        static shared_ptr<vaTracerStreamWriter>                 s_streamWriter;                     // secured with s_streamMutex
+        static std::mutex                                       s_streamMutex;
+        static string                                           s_lastStreamFilePath;               // secured with s_streamMutex
+        static constexpr int                                    c_maxStreamPendingEntries = 256 * 1024;  // per thread; if the writer thread can't keep up with this, entries get dropped
+
+        static std::atomic_bool                                 s_HWCountersEnabled;                // only a hint read once per scope begin, so relaxed loads
 //
 //        static thread_local shared_ptr<Thread>                  s_threads;
 
@@ -189,6 +228,19 @@ namespace Vanilla
         static void                                             DumpChromeTracingReportToFile( double duration = c_maxCaptureDuration, bool reset = true );
         static string                                           CreateChromeTracingReport( double duration = c_maxCaptureDuration, bool reset = true );
         static void                                             ListAllThreadNames( vector<string> & outNames );
+
+        // Continuous capture of all thread contexts into a compact binary file (written from a background thread, with bounded 
+        // memory use) - use for captures longer than c_maxCaptureDuration; filePath defaults to 'TracerCaptureXXX.vatb' next to the 
+        // executable. Convert to chrome://tracing json with vaTracerStreamReader::ConvertToChromeTracingJSON.
+        static bool                                             StartStreamingCapture( const string & filePath = "" );
+        static void                                             StopStreamingCapture( );
+        static bool                                             IsStreamingCapture( )               { return s_streamingActive; }
+
+        // Capture CPU hardware counter deltas (see vaHWCounters) for every CPU scope; they get aggregated in vaTracerView and
+        // included in both json and streaming captures. Costs a counter read (a syscall on some platforms) at each scope 
+        // begin & end so only enable when needed. Requires VA_TRACER_HW_COUNTERS to be defined.
+        static void                                             SetHWCountersEnabled( bool enable );
+        static bool                                             IsHWCountersEnabled( )              { return s_HWCountersEnabled.load( std::memory_order_relaxed ); }
         //static void                                             UpdateToView( vaTracerView & outView, float historyDuration );
 
         static constexpr float                                  c_UI_ProfilingUpdateFrequency   = 1.0f;
@@ -236,6 +288,10 @@ namespace Vanilla
             double              TimeSelfAvgPerFrame = 0.0;
             int                 Instances           = 0;        // how many times was recorded during the vaTracerReport::end-beginning time span
 
+            // hardware counter totals for all Instances that had them (see vaTracer::SetHWCountersEnabled)
+            uint64              HWTotal[vaHWCounters::Count]    = { };
+            int                 HWInstances[vaHWCounters::Count]= { };
+
             int                 RecursionDepth  = 0;        // RootNode is 0
 
             vector<Node*>       ChildNodes;
@@ -267,6 +323,11 @@ namespace Vanilla
                 TimeSelfAvgPerFrame     = 0.0;
                 Instances               = 0;
                 SortOrder               = 0;
+                for( int i = 0; i < vaHWCounters::Count; i++ )
+                {
+                    HWTotal[i]          = 0;
+                    HWInstances[i]      = 0;
+                }
             }
 
             void ReleaseRecursive( vaTracerView & view )   
@@ -459,7 +520,18 @@ namespace Vanilla
         // if this triggers, you have overlapping scopes - shouldn't happen but it did so fix it please :)
         assert( verifyName == LocalTimeline[CurrentOpenStack.back( )].Name );
 #endif
-        LocalTimeline[CurrentOpenStack.back( )].End = now;
+        Entry & closingEntry = LocalTimeline[CurrentOpenStack.back( )];
+#ifdef VA_TRACER_HW_COUNTERS
+        if( closingEntry.HWCounterMask != 0 )
+        {
+            uint64 values[vaHWCounters::Count];
+            closingEntry.HWCounterMask &= vaHWCounters::ReadThread( values );
+            for( int i = 0; i < vaHWCounters::Count; i++ )
+                if( closingEntry.HWCounterMask & ( 1 << i ) )
+                    closingEntry.HWCounters[i] = values[i] - closingEntry.HWCounters[i];
+        }
+#endif
+        closingEntry.End = now;
         CurrentOpenStack.pop_back( );
 
         if( CurrentOpenStack.size( ) == 0 && ( LocalTimeline.size( ) > 20 || NextDefragTime > now ) )
@@ -472,6 +544,8 @@ namespace Vanilla
                 attachedViewer->UpdateCallback( LocalTimeline.data(), (int)LocalTimeline.size() );
 
             const int arrsize = (int)LocalTimeline.size( );
+            if( s_streamingActive )
+                StreamAppend( LocalTimeline.data(), arrsize );
             for( int i = 0; i < arrsize; i++ )
                 Timeline.emplace_back( std::move(LocalTimeline[i]) );
 
@@ -507,6 +581,8 @@ namespace Vanilla
             attachedViewer->UpdateCallback( entries, count, true );
         }
 
+        if( s_streamingActive )
+            StreamAppend( entries, count );
         for( int i = 0; i < count; i++ )
             Timeline.emplace_back( std::move(entries[i]) );
 
@@ -518,6 +594,16 @@ namespace Vanilla
         }
     }
 
+    inline void vaTracer::ThreadContext::StreamAppend( const Entry * entries, int count )
+    {
+        if( StreamPending.size( ) + count > c_maxStreamPendingEntries )
+        {
+            StreamDroppedCount += count;
+            return;
+        }
+        StreamPending.insert( StreamPending.end( ), entries, entries + count );
+    }
+
 #define VA_SCOPE_TRACE_ENABLED
 
 #ifdef VA_SCOPE_TRACE_ENABLED
@@ -0,0 +1,713 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "vaSphericalHarmonics.h"
+
+#include "Core/Misc/vaProfiler.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+// x64 always has SSE2; the scalar path is there for everything else (and handles the row tails)
+#if defined( _M_X64 ) || defined( __SSE2__ )
+#define VA_SPHERICAL_HARMONICS_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace Vanilla;
+
+namespace
+{
+    static const int        c_numSums           = vaSphericalHarmonics::c_numCoefs * 3;
+
+    // rows per work item; small enough to give vaParallel plenty of items to balance even for a single small probe
+    static const int        c_rowsPerItem       = 16;
+
+    // same as CubeHDRClamp in vaIBL.hlsl - 64512.0 is max encodeable by R11G11B10_FLOAT
+    static const float      c_hdrClampMax       = 64512.0f;
+
+    // Per-texel weights of a cube face of a given resolution (same for all 6 faces): exact solid angle and the
+    // 1/length factor that normalizes the (cx, cy, 1) face direction; see CubemapSolidAngle / CubemapGetDirectionFor
+    struct CubeFaceTable
+    {
+        int                 Dim;
+        vector<float>       CX;             // per column
+        vector<float>       CY;             // per row
+        vector<float>       InvLength;      // per texel
+        vector<float>       SolidAngle;     // per texel
+
+        explicit CubeFaceTable( int dim ) : Dim( dim ), CX( dim ), CY( dim ), InvLength( (size_t)dim * dim ), SolidAngle( (size_t)dim * dim )
+        {
+            // area of a cube face's quadrant projected onto a sphere (from "filament\libs\ibl\src\CubemapUtils.cpp")
+            auto sphereQuadrantArea = [ ]( double x, double y ) { return std::atan2( x * y, std::sqrt( x * x + y * y + 1.0 ) ); };
+
+            const double iDim = 1.0 / dim;
+            for( int i = 0; i < dim; i++ )
+            {
+                CX[i] = (float)( ( i + 0.5 ) * 2.0 * iDim - 1.0 );
+                CY[i] = -CX[i];
+            }
+            for( int y = 0; y < dim; y++ )
+            {
+                const double t = ( y + 0.5 ) * 2.0 * iDim - 1.0;
+                for( int x = 0; x < dim; x++ )
+                {
+                    const double s = ( x + 0.5 ) * 2.0 * iDim - 1.0;
+                    const double x0 = s - iDim, y0 = t - iDim, x1 = s + iDim, y1 = t + iDim;
+                    SolidAngle[(size_t)y * dim + x] = (float)( sphereQuadrantArea( x0, y0 ) - sphereQuadrantArea( x0, y1 ) - sphereQuadrantArea( x1, y0 ) + sphereQuadrantArea( x1, y1 ) );
+                    InvLength[(size_t)y * dim + x]  = (float)( 1.0 / std::sqrt( s * s + t * t + 1.0 ) );
+                }
+            }
+        }
+    };
+
+    shared_ptr<const CubeFaceTable> GetCubeFaceTable( int dim )
+    {
+        static std::mutex                                       s_mutex;
+        static std::map<int, shared_ptr<const CubeFaceTable>>   s_cache;
+
+        std::lock_guard<std::mutex> lock( s_mutex );
+        auto it = s_cache.find( dim );
+        if( it != s_cache.end( ) )
+            return it->second;
+        shared_ptr<const CubeFaceTable> table = std::make_shared<CubeFaceTable>( dim );
+        s_cache[dim] = table;
+        return table;
+    }
+
+    // Equirectangular (lat-long) weights: each texel covers dPhi * ( sin(latTop) - sin(latBottom) ) of the sphere
+    struct EquirectTable
+    {
+        vector<float>       SinPhi;         // per column
+        vector<float>       CosPhi;         // per column
+        vector<float>       SinLat;         // per row
+        vector<float>       CosLat;         // per row
+        vector<float>       RowWeight;      // per row
+
+        EquirectTable( int width, int height ) : SinPhi( width ), CosPhi( width ), SinLat( height ), CosLat( height ), RowWeight( height )
+        {
+            // inverse of DirToRectilinear in vaIBL.hlsl: u = ( phi / PI + 1 ) / 2, v = ( 1 - lat * 2 / PI ) / 2
+            for( int x = 0; x < width; x++ )
+            {
+                const double phi = ( 2.0 * ( x + 0.5 ) / width - 1.0 ) * VA_PI;
+                SinPhi[x] = (float)std::sin( phi );
+                CosPhi[x] = (float)std::cos( phi );
+            }
+            const double dPhi = 2.0 * VA_PI / width;
+            for( int y = 0; y < height; y++ )
+            {
+                const double lat        = ( 1.0 - 2.0 * ( y + 0.5 ) / height ) * VA_PI * 0.5;
+                const double latTop     = ( 1.0 - 2.0 * ( y + 0.0 ) / height ) * VA_PI * 0.5;
+                const double latBottom  = ( 1.0 - 2.0 * ( y + 1.0 ) / height ) * VA_PI * 0.5;
+                SinLat[y]       = (float)std::sin( lat );
+                CosLat[y]       = (float)std::cos( lat );
+                RowWeight[y]    = (float)( dPhi * ( std::sin( latTop ) - std::sin( latBottom ) ) );
+            }
+        }
+    };
+
+    struct WorkItem
+    {
+        int                 Probe;
+        int                 Face;
+        int                 RowBegin;
+        int                 RowEnd;
+    };
+
+    struct ProbeSetup
+    {
+        shared_ptr<const CubeFaceTable> Cube;
+        shared_ptr<const EquirectTable> Equirect;
+    };
+
+    struct RowScratch
+    {
+        vector<float>       RGB;
+        vector<float>       R, G, B;
+        vector<float>       DirX, DirY, DirZ, Weight;
+
+        void                Resize( int width )
+        {
+            if( (int)R.size( ) >= width )
+                return;
+            RGB.resize( (size_t)width * 3 );
+            R.resize( width ); G.resize( width ); B.resize( width );
+            DirX.resize( width ); DirY.resize( width ); DirZ.resize( width ); Weight.resize( width );
+        }
+    };
+
+    // non-normalized SH basis, same as ComputeShBasis in vaIBL.hlsl (written out for 3 bands)
+    inline void ComputeBasis( float x, float y, float z, float outBasis[vaSphericalHarmonics::c_numCoefs] )
+    {
+        outBasis[0] = 1.0f;
+        outBasis[1] = -y;
+        outBasis[2] = z;
+        outBasis[3] = -x;
+        outBasis[4] = 6.0f * x * y;
+        outBasis[5] = -3.0f * y * z;
+        outBasis[6] = 1.5f * z * z - 0.5f;
+        outBasis[7] = -3.0f * x * z;
+        outBasis[8] = 3.0f * ( x * x - y * y );
+    }
+
+    inline float ClampHDR( float val )
+    {
+        return ( val > 0.0f ) ? ( std::min( val, c_hdrClampMax ) ) : ( 0.0f );    // also catches NaN
+    }
+
+    // adds sum( basis(dir) * weight * color ) over the row into outSums[coef * 3 + channel]
+    void AccumulateRow( const RowScratch & row, int count, double outSums[c_numSums] )
+    {
+        float sums[c_numSums] = { };
+        int x = 0;
+
+#ifdef VA_SPHERICAL_HARMONICS_SSE2
+        {
+            const __m128 zero       = _mm_setzero_ps( );
+            const __m128 clampMax   = _mm_set1_ps( c_hdrClampMax );
+            const __m128 half       = _mm_set1_ps( 0.5f );
+            const __m128 oneHalf    = _mm_set1_ps( 1.5f );
+            const __m128 three      = _mm_set1_ps( 3.0f );
+            const __m128 six        = _mm_set1_ps( 6.0f );
+
+            __m128 acc[c_numSums];
+            for( int i = 0; i < c_numSums; i++ )
+                acc[i] = zero;
+
+            for( ; x + 4 <= count; x += 4 )
+            {
+                const __m128 dx = _mm_loadu_ps( &row.DirX[x] );
+                const __m128 dy = _mm_loadu_ps( &row.DirY[x] );
+                const __m128 dz = _mm_loadu_ps( &row.DirZ[x] );
+                const __m128 w  = _mm_loadu_ps( &row.Weight[x] );
+                // max( val, 0 ) returns 0 for NaN (second operand)
+                const __m128 r  = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( &row.R[x] ), zero ), clampMax );
+                const __m128 g  = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( &row.G[x] ), zero ), clampMax );
+                const __m128 b  = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( &row.B[x] ), zero ), clampMax );
+
+                // weighted basis
+                __m128 wb[vaSphericalHarmonics::c_numCoefs];
+                wb[0] = w;
+                wb[1] = _mm_mul_ps( _mm_sub_ps( zero, dy ), w );
+                wb[2] = _mm_mul_ps( dz, w );
+                wb[3] = _mm_mul_ps( _mm_sub_ps( zero, dx ), w );
+                wb[4] = _mm_mul_ps( _mm_mul_ps( six, _mm_mul_ps( dx, dy ) ), w );
+                wb[5] = _mm_mul_ps( _mm_sub_ps( zero, _mm_mul_ps( three, _mm_mul_ps( dy, dz ) ) ), w );
+                wb[6] = _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( oneHalf, _mm_mul_ps( dz, dz ) ), half ), w );
+                wb[7] = _mm_mul_ps( _mm_sub_ps( zero, _mm_mul_ps( three, _mm_mul_ps( dx, dz ) ) ), w );
+                wb[8] = _mm_mul_ps( _mm_mul_ps( three, _mm_sub_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ) ), w );
+
+                for( int i = 0; i < vaSphericalHarmonics::c_numCoefs; i++ )
+                {
+                    acc[i * 3 + 0] = _mm_add_ps( acc[i * 3 + 0], _mm_mul_ps( wb[i], r ) );
+                    acc[i * 3 + 1] = _mm_add_ps( acc[i * 3 + 1], _mm_mul_ps( wb[i], g ) );
+                    acc[i * 3 + 2] = _mm_add_ps( acc[i * 3 + 2], _mm_mul_ps( wb[i], b ) );
+                }
+            }
+
+            for( int i = 0; i < c_numSums; i++ )
+            {
+                alignas( 16 ) float lanes[4];
+                _mm_store_ps( lanes, acc[i] );
+                sums[i] = ( lanes[0] + lanes[1] ) + ( lanes[2] + lanes[3] );
+            }
+        }
+#endif
+
+        for( ; x < count; x++ )
+        {
+            float basis[vaSphericalHarmonics::c_numCoefs];
+            ComputeBasis( row.DirX[x], row.DirY[x], row.DirZ[x], basis );
+            const float r = ClampHDR( row.R[x] ), g = ClampHDR( row.G[x] ), b = ClampHDR( row.B[x] );
+            for( int i = 0; i < vaSphericalHarmonics::c_numCoefs; i++ )
+            {
+                const float wb = basis[i] * row.Weight[x];
+                sums[i * 3 + 0] += wb * r;
+                sums[i * 3 + 1] += wb * g;
+                sums[i * 3 + 2] += wb * b;
+            }
+        }
+
+        for( int i = 0; i < c_numSums; i++ )
+            outSums[i] += sums[i];
+    }
+
+    void ProjectRows( const vaSphericalHarmonics::Probe & probe, const ProbeSetup & setup, const WorkItem & item, double outSums[c_numSums] )
+    {
+        const vaImageMetrics::Image & image = probe.Faces[item.Face];
+        const int width = image.Width;
+
+        static thread_local RowScratch row;
+        row.Resize( width );
+
+        for( int y = item.RowBegin; y < item.RowEnd; y++ )
+        {
+            vaImageMetrics::DecodeRowLinear( image, y, row.RGB.data( ) );
+            for( int x = 0; x < width; x++ )
+            {
+                row.R[x] = row.RGB[x * 3 + 0];
+                row.G[x] = row.RGB[x * 3 + 1];
+                row.B[x] = row.RGB[x * 3 + 2];
+            }
+
+            if( setup.Cube != nullptr )
+            {
+                const CubeFaceTable & table = *setup.Cube;
+                const float cy = table.CY[y];
+                const float * invLength = &table.InvLength[(size_t)y * width];
+                const float * solidAngle = &table.SolidAngle[(size_t)y * width];
+                for( int x = 0; x < width; x++ )
+                {
+                    // same face orientation as CubemapGetDirectionFor
+                    const float il = invLength[x], nx = table.CX[x] * il, ny = cy * il;
+                    switch( item.Face )
+                    {
+                    case( 0 ): row.DirX[x] =  il; row.DirY[x] =  ny; row.DirZ[x] = -nx; break;   // PX
+                    case( 1 ): row.DirX[x] = -il; row.DirY[x] =  ny; row.DirZ[x] =  nx; break;   // NX
+                    case( 2 ): row.DirX[x] =  nx; row.DirY[x] =  il; row.DirZ[x] = -ny; break;   // PY
+                    case( 3 ): row.DirX[x] =  nx; row.DirY[x] = -il; row.DirZ[x] =  ny; break;   // NY
+                    case( 4 ): row.DirX[x] =  nx; row.DirY[x] =  ny; row.DirZ[x] =  il; break;   // PZ
+                    case( 5 ): row.DirX[x] = -nx; row.DirY[x] =  ny; row.DirZ[x] = -il; break;   // NZ
+                    default: assert( false ); break;
+                    }
+                    row.Weight[x] = solidAngle[x];
+                }
+            }
+            else
+            {
+                const EquirectTable & table = *setup.Equirect;
+                const float cosLat = table.CosLat[y], sinLat = table.SinLat[y], rowWeight = table.RowWeight[y];
+                for( int x = 0; x < width; x++ )
+                {
+                    row.DirX[x]     = cosLat * table.SinPhi[x];
+                    row.DirY[x]     = -cosLat * table.CosPhi[x];
+                    row.DirZ[x]     = sinLat;
+                    row.Weight[x]   = rowWeight;
+                }
+            }
+
+            AccumulateRow( row, width, outSums );
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Windowing and shader pre-scaling; CPU versions of the CSPostProcessSH pass in vaIBL.hlsl (both originally from
+    // "filament\libs\ibl\src\CubemapSH.cpp")
+    static inline constexpr uint32 SHindex( int32 m, uint32 l )
+    {
+        return l * ( l + 1 ) + m;
+    }
+
+    // returns n! / d!
+    static float Factorial( uint32 n, uint32 d )
+    {
+        d = std::max( uint32( 1 ), d );
+        n = std::max( uint32( 1 ), n );
+        float r = 1.0;
+        if( n > d )
+        {
+            for( ; n > d; n-- )
+                r *= n;
+        }
+        else if( d > n )
+        {
+            for( ; d > n; d-- )
+                r *= d;
+            r = 1.0f / r;
+        }
+        return r;
+    }
+
+    constexpr const double F_2_SQRTPI = 1.12837916709551257389615890312154517;
+    constexpr const double F_SQRT2    = 1.41421356237309504880168872420969808;
+    constexpr const double F_PI       = 3.14159265358979323846264338327950288;
+    constexpr const double F_1_PI     = 0.318309886183790671537767526745028724;
+    constexpr const double F_SQRT1_2  = 0.707106781186547524400844362104849039;
+    constexpr const float  M_SQRT_3   = 1.7320508076f;
+    constexpr const float  M_SQRT_PI  = 1.7724538509f;
+    constexpr const float  M_SQRT_5   = 2.2360679775f;
+    constexpr const float  M_SQRT_15  = 3.8729833462f;
+
+    // Coefficients for the polynomial form of the SH functions, from "Stupid Spherical Harmonics (SH)" by Peter-Pike Sloan
+    constexpr const float c_polynomialA[vaSphericalHarmonics::c_numCoefs] = {
+              1.0f / ( 2.0f * M_SQRT_PI ),  // 0: 0  0
+        -M_SQRT_3  / ( 2.0f * M_SQRT_PI ),  // 1: 1 -1
+         M_SQRT_3  / ( 2.0f * M_SQRT_PI ),  // 2: 1  0
+        -M_SQRT_3  / ( 2.0f * M_SQRT_PI ),  // 3: 1  1
+         M_SQRT_15 / ( 2.0f * M_SQRT_PI ),  // 4: 2 -2
+        -M_SQRT_15 / ( 2.0f * M_SQRT_PI ),  // 5: 2 -1
+         M_SQRT_5  / ( 4.0f * M_SQRT_PI ),  // 6: 2  0
+        -M_SQRT_15 / ( 2.0f * M_SQRT_PI ),  // 7: 2  1
+         M_SQRT_15 / ( 4.0f * M_SQRT_PI )   // 8: 2  2
+    };
+
+    // SH scaling factors: returns sqrt((2*l + 1) / 4*pi) * sqrt( (l-|m|)! / (l+|m|)! )
+    static float Kml( int32 m, uint32 l )
+    {
+        m = m < 0 ? -m : m;
+        const float K = ( 2 * l + 1 ) * Factorial( uint32( l - m ), uint32( l + m ) );
+        return float( std::sqrt( K ) * ( F_2_SQRTPI * 0.25 ) );
+    }
+
+    // < cos(theta) > SH coefficients pre-multiplied by 1 / K(0,l)
+    static float ComputeTruncatedCosSh( uint32 l )
+    {
+        if( l == 0 )
+            return (float)F_PI;
+        else if( l == 1 )
+            return float( 2 * F_PI / 3 );
+        else if( l & 1u )
+            return 0.0f;
+        const uint32 l_2 = l / 2;
+        float A0 = ( ( l_2 & 1u ) ? 1.0f : -1.0f ) / ( ( l + 2 ) * ( l - 1 ) );
+        float A1 = Factorial( l, l_2 ) / ( Factorial( l_2, 1 ) * ( 1 << l ) );
+        return float( 2 * F_PI * A0 * A1 );
+    }
+
+    // Windowing to mitigate ringing; see "Stupid Spherical Harmonics (SH)" and "Deringing Spherical Harmonics" by
+    // Peter-Pike Sloan (https://www.ppsloan.org/publications/shdering.pdf)
+    static float SincWindow( uint32 l, float w )
+    {
+        if( l == 0 )
+            return 1.0f;
+        else if( l >= w )
+            return 0.0f;
+
+        // sinc window scaled to the desired window size in bands units (only has zonal harmonics); taking the window
+        // to power N is equivalent to applying the filter N times
+        float x = ( float( F_PI ) * l ) / w;
+        x = std::sin( x ) / x;
+        return std::pow( x, 4.0f );
+    }
+
+    static void Multiply3( float out[3], const float M[3][3], const float x[3] )
+    {
+        out[0] = M[0][0] * x[0] + M[1][0] * x[1] + M[2][0] * x[2];
+        out[1] = M[0][1] * x[0] + M[1][1] * x[1] + M[2][1] * x[2];
+        out[2] = M[0][2] * x[0] + M[1][2] * x[1] + M[2][2] * x[2];
+    }
+
+    static void Multiply5( float out[5], const float M[5][5], const float x[5] )
+    {
+        for( int i = 0; i < 5; i++ )
+            out[i] = M[0][i] * x[0] + M[1][i] * x[1] + M[2][i] * x[2] + M[3][i] * x[3] + M[4][i] * x[4];
+    }
+
+    // projects a vec3 to SH2/k space (i.e. premultiplied by 1/k)
+    static void Project5( float out[5], const float s[3] )
+    {
+        out[0] = ( s[1] * s[0] );
+        out[1] = -( s[1] * s[2] );
+        out[2] = 1 / ( 2 * M_SQRT_3 ) * ( ( 3 * s[2] * s[2] - 1 ) );
+        out[3] = -( s[2] * s[0] );
+        out[4] = 0.5f * ( ( s[0] * s[0] - s[1] * s[1] ) );
+    }
+
+    static void RotateSphericalHarmonicBand1( float out[3], const float band1[3], const float M[3][3] )
+    {
+        // inverse of the projection of N0, N1, N2 (the unit axes) to SH space, precomputed
+        const float invA1TimesK[3][3] = {
+                {  0, -1,  0 },
+                {  0,  0,  1 },
+                { -1,  0,  0 }
+        };
+
+        const float * MN0 = M[0];  // M * N0;
+        const float * MN1 = M[1];  // M * N1;
+        const float * MN2 = M[2];  // M * N2;
+        const float R1OverK[3][3] = {
+                { -MN0[1], MN0[2], -MN0[0] },
+                { -MN1[1], MN1[2], -MN1[0] },
+                { -MN2[1], MN2[2], -MN2[0] }
+        };
+
+        float temp[3];
+        Multiply3( temp, invA1TimesK, band1 );
+        Multiply3( out, R1OverK, temp );
+    }
+
+    static void RotateSphericalHarmonicBand2( float result[5], const float band2[5], const float M[3][3] )
+    {
+        constexpr float n = (float)F_SQRT1_2;
+
+        // k * inverse( mat5{ project(N0), project(N1), project(N2), project(N3), project(N4) } ) with
+        // N0 = { 1, 0, 0 }, N1 = { 0, 0, 1 }, N2 = { n, n, 0 }, N3 = { n, 0, n }, N4 = { 0, n, n }, precomputed
+        const float invATimesK[5][5] = {
+                {    0,        1,   2,   0,  0 },
+                {   -1,        0,   0,   0, -2 },
+                {    0, M_SQRT_3,   0,   0,  0 },
+                {    1,        1,   0,  -2,  0 },
+                {    2,        1,   0,   0,  0 }
+        };
+
+        float invATimesKTimesBand2[5];
+        Multiply5( invATimesKTimesBand2, invATimesK, band2 );
+
+        float ROverK[5][5];
+        Project5( ROverK[0], M[0] );                  // M * N0
+        Project5( ROverK[1], M[2] );                  // M * N1
+        vaVector3 k0 = n * ( vaVector3( M[0] ) + vaVector3( M[1] ) );
+        vaVector3 k1 = n * ( vaVector3( M[0] ) + vaVector3( M[2] ) );
+        vaVector3 k2 = n * ( vaVector3( M[1] ) + vaVector3( M[2] ) );
+        Project5( ROverK[2], &k0.x );     // M * N2
+        Project5( ROverK[3], &k1.x );     // M * N3
+        Project5( ROverK[4], &k2.x );     // M * N4
+
+        // (R / k) * (invA * k) * band2 == R * invA * band2
+        Multiply5( result, ROverK, invATimesKTimesBand2 );
+    }
+
+    static void RotateSH3Bands( float sh[9], const vaMatrix3x3 & M )
+    {
+        const float band1[3] = { sh[1], sh[2], sh[3] };
+        const float band2[5] = { sh[4], sh[5], sh[6], sh[7], sh[8] };
+        float b1[3], b2[5];
+        RotateSphericalHarmonicBand1( b1, band1, M.m );
+        RotateSphericalHarmonicBand2( b2, band2, M.m );
+        for( int i = 0; i < 3; i++ ) sh[1 + i] = b1[i];
+        for( int i = 0; i < 5; i++ ) sh[4 + i] = b2[i];
+    }
+
+    // the function we're trying to minimize; first term accounts for ZH + |m| = 2, second for |m| = 1
+    static float SHMinFunc( float a, float b, float c, float d, float x )
+    {
+        return ( a * x * x + b * x + c ) + ( d * x * std::sqrt( 1 - x * x ) );
+    }
+
+    // func' / func''
+    static float SHMinIncrement( float a, float b, float d, float x )
+    {
+        return ( x * x - 1 ) * ( d - 2 * d * x * x + ( b + 2 * a * x ) * std::sqrt( 1 - x * x ) )
+            / ( 3 * d * x - 2 * d * x * x * x - 2 * a * std::pow( 1 - x * x, 1.5f ) );
+    }
+
+    // minimum of a single channel 3-band SH over the sphere (modifies f - rotates it to the optimal linear direction)
+    static float SHMin( float f[9] )
+    {
+        const float * A = c_polynomialA;
+
+        // rotate the SH to align Z with the optimal linear direction
+        const vaVector3 dir = vaVector3::Normalize( vaVector3{ -f[3], -f[1], f[2] } );
+        const vaVector3 z_axis = -dir;
+        const vaVector3 x_axis = vaVector3::Normalize( vaVector3::Cross( z_axis, vaVector3{ 0, 1, 0 } ) );
+        const vaVector3 y_axis = vaVector3::Cross( x_axis, z_axis );
+        const vaMatrix3x3 M = vaMatrix3x3{ x_axis, y_axis, -z_axis }.Transposed( );
+        RotateSH3Bands( f, M );
+
+        // min for |m| = 2 can be expressed as m2max * z^2 - m2max, so it's folded into the ZH min below
+        const float m2max = A[8] * std::sqrt( f[8] * f[8] + f[4] * f[4] );
+
+        // min of the zonal harmonics: derivative of a * z^2 + b * z + c is zero at -b / 2a, unless outside of [-1, 1]
+        const float a = 3 * A[6] * f[6] + m2max;
+        const float b = A[2] * f[2];
+        const float c = A[0] * f[0] - A[6] * f[6] - m2max;
+
+        const float zmin = -b / ( 2.0f * a );
+        const float m0min_z = a * zmin * zmin + b * zmin + c;
+        const float m0min_b = std::min( a + b + c, a - b + c );
+        const float m0min = ( a > 0 && zmin >= -1 && zmin <= 1 ) ? m0min_z : m0min_b;
+
+        // l = 2, |m| = 1 (l = 1, |m| = 1 is 0 because of the rotation)
+        const float d = A[4] * std::sqrt( f[5] * f[5] + f[7] * f[7] );
+
+        // the |m|=1 function is minimal in -0.5 - use that to skip the Newton's loop when possible
+        float minimum = m0min - 0.5f * d;
+        if( minimum < 0 )
+        {
+            float dz;
+            float z = float( -F_SQRT1_2 );   // start guessing at the min of |m|=1 function
+            int loopCount = 0;
+            do
+            {
+                minimum = SHMinFunc( a, b, c, d, z );
+                dz = SHMinIncrement( a, b, d, z );
+                z = z - dz;
+                loopCount++;
+            } while( ( std::abs( z ) <= 1 ) && ( std::abs( dz ) > 1e-5f ) && ( loopCount < 16 ) );
+
+            if( std::abs( z ) > 1 )
+                minimum = std::min( SHMinFunc( a, b, c, d, 1 ), SHMinFunc( a, b, c, d, -1 ) );
+        }
+        return minimum;
+    }
+
+    static void ApplyWindow( float out[9], const float f[9], float cutoff )
+    {
+        for( int i = 0; i < 9; i++ )
+            out[i] = f[i];
+        for( uint32 l = 0; l < (uint32)vaSphericalHarmonics::c_numBands; l++ )
+        {
+            const float w = SincWindow( l, cutoff );
+            out[SHindex( 0, l )] *= w;
+            for( uint32 m = 1; m <= l; m++ )
+            {
+                out[SHindex( -int32( m ), l )] *= w;
+                out[SHindex( int32( m ), l )] *= w;
+            }
+        }
+    }
+}
+
+bool vaSphericalHarmonics::Probe::IsValid( ) const
+{
+    if( Layout == LayoutType::Equirectangular )
+        return Faces[0].IsValid( );
+
+    for( int i = 0; i < 6; i++ )
+    {
+        if( !Faces[i].IsValid( ) || Faces[i].Width != Faces[i].Height || Faces[i].Width != Faces[0].Width )
+            return false;
+    }
+    return true;
+}
+
+bool vaSphericalHarmonics::Project( const Probe & probe, SH3 & outRawSH )
+{
+    vector<SH3> rawSH;
+    vector<bool> valid;
+    ProjectBatch( vector<Probe>( { probe } ), rawSH, valid );
+    outRawSH = rawSH[0];
+    return valid[0];
+}
+
+void vaSphericalHarmonics::ProjectBatch( const vector<Probe> & probes, vector<SH3> & outRawSH, vector<bool> & outValid )
+{
+    VA_TRACE_CPU_SCOPE( vaSphericalHarmonics_ProjectBatch );
+
+    SH3 zeroSH;
+    zeroSH.fill( vaVector3( 0, 0, 0 ) );
+    outRawSH.assign( probes.size( ), zeroSH );
+    outValid.assign( probes.size( ), false );
+
+    // weight tables and the list of work items (bands of rows from each face of each probe)
+    vector<ProbeSetup> setups( probes.size( ) );
+    vector<WorkItem> items;
+    for( int i = 0; i < (int)probes.size( ); i++ )
+    {
+        const Probe & probe = probes[i];
+        if( !probe.IsValid( ) )
+        {
+            VA_LOG_WARNING( "vaSphericalHarmonics::ProjectBatch - probe %d is not valid (unsupported format or mismatched face sizes), skipping", i );
+            continue;
+        }
+        outValid[i] = true;
+
+        int faceCount;
+        if( probe.Layout == Probe::LayoutType::Cubemap )
+        {
+            setups[i].Cube = GetCubeFaceTable( probe.Faces[0].Width );
+            faceCount = 6;
+        }
+        else
+        {
+            setups[i].Equirect = std::make_shared<EquirectTable>( probe.Faces[0].Width, probe.Faces[0].Height );
+            faceCount = 1;
+        }
+        for( int face = 0; face < faceCount; face++ )
+            for( int y = 0; y < probe.Faces[face].Height; y += c_rowsPerItem )
+                items.push_back( { i, face, y, std::min( y + c_rowsPerItem, probe.Faces[face].Height ) } );
+    }
+
+    vector<std::array<double, c_numSums>> partials( items.size( ) );
+    vaParallel::For( 0, (int64)items.size( ), 1, [&]( int64 begin, int64 end )
+    {
+        for( int64 i = begin; i < end; i++ )
+        {
+            partials[i].fill( 0.0 );
+            ProjectRows( probes[items[i].Probe], setups[items[i].Probe], items[i], partials[i].data( ) );
+        }
+    } );
+
+    // reduce in item order so that the result doesn't depend on how the work got scheduled
+    vector<std::array<double, c_numSums>> totals( probes.size( ) );
+    for( auto & total : totals )
+        total.fill( 0.0 );
+    for( size_t i = 0; i < items.size( ); i++ )
+        for( int j = 0; j < c_numSums; j++ )
+            totals[items[i].Probe][j] += partials[i][j];
+
+    for( size_t i = 0; i < probes.size( ); i++ )
+        for( int j = 0; j < c_numCoefs; j++ )
+            outRawSH[i][j] = vaVector3( (float)totals[i][j * 3 + 0], (float)totals[i][j * 3 + 1], (float)totals[i][j * 3 + 2] );
+}
+
+vaSphericalHarmonics::SH3 vaSphericalHarmonics::PreprocessForShader( const SH3 & rawSH )
+{
+    // SH normalization and convolution with the truncated cos (irradiance)
+    float scalingK[c_numCoefs];
+    for( uint32 l = 0; l < (uint32)c_numBands; l++ )
+    {
+        const float truncatedCosSh = ComputeTruncatedCosSh( l );
+        scalingK[SHindex( 0, l )] = Kml( 0, l ) * truncatedCosSh;
+        for( uint32 m = 1; m <= l; m++ )
+            scalingK[SHindex( -int32( m ), l )] = scalingK[SHindex( int32( m ), l )] = float( F_SQRT2 * Kml( m, l ) ) * truncatedCosSh;
+    }
+
+    float SH[3][c_numCoefs];
+    for( int channel = 0; channel < 3; channel++ )
+        for( int i = 0; i < c_numCoefs; i++ )
+            SH[channel][i] = rawSH[i][channel] * scalingK[i];
+
+    // find the largest window cutoff (in bands) that leaves no negative values, for each channel independently (as
+    // the 3 threads in CSPostProcessSH do), then use the smallest for all channels
+    const float startCutoff = (float)c_numBands * 4 + 1;
+    float cutoff = startCutoff;
+    for( int channel = 0; channel < 3; channel++ )
+    {
+        float l = (float)c_numBands;
+        float r = startCutoff;
+        for( int i = 0; i < 16 && l + 0.1f < r; i++ )
+        {
+            float m = 0.5f * ( l + r );
+            float temp[c_numCoefs];
+            ApplyWindow( temp, SH[channel], m );
+            if( SHMin( temp ) < 0 )
+                r = m;
+            else
+                l = m;
+        }
+        cutoff = std::min( cutoff, l );
+    }
+
+    // window and pre-multiply by the polynomial form factors and the lambertian diffuse BRDF 1/pi
+    SH3 ret;
+    for( int channel = 0; channel < 3; channel++ )
+    {
+        float windowed[c_numCoefs];
+        ApplyWindow( windowed, SH[channel], cutoff );
+        for( int i = 0; i < c_numCoefs; i++ )
+            ret[i][channel] = windowed[i] * float( c_polynomialA[i] * F_1_PI );
+    }
+    return ret;
+}
+
+vaVector3 vaSphericalHarmonics::EvaluateIrradiance( const SH3 & shaderSH, const vaVector3 & n )
+{
+    vaVector3 ret = shaderSH[0]
+        + shaderSH[1] * n.y
+        + shaderSH[2] * n.z
+        + shaderSH[3] * n.x
+        + shaderSH[4] * ( n.y * n.x )
+        + shaderSH[5] * ( n.y * n.z )
+        + shaderSH[6] * ( 3.0f * n.z * n.z - 1.0f )
+        + shaderSH[7] * ( n.z * n.x )
+        + shaderSH[8] * ( n.x * n.x - n.y * n.y );
+    return vaVector3::ComponentMax( ret, vaVector3( 0, 0, 0 ) );
+}
@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Core/vaCoreIncludes.h"
+#include "Core/Misc/vaImageMetrics.h"
+
+#include <array>
+
+namespace Vanilla
+{
+    // CPU projection of cubemap or equirectangular (lat-long) environment images into 3-band (9 coefficient) spherical
+    // harmonics. Matches vaIrradianceSHCalculator (same non-normalized basis, HDR clamp and windowing/post-process) so
+    // results can be used in place of the GPU ones (for ex. for offline probe baking or when importing probes from
+    // files, which avoids the GPU readback stall) or to validate them.
+    //
+    // Cubemap texels are weighted by their exact solid angle (tables are precomputed once per face resolution and
+    // cached), equirectangular texels by the exact area of their lat-long cell. All faces of all probes in a batch are
+    // split into row bands that run on vaParallel workers with SSE inner loops; the partial sums are reduced in a fixed
+    // order so the results don't depend on scheduling.
+    class vaSphericalHarmonics
+    {
+    public:
+        static const int                    c_numBands          = 3;
+        static const int                    c_numCoefs          = c_numBands * c_numBands;
+
+        typedef std::array<vaVector3, c_numCoefs>   SH3;
+
+        struct Probe
+        {
+            enum class LayoutType
+            {
+                Cubemap,                    // Faces[0..5] are +X, -X, +Y, -Y, +Z, -Z (same as D3D array slices), square and of the same size
+                Equirectangular,            // only Faces[0] is used; same mapping as CSEquirectangularToCubemap
+            };
+            LayoutType                      Layout              = LayoutType::Cubemap;
+            vaImageMetrics::Image           Faces[6];
+
+            Probe( ) { }
+            explicit Probe( const vaImageMetrics::Image & equirectangular ) : Layout( LayoutType::Equirectangular ) { Faces[0] = equirectangular; }
+            explicit Probe( const vaImageMetrics::Image cubeFaces[6] ) : Layout( LayoutType::Cubemap ) { for( int i = 0; i < 6; i++ ) Faces[i] = cubeFaces[i]; }
+
+            bool                            IsValid( ) const;
+        };
+
+    private:
+        vaSphericalHarmonics( ) { }
+
+    public:
+        // 'raw' SH (radiance projected onto the non-normalized basis, same as the output of vaIrradianceSHCalculator's
+        // first pass); returns false (and zeroes outRawSH) if the probe isn't valid
+        static bool                         Project( const Probe & probe, SH3 & outRawSH );
+
+        // projects all probes in one go; outRawSH[i] / outValid[i] belong to probes[i]
+        static void                         ProjectBatch( const vector<Probe> & probes, vector<SH3> & outRawSH, vector<bool> & outValid );
+
+        // irradiance convolution, auto-windowing (deringing) and pre-scaling by the polynomial basis factors and 1/pi:
+        // converts raw SH to what IBLProbeConstants::DiffuseSH expects (same as vaIrradianceSHCalculator::GetSH output)
+        static SH3                          PreprocessForShader( const SH3 & rawSH );
+
+        // evaluates irradiance (already divided by pi) for the given normal from PreprocessForShader output, same as
+        // Irradiance_SphericalHarmonics on the shader side
+        static vaVector3                    EvaluateIrradiance( const SH3 & shaderSH, const vaVector3 & normal );
+    };
+}
@@ -0,0 +1,439 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated 
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation 
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of 
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+
+#include "Core/Misc/vaTracerStream.h"
+
+#include <sstream>
+
+using namespace Vanilla;
+
+bool vaTracerStreamWriter::Start( const string & filePath )
+{
+    assert( !m_thread.joinable() );
+    if( m_thread.joinable() )
+        return false;
+
+    if( !m_file.Open( filePath, FileCreationMode::Create, FileAccessMode::Write ) )
+    {
+        VA_LOG_ERROR( "vaTracerStreamWriter - could not open '%s' for writing", filePath.c_str() );
+        return false;
+    }
+    m_filePath              = filePath;
+    m_stop                  = false;
+    m_writeFailed           = false;
+    m_totalEntriesWritten   = 0;
+    m_totalBytesWritten     = 0;
+    m_nextThreadID          = 0;
+    m_stringTable.clear();
+    m_threadTable.clear();
+
+    m_recordBuffer.Resize( 0 );
+    m_recordBuffer.WriteValue<uint32>( vaTracerStreamFormat::c_magic );
+    m_recordBuffer.WriteValue<uint32>( vaTracerStreamFormat::c_version );
+    FlushRecordBuffer( );
+
+    m_thread = std::thread( [this]( ) { ThreadProc( ); } );
+    return true;
+}
+
+void vaTracerStreamWriter::Stop( )
+{
+    if( !m_thread.joinable() )
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock( m_stopMutex );
+        m_stop = true;
+        m_stopCV.notify_all( );
+    }
+    m_thread.join( );
+
+    m_recordBuffer.Resize( 0 );
+    m_recordBuffer.WriteValue<uint8>( (uint8)vaTracerStreamFormat::RecordType::End );
+    FlushRecordBuffer( );
+    m_file.Close( );
+
+    m_stringTable.clear();
+    m_threadTable.clear();
+    m_collected.clear();
+    m_collected.shrink_to_fit();
+}
+
+void vaTracerStreamWriter::ThreadProc( )
+{
+    // Note: no VA_TRACE_* scopes in here - this thread should never show up in its own capture
+    std::unique_lock<std::mutex> lock( m_stopMutex );
+    while( !m_stop )
+    {
+        m_stopCV.wait_for( lock, std::chrono::milliseconds( c_flushIntervalMS ) );
+        lock.unlock( );
+        CollectAndWrite( );
+        lock.lock( );
+    }
+    lock.unlock( );
+    // one last time to catch anything that came in while stopping
+    CollectAndWrite( );
+}
+
+uint32 vaTracerStreamWriter::GetStringID( const string & name )
+{
+    auto it = m_stringTable.find( name );
+    if( it != m_stringTable.end() )
+        return it->second;
+
+    uint32 id = (uint32)m_stringTable.size();
+    m_stringTable.insert( std::make_pair( name, id ) );
+
+    m_recordBuffer.WriteValue<uint8>( (uint8)vaTracerStreamFormat::RecordType::String );
+    vaTracerStreamFormat::WriteVarUInt( m_recordBuffer, id );
+    vaTracerStreamFormat::WriteVarUInt( m_recordBuffer, name.length() );
+    m_recordBuffer.Write( name.c_str(), name.length() );
+    return id;
+}
+
+uint32 vaTracerStreamWriter::GetThreadID( const shared_ptr<vaTracer::ThreadContext> & context )
+{
+    auto it = m_threadTable.find( context );
+    if( it != m_threadTable.end( ) )
+        return it->second;
+
+    uint32 nameID = GetStringID( context->Name );
+    uint32 id = m_nextThreadID++;
+    m_threadTable.insert( std::make_pair( weak_ptr<vaTracer::ThreadContext>( context ), id ) );
+
+    m_recordBuffer.WriteValue<uint8>( (uint8)vaTracerStreamFormat::RecordType::Thread );
+    vaTracerStreamFormat::WriteVarUInt( m_recordBuffer, id );
+    vaTracerStreamFormat::WriteVarUInt( m_recordBuffer, nameID );
+    return id;
+}
+
+void vaTracerStreamWriter::CollectAndWrite( )
+{
+    vector<shared_ptr<vaTracer::ThreadContext>> contexts;
+    {
+        std::lock_guard<std::mutex> lock( vaTracer::s_globalMutex );
+        for( auto & weakContext : vaTracer::s_threadContexts )
+        {
+            shared_ptr<vaTracer::ThreadContext> context = weakContext.lock( );
+            if( context != nullptr )
+                contexts.push_back( context );
+        }
+    }
+
+    // forget dead threads so the table doesn't grow with thread churn (they'll never submit again)
+    for( auto it = m_threadTable.begin( ); it != m_threadTable.end( ); )
+    {
+        if( it->first.expired( ) )
+            it = m_threadTable.erase( it );
+        else
+            it++;
+    }
+
+    int64 droppedCount = 0;
+    for( const shared_ptr<vaTracer::ThreadContext> & context : contexts )
+    {
+        assert( m_collected.size() == 0 );
+        {
+            std::lock_guard<std::mutex> lock( context->TimelineMutex );
+            // swap so that the (already allocated) storage gets reused on both sides
+            m_collected.swap( context->StreamPending );
+            droppedCount += context->StreamDroppedCount;
+            context->StreamDroppedCount = 0;
+        }
+        if( m_collected.size() == 0 )
+            continue;
+
+        uint32 threadID = GetThreadID( context );
+
+        const int64 baseTime = vaTracerStreamFormat::TimeToNanoseconds( m_collected[0].Beginning );
+        int64 prevBegin = baseTime;
+        m_payloadBuffer.Resize( 0 );
+        for( const vaTracer::Entry & entry : m_collected )
+        {
+            const int64 begin   = vaTracerStreamFormat::TimeToNanoseconds( entry.Beginning );
+            const int64 end     = vaTracerStreamFormat::TimeToNanoseconds( entry.End );
+            uint32 nameID       = GetStringID( entry.Name );      // <- will write into m_recordBuffer ahead of the chunk if new
+
+            vaTracerStreamFormat::WriteVarInt( m_payloadBuffer, begin - prevBegin );
+            vaTracerStreamFormat::WriteVarUInt( m_payloadBuffer, (uint64)std::max<int64>( 0, end - begin ) );
+            vaTracerStreamFormat::WriteVarUInt( m_payloadBuffer, (uint64)entry.Depth );
+            vaTracerStreamFormat::WriteVarUInt( m_payloadBuffer, nameID );
+#ifdef VA_TRACER_HW_COUNTERS
+            vaTracerStreamFormat::WriteVarUInt( m_payloadBuffer, entry.HWCounterMask );
+            for( int i = 0; i < vaHWCounters::Count; i++ )
+                if( entry.HWCounterMask & ( 1 << i ) )
+                    vaTracerStreamFormat::WriteVarUInt( m_payloadBuffer, entry.HWCounters[i] );
+#else
+            vaTracerStreamFormat::WriteVarUInt( m_payloadBuffer, 0 );
+#endif
+            prevBegin = begin;
+        }
+
+        m_recordBuffer.WriteValue<uint8>( (uint8)vaTracerStreamFormat::RecordType::Chunk );
+        vaTracerStreamFormat::WriteVarUInt( m_recordBuffer, threadID );
+        vaTracerStreamFormat::WriteVarUInt( m_recordBuffer, m_collected.size() );
+        m_recordBuffer.WriteValue<int64>( baseTime );
+        vaTracerStreamFormat::WriteVarUInt( m_recordBuffer, (uint64)m_payloadBuffer.GetPosition() );
+        m_recordBuffer.Write( m_payloadBuffer.GetBuffer(), m_payloadBuffer.GetPosition() );
+
+        m_totalEntriesWritten += (int64)m_collected.size();
+        m_collected.clear( );
+
+        FlushRecordBuffer( );
+    }
+
+    if( droppedCount > 0 )
+        VA_LOG_WARNING( "vaTracerStreamWriter - writer falling behind, %d entries dropped", (int)droppedCount );
+}
+
+void vaTracerStreamWriter::FlushRecordBuffer( )
+{
+    if( m_recordBuffer.GetPosition() == 0 )
+        return;
+    if( !m_writeFailed && !m_file.Write( m_recordBuffer.GetBuffer(), m_recordBuffer.GetPosition() ) )
+    {
+        m_writeFailed = true;
+        VA_LOG_ERROR( "vaTracerStreamWriter - error writing to '%s', rest of the capture will be lost", m_filePath.c_str() );
+    }
+    m_totalBytesWritten += m_recordBuffer.GetPosition();
+    m_recordBuffer.Resize( 0 );
+}
+
+bool vaTracerStreamReader::Open( const string & filePath )
+{
+    m_stringTable.clear();
+    m_threads.clear();
+    m_endReached = false;
+
+    if( !m_file.Open( filePath, FileCreationMode::Open, FileAccessMode::Read ) )
+        return false;
+
+    uint32 magic, version;
+    if( !m_file.ReadValue<uint32>( magic ) || !m_file.ReadValue<uint32>( version ) || magic != vaTracerStreamFormat::c_magic )
+    {
+        VA_LOG_ERROR( "vaTracerStreamReader - '%s' is not a tracer stream file", filePath.c_str() );
+        m_file.Close();
+        return false;
+    }
+    if( version < 1 || version > vaTracerStreamFormat::c_version )
+    {
+        VA_LOG_ERROR( "vaTracerStreamReader - '%s' has unsupported version %d", filePath.c_str(), (int)version );
+        m_file.Close();
+        return false;
+    }
+    m_version = version;
+    return true;
+}
+
+// records are small and varint-encoded so read them from the file byte by byte; the bulk of the data (chunk payloads) is read in one go
+static bool ReadVarUIntFromStream( vaStream & stream, uint64 & outValue )
+{
+    outValue = 0;
+    for( int shift = 0; shift < 64; shift += 7 )
+    {
+        uint8 byte;
+        if( !stream.ReadValue<uint8>( byte ) )
+            return false;
+        outValue |= (uint64)(byte & 0x7F) << shift;
+        if( (byte & 0x80) == 0 )
+            return true;
+    }
+    return false;
+}
+
+bool vaTracerStreamReader::ReadNextChunk( uint32 & outThreadID, vector<vaTracer::Entry> & outEntries )
+{
+    outEntries.clear();
+    if( m_endReached || !m_file.IsOpen() )
+        return false;
+
+    while( true )
+    {
+        uint8 recordType;
+        if( !m_file.ReadValue<uint8>( recordType ) )
+        {
+            VA_LOG_WARNING( "vaTracerStreamReader - stream ended without an end record (capture not stopped properly?)" );
+            m_endReached = true;
+            return false;
+        }
+
+        switch( (vaTracerStreamFormat::RecordType)recordType )
+        {
+        case vaTracerStreamFormat::RecordType::End:
+        {
+            m_endReached = true;
+            return false;
+        }
+        case vaTracerStreamFormat::RecordType::String:
+        {
+            uint64 id, length;
+            if( !ReadVarUIntFromStream( m_file, id ) || !ReadVarUIntFromStream( m_file, length ) || id != m_stringTable.size() )
+                break;
+            string name( (size_t)length, '\0' );
+            if( length > 0 && !m_file.Read( &name[0], (int64)length ) )
+                break;
+            m_stringTable.push_back( std::move( name ) );
+            continue;
+        }
+        case vaTracerStreamFormat::RecordType::Thread:
+        {
+            uint64 id, nameID;
+            if( !ReadVarUIntFromStream( m_file, id ) || !ReadVarUIntFromStream( m_file, nameID ) || nameID >= m_stringTable.size() )
+                break;
+            if( id >= m_threads.size() )
+                m_threads.resize( (size_t)id + 1 );
+            m_threads[(size_t)id].Name = m_stringTable[(size_t)nameID];
+            continue;
+        }
+        case vaTracerStreamFormat::RecordType::Chunk:
+        {
+            uint64 threadID, entryCount, payloadSize; int64 baseTime;
+            if( !ReadVarUIntFromStream( m_file, threadID ) || !ReadVarUIntFromStream( m_file, entryCount ) || !m_file.ReadValue<int64>( baseTime ) || !ReadVarUIntFromStream( m_file, payloadSize ) || threadID >= m_threads.size() )
+                break;
+            m_payload.resize( (size_t)payloadSize );
+            if( payloadSize > 0 && !m_file.Read( m_payload.data(), (int64)payloadSize ) )
+                break;
+
+            const uint8 * data      = m_payload.data();
+            const uint8 * dataEnd   = data + m_payload.size();
+            int64 prevBegin         = baseTime;
+            outEntries.resize( (size_t)entryCount );
+            bool payloadOK = true;
+            for( size_t i = 0; i < outEntries.size() && payloadOK; i++ )
+            {
+                int64 beginDelta; uint64 duration, depth, nameID;
+                payloadOK = vaTracerStreamFormat::ReadVarInt( data, dataEnd, beginDelta ) && vaTracerStreamFormat::ReadVarUInt( data, dataEnd, duration )
+                    && vaTracerStreamFormat::ReadVarUInt( data, dataEnd, depth ) && vaTracerStreamFormat::ReadVarUInt( data, dataEnd, nameID ) && nameID < m_stringTable.size();
+                if( !payloadOK )
+                    break;
+                uint64 HWCounterMask = 0;
+                uint64 HWCounters[vaHWCounters::Count] = { };
+                if( m_version >= 2 )
+                {
+                    payloadOK = vaTracerStreamFormat::ReadVarUInt( data, dataEnd, HWCounterMask ) && HWCounterMask < ( 1 << vaHWCounters::Count );
+                    for( int c = 0; c < vaHWCounters::Count && payloadOK; c++ )
+                        if( HWCounterMask & ( 1 << c ) )
+                            payloadOK = vaTracerStreamFormat::ReadVarUInt( data, dataEnd, HWCounters[c] );
+                    if( !payloadOK )
+                        break;
+                }
+                const int64 begin       = prevBegin + beginDelta;
+                prevBegin               = begin;
+                vaTracer::Entry & entry = outEntries[i];
+                entry.Name              = m_stringTable[(size_t)nameID];
+                entry.Depth             = (int)depth;
+                entry.Beginning         = begin * 1e-9;
+                entry.End               = (begin + (int64)duration) * 1e-9;
+#ifdef VA_TRACER_HW_COUNTERS
+                entry.HWCounterMask     = (uint32)HWCounterMask;
+                for( int c = 0; c < vaHWCounters::Count; c++ )
+                    entry.HWCounters[c] = ( HWCounterMask & ( 1 << c ) ) ? ( HWCounters[c] ) : ( 0 );
+#endif
+            }
+            if( !payloadOK )
+                break;
+            outThreadID = (uint32)threadID;
+            return true;
+        }
+        default:
+            break;
+        }
+
+        // if we got here, something's wrong with the data
+        VA_LOG_ERROR( "vaTracerStreamReader - corrupted stream" );
+        outEntries.clear();
+        m_endReached = true;
+        return false;
+    }
+}
+
+bool vaTracerStreamReader::ConvertToChromeTracingJSON( const string & inBinaryFilePath, const string & outJSONFilePath )
+{
+    vaTracerStreamReader reader;
+    if( !reader.Open( inBinaryFilePath ) )
+        return false;
+
+    vaFileStream fileOut;
+    if( !fileOut.Open( outJSONFilePath, FileCreationMode::Create, FileAccessMode::Write ) )
+    {
+        VA_LOG_ERROR( "Could not open tracing report file '%s'", outJSONFilePath.c_str( ) );
+        return false;
+    }
+
+    const std::streamoff flushThreshold = 1024 * 1024;
+    std::stringstream os;
+    os.precision( 12 );
+    os << '[';
+
+    bool first = true;
+    uint32 threadID;
+    vector<vaTracer::Entry> entries;
+    int64 totalEntries = 0;
+    while( reader.ReadNextChunk( threadID, entries ) )
+    {
+        const string & threadName = reader.GetThreadInfo( threadID ).Name;
+        for( const vaTracer::Entry & entry : entries )
+        {
+            if( !first )
+                os << ',';
+            first = false;
+            // same layout as vaTracer::CreateChromeTracingReport except the time is absolute (from app start)
+            os << '{' << "\"cat\":\"va\"," << "\"name\":\"" << entry.Name << "\"," << "\"ph\":\"X\"," << "\"pid\":1,"
+               << "\"tid\":\"" << threadName << "\","
+               << "\"ts\":" << entry.Beginning * 1000000.0 << ','
+               << "\"dur\":" << ( entry.End - entry.Beginning ) * 1000000.0;
+#ifdef VA_TRACER_HW_COUNTERS
+            if( entry.HWCounterMask != 0 )
+            {
+                os << ",\"args\":{";
+                bool firstArg = true;
+                for( int i = 0; i < vaHWCounters::Count; i++ )
+                {
+                    if( ( entry.HWCounterMask & ( 1 << i ) ) == 0 )
+                        continue;
+                    os << ( ( firstArg ) ? ( "" ) : ( "," ) ) << '"' << vaHWCounters::GetCounterName( i ) << "\":" << entry.HWCounters[i];
+                    firstArg = false;
+                }
+                os << '}';
+            }
+#endif
+            os << '}';
+        }
+        totalEntries += (int64)entries.size();
+
+        if( os.tellp( ) > flushThreshold )
+        {
+            if( !fileOut.WriteTXT( os.str( ) ) )
+            {
+                VA_LOG_ERROR( "Could not write tracing report to '%s'", outJSONFilePath.c_str( ) );
+                return false;
+            }
+            os.str( "" );
+        }
+    }
+    os << "]\n";
+    if( !fileOut.WriteTXT( os.str( ) ) )
+    {
+        VA_LOG_ERROR( "Could not write tracing report to '%s'", outJSONFilePath.c_str( ) );
+        return false;
+    }
+
+    VA_LOG_SUCCESS( "Converted %d tracer entries from '%s' to '%s' - to view open Chrome tab, navigate to 'chrome://tracing/' (or https://ui.perfetto.dev) and drag & drop file into it", 
+        (int)totalEntries, inBinaryFilePath.c_str(), outJSONFilePath.c_str() );
+    return true;
+}
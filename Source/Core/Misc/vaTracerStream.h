@@ -0,0 +1,173 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated 
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation 
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of 
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+
+#pragma once
+
+#include "Core/vaCoreIncludes.h"
+
+#include "Core/System/vaFileStream.h"
+#include "Core/System/vaMemoryStream.h"
+
+#include "Core/Misc/vaProfiler.h"
+
+// Compact streaming binary format for vaTracer captures that can run for any length of time with bounded memory use.
+// 
+// File layout is a 'VATB' header followed by a sequence of records, each starting with a uint8 RecordType:
+//  * String    - varint id, varint length, name bytes        (string table - emitted once, before the first use)
+//  * Thread    - varint id, varint name string id            (thread table - emitted once, before the first use)
+//  * Chunk     - varint thread id, varint entry count, int64 base time (ns), varint payload size, payload
+//                payload per entry: zigzag varint begin delta (from previous begin or base time), varint duration, 
+//                varint depth, varint name string id, varint hardware counter mask (version 2+) followed by a varint 
+//                for each counter in the mask (see vaHWCounters)
+//  * End       - end of stream; a file without it was not closed properly but all complete chunks before that are still readable
+// 
+// All times are in nanoseconds from vaCore::TimeFromAppStart() zero.
+
+namespace Vanilla
+{
+    class vaTracerStreamFormat
+    {
+    public:
+        static constexpr uint32                             c_magic                 = 'BTAV';   // "VATB" in the file
+        static constexpr uint32                             c_version               = 2;        // version 1 had no hardware counters; still readable
+
+        enum class RecordType : uint8
+        {
+            End                 = 0,
+            String              = 1,
+            Thread              = 2,
+            Chunk               = 3,
+        };
+
+        static inline void                                  WriteVarUInt( vaMemoryStream & stream, uint64 value )
+        {
+            uint8 buffer[10]; int count = 0;
+            do 
+            {
+                uint8 byte = (uint8)(value & 0x7F);
+                value >>= 7;
+                buffer[count++] = byte | ((value != 0)?(0x80):(0));
+            } while( value != 0 );
+            stream.Write( buffer, count );
+        }
+        static inline void                                  WriteVarInt( vaMemoryStream & stream, int64 value )     { WriteVarUInt( stream, ((uint64)value << 1) ^ (uint64)(value >> 63) ); }
+
+        static inline bool                                  ReadVarUInt( const uint8 * & data, const uint8 * dataEnd, uint64 & outValue )
+        {
+            outValue = 0;
+            for( int shift = 0; shift < 64 && data < dataEnd; shift += 7 )
+            {
+                uint8 byte = *(data++);
+                outValue |= (uint64)(byte & 0x7F) << shift;
+                if( (byte & 0x80) == 0 )
+                    return true;
+            }
+            return false;
+        }
+        static inline bool                                  ReadVarInt( const uint8 * & data, const uint8 * dataEnd, int64 & outValue )
+        {
+            uint64 value;
+            if( !ReadVarUInt( data, dataEnd, value ) )
+                return false;
+            outValue = (int64)(value >> 1) ^ -(int64)(value & 1);
+            return true;
+        }
+
+        static inline int64                                 TimeToNanoseconds( double time )        { return (int64)std::llround( time * 1e9 ); }
+    };
+
+    // Collects entries from all vaTracer thread contexts on a background thread and writes them out in chunks - 
+    // use through vaTracer::StartStreamingCapture / StopStreamingCapture.
+    class vaTracerStreamWriter
+    {
+        vaFileStream                                        m_file;
+        string                                              m_filePath;
+
+        std::thread                                         m_thread;
+        std::mutex                                          m_stopMutex;
+        std::condition_variable                             m_stopCV;
+        bool                                                m_stop                  = false;
+
+        // below only used by the writer thread
+        map<string, uint32>                                 m_stringTable;
+        map< weak_ptr<vaTracer::ThreadContext>, uint32, std::owner_less<weak_ptr<vaTracer::ThreadContext>> >
+                                                            m_threadTable;
+        uint32                                              m_nextThreadID          = 0;
+        vaMemoryStream                                      m_recordBuffer;
+        vaMemoryStream                                      m_payloadBuffer;
+        vector<vaTracer::Entry>                             m_collected;
+
+        int64                                               m_totalEntriesWritten   = 0;
+        int64                                               m_totalBytesWritten     = 0;
+        bool                                                m_writeFailed           = false;
+
+    public:
+        static constexpr int                                c_flushIntervalMS       = 100;
+
+    public:
+        vaTracerStreamWriter( )                             : m_recordBuffer( (int64)0, (int64)64 * 1024 ), m_payloadBuffer( (int64)0, (int64)64 * 1024 ) { }
+        ~vaTracerStreamWriter( )                            { assert( !m_thread.joinable() ); }
+
+        bool                                                Start( const string & filePath );
+        void                                                Stop( );
+
+        const string &                                      GetFilePath( ) const                    { return m_filePath; }
+        int64                                               GetTotalEntriesWritten( ) const         { return m_totalEntriesWritten; }   // only valid after Stop
+        int64                                               GetTotalBytesWritten( ) const           { return m_totalBytesWritten; }     // only valid after Stop
+
+    private:
+        void                                                ThreadProc( );
+        void                                                CollectAndWrite( );
+        uint32                                              GetStringID( const string & name );
+        uint32                                              GetThreadID( const shared_ptr<vaTracer::ThreadContext> & context );
+        void                                                FlushRecordBuffer( );
+    };
+
+    // Reads back a stream written with vaTracerStreamWriter
+    class vaTracerStreamReader
+    {
+    public:
+        struct ThreadInfo
+        {
+            string                                          Name;
+        };
+
+    private:
+        vaFileStream                                        m_file;
+        vector<string>                                      m_stringTable;
+        vector<ThreadInfo>                                  m_threads;
+        vector<uint8>                                       m_payload;
+        uint32                                              m_version               = 0;
+        bool                                                m_endReached            = false;
+
+    public:
+        bool                                                Open( const string & filePath );
+
+        // reads the next chunk of entries (and any string/thread table records preceding it); returns false at the end of the stream
+        bool                                                ReadNextChunk( uint32 & outThreadID, vector<vaTracer::Entry> & outEntries );
+
+        const ThreadInfo &                                  GetThreadInfo( uint32 threadID ) const  { return m_threads[threadID]; }
+        bool                                                IsEndReached( ) const                   { return m_endReached; }
+
+    public:
+        // Converts the binary stream into a chrome://tracing (also readable by https://ui.perfetto.dev) JSON file; output is written 
+        // out progressively so the conversion itself does not need to hold the whole capture in memory.
+        static bool                                         ConvertToChromeTracingJSON( const string & inBinaryFilePath, const string & outJSONFilePath );
+    };
+
+}
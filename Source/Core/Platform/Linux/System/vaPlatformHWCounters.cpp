@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated 
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation 
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of 
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Core/System/vaHWCounters.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace Vanilla;
+
+// All counters are opened as one group (cycles is the leader) so they get scheduled onto the PMU together and can be 
+// read with a single read() syscall. Counters that fail to open (not supported by the CPU/VM, or perf_event_paranoid 
+// too restrictive) are simply left out of the mask.
+
+namespace
+{
+    struct ThreadCounters
+    {
+        bool                    Initialized     = false;
+        int                     LeaderFD        = -1;
+        int                     FDs[vaHWCounters::Count];
+        int                     ReadOrder[vaHWCounters::Count];     // counter index for each value in the group read, in the order they were added
+        int                     OpenCount       = 0;
+        uint32                  Mask            = 0;
+
+        ThreadCounters( )       { for( int i = 0; i < vaHWCounters::Count; i++ ) FDs[i] = -1; }
+        ~ThreadCounters( )
+        {
+            for( int i = 0; i < vaHWCounters::Count; i++ )
+                if( FDs[i] != -1 )
+                    ::close( FDs[i] );
+        }
+
+        void Initialize( )
+        {
+            Initialized = true;
+
+            static const uint64 configs[vaHWCounters::Count] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+            for( int i = 0; i < vaHWCounters::Count; i++ )
+            {
+                perf_event_attr attr;
+                memset( &attr, 0, sizeof( attr ) );
+                attr.type           = PERF_TYPE_HARDWARE;
+                attr.size           = sizeof( attr );
+                attr.config         = configs[i];
+                attr.disabled       = ( LeaderFD == -1 ) ? ( 1 ) : ( 0 );     // leader starts disabled, members follow the leader
+                attr.exclude_kernel = 1;
+                attr.exclude_hv     = 1;
+                attr.read_format    = PERF_FORMAT_GROUP;
+
+                // pid 0 / cpu -1: calling thread, any CPU
+                int fd = (int)::syscall( __NR_perf_event_open, &attr, 0, -1, LeaderFD, 0 );
+                if( fd == -1 )
+                    continue;
+                if( LeaderFD == -1 )
+                    LeaderFD = fd;
+                FDs[i]                  = fd;
+                ReadOrder[OpenCount++]  = i;
+                Mask                   |= 1 << i;
+            }
+            if( LeaderFD != -1 )
+            {
+                ::ioctl( LeaderFD, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+                ::ioctl( LeaderFD, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+            }
+        }
+    };
+
+    static thread_local ThreadCounters  s_threadCounters;
+}
+
+uint32 vaHWCounters::ReadThread( uint64 (&outValues)[Count] )
+{
+    ThreadCounters & counters = s_threadCounters;
+    if( !counters.Initialized )
+        counters.Initialize( );
+    if( counters.LeaderFD == -1 )
+        return 0;
+
+    // PERF_FORMAT_GROUP layout: u64 nr, followed by nr values
+    uint64 buffer[1 + Count];
+    ssize_t bytesRead = ::read( counters.LeaderFD, buffer, sizeof( uint64 ) * ( 1 + counters.OpenCount ) );
+    if( bytesRead < (ssize_t)sizeof( uint64 ) || buffer[0] != (uint64)counters.OpenCount )
+        return 0;
+
+    for( int i = 0; i < counters.OpenCount; i++ )
+        outValues[counters.ReadOrder[i]] = buffer[1 + i];
+    return counters.Mask;
+}
+
+uint32 vaHWCounters::GetAvailableMask( )
+{
+    if( !s_threadCounters.Initialized )
+        s_threadCounters.Initialize( );
+    return s_threadCounters.Mask;
+}
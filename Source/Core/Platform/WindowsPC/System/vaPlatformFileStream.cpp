@@ -34,6 +34,9 @@ vaFileStream::vaFileStream( )
 {
     m_file = 0;
     m_accessMode = FileAccessMode::Default;
+    m_position = 0;
+    m_mapping = NULL;
+    m_mappedView = nullptr;
 }
 vaFileStream::~vaFileStream( void )
 {
@@ -84,6 +87,33 @@ static std::wstring GetLastErrorAsStringW( )
     return message;
 }
 //
+// The file handle is opened with FILE_FLAG_OVERLAPPED so that ReadAt/WriteAt from different threads don't share (and 
+// race on) the file pointer; the OS then doesn't maintain the position, so every read/write is issued at an explicit 
+// offset and vaFileStream keeps the stream position in m_position.
+static bool OverlappedIO( HANDLE file, bool write, int64 position, void * buffer, int64 count, DWORD & outTransferred )
+{
+    // one event per thread is enough as each call waits for its request to complete
+    struct ThreadEvent
+    {
+        HANDLE  Event   = ::CreateEventW( NULL, TRUE, FALSE, NULL );
+        ~ThreadEvent( ) { if( Event != NULL ) ::CloseHandle( Event ); }
+    };
+    static thread_local ThreadEvent threadEvent;
+
+    OVERLAPPED overlapped = { };
+    overlapped.Offset       = (DWORD)( position & 0xFFFFFFFF );
+    overlapped.OffsetHigh   = (DWORD)( position >> 32 );
+    overlapped.hEvent       = threadEvent.Event;
+
+    outTransferred = 0;
+    BOOL started = ( write ) ? ( ::WriteFile( file, buffer, (DWORD)count, NULL, &overlapped ) ) : ( ::ReadFile( file, buffer, (DWORD)count, NULL, &overlapped ) );
+    if( !started && ::GetLastError( ) != ERROR_IO_PENDING )
+        return ::GetLastError( ) == ERROR_HANDLE_EOF;       // reading at or past the end just reads nothing
+    if( !::GetOverlappedResult( file, &overlapped, &outTransferred, TRUE ) )
+        return ::GetLastError( ) == ERROR_HANDLE_EOF;
+    return true;
+}
+//
 bool vaFileStream::Open( const wchar_t * filePath, FileCreationMode::Enum creationMode, FileAccessMode::Enum accessMode, FileShareMode::Enum shareMode )
 {
     if( IsOpen( ) ) return false;
@@ -147,7 +177,7 @@ bool vaFileStream::Open( const wchar_t * filePath, FileCreationMode::Enum creati
     wstring longFilePath = vaFileTools::GetAbsolutePath( vaFileTools::CleanupPath(filePath, false) );
 
     longFilePath = L"\\\\?\\" + longFilePath;
-    m_file = ::CreateFileW( longFilePath.c_str(), dwDesiredAccess, dwShareMode, NULL, dwCreationDisposition, FILE_ATTRIBUTE_NORMAL, NULL );
+    m_file = ::CreateFileW( longFilePath.c_str(), dwDesiredAccess, dwShareMode, NULL, dwCreationDisposition, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, NULL );
 
     if( m_file == INVALID_HANDLE_VALUE )
     {
@@ -158,6 +188,7 @@ bool vaFileStream::Open( const wchar_t * filePath, FileCreationMode::Enum creati
     }
 
     m_accessMode = accessMode;
+    m_position = 0;
 
     if( creationMode == FileCreationMode::Append )
     {
@@ -177,6 +208,10 @@ void vaFileStream::Truncate( )
 {
     VA_ASSERT( ( m_accessMode & FileAccessMode::Write ) != 0, L"File not opened for writing" );
 
+    // SetEndOfFile uses the OS file pointer, which isn't kept up to date for overlapped handles
+    LARGE_INTEGER pos;
+    pos.QuadPart = (LONGLONG)m_position;
+    ::SetFilePointerEx( m_file, pos, NULL, FILE_BEGIN );
     ::SetEndOfFile( m_file );
 }
 //
@@ -187,8 +222,9 @@ bool vaFileStream::Read( void * buffer, int64 count, int64 * outCountRead )
     VA_ASSERT( count < INT_MAX, L"File system current doesn't support reads bigger than INT_MAX" );
 
     DWORD dwRead;
-    if( !::ReadFile( m_file, buffer, (DWORD)count, &dwRead, NULL ) )
+    if( !OverlappedIO( m_file, false, m_position, buffer, count, dwRead ) )
         return false;
+    m_position += dwRead;
 
     if( outCountRead == NULL )
     {
@@ -208,8 +244,9 @@ bool vaFileStream::Write( const void * buffer, int64 count, int64 * outCountWrit
     VA_ASSERT( count < INT_MAX, L"File system current doesn't support writes bigger than INT_MAX" );
 
     DWORD dwWritten;
-    if( !::WriteFile( m_file, buffer, (DWORD)count, &dwWritten, NULL ) )
+    if( !OverlappedIO( m_file, true, m_position, const_cast<void*>( buffer ), count, dwWritten ) )
         return false;
+    m_position += dwWritten;
 
     if( outCountWritten == NULL )
     {
@@ -226,14 +263,13 @@ void vaFileStream::Seek( int64 position )
 {
     assert( position >= 0 );
 
-    LARGE_INTEGER pos;
-    pos.QuadPart = (LONGLONG)position;
-    LARGE_INTEGER outPos;
-    ::SetFilePointerEx( m_file, pos, &outPos, FILE_BEGIN );
+    m_position = position;
 }
 //
 void vaFileStream::Close( )
 {
+    Unmap( );
+
     if( m_file == NULL ) return;
 
     if( !::CloseHandle( m_file ) )
@@ -243,6 +279,7 @@ void vaFileStream::Close( )
     }
     m_file = NULL;
     m_accessMode = FileAccessMode::Default;
+    m_position = 0;
 }
 //
 bool vaFileStream::IsOpen( ) const
@@ -260,16 +297,73 @@ int64 vaFileStream::GetLength( )
 //
 int64 vaFileStream::GetPosition( ) const
 {
-    LARGE_INTEGER pos;
-    pos.QuadPart = 0;
-    LARGE_INTEGER outPos;
-    ::SetFilePointerEx( m_file, pos, &outPos, FILE_CURRENT );
-    return (int64)outPos.QuadPart;
+    return m_position;
 }
 //
 void vaFileStream::Flush( )
 {
     ::FlushFileBuffers( m_file );
 }
+//
+bool vaFileStream::ReadAt( int64 position, void * buffer, int64 count )
+{
+    VA_ASSERT( count > 0, L"count parameter must be > 0" );
+    VA_ASSERT( ( m_accessMode & FileAccessMode::Read ) != 0, L"File not opened for reading" );
+    VA_ASSERT( count < INT_MAX, L"File system current doesn't support reads bigger than INT_MAX" );
+
+    DWORD dwRead;
+    if( !OverlappedIO( m_file, false, position, buffer, count, dwRead ) )
+        return false;
+    return count == (int)dwRead;
+}
+//
+bool vaFileStream::WriteAt( int64 position, const void * buffer, int64 count )
+{
+    VA_ASSERT( count > 0, L"count parameter must be > 0" );
+    VA_ASSERT( ( m_accessMode & FileAccessMode::Write ) != 0, L"File not opened for writing" );
+    VA_ASSERT( count < INT_MAX, L"File system current doesn't support writes bigger than INT_MAX" );
+
+    DWORD dwWritten;
+    if( !OverlappedIO( m_file, true, position, const_cast<void*>( buffer ), count, dwWritten ) )
+        return false;
+    return count == (int)dwWritten;
+}
+//
+const void * vaFileStream::MapForReading( )
+{
+    if( m_mappedView != nullptr )
+        return m_mappedView;
+
+    VA_ASSERT( ( m_accessMode & FileAccessMode::Read ) != 0, L"File not opened for reading" );
+    if( m_file == NULL || GetLength( ) == 0 )
+        return nullptr;
+
+    m_mapping = ::CreateFileMappingW( m_file, NULL, PAGE_READONLY, 0, 0, NULL );
+    if( m_mapping == NULL )
+    {
+        wstring errorStr = GetLastErrorAsStringW( );
+        VA_LOG( L"vaFileStream::MapForReading( ) - error with CreateFileMapping: %s", errorStr.c_str( ) );
+        return nullptr;
+    }
+    m_mappedView = ::MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 );
+    if( m_mappedView == nullptr )
+    {
+        wstring errorStr = GetLastErrorAsStringW( );
+        VA_LOG( L"vaFileStream::MapForReading( ) - error with MapViewOfFile: %s", errorStr.c_str( ) );
+        ::CloseHandle( m_mapping );
+        m_mapping = NULL;
+    }
+    return m_mappedView;
+}
+//
+void vaFileStream::Unmap( )
+{
+    if( m_mappedView != nullptr )
+        ::UnmapViewOfFile( m_mappedView );
+    if( m_mapping != NULL )
+        ::CloseHandle( m_mapping );
+    m_mappedView = nullptr;
+    m_mapping = NULL;
+}
 
 //////////////////////////////////////////////////////////////////////////////
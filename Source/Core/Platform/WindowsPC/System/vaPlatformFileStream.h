@@ -27,6 +27,7 @@ typedef struct _iobuf FILE;
 namespace Vanilla
 {
    typedef HANDLE                vaPlatformFileStreamType;
+   typedef HANDLE                vaPlatformFileMappingType;
 
 }
 
@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated 
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation 
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of 
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Core/System/vaHWCounters.h"
+
+using namespace Vanilla;
+
+// Only the cycle counter is accessible from user mode on Windows; it is per-thread (excludes time the thread was not
+// scheduled) which makes it the most useful of the lot anyway. Instructions/cache/branch counters would need a kernel 
+// driver or an ETW PMC session, neither of which is something we want to depend on.
+
+uint32 vaHWCounters::ReadThread( uint64 (&outValues)[Count] )
+{
+    ULONG64 cycles = 0;
+    if( !::QueryThreadCycleTime( ::GetCurrentThread( ), &cycles ) )
+        return 0;
+    outValues[Cycles] = (uint64)cycles;
+    return 1 << Cycles;
+}
+
+uint32 vaHWCounters::GetAvailableMask( )
+{
+    uint64 values[Count];
+    return ReadThread( values );
+}
@@ -36,6 +36,67 @@ void vaThreading::YieldProcessor( )
     ::YieldProcessor( );
 }
 
+namespace
+{
+    struct FiberStartInfo
+    {
+        void                ( * Entry )( void * userData );
+        void *              UserData;
+    };
+
+    static VOID CALLBACK FiberTrampoline( LPVOID parameter )
+    {
+        FiberStartInfo startInfo = *reinterpret_cast<FiberStartInfo*>( parameter );
+        delete reinterpret_cast<FiberStartInfo*>( parameter );
+        startInfo.Entry( startInfo.UserData );
+        
+        // returning from a fiber function exits the thread
+        assert( false );
+    }
+}
+
+vaThreading::FiberHandle vaThreading::FiberConvertCurrentThread( bool & outConverted )
+{
+    if( ::IsThreadAFiber( ) )
+    {
+        outConverted = false;
+        return ::GetCurrentFiber( );
+    }
+    FiberHandle fiber = ::ConvertThreadToFiberEx( nullptr, FIBER_FLAG_FLOAT_SWITCH );
+    assert( fiber != nullptr );
+    outConverted = fiber != nullptr;
+    return fiber;
+}
+
+void vaThreading::FiberRevertCurrentThread( )
+{
+    BOOL ok = ::ConvertFiberToThread( );
+    assert( ok ); ok;
+}
+
+vaThreading::FiberHandle vaThreading::FiberCreate( size_t stackSize, void ( * entry )( void * userData ), void * userData )
+{
+    FiberStartInfo * startInfo = new FiberStartInfo{ entry, userData };
+    FiberHandle fiber = ::CreateFiberEx( stackSize, stackSize, FIBER_FLAG_FLOAT_SWITCH, FiberTrampoline, startInfo );
+    if( fiber == nullptr )
+    {
+        assert( false );
+        delete startInfo;
+    }
+    return fiber;
+}
+
+void vaThreading::FiberDelete( FiberHandle fiber )
+{
+    assert( fiber != ::GetCurrentFiber( ) );
+    ::DeleteFiber( fiber );
+}
+
+void vaThreading::FiberSwitchTo( FiberHandle fiber )
+{
+    ::SwitchToFiber( fiber );
+}
+
 typedef BOOL( WINAPI *LPFN_GLPI )(
     PSYSTEM_LOGICAL_PROCESSOR_INFORMATION,
     PDWORD );
@@ -106,6 +106,10 @@ namespace Vanilla
    private:
       vaPlatformFileStreamType   m_file;
       FileAccessMode::Enum       m_accessMode;
+      int64                      m_position;          // stream position used by Read/Write/Seek (not tracked by the OS, see ReadAt)
+
+      vaPlatformFileMappingType  m_mapping;
+      const void *               m_mappedView;
 
    public:
       vaFileStream( );
@@ -131,6 +135,18 @@ namespace Vanilla
       virtual void            Flush( );
 
       virtual void            Truncate( );
+
+      // Positional read/write - these neither use nor change the stream position. The file is opened for overlapped I/O
+      // and each call waits for its own request, so they can be called from multiple threads at the same time (for ex.
+      // for reading different blocks of a large file in parallel). Read/Write/Seek are not thread safe.
+      bool                    ReadAt( int64 position, void * buffer, int64 count );
+      bool                    WriteAt( int64 position, const void * buffer, int64 count );
+
+      // Maps the whole file into the address space for reading (file must be open for reading); returns nullptr if 
+      // that's not possible (empty file, out of address space, ...). The mapping stays valid until Unmap or Close.
+      const void *            MapForReading( );
+      void                    Unmap( );
+      const void *            GetMappedView( ) const              { return m_mappedView; }
    };
 
    // need to implement this, with proper text encoding, etc
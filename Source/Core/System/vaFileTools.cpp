@@ -55,6 +55,15 @@ bool vaFileTools::MoveFile( const wstring & oldPath, const wstring & newPath )
     return ret == 0;
 }
 
+bool vaFileTools::GetFileLastWriteTime( const wstring & path, int64 & outTime )
+{
+    WIN32_FILE_ATTRIBUTE_DATA attrInfo;
+    if( !::GetFileAttributesEx( path.c_str( ), GetFileExInfoStandard, &attrInfo ) )
+        return false;
+    outTime = ( ( (int64)attrInfo.ftLastWriteTime.dwHighDateTime ) << 32 ) | ( (int64)attrInfo.ftLastWriteTime.dwLowDateTime );
+    return true;
+}
+
 std::shared_ptr<vaMemoryStream> vaFileTools::LoadFileToMemoryStream( const string & fileName )
 {
     return LoadFileToMemoryStream( vaStringTools::SimpleWiden( fileName ) );
@@ -70,6 +70,9 @@ namespace Vanilla
 
       static bool								MoveFile( const wstring & oldPath, const wstring & newPath );
 
+      // Last write time as an opaque 64bit value (only meant for comparing against a previously obtained one)
+      static bool                               GetFileLastWriteTime( const wstring & path, int64 & outTime );
+
       static bool                               DirectoryExists( const wchar_t * path );
       static bool                               DirectoryExists( const wstring & path )                 { return DirectoryExists( path.c_str() ); }
 
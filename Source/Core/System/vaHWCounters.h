@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Core/vaCore.h"
+
+namespace Vanilla
+{
+    // Per-thread CPU hardware performance counters, used by vaTracer to (optionally) capture counter deltas for each scope.
+    // Platform specific implementation is in Platform/xxx/System/vaPlatformHWCounters.cpp; not every platform can provide
+    // every counter, so all reads return a mask of valid ones:
+    //  * Linux: all counters through perf_event_open (subject to /proc/sys/kernel/perf_event_paranoid)
+    //  * Windows: only Cycles (QueryThreadCycleTime) - the rest require a kernel driver / ETW PMC sessions
+    class vaHWCounters
+    {
+    public:
+        enum Counter : int
+        {
+            Cycles              = 0,
+            Instructions,
+            LLCMisses,
+            BranchMisses,
+
+            Count
+        };
+
+    private:
+        vaHWCounters( )  { }
+        ~vaHWCounters( ) { }
+
+    public:
+        // Reads current (monotonically increasing) counter values for the calling thread; counters get opened on first use
+        // per thread and closed at thread exit. Returns the mask of (1<<Counter) bits that are valid in outValues.
+        static uint32                       ReadThread( uint64 (&outValues)[Count] );
+
+        // Mask of counters available on this platform/machine (opens counters for the calling thread if not yet open).
+        static uint32                       GetAvailableMask( );
+
+        static const char *                 GetCounterName( int counter )
+        {
+            switch( counter )
+            {
+            case( Cycles ):         return "cycles";
+            case( Instructions ):   return "instructions";
+            case( LLCMisses ):      return "llc_misses";
+            case( BranchMisses ):   return "branch_misses";
+            default: assert( false ); return "unknown";
+            }
+        }
+    };
+}
@@ -22,6 +22,7 @@
 #include "vaThreading.h"
 
 #include "Core/vaMath.h"
+#include "Core/vaStringTools.h"
 
 #include "Core/Misc/vaProfiler.h"
 
@@ -29,6 +30,8 @@
 #include "IntegratedExternals/vaImguiIntegration.h"
 #endif
 
+#include <algorithm>
+
 using namespace Vanilla;
 
 thread_local vaThreading::ThreadLocalProps vaThreading::s_threadLocal;
@@ -157,9 +160,7 @@ void vaBackgroundTaskManager::Run( const shared_ptr<TaskInternal> & _task )
                 // if we're a threadpool task and there's some threadpool tasks waiting, continue working
                 if( !m_waitingPooledTasks.empty() )
                 {
-                    task = m_waitingPooledTasks.front();
-                    m_waitingPooledTasks.pop();
-                    task->PooledWaiting = false;
+                    task = PopWaitingPooledTask( );
                     loopDone = false;
                 }
                 else
@@ -173,25 +174,47 @@ void vaBackgroundTaskManager::Run( const shared_ptr<TaskInternal> & _task )
     thread.detach(); // run free little one!!
 }
 
-bool vaBackgroundTaskManager::Spawn( shared_ptr<Task> & outTask, const string & taskName, SpawnFlags flags, const std::function< bool( TaskContext & context ) > & taskFunction )
+shared_ptr<vaBackgroundTaskManager::TaskInternal> vaBackgroundTaskManager::PopWaitingPooledTask( )
+{
+    assert( !m_waitingPooledTasks.empty() );
+
+    // linear search is fine - the waiting list is rarely longer than a few hundred (shader compiles after loading a big scene)
+    int bestIndex = 0;
+    for( int i = 1; i < (int)m_waitingPooledTasks.size(); i++ )
+    {
+        const TaskInternal & candidate  = *m_waitingPooledTasks[i];
+        const TaskInternal & best       = *m_waitingPooledTasks[bestIndex];
+        float candidatePriority = candidate.Priority, bestPriority = best.Priority;
+        if( candidatePriority > bestPriority || ( candidatePriority == bestPriority && candidate.SpawnIndex < best.SpawnIndex ) )
+            bestIndex = i;
+    }
+
+    shared_ptr<TaskInternal> task = m_waitingPooledTasks[bestIndex];
+    m_waitingPooledTasks.erase( m_waitingPooledTasks.begin() + bestIndex );
+    task->PooledWaiting = false;
+    return task;
+}
+
+bool vaBackgroundTaskManager::Spawn( shared_ptr<Task> & outTask, const string & taskName, SpawnFlags flags, const std::function< bool( TaskContext & context ) > & taskFunction, float priority )
 {
     std::unique_lock<mutex> spawnLock( m_spawnMutex );
     assert( !m_stopped );
     if( m_stopped ) return false;
 
-    shared_ptr<vaBackgroundTaskManager::TaskInternal> newTask = std::make_shared<vaBackgroundTaskManager::TaskInternal>( taskName, flags, taskFunction );
+    shared_ptr<vaBackgroundTaskManager::TaskInternal> newTask = std::make_shared<vaBackgroundTaskManager::TaskInternal>( taskName, flags, taskFunction, priority );
     outTask = newTask;
 
     {
         std::unique_lock<mutex> tasksLock( m_currentTasksMutex );
         m_currentTasks.push_back( newTask );
+        newTask->SpawnIndex = m_spawnCounter++;
 
         // using thread pool - if we can spawn, spawn, if we can't then add to waiting list
         if( ( newTask->Flags & SpawnFlags::UseThreadPool ) != 0 )
         {
             if( m_currentThreadPoolUseCount >= m_threadPoolSize )
             {
-                m_waitingPooledTasks.push( newTask );
+                m_waitingPooledTasks.push_back( newTask );
                 newTask->PooledWaiting = true;
                 return true;
             }
@@ -212,6 +235,32 @@ void vaBackgroundTaskManager::WaitUntilFinished( const shared_ptr<Task> & _task
     if( _task == nullptr )
         return;
     const shared_ptr<TaskInternal> task =  std::static_pointer_cast<TaskInternal>(_task);
+
+    // still waiting for a pool thread? no point in waiting for all the tasks in front of it - just run it here
+    bool runHere = false;
+    if( task->PooledWaiting )
+    {
+        std::unique_lock<mutex> tasksLock( m_currentTasksMutex );
+        auto it = std::find( m_waitingPooledTasks.begin(), m_waitingPooledTasks.end(), task );
+        if( it != m_waitingPooledTasks.end() )
+        {
+            m_waitingPooledTasks.erase( it );
+            task->PooledWaiting = false;
+            runHere = true;
+        }
+    }
+    if( runHere )
+    {
+        assert( !task->IsFinished );
+        task->Result = task->UserFunction( task->Context );
+        task->Context.Progress = 1.0f;
+        {
+            std::unique_lock<std::mutex> cvLock( task->WaitFinishedMutex );
+            task->IsFinished = true;
+            task->WaitFinishedCV.notify_all();
+        }
+    }
+
     {
         std::unique_lock<std::mutex> cvLock( task->WaitFinishedMutex );
         while( !task->IsFinished )
@@ -225,6 +274,21 @@ void vaBackgroundTaskManager::WaitUntilFinished( const shared_ptr<Task> & _task
     assert( task->IsFinished );
 }
 
+void vaBackgroundTaskManager::RaisePriority( const shared_ptr<Task> & _task, float priority )
+{
+    if( _task == nullptr )
+        return;
+    const shared_ptr<TaskInternal> task =  std::static_pointer_cast<TaskInternal>(_task);
+    float current = task->Priority;
+    while( current < priority && !task->Priority.compare_exchange_weak( current, priority ) ) { }
+}
+
+int vaBackgroundTaskManager::GetWaitingPooledTaskCount( )
+{
+    std::unique_lock<mutex> tasksLock( m_currentTasksMutex );
+    return (int)m_waitingPooledTasks.size();
+}
+
 float vaBackgroundTaskManager::GetProgress( const shared_ptr<Task> & _task )
 {
     const shared_ptr<TaskInternal> task =  std::static_pointer_cast<TaskInternal>(_task);
@@ -413,3 +477,112 @@ void vaBackgroundTaskManager::InsertImGuiWindow( const string & title )
     ImGui::End( );
 #endif
 }
+
+thread_local bool vaParallel::s_isWorkerThread = false;
+
+vaParallel::vaParallel( int workerCount )
+{
+    for( int i = 0; i < workerCount; i++ )
+        m_workers.push_back( std::thread( &vaParallel::WorkerLoop, this, i ) );
+}
+
+vaParallel::~vaParallel( )
+{
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        assert( m_jobs.empty() );   // For() still running on another thread during shutdown?
+        m_stop = true;
+    }
+    m_workAvailableCV.notify_all( );
+    for( std::thread & worker : m_workers )
+        worker.join( );
+}
+
+int vaParallel::GetWorkerCount( )
+{
+    vaParallel * instance = vaParallel::GetInstancePtr( );
+    return ( instance != nullptr ) ? ( (int)instance->m_workers.size( ) ) : ( 0 );
+}
+
+void vaParallel::WorkerLoop( int index )
+{
+    s_isWorkerThread = true;
+    vaThreading::SetThreadName( vaStringTools::Format( "!vaParallel%02d", index ) );
+
+    std::unique_lock<std::mutex> lock( m_mutex );
+    while( true )
+    {
+        m_workAvailableCV.wait( lock, [this] { return m_stop || !m_jobs.empty( ); } );
+        if( m_stop )
+            return;
+
+        shared_ptr<Job> job = m_jobs.front( );
+        lock.unlock( );
+        ExecuteChunks( *job );
+        lock.lock( );
+
+        // all chunks handed out - no one needs to pick this job up anymore
+        if( !m_jobs.empty( ) && m_jobs.front( ) == job )
+            m_jobs.pop_front( );
+    }
+}
+
+void vaParallel::ExecuteChunks( Job & job )
+{
+    int64 chunk;
+    while( ( chunk = job.NextChunk.fetch_add( 1 ) ) < job.ChunkCount )
+    {
+        int64 chunkBegin    = job.Begin + chunk * job.ChunkSize;
+        int64 chunkEnd      = std::min( chunkBegin + job.ChunkSize, job.End );
+        ( *job.Function )( chunkBegin, chunkEnd );
+
+        if( job.FinishedChunks.fetch_add( 1 ) + 1 == job.ChunkCount )
+        {
+            // lock so that the notify can't slip in between the waiter's predicate check and its wait
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_jobFinishedCV.notify_all( );
+        }
+    }
+}
+
+void vaParallel::For( int64 begin, int64 end, int64 minChunkSize, const std::function<void( int64 chunkBegin, int64 chunkEnd )> & func )
+{
+    if( end <= begin )
+        return;
+    minChunkSize = std::max( (int64)1, minChunkSize );
+
+    vaParallel * instance = vaParallel::GetInstancePtr( );
+    int64 count = end - begin;
+    if( instance == nullptr || s_isWorkerThread || instance->m_workers.size( ) == 0 || count <= minChunkSize )
+    {
+        func( begin, end );
+        return;
+    }
+
+    // a few chunks per thread to even out the load, but no smaller than requested
+    int64 threadCount   = (int64)instance->m_workers.size( ) + 1;
+    int64 chunkCount    = std::min( ( count + minChunkSize - 1 ) / minChunkSize, threadCount * 4 );
+    
+    shared_ptr<Job> job = std::make_shared<Job>( );
+    job->Function       = &func;
+    job->Begin          = begin;
+    job->End            = end;
+    job->ChunkSize      = ( count + chunkCount - 1 ) / chunkCount;
+    job->ChunkCount     = ( count + job->ChunkSize - 1 ) / job->ChunkSize;
+
+    {
+        std::unique_lock<std::mutex> lock( instance->m_mutex );
+        instance->m_jobs.push_back( job );
+    }
+    instance->m_workAvailableCV.notify_all( );
+
+    // help out and then wait for the stragglers
+    instance->ExecuteChunks( *job );
+    {
+        std::unique_lock<std::mutex> lock( instance->m_mutex );
+        instance->m_jobFinishedCV.wait( lock, [&job] { return job->FinishedChunks.load( ) == job->ChunkCount; } );
+        auto it = std::find( instance->m_jobs.begin( ), instance->m_jobs.end( ), job );
+        if( it != instance->m_jobs.end( ) )
+            instance->m_jobs.erase( it );
+    }
+}
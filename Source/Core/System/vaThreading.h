@@ -21,7 +21,7 @@
 
 // old code dropped, replaced by much simpler stuff based on C++14
 // for long tasks use vaBackgroundTaskManager
-// there's no fine grained thread pool anymore, use EnkiTS or similar for that
+// for data-parallel loops that complete within the call use vaParallel; for anything more fine grained use EnkiTS or similar
 
 #include "Core/vaCore.h"
 #include "Core/vaSingleton.h"
@@ -50,6 +50,18 @@ namespace Vanilla
 
         static void                         SetSyncedWithMainThread( )                                          { s_threadLocal.MainThreadSynced = true; }
 
+        // Minimal stackful cooperative fibers (used by vaMiniScript to run scripts inline on the calling thread). A fiber
+        // never migrates between threads and its entry function must never return - switch back to another fiber instead.
+        typedef void *                      FiberHandle;
+        // returns the fiber handle of the current thread, converting it into a fiber if needed (outConverted tells if it was)
+        static FiberHandle                  FiberConvertCurrentThread( bool & outConverted );
+        // undoes FiberConvertCurrentThread (only call if it reported outConverted == true)
+        static void                         FiberRevertCurrentThread( );
+        // stackSize 0 means default (same as the executable's main thread)
+        static FiberHandle                  FiberCreate( size_t stackSize, void ( * entry )( void * userData ), void * userData );
+        static void                         FiberDelete( FiberHandle fiber );
+        static void                         FiberSwitchTo( FiberHandle fiber );
+
     private:
         friend class vaCore;
 
@@ -60,6 +72,7 @@ namespace Vanilla
         static void                         SetMainThread( );
 
         friend class vaTracer;
+        friend class vaParallel;
         static void                         SetThreadName( const string & name );   // can only be called once and before any GetThreadName
         static const char *                 GetThreadName( );
     };
@@ -116,7 +129,10 @@ namespace Vanilla
 
             std::atomic_bool        PooledWaiting       = false;
 
-            TaskInternal( const string & name, SpawnFlags flags, const std::function< bool( TaskContext & context ) > & taskFunction ) : Task(name), Flags( flags ), UserFunction( taskFunction ) { }
+            std::atomic<float>      Priority            = 0.0f;         // waiting pooled tasks with higher priority get picked up first; same priority ones are FIFO
+            uint64                  SpawnIndex          = 0;            // for the FIFO ordering above
+
+            TaskInternal( const string & name, SpawnFlags flags, const std::function< bool( TaskContext & context ) > & taskFunction, float priority ) : Task(name), Flags( flags ), UserFunction( taskFunction ), Priority( priority ) { }
 
             TaskInternal( const TaskInternal & copy ) = delete;
             TaskInternal & operator =( const TaskInternal & copy ) = delete;
@@ -129,7 +145,8 @@ namespace Vanilla
 
 
         vector<shared_ptr<TaskInternal>>            m_currentTasks;
-        queue<shared_ptr<TaskInternal>>             m_waitingPooledTasks;
+        vector<shared_ptr<TaskInternal>>            m_waitingPooledTasks;           // not sorted - see PopWaitingPooledTask
+        uint64                                      m_spawnCounter      = 0;
         mutex                                       m_currentTasksMutex;
 
         // used to block simultaneous spawning of new tasks while WaitUntilFinished or StopManager calls as I have not made sure they will logically work ok
@@ -144,16 +161,21 @@ namespace Vanilla
         bool                    IsManagerStopped( ) const  { return m_stopped; }
 
         // This Spawn version guarantees that the outTask will always receive the new handle BEFORE the taskFunction has started on another thread (is this actually useful?)
-        bool                    Spawn( shared_ptr<Task> & outTask, const string & taskName, SpawnFlags flags, const std::function< bool( TaskContext & context ) > & taskFunction );
+        // 'priority' only matters for UseThreadPool tasks that have to wait for a free pool thread: the highest priority waiting one gets started first.
+        bool                    Spawn( shared_ptr<Task> & outTask, const string & taskName, SpawnFlags flags, const std::function< bool( TaskContext & context ) > & taskFunction, float priority = 0.0f );
         // Version for when we don't care about getting the handle before the taskFunction could have started (in theory it might have finished by the time we get the handle)
-        shared_ptr<Task>        Spawn( const string & taskName, SpawnFlags flags, const std::function< bool( TaskContext & context ) > & taskFunction ) { shared_ptr<Task> outTask; if( Spawn( outTask, taskName, flags, taskFunction ) ) return outTask; else return nullptr; }
+        shared_ptr<Task>        Spawn( const string & taskName, SpawnFlags flags, const std::function< bool( TaskContext & context ) > & taskFunction, float priority = 0.0f ) { shared_ptr<Task> outTask; if( Spawn( outTask, taskName, flags, taskFunction, priority ) ) return outTask; else return nullptr; }
 
         // SpawnWithDependency( shared_ptr<Task> & outTask, const string & taskName, SpawnFlags flags, const std::function< bool( TaskContext & context ) > & taskFunction );
         
         float                   GetProgress( const shared_ptr<Task> & task );
         bool                    IsFinished( const shared_ptr<Task> & task );
         void                    MarkForStopping( const shared_ptr<Task> & task ); // mark for force-stop which should cause interruption but does not guarantee it will stop soon; does not wait for it to get stopped either (use WaitUntilFinished for that)
+        // if the task is a pooled one still waiting for a free thread, it gets removed from the waiting list and run on the calling thread instead
         void                    WaitUntilFinished( const shared_ptr<Task> & task );
+        // raises the priority of a waiting pooled task (never lowers it, so it can be called by multiple requesters); no effect once the task has started
+        void                    RaisePriority( const shared_ptr<Task> & task, float priority );
+        int                     GetWaitingPooledTaskCount( );
 
     public:
         // used internally to show task progress but can be used from any vaIOPanel::IOPanelDraw() or similar imgui-suitable location to insert ImGui commands showing progress/info on the task!
@@ -170,11 +192,58 @@ namespace Vanilla
     private:
         void                    Run( const shared_ptr<TaskInternal> & task );
         void                    ClearFinishedTasks( );
+        shared_ptr<TaskInternal> PopWaitingPooledTask( );                  // m_currentTasksMutex must be locked
         
     };
 
     BITFLAG_ENUM_CLASS_HELPER( vaBackgroundTaskManager::SpawnFlags );
 
+    // Fork-join helper for data-parallel work that has to be finished by the time the call returns (image metrics, texture
+    // compression, light binning, ...). Unlike vaBackgroundTaskManager it keeps a persistent pool of worker threads, and the
+    // calling thread works on the loop too. Calls made from a worker thread (nested loops) just run serially, so there's
+    // no way to deadlock the pool. If the pool isn't created (vaCore not initialized) everything runs serially as well.
+    class vaParallel : public vaSingletonBase<vaParallel>
+    {
+        struct Job
+        {
+            const std::function<void( int64 begin, int64 end )> *
+                                        Function        = nullptr;
+            int64                       Begin           = 0;
+            int64                       End             = 0;
+            int64                       ChunkSize       = 0;
+            int64                       ChunkCount      = 0;
+            std::atomic<int64>          NextChunk       = 0;
+            std::atomic<int64>          FinishedChunks  = 0;
+        };
+
+        std::vector<std::thread>                    m_workers;
+        std::mutex                                  m_mutex;
+        std::condition_variable                     m_workAvailableCV;
+        std::condition_variable                     m_jobFinishedCV;
+        std::deque<shared_ptr<Job>>                 m_jobs;
+        bool                                        m_stop              = false;
+
+        static thread_local bool                    s_isWorkerThread;
+
+    private:
+        friend class vaCore;
+        explicit vaParallel( int workerCount );
+        ~vaParallel( );
+
+    public:
+        // Calls func( chunkBegin, chunkEnd ) for consecutive sub-ranges covering [begin, end), each at least minChunkSize
+        // items long (except for the last one); sub-ranges run in parallel and in no particular order.
+        static void                                 For( int64 begin, int64 end, int64 minChunkSize, const std::function<void( int64 chunkBegin, int64 chunkEnd )> & func );
+
+        // number of pool threads, not counting the calling thread; 0 if no pool
+        static int                                  GetWorkerCount( );
+        static bool                                 IsWorkerThread( )       { return s_isWorkerThread; }
+
+    private:
+        void                                        WorkerLoop( int index );
+        void                                        ExecuteChunks( Job & job );
+    };
+
     // Owner thread creates an instance of vaThreadSpecificCallbackQueue and calls Tick( ... )
     // Any other thread can call 
     template< typename ... ArgsType >
@@ -171,6 +171,9 @@ void vaApplicationBase::Tick( float deltaTime )
 {
     VA_TRACE_CPU_SCOPE( vaApplicationBase_Tick );
 
+    // close the previous frame's per-tag allocation counters
+    vaMemory::TickFrame( );
+
     m_tickNumber++;
 
     // assuming Y-based scaling
@@ -328,6 +331,14 @@ void vaApplicationBase::UIPanelHandler( vaApplicationBase & )
     }
     if( ImGui::MenuItem( "Dump perf tracing report", "CTRL+T" ) )
         vaTracer::DumpChromeTracingReportToFile();
+    bool streamingCapture = vaTracer::IsStreamingCapture( );
+    if( ImGui::MenuItem( "Streaming perf tracing capture", "", &streamingCapture ) )
+    {
+        if( streamingCapture )
+            vaTracer::StartStreamingCapture( );
+        else
+            vaTracer::StopStreamingCapture( );
+    }
 
 #ifdef _DEBUG
     if( ImGui::MenuItem( "Show ImGui demo", "", &vaUIManager::GetInstance().m_showImGuiDemo ) )
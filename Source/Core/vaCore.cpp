@@ -135,6 +135,9 @@ void vaCore::Initialize( bool liveRestart )
 
     new vaBackgroundTaskManager( );
 
+    // same heuristic as above; the thread calling vaParallel::For works too, hence the -1
+    new vaParallel( vaMath::Max( 2, ( physicalCores + logicalCores - 1 ) / 2 ) - 1 );
+
 
     //   InitializeSubsystemManagers( );
        // hmm not needed at the moment
@@ -155,12 +158,16 @@ void vaCore::Deinitialize( bool liveRestart )
 {
     assert( s_initialized );
 
+    // finish writing before anything it might log to goes away
+    vaTracer::StopStreamingCapture( );
+
     delete vaBenchmarkTool::GetInstancePtr( );
 
     //   delete vaThreadPool::GetInstancePtr();
 
     //   DeinitializeSubsystemManagers( );
 
+    delete vaParallel::GetInstancePtr( );
     delete vaBackgroundTaskManager::GetInstancePtr( );
 #ifdef VA_TASKFLOW_INTEGRATION_ENABLED
     delete vaTF::GetInstancePtr();
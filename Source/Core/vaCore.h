@@ -204,6 +204,19 @@ namespace Vanilla
         }
     };
 
+    // for unordered containers; GUIDs are mostly random already so just fold the two halves and mix
+    struct vaGUIDHasher
+    {
+        size_t operator()( const vaGUID & guid ) const
+        {
+            uint64 lo = (uint64)(uint32)guid.Data1 | ( (uint64)guid.Data2 << 32 ) | ( (uint64)guid.Data3 << 48 );
+            uint64 hi; memcpy( &hi, guid.Data4, sizeof( hi ) );
+            uint64 h = lo ^ ( hi * 0x9E3779B97F4A7C15ull );
+            h ^= h >> 32; h *= 0xD6E8FEB86659FD93ull; h ^= h >> 32;
+            return (size_t)h;
+        }
+    };
+
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // RAII way to set a bool to 'true' while in scope - could be templated for more flexibility
     class vaMarkWhileInScope
@@ -0,0 +1,144 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "vaFrameArena.h"
+
+#include "vaMemory.h"
+
+#include <algorithm>
+
+using namespace Vanilla;
+
+namespace
+{
+    // overflow blocks are at least this big so that a burst of small allocations doesn't hit the heap for each one
+    static const size_t c_minOverflowBlockSize  = 64 * 1024;
+
+    inline uint8 * AlignPointer( uint8 * ptr, size_t alignment )
+    {
+        return (uint8 *)( ( (uintptr_t)ptr + ( alignment - 1 ) ) & ~(uintptr_t)( alignment - 1 ) );
+    }
+}
+
+vaFrameArena::vaFrameArena( int framesInFlight, size_t initialFrameCapacity )
+    : m_framesInFlight( std::max( 1, framesInFlight ) )
+{
+    VA_MEMORY_TAG_SCOPE( "FrameArena" );
+    m_regions = new Region[m_framesInFlight];
+    for( int i = 0; i < m_framesInFlight; i++ )
+    {
+        m_regions[i].Capacity   = initialFrameCapacity;
+        m_regions[i].Memory     = new uint8[initialFrameCapacity];
+    }
+    m_currentRegion = &m_regions[0];
+    m_stats.Capacity = initialFrameCapacity * m_framesInFlight;
+}
+
+vaFrameArena::~vaFrameArena( )
+{
+    for( int i = 0; i < m_framesInFlight; i++ )
+    {
+        RecycleRegion( m_regions[i] );
+        delete[] m_regions[i].Memory;
+    }
+    delete[] m_regions;
+}
+
+void vaFrameArena::RecycleRegion( Region & region )
+{
+    for( uint8 * block : region.OverflowBlocks )
+        delete[] block;
+    region.OverflowBlocks.clear( );
+    region.OverflowCurrent          = nullptr;
+    region.OverflowCurrentSize      = 0;
+    region.OverflowCurrentOffset    = 0;
+    region.OverflowBytes            = 0;
+    region.Offset                   = 0;
+}
+
+void vaFrameArena::BeginFrame( int64 frameIndex )
+{
+    assert( frameIndex > m_currentFrameIndex );
+
+    // stats for the frame that just finished
+    if( m_currentFrameIndex >= 0 )
+    {
+        Region & last = *m_currentRegion;
+        m_stats.LastFrameUsedBytes      = std::min( last.Offset.load( ), last.Capacity ) + last.OverflowBytes.load( );
+        m_stats.LastFrameOverflowBytes  = last.OverflowBytes.load( );
+        m_stats.TotalOverflows         += (int64)last.OverflowBlocks.size( );
+    }
+
+    m_currentFrameIndex = frameIndex;
+    Region & region = m_regions[ frameIndex % m_framesInFlight ];
+
+    // last time this region was used it ran out of space: grow it so it fits everything (plus some headroom) in one go
+    size_t neededCapacity = std::min( region.Offset.load( ), region.Capacity ) + region.OverflowBytes.load( );
+    if( neededCapacity > region.Capacity )
+    {
+        VA_MEMORY_TAG_SCOPE( "FrameArena" );
+        size_t newCapacity = neededCapacity + neededCapacity / 2;
+        m_stats.Capacity += newCapacity - region.Capacity;
+        delete[] region.Memory;
+        region.Memory   = new uint8[newCapacity];
+        region.Capacity = newCapacity;
+    }
+    RecycleRegion( region );
+    region.FrameIndex = frameIndex;
+
+    m_currentRegion     = &region;
+    m_stats.FrameIndex  = frameIndex;
+}
+
+void * vaFrameArena::Allocate( size_t size, size_t alignment )
+{
+    assert( alignment > 0 && ( alignment & ( alignment - 1 ) ) == 0 );
+    assert( m_currentFrameIndex >= 0 ); // BeginFrame never called?
+    Region & region = *m_currentRegion;
+
+    // worst case padding is reserved so that the returned block is always aligned regardless of where the offset lands
+    size_t paddedSize = size + alignment - 1;
+    size_t offset = region.Offset.fetch_add( paddedSize );
+    if( offset + paddedSize <= region.Capacity )
+        return AlignPointer( region.Memory + offset, alignment );
+
+    return AllocateOverflow( region, size, alignment );
+}
+
+void * vaFrameArena::AllocateOverflow( Region & region, size_t size, size_t alignment )
+{
+    VA_MEMORY_TAG_SCOPE( "FrameArena" );
+    std::lock_guard<std::mutex> lock( region.OverflowMutex );
+
+    size_t paddedSize = size + alignment - 1;
+    region.OverflowBytes += paddedSize;
+
+    if( region.OverflowCurrent == nullptr || region.OverflowCurrentOffset + paddedSize > region.OverflowCurrentSize )
+    {
+        size_t blockSize = std::max( std::max( c_minOverflowBlockSize, region.Capacity / 4 ), paddedSize );
+        region.OverflowCurrent          = new uint8[blockSize];
+        region.OverflowCurrentSize      = blockSize;
+        region.OverflowCurrentOffset    = 0;
+        region.OverflowBlocks.push_back( region.OverflowCurrent );
+    }
+
+    uint8 * ret = AlignPointer( region.OverflowCurrent + region.OverflowCurrentOffset, alignment );
+    region.OverflowCurrentOffset += paddedSize;
+    return ret;
+}
@@ -0,0 +1,161 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "vaCore.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace Vanilla
+{
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // vaFrameArena
+    //
+    // Linear (bump) allocator for transient per-frame data. It holds one region per frame in flight; BeginFrame( N )
+    // recycles the region last used by frame N - framesInFlight, so anything allocated during a frame stays valid until
+    // that many frames later and is then dropped wholesale - there is no per-allocation free and no destructors get called.
+    // Allocate is lock-free and can be called from any thread; BeginFrame must not run in parallel with allocations.
+    // When a frame's region runs out, overflow blocks are taken from the heap and the region is grown when it next gets
+    // recycled, so after a couple of frames the steady state does no heap allocations at all.
+    class vaFrameArena
+    {
+    public:
+        static constexpr size_t             c_defaultFrameCapacity  = 256 * 1024;
+
+        struct Stats
+        {
+            int64                           FrameIndex              = -1;
+            size_t                          Capacity                = 0;    // sum of all region capacities
+            size_t                          LastFrameUsedBytes      = 0;
+            size_t                          LastFrameOverflowBytes  = 0;    // anything > 0 means the region got (or will get) grown
+            int64                           TotalOverflows          = 0;
+        };
+
+    private:
+        struct Region
+        {
+            uint8 *                         Memory                  = nullptr;
+            size_t                          Capacity                = 0;
+            std::atomic<size_t>             Offset                  { 0 };
+
+            std::mutex                      OverflowMutex;
+            std::vector<uint8 *>            OverflowBlocks;
+            uint8 *                         OverflowCurrent         = nullptr;
+            size_t                          OverflowCurrentSize     = 0;
+            size_t                          OverflowCurrentOffset   = 0;
+            std::atomic<size_t>             OverflowBytes           { 0 };
+
+            int64                           FrameIndex              = -1;
+        };
+
+        const int                           m_framesInFlight;
+        Region *                            m_regions;
+        Region *                            m_currentRegion;
+        int64                               m_currentFrameIndex     = -1;
+
+        Stats                               m_stats;
+
+    public:
+        vaFrameArena( int framesInFlight, size_t initialFrameCapacity = c_defaultFrameCapacity );
+        ~vaFrameArena( );
+
+        vaFrameArena( const vaFrameArena & ) = delete;
+        vaFrameArena & operator = ( const vaFrameArena & ) = delete;
+
+    public:
+        // starts a new frame; recycles the region used by frame (frameIndex - framesInFlight) - frameIndex must increase monotonically
+        void                                BeginFrame( int64 frameIndex );
+
+        // never fails (falls back to the heap when out of region memory); returned memory is valid until frame (GetCurrentFrame()+framesInFlight) begins
+        void *                              Allocate( size_t size, size_t alignment = 16 );
+
+        template< typename T >
+        T *                                 AllocateArray( size_t count )                       { return static_cast<T*>( Allocate( sizeof(T) * count, alignof(T) ) ); }
+
+        int64                               GetCurrentFrame( ) const                            { return m_currentFrameIndex; }
+        int                                 GetFramesInFlight( ) const                          { return m_framesInFlight; }
+        // is memory allocated during 'frameIndex' still valid?
+        bool                                IsFrameAlive( int64 frameIndex ) const              { return frameIndex >= 0 && frameIndex <= m_currentFrameIndex && (m_currentFrameIndex - frameIndex) < m_framesInFlight; }
+
+        const Stats &                       GetStats( ) const                                   { return m_stats; }
+
+    private:
+        void *                              AllocateOverflow( Region & region, size_t size, size_t alignment );
+        static void                         RecycleRegion( Region & region );
+    };
+
+    // STL allocator adapter; with a null arena it falls back to the regular heap (so the same container type can be used
+    // either way). deallocate is a no-op for the arena case - containers that use it must be reset (storage dropped, see
+    // vaFrameArenaVectorReset) at least once every framesInFlight frames, and copies of such containers get heap storage.
+    template< typename T >
+    class vaFrameArenaAllocator
+    {
+        template< typename U > friend class vaFrameArenaAllocator;
+        vaFrameArena *                      m_arena                 = nullptr;
+
+    public:
+        typedef T                           value_type;
+        typedef std::true_type              propagate_on_container_move_assignment;
+        typedef std::true_type              propagate_on_container_swap;
+        typedef std::false_type             propagate_on_container_copy_assignment;
+        typedef std::false_type             is_always_equal;
+
+        vaFrameArenaAllocator( ) noexcept                                                       { }
+        explicit vaFrameArenaAllocator( vaFrameArena * arena ) noexcept : m_arena( arena )     { }
+        template< typename U >
+        vaFrameArenaAllocator( const vaFrameArenaAllocator<U> & other ) noexcept : m_arena( other.m_arena ) { }
+
+        T *                                 allocate( size_t count )
+        {
+            if( m_arena != nullptr )
+                return m_arena->AllocateArray<T>( count );
+            return static_cast<T*>( ::operator new( count * sizeof( T ) ) );
+        }
+        void                                deallocate( T * ptr, size_t ) noexcept
+        {
+            if( m_arena == nullptr )
+                ::operator delete( ptr );
+        }
+
+        // copies of arena-backed containers don't inherit the (short) lifetime of the original
+        vaFrameArenaAllocator               select_on_container_copy_construction( ) const      { return vaFrameArenaAllocator( ); }
+
+        vaFrameArena *                      GetArena( ) const                                   { return m_arena; }
+
+        template< typename U >
+        bool                                operator == ( const vaFrameArenaAllocator<U> & other ) const    { return m_arena == other.m_arena; }
+        template< typename U >
+        bool                                operator != ( const vaFrameArenaAllocator<U> & other ) const    { return m_arena != other.m_arena; }
+    };
+
+    template< typename T >
+    using vaFrameArenaVector = std::vector< T, vaFrameArenaAllocator<T> >;
+
+    // destroys all elements and, if arena-backed, drops the storage (no-op deallocate) so that the next growth comes from
+    // the current frame; heap-backed vectors just get cleared and keep their capacity. Can also re-bind to a different arena.
+    template< typename T >
+    inline void vaFrameArenaVectorReset( vaFrameArenaVector<T> & vec, vaFrameArena * arena )
+    {
+        vec.clear( );
+        if( arena != nullptr || vec.get_allocator( ).GetArena( ) != nullptr )
+            vec = vaFrameArenaVector<T>( vaFrameArenaAllocator<T>( arena ) );
+    }
+}
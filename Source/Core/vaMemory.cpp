@@ -20,13 +20,33 @@
 #pragma once
 
 #include "vaMemory.h"
+#include "vaStringTools.h"
 
 using namespace Vanilla;
 
 #include "IntegratedExternals/vaAssimpIntegration.h"
 
+#ifdef VA_IMGUI_INTEGRATION_ENABLED
+#include "IntegratedExternals/vaImguiIntegration.h"
+#endif
+
+#include <new>
+#include <algorithm>
+#include <unordered_map>
+
+#include <DbgHelp.h>
+#pragma comment( lib, "dbghelp.lib" )
+
 _CrtMemState s_memStateStart;
 
+namespace
+{
+    // symbolization (main thread UI only; released in Deinitialize so it doesn't show up as a leak)
+    std::mutex                                  s_symbolMutex;
+    bool                                        s_symbolsInitialized    = false;
+    std::unordered_map<void *, string> *        s_symbolCache           = nullptr;
+}
+
 void vaMemory::Initialize( )
 {
 
@@ -69,6 +89,16 @@ void vaMemory::Initialize( )
 
 void vaMemory::Deinitialize()
 {
+    SetTrackingEnabled( false );
+    {
+        std::lock_guard<std::mutex> lock( s_symbolMutex );
+        delete s_symbolCache;
+        s_symbolCache = nullptr;
+        if( s_symbolsInitialized )
+            ::SymCleanup( ::GetCurrentProcess( ) );
+        s_symbolsInitialized = false;
+    }
+
 #if defined(DEBUG) || defined(_DEBUG)
    _CrtMemState memStateStop, memStateDiff;
    _CrtMemCheckpoint( &memStateStop );
@@ -93,4 +123,404 @@ void vaMemory::Deinitialize()
 #endif
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////
+// allocation tracking
+//
+// Everything below can get called from global operator new, including during static initialization and from any
+// thread, so it only uses zero-initialized (constant initialized) statics, spin locks instead of std::mutex and never
+// allocates from the heap itself.
+
+namespace Vanilla
+{
+    struct vaMemoryTrackingInternal
+    {
+        struct TagCounters
+        {
+            char                        Name[vaMemory::c_maxTagNameLength];
+            std::atomic<int64>          LiveBytes;
+            std::atomic<int64>          PeakLiveBytes;
+            std::atomic<int64>          TotalAllocations;
+            std::atomic<int64>          TotalBytes;
+
+            // main thread only (TickFrame)
+            int64                       PrevFrameAllocations;
+            int64                       PrevFrameBytes;
+            int64                       LastFrameAllocations;
+            int64                       LastFrameBytes;
+            int64                       MaxFrameAllocations;
+        };
+
+        struct StackSampleSlot
+        {
+            uint32                      Hash;
+            int                         Tag;
+            int64                       SampleCount;
+            int64                       SampledBytes;
+            int                         FrameCount;
+            void *                      Frames[vaMemory::c_stackSampleDepth];
+        };
+        static constexpr int            c_stackSampleSlots      = 4096;
+
+        struct SpinLock
+        {
+            std::atomic_flag &          Flag;
+            explicit SpinLock( std::atomic_flag & flag ) : Flag( flag )     { while( Flag.test_and_set( std::memory_order_acquire ) ) { std::this_thread::yield( ); } }
+            ~SpinLock( )                                                    { Flag.clear( std::memory_order_release ); }
+        };
+
+        static TagCounters              s_tags[vaMemory::c_maxTags];
+        static std::atomic<int>         s_tagCount;                         // excluding tag 0 ("untagged")
+        static std::atomic_flag         s_tagsLock;
+
+        static std::atomic<bool>        s_allocatorHooked;                  // global new/delete go through vaMemoryTracking.cpp
+        static std::atomic<bool>        s_trackingEnabled;
+        static std::atomic<int>         s_stackSampling;
+
+        static StackSampleSlot          s_stackSamples[c_stackSampleSlots];
+        static std::atomic_flag         s_stackSamplesLock;
+
+        static thread_local int         t_tag;
+        static thread_local int         t_stackSampleCounter;
+
+        static void                     OnAllocation( int tag, size_t size );
+        static void                     OnFree( int tag, size_t size );
+        static void                     SampleStack( int tag, size_t size );
+    };
+
+    vaMemoryTrackingInternal::TagCounters       vaMemoryTrackingInternal::s_tags[vaMemory::c_maxTags];
+    std::atomic<int>                            vaMemoryTrackingInternal::s_tagCount;
+    std::atomic_flag                            vaMemoryTrackingInternal::s_tagsLock            = ATOMIC_FLAG_INIT;
+    std::atomic<bool>                           vaMemoryTrackingInternal::s_allocatorHooked;
+    std::atomic<bool>                           vaMemoryTrackingInternal::s_trackingEnabled;
+    std::atomic<int>                            vaMemoryTrackingInternal::s_stackSampling;
+    vaMemoryTrackingInternal::StackSampleSlot   vaMemoryTrackingInternal::s_stackSamples[vaMemoryTrackingInternal::c_stackSampleSlots];
+    std::atomic_flag                            vaMemoryTrackingInternal::s_stackSamplesLock    = ATOMIC_FLAG_INIT;
+    thread_local int                            vaMemoryTrackingInternal::t_tag                 = 0;
+    thread_local int                            vaMemoryTrackingInternal::t_stackSampleCounter  = 0;
+}
+
+namespace
+{
+    typedef vaMemoryTrackingInternal MTI;
+
+    inline const char * TagName( int tag )      { return ( tag == 0 ) ? ( "untagged" ) : ( MTI::s_tags[tag].Name ); }
+}
 
+int vaMemory::RegisterTag( const char * name )
+{
+    MTI::SpinLock lock( MTI::s_tagsLock );
+    int count = MTI::s_tagCount.load( );
+    for( int i = 1; i <= count; i++ )
+        if( strcmp( MTI::s_tags[i].Name, name ) == 0 )
+            return i;
+    if( count + 1 >= c_maxTags )
+    {
+        assert( false ); // increase c_maxTags
+        return 0;
+    }
+    int tag = count + 1;
+    size_t len = std::min( strlen( name ), (size_t)c_maxTagNameLength - 1 );
+    memcpy( MTI::s_tags[tag].Name, name, len );
+    MTI::s_tags[tag].Name[len] = 0;
+    MTI::s_tagCount.store( tag );
+    return tag;
+}
+
+int vaMemory::GetTagCount( )                { return MTI::s_tagCount.load( ) + 1; }
+int vaMemory::GetThreadTag( )               { return MTI::t_tag; }
+void vaMemory::SetThreadTag( int tag )      { assert( tag >= 0 && tag < c_maxTags ); MTI::t_tag = tag; }
+
+bool vaMemory::IsTrackingAvailable( )       { return MTI::s_allocatorHooked.load( std::memory_order_relaxed ); }
+
+void vaMemory::SetTrackingEnabled( bool enable )
+{
+    if( !IsTrackingAvailable( ) || enable == MTI::s_trackingEnabled.load( ) )
+        return;
+
+    if( enable )
+    {
+        // start fresh; LiveBytes is kept as it still correctly accounts for allocations tracked earlier
+        for( int i = 0; i < c_maxTags; i++ )
+        {
+            auto & tag = MTI::s_tags[i];
+            tag.TotalAllocations        = 0;
+            tag.TotalBytes              = 0;
+            tag.PeakLiveBytes           = tag.LiveBytes.load( );
+            tag.PrevFrameAllocations    = 0;
+            tag.PrevFrameBytes          = 0;
+            tag.LastFrameAllocations    = 0;
+            tag.LastFrameBytes          = 0;
+            tag.MaxFrameAllocations     = 0;
+        }
+    }
+    MTI::s_trackingEnabled = enable;
+}
+
+bool vaMemory::IsTrackingEnabled( )         { return MTI::s_trackingEnabled.load( std::memory_order_relaxed ); }
+void vaMemory::SetStackSampling( int n )    { MTI::s_stackSampling = std::max( 0, n ); }
+int  vaMemory::GetStackSampling( )          { return MTI::s_stackSampling.load( std::memory_order_relaxed ); }
+
+void vaMemory::OnAllocatorHooked( )         { MTI::s_allocatorHooked = true; }
+void vaMemory::OnTrackedAllocation( int tag, size_t size )  { MTI::OnAllocation( tag, size ); }
+void vaMemory::OnTrackedFree( int tag, size_t size )        { MTI::OnFree( tag, size ); }
+
+void vaMemoryTrackingInternal::OnAllocation( int tag, size_t size )
+{
+    auto & counters = s_tags[tag];
+    int64 live = counters.LiveBytes.fetch_add( (int64)size, std::memory_order_relaxed ) + (int64)size;
+    int64 peak = counters.PeakLiveBytes.load( std::memory_order_relaxed );
+    while( live > peak && !counters.PeakLiveBytes.compare_exchange_weak( peak, live, std::memory_order_relaxed ) ) { }
+    counters.TotalAllocations.fetch_add( 1, std::memory_order_relaxed );
+    counters.TotalBytes.fetch_add( (int64)size, std::memory_order_relaxed );
+
+    int sampling = s_stackSampling.load( std::memory_order_relaxed );
+    if( sampling > 0 && ++t_stackSampleCounter >= sampling )
+    {
+        t_stackSampleCounter = 0;
+        SampleStack( tag, size );
+    }
+}
+
+void vaMemoryTrackingInternal::OnFree( int tag, size_t size )
+{
+    s_tags[tag].LiveBytes.fetch_sub( (int64)size, std::memory_order_relaxed );
+}
+
+void vaMemoryTrackingInternal::SampleStack( int tag, size_t size )
+{
+    void * frames[vaMemory::c_stackSampleDepth];
+    ULONG hash = 0;
+    // skip SampleStack & OnAllocation; the remaining allocator frames (if not inlined) get skipped when displaying
+    int frameCount = (int)::RtlCaptureStackBackTrace( 2, vaMemory::c_stackSampleDepth, frames, &hash );
+    hash ^= (uint32)tag * 0x9E3779B1u;
+
+    SpinLock lock( s_stackSamplesLock );
+    for( int probe = 0; probe < 16; probe++ )
+    {
+        StackSampleSlot & slot = s_stackSamples[( hash + probe ) % c_stackSampleSlots];
+        if( slot.SampleCount == 0 )
+        {
+            slot.Hash           = hash;
+            slot.Tag            = tag;
+            slot.FrameCount     = frameCount;
+            memcpy( slot.Frames, frames, sizeof( void* ) * frameCount );
+        }
+        else if( slot.Hash != hash || slot.Tag != tag )
+            continue;
+        slot.SampleCount++;
+        slot.SampledBytes += (int64)size;
+        return;
+    }
+    // table (locally) full - sample gets dropped
+}
+
+void vaMemory::TickFrame( )
+{
+    if( !IsTrackingEnabled( ) )
+        return;
+    int count = GetTagCount( );
+    for( int i = 0; i < count; i++ )
+    {
+        auto & tag = MTI::s_tags[i];
+        int64 allocations           = tag.TotalAllocations.load( std::memory_order_relaxed );
+        int64 bytes                 = tag.TotalBytes.load( std::memory_order_relaxed );
+        tag.LastFrameAllocations    = allocations - tag.PrevFrameAllocations;
+        tag.LastFrameBytes          = bytes - tag.PrevFrameBytes;
+        tag.PrevFrameAllocations    = allocations;
+        tag.PrevFrameBytes          = bytes;
+        tag.MaxFrameAllocations     = std::max( tag.MaxFrameAllocations, tag.LastFrameAllocations );
+    }
+}
+
+void vaMemory::GetTagStats( std::vector<TagStats> & outStats )
+{
+    int count = GetTagCount( );
+    outStats.resize( count );
+    for( int i = 0; i < count; i++ )
+    {
+        const auto & tag = MTI::s_tags[i];
+        TagStats & stats            = outStats[i];
+        stats.Name                  = TagName( i );
+        stats.LiveBytes             = tag.LiveBytes.load( std::memory_order_relaxed );
+        stats.PeakLiveBytes         = tag.PeakLiveBytes.load( std::memory_order_relaxed );
+        stats.TotalAllocations      = tag.TotalAllocations.load( std::memory_order_relaxed );
+        stats.TotalBytes            = tag.TotalBytes.load( std::memory_order_relaxed );
+        stats.LastFrameAllocations  = tag.LastFrameAllocations;
+        stats.LastFrameBytes        = tag.LastFrameBytes;
+        stats.MaxFrameAllocations   = tag.MaxFrameAllocations;
+    }
+}
+
+void vaMemory::GetTotals( int64 & outTotalAllocations, int64 & outTotalBytes, int64 & outLiveBytes )
+{
+    outTotalAllocations = outTotalBytes = outLiveBytes = 0;
+    int count = GetTagCount( );
+    for( int i = 0; i < count; i++ )
+    {
+        outTotalAllocations += MTI::s_tags[i].TotalAllocations.load( std::memory_order_relaxed );
+        outTotalBytes       += MTI::s_tags[i].TotalBytes.load( std::memory_order_relaxed );
+        outLiveBytes        += MTI::s_tags[i].LiveBytes.load( std::memory_order_relaxed );
+    }
+}
+
+void vaMemory::ResetPeaks( )
+{
+    for( int i = 0; i < c_maxTags; i++ )
+    {
+        MTI::s_tags[i].PeakLiveBytes        = MTI::s_tags[i].LiveBytes.load( );
+        MTI::s_tags[i].MaxFrameAllocations  = 0;
+    }
+}
+
+void vaMemory::GetStackSamples( std::vector<StackSample> & outSamples, int maxCount )
+{
+    outSamples.clear( );
+    {
+        // copy out first - can't allocate while holding the lock (operator new would deadlock when sampling)
+        static MTI::StackSampleSlot s_copy[MTI::c_stackSampleSlots];
+        {
+            MTI::SpinLock lock( MTI::s_stackSamplesLock );
+            memcpy( s_copy, MTI::s_stackSamples, sizeof( s_copy ) );
+        }
+        for( const auto & slot : s_copy )
+        {
+            if( slot.SampleCount == 0 )
+                continue;
+            StackSample sample;
+            sample.Tag          = slot.Tag;
+            sample.SampleCount  = slot.SampleCount;
+            sample.SampledBytes = slot.SampledBytes;
+            sample.FrameCount   = slot.FrameCount;
+            memcpy( sample.Frames, slot.Frames, sizeof( void* ) * slot.FrameCount );
+            outSamples.push_back( sample );
+        }
+    }
+    std::sort( outSamples.begin( ), outSamples.end( ), [ ]( const StackSample & a, const StackSample & b ) { return a.SampledBytes > b.SampledBytes; } );
+    if( (int)outSamples.size( ) > maxCount )
+        outSamples.resize( maxCount );
+}
+
+void vaMemory::ClearStackSamples( )
+{
+    MTI::SpinLock lock( MTI::s_stackSamplesLock );
+    memset( MTI::s_stackSamples, 0, sizeof( MTI::s_stackSamples ) );
+}
+
+string vaMemory::SymbolizeAddress( void * address )
+{
+    // DbgHelp is single threaded
+    std::lock_guard<std::mutex> lock( s_symbolMutex );
+
+    HANDLE process = ::GetCurrentProcess( );
+    if( !s_symbolsInitialized )
+    {
+        ::SymSetOptions( SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES );
+        ::SymInitialize( process, nullptr, TRUE );
+        s_symbolsInitialized = true;
+    }
+
+    char symbolBuffer[sizeof( SYMBOL_INFO ) + 256];
+    SYMBOL_INFO * symbol = reinterpret_cast<SYMBOL_INFO*>( symbolBuffer );
+    symbol->SizeOfStruct    = sizeof( SYMBOL_INFO );
+    symbol->MaxNameLen      = 255;
+    DWORD64 displacement    = 0;
+    if( !::SymFromAddr( process, (DWORD64)address, &displacement, symbol ) )
+        return vaStringTools::Format( "0x%p", address );
+
+    IMAGEHLP_LINE64 line = { sizeof( IMAGEHLP_LINE64 ) };
+    DWORD lineDisplacement = 0;
+    if( ::SymGetLineFromAddr64( process, (DWORD64)address, &lineDisplacement, &line ) )
+        return vaStringTools::Format( "%s (%s:%d)", symbol->Name, line.FileName, (int)line.LineNumber );
+    return string( symbol->Name );
+}
+
+void vaMemory::TickImGui( )
+{
+#ifdef VA_IMGUI_INTEGRATION_ENABLED
+    if( !IsTrackingAvailable( ) )
+    {
+        ImGui::Text( "Allocation tracking not linked in (VA_MEMORY_TRACKING_ENABLED, vaMemoryTracking.cpp)" );
+        return;
+    }
+
+    bool enabled = IsTrackingEnabled( );
+    if( ImGui::Checkbox( "Track heap allocations", &enabled ) )
+        SetTrackingEnabled( enabled );
+    if( ImGui::IsItemHovered( ) ) ImGui::SetTooltip( "Attributes every heap allocation to the active VA_MEMORY_TAG_SCOPE" );
+    if( !enabled )
+        return;
+
+    int sampling = GetStackSampling( );
+    if( ImGui::InputInt( "Stack sampling (1 in N)", &sampling, 64, 1024 ) )
+        SetStackSampling( sampling );
+    if( ImGui::IsItemHovered( ) ) ImGui::SetTooltip( "Captures a call stack for every Nth allocation to find the hot allocation sites; 0 disables" );
+    if( ImGui::Button( "Reset peaks" ) )
+        ResetPeaks( );
+
+    std::vector<TagStats> tagStats;
+    GetTagStats( tagStats );
+    std::sort( tagStats.begin( ), tagStats.end( ), [ ]( const TagStats & a, const TagStats & b ) { return a.LastFrameAllocations > b.LastFrameAllocations; } );
+
+    ImGui::Columns( 6, "vaMemoryTags" );
+    ImGui::Text( "Tag" );           ImGui::NextColumn( );
+    ImGui::Text( "Allocs/frame" );  ImGui::NextColumn( );
+    ImGui::Text( "KB/frame" );      ImGui::NextColumn( );
+    ImGui::Text( "Max allocs" );    ImGui::NextColumn( );
+    ImGui::Text( "Live KB" );       ImGui::NextColumn( );
+    ImGui::Text( "Peak KB" );       ImGui::NextColumn( );
+    ImGui::Separator( );
+    for( const TagStats & stats : tagStats )
+    {
+        if( stats.TotalAllocations == 0 && stats.LiveBytes == 0 )
+            continue;
+        ImGui::Text( "%s", stats.Name );                                    ImGui::NextColumn( );
+        ImGui::Text( "%lld", stats.LastFrameAllocations );                  ImGui::NextColumn( );
+        ImGui::Text( "%.1f", stats.LastFrameBytes / 1024.0 );               ImGui::NextColumn( );
+        ImGui::Text( "%lld", stats.MaxFrameAllocations );                   ImGui::NextColumn( );
+        ImGui::Text( "%.1f", stats.LiveBytes / 1024.0 );                    ImGui::NextColumn( );
+        ImGui::Text( "%.1f", stats.PeakLiveBytes / 1024.0 );                ImGui::NextColumn( );
+    }
+    ImGui::Columns( 1 );
+
+    if( GetStackSampling( ) > 0 && ImGui::TreeNode( "Hot allocation sites (sampled)" ) )
+    {
+        if( ImGui::Button( "Clear samples" ) )
+            ClearStackSamples( );
+
+        if( s_symbolCache == nullptr )
+            s_symbolCache = new std::unordered_map<void *, string>( );
+        auto symbolize = [ ]( void * address ) -> const string &
+        {
+            auto it = s_symbolCache->find( address );
+            if( it == s_symbolCache->end( ) )
+                it = s_symbolCache->insert( std::make_pair( address, SymbolizeAddress( address ) ) ).first;
+            return it->second;
+        };
+        // first frame that isn't the allocator itself
+        auto isAllocatorFrame = [ ]( const string & name )
+        {
+            return name.find( "operator new" ) != string::npos || name.find( "TrackedNew" ) != string::npos || name.find( "TrackedAllocate" ) != string::npos 
+                || name.compare( 0, 5, "std::" ) == 0;
+        };
+
+        std::vector<StackSample> samples;
+        GetStackSamples( samples, 24 );
+        for( const StackSample & sample : samples )
+        {
+            int siteFrame = 0;
+            while( siteFrame < sample.FrameCount - 1 && isAllocatorFrame( symbolize( sample.Frames[siteFrame] ) ) )
+                siteFrame++;
+            const char * site = ( sample.FrameCount > 0 ) ? ( symbolize( sample.Frames[siteFrame] ).c_str( ) ) : ( "?" );
+            ImGui::Text( "[%s] %lld samples, %.1f KB: %s", TagName( sample.Tag ), sample.SampleCount, sample.SampledBytes / 1024.0, site );
+            if( ImGui::IsItemHovered( ) )
+            {
+                string stack;
+                for( int i = 0; i < sample.FrameCount; i++ )
+                    stack += symbolize( sample.Frames[i] ) + "\n";
+                ImGui::SetTooltip( "%s", stack.c_str( ) );
+            }
+        }
+        ImGui::TreePop( );
+    }
+#endif
+}
@@ -26,15 +26,94 @@ namespace Vanilla
 {
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // vaMemory
+    //
+    // With VA_MEMORY_TRACKING_ENABLED and vaMemoryTracking.cpp compiled into the executable all global new/delete go 
+    // through vaMemory, which can (when enabled at runtime) attribute every heap allocation to the 'tag' active on the
+    // allocating thread - see VA_MEMORY_TAG_SCOPE. Tag scopes are only a thread local store so they're always compiled in.
+    // Per-tag counters are: live bytes, peak live bytes, and allocations/bytes per frame (frame boundary is TickFrame).
+    // Optionally every Nth tracked allocation also captures a call stack so that hot allocation sites can be found.
+    // Frees are attributed to the tag that made the allocation, regardless of the scope active when freeing.
     class vaMemory
     {
+    public:
+        static constexpr int                c_maxTags               = 128;
+        static constexpr int                c_maxTagNameLength      = 48;
+        static constexpr int                c_stackSampleDepth      = 16;
+
+        struct TagStats
+        {
+            const char *                    Name                    = nullptr;
+            int64                           LiveBytes               = 0;
+            int64                           PeakLiveBytes           = 0;
+            int64                           TotalAllocations        = 0;    // since tracking was enabled
+            int64                           TotalBytes              = 0;    // since tracking was enabled
+            int64                           LastFrameAllocations    = 0;
+            int64                           LastFrameBytes          = 0;
+            int64                           MaxFrameAllocations     = 0;
+        };
+
+        struct StackSample
+        {
+            int                             Tag                     = 0;
+            int64                           SampleCount             = 0;
+            int64                           SampledBytes            = 0;
+            int                             FrameCount              = 0;
+            void *                          Frames[c_stackSampleDepth];
+        };
+
     private:
-       friend class vaCore;
+        friend class vaCore;
+
+        static void                         Initialize( );
+        static void                         Deinitialize( );
+
+    public:
+        // tag 0 is "untagged"; registering an existing name returns the existing tag; thread-safe
+        static int                          RegisterTag( const char * name );
+        static int                          GetTagCount( );
 
-       static void						Initialize( );
-       static void						Deinitialize( );
+        // current tag for the calling thread (used for all allocations it makes); prefer VA_MEMORY_TAG_SCOPE
+        static int                          GetThreadTag( );
+        static void                         SetThreadTag( int tag );
+
+        static bool                         IsTrackingAvailable( );         // global new/delete hooked (vaMemoryTracking.cpp linked in)?
+        static void                         SetTrackingEnabled( bool enable );
+        static bool                         IsTrackingEnabled( );
+        // 0 disables call stack sampling, otherwise captures one in every sampleEveryNth tracked allocations (per thread)
+        static void                         SetStackSampling( int sampleEveryNth );
+        static int                          GetStackSampling( );
+
+        // closes the current frame - updates the per-frame counters; call once per frame from the main thread
+        static void                         TickFrame( );
+
+        static void                         GetTagStats( std::vector<TagStats> & outStats );
+        static void                         GetTotals( int64 & outTotalAllocations, int64 & outTotalBytes, int64 & outLiveBytes );
+        static void                         ResetPeaks( );
+
+        // hottest sampled allocation sites, sorted by sampled bytes
+        static void                         GetStackSamples( std::vector<StackSample> & outSamples, int maxCount = 32 );
+        static void                         ClearStackSamples( );
+        static string                       SymbolizeAddress( void * address );
+
+        static void                         TickImGui( );
+
+        // called by the global new/delete replacement in vaMemoryTracking.cpp
+        static void                         OnAllocatorHooked( );
+        static void                         OnTrackedAllocation( int tag, size_t size );
+        static void                         OnTrackedFree( int tag, size_t size );
     };
 
+    // sets the allocation tag for the calling thread for the lifetime of the scope
+    class vaMemoryTagScope
+    {
+        int                                 m_prevTag;
+    public:
+        explicit vaMemoryTagScope( int tag ) : m_prevTag( vaMemory::GetThreadTag( ) )   { vaMemory::SetThreadTag( tag ); }
+        ~vaMemoryTagScope( )                                                            { vaMemory::SetThreadTag( m_prevTag ); }
+    };
+
+    #define VA_MEMORY_TAG_SCOPE( name )     static const int VA_COMBINE( vaMemoryTag_, __LINE__ ) = Vanilla::vaMemory::RegisterTag( name ); Vanilla::vaMemoryTagScope VA_COMBINE( vaMemoryTagScope_, __LINE__ )( VA_COMBINE( vaMemoryTag_, __LINE__ ) );
+
     // Just a simple generic self-contained memory buffer helper class, for passing data as argument, etc.
     class vaMemoryBuffer
     {
@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Opt-in part of vaMemory allocation tracking: replaces the global new/delete so that every heap allocation can be
+// attributed to a tag. This is not part of AllModules - an executable that wants tracking defines
+// VA_MEMORY_TRACKING_ENABLED and compiles this file itself (see the Benchmarks project).
+
+#include "Core/vaMemory.h"
+
+#include <new>
+#include <algorithm>
+
+using namespace Vanilla;
+
+#ifdef VA_MEMORY_TRACKING_ENABLED
+
+// Global new/delete replacements. Every allocation gets a 16 byte header just before the returned pointer holding the
+// size and the tag, so that frees can be attributed back even if tracking was toggled in between.
+namespace
+{
+    struct AllocationHeader
+    {
+        uint64                  Size;
+        uint32                  Tag;
+        uint32                  Flags;
+    };
+    static_assert( sizeof( AllocationHeader ) == 16, "header must keep the default new alignment" );
+
+    static constexpr uint32     c_flagTracked           = 0x00000001;
+
+    inline size_t HeaderSize( size_t alignment )        { return std::max( sizeof( AllocationHeader ), alignment ); }
+
+    inline void * TrackedAllocate( size_t size, size_t alignment )
+    {
+        if( size == 0 )
+            size = 1;
+        const size_t headerSize = HeaderSize( alignment );
+        uint8 * raw = ( alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__ ) ? ( (uint8*)::_aligned_malloc( size + headerSize, alignment ) ) : ( (uint8*)::malloc( size + headerSize ) );
+        if( raw == nullptr )
+            return nullptr;
+        AllocationHeader * header = reinterpret_cast<AllocationHeader*>( raw + headerSize ) - 1;
+        header->Size    = size;
+        header->Tag     = (uint32)vaMemory::GetThreadTag( );
+        header->Flags   = 0;
+        if( vaMemory::IsTrackingEnabled( ) )
+        {
+            header->Flags |= c_flagTracked;
+            vaMemory::OnTrackedAllocation( header->Tag, size );
+        }
+        return raw + headerSize;
+    }
+
+    inline void * TrackedNew( size_t size, size_t alignment )
+    {
+        for( ;; )
+        {
+            void * ptr = TrackedAllocate( size, alignment );
+            if( ptr != nullptr )
+                return ptr;
+            std::new_handler handler = std::get_new_handler( );
+            if( handler == nullptr )
+                throw std::bad_alloc( );
+            handler( );
+        }
+    }
+
+    inline void TrackedDelete( void * ptr, size_t alignment ) noexcept
+    {
+        if( ptr == nullptr )
+            return;
+        const size_t headerSize = HeaderSize( alignment );
+        AllocationHeader * header = reinterpret_cast<AllocationHeader*>( ptr ) - 1;
+        if( header->Flags & c_flagTracked )
+            vaMemory::OnTrackedFree( header->Tag, (size_t)header->Size );
+        uint8 * raw = reinterpret_cast<uint8*>( ptr ) - headerSize;
+        if( alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__ )
+            ::_aligned_free( raw );
+        else
+            ::free( raw );
+    }
+
+    // lets vaMemory know the allocator is hooked (static initialization is done long before anyone can enable tracking)
+    struct AllocatorHookedRegistration
+    {
+        AllocatorHookedRegistration( )                  { vaMemory::OnAllocatorHooked( ); }
+    } s_allocatorHookedRegistration;
+}
+
+void * operator new( size_t size )                                              { return TrackedNew( size, __STDCPP_DEFAULT_NEW_ALIGNMENT__ ); }
+void * operator new[]( size_t size )                                            { return TrackedNew( size, __STDCPP_DEFAULT_NEW_ALIGNMENT__ ); }
+void * operator new( size_t size, std::align_val_t alignment )                  { return TrackedNew( size, (size_t)alignment ); }
+void * operator new[]( size_t size, std::align_val_t alignment )                { return TrackedNew( size, (size_t)alignment ); }
+void operator delete( void * ptr ) noexcept                                     { TrackedDelete( ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__ ); }
+void operator delete[]( void * ptr ) noexcept                                   { TrackedDelete( ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__ ); }
+void operator delete( void * ptr, size_t ) noexcept                             { TrackedDelete( ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__ ); }
+void operator delete[]( void * ptr, size_t ) noexcept                           { TrackedDelete( ptr, __STDCPP_DEFAULT_NEW_ALIGNMENT__ ); }
+void operator delete( void * ptr, std::align_val_t alignment ) noexcept         { TrackedDelete( ptr, (size_t)alignment ); }
+void operator delete[]( void * ptr, std::align_val_t alignment ) noexcept       { TrackedDelete( ptr, (size_t)alignment ); }
+void operator delete( void * ptr, size_t, std::align_val_t alignment ) noexcept { TrackedDelete( ptr, (size_t)alignment ); }
+void operator delete[]( void * ptr, size_t, std::align_val_t alignment ) noexcept { TrackedDelete( ptr, (size_t)alignment ); }
+
+#endif // VA_MEMORY_TRACKING_ENABLED
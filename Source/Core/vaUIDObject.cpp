@@ -41,6 +41,28 @@ vaUIDObjectRegistrar::vaUIDObjectRegistrar()
     assert( vaThreading::IsMainThread() );
 }
 
+vaUIDObjectRegistrar::~vaUIDObjectRegistrar( )
+{
+    for( int i = 0; i < c_shardCount; i++ )
+    {
+        std::unique_lock<std::shared_mutex> shardLock( m_shards[i].Mutex );
+        // not 0? memory leak or not all objects deleted before the registrar was deleted (bug)
+        assert( m_shards[i].Objects.size( ) == 0 );
+    }
+}
+
+bool vaUIDObjectRegistrar::Track( vaUIDObject * obj )
+{
+    std::unique_lock<std::shared_mutex> shardLock( GetShard( obj->m_uid ).Mutex );
+    return TrackNoMutexLock( obj );
+}
+
+bool vaUIDObjectRegistrar::Untrack( vaUIDObject * obj )
+{
+    std::unique_lock<std::shared_mutex> shardLock( GetShard( obj->m_uid ).Mutex );
+    return UntrackNoMutexLock( obj );
+}
+
 bool vaUIDObjectRegistrar::TrackNoMutexLock( vaUIDObject * obj )
 {
     if( obj->m_tracked )
@@ -49,15 +71,16 @@ bool vaUIDObjectRegistrar::TrackNoMutexLock( vaUIDObject * obj )
         return false;
     }
 
-    auto it = m_objectsMap.find( obj->m_uid );
-    if( it != m_objectsMap.end( ) )
+    Shard & shard = GetShard( obj->m_uid );
+    auto it = shard.Objects.find( obj->m_uid );
+    if( it != shard.Objects.end( ) )
     {
         VA_LOG_ERROR( "vaUIDObjectRegistrar::Track() - object with the same UID already exists: this is a potential bug, the new object will not be tracked and will not be searchable by vaUIDObjectRegistrar::Find" );
         return false;
     }
     else
     {
-        m_objectsMap.insert( std::make_pair( obj->m_uid, obj ) );
+        shard.Objects.insert( std::make_pair( obj->m_uid, obj ) );
         obj->m_tracked = true;
         return true;
     }
@@ -69,8 +92,9 @@ bool vaUIDObjectRegistrar::UntrackNoMutexLock( vaUIDObject * obj )
     if( !obj->m_tracked )
         return false;
 
-    auto it = m_objectsMap.find( obj->m_uid );
-    if( it == m_objectsMap.end( ) )
+    Shard & shard = GetShard( obj->m_uid );
+    auto it = shard.Objects.find( obj->m_uid );
+    if( it == shard.Objects.end( ) )
     {
         VA_ERROR( "vaUIDObjectRegistrar::Untrack() - A tracked vaUIDObject couldn't be found: this is an indicator of a more serious error such as an algorithm bug or a memory overwrite. Don't ignore it." );
         return false;
@@ -86,7 +110,7 @@ bool vaUIDObjectRegistrar::UntrackNoMutexLock( vaUIDObject * obj )
         else
         {
             obj->m_tracked = false;
-            m_objectsMap.erase( it );
+            shard.Objects.erase( it );
             return true;
         }
     }
@@ -95,12 +119,18 @@ bool vaUIDObjectRegistrar::UntrackNoMutexLock( vaUIDObject * obj )
 
 void vaUIDObjectRegistrar::SwapIDs( vaUIDObject & a, vaUIDObject & b )
 {
-    std::unique_lock<mutex> mapLock( m_objectsMapMutex );
+    // both shards locked (in a fixed order, to avoid deadlocks) for the whole swap so no one can observe the in-between state
+    int shardA = ShardIndex( a.m_uid );
+    int shardB = ShardIndex( b.m_uid );
+    std::unique_lock<std::shared_mutex> lockFirst( m_shards[ std::min( shardA, shardB ) ].Mutex );
+    std::unique_lock<std::shared_mutex> lockSecond;
+    if( shardA != shardB )
+        lockSecond = std::unique_lock<std::shared_mutex>( m_shards[ std::max( shardA, shardB ) ].Mutex );
 
     bool aWasTracked = a.m_tracked;
     if( a.m_tracked )
         UntrackNoMutexLock( &a );
-    bool bWasTracked = a.m_tracked;
+    bool bWasTracked = b.m_tracked;
     if( b.m_tracked )
         UntrackNoMutexLock( &b );
 
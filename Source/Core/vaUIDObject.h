@@ -23,6 +23,8 @@
 #include "vaSingleton.h"
 #include "System\vaStream.h"
 
+#include <unordered_map>
+
 namespace Vanilla
 {
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -41,7 +43,7 @@ namespace Vanilla
     private:
         friend class vaUIDObjectRegistrar;
         vaGUID /*const*/                             m_uid;                                 // removed const to be able to have SwapIDs but no one else anywhere should ever be modifying this!!
-        bool                                         m_tracked;                            // will be false on startup and become true on UIDObject_MakeOrphan()
+        std::atomic_bool                             m_tracked;                            // will be false on startup and become true on UIDObject_MakeOrphan(); only changed with the object's registrar shard locked
 
     protected:
         explicit vaUIDObject( const vaGUID & uid );
@@ -55,29 +57,33 @@ namespace Vanilla
         bool                                         UIDObject_Untrack( );
     };
 
+    // Objects are spread across c_shardCount independent hash maps by GUID hash, each with its own reader/writer lock, so
+    // lookups (FindCached misses during scene selection, material resolves, etc.) only take a shared lock on one shard and
+    // don't contend with each other or with tracking/untracking of objects that land in other shards.
     class vaUIDObjectRegistrar : public vaSingletonBase< vaUIDObjectRegistrar >
     {
     protected:
         friend class vaUIDObject;
 
-        map< vaGUID, vaUIDObject*, vaGUIDComparer >  m_objectsMap;
-        mutex                                       m_objectsMapMutex;
+        static constexpr int                        c_shardCount        = 64;       // must be power of 2
+
+        struct alignas( 64 ) Shard                  // cache line aligned so that shard locks don't false-share
+        {
+            std::unordered_map< vaGUID, vaUIDObject*, vaGUIDHasher >
+                                                    Objects;
+            mutable std::shared_mutex               Mutex;
+        };
+        Shard                                       m_shards[c_shardCount];
 
     private:
         friend class vaCore;
         vaUIDObjectRegistrar( );
-        ~vaUIDObjectRegistrar( )
-        {
-            std::unique_lock<mutex> mapLock( m_objectsMapMutex );
-            // not 0? memory leak or not all objects deleted before the registrar was deleted (bug)
-            assert( m_objectsMap.size( ) == 0 );
-        }
+        ~vaUIDObjectRegistrar( );
 
     public:
-        bool                                         IsTracked( const vaUIDObject * obj ) const;
-        bool                                         Track( vaUIDObject * obj )                     { std::unique_lock<mutex> mapLock( m_objectsMapMutex ); return TrackNoMutexLock(obj);      }
-        bool                                         Untrack( vaUIDObject * obj )                   { std::unique_lock<mutex> mapLock( m_objectsMapMutex ); return UntrackNoMutexLock(obj);    }
-
+        bool                                        IsTracked( const vaUIDObject * obj ) const      { return obj->m_tracked; }
+        bool                                        Track( vaUIDObject * obj );
+        bool                                        Untrack( vaUIDObject * obj );
 
     public:
         template< class T >
@@ -95,15 +101,18 @@ namespace Vanilla
         void                                        SwapIDs( vaUIDObject & a, vaUIDObject & b );
 
     private:
-        // perhaps make these public? one could use it to track/untrack a bunch of objects at once or similar
-        mutex &                                     GetMutex( ) { return m_objectsMapMutex; }
+        static int                                  ShardIndex( const vaGUID & uid )                { return (int)( vaGUIDHasher()( uid ) >> 7 ) & ( c_shardCount - 1 ); }
+        Shard &                                     GetShard( const vaGUID & uid )                  { return m_shards[ ShardIndex( uid ) ]; }
+
+        // these expect the shard that obj->m_uid maps to to be locked for writing
         bool                                        TrackNoMutexLock( vaUIDObject * obj );
         bool                                        UntrackNoMutexLock( vaUIDObject * obj );
 
+        // expects the shard to be locked (at least for reading)
         template< class T >
-        static T *                                  FindNoMutexLock( const vaGUID & uid );
+        static T *                                  FindNoMutexLock( const Shard & shard, const vaGUID & uid );
 
-        void                                        UntrackIfTracked( vaUIDObject * obj )                   { std::unique_lock<mutex> mapLock( m_objectsMapMutex ); if( obj->m_tracked ) UntrackNoMutexLock(obj);    }
+        void                                        UntrackIfTracked( vaUIDObject * obj )           { if( obj->m_tracked ) Untrack( obj ); }
     };
 
     // inline 
@@ -123,34 +132,30 @@ namespace Vanilla
         return vaUIDObjectRegistrar::GetInstance( ).Untrack( this );
     }
 
-    inline bool vaUIDObjectRegistrar::IsTracked( const vaUIDObject * obj ) const
-    {
-        std::unique_lock<mutex> mapLock( vaUIDObjectRegistrar::GetInstance( ).m_objectsMapMutex );
-        return obj->m_tracked;
-    }
-
     template< class T>
     inline shared_ptr<T> vaUIDObjectRegistrar::Find( const vaGUID & uid )
     {
-        std::unique_lock<mutex> mapLock( vaUIDObjectRegistrar::GetInstance( ).m_objectsMapMutex );
-        
-        shared_ptr<T> object = nullptr;
+        if( uid == vaCore::GUIDNull( ) )
+            return nullptr;
 
-        T* objPtr = FindNoMutexLock<T>( uid );
+        const Shard & shard = vaUIDObjectRegistrar::GetInstance( ).GetShard( uid );
+        std::shared_lock<std::shared_mutex> shardLock( shard.Mutex );
+        
+        T* objPtr = FindNoMutexLock<T>( shard, uid );
         if( objPtr != nullptr )
-            return std::static_pointer_cast<T>( objPtr->shared_from_this( ) );
+            return std::static_pointer_cast<T>( objPtr->weak_from_this( ).lock( ) );    // weak: object could be in the process of getting destroyed (and not yet untracked)
         else
             return nullptr;
     }
 
     template< class T>
-    inline T * vaUIDObjectRegistrar::FindNoMutexLock( const vaGUID & uid )
+    inline T * vaUIDObjectRegistrar::FindNoMutexLock( const Shard & shard, const vaGUID & uid )
     {
         if( uid == vaCore::GUIDNull( ) )
             return nullptr;
 
-        auto it = vaUIDObjectRegistrar::GetInstance( ).m_objectsMap.find( uid );
-        if( it == vaUIDObjectRegistrar::GetInstance( ).m_objectsMap.end( ) )
+        auto it = shard.Objects.find( uid );
+        if( it == shard.Objects.end( ) )
         {
             return nullptr;
         }
@@ -185,18 +190,11 @@ namespace Vanilla
 
         if( object == nullptr || object->m_uid != uid )
         {
-            std::unique_lock<mutex> mapLock( vaUIDObjectRegistrar::GetInstance( ).m_objectsMapMutex );
-            T * objPtr = FindNoMutexLock<T>( uid );
-            if( objPtr != nullptr )
-            {
-                object = std::static_pointer_cast<T>( objPtr->shared_from_this( ) );
+            object = Find<T>( uid );
+            if( object != nullptr )
                 inOutCachedPtr = object;
-            }
             else
-            {
-                object = nullptr;
                 inOutCachedPtr.reset( );
-            }
         }
         return object;
     }
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "vaUploadRingAllocator.h"
+
+#include <algorithm>
+
+using namespace Vanilla;
+
+vaUploadRingAllocator::vaUploadRingAllocator( uint64 capacity, int framesInFlight )
+    : m_capacity( capacity ), m_framesInFlight( std::max( 1, framesInFlight ) )
+{
+    assert( capacity > 0 );
+    m_frameMarks = new FrameMark[m_framesInFlight];
+    m_stats.Capacity = m_capacity;
+}
+
+vaUploadRingAllocator::~vaUploadRingAllocator( )
+{
+    delete[] m_frameMarks;
+}
+
+void vaUploadRingAllocator::BeginFrame( int64 frameIndex )
+{
+    assert( frameIndex > m_currentFrameIndex );
+
+    // close the frame that just finished
+    if( m_currentFrameIndex >= 0 )
+    {
+        FrameMark & mark = m_frameMarks[ m_currentFrameIndex % m_framesInFlight ];
+        mark.FrameIndex = m_currentFrameIndex;
+        mark.End        = m_head;
+        m_stats.LastFrameUsedBytes      = m_head - m_currentFrameStart;
+        m_stats.LastFrameAllocations    = m_currentFrameAllocations;
+    }
+
+    // release everything up to the end of the most recent frame the GPU is guaranteed to be done with; frame indices can
+    // skip so check all marks (a mark overwritten before it got released just delays the release, which is safe)
+    for( int i = 0; i < m_framesInFlight; i++ )
+    {
+        const FrameMark & mark = m_frameMarks[i];
+        if( mark.FrameIndex >= 0 && mark.FrameIndex <= frameIndex - m_framesInFlight )
+            m_tail = std::max( m_tail, mark.End );
+    }
+    assert( m_tail <= m_head );
+
+    m_currentFrameIndex         = frameIndex;
+    m_currentFrameStart         = m_head;
+    m_currentFrameAllocations   = 0;
+    m_stats.FrameIndex          = frameIndex;
+    m_stats.InFlightBytes       = m_head - m_tail;
+}
+
+bool vaUploadRingAllocator::Allocate( uint64 size, uint64 alignment, uint64 & outOffset )
+{
+    assert( alignment > 0 && ( alignment & ( alignment - 1 ) ) == 0 );
+    assert( ( m_capacity % alignment ) == 0 );
+    assert( m_currentFrameIndex >= 0 ); // BeginFrame never called?
+
+    // nothing in flight: restart from the beginning so a big slice doesn't get rejected just because of where the head is
+    if( m_head == m_tail && ( m_head % m_capacity ) != 0 )
+        m_head = m_tail = m_head - ( m_head % m_capacity ) + m_capacity;
+
+    uint64 offset   = m_head % m_capacity;
+    uint64 aligned  = ( offset + ( alignment - 1 ) ) & ~( alignment - 1 );
+    // doesn't fit before the end? skip the remainder and start from the beginning
+    if( aligned + size > m_capacity )
+        aligned = m_capacity;
+    uint64 newHead  = m_head + ( aligned - offset ) + size;
+    if( aligned == m_capacity )
+        aligned = 0;
+
+    if( size > m_capacity || ( newHead - m_tail ) > m_capacity )
+    {
+        m_stats.TotalFailedAllocations++;
+        return false;
+    }
+
+    m_head = newHead;
+    m_currentFrameAllocations++;
+    m_stats.InFlightBytes = m_head - m_tail;
+    outOffset = aligned;
+    return true;
+}
@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "vaCore.h"
+
+namespace Vanilla
+{
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // vaUploadRingAllocator
+    //
+    // Sub-allocator for a single, persistently mapped upload buffer shared by all frames in flight (used for transient
+    // constant buffer data, see vaConstantBufferDX12::Update). It only deals with offsets so it is platform-neutral; the
+    // owner maps the returned offsets onto its buffer's CPU/GPU addresses.
+    // Allocations are handed out linearly from the head and wrap around at the end (a slice never straddles the end -
+    // the remainder gets skipped); BeginFrame( N ) releases everything allocated before frame N - framesInFlight began,
+    // so a slice stays valid until the GPU is done with the frame that allocated it. There is no per-allocation free.
+    // Unlike vaFrameArena there's no fallback - Allocate returns false when the ring is full and the caller has to
+    // handle it (for ex. by using a dedicated buffer). Not thread-safe: intended to be used from the render thread only.
+    class vaUploadRingAllocator
+    {
+    public:
+        struct Stats
+        {
+            int64                           FrameIndex              = -1;
+            uint64                          Capacity                = 0;
+            uint64                          LastFrameUsedBytes      = 0;    // includes alignment and wrap-around padding
+            uint64                          LastFrameAllocations    = 0;
+            uint64                          InFlightBytes           = 0;    // everything not yet released, including the current frame
+            int64                           TotalFailedAllocations  = 0;
+        };
+
+    private:
+        struct FrameMark
+        {
+            int64                           FrameIndex              = -1;
+            uint64                          End                     = 0;    // m_head at the end of the frame
+        };
+
+        const uint64                        m_capacity;
+        const int                           m_framesInFlight;
+
+        // monotonically increasing byte positions (offset in buffer is position % capacity); m_head - m_tail is the used size
+        uint64                              m_head                  = 0;
+        uint64                              m_tail                  = 0;
+
+        FrameMark *                         m_frameMarks;                   // one per frame in flight
+        int64                               m_currentFrameIndex     = -1;
+        uint64                              m_currentFrameStart     = 0;
+        uint64                              m_currentFrameAllocations = 0;
+
+        Stats                               m_stats;
+
+    public:
+        vaUploadRingAllocator( uint64 capacity, int framesInFlight );
+        ~vaUploadRingAllocator( );
+
+        vaUploadRingAllocator( const vaUploadRingAllocator & ) = delete;
+        vaUploadRingAllocator & operator = ( const vaUploadRingAllocator & ) = delete;
+
+    public:
+        // starts a new frame and releases slices allocated by frame (frameIndex - framesInFlight) and older - frameIndex must increase monotonically
+        void                                BeginFrame( int64 frameIndex );
+
+        // alignment must be a power of 2 that capacity is a multiple of; returns false if there's not enough free space
+        bool                                Allocate( uint64 size, uint64 alignment, uint64 & outOffset );
+
+        uint64                              GetCapacity( ) const                                { return m_capacity; }
+        int64                               GetCurrentFrame( ) const                            { return m_currentFrameIndex; }
+        int                                 GetFramesInFlight( ) const                          { return m_framesInFlight; }
+        // is a slice allocated during 'frameIndex' still valid?
+        bool                                IsFrameAlive( int64 frameIndex ) const              { return frameIndex >= 0 && frameIndex <= m_currentFrameIndex && (m_currentFrameIndex - frameIndex) < m_framesInFlight; }
+
+        const Stats &                       GetStats( ) const                                   { return m_stats; }
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vaCore.h"
+#include "vaMemory.h"
 
 #include "IntegratedExternals\vaTinyxml2Integration.h"
 
@@ -76,18 +77,21 @@ namespace Vanilla
         // parse data, set to loading mode
         vaXMLSerializer( const char * inputData, size_t dataSize )
         {
+            VA_MEMORY_TAG_SCOPE( "XMLSerialization" );
             InitReadingFromBuffer( inputData, dataSize );
         }
 
         // parse data, set to loading mode
         explicit vaXMLSerializer( vaFileStream & fileStream )
         {
+            VA_MEMORY_TAG_SCOPE( "XMLSerialization" );
             InitReadingFromFileStream( fileStream );
         }
 
         // parse data, set to loading mode
         explicit vaXMLSerializer( const wstring & filePath )
         {
+            VA_MEMORY_TAG_SCOPE( "XMLSerialization" );
             vaFileStream inFile;
             if( !inFile.Open( filePath, FileCreationMode::Open ) )
                 VA_LOG_ERROR( L"vaXMLSerializer::WriterSaveToFile(%s) - unable to create file for saving", filePath.c_str( ) );
@@ -32,6 +32,8 @@
 #include "IntegratedExternals/vaImguiIntegration.h"
 #include "Scene/vaAssetImporter.h"
 
+#include "VRS-MaterialTuner.h"
+
 #include <iomanip>
 #include <sstream> // stringstream
 #include <fstream>
@@ -135,6 +137,11 @@ VanillaSample::VanillaSample( vaRenderDevice & renderDevice, vaApplicationBase &
     m_SSAO                  = std::make_shared<vaASSAOLite>( GetRenderDevice() );
     m_DepthOfField          = std::make_shared<vaDepthOfField>( GetRenderDevice() );
 
+    // these get rebuilt and reset every frame so their storage can come from the per-frame arena
+    m_selectedOpaque.MeshList->SetFrameArena( &GetRenderDevice().GetFrameArena() );
+    m_selectedTransparent.MeshList->SetFrameArena( &GetRenderDevice().GetFrameArena() );
+    m_queuedShadowmapRenderSelection.MeshList->SetFrameArena( &GetRenderDevice().GetFrameArena() );
+
     // this is used for all frame buffer needs - color, depth, linear depth, gbuffer material stuff if used, etc.
     m_GBufferFormats = m_GBuffer->GetFormats();
 
@@ -439,6 +446,7 @@ void VanillaSample::OnTick( float deltaTime )
     {
         auto controller = m_camera->GetAttachedController( );
         m_camera->AttachController( nullptr );
+        vaTextureReductionTestTool::GetInstance( ).SetScene( m_currentScene );
         vaTextureReductionTestTool::GetInstance( ).TickCPU( m_camera );
         m_camera->AttachController( controller );   // <- this actually updates the controller to current camera values so it doesn't override us in Tick()
         //m_camera->Tick( 0.0f, false );
@@ -545,7 +553,18 @@ void VanillaSample::OnTick( float deltaTime )
             assert( m_selectedOpaque.MeshList->Count( ) == 0 );
             assert( m_selectedTransparent.MeshList->Count( ) == 0 );
 
-            m_currentDrawResults |= m_currentScene->SelectForRendering( &m_selectedOpaque, &m_selectedTransparent, vaRenderSelection::FilterSettings::FrustumCull( *m_camera ), sceneObjectFilter );
+            m_currentDrawResults |= m_currentScene->SelectForRendering( &m_selectedOpaque, &m_selectedTransparent, vaRenderSelection::FilterSettings::FrustumCull( *m_camera, &GetRenderDevice().GetFrameArena() ), sceneObjectFilter );
+
+            if( m_collectVisibleMaterials )
+            {
+                m_lastFrameVisibleMaterials.clear( );
+                for( const vaRenderSelection * selection : { &m_selectedOpaque, &m_selectedTransparent } )
+                    for( int i = 0; i < selection->MeshList->Count( ); i++ )
+                        if( ( *selection->MeshList )[i].Material != nullptr )
+                            m_lastFrameVisibleMaterials.push_back( ( *selection->MeshList )[i].Material );
+                std::sort( m_lastFrameVisibleMaterials.begin( ), m_lastFrameVisibleMaterials.end( ) );
+                m_lastFrameVisibleMaterials.erase( std::unique( m_lastFrameVisibleMaterials.begin( ), m_lastFrameVisibleMaterials.end( ) ), m_lastFrameVisibleMaterials.end( ) );
+            }
 
             // This is where we would start the async sorts if we had that implemented - or actually at some point below
             // if we're changing VRS shading rate
@@ -1039,9 +1058,16 @@ vaDrawResultFlags VanillaSample::RenderTick( float deltaTime )
                 probes[i]->Import( mainContext, probeDatas[i] );
             else
             {
-                vaRenderSelection selectionOpaque;
-                vaRenderSelection selectionTransparent;
-                auto results = m_currentScene->SelectForRendering( &selectionOpaque, &selectionTransparent, vaRenderSelection::FilterSettings::EnvironmentProbeCull( probeDatas[i] ), 
+                // one omnidirectional selection is shared by all faces rendered in this step; with the time-sliced capture it gets
+                // redone every step (frame) as instances can be added, removed or moved while the capture is in progress, and a 
+                // selection kept from the first step would then reference stale ones (scene switches also cancel the capture, see 
+                // the probe Reset calls in the scene stuff above)
+                const bool timeSliced = m_settings.IBLTimeSlicedCapture;
+                vaRenderSelection & selectionOpaque         = m_IBLCaptureSelectionOpaque;
+                vaRenderSelection & selectionTransparent    = m_IBLCaptureSelectionTransparent;
+                selectionOpaque.Reset( );
+                selectionTransparent.Reset( );
+                vaDrawResultFlags results = m_currentScene->SelectForRendering( &selectionOpaque, &selectionTransparent, vaRenderSelection::FilterSettings::EnvironmentProbeCull( probeDatas[i] ), 
                     [ ]( const vaSceneObject & obj, const vaMatrix4x4 & , const vaOrientedBoundingBox &, const vaRenderMesh &, const vaRenderMaterial &, int & outBaseShadingRate, vaVector4 & ) -> bool
                 { 
                     outBaseShadingRate;
@@ -1072,8 +1098,26 @@ vaDrawResultFlags VanillaSample::RenderTick( float deltaTime )
 
                         return drawResults;
                     };
-                    if( probes[i]->Capture( mainContext, probeDatas[i], faceCapture ) == vaDrawResultFlags::None )
-                        probesOK++;
+                    if( timeSliced )
+                    {
+                        vaIBLProbe::IncrementalCaptureSettings captureSettings;
+                        // limited by steps rather than by the (CPU only) time budget: a face render or a pre-filter MIP is cheap to
+                        // record but not cheap on the GPU
+                        captureSettings.MaxStepsPerFrame = m_settings.IBLCaptureStepsPerFrame;
+                        bool completed = false;
+                        probes[i]->CaptureIncremental( mainContext, probeDatas[i], faceCapture, captureSettings, completed );
+                        if( completed )
+                            probesOK++;
+                        selectionOpaque.Reset( );
+                        selectionTransparent.Reset( );
+                    }
+                    else
+                    {
+                        if( probes[i]->Capture( mainContext, probeDatas[i], faceCapture ) == vaDrawResultFlags::None )
+                            probesOK++;
+                        selectionOpaque.Reset( );
+                        selectionTransparent.Reset( );
+                    }
                     break;
                 }
             }
@@ -1426,6 +1470,11 @@ void VanillaSample::UIPanelTick( vaApplicationBase & application )
         }
     }
 
+    ImGui::Checkbox( "Time-sliced IBL capture", &m_settings.IBLTimeSlicedCapture );
+    if( ImGui::IsItemHovered( ) ) ImGui::SetTooltip( "Spread IBL probe capture (face rendering, pre-filtering) across frames instead of doing it all in one frame" );
+    if( m_settings.IBLTimeSlicedCapture )
+        ImGui::InputInt( "IBL capture steps per frame", &m_settings.IBLCaptureStepsPerFrame );
+
     // ImGuiEx_Combo( "SuperSampling", (int&)m_settings.SuperSamplingOption, { "Disabled", "2x", "4x" } );
     ImGui::Separator();
 
@@ -1497,6 +1546,16 @@ void VanillaSample::ScriptedTests( vaApplicationBase & application )
 
     ImGui::Separator( );
 
+    {
+        bool inlineScripts = m_miniScript.GetExecutionMode( ) == vaMiniScript::ExecutionMode::Inline;
+        if( ImGui::Checkbox( "Run scripts inline (fiber)", &inlineScripts ) )
+            m_miniScript.SetExecutionMode( (inlineScripts)?(vaMiniScript::ExecutionMode::Inline):(vaMiniScript::ExecutionMode::Threaded) );
+        if( ImGui::IsItemHovered( ) )
+            ImGui::SetTooltip( "Inline runs the test scripts on a fiber on the main thread; uncheck to use the old script-thread\nhand-over (two OS context switches per frame) and compare frame time variance." );
+    }
+
+    ImGui::Separator( );
+
     if( ImGui::Button("Run quality analysis") )
     {
         m_miniScript.Start( [ thisPtr = this] (vaMiniScriptInterface & msi)
@@ -2157,6 +2216,264 @@ void VanillaSample::ScriptedTests( vaApplicationBase & application )
             autobench.ReportAddText( "\r\n" );
         } );
     }
+
+    ImGui::InputFloat( "AutoVRSTunerMinPSNR", &m_settings.AutoVRSTunerMinPSNR, 0.5f, 1.0f, "%.1f" );
+    m_settings.AutoVRSTunerMinPSNR = vaMath::Clamp( m_settings.AutoVRSTunerMinPSNR, 20.0f, 80.0f );
+
+    // Unlike "Optimize material VRSRateOffsets" above this also takes the performance into account: each material is rendered
+    // in isolation with each of the VRSMaterialTuner options at each location (references get captured once per location), GPU
+    // time saved and image MSE get collected (comparisons run in the background while rendering goes on) and then the
+    // offsets are solved for maximum time saved within the AutoVRSTunerMinPSNR quality budget. Each option's GPU time is
+    // measured on its own (one configuration per timing window) between two re-measured full rate baselines.
+    if( ImGui::Button( "Auto-tune material VRS offsets (quality vs. time)" ) )
+    {
+        m_miniScript.Start( [ thisPtr = this, setVRSAndLoopUntilStable, minPSNR = m_settings.AutoVRSTunerMinPSNR ]( vaMiniScriptInterface& msi )
+        {
+            // this sets up some globals and also backups all the sample settings
+            AutoBenchTool autobench( *thisPtr, msi, true, true );
+
+            // no need to enable DoF for this analysis
+            thisPtr->Settings( ).EnableDOF = false;
+
+            // animation stuff
+            const float c_framePerSecond = 30;
+            const float c_frameDeltaTime = 1.0f / (float)c_framePerSecond;
+            const int   c_totalFrameCount = (int)( thisPtr->GetFlythroughCameraController( )->GetTotalTime( ) / c_frameDeltaTime );
+            const int   c_totalFramesToTest = 32;
+            const int   c_timingFrames = 8;
+            vector<float> timePointsToTest;
+            for( int i = 0; i < c_totalFramesToTest; i++ )
+                timePointsToTest.push_back( c_frameDeltaTime * ( (float)c_totalFrameCount * ( (float)i + 0.5f ) / (float)c_totalFramesToTest ) );
+            thisPtr->SetFlythroughCameraEnabled( true );
+            thisPtr->GetFlythroughCameraController( )->SetPlaySpeed( 0.0f );
+
+            // get a list of all materials to play with
+            vector<shared_ptr<vaAsset>> materialAssets = thisPtr->m_renderDevice.GetAssetPackManager( ).FindAssets( [ ]( vaAsset& asset ) { return asset.Type == vaAssetType::RenderMaterial; } );
+            vector<shared_ptr<vaRenderMaterial>> materials;
+            vector<vaRenderMaterial::MaterialSettings> originalSettings;
+            for( const shared_ptr<vaAsset> & asset : materialAssets )
+            {
+                shared_ptr<vaRenderMaterial> material = asset->GetResource<vaRenderMaterial>( );
+                if( material == nullptr )
+                {
+                    assert( false );
+                    continue;
+                }
+                materials.push_back( material );
+                originalSettings.push_back( material->GetMaterialSettings( ) );
+            }
+
+            // all tuning is done at the 2x2 base rate with one material at a time using VRS and all others at full rate
+            const VariableRateShadingType testShadingRate = VanillaSample::VariableRateShadingType::Tier1_Static_2x2;
+            auto setMaterial = [ &materials, &originalSettings ]( int index, const VRSMaterialTuner::Option * option )
+            {
+                auto settings = originalSettings[index];
+                settings.VRSRateOffset          = ( option != nullptr ) ? ( option->VRSRateOffset ) : ( VRSMaterialTuner::c_baselineVRSRateOffset );
+                settings.VRSPreferHorizontal    = ( option != nullptr ) ? ( option->VRSPreferHorizontal ) : ( settings.VRSPreferHorizontal );
+                materials[index]->SetMaterialSettings( settings );
+            };
+
+            // restores materials if stopped before the end
+            bool finished = false;
+            struct ScopeExit { std::function<void( )> Func; ~ScopeExit( ) { Func( ); } } scopeExit { [ & ]( ) 
+            { 
+                thisPtr->m_collectVisibleMaterials = false;
+                if( !finished )
+                    for( int i = 0; i < (int)materials.size( ); i++ )
+                        materials[i]->SetMaterialSettings( originalSettings[i] );
+            } };
+
+            for( int i = 0; i < (int)materials.size( ); i++ )
+                setMaterial( i, nullptr );
+            thisPtr->m_collectVisibleMaterials = true;
+
+            // shared with the readback callbacks which can outlive the script if it gets stopped
+            shared_ptr<VRSMaterialTuner> tuner = std::make_shared<VRSMaterialTuner>( (int)materials.size( ), (int)timePointsToTest.size( ) );
+            shared_ptr<std::atomic_int> capturesInFlight = std::make_shared<std::atomic_int>( 0 );
+            const vector<VRSMaterialTuner::Option> & options = tuner->GetOptions( );
+
+            auto tracerView = std::make_shared<vaTracerView>( );
+            // GPU time of the VRS affected passes, in ms per frame
+            auto measureGPUTime = [ &msi, &autobench, &tracerView, c_timingFrames ]( double & outTimeMs ) -> bool
+            {
+                tracerView->ConnectToThreadContext( string( vaGPUContextTracer::c_threadNamePrefix ) + "*", VA_FLOAT_HIGHEST );
+                for( int i = 0; i < c_timingFrames; i++ )
+                {
+                    if( !msi.YieldExecution( ) || autobench.GetShouldStop( ) )
+                    {
+                        tracerView->Disconnect( );
+                        return false;
+                    }
+                }
+                tracerView->Disconnect( );
+                double total = 0.0;
+                for( const char * name : { "Forward", "Transparencies" } )
+                {
+                    const vaTracerView::Node * node = tracerView->FindNodeRecursive( name );
+                    if( node != nullptr )
+                        total += node->TimeTotal;
+                }
+                outTimeMs = total * 1000.0 / (double)c_timingFrames;
+                return true;
+            };
+            // readback slots are limited; wait for one to free up if needed
+            auto captureImage = [ thisPtr, &msi, &autobench, capturesInFlight ]( const std::function<void( vaImageMetrics::Image && image )> & callback ) -> bool
+            {
+                (*capturesInFlight)++;
+                auto wrappedCallback = [ callback, capturesInFlight ]( vaImageMetrics::Image && image ) { callback( std::move( image ) ); (*capturesInFlight)--; };
+                while( !thisPtr->ImageCompareTool( )->CaptureCPUImage( *thisPtr->GetRenderDevice( ).GetMainContext( ), thisPtr->CurrentFrameTexture( ), wrappedCallback ) )
+                {
+                    if( !msi.YieldExecutionFor( 1 ) || autobench.GetShouldStop( ) )
+                    {
+                        (*capturesInFlight)--;
+                        return false;
+                    }
+                }
+                return true;
+            };
+
+            autobench.ReportAddText( vaStringTools::Format( "\r\nAuto-tuning VRS options for %d materials at %d locations for %s, quality budget %.1fdB PSNR\r\n",
+                (int)materials.size( ), (int)timePointsToTest.size( ), thisPtr->GetVRSOptionName( testShadingRate ), minPSNR ) );
+
+            double timingNoiseSum = 0.0;
+            for( int testFrame = 0; testFrame < (int)timePointsToTest.size( ); testFrame++ )
+            {
+                thisPtr->GetFlythroughCameraController( )->SetPlayTime( timePointsToTest[testFrame] );
+
+                // timing baseline (everything at full rate) gets re-measured between option measurements, so that every option
+                // is bracketed by two baselines and GPU clock / thermal drift over the long run of switches cancels out; the
+                // spread of the repeated baselines is the noise threshold for the savings at this location
+                struct OptionTiming
+                {
+                    int                 Material;
+                    int                 Option;
+                    double              Time;
+                    int                 BaselineBefore;     // index into baselineTimes; BaselineBefore+1 is the one after
+                };
+                vector<double>          baselineTimes;
+                vector<OptionTiming>    optionTimings;
+                bool lastMeasuredBaseline = false;
+                auto measureBaseline = [ & ]( ) -> bool
+                {
+                    double time;
+                    if( !setVRSAndLoopUntilStable( testShadingRate, thisPtr, msi, autobench ) || !measureGPUTime( time ) )
+                        return false;
+                    baselineTimes.push_back( time );
+                    lastMeasuredBaseline = true;
+                    return true;
+                };
+
+                // reference (everything at full rate) - both the image and the first timing baseline
+                if( !measureBaseline( ) )
+                    return;
+                vector<shared_ptr<vaRenderMaterial>> visibleMaterials = thisPtr->m_lastFrameVisibleMaterials;
+                shared_ptr<vaImageMetrics::Image> reference = std::make_shared<vaImageMetrics::Image>( );
+                if( !captureImage( [ reference ]( vaImageMetrics::Image && image ) { *reference = std::move( image ); } ) )
+                    return;
+                while( !reference->IsValid( ) )
+                {
+                    if( *capturesInFlight == 0 )
+                    {
+                        VA_ERROR( "Unable to capture reference image - is the backbuffer format supported by vaImageMetrics?" );
+                        return;
+                    }
+                    if( !msi.YieldExecutionFor( 1 ) || autobench.GetShouldStop( ) )
+                        return;
+                }
+
+                for( int m = 0; m < (int)materials.size( ); m++ )
+                {
+                    if( std::find( visibleMaterials.begin( ), visibleMaterials.end( ), materials[m] ) == visibleMaterials.end( ) )
+                        continue;
+                    tuner->AddVisibleLocation( m );
+
+                    for( int o = 0; o < (int)options.size( ); o++ )
+                    {
+                        autobench.SetUIStatusInfo( vaStringTools::Format( "location %d of %d, material %d of %d, option %s", testFrame + 1, (int)timePointsToTest.size( ), m + 1, (int)materials.size( ), options[o].Name ) );
+
+                        if( !lastMeasuredBaseline && !measureBaseline( ) )
+                            return;
+
+                        setMaterial( m, &options[o] );
+                        if( !setVRSAndLoopUntilStable( testShadingRate, thisPtr, msi, autobench ) )
+                            return;
+                        double time;
+                        if( !measureGPUTime( time ) )
+                            return;
+                        optionTimings.push_back( { m, o, time, (int)baselineTimes.size( ) - 1 } );
+                        lastMeasuredBaseline = false;
+
+                        vaImageMetrics::Image referenceImage = *reference;
+                        if( !captureImage( [ tuner, m, o, referenceImage ]( vaImageMetrics::Image && image ) { tuner->QueueComparison( m, o, referenceImage, image ); } ) )
+                            return;
+                        setMaterial( m, nullptr );
+
+                        // don't let the comparisons fall too far behind (memory)
+                        while( tuner->GetImagesInFlight( ) > tuner->GetBatchSize( ) * 3 )
+                            if( !msi.YieldExecutionFor( 1 ) || autobench.GetShouldStop( ) )
+                                return;
+                    }
+                }
+
+                // closing baseline for the last option, then the savings against the average of the two surrounding baselines;
+                // anything within 2 standard deviations of the repeated baselines is treated as no change
+                if( !lastMeasuredBaseline && !measureBaseline( ) )
+                    return;
+                double baselineMean = 0.0, baselineVariance = 0.0;
+                for( double time : baselineTimes )
+                    baselineMean += time / (double)baselineTimes.size( );
+                for( double time : baselineTimes )
+                    baselineVariance += ( time - baselineMean ) * ( time - baselineMean ) / (double)baselineTimes.size( );
+                const double noiseThreshold = 2.0 * std::sqrt( baselineVariance );
+                timingNoiseSum += noiseThreshold;
+                for( const OptionTiming & timing : optionTimings )
+                {
+                    double timeSaved = 0.5 * ( baselineTimes[timing.BaselineBefore] + baselineTimes[timing.BaselineBefore + 1] ) - timing.Time;
+                    tuner->AddTimeSaved( timing.Material, timing.Option, ( std::abs( timeSaved ) > noiseThreshold ) ? ( timeSaved ) : ( 0.0 ) );
+                }
+            }
+
+            // wait for the remaining readbacks and comparisons
+            autobench.SetUIStatusInfo( "finishing comparisons" );
+            while( *capturesInFlight > 0 )
+                if( !msi.YieldExecutionFor( 1 ) || autobench.GetShouldStop( ) )
+                    return;
+            tuner->FlushComparisons( );
+            while( tuner->GetImagesInFlight( ) > 0 )
+                if( !msi.YieldExecutionFor( 1 ) || autobench.GetShouldStop( ) )
+                    return;
+            if( tuner->GetFailedComparisons( ) > 0 )
+                VA_WARN( "VRS material tuner: %d image comparisons failed", tuner->GetFailedComparisons( ) );
+
+            double mseBudget = ::pow( 10.0, -(double)minPSNR / 10.0 );
+            double totalTimeSaved = tuner->Solve( mseBudget );
+
+            autobench.ReportAddRowValues( { "Material name", "VRS option", "VRSRateOffset", "Avg MSE added", "Avg time saved (ms)", "Visible at locations" } );
+            double totalMSE = 0.0;
+            for( int m = 0; m < (int)materials.size( ); m++ )
+            {
+                const VRSMaterialTuner::MaterialResults & results = tuner->GetResults( m );
+                int o = results.ChosenOption;
+                // materials that weren't visible anywhere keep their settings
+                if( results.VisibleLocations == 0 )
+                    materials[m]->SetMaterialSettings( originalSettings[m] );
+                else
+                    setMaterial( m, ( o >= 0 ) ? ( &options[o] ) : ( nullptr ) );
+                totalMSE += ( o >= 0 ) ? ( tuner->GetAverageMSE( m, o ) ) : ( 0.0 );
+
+                autobench.ReportAddRowValues( { materials[m]->GetParentAsset( )->Name( ), ( o >= 0 ) ? ( options[o].Name ) : ( "1x1" ), std::to_string( materials[m]->GetMaterialSettings( ).VRSRateOffset ),
+                    vaStringTools::Format( "%.8f", ( o >= 0 ) ? ( tuner->GetAverageMSE( m, o ) ) : ( 0.0 ) ), vaStringTools::Format( "%.3f", ( o >= 0 ) ? ( tuner->GetAverageTimeSaved( m, o ) ) : ( 0.0 ) ),
+                    std::to_string( results.VisibleLocations ) } );
+            }
+            finished = true;
+
+            autobench.ReportAddText( vaStringTools::Format( "\r\nExpected: %.3fms saved per frame (Forward + Transparencies, avg over locations), %.2fdB PSNR (assuming per-material errors add up)\r\n",
+                totalTimeSaved, ( totalMSE > 0 ) ? ( vaMath::PSNR( totalMSE, 1.0 ) ) : ( std::numeric_limits<double>::infinity( ) ) ) );
+            autobench.ReportAddText( vaStringTools::Format( "Timing noise threshold: %.3fms (2 std. deviations of the repeated baselines, avg over locations); smaller savings were ignored\r\n",
+                timingNoiseSum / (double)timePointsToTest.size( ) ) );
+            autobench.ReportAddText( "Material settings were updated in memory - save the asset pack(s) to keep them.\r\n" );
+        } );
+    }
     ImGui::Separator( );
 }
 
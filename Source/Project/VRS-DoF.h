@@ -108,6 +108,10 @@ namespace Vanilla
             bool                                    EnableGradientFilterExtension   = false;
 
             float                                   AutoVRSRateOffsetThreshold      = 0.2f;
+            float                                   AutoVRSTunerMinPSNR             = 45.0f;    // quality budget for the automatic material VRS tuner (average over all test locations)
+
+            bool                                    IBLTimeSlicedCapture            = true;     // spread IBL probe capture across frames to avoid a hitch (see vaIBLProbe::CaptureIncremental)
+            int                                     IBLCaptureStepsPerFrame         = 1;        // each step is at most one face render or pre-filter MIP (see vaIBLProbe::IncrementalCaptureSettings)
 
             void Serialize( vaXMLSerializer & serializer )
             {
@@ -126,10 +130,13 @@ namespace Vanilla
                 serializer.Serialize( "DoFRange"                        , DoFRange                          );
                 serializer.Serialize( "EnableGradientFilterExtension"   , EnableGradientFilterExtension     );
                 serializer.Serialize( "AutoVRSRateOffsetThreshold"      , AutoVRSRateOffsetThreshold        );
+                serializer.Serialize( "AutoVRSTunerMinPSNR"             , AutoVRSTunerMinPSNR               );
+                serializer.Serialize( "IBLTimeSlicedCapture"            , IBLTimeSlicedCapture              );
+                serializer.Serialize( "IBLCaptureStepsPerFrame"         , IBLCaptureStepsPerFrame           );
 
                 // this here is just to remind you to update serialization when changing the struct
                 size_t dbgSizeOfThis = sizeof(*this); dbgSizeOfThis;
-                assert( dbgSizeOfThis == 52 );
+                assert( dbgSizeOfThis == 64 );
             }
 
             void Validate( )
@@ -141,6 +148,7 @@ namespace Vanilla
                 DoFDrivenVRSMaxRate             = vaMath::Clamp( DoFDrivenVRSMaxRate, 0, 4 );
                 DoFFocalLength                  = vaMath::Clamp( DoFFocalLength,    0.0f, 100.0f );
                 DoFRange                        = vaMath::Clamp( DoFRange,          0.0f, 1.0f );
+                IBLCaptureStepsPerFrame         = vaMath::Clamp( IBLCaptureStepsPerFrame, 1, 64 );
             }
         };
 
@@ -196,6 +204,8 @@ namespace Vanilla
         bool                                    m_shadowsStable = false;
 
         bool                                    m_IBLsStable = false;
+        vaRenderSelection                       m_IBLCaptureSelectionOpaque;        // scratch for IBL capture, re-selected every capture step
+        vaRenderSelection                       m_IBLCaptureSelectionTransparent;
 
         shared_ptr<vaCMAA2>                     m_CMAA2;
 
@@ -224,6 +234,10 @@ namespace Vanilla
         vaMiniScript                            m_miniScript;
         shared_ptr<vaTexture>                   m_currentFrameTexture;  // for scripting
 
+        // for scripting: if enabled, materials of all (frustum culled) selected meshes get collected each frame
+        bool                                    m_collectVisibleMaterials       = false;
+        vector<shared_ptr<vaRenderMaterial>>    m_lastFrameVisibleMaterials;
+
     protected:
         VanillaSampleSettings                   m_settings;
         VanillaSampleSettings                   m_lastSettings;
@@ -0,0 +1,185 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated 
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation 
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of 
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "VRS-MaterialTuner.h"
+
+#include <algorithm>
+
+using namespace Vanilla;
+
+VRSMaterialTuner::VRSMaterialTuner( int materialCount, int locationCount ) 
+    : m_options( GetDefaultOptions( ) ), m_locationCount( locationCount ), m_batchSize( vaMath::Max( 4, vaParallel::GetWorkerCount( ) + 1 ) )
+{
+    m_results.resize( materialCount );
+    for( MaterialResults & results : m_results )
+    {
+        results.MSESum.resize( m_options.size( ), 0.0 );
+        results.TimeSavedSum.resize( m_options.size( ), 0.0 );
+    }
+}
+
+VRSMaterialTuner::~VRSMaterialTuner( )
+{
+    // background batches reference this object
+    m_imagesInFlight -= (int)m_currentBatch.size( );
+    m_currentBatch.clear( );
+    while( m_imagesInFlight.load( ) > 0 )
+        vaThreading::Sleep( 1 );
+}
+
+const vector<VRSMaterialTuner::Option> & VRSMaterialTuner::GetDefaultOptions( )
+{
+    // the baseline (1x1) isn't in the list - it's what everything gets compared against
+    static const vector<Option> options = 
+    {
+        { -1, true,  "2x1" },
+        { -1, false, "1x2" },
+        {  0, true,  "2x2" },
+    };
+    return options;
+}
+
+void VRSMaterialTuner::AddVisibleLocation( int material )
+{
+    std::lock_guard<mutex> lock( m_resultsMutex );
+    m_results[material].VisibleLocations++;
+}
+
+void VRSMaterialTuner::AddTimeSaved( int material, int option, double timeSavedMs )
+{
+    std::lock_guard<mutex> lock( m_resultsMutex );
+    m_results[material].TimeSavedSum[option] += timeSavedMs;
+}
+
+void VRSMaterialTuner::QueueComparison( int material, int option, const vaImageMetrics::Image & reference, const vaImageMetrics::Image & test )
+{
+    m_currentBatch.push_back( { material, option, reference, test } );
+    m_imagesInFlight++;
+    if( (int)m_currentBatch.size( ) >= m_batchSize )
+        FlushComparisons( );
+}
+
+void VRSMaterialTuner::FlushComparisons( )
+{
+    if( m_currentBatch.size( ) == 0 )
+        return;
+
+    shared_ptr<vector<PendingComparison>> batch = std::make_shared<vector<PendingComparison>>( std::move( m_currentBatch ) );
+    m_currentBatch.clear( );
+
+    vaBackgroundTaskManager::GetInstance( ).Spawn( "VRS material tuner comparisons", vaBackgroundTaskManager::SpawnFlags::None, [ this, batch ]( vaBackgroundTaskManager::TaskContext & )
+    {
+        vector<pair<vaImageMetrics::Image, vaImageMetrics::Image>> pairs;
+        pairs.reserve( batch->size( ) );
+        for( const PendingComparison & item : *batch )
+            pairs.push_back( { item.Reference, item.Test } );
+
+        // MSE is all that's needed for the solver
+        vaImageMetrics::Settings settings;
+        settings.SSIM   = false;
+        settings.MSSSIM = false;
+        vector<vaImageMetrics::Results> results;
+        vaImageMetrics::CompareBatch( pairs, settings, results );
+
+        {
+            std::lock_guard<mutex> lock( m_resultsMutex );
+            for( size_t i = 0; i < batch->size( ); i++ )
+            {
+                if( results[i].Valid )
+                    m_results[( *batch )[i].Material].MSESum[( *batch )[i].Option] += results[i].MSE;
+                else
+                    m_failedComparisons++;
+            }
+        }
+        m_imagesInFlight -= (int)batch->size( );
+        return true;
+    } );
+}
+
+double VRSMaterialTuner::GetAverageMSE( int material, int option ) const
+{
+    std::lock_guard<mutex> lock( m_resultsMutex );
+    return m_results[material].MSESum[option] / (double)vaMath::Max( 1, m_locationCount );
+}
+
+double VRSMaterialTuner::GetAverageTimeSaved( int material, int option ) const
+{
+    std::lock_guard<mutex> lock( m_resultsMutex );
+    return m_results[material].TimeSavedSum[option] / (double)vaMath::Max( 1, m_locationCount );
+}
+
+double VRSMaterialTuner::Solve( double mseBudget, int budgetSteps )
+{
+    assert( m_imagesInFlight.load( ) == 0 );
+    assert( mseBudget > 0 && budgetSteps > 0 );
+
+    const int materialCount = (int)m_results.size( );
+    const int optionCount   = (int)m_options.size( );
+
+    // integer costs (rounded up so that the budget is never exceeded) and values; options that don't save any time
+    // (noise) are never worth picking
+    vector<int>     costs( (size_t)materialCount * optionCount );
+    vector<double>  values( (size_t)materialCount * optionCount );
+    for( int m = 0; m < materialCount; m++ )
+        for( int o = 0; o < optionCount; o++ )
+        {
+            double mse      = GetAverageMSE( m, o );
+            double saved    = GetAverageTimeSaved( m, o );
+            costs[m * optionCount + o]  = (int)std::min( (double)budgetSteps + 1, ::ceil( mse / mseBudget * budgetSteps ) );
+            values[m * optionCount + o] = ( saved > 0.0 ) ? ( saved ) : ( -1.0 );
+        }
+
+    // best[b] - best total value with total cost <= b for materials processed so far; choices kept per material for backtracking
+    vector<double>  best( budgetSteps + 1, 0.0 );
+    vector<double>  next( budgetSteps + 1 );
+    vector<int8>    choice( (size_t)materialCount * ( budgetSteps + 1 ), -1 );
+    for( int m = 0; m < materialCount; m++ )
+    {
+        int8 * materialChoice = &choice[(size_t)m * ( budgetSteps + 1 )];
+        for( int b = 0; b <= budgetSteps; b++ )
+        {
+            next[b] = best[b];  // baseline: costs nothing, saves nothing
+            for( int o = 0; o < optionCount; o++ )
+            {
+                int cost = costs[m * optionCount + o];
+                double value = values[m * optionCount + o];
+                if( value <= 0.0 || cost > b )
+                    continue;
+                if( best[b - cost] + value > next[b] )
+                {
+                    next[b] = best[b - cost] + value;
+                    materialChoice[b] = (int8)o;
+                }
+            }
+        }
+        std::swap( best, next );
+    }
+
+    // backtrack
+    int b = budgetSteps;
+    for( int m = materialCount - 1; m >= 0; m-- )
+    {
+        int o = choice[(size_t)m * ( budgetSteps + 1 ) + b];
+        m_results[m].ChosenOption = o;
+        if( o >= 0 )
+            b -= costs[m * optionCount + o];
+        assert( b >= 0 );
+    }
+    return best[budgetSteps];
+}
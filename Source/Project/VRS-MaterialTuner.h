@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated 
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation 
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of 
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Core/vaCoreIncludes.h"
+
+#include "Core/Misc/vaImageMetrics.h"
+
+namespace Vanilla
+{
+    // Data collection and solver for the automatic per-material VRS tuning script (see "Auto-tune material VRS offsets" in
+    // VanillaSample::ScriptedTests).
+    //
+    // The script renders each material in isolation (all other materials at full rate) with each candidate option at
+    // a number of scene locations, and feeds the results in here: the GPU time saved and the captured image, which is
+    // compared against the location's reference on background threads in batches. Since materials mostly cover different
+    // pixels, per-material MSE and time savings are treated as additive; Solve then picks one option per material
+    // maximizing the total time saved while keeping the summed MSE within the budget (multiple-choice knapsack, DP over a
+    // discretized budget).
+    class VRSMaterialTuner
+    {
+    public:
+        // a candidate material setting; all tuning is done with the 2x2 base rate (VariableRateShadingType::Tier1_Static_2x2)
+        // so that the VRSRateOffset values match the range used elsewhere ([-2, 0])
+        struct Option
+        {
+            int                                 VRSRateOffset;
+            bool                                VRSPreferHorizontal;
+            const char *                        Name;
+        };
+
+        struct MaterialResults
+        {
+            vector<double>                      MSESum;             // per option, sum over locations (0 where the material wasn't visible)
+            vector<double>                      TimeSavedSum;       // per option, sum over locations in milliseconds
+            int                                 VisibleLocations    = 0;
+            int                                 ChosenOption        = -1;   // -1 is the full rate baseline
+        };
+
+    private:
+        struct PendingComparison
+        {
+            int                                 Material;
+            int                                 Option;
+            vaImageMetrics::Image               Reference;
+            vaImageMetrics::Image               Test;
+        };
+
+        const vector<Option>                    m_options;
+        const int                               m_locationCount;
+        const int                               m_batchSize;
+
+        vector<MaterialResults>                 m_results;
+        mutable mutex                           m_resultsMutex;
+
+        vector<PendingComparison>               m_currentBatch;
+        std::atomic_int                         m_imagesInFlight    = 0;    // queued + being compared
+        std::atomic_int                         m_failedComparisons = 0;
+
+    public:
+        VRSMaterialTuner( int materialCount, int locationCount );
+        ~VRSMaterialTuner( );
+
+        static const vector<Option> &           GetDefaultOptions( );
+        static const int                        c_baselineVRSRateOffset = -2;           // 1x1 at 2x2 base rate
+
+        const vector<Option> &                  GetOptions( ) const                     { return m_options; }
+
+        // render thread: material became visible at a location (only visible materials get measured)
+        void                                    AddVisibleLocation( int material );
+        void                                    AddTimeSaved( int material, int option, double timeSavedMs );
+
+        // render thread: queue up the comparison of a captured image against the location's reference; comparisons run
+        // in batches of roughly one image per hardware thread on background tasks
+        void                                    QueueComparison( int material, int option, const vaImageMetrics::Image & reference, const vaImageMetrics::Image & test );
+        void                                    FlushComparisons( );
+        int                                     GetImagesInFlight( ) const              { return m_imagesInFlight.load( ); }
+        int                                     GetBatchSize( ) const                   { return m_batchSize; }
+        int                                     GetFailedComparisons( ) const           { return m_failedComparisons.load( ); }
+
+        // after all comparisons are done: pick options; mseBudget is the allowed average MSE (over all locations) added by VRS,
+        // for ex. vaMath::PSNR based: pow( 10, -minPSNR / 10 ); returns the total expected time saved (average per location, ms)
+        double                                  Solve( double mseBudget, int budgetSteps = 4096 );
+
+        // per-location averages
+        double                                  GetAverageMSE( int material, int option ) const;
+        double                                  GetAverageTimeSaved( int material, int option ) const;
+        const MaterialResults &                 GetResults( int material ) const        { return m_results[material]; }
+    };
+}
@@ -2652,40 +2652,70 @@ void vaGraphicsPSODescDX12::FillGraphicsPipelineStateDesc( D3D12_GRAPHICS_PIPELI
 
 }
 
-void vaGraphicsPSODescDX12::FillKey( vaMemoryStream & outStream ) const
+void vaGraphicsPSODescDX12::UpdateHash( )
 {
     size_t dbgSizeOfThis = sizeof(*this); dbgSizeOfThis;
-    assert( dbgSizeOfThis == 168 ); // size of the structure changed, did you change the key creation too?
-    
-    assert( outStream.GetPosition() == 0 );
-
-    // add space for the 64bit hash 
-    outStream.WriteValue<uint64>( 0ui64 );
-
-    outStream.WriteValue<int64>( VSUniqueContentsID );
-    outStream.WriteValue<int64>( PSUniqueContentsID );
-    outStream.WriteValue<int64>( DSUniqueContentsID );
-    outStream.WriteValue<int64>( HSUniqueContentsID );
-    outStream.WriteValue<int64>( GSUniqueContentsID );
-
-    outStream.WriteValue<int32>( static_cast<int32>(this->BlendMode) );
-    outStream.WriteValue<int32>( static_cast<int32>(this->FillMode) );
-    outStream.WriteValue<int32>( static_cast<int32>(this->CullMode) );
-    outStream.WriteValue<bool>( this->FrontCounterClockwise );
-    outStream.WriteValue<bool>( this->MultisampleEnable );
-    // outStream.WriteValue<bool>( this->ScissorEnable );
-    outStream.WriteValue<bool>( this->DepthEnable );
-    outStream.WriteValue<bool>( this->DepthWriteEnable );
-    outStream.WriteValue<int32>( static_cast<int32>(this->DepthFunc) );
-    outStream.WriteValue<int32>( static_cast<int32>(this->Topology) );
-    outStream.WriteValue<int32>( this->NumRenderTargets );
-    
-    for( int i = 0; i < _countof(this->RTVFormats); i++ )
-        outStream.WriteValue<int32>( static_cast<int32>(this->RTVFormats[i]) );
-    outStream.WriteValue<int32>( static_cast<int32>(this->DSVFormat) );
-    outStream.WriteValue<uint32>( this->SampleDescCount );
-
-    *reinterpret_cast<uint64*>(outStream.GetBuffer()) = vaXXHash64::Compute( outStream.GetBuffer() + sizeof(uint64), outStream.GetPosition() - sizeof(uint64), 0 );
+    assert( dbgSizeOfThis == 176 ); // size of the structure changed, did you change UpdateHash and KeyEquals too?
+
+    // everything that goes into the key, tightly packed and zero initialized so that padding doesn't affect the hash
+    struct KeyData
+    {
+        int64   UniqueContentsIDs[5];
+        int32   BlendMode;
+        int32   FillMode;
+        int32   CullMode;
+        int32   DepthFunc;
+        int32   Topology;
+        int32   NumRenderTargets;
+        int32   RTVFormats[_countof(vaGraphicsPSODescDX12::RTVFormats)];
+        int32   DSVFormat;
+        uint32  SampleDescCount;
+        uint8   FrontCounterClockwise;
+        uint8   MultisampleEnable;
+        uint8   DepthEnable;
+        uint8   DepthWriteEnable;
+    } key;
+    memset( &key, 0, sizeof(key) );
+
+    key.UniqueContentsIDs[0]    = VSUniqueContentsID;
+    key.UniqueContentsIDs[1]    = PSUniqueContentsID;
+    key.UniqueContentsIDs[2]    = DSUniqueContentsID;
+    key.UniqueContentsIDs[3]    = HSUniqueContentsID;
+    key.UniqueContentsIDs[4]    = GSUniqueContentsID;
+    key.BlendMode               = static_cast<int32>(BlendMode);
+    key.FillMode                = static_cast<int32>(FillMode);
+    key.CullMode                = static_cast<int32>(CullMode);
+    key.DepthFunc               = static_cast<int32>(DepthFunc);
+    key.Topology                = static_cast<int32>(Topology);
+    key.NumRenderTargets        = NumRenderTargets;
+    for( int i = 0; i < _countof(RTVFormats); i++ )
+        key.RTVFormats[i]       = static_cast<int32>(RTVFormats[i]);
+    key.DSVFormat               = static_cast<int32>(DSVFormat);
+    key.SampleDescCount         = SampleDescCount;
+    key.FrontCounterClockwise   = FrontCounterClockwise;
+    key.MultisampleEnable       = MultisampleEnable;
+    key.DepthEnable             = DepthEnable;
+    key.DepthWriteEnable        = DepthWriteEnable;
+
+    Hash = vaXXHash64::Compute( &key, sizeof(key), 0 );
+    if( Hash == 0 ) // 0 means 'not computed'
+        Hash = 1;
+}
+
+bool vaGraphicsPSODescDX12::KeyEquals( const vaGraphicsPSODescDX12 & other ) const
+{
+    if( Hash != other.Hash 
+        || VSUniqueContentsID != other.VSUniqueContentsID || PSUniqueContentsID != other.PSUniqueContentsID || DSUniqueContentsID != other.DSUniqueContentsID 
+        || HSUniqueContentsID != other.HSUniqueContentsID || GSUniqueContentsID != other.GSUniqueContentsID 
+        || BlendMode != other.BlendMode || FillMode != other.FillMode || CullMode != other.CullMode || FrontCounterClockwise != other.FrontCounterClockwise 
+        || MultisampleEnable != other.MultisampleEnable || DepthEnable != other.DepthEnable || DepthWriteEnable != other.DepthWriteEnable 
+        || DepthFunc != other.DepthFunc || Topology != other.Topology || NumRenderTargets != other.NumRenderTargets 
+        || DSVFormat != other.DSVFormat || SampleDescCount != other.SampleDescCount )
+        return false;
+    for( int i = 0; i < _countof(RTVFormats); i++ )
+        if( RTVFormats[i] != other.RTVFormats[i] )
+            return false;
+    return true;
 }
 
 void vaComputePSODescDX12::FillComputePipelineStateDesc( D3D12_COMPUTE_PIPELINE_STATE_DESC & outDesc, ID3D12RootSignature * pRootSignature ) const
@@ -2698,14 +2728,14 @@ void vaComputePSODescDX12::FillComputePipelineStateDesc( D3D12_COMPUTE_PIPELINE_
     outDesc.Flags             = D3D12_PIPELINE_STATE_FLAG_NONE; // for warp devices automatically use D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG?
 }
 
-void vaComputePSODescDX12::FillKey( vaMemoryStream & outStream ) const
+void vaComputePSODescDX12::UpdateHash( )
 {
     size_t dbgSizeOfThis = sizeof(*this); dbgSizeOfThis;
-    assert( dbgSizeOfThis == 16 ); // size of the structure changed, did you change the key creation too?
-    
-    assert( outStream.GetPosition() == 0 );
+    assert( dbgSizeOfThis == 24 ); // size of the structure changed, did you change UpdateHash and KeyEquals too?
 
-    outStream.WriteValue<int64>( CSUniqueContentsID );
+    Hash = vaXXHash64::Compute( &CSUniqueContentsID, sizeof(CSUniqueContentsID), 0 );
+    if( Hash == 0 ) // 0 means 'not computed'
+        Hash = 1;
 }
 
 HRESULT vaGraphicsPSODX12::CreatePSO( vaRenderDeviceDX12 & device, ID3D12RootSignature * rootSignature )
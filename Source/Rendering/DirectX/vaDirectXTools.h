@@ -793,6 +793,8 @@ namespace Vanilla
         virtual const vaConstantBufferViewDX12 *    GetCBV( )   const                                                                       = 0;
         virtual const vaUnorderedAccessViewDX12 *   GetUAV( )   const                                                                       = 0;
         virtual const vaShaderResourceViewDX12 *    GetSRV( )   const                                                                       = 0;
+        // for constant buffers whose current contents live in transient (per-frame) upload memory, with no persistent CBV
+        virtual bool                                GetTransientCBVDesc( D3D12_CONSTANT_BUFFER_VIEW_DESC & outDesc )                    { outDesc; return false; }
 
         virtual void                                TransitionResource( vaRenderDeviceContextDX12 & context, D3D12_RESOURCE_STATES target ) = 0;
         virtual void                                AdoptResourceState( vaRenderDeviceContextDX12 & context, D3D12_RESOURCE_STATES target ) = 0;   // if something external does a transition we can update our internal tracking
@@ -869,9 +871,14 @@ namespace Vanilla
         // should probably be enabled for WARP once I get WARP working
         // D3D12_PIPELINE_STATE_FLAGS Flags;
 
+        // 64-bit hash of all of the above that goes into the PSO; UpdateHash has to be called after changing any of it and
+        // before the PSO cache lookup (it's never 0 once computed)
+        uint64                              Hash                    = 0;
+
         void                                FillGraphicsPipelineStateDesc( D3D12_GRAPHICS_PIPELINE_STATE_DESC & outDesc, ID3D12RootSignature * pRootSignature ) const;
 
-        void                                FillKey( vaMemoryStream & outStream ) const;
+        void                                UpdateHash( );
+        bool                                KeyEquals( const vaGraphicsPSODescDX12 & other ) const;
     };
 
     // Used for caching
@@ -917,9 +924,13 @@ namespace Vanilla
         // should probably be enabled for WARP once I get WARP working
         // D3D12_PIPELINE_STATE_FLAGS Flags;
 
+        // see vaGraphicsPSODescDX12::Hash
+        uint64                              Hash                    = 0;
+
         void                                FillComputePipelineStateDesc( D3D12_COMPUTE_PIPELINE_STATE_DESC & outDesc, ID3D12RootSignature * pRootSignature ) const;
 
-        void                                FillKey( vaMemoryStream & outStream ) const;
+        void                                UpdateHash( );
+        bool                                KeyEquals( const vaComputePSODescDX12 & other ) const      { return Hash == other.Hash && CSUniqueContentsID == other.CSUniqueContentsID; }
     };
 
     // Used for caching
@@ -77,6 +77,7 @@ void vaConstantBufferDX11::Create( int bufferSize, const void * initialData, boo
 void vaConstantBufferDX11::Destroy( )
 {
     SAFE_RELEASE( m_buffer );
+    m_partialUpdateScratch.clear( );
     m_dataSize = 0;
 }
 
@@ -84,7 +85,15 @@ void vaConstantBufferDX11::Update( ID3D11DeviceContext * dx11Context, const void
 {
     assert( dataSize <= m_dataSize );
 
-    dx11Context->UpdateSubresource( m_buffer, 0, NULL, data, (UINT)dataSize, 0 );
+    // UpdateSubresource always reads the whole buffer size for constant buffers so pad partial updates
+    if( dataSize < m_dataSize )
+    {
+        m_partialUpdateScratch.resize( m_dataSize );
+        memcpy( m_partialUpdateScratch.data(), data, dataSize );
+        data = m_partialUpdateScratch.data();
+    }
+
+    dx11Context->UpdateSubresource( m_buffer, 0, NULL, data, (UINT)m_dataSize, 0 );
 }
 
 void vaConstantBufferDX11::Update( vaRenderDeviceContext & renderContext, const void * data, uint32 dataSize )
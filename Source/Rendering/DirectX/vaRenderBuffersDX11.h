@@ -31,6 +31,7 @@ namespace Vanilla
 
     private:
         ID3D11Buffer *                      m_buffer    = nullptr;
+        vector<uint8>                       m_partialUpdateScratch;     // constant buffers can only be updated whole
 
     protected:
         friend class vaConstantBuffer;
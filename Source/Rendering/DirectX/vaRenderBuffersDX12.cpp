@@ -95,6 +95,59 @@ const vaConstantBufferViewDX12 * vaConstantBufferDX12::GetCBV( ) const
     return nullptr; 
 }
 
+bool vaConstantBufferDX12::GetTransientCBVDesc( D3D12_CONSTANT_BUFFER_VIEW_DESC & outDesc )
+{
+    if( m_ringGPUAddress == 0 )
+        return false;
+
+    // last updated in one of the previous frames - that slice can get released before the GPU is done with this frame so re-upload;
+    // unless the slice was already released (and the data preserved) it's still there to copy from
+    if( m_ringFrameIndex != GetRenderDevice().GetCurrentFrameIndex() )
+    {
+        assert( m_ringShadowValid || m_ringFrameIndex + vaRenderDevice::c_BackbufferCount > GetRenderDevice().GetCurrentFrameIndex() );
+        const void * source = ( m_ringShadowValid ) ? ( m_ringShadowData.data() ) : ( m_ringCPUAddress );
+
+        void * cpuAddress; D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;
+        if( !AsDX12(GetRenderDevice()).AllocateUploadRing( m_actualSizeInBytes, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, cpuAddress, gpuAddress ) )
+        {
+            // ring full - move the contents to our own upload buffer and bind that
+            m_ringGPUAddress = 0;
+            AllocateNextUploadBuffer();
+            assert( m_uploadConstantBuffer->MappedData != nullptr );
+            if( m_uploadConstantBuffer->MappedData != nullptr )
+                memcpy( m_uploadConstantBuffer->MappedData, source, m_dataSize );
+            return false;
+        }
+        memcpy( cpuAddress, source, m_dataSize );
+        SetUploadRingSlice( cpuAddress, gpuAddress );
+    }
+
+    outDesc = { m_ringGPUAddress, m_actualSizeInBytes };
+    return true;
+}
+
+void vaConstantBufferDX12::SetUploadRingSlice( void * cpuAddress, D3D12_GPU_VIRTUAL_ADDRESS gpuAddress )
+{
+    const int64 currentFrameIndex = GetRenderDevice().GetCurrentFrameIndex();
+    if( m_ringFrameIndex != currentFrameIndex )
+        AsDX12(GetRenderDevice()).TrackUploadRingUser( m_createdThis );
+    m_ringCPUAddress = cpuAddress;
+    m_ringGPUAddress = gpuAddress;
+    m_ringFrameIndex = currentFrameIndex;
+}
+
+void vaConstantBufferDX12::PreserveUploadRingData( int64 frameIndex )
+{
+    // updated (or re-uploaded) since, or already have the copy
+    if( m_ringGPUAddress == 0 || m_ringFrameIndex != frameIndex || m_ringShadowValid )
+        return;
+
+    // reading from the upload heap is slow but only buffers that stayed un-updated for a whole frame end up here
+    m_ringShadowData.resize( m_dataSize );
+    memcpy( m_ringShadowData.data(), m_ringCPUAddress, m_dataSize );
+    m_ringShadowValid = true;
+}
+
 void vaConstantBufferDX12::AllocateNextUploadBuffer( )
 {
     assert( m_uploadConstantBuffer == nullptr );
@@ -243,16 +296,28 @@ void vaConstantBufferDX12::Update( vaRenderDeviceContext & renderContext, const
     // this is actually safe to do but not useful since there's no sync with RT contexts
     assert( GetRenderDevice().IsRenderThread() );
     
-    assert( m_dataSize == dataSize );
+    assert( dataSize <= m_dataSize );
 
     if( m_dynamicUpload )
     {
-        assert( m_uploadConstantBuffer != nullptr );
+        assert( m_uploadConstantBuffer != nullptr || m_ringGPUAddress != 0 );
         if( m_uploadConstantBuffer != nullptr ) 
         {
             SafeReleaseUploadBuffer( m_uploadConstantBuffer );
             m_uploadConstantBuffer = nullptr;
         }
+
+        // sub-allocate from the device's per-frame upload ring: no resource or descriptor creation and consecutive updates
+        // (for ex. per-draw instance constants) end up next to each other; only fall back to own buffers if the ring is full
+        void * cpuAddress; D3D12_GPU_VIRTUAL_ADDRESS gpuAddress;
+        if( AsDX12(GetRenderDevice()).AllocateUploadRing( m_actualSizeInBytes, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, cpuAddress, gpuAddress ) )
+        {
+            memcpy( cpuAddress, data, dataSize );
+            SetUploadRingSlice( cpuAddress, gpuAddress );
+            m_ringShadowValid = false;
+            return;
+        }
+        m_ringGPUAddress = 0;
     }
 
     AllocateNextUploadBuffer();
@@ -290,6 +355,12 @@ void vaConstantBufferDX12::DestroyInternal( /*bool lockMutex*/ )
         m_GPUConstantBufferCBV.SafeRelease();
     }
 
+    m_ringCPUAddress = nullptr;
+    m_ringGPUAddress = 0;
+    m_ringFrameIndex = -1;
+    m_ringShadowData.clear();
+    m_ringShadowValid = false;
+
     m_dataSize = 0;
     m_actualSizeInBytes = 0;
     m_dynamicUpload = false;
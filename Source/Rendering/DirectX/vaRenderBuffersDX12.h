@@ -64,6 +64,16 @@ namespace Vanilla
 
         bool                                m_dynamicUpload         = false;
 
+        // set if the last Update went into the device's upload ring (dynamic upload only); the CBV then gets created in place
+        // when binding (see GetTransientCBVDesc) and m_uploadConstantBuffer is not used
+        void *                              m_ringCPUAddress        = nullptr;
+        D3D12_GPU_VIRTUAL_ADDRESS           m_ringGPUAddress        = 0;
+        int64                               m_ringFrameIndex        = -1;
+        // copy of the data for re-uploading if bound in a later frame than the one it was updated in; only made when the
+        // ring slice is about to be released (see PreserveUploadRingData), not on every Update
+        vector<uint8>                       m_ringShadowData;
+        bool                                m_ringShadowValid       = false;
+
         // these are used if m_dynamicUpload == false
         ComPtr<ID3D12Resource>              m_GPUConstantBuffer     = nullptr;
         vaConstantBufferViewDX12            m_GPUConstantBufferCBV;
@@ -83,6 +93,10 @@ namespace Vanilla
         virtual const vaConstantBufferViewDX12 *    GetCBV( ) const override;
         virtual const vaUnorderedAccessViewDX12 *   GetUAV( ) const override                                { return nullptr; }
         virtual const vaShaderResourceViewDX12 *    GetSRV( ) const override                                { return nullptr; }
+        virtual bool                                GetTransientCBVDesc( D3D12_CONSTANT_BUFFER_VIEW_DESC & outDesc ) override;
+
+        // called by the device before releasing the upload ring slices of frameIndex
+        void                                PreserveUploadRingData( int64 frameIndex );
 
         virtual void TransitionResource( vaRenderDeviceContextDX12 & context, D3D12_RESOURCE_STATES target )  override { context; target; assert( false ); } //static_cast<vaResourceStateTransitionHelperDX12*>(this); }
         virtual void AdoptResourceState( vaRenderDeviceContextDX12 & context, D3D12_RESOURCE_STATES target )  override { context; target; assert( false ); } // if something external does a transition we can update our internal tracking
@@ -90,6 +104,7 @@ namespace Vanilla
     private:            
         void                                DestroyInternal( /*bool lockMutex*/ );
         void                                AllocateNextUploadBuffer( );
+        void                                SetUploadRingSlice( void * cpuAddress, D3D12_GPU_VIRTUAL_ADDRESS gpuAddress );
         void                                SafeReleaseUploadBuffer( DetachableUploadBuffer * uploadBuffer );
     };
 
@@ -455,6 +455,12 @@ vaDrawResultFlags vaRenderDeviceContextDX11::ExecuteItem( const vaGraphicsItem &
         case( vaGraphicsItem::DrawType::DrawIndexed ): 
             m_deviceContext->DrawIndexed( renderItem.DrawIndexedParams.IndexCount, renderItem.DrawIndexedParams.StartIndexLocation, renderItem.DrawIndexedParams.BaseVertexLocation );
             break;
+        case( vaGraphicsItem::DrawType::DrawIndexedInstanced ): 
+            m_deviceContext->DrawIndexedInstanced( renderItem.DrawIndexedParams.IndexCount, renderItem.DrawInstancedParams.InstanceCount, renderItem.DrawIndexedParams.StartIndexLocation, renderItem.DrawIndexedParams.BaseVertexLocation, renderItem.DrawInstancedParams.StartInstanceLocation );
+            break;
+        case( vaGraphicsItem::DrawType::DrawInstanced ): 
+            m_deviceContext->DrawInstanced( renderItem.DrawSimpleParams.VertexCount, renderItem.DrawInstancedParams.InstanceCount, renderItem.DrawSimpleParams.StartVertexLocation, renderItem.DrawInstancedParams.StartInstanceLocation );
+            break;
         default:
             assert( false );
             break;
@@ -398,6 +398,13 @@ void vaRenderDeviceContextDX12::BeginItems( vaRenderTypeFlags typeFlags, const v
         if( shaderGlobals.ConstantBuffers[i] != nullptr )
         {
             vaShaderResourceDX12& res = AsDX12( *shaderGlobals.ConstantBuffers[i] );
+            // constants in the device upload ring have no persistent descriptor - create the view in place
+            D3D12_CONSTANT_BUFFER_VIEW_DESC transientCBVDesc;
+            if( res.GetTransientCBVDesc( transientCBVDesc ) )
+            {
+                d3d12Device->CreateConstantBufferView( &transientCBVDesc, gpuHeapSRVCBVUAV->ComputeCPUHandle( descHeapCBVOffset + i ) );
+                continue;
+            }
             const vaConstantBufferViewDX12* cbv = res.GetCBV( );
             if( cbv != nullptr )
             {
@@ -550,6 +557,12 @@ vaDrawResultFlags vaRenderDeviceContextDX12::ExecuteItem( const vaGraphicsItem &
         if( renderItem.ConstantBuffers[i] != nullptr )
         {
             vaShaderResourceDX12& res = AsDX12( *renderItem.ConstantBuffers[i] );
+            D3D12_CONSTANT_BUFFER_VIEW_DESC transientCBVDesc;
+            if( res.GetTransientCBVDesc( transientCBVDesc ) )
+            {
+                d3d12Device->CreateConstantBufferView( &transientCBVDesc, gpuHeapSRVCBVUAV->ComputeCPUHandle( descHeapBaseIndexSRVCBVUAV + vaRenderDeviceDX12::DefaultRootSignatureIndexRanges::CBVBase + i ) );
+                continue;
+            }
             const vaConstantBufferViewDX12* cbv = res.GetCBV( );
             if( cbv != nullptr )
             {
@@ -713,7 +726,8 @@ vaDrawResultFlags vaRenderDeviceContextDX12::ExecuteItem( const vaGraphicsItem &
     }
 #endif
 
-    shared_ptr<vaGraphicsPSODX12> pso = AsDX12(GetRenderDevice()).FindOrCreateGraphicsPipelineState( psoDesc );
+    psoDesc.UpdateHash( );
+    vaGraphicsPSODX12 * pso = AsDX12(GetRenderDevice()).FindOrCreateGraphicsPipelineState( psoDesc, &m_graphicsPSOFrontCache );
     m_commandList->SetPipelineState( pso->GetPSO().Get() );
    
     bool continueWithDraw = true;
@@ -730,6 +744,12 @@ vaDrawResultFlags vaRenderDeviceContextDX12::ExecuteItem( const vaGraphicsItem &
         case( vaGraphicsItem::DrawType::DrawIndexed ): 
             m_commandList->DrawIndexedInstanced( renderItem.DrawIndexedParams.IndexCount, 1, renderItem.DrawIndexedParams.StartIndexLocation, renderItem.DrawIndexedParams.BaseVertexLocation, 0 );
             break;
+        case( vaGraphicsItem::DrawType::DrawIndexedInstanced ): 
+            m_commandList->DrawIndexedInstanced( renderItem.DrawIndexedParams.IndexCount, renderItem.DrawInstancedParams.InstanceCount, renderItem.DrawIndexedParams.StartIndexLocation, renderItem.DrawIndexedParams.BaseVertexLocation, renderItem.DrawInstancedParams.StartInstanceLocation );
+            break;
+        case( vaGraphicsItem::DrawType::DrawInstanced ): 
+            m_commandList->DrawInstanced( renderItem.DrawSimpleParams.VertexCount, renderItem.DrawInstancedParams.InstanceCount, renderItem.DrawSimpleParams.StartVertexLocation, renderItem.DrawInstancedParams.StartInstanceLocation );
+            break;
         default:
             assert( false );
             break;
@@ -741,7 +761,6 @@ vaDrawResultFlags vaRenderDeviceContextDX12::ExecuteItem( const vaGraphicsItem &
     if( renderItem.PostDrawHook != nullptr )
         renderItem.PostDrawHook( renderItem, *this );
 
-    AsDX12(GetRenderDevice()).ReleasePipelineState( pso );
     //// for caching - not really needed for now
     //// m_lastRenderItem = renderItem;
     return vaDrawResultFlags::None;
@@ -803,6 +822,12 @@ vaDrawResultFlags vaRenderDeviceContextDX12::ExecuteItem( const vaComputeItem &
         if( computeItem.ConstantBuffers[i] != nullptr )
         {
             vaShaderResourceDX12 & res = AsDX12(*computeItem.ConstantBuffers[i]);
+            D3D12_CONSTANT_BUFFER_VIEW_DESC transientCBVDesc;
+            if( res.GetTransientCBVDesc( transientCBVDesc ) )
+            {
+                d3d12Device->CreateConstantBufferView( &transientCBVDesc, gpuHeapSRVCBVUAV->ComputeCPUHandle( descHeapBaseIndexSRVCBVUAV + vaRenderDeviceDX12::DefaultRootSignatureIndexRanges::CBVBase + i ) );
+                continue;
+            }
             const vaConstantBufferViewDX12 * cbv = res.GetCBV();
             if( cbv != nullptr )
             {
@@ -858,7 +883,8 @@ vaDrawResultFlags vaRenderDeviceContextDX12::ExecuteItem( const vaComputeItem &
         assert( m_outputsState.UAVInitialCounts[i-m_outputsState.UAVsStartSlot] == -1 ); // UAV counters not supported (and no plans on supporting them)
     }
 
-    shared_ptr<vaComputePSODX12> pso = AsDX12(GetRenderDevice()).FindOrCreateComputePipelineState( psoDesc );
+    psoDesc.UpdateHash( );
+    vaComputePSODX12 * pso = AsDX12(GetRenderDevice()).FindOrCreateComputePipelineState( psoDesc, &m_computePSOFrontCache );
     m_commandList->SetPipelineState( pso->GetPSO().Get() );
 
     bool continueWithDraw = true;
@@ -896,8 +922,6 @@ vaDrawResultFlags vaRenderDeviceContextDX12::ExecuteItem( const vaComputeItem &
         m_itemsSubmittedAfterLastExecute++;
     }
     
-    AsDX12(GetRenderDevice()).ReleasePipelineState( pso );
-
     // // API-SPECIFIC MODIFIER CALLBACKS
     // std::function<bool( RenderItem & )> PreDrawHook;
 
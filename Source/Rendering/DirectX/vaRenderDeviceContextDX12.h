@@ -62,6 +62,10 @@ namespace Vanilla
         D3D_PRIMITIVE_TOPOLOGY          m_commandListCurrentTopology        = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
         D3D12_SHADING_RATE              m_commandListShadingRate            = D3D12_SHADING_RATE_1X1;
 
+        // in front of the device's PSO caches so that repeated draws with the same states don't go to the shared table
+        vaRenderDeviceDX12::GraphicsPSOCache::FrontCache<>  m_graphicsPSOFrontCache;
+        vaRenderDeviceDX12::ComputePSOCache::FrontCache<>   m_computePSOFrontCache;
+
     protected:
         explicit                        vaRenderDeviceContextDX12( const vaRenderingModuleParams & params );
         virtual                         ~vaRenderDeviceContextDX12( );
@@ -177,12 +177,8 @@ vaRenderDeviceDX12::~vaRenderDeviceDX12( void )
 
     // clear PSO cache (these hold shader blobs)
     {
-        for( auto& it : m_graphicsPSOCache )
-            ReleasePipelineState( it.second );
-        m_graphicsPSOCache.clear( );
-        for( auto& it : m_computePSOCache )
-            ReleasePipelineState( it.second );
-        m_computePSOCache.clear( );
+        m_graphicsPSOCache.Clear( [this]( shared_ptr<vaGraphicsPSODX12> & pso ) { ReleasePipelineState( pso ); } );
+        m_computePSOCache.Clear( [this]( shared_ptr<vaComputePSODX12> & pso ) { ReleasePipelineState( pso ); } );
     }
 
     // clear all - as there's a queue for each frame/swapchain 
@@ -216,6 +212,16 @@ vaRenderDeviceDX12::~vaRenderDeviceDX12( void )
     m_nullDSV.SafeRelease();
     m_nullSamplerView.SafeRelease();
 
+    if( m_uploadRingBuffer != nullptr )
+    {
+        m_uploadRingBuffer->Unmap( 0, nullptr );
+        m_uploadRingMappedData = nullptr;
+        m_uploadRingGPUAddress = 0;
+        m_uploadRingBuffer.Reset();
+    }
+    for( auto & users : m_uploadRingUsers )
+        users.clear( );
+
     // one last time but clear all - as there's a queue for each frame/swapchain 
     {
         // make sure GPU is not executing anything from us anymore and call & clear all callbacks
@@ -681,6 +687,23 @@ bool vaRenderDeviceDX12::Initialize( const vector<wstring> & shaderSearchPaths )
         m_nullSamplerView.CreateNull();
     }
 
+    // upload ring for dynamic constant buffers
+    {
+        V( m_device->CreateCommittedResource( &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer( c_uploadRingCapacity ),
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS( &m_uploadRingBuffer ) ) );
+        if( SUCCEEDED( hr ) )
+        {
+            m_uploadRingBuffer->SetName( L"vaRenderDeviceDX12_uploadRing" );
+            CD3DX12_RANGE readRange( 0, 0 );        // We do not intend to read from this resource on the CPU.
+            if( FAILED( m_uploadRingBuffer->Map( 0, &readRange, reinterpret_cast<void**>( &m_uploadRingMappedData ) ) ) )
+            {
+                assert( false );
+                m_uploadRingMappedData = nullptr;
+            }
+            m_uploadRingGPUAddress = m_uploadRingBuffer->GetGPUVirtualAddress( );
+        }
+    }
+
         // Create the root signature.
     {
         D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
@@ -1080,6 +1103,20 @@ void vaRenderDeviceDX12::BeginFrame( float deltaTime )
 
     vaRenderDevice::BeginFrame( deltaTime );
 
+    // GPU is done with frame (current - c_BackbufferCount) at this point (see the fence wait in EndAndPresentFrame); constant
+    // buffers not updated since still need their data in case they get bound again
+    {
+        vector<weak_ptr<vaConstantBufferDX12*>> & users = m_uploadRingUsers[GetCurrentFrameIndex( ) % c_BackbufferCount];
+        for( const weak_ptr<vaConstantBufferDX12*> & user : users )
+        {
+            shared_ptr<vaConstantBufferDX12*> buffer = user.lock( );
+            if( buffer != nullptr )
+                (*buffer)->PreserveUploadRingData( GetCurrentFrameIndex( ) - c_BackbufferCount );
+        }
+        users.clear( );
+    }
+    m_uploadRing.BeginFrame( GetCurrentFrameIndex( ) );
+
     m_mainDeviceContext->BeginFrame( );
 
     // execute begin frame callbacks - mostly initialization stuff that requires a command list (main context)
@@ -1196,6 +1233,21 @@ void vaRenderDeviceDX12::EndAndPresentFrame( int vsyncInterval )
 #endif
 }
 
+bool vaRenderDeviceDX12::AllocateUploadRing( uint32 size, uint32 alignment, void *& outCPUAddress, D3D12_GPU_VIRTUAL_ADDRESS & outGPUAddress )
+{
+    assert( IsRenderThread() );
+    if( m_uploadRingMappedData == nullptr || !IsFrameStarted( ) )
+        return false;
+
+    uint64 offset;
+    if( !m_uploadRing.Allocate( size, alignment, offset ) )
+        return false;
+
+    outCPUAddress = m_uploadRingMappedData + offset;
+    outGPUAddress = m_uploadRingGPUAddress + offset;
+    return true;
+}
+
 void vaRenderDeviceDX12::ExecuteAtBeginFrame( const std::function<void( vaRenderDeviceDX12 & device )> & callback )
 { 
     assert( !m_beginFrameCallbacksDisable );
@@ -1579,94 +1631,55 @@ void vaRenderDeviceDX12::ImGuiEndFrameAndRender( vaRenderDeviceContext & renderC
     m_imguiFrameStarted = false;
 }
 
-template< typename PSOType >
-static void CleanPSOCache( vaRenderDeviceDX12 & device, vaMemoryBuffer & startKey, std::map<vaMemoryBuffer, shared_ptr<PSOType>, MemoryBufferComparer> & PSOCache )
+template< typename PSOType, typename PSODescType >
+static void CleanPSOCache( vaRenderDeviceDX12 & device, vaPipelineStateCache<PSODescType, PSOType> & PSOCache )
 {
-    const int64 currentFrameIndex     = device.GetCurrentFrameIndex();
-    const int itemsToVisit          = 5;
-    const int unusedAgeThreshold    = 9000; // at 30fps this is 5 minutes
-
-    if( PSOCache.size() == 0 )
-        return;
+    static const int itemsToVisit           = 5;
+    static const int unusedAgeThreshold     = 9000; // at 30fps this is 5 minutes
+    const int64 currentFrameIndex           = device.GetCurrentFrameIndex();
 
-    // get start iterator
-    auto & it = (startKey.GetData() == nullptr)?(PSOCache.end()):(PSOCache.find( startKey ));
-    if( it == PSOCache.end() )
-        it = PSOCache.begin();
-
-    float remainingStepCount = (float)std::min( itemsToVisit, (int)PSOCache.size() );
-    do 
+    PSOCache.IncrementalCleanup( itemsToVisit, [&device, currentFrameIndex]( shared_ptr<PSOType> & pso )
     {
-        if( currentFrameIndex - it->second->GetLastUsedFrame( ) > unusedAgeThreshold )
-        {
-            device.ReleasePipelineState( it->second );
-            it = PSOCache.erase( it );
-            remainingStepCount += 0.8f;   // if there was something to erase, just continue erasing but not indefinitely so we don't cause a frame spike
-        }
-        else
-            it++;
-
-        remainingStepCount -= 1.0f;
-        if( it == PSOCache.end() && PSOCache.size() > 0 )
-            it = PSOCache.begin();
-    } while ( remainingStepCount > 0.0f && PSOCache.size() > 0 );
-
-    if( it != PSOCache.end() )
-        startKey = it->first;
-    else
-        startKey.Clear();
+        if( currentFrameIndex - pso->GetLastUsedFrame( ) <= unusedAgeThreshold )
+            return false;
+        device.ReleasePipelineState( pso );
+        return true;
+    } );
 }
 
 void vaRenderDeviceDX12::PSOCachesClearUnusedTick( )
 {
-    std::unique_lock<std::mutex> mutexLock(m_PSOCacheMutex);
-    CleanPSOCache( *this, m_graphicsPSOCacheCleanupLastKey, m_graphicsPSOCache );
-    CleanPSOCache( *this, m_computePSOCacheCleanupLastKey, m_computePSOCache );
+    // no lookups can be in flight here (all happen on the render thread in between BeginFrame/EndFrame) which is
+    // what vaPipelineStateCache::IncrementalCleanup requires; it will also flush all context front caches if anything got removed
+    CleanPSOCache( *this, m_graphicsPSOCache );
+    CleanPSOCache( *this, m_computePSOCache );
 }
 
-template< typename PSOType, typename PSODescType, int scratchBufferSize >
-static shared_ptr<PSOType> FindOrCreateGraphicsPipelineStateTemplated( vaRenderDeviceDX12 & device, std::mutex & mtx, const PSODescType & psoDesc, std::map<vaMemoryBuffer, shared_ptr<PSOType>, MemoryBufferComparer> & PSOCache, ID3D12RootSignature * rootSignature )
+template< typename PSOType, typename PSODescType, typename PSOCacheType, typename FrontCacheType >
+static PSOType * FindOrCreatePipelineStateTemplated( vaRenderDeviceDX12 & device, const PSODescType & psoDesc, PSOCacheType & PSOCache, FrontCacheType * frontCache, ID3D12RootSignature * rootSignature )
 {
-    assert( device.IsRenderThread() ); // make sure it's really thread-safe 
-
-    uint8 scratchBuffer[scratchBufferSize];
-
-    vaMemoryStream scratchStream( scratchBuffer, scratchBufferSize );
-    psoDesc.FillKey( scratchStream );
-    vaMemoryBuffer tempKey( scratchStream.GetBuffer(), scratchStream.GetPosition(), vaMemoryBuffer::InitType::View ); // doesn't take the ownership (no allocations)!
-    
-    shared_ptr<PSOType> retPSO = nullptr;
-
-    // only need to lock now - building the key (above) was the most expensive part
-    std::unique_lock<std::mutex> mutexLock(mtx);
+    assert( device.IsRenderThread() ); // lookups are thread-safe but PSOCachesClearUnusedTick expects them all on the render thread
+    assert( psoDesc.Hash != 0 );        // UpdateHash not called?
 
+    auto createPSO = [&device, rootSignature]( const PSODescType & desc )
     {
-        //VA_TRACE_CPU_SCOPE( FindOrCreate );
-        auto it = PSOCache.find( tempKey );
-        if( it != PSOCache.end() )
-        {
-            retPSO = it->second;
-        }
-        else
-        {
-            //VA_TRACE_CPU_SCOPE( CreatePSO );
-
-            retPSO = std::make_shared<PSOType>( psoDesc );
+        //VA_TRACE_CPU_SCOPE( CreatePSO );
+        shared_ptr<PSOType> pso = std::make_shared<PSOType>( desc );
 
-            HRESULT hr;
-            V( retPSO->CreatePSO( device, rootSignature ) );
+        HRESULT hr;
+        V( pso->CreatePSO( device, rootSignature ) );
+        return pso;
+    };
 
-            PSOCache.insert( std::make_pair( tempKey, retPSO ) );
-        }
-    }
+    PSOType * retPSO = ( frontCache != nullptr ) ? ( frontCache->FindOrCreate( PSOCache, psoDesc, createPSO ) ) : ( PSOCache.FindOrCreate( psoDesc, createPSO ) );
     assert( retPSO != nullptr );
     retPSO->SetLastUsedFrame( device.GetCurrentFrameIndex() );
     return retPSO;
 }
 
-shared_ptr<vaGraphicsPSODX12> vaRenderDeviceDX12::FindOrCreateGraphicsPipelineState( const vaGraphicsPSODescDX12 & psoDesc )
+vaGraphicsPSODX12 * vaRenderDeviceDX12::FindOrCreateGraphicsPipelineState( const vaGraphicsPSODescDX12 & psoDesc, GraphicsPSOCache::FrontCache<> * frontCache )
 {
-    return FindOrCreateGraphicsPipelineStateTemplated<vaGraphicsPSODX12, vaGraphicsPSODescDX12, 256>( *this, m_PSOCacheMutex, psoDesc, m_graphicsPSOCache, GetDefaultGraphicsRootSignature() );
+    return FindOrCreatePipelineStateTemplated<vaGraphicsPSODX12>( *this, psoDesc, m_graphicsPSOCache, frontCache, GetDefaultGraphicsRootSignature() );
 }
 
 void vaRenderDeviceDX12::ReleasePipelineState( shared_ptr<vaGraphicsPSODX12> & pso )
@@ -1692,9 +1705,9 @@ void vaRenderDeviceDX12::ReleasePipelineState( shared_ptr<vaGraphicsPSODX12> & p
         delete sptrToDispose;
 }
 
-shared_ptr<vaComputePSODX12> vaRenderDeviceDX12::FindOrCreateComputePipelineState( const vaComputePSODescDX12 & psoDesc )
+vaComputePSODX12 * vaRenderDeviceDX12::FindOrCreateComputePipelineState( const vaComputePSODescDX12 & psoDesc, ComputePSOCache::FrontCache<> * frontCache )
 {
-    return FindOrCreateGraphicsPipelineStateTemplated<vaComputePSODX12, vaComputePSODescDX12, 256>( *this, m_PSOCacheMutex, psoDesc, m_computePSOCache, GetDefaultComputeRootSignature() );
+    return FindOrCreatePipelineStateTemplated<vaComputePSODX12>( *this, psoDesc, m_computePSOCache, frontCache, GetDefaultComputeRootSignature() );
 }
 
 void vaRenderDeviceDX12::ReleasePipelineState( shared_ptr<vaComputePSODX12> & pso )
@@ -23,8 +23,10 @@
 
 #include "Rendering/DirectX/vaDirectXIncludes.h"
 #include "Rendering/DirectX/vaDirectXTools.h"
+#include "Rendering/vaPipelineStateCache.h"
 
 #include "Core/System/vaMemoryStream.h"
+#include "Core/vaUploadRingAllocator.h"
 
 // #include "Rendering/DirectX/vaDebugCanvas2DDX11.h"
 // #include "Rendering/DirectX/vaDebugCanvas3DDX11.h"
@@ -40,16 +42,7 @@ namespace Vanilla
 {
     class vaApplicationWin;
     class vaBufferDX12;
-
-    struct MemoryBufferComparer
-    {
-        bool operator()( const vaMemoryBuffer & left, const vaMemoryBuffer & right ) const
-        {
-            assert( left.GetSize() == right.GetSize() );
-            // comparison logic goes here
-            return memcmp( left.GetData(), right.GetData(), std::min( left.GetSize(), right.GetSize() ) ) < 0;
-        }
-    };
+    class vaConstantBufferDX12;
 
     class vaRenderDeviceDX12 : public vaRenderDevice
     {
@@ -219,15 +212,24 @@ namespace Vanilla
         vaDepthStencilViewDX12              m_nullDSV;
         vaSamplerViewDX12                   m_nullSamplerView;
 
-        // PSO cache
-        std::mutex                          m_PSOCacheMutex;
+        // one persistently mapped upload buffer shared by all dynamic constant buffer updates (see AllocateUploadRing)
+        static constexpr uint64             c_uploadRingCapacity    = 16 * 1024 * 1024;
+        ComPtr<ID3D12Resource>              m_uploadRingBuffer;
+        uint8 *                             m_uploadRingMappedData  = nullptr;
+        D3D12_GPU_VIRTUAL_ADDRESS           m_uploadRingGPUAddress  = 0;
+        vaUploadRingAllocator               m_uploadRing            { c_uploadRingCapacity, c_BackbufferCount };
+        // constant buffers that put data into the ring, by the frame they did it in; before that frame's slices get released
+        // the ones still pointing at them make a CPU copy so that they can be re-uploaded if bound later
+        vector<weak_ptr<vaConstantBufferDX12*>>    m_uploadRingUsers[c_BackbufferCount];
 
-        std::map<vaMemoryBuffer, shared_ptr<vaGraphicsPSODX12>, MemoryBufferComparer>
-                                            m_graphicsPSOCache;
-        vaMemoryBuffer                      m_graphicsPSOCacheCleanupLastKey;
-        std::map<vaMemoryBuffer, shared_ptr<vaComputePSODX12>, MemoryBufferComparer>
-                                            m_computePSOCache;
-        vaMemoryBuffer                      m_computePSOCacheCleanupLastKey;
+    public:
+        typedef vaPipelineStateCache<vaGraphicsPSODescDX12, vaGraphicsPSODX12>    GraphicsPSOCache;
+        typedef vaPipelineStateCache<vaComputePSODescDX12, vaComputePSODX12>      ComputePSOCache;
+
+    private:
+        // PSO caches - lookups are lock-free; contexts keep their own front caches on top (see vaPipelineStateCache)
+        GraphicsPSOCache                    m_graphicsPSOCache;
+        ComputePSOCache                     m_computePSOCache;
 
     private:
 
@@ -276,6 +278,13 @@ namespace Vanilla
         template<typename T>
         void                                SafeReleaseAfterCurrentGPUFrameDone( ComPtr<T> & resourcePtr, bool assertOnNotUnique = true );
 
+        // transient upload memory valid until the GPU is done with the current frame (render thread only, and only between
+        // BeginFrame/EndAndPresentFrame); returns false if the ring is full, in which case the caller has to use its own buffer
+        bool                                AllocateUploadRing( uint32 size, uint32 alignment, void *& outCPUAddress, D3D12_GPU_VIRTUAL_ADDRESS & outGPUAddress );
+        // see m_uploadRingUsers; once per buffer per frame is enough
+        void                                TrackUploadRingUser( const shared_ptr<vaConstantBufferDX12*> & buffer )        { m_uploadRingUsers[GetCurrentFrameIndex( ) % c_BackbufferCount].push_back( buffer ); }
+        const vaUploadRingAllocator &       GetUploadRing( ) const                                                          { return m_uploadRing; }
+
         const vaConstantBufferViewDX12 &    GetNullCBV        () const                                                     { return  m_nullCBV;       }
         const vaShaderResourceViewDX12 &    GetNullSRV        () const                                                     { return  m_nullSRV;       }
         const vaUnorderedAccessViewDX12&    GetNullUAV        () const                                                     { return  m_nullUAV;       }
@@ -284,13 +293,14 @@ namespace Vanilla
         const vaDepthStencilViewDX12   &    GetNullDSV        () const                                                     { return  m_nullDSV;       }
         const vaSamplerViewDX12        &    GetNullSamplerView() const                                                     { return m_nullSamplerView;}
 
-        // find in cache or create
-        shared_ptr<vaGraphicsPSODX12>       FindOrCreateGraphicsPipelineState( const vaGraphicsPSODescDX12 & psoDesc );
+        // find in cache or create; psoDesc.UpdateHash() must have been called; the returned PSO stays alive at least until
+        // the next frame (unused ones get released in PSOCachesClearUnusedTick) so no need to hold on to it
+        vaGraphicsPSODX12 *                 FindOrCreateGraphicsPipelineState( const vaGraphicsPSODescDX12 & psoDesc, GraphicsPSOCache::FrontCache<> * frontCache = nullptr );
         // will set pso to nullptr and add it to reuse cache or deletion queue; this is the only safe way to release this shared pointer
         void                                ReleasePipelineState( shared_ptr<vaGraphicsPSODX12> & pso );
 
-        // find in cache or create
-        shared_ptr<vaComputePSODX12>        FindOrCreateComputePipelineState( const vaComputePSODescDX12 & psoDesc );
+        // find in cache or create; same rules as for FindOrCreateGraphicsPipelineState
+        vaComputePSODX12 *                  FindOrCreateComputePipelineState( const vaComputePSODescDX12 & psoDesc, ComputePSOCache::FrontCache<> * frontCache = nullptr );
         // will set pso to nullptr and add it to reuse cache or deletion queue; this is the only safe way to release this shared pointer
         void                                ReleasePipelineState( shared_ptr<vaComputePSODX12> & pso );
 
@@ -41,10 +41,6 @@
 
 using namespace Vanilla;
 
-#ifdef NDEBUG
-#define           STILL_LOAD_FROM_CACHE_IF_ORIGINAL_FILE_MISSING
-#endif
-
 using namespace std;
 
 namespace Vanilla
@@ -54,7 +50,7 @@ namespace Vanilla
 
     class vaShaderIncludeHelper11 : public ID3DInclude
     {
-        std::vector<vaShaderCacheEntry11::FileDependencyInfo> &     m_dependenciesCollector;
+        std::vector<vaShaderFileDependency> &                       m_dependenciesCollector;
         
         std::vector< std::pair<string, string> >                    m_foundNamePairs;
 
@@ -72,7 +68,7 @@ namespace Vanilla
         //}    // to prevent warnings (and also this object doesn't support copying/assignment)
 
     public:
-        vaShaderIncludeHelper11( std::vector<vaShaderCacheEntry11::FileDependencyInfo> & dependenciesCollector, const wstring & relativePath, const string & macrosAsIncludeFile ) : m_dependenciesCollector( dependenciesCollector ), m_relativePath( relativePath ), m_macrosAsIncludeFile( macrosAsIncludeFile )
+        vaShaderIncludeHelper11( std::vector<vaShaderFileDependency> & dependenciesCollector, const wstring & relativePath, const string & macrosAsIncludeFile ) : m_dependenciesCollector( dependenciesCollector ), m_relativePath( relativePath ), m_macrosAsIncludeFile( macrosAsIncludeFile )
         {
         }
 
@@ -92,7 +88,7 @@ namespace Vanilla
                 return S_OK;
             }
 
-            vaShaderCacheEntry11::FileDependencyInfo fileDependencyInfo;
+            vaShaderFileDependency fileDependencyInfo;
             std::shared_ptr<vaMemoryStream>        memBuffer;
 
             wstring fileNameR = m_relativePath + vaStringTools::SimpleWiden( string( pFileName ) );
@@ -104,7 +100,7 @@ namespace Vanilla
                 fullFileName = vaDirectX11ShaderManager::GetInstance( ).FindShaderFile( fileNameA.c_str( ) );
             if( fullFileName != L"" )
             {
-                fileDependencyInfo = vaShaderCacheEntry11::FileDependencyInfo( fullFileName.c_str( ) );
+                fileDependencyInfo = vaDirectX11ShaderManager::GetInstance( ).MakeFileDependency( fullFileName );
                 memBuffer = vaFileTools::LoadFileToMemoryStream( fullFileName.c_str( ) );
             }
             else
@@ -119,7 +115,7 @@ namespace Vanilla
                     vaCore::Error( L"Error trying to find shader file '%s' / '%s'!", fileNameR.c_str( ), fileNameA.c_str( ) );
                     return E_FAIL;
                 }
-                fileDependencyInfo = vaShaderCacheEntry11::FileDependencyInfo( embeddedData.Name.c_str(), embeddedData.TimeStamp );
+                fileDependencyInfo = vaShaderFileDependency( embeddedData.Name.c_str(), embeddedData.TimeStamp );
                 memBuffer = embeddedData.MemStream;
             }
 
@@ -244,7 +240,7 @@ namespace Vanilla
         }
     }
     //
-    void vaShaderDX11::CreateCacheKey( vaShaderCacheKey11 & outKey )
+    void vaShaderDX11::CreateCacheKey( vaShaderCacheKey & outKey )
     {
         m_allShaderDataMutex.assert_locked_by_caller();
 
@@ -362,7 +358,7 @@ namespace Vanilla
         return ret;
     }
     //
-    void vaVertexShaderDX11::CreateCacheKey( vaShaderCacheKey11 & outKey )
+    void vaVertexShaderDX11::CreateCacheKey( vaShaderCacheKey & outKey )
     {
         m_allShaderDataMutex.assert_locked_by_caller();
 
@@ -372,7 +368,7 @@ namespace Vanilla
     }
     //
     static HRESULT CompileShaderFromFile( const wchar_t* szFileName, const string & macrosAsIncludeFile, LPCSTR szEntryPoint,
-        LPCSTR szShaderModel, ID3DBlob** ppBlobOut, vector<vaShaderCacheEntry11::FileDependencyInfo> & outDependencies, HWND hwnd, string & outErrorInfo )
+        LPCSTR szShaderModel, ID3DBlob** ppBlobOut, vector<vaShaderFileDependency> & outDependencies, HWND hwnd, string & outErrorInfo )
     {
         HRESULT hr = S_OK;
 
@@ -400,7 +396,7 @@ namespace Vanilla
             do
             {
                 outDependencies.clear( );
-                outDependencies.push_back( vaShaderCacheEntry11::FileDependencyInfo( szFileName ) );
+                outDependencies.push_back( vaDirectX11ShaderManager::GetInstance( ).MakeFileDependency( szFileName ) );
 
                 wstring relativePath;
                 vaFileTools::SplitPath( szFileName, &relativePath, nullptr, nullptr );
@@ -457,7 +453,7 @@ namespace Vanilla
                 return E_FAIL;
             }
 
-            vaShaderCacheEntry11::FileDependencyInfo fileDependencyInfo = vaShaderCacheEntry11::FileDependencyInfo( szFileName, embeddedData.TimeStamp );
+            vaShaderFileDependency fileDependencyInfo = vaShaderFileDependency( szFileName, embeddedData.TimeStamp );
 
             outDependencies.clear( );
             outDependencies.push_back( fileDependencyInfo );
@@ -520,7 +516,7 @@ namespace Vanilla
             combinedShaderCode +="\n";
         combinedShaderCode += shaderCode;
 
-        vector<vaShaderCacheEntry11::FileDependencyInfo> unusedDependencies;
+        vector<vaShaderFileDependency> unusedDependencies;
         vaShaderIncludeHelper11 includeHelper( unusedDependencies, L"", macrosAsIncludeFile );
 
         ID3DBlob* pErrorBlob;
@@ -571,7 +567,7 @@ namespace Vanilla
 
         if( m_shaderFilePath.size( ) != 0 )
         {
-            vaShaderCacheKey11 cacheKey;
+            vaShaderCacheKey cacheKey;
             CreateCacheKey( cacheKey );
 
 #ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
@@ -594,7 +590,7 @@ namespace Vanilla
 
             if( shaderBlob == nullptr )
             {
-                vector<vaShaderCacheEntry11::FileDependencyInfo> dependencies;
+                vector<vaShaderFileDependency> dependencies;
 
                 CompileShaderFromFile( m_shaderFilePath.c_str( ), macrosAsIncludeFile, m_entryPoint.c_str( ), m_shaderModel.c_str( ), &shaderBlob, dependencies, GetRenderDevice().SafeCast<vaRenderDeviceDX11*>()->GetHWND( ), m_lastError );
 
@@ -631,7 +627,7 @@ namespace Vanilla
                 {
                     wstring fileName = vaCore::GetWorkingDirectory( );
 
-                    vaShaderCacheKey11 cacheKey;
+                    vaShaderCacheKey cacheKey;
                     CreateCacheKey( cacheKey );
                     // vaCRC64 crc;
                     // crc.AddString( cacheKey.StringPart );
@@ -929,9 +925,6 @@ namespace Vanilla
         assert( GetRenderDevice().IsRenderThread() );
 #ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
         {
-            // lock here just in case we put something after the loading task 
-            std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );
-
             // this should maybe be set externally, but good enough for now
             m_cacheFilePath = vaCore::GetExecutableDirectory( ) + L".cache\\";
 
@@ -943,7 +936,16 @@ namespace Vanilla
 #endif
         }
 
-        LoadCacheInternal();
+        // the cache used to be a single file with everything in it - not used anymore
+        if( vaFileTools::FileExists( m_cacheFilePath ) )
+            vaFileTools::DeleteFile( m_cacheFilePath );
+
+        // this only maps the index, entries get loaded on first use so startup doesn't depend on the size of the cache
+        if( m_cacheStore.Open( m_cacheFilePath ) && m_cacheStore.NeedsCompaction( ) )
+        {
+            m_cacheCompactionTask = vaBackgroundTaskManager::GetInstance( ).Spawn( "Compacting Shader Cache", vaBackgroundTaskManager::SpawnFlags::None, 
+                [this]( vaBackgroundTaskManager::TaskContext & ) { return m_cacheStore.Compact( ); } );
+        }
 #endif // VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
     }
     //
@@ -953,12 +955,10 @@ namespace Vanilla
         assert( GetRenderDevice().IsRenderThread() );
 
 #ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
-        {
-            std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );    // this is also needed to make sure loading finished!
-            SaveCacheInternal( );
-        }
+        if( m_cacheCompactionTask != nullptr )
+            vaBackgroundTaskManager::GetInstance( ).WaitUntilFinished( m_cacheCompactionTask );
+        m_cacheStore.Close( );
 #endif
-        ClearCache( );
 
         // Ensure no shaders remain
         {
@@ -1005,319 +1005,39 @@ namespace Vanilla
         return L"";
     }
     //
-    void vaDirectX11ShaderManager::LoadCacheInternal( )
-    {
-        auto loadingLambda = [this]( vaBackgroundTaskManager::TaskContext & context ) 
-        {
-            // lock here just in case we put something after the loading task 
-            std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );
-
-            {
-                std::unique_lock<std::mutex> cacheLoadStartedMutexLock( m_cacheLoadStartedMutex );
-                m_cacheLoadStarted = true;
-            }
-            m_cacheLoadStartedCV.notify_all();
-
-            wstring fullFileName = m_cacheFilePath;
-
-            if( fullFileName == L"" )
-                return false;
-
-            if( !vaFileTools::FileExists( fullFileName ) )
-                return false;
-
-            ClearCacheInternal( );
-
-            vaFileStream inFile;
-            if( inFile.Open( fullFileName.c_str( ), FileCreationMode::Open, FileAccessMode::Read ) )
-            {
-                int version = -1;
-                inFile.ReadValue<int32>( version );
-
-                assert( version == 0 );
-
-                int32 entryCount = 0;
-                inFile.ReadValue<int32>( entryCount );
-
-                for( int i = 0; i < entryCount; i++ )
-                {
-                    context.Progress = float(i)/float(entryCount-1);
-
-                    vaShaderCacheKey11 key;
-                    key.Load( inFile );
-                    vaShaderCacheEntry11 * entry = new vaShaderCacheEntry11( inFile );
-
-                    m_cache.insert( std::pair<vaShaderCacheKey11, vaShaderCacheEntry11 *>( key, entry ) );
-                }
-
-                int32 terminator;
-                inFile.ReadValue<int32>( terminator );
-                assert( terminator == 0xFF );
-            }
-            return true;
-        };
-
-        bool multithreaded = true;
-        if( multithreaded )
-        {
-            vaBackgroundTaskManager::GetInstance().Spawn( "Loading Shader Cache", vaBackgroundTaskManager::SpawnFlags::ShowInUI, loadingLambda );
-            
-            // make sure we've started and taken the thread
-            {
-                std::unique_lock<std::mutex> lk(m_cacheLoadStartedMutex);
-                m_cacheLoadStartedCV.wait(lk, [this] { return (bool)m_cacheLoadStarted; } );
-            }
-        }
-        else
-        {
-            loadingLambda( vaBackgroundTaskManager::TaskContext() );
-        }
-    }
-    //
-    void vaDirectX11ShaderManager::SaveCacheInternal( ) const
-    {
-        // must already be locked by this point!
-        // std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );
-        m_cacheMutex.assert_locked_by_caller();
-
-        wstring fullFileName = m_cacheFilePath;
-
-        wstring cacheDir;
-        vaFileTools::SplitPath( fullFileName, &cacheDir, nullptr, nullptr );
-        vaFileTools::EnsureDirectoryExists( cacheDir.c_str( ) );
-
-        vaFileStream outFile;
-        outFile.Open( fullFileName.c_str( ), FileCreationMode::Create );
-
-        outFile.WriteValue<int32>( 0 );                 // version;
-
-        outFile.WriteValue<int32>( (int32)m_cache.size( ) );    // number of entries
-
-        for( std::map<vaShaderCacheKey11, vaShaderCacheEntry11 *>::const_iterator it = m_cache.cbegin( ); it != m_cache.cend( ); ++it )
-        {
-            // Save key
-            ( *it ).first.Save( outFile );
-
-            // Save data
-            ( *it ).second->Save( outFile );
-        }
-
-        outFile.WriteValue<int32>( 0xFF );  // EOF;
-    }
-    //
-    void vaDirectX11ShaderManager::ClearCacheInternal( )
-    {
-        m_cacheMutex.assert_locked_by_caller();
-        for( std::map<vaShaderCacheKey11, vaShaderCacheEntry11 *>::iterator it = m_cache.begin( ); it != m_cache.end( ); ++it )
-        {
-            delete ( *it ).second;;
-        }
-        m_cache.clear( );
-    }
-    //
     void vaDirectX11ShaderManager::ClearCache( )
     {
-        std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );
-        ClearCacheInternal();
+#ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
+        m_cacheStore.Clear( );
+#endif
     }
     //
-    ID3DBlob * vaDirectX11ShaderManager::FindInCache( vaShaderCacheKey11 & key, bool & foundButModified )
+    ID3DBlob * vaDirectX11ShaderManager::FindInCache( vaShaderCacheKey & key, bool & foundButModified )
     {
-        std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );
-
         foundButModified = false;
+#ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
+        auto entry = m_cacheStore.Find( key, [this]( const wstring & filePath, int64 & outTimeStamp ) { return GetShaderFileTimeStamp( filePath, outTimeStamp ); }, foundButModified );
+        if( entry == nullptr )
+            return nullptr;
 
-        std::map<vaShaderCacheKey11, vaShaderCacheEntry11 *>::iterator it = m_cache.find( key );
-
-        if( it != m_cache.end( ) )
-        {
-            if( ( *it ).second->IsModified( ) )
-            {
-                foundButModified = true;
-
-                // Have to recompile...
-                delete ( *it ).second;
-                m_cache.erase( it );
-
-                return nullptr;
-            }
-
-            ID3DBlob * retBlob = ( *it ).second->GetCompiledShader( );
-            return retBlob;
-        }
+        ID3DBlob * shaderBlob = nullptr;
+        if( FAILED( D3DCreateBlob( entry->Blob.size( ), &shaderBlob ) ) )
+            return nullptr;
+        memcpy( shaderBlob->GetBufferPointer( ), entry->Blob.data( ), entry->Blob.size( ) );
+        return shaderBlob;
+#else
+        key;
         return nullptr;
+#endif
     }
     //
-    void vaDirectX11ShaderManager::AddToCache( vaShaderCacheKey11 & key, ID3DBlob * shaderBlob, std::vector<vaShaderCacheEntry11::FileDependencyInfo> & dependencies )
-    {
-        std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );
-
-        std::map<vaShaderCacheKey11, vaShaderCacheEntry11 *>::iterator it = m_cache.find( key );
-
-        if( it != m_cache.end( ) )
-        {
-            // Already in? can happen with parallel compilation I guess?
-            // well let's just not do anything then
-            return;
-            // delete ( *it ).second;
-            // m_cache.erase( it );
-        }
-
-        m_cache.insert( std::pair<vaShaderCacheKey11, vaShaderCacheEntry11 *>( key, new vaShaderCacheEntry11( shaderBlob, dependencies ) ) );
-    }
-    //
-    vaShaderCacheEntry11::FileDependencyInfo::FileDependencyInfo( const wstring & filePath )
-    {
-        wstring fullFileName = vaDirectX11ShaderManager::GetInstance( ).FindShaderFile( filePath );
-
-        if( fullFileName == L"" )
-        {
-            VA_ERROR( L"Error trying to find shader file '%s'!", filePath.c_str() );
-
-            assert( false );
-            this->FilePath = L"";
-            this->ModifiedTimeDate = 0;
-        }
-        else
-        {
-            this->FilePath = filePath;
-
-            // struct _stat64 fileInfo;
-            // _wstat64( fullFileName.c_str( ), &fileInfo ); // check error code?
-            //this->ModifiedTimeDate = fileInfo.st_mtime;
-
-            // maybe add some CRC64 here too? that would require reading contents of every file and every dependency which would be costly! 
-            WIN32_FILE_ATTRIBUTE_DATA attrInfo;
-            ::GetFileAttributesEx( fullFileName.c_str( ), GetFileExInfoStandard, &attrInfo );
-            this->ModifiedTimeDate = ( ( (int64)attrInfo.ftLastWriteTime.dwHighDateTime ) << 32 ) | ( (int64)attrInfo.ftLastWriteTime.dwLowDateTime );
-        }
-    }
-    //
-    vaShaderCacheEntry11::FileDependencyInfo::FileDependencyInfo( const wstring & filePath, int64 modifiedTimeDate )
-    {
-        this->FilePath = filePath;
-        this->ModifiedTimeDate = modifiedTimeDate;
-    }
-    //
-    bool vaShaderCacheEntry11::FileDependencyInfo::IsModified( )
+    void vaDirectX11ShaderManager::AddToCache( vaShaderCacheKey & key, ID3DBlob * shaderBlob, std::vector<vaShaderFileDependency> & dependencies )
     {
-        wstring fullFileName = vaDirectX11ShaderManager::GetInstance( ).FindShaderFile( this->FilePath.c_str( ) );
-
-        //vaLog::GetInstance( ).Add( LOG_COLORS_SHADERS, (L"vaShaderCacheEntry11::FileDependencyInfo::IsModified, file name %s", fullFileName.c_str() ) );
-
-        if( fullFileName == L"" )  // Can't find the file?
-        {
-            vaFileTools::EmbeddedFileData embeddedData = vaFileTools::EmbeddedFilesFind( wstring( L"shaders:\\" ) + this->FilePath );
-
-            if( !embeddedData.HasContents( ) )
-            {
-                //vaLog::GetInstance( ).Add( LOG_COLORS_SHADERS, L"        > embedded data has NO contents" );
-#ifdef STILL_LOAD_FROM_CACHE_IF_ORIGINAL_FILE_MISSING
-                return false;
+#ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
+        m_cacheStore.Add( key, dependencies, shaderBlob->GetBufferPointer( ), (int64)shaderBlob->GetBufferSize( ) );
 #else
-                VA_ERROR( L"Error trying to find shader file '%s'!", this->FilePath.c_str( ) );
-                return true;
+        key; shaderBlob; dependencies;
 #endif
-            }
-            else
-            {
-                //vaLog::GetInstance( ).Add( LOG_COLORS_SHADERS,  L"        > embedded data has contents" );
-                return this->ModifiedTimeDate != embeddedData.TimeStamp;
-            }
-        }
-
-        // struct _stat64 fileInfo;
-        // _wstat64( fullFileName.c_str( ), &fileInfo ); // check error code?
-        // return this->ModifiedTimeDate != fileInfo.st_mtime;
-
-        // maybe add some CRC64 here too? that would require reading contents of every file and every dependency which would be costly! 
-        WIN32_FILE_ATTRIBUTE_DATA attrInfo;
-        ::GetFileAttributesEx( fullFileName.c_str( ), GetFileExInfoStandard, &attrInfo );
-        bool ret = this->ModifiedTimeDate != ( ( ( (int64)attrInfo.ftLastWriteTime.dwHighDateTime ) << 32 ) | ( (int64)attrInfo.ftLastWriteTime.dwLowDateTime ) );
-
-        // if( ret )
-        // {
-        //     vaLog::GetInstance( ).Add( LOG_COLORS_SHADERS,  (const wchar_t*)((ret)?(L"   > shader file '%s' modified "):(L"   > shader file '%s' NOT modified ")), fullFileName.c_str() );
-        // }
-
-        return ret;
-    }
-    //
-    vaShaderCacheEntry11::vaShaderCacheEntry11( ID3DBlob * compiledShader, std::vector<vaShaderCacheEntry11::FileDependencyInfo> & dependencies )
-    {
-        m_compiledShader = compiledShader;
-        m_compiledShader->AddRef( );
-
-        m_dependencies = dependencies;
-    }
-    //
-    vaShaderCacheEntry11::~vaShaderCacheEntry11( )
-    {
-        m_compiledShader->Release( );
-    }
-    //
-    bool vaShaderCacheEntry11::IsModified( )
-    {
-        for( std::vector<vaShaderCacheEntry11::FileDependencyInfo>::iterator it = m_dependencies.begin( ); it != m_dependencies.end( ); ++it )
-        {
-            if( ( *it ).IsModified( ) )
-                return true;
-        }
-        return false;
-    }
-    //
-    void vaShaderCacheKey11::Save( vaStream & outStream ) const
-    {
-        outStream.WriteString( this->StringPart.c_str( ) );
-    }
-    //
-    void vaShaderCacheEntry11::FileDependencyInfo::Save( vaStream & outStream ) const
-    {
-        outStream.WriteString( this->FilePath.c_str( ) );
-        outStream.WriteValue<int64>( this->ModifiedTimeDate );
-    }
-    //
-    void vaShaderCacheEntry11::Save( vaStream & outStream ) const
-    {
-        outStream.WriteValue<int32>( ( int32 )this->m_dependencies.size( ) );       // number of dependencies
-
-        for( std::vector<vaShaderCacheEntry11::FileDependencyInfo>::const_iterator it = m_dependencies.cbegin( ); it != m_dependencies.cend( ); ++it )
-        {
-            ( *it ).Save( outStream );
-        }
-
-        int bufferSize = (int)m_compiledShader->GetBufferSize( );
-
-        outStream.WriteValue<int32>( bufferSize );
-        outStream.Write( m_compiledShader->GetBufferPointer( ), bufferSize );
-    }
-    //
-    void vaShaderCacheKey11::Load( vaStream & inStream )
-    {
-        inStream.ReadString( this->StringPart );
-    }
-    //
-    void vaShaderCacheEntry11::FileDependencyInfo::Load( vaStream & inStream )
-    {
-        inStream.ReadString( this->FilePath );
-        inStream.ReadValue<int64>( this->ModifiedTimeDate );
-    }
-    //
-    void vaShaderCacheEntry11::Load( vaStream & inStream )
-    {
-        int dependencyCount;
-        inStream.ReadValue<int32>( dependencyCount );
-
-        for( int i = 0; i < dependencyCount; i++ )
-        {
-            m_dependencies.push_back( vaShaderCacheEntry11::FileDependencyInfo( inStream ) );
-        }
-
-        int bufferSize;
-        inStream.ReadValue<int32>( bufferSize );
-
-        D3DCreateBlob( bufferSize, &m_compiledShader );
-        inStream.Read( m_compiledShader->GetBufferPointer( ), bufferSize );
     }
 }
 
@@ -24,8 +24,6 @@
 
 namespace Vanilla
 {
-    struct vaShaderCacheKey11;
-    class vaShaderCacheEntry11;
 
     class vaShaderDX11 : public virtual vaShader
     {
@@ -43,7 +41,7 @@ namespace Vanilla
         virtual bool                    IsCreated( ) override { std::unique_lock<mutex> allShaderDataLock( m_allShaderDataMutex, std::try_to_lock ); return allShaderDataLock.owns_lock() && m_shader != nullptr; }
         //
     protected:
-        virtual void                    CreateCacheKey( vaShaderCacheKey11 & outKey );
+        virtual void                    CreateCacheKey( vaShaderCacheKey & outKey );
         //
     protected:
         //
@@ -214,63 +212,12 @@ namespace Vanilla
         virtual void                CreateShader( ) override;
         virtual void                DestroyShader( ) override;
 
-        virtual void                CreateCacheKey( vaShaderCacheKey11 & outKey );
+        virtual void                CreateCacheKey( vaShaderCacheKey & outKey );
     };
 
 
 #pragma warning ( pop )
 
-    struct vaShaderCacheKey11
-    {
-        std::string                StringPart;
-
-        bool                       operator == ( const vaShaderCacheKey11 & cmp ) const { return this->StringPart == cmp.StringPart; }
-        bool                       operator < ( const vaShaderCacheKey11 & cmp ) const { return this->StringPart < cmp.StringPart; }
-        bool                       operator >( const vaShaderCacheKey11 & cmp ) const { return this->StringPart > cmp.StringPart; }
-
-        void                       Save( vaStream & outStream ) const;
-        void                       Load( vaStream & inStream );
-    };
-
-    class vaShaderCacheEntry11
-    {
-    public:
-        struct FileDependencyInfo
-        {
-            std::wstring            FilePath;
-            int64                   ModifiedTimeDate;
-
-            FileDependencyInfo( ) : FilePath( L"" ), ModifiedTimeDate( 0 ) { }
-            FileDependencyInfo( const wstring & filePath );
-            FileDependencyInfo( const wstring & filePath, int64 modifiedTimeDate );
-            FileDependencyInfo( vaStream & inStream ) { Load( inStream ); }
-
-            bool                    IsModified( );
-
-            void                    Save( vaStream & outStream ) const;
-            void                    Load( vaStream & inStream );
-        };
-
-    private:
-
-        ID3DBlob *                                               m_compiledShader;
-        std::vector<vaShaderCacheEntry11::FileDependencyInfo>      m_dependencies;
-
-    private:
-        vaShaderCacheEntry11( ) {}
-        explicit vaShaderCacheEntry11( const vaShaderCacheEntry11 & copy ) { copy; }
-    public:
-        vaShaderCacheEntry11( ID3DBlob * compiledShader, std::vector<vaShaderCacheEntry11::FileDependencyInfo> & dependencies );
-        explicit vaShaderCacheEntry11( vaStream & inFile ) { m_compiledShader = NULL; Load( inFile ); }
-        ~vaShaderCacheEntry11( );
-
-        bool                       IsModified( );
-        ID3DBlob *                 GetCompiledShader( ) { m_compiledShader->AddRef( ); return m_compiledShader; }
-
-        void                       Save( vaStream & outStream ) const;
-        void                       Load( vaStream & inStream );
-    };
-
     // Singleton utility class for handling shaders
     class vaDirectX11ShaderManager : public vaShaderManager, public vaSingletonBase < vaDirectX11ShaderManager > // oooo I feel so dirty here but oh well
     {
@@ -280,15 +227,10 @@ namespace Vanilla
         friend class vaShaderDX11;
 
     private:
-        std::map<vaShaderCacheKey11, vaShaderCacheEntry11 *>    m_cache;
-        mutable mutex                                       m_cacheMutex;
 #ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
         wstring                                             m_cacheFilePath;
-
-        // since cache loading from the disk happens only once, use this to ensure loading proc has grabbed m_cacheMutex - once it's unlocked we know it finished
-        std::atomic_bool                                    m_cacheLoadStarted = false;
-        std::mutex                                          m_cacheLoadStartedMutex;
-        std::condition_variable                             m_cacheLoadStartedCV;
+        vaShaderCacheStore                                  m_cacheStore;
+        shared_ptr<vaBackgroundTaskManager::Task>           m_cacheCompactionTask;
 #endif
 
         shared_ptr<int>                                     m_objLifetimeToken;
@@ -298,19 +240,14 @@ namespace Vanilla
         ~vaDirectX11ShaderManager( );
 
     public:
-        ID3DBlob *          FindInCache( vaShaderCacheKey11 & key, bool & foundButModified );
-        void                AddToCache( vaShaderCacheKey11 & key, ID3DBlob * shaderBlob, std::vector<vaShaderCacheEntry11::FileDependencyInfo> & dependencies );
+        ID3DBlob *          FindInCache( vaShaderCacheKey & key, bool & foundButModified );
+        void                AddToCache( vaShaderCacheKey & key, ID3DBlob * shaderBlob, std::vector<vaShaderFileDependency> & dependencies );
         void                ClearCache( );
 
         // pushBack (searched last) or pushFront (searched first)
         virtual void        RegisterShaderSearchPath( const std::wstring & path, bool pushBack = true )     override;
         virtual wstring     FindShaderFile( const wstring & fileName )                                      override;
         virtual wstring     GetCacheStoragePath( ) const override                                           { return m_cacheFilePath; }
-
-    private:
-        void                ClearCacheInternal( );          // will not lock m_cacheMutex - has to be done before calling!!
-        void                LoadCacheInternal( );           // will not lock m_cacheMutex - has to be done before calling!!
-        void                SaveCacheInternal( ) const;     // will not lock m_cacheMutex - has to be done before calling!!
     };
 
 }
\ No newline at end of file
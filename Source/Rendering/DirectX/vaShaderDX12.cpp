@@ -82,10 +82,6 @@ HRESULT DoBasicQueryInterface( TObject* self, REFIID iid, void** ppvObject ) {
 
 using namespace Vanilla;
 
-#ifdef NDEBUG
-#define           STILL_LOAD_FROM_CACHE_IF_ORIGINAL_FILE_MISSING
-#endif
-
 using namespace std;
 
 namespace Vanilla
@@ -104,7 +100,7 @@ namespace Vanilla
 
     class vaShaderIncludeHelper12 : public IDxcIncludeHandler// ID3DInclude
     {
-        std::vector<vaShaderCacheEntry12::FileDependencyInfo> &     m_dependenciesCollector;
+        std::vector<vaShaderFileDependency> &                       m_dependenciesCollector;
 
         std::vector< std::pair<string, string> >                    m_foundNamePairs;
 
@@ -132,7 +128,7 @@ namespace Vanilla
         }
         ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     public:
-        vaShaderIncludeHelper12( std::vector<vaShaderCacheEntry12::FileDependencyInfo> & dependenciesCollector, const wstring & relativePath, const string & macrosAsIncludeFile ) 
+        vaShaderIncludeHelper12( std::vector<vaShaderFileDependency> & dependenciesCollector, const wstring & relativePath, const string & macrosAsIncludeFile ) 
             : m_dwRef(1), m_dependenciesCollector( dependenciesCollector ), m_relativePath( relativePath ), m_macrosAsIncludeFile( macrosAsIncludeFile )
         {
         }
@@ -163,7 +159,7 @@ namespace Vanilla
                 }
             }
 
-            vaShaderCacheEntry12::FileDependencyInfo fileDependencyInfo;
+            vaShaderFileDependency fileDependencyInfo;
             std::shared_ptr<vaMemoryStream>        memBuffer;
 
             wstring fileNameR = m_relativePath + wstring( inFileName );
@@ -175,7 +171,7 @@ namespace Vanilla
                 fullFileName = vaDirectX12ShaderManager::GetInstance( ).FindShaderFile( fileNameA.c_str( ) );
             if( fullFileName != L"" )
             {
-                fileDependencyInfo = vaShaderCacheEntry12::FileDependencyInfo( fullFileName.c_str( ) );
+                fileDependencyInfo = vaDirectX12ShaderManager::GetInstance( ).MakeFileDependency( fullFileName );
                 memBuffer = vaFileTools::LoadFileToMemoryStream( fullFileName.c_str( ) );
             }
             else
@@ -194,7 +190,7 @@ namespace Vanilla
                     vaCore::Error( L"Error trying to find shader file '%s' / '%s'!", fileNameR.c_str( ), fileNameA.c_str( ) );
                     return E_FAIL;
                 }
-                fileDependencyInfo = vaShaderCacheEntry12::FileDependencyInfo( foundName, embeddedData.TimeStamp );
+                fileDependencyInfo = vaShaderFileDependency( foundName, embeddedData.TimeStamp );
                 memBuffer = embeddedData.MemStream;
             }
 
@@ -320,7 +316,7 @@ namespace Vanilla
         }
     }
     //
-    void vaShaderDX12::CreateCacheKey( vaShaderCacheKey12 & outKey )
+    void vaShaderDX12::CreateCacheKey( vaShaderCacheKey & outKey )
     {
         m_allShaderDataMutex.assert_locked_by_caller();
 
@@ -339,7 +335,7 @@ namespace Vanilla
         outKey.StringPart += vaStringTools::ToLower( vaStringTools::SimpleNarrow( m_shaderFilePath ) ) + " ";
     }
     //
-    void vaVertexShaderDX12::CreateCacheKey( vaShaderCacheKey12 & outKey )
+    void vaVertexShaderDX12::CreateCacheKey( vaShaderCacheKey & outKey )
     {
         m_allShaderDataMutex.assert_locked_by_caller();
 
@@ -530,7 +526,7 @@ namespace Vanilla
     }    
     //
     static HRESULT CompileShaderFromFile( const wchar_t* szFileName, const string & macrosAsIncludeFile, LPCSTR szEntryPoint,
-        LPCSTR szShaderModel, IDxcBlob** ppBlobOut, vector<vaShaderCacheEntry12::FileDependencyInfo> & outDependencies, string & outErrorInfo )
+        LPCSTR szShaderModel, IDxcBlob** ppBlobOut, vector<vaShaderFileDependency> & outDependencies, string & outErrorInfo )
     {
         outDependencies.clear( );
 
@@ -542,7 +538,7 @@ namespace Vanilla
 
         if( fullFileName != L"" )
         {
-            outDependencies.push_back( vaShaderCacheEntry12::FileDependencyInfo( szFileName ) );
+            outDependencies.push_back( vaDirectX12ShaderManager::GetInstance( ).MakeFileDependency( szFileName ) );
             
             std::shared_ptr<vaMemoryStream> memBuffer = vaFileTools::LoadFileToMemoryStream( fullFileName.c_str( ) );
             ansiName = vaStringTools::SimpleNarrow( fullFileName );
@@ -565,7 +561,7 @@ namespace Vanilla
                 return E_FAIL;
             }
 
-            outDependencies.push_back( vaShaderCacheEntry12::FileDependencyInfo( szFileName, embeddedData.TimeStamp ) );
+            outDependencies.push_back( vaShaderFileDependency( szFileName, embeddedData.TimeStamp ) );
 
             wstring relativePath;
             vaFileTools::SplitPath( szFileName, &relativePath, nullptr, nullptr );
@@ -602,7 +598,7 @@ namespace Vanilla
 
         if( m_shaderFilePath.size( ) != 0 )
         {
-            vaShaderCacheKey12 cacheKey;
+            vaShaderCacheKey cacheKey;
             CreateCacheKey( cacheKey );
 
 #ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
@@ -626,7 +622,7 @@ namespace Vanilla
 
             if( shaderBlob == nullptr )
             {
-                vector<vaShaderCacheEntry12::FileDependencyInfo> dependencies;
+                vector<vaShaderFileDependency> dependencies;
 
                 CompileShaderFromFile( m_shaderFilePath.c_str( ), macrosAsIncludeFile, m_entryPoint.c_str( ), m_shaderModel.c_str( ), &shaderBlob, dependencies, m_lastError );
 
@@ -643,7 +639,7 @@ namespace Vanilla
         }
         else if( m_shaderCode.size( ) != 0 )
         {
-            vector<vaShaderCacheEntry12::FileDependencyInfo> unusedDependencies;
+            vector<vaShaderFileDependency> unusedDependencies;
             vaShaderIncludeHelper12 includeHelper( unusedDependencies, L"", macrosAsIncludeFile );
 
             CompileShaderFromBuffer( m_shaderCode.c_str( ), m_shaderCode.size( ), "EmbeddedInCodebase", m_entryPoint.c_str( ), m_shaderModel.c_str( ), &shaderBlob, m_lastError, includeHelper );
@@ -683,7 +679,7 @@ namespace Vanilla
                 {
                     wstring fileName = vaCore::GetWorkingDirectory( );
 
-                    vaShaderCacheKey12 cacheKey;
+                    vaShaderCacheKey cacheKey;
                     CreateCacheKey( cacheKey );
                     // vaCRC64 crc;
                     // crc.AddString( cacheKey.StringPart );
@@ -853,11 +849,8 @@ namespace Vanilla
         assert( GetRenderDevice( ).IsRenderThread( ) );
 
 #ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
-        // start loading the cache before initializing anything else as it will continue in background - faster startup!
+        // cache files live next to the executable
         {
-            // lock here just in case we put something after the loading task 
-            std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );
-
             // this should maybe be set externally, but good enough for now
             m_cacheFilePath = vaCore::GetExecutableDirectory( ) + L".cache\\";
 
@@ -869,7 +862,16 @@ namespace Vanilla
 #endif
         }
 
-        LoadCacheInternal();
+        // the cache used to be a single file with everything in it - not used anymore
+        if( vaFileTools::FileExists( m_cacheFilePath ) )
+            vaFileTools::DeleteFile( m_cacheFilePath );
+
+        // this only maps the index, entries get loaded on first use so startup doesn't depend on the size of the cache
+        if( m_cacheStore.Open( m_cacheFilePath ) && m_cacheStore.NeedsCompaction( ) )
+        {
+            m_cacheCompactionTask = vaBackgroundTaskManager::GetInstance( ).Spawn( "Compacting Shader Cache", vaBackgroundTaskManager::SpawnFlags::None, 
+                [this]( vaBackgroundTaskManager::TaskContext & ) { return m_cacheStore.Compact( ); } );
+        }
 #endif // VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
 
         wstring compilerPath = vaCore::GetExecutableDirectory() + L"CustomDXC\\";
@@ -909,12 +911,10 @@ namespace Vanilla
         assert( GetRenderDevice().IsRenderThread() );
 
 #ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
-        {
-            std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );    // this is also needed to make sure loading finished!
-            SaveCacheInternal( );
-        }
+        if( m_cacheCompactionTask != nullptr )
+            vaBackgroundTaskManager::GetInstance( ).WaitUntilFinished( m_cacheCompactionTask );
+        m_cacheStore.Close( );
 #endif
-        ClearCache( );
 
         // Ensure no shaders remain
         {
@@ -969,341 +969,39 @@ namespace Vanilla
         return L"";
     }
     //
-    void vaDirectX12ShaderManager::LoadCacheInternal( )
-    {
-        auto loadingLambda = [this]( vaBackgroundTaskManager::TaskContext & context ) 
-        {
-            vaSimpleScopeTimerLog log( "Loading DirectX12 shader cache" );
-
-            // lock here just in case we put something after the loading task 
-            std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );
-
-            {
-                std::unique_lock<std::mutex> cacheLoadStartedMutexLock( m_cacheLoadStartedMutex );
-                m_cacheLoadStarted = true;
-            }
-            m_cacheLoadStartedCV.notify_all();
-
-            wstring fullFileName = m_cacheFilePath;
-
-            if( fullFileName == L"" )
-                return false;
-
-            if( !vaFileTools::FileExists( fullFileName ) )
-                return false;
-
-            ClearCacheInternal( );
-
-            vaFileStream inFile;
-            if( inFile.Open( fullFileName.c_str( ), FileCreationMode::Open, FileAccessMode::Read ) )
-            {
-                int version = -1;
-                inFile.ReadValue<int32>( version );
-
-                if( version == 1 )
-                {
-                    assert( version == 1 );
-
-                    int32 entryCount = 0;
-                    inFile.ReadValue<int32>( entryCount );
-
-                    for( int i = 0; i < entryCount; i++ )
-                    {
-                        context.Progress = float(i)/float(entryCount-1);
-
-                        vaShaderCacheKey12 key;
-                        key.Load( inFile );
-                        vaShaderCacheEntry12 * entry = new vaShaderCacheEntry12( inFile );
-
-                        m_cache.insert( std::pair<vaShaderCacheKey12, vaShaderCacheEntry12 *>( key, entry ) );
-                    }
-
-                    int32 terminator;
-                    inFile.ReadValue<int32>( terminator );
-                    assert( terminator == 0xFF );
-                }
-                else
-                {
-                    VA_WARN( "Shader cache version upgraded, cannot use old cache, resetting and starting from scratch!" );
-                }
-            }
-            return true;
-        };
-
-        bool multithreaded = true;
-        if( multithreaded )
-        {
-            vaBackgroundTaskManager::GetInstance().Spawn( "Loading Shader Cache", vaBackgroundTaskManager::SpawnFlags::ShowInUI, loadingLambda );
-            
-            // make sure we've started and taken the thread
-            {
-                std::unique_lock<std::mutex> lk(m_cacheLoadStartedMutex);
-                m_cacheLoadStartedCV.wait(lk, [this] { return (bool)m_cacheLoadStarted; } );
-            }
-        }
-        else
-        {
-            loadingLambda( vaBackgroundTaskManager::TaskContext() );
-        }
-    }
-    //
-    void vaDirectX12ShaderManager::SaveCacheInternal( ) const
-    {
-        vaSimpleScopeTimerLog log( "Saving DirectX12 shader cache" );
-
-        // must already be locked by this point!
-        // std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );
-        m_cacheMutex.assert_locked_by_caller();
-
-        wstring fullFileName = m_cacheFilePath;
-
-        wstring cacheDir;
-        vaFileTools::SplitPath( fullFileName, &cacheDir, nullptr, nullptr );
-        vaFileTools::EnsureDirectoryExists( cacheDir.c_str( ) );
-
-        vaFileStream outFile;
-        outFile.Open( fullFileName.c_str( ), FileCreationMode::Create );
-
-        outFile.WriteValue<int32>( 1 );                 // version;
-
-        outFile.WriteValue<int32>( (int32)m_cache.size( ) );    // number of entries
-
-        for( std::map<vaShaderCacheKey12, vaShaderCacheEntry12 *>::const_iterator it = m_cache.cbegin( ); it != m_cache.cend( ); ++it )
-        {
-            // Save key
-            ( *it ).first.Save( outFile );
-
-            // Save data
-            ( *it ).second->Save( outFile );
-        }
-
-        outFile.WriteValue<int32>( 0xFF );  // EOF;
-    }
-    //
-    void vaDirectX12ShaderManager::ClearCacheInternal( )
-    {
-        m_cacheMutex.assert_locked_by_caller();
-        for( std::map<vaShaderCacheKey12, vaShaderCacheEntry12 *>::iterator it = m_cache.begin( ); it != m_cache.end( ); ++it )
-        {
-            delete ( *it ).second;;
-        }
-        m_cache.clear( );
-    }
-    //
     void vaDirectX12ShaderManager::ClearCache( )
     {
-        std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );
-        ClearCacheInternal();
+#ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
+        m_cacheStore.Clear( );
+#endif
     }
     //
-    ID3DBlob* vaDirectX12ShaderManager::FindInCache( vaShaderCacheKey12& key, bool& foundButModified )
+    ID3DBlob * vaDirectX12ShaderManager::FindInCache( vaShaderCacheKey & key, bool & foundButModified )
     {
-        std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );
-
         foundButModified = false;
+#ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
+        auto entry = m_cacheStore.Find( key, [this]( const wstring & filePath, int64 & outTimeStamp ) { return GetShaderFileTimeStamp( filePath, outTimeStamp ); }, foundButModified );
+        if( entry == nullptr )
+            return nullptr;
 
-        std::map<vaShaderCacheKey12, vaShaderCacheEntry12 *>::iterator it = m_cache.find( key );
-
-        if( it != m_cache.end( ) )
-        {
-            if( ( *it ).second->IsModified( ) )
-            {
-                foundButModified = true;
-
-                // Have to recompile...
-                delete ( *it ).second;
-                m_cache.erase( it );
-
-                return nullptr;
-            }
-
-            return ( *it ).second->GetCompiledShader( );
-        }
-        return nullptr;
-    }
-    //
-    void vaDirectX12ShaderManager::AddToCache( vaShaderCacheKey12 & key, ID3DBlob * shaderBlob, std::vector<vaShaderCacheEntry12::FileDependencyInfo> & dependencies )
-    {
-        std::unique_lock<mutex> cacheMutexLock( m_cacheMutex );
-
-        std::map<vaShaderCacheKey12, vaShaderCacheEntry12 *>::iterator it = m_cache.find( key );
-
-        if( it != m_cache.end( ) )
-        {
-            // Already in? can happen with parallel compilation I guess?
-            // well let's just not do anything then
-            return;
-            // delete ( *it ).second;
-            // m_cache.erase( it );
-        }
-
-        m_cache.insert( std::pair<vaShaderCacheKey12, vaShaderCacheEntry12 *>( key, new vaShaderCacheEntry12( shaderBlob, dependencies ) ) );
-    }
-    //
-    vaShaderCacheEntry12::FileDependencyInfo::FileDependencyInfo( const wstring & filePath )
-    {
-        wstring fullFileName = vaDirectX12ShaderManager::GetInstance( ).FindShaderFile( filePath );
-
-        if( fullFileName == L"" )
-        {
-            VA_ERROR( L"Error trying to find shader file '%s'!", filePath.c_str() );
-
-            assert( false );
-            this->FilePath = L"";
-            this->ModifiedTimeDate = 0;
-        }
-        else
-        {
-            this->FilePath = filePath;
-
-            // struct _stat64 fileInfo;
-            // _wstat64( fullFileName.c_str( ), &fileInfo ); // check error code?
-            //this->ModifiedTimeDate = fileInfo.st_mtime;
-
-            // maybe add some CRC64 here too? that would require reading contents of every file and every dependency which would be costly! 
-            WIN32_FILE_ATTRIBUTE_DATA attrInfo;
-            ::GetFileAttributesEx( fullFileName.c_str( ), GetFileExInfoStandard, &attrInfo );
-            this->ModifiedTimeDate = ( ( (int64)attrInfo.ftLastWriteTime.dwHighDateTime ) << 32 ) | ( (int64)attrInfo.ftLastWriteTime.dwLowDateTime );
-        }
-    }
-    //
-    vaShaderCacheEntry12::FileDependencyInfo::FileDependencyInfo( const wstring & filePath, int64 modifiedTimeDate )
-    {
-        this->FilePath = filePath;
-        this->ModifiedTimeDate = modifiedTimeDate;
-    }
-    //
-    bool vaShaderCacheEntry12::FileDependencyInfo::IsModified( )
-    {
-        wstring fullFileName = vaDirectX12ShaderManager::GetInstance( ).FindShaderFile( this->FilePath.c_str( ) );
-
-        //vaLog::GetInstance( ).Add( LOG_COLORS_SHADERS, (L"vaShaderCacheEntry12::FileDependencyInfo::IsModified, file name %s", fullFileName.c_str() ) );
-
-        if( fullFileName == L"" )  // Can't find the file?
-        {
-            vaFileTools::EmbeddedFileData embeddedData = vaFileTools::EmbeddedFilesFind( wstring( L"shaders:\\" ) + this->FilePath );
-
-            if( !embeddedData.HasContents( ) )
-            {
-                //vaLog::GetInstance( ).Add( LOG_COLORS_SHADERS, L"        > embedded data has NO contents" );
-#ifdef STILL_LOAD_FROM_CACHE_IF_ORIGINAL_FILE_MISSING
-                return false;
+        // grrmpf - IDxcBlob is an alias of ID3DBlob; if you want to be safe and just use the IDxcBlob then CreateBlobWithEncodingOnHeapCopy is the way, but it's slower
+        ID3DBlob * shaderBlob = nullptr;
+        if( FAILED( D3DCreateBlob( entry->Blob.size( ), &shaderBlob ) ) )
+            return nullptr;
+        memcpy( shaderBlob->GetBufferPointer( ), entry->Blob.data( ), entry->Blob.size( ) );
+        return shaderBlob;
 #else
-                VA_ERROR( L"Error trying to find shader file '%s'!", this->FilePath.c_str( ) );
-                return true;
+        key;
+        return nullptr;
 #endif
-            }
-            else
-            {
-                //vaLog::GetInstance( ).Add( LOG_COLORS_SHADERS,  L"        > embedded data has contents" );
-                return this->ModifiedTimeDate != embeddedData.TimeStamp;
-            }
-        }
-
-        // struct _stat64 fileInfo;
-        // _wstat64( fullFileName.c_str( ), &fileInfo ); // check error code?
-        // return this->ModifiedTimeDate != fileInfo.st_mtime;
-
-        // maybe add some CRC64 here too? that would require reading contents of every file and every dependency which would be costly! 
-        WIN32_FILE_ATTRIBUTE_DATA attrInfo;
-        ::GetFileAttributesEx( fullFileName.c_str( ), GetFileExInfoStandard, &attrInfo );
-        bool ret = this->ModifiedTimeDate != ( ( ( (int64)attrInfo.ftLastWriteTime.dwHighDateTime ) << 32 ) | ( (int64)attrInfo.ftLastWriteTime.dwLowDateTime ) );
-
-        // if( ret )
-        // {
-        //     vaLog::GetInstance( ).Add( LOG_COLORS_SHADERS,  (const wchar_t*)((ret)?(L"   > shader file '%s' modified "):(L"   > shader file '%s' NOT modified ")), fullFileName.c_str() );
-        // }
-
-        return ret;
     }
     //
-    vaShaderCacheEntry12::vaShaderCacheEntry12( ID3DBlob * compiledShader, std::vector<vaShaderCacheEntry12::FileDependencyInfo> & dependencies )
+    void vaDirectX12ShaderManager::AddToCache( vaShaderCacheKey & key, ID3DBlob * shaderBlob, std::vector<vaShaderFileDependency> & dependencies )
     {
-        m_compiledShader = compiledShader;
-        m_compiledShader->AddRef( );
-
-        m_dependencies = dependencies;
-    }
-    //
-    vaShaderCacheEntry12::~vaShaderCacheEntry12( )
-    {
-        m_compiledShader->Release( );
-    }
-    //
-    bool vaShaderCacheEntry12::IsModified( )
-    {
-        for( std::vector<vaShaderCacheEntry12::FileDependencyInfo>::iterator it = m_dependencies.begin( ); it != m_dependencies.end( ); ++it )
-        {
-            if( ( *it ).IsModified( ) )
-                return true;
-        }
-        return false;
-    }
-    //
-    void vaShaderCacheKey12::Save( vaStream & outStream ) const
-    {
-        outStream.WriteString( this->StringPart.c_str( ) );
-    }
-    //
-    void vaShaderCacheEntry12::FileDependencyInfo::Save( vaStream & outStream ) const
-    {
-        outStream.WriteString( this->FilePath.c_str( ) );
-        outStream.WriteValue<int64>( this->ModifiedTimeDate );
-    }
-    //
-    void vaShaderCacheEntry12::Save( vaStream & outStream ) const
-    {
-        outStream.WriteValue<int32>( ( int32 )this->m_dependencies.size( ) );       // number of dependencies
-
-        for( std::vector<vaShaderCacheEntry12::FileDependencyInfo>::const_iterator it = m_dependencies.cbegin( ); it != m_dependencies.cend( ); ++it )
-        {
-            ( *it ).Save( outStream );
-        }
-
-        int bufferSize = (int)m_compiledShader->GetBufferSize( );
-
-        outStream.WriteValue<int32>( bufferSize );
-        outStream.Write( m_compiledShader->GetBufferPointer( ), bufferSize );
-    }
-    //
-    void vaShaderCacheKey12::Load( vaStream & inStream )
-    {
-        inStream.ReadString( this->StringPart );
-    }
-    //
-    void vaShaderCacheEntry12::FileDependencyInfo::Load( vaStream & inStream )
-    {
-        inStream.ReadString( this->FilePath );
-        inStream.ReadValue<int64>( this->ModifiedTimeDate );
-    }
-    //
-    void vaShaderCacheEntry12::Load( vaStream & inStream )
-    {
-        int dependencyCount;
-        inStream.ReadValue<int32>( dependencyCount );
-
-        for( int i = 0; i < dependencyCount; i++ )
-        {
-            m_dependencies.push_back( vaShaderCacheEntry12::FileDependencyInfo( inStream ) );
-        }
-
-        int bufferSize;
-        inStream.ReadValue<int32>( bufferSize );
-
-        assert( m_compiledShader == nullptr );
-        SAFE_RELEASE( m_compiledShader );
-
-#if 0   // grrmpf - IDxcBlob is an alias of ID3DBlob but if you want to be safe and just use the IDxcBlob then you have to do what's below, which is slower
-        byte* buffer = new byte[bufferSize];
-        inStream.Read( buffer, bufferSize );
-        ComPtr<IDxcBlobEncoding> blobSource;
-        HRESULT hr = s_dxcLibrary->CreateBlobWithEncodingOnHeapCopy( buffer, bufferSize, CP_UTF8, blobSource.GetAddressOf( ) );
-        blobSource->AddRef( );
-        m_compiledShader = blobSource.Get( );
-        assert( SUCCEEDED( hr ) );
+#ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
+        m_cacheStore.Add( key, dependencies, shaderBlob->GetBufferPointer( ), (int64)shaderBlob->GetBufferSize( ) );
 #else
-        D3DCreateBlob( bufferSize, (ID3DBlob**)&m_compiledShader );
-        inStream.Read( m_compiledShader->GetBufferPointer( ), bufferSize );
+        key; shaderBlob; dependencies;
 #endif
     }
 }
@@ -24,8 +24,6 @@
 
 namespace Vanilla
 {
-    struct vaShaderCacheKey12;
-    class vaShaderCacheEntry12;
 
     class vaShaderDX12 : public virtual vaShader
     {
@@ -45,7 +43,7 @@ namespace Vanilla
         vaShader::State                 GetShader( ComPtr<ID3DBlob> & outBlob, int64 & outUniqueContentsID );
         //
     protected:
-        virtual void                    CreateCacheKey( vaShaderCacheKey12 & outKey );
+        virtual void                    CreateCacheKey( vaShaderCacheKey & outKey );
         //
     protected:
         //
@@ -128,62 +126,11 @@ namespace Vanilla
         virtual void                CreateShader( ) override;
         virtual void                DestroyShader( ) override;
 
-        virtual void                CreateCacheKey( vaShaderCacheKey12 & outKey );
+        virtual void                CreateCacheKey( vaShaderCacheKey & outKey );
     };
 
 #pragma warning ( pop )
 
-    struct vaShaderCacheKey12
-    {
-        std::string                StringPart;
-
-        bool                       operator == ( const vaShaderCacheKey12 & cmp ) const { return this->StringPart == cmp.StringPart; }
-        bool                       operator < ( const vaShaderCacheKey12 & cmp ) const { return this->StringPart < cmp.StringPart; }
-        bool                       operator >( const vaShaderCacheKey12 & cmp ) const { return this->StringPart > cmp.StringPart; }
-
-        void                       Save( vaStream & outStream ) const;
-        void                       Load( vaStream & inStream );
-    };
-
-    class vaShaderCacheEntry12
-    {
-    public:
-        struct FileDependencyInfo
-        {
-            std::wstring            FilePath;
-            int64                   ModifiedTimeDate;
-
-            FileDependencyInfo( ) : FilePath( L"" ), ModifiedTimeDate( 0 ) { }
-            FileDependencyInfo( const wstring & filePath );
-            FileDependencyInfo( const wstring & filePath, int64 modifiedTimeDate );
-            FileDependencyInfo( vaStream & inStream ) { Load( inStream ); }
-
-            bool                    IsModified( );
-
-            void                    Save( vaStream & outStream ) const;
-            void                    Load( vaStream & inStream );
-        };
-
-    private:
-
-        ID3DBlob *                                               m_compiledShader;
-        std::vector<vaShaderCacheEntry12::FileDependencyInfo>      m_dependencies;
-
-    private:
-        vaShaderCacheEntry12( ) {}
-        explicit vaShaderCacheEntry12( const vaShaderCacheEntry12 & copy ) { copy; }
-    public:
-        vaShaderCacheEntry12( ID3DBlob * compiledShader, std::vector<vaShaderCacheEntry12::FileDependencyInfo> & dependencies );
-        explicit vaShaderCacheEntry12( vaStream & inFile ) { m_compiledShader = NULL; Load( inFile ); }
-        ~vaShaderCacheEntry12( );
-
-        bool                       IsModified( );
-        ID3DBlob *                 GetCompiledShader( ) { m_compiledShader->AddRef( ); return m_compiledShader; }
-
-        void                       Save( vaStream & outStream ) const;
-        void                       Load( vaStream & inStream );
-    };
-
     // Singleton utility class for handling shaders
     class vaDirectX12ShaderManager : public vaShaderManager, public vaSingletonBase < vaDirectX12ShaderManager > // oooo I feel so dirty here but oh well
     {
@@ -193,15 +140,10 @@ namespace Vanilla
         friend class vaShaderDX12;
 
     private:
-        std::map<vaShaderCacheKey12, vaShaderCacheEntry12 *>    m_cache;
-        mutable mutex                                       m_cacheMutex;
 #ifdef VA_SHADER_CACHE_PERSISTENT_STORAGE_ENABLE
         wstring                                             m_cacheFilePath;
-
-        // since cache loading from the disk happens only once, use this to ensure loading proc has grabbed m_cacheMutex - once it's unlocked we know it finished
-        std::atomic_bool                                    m_cacheLoadStarted = false;
-        std::mutex                                          m_cacheLoadStartedMutex;
-        std::condition_variable                             m_cacheLoadStartedCV;
+        vaShaderCacheStore                                  m_cacheStore;
+        shared_ptr<vaBackgroundTaskManager::Task>           m_cacheCompactionTask;
 #endif
 
         shared_ptr<int>                                     m_objLifetimeToken;
@@ -211,19 +153,14 @@ namespace Vanilla
         ~vaDirectX12ShaderManager( );
 
     public:
-        ID3DBlob *                  FindInCache( vaShaderCacheKey12 & key, bool & foundButModified );
-        void                        AddToCache( vaShaderCacheKey12 & key, ID3DBlob * shaderBlob, std::vector<vaShaderCacheEntry12::FileDependencyInfo> & dependencies );
+        ID3DBlob *                  FindInCache( vaShaderCacheKey & key, bool & foundButModified );
+        void                        AddToCache( vaShaderCacheKey & key, ID3DBlob * shaderBlob, std::vector<vaShaderFileDependency> & dependencies );
         void                        ClearCache( );
 
         // pushBack (searched last) or pushFront (searched first)
         virtual void                RegisterShaderSearchPath( const std::wstring & path, bool pushBack = true )     override;
         virtual wstring             FindShaderFile( const wstring & fileName )                                      override;
         virtual wstring             GetCacheStoragePath( ) const override                                           { return m_cacheFilePath; }
-
-    private:
-        void                        ClearCacheInternal( );          // will not lock m_cacheMutex - has to be done before calling!!
-        void                        LoadCacheInternal( );           // will not lock m_cacheMutex - has to be done before calling!!
-        void                        SaveCacheInternal( ) const;     // will not lock m_cacheMutex - has to be done before calling!!
     };
 
     inline vaShader::State          vaShaderDX12::GetShader( ComPtr<ID3DBlob> & outBlob, int64 & outUniqueContentsID )
@@ -0,0 +1,302 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated 
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation 
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of 
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "vaTextureCompressionDX.h"
+
+#include "Rendering/vaRenderDevice.h"
+
+#include "Core/Misc/vaProfiler.h"
+
+// per-block encoders (DirectXTex internal header, but the functions are exported from the library all the same)
+#include "IntegratedExternals/DirectXTex/DirectXTex/BC.h"
+
+#include <algorithm>
+
+using namespace Vanilla;
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+    // block rows handed to a worker at a time; one BC7 row of a 4k texture is ~1k blocks which is plenty
+    static const int64      c_minBlockRowsPerChunk      = 1;
+
+    // how often (in block rows) the progress callback gets called
+    static const int64      c_progressReportInterval    = 16;
+
+    // unpacks one source row into XMVECTORs (x, y, z, w = r, g, b, a), 'count' pixels starting at 'src'
+    static void UnpackRow( DXGI_FORMAT format, const uint8 * src, int count, XMVECTOR * dst )
+    {
+        switch( format )
+        {
+        case( DXGI_FORMAT_R8G8B8A8_UNORM ):
+        case( DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ):
+            for( int i = 0; i < count; i++ )
+                dst[i] = XMLoadUByteN4( reinterpret_cast<const XMUBYTEN4 *>( src ) + i );
+            break;
+        case( DXGI_FORMAT_B8G8R8A8_UNORM ):
+        case( DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ):
+            for( int i = 0; i < count; i++ )
+                dst[i] = XMLoadColor( reinterpret_cast<const XMCOLOR *>( src ) + i );
+            break;
+        case( DXGI_FORMAT_B8G8R8X8_UNORM ):
+        case( DXGI_FORMAT_B8G8R8X8_UNORM_SRGB ):
+            for( int i = 0; i < count; i++ )
+                dst[i] = XMVectorSelect( g_XMIdentityR3, XMLoadColor( reinterpret_cast<const XMCOLOR *>( src ) + i ), g_XMSelect1110 );
+            break;
+        case( DXGI_FORMAT_R8G8_UNORM ):
+            for( int i = 0; i < count; i++ )
+                dst[i] = XMVectorSet( src[i*2+0] / 255.0f, src[i*2+1] / 255.0f, 0.0f, 1.0f );
+            break;
+        case( DXGI_FORMAT_R8_UNORM ):
+            for( int i = 0; i < count; i++ )
+                dst[i] = XMVectorSet( src[i] / 255.0f, 0.0f, 0.0f, 1.0f );
+            break;
+        case( DXGI_FORMAT_R16G16B16A16_FLOAT ):
+            for( int i = 0; i < count; i++ )
+                dst[i] = XMLoadHalf4( reinterpret_cast<const XMHALF4 *>( src ) + i );
+            break;
+        case( DXGI_FORMAT_R32G32B32A32_FLOAT ):
+            for( int i = 0; i < count; i++ )
+                dst[i] = XMLoadFloat4( reinterpret_cast<const XMFLOAT4 *>( src ) + i );
+            break;
+        default:
+            assert( false ); // IsSourceFormatSupported should have caught this
+            for( int i = 0; i < count; i++ )
+                dst[i] = g_XMZero;
+            break;
+        }
+    }
+
+    static DWORD EncoderFlags( vaTextureCompressionPreset preset )
+    {
+        switch( preset )
+        {
+        case( vaTextureCompressionPreset::Fast ):           return BC_FLAGS_FORCE_BC7_MODE6 | BC_FLAGS_UNIFORM;
+        case( vaTextureCompressionPreset::Balanced ):       return BC_FLAGS_NONE;
+        case( vaTextureCompressionPreset::HighQuality ):    return BC_FLAGS_USE_3SUBSETS | BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A;
+        default: assert( false );                           return BC_FLAGS_NONE;
+        }
+    }
+
+    static void EncodeBlock( DXGI_FORMAT format, uint8 * dst, const XMVECTOR * pixels, DWORD flags )
+    {
+        switch( format )
+        {
+        case( DXGI_FORMAT_BC1_UNORM ):
+        case( DXGI_FORMAT_BC1_UNORM_SRGB ):     D3DXEncodeBC1( dst, pixels, TEX_THRESHOLD_DEFAULT, flags );     break;
+        case( DXGI_FORMAT_BC2_UNORM ):
+        case( DXGI_FORMAT_BC2_UNORM_SRGB ):     D3DXEncodeBC2( dst, pixels, flags );                            break;
+        case( DXGI_FORMAT_BC3_UNORM ):
+        case( DXGI_FORMAT_BC3_UNORM_SRGB ):     D3DXEncodeBC3( dst, pixels, flags );                            break;
+        case( DXGI_FORMAT_BC4_UNORM ):          D3DXEncodeBC4U( dst, pixels, flags );                           break;
+        case( DXGI_FORMAT_BC4_SNORM ):          D3DXEncodeBC4S( dst, pixels, flags );                           break;
+        case( DXGI_FORMAT_BC5_UNORM ):          D3DXEncodeBC5U( dst, pixels, flags );                           break;
+        case( DXGI_FORMAT_BC5_SNORM ):          D3DXEncodeBC5S( dst, pixels, flags );                           break;
+        case( DXGI_FORMAT_BC6H_UF16 ):          D3DXEncodeBC6HU( dst, pixels, flags );                          break;
+        case( DXGI_FORMAT_BC6H_SF16 ):          D3DXEncodeBC6HS( dst, pixels, flags );                          break;
+        case( DXGI_FORMAT_BC7_UNORM ):
+        case( DXGI_FORMAT_BC7_UNORM_SRGB ):     D3DXEncodeBC7( dst, pixels, flags );                            break;
+        default: assert( false ); break;
+        }
+    }
+}
+
+vaTextureCompressionJobDX::vaTextureCompressionJobDX( vaRenderDevice & device, DirectX::ScratchImage && source, DXGI_FORMAT destinationFormat, vaTextureContentsType destinationContentsType, vaResourceBindSupportFlags bindFlags, vaTextureCompressionPreset preset )
+    : m_device( device ), m_source( std::move( source ) ), m_destinationFormat( destinationFormat ), m_destinationContentsType( destinationContentsType ), m_preset( preset )
+{
+    // drop unsupported bind flags if any - doesn't work with CreateFromImageBuffer
+    m_bindFlags = bindFlags & ~( vaResourceBindSupportFlags::RenderTarget | vaResourceBindSupportFlags::UnorderedAccess | vaResourceBindSupportFlags::DepthStencil );
+
+    const Image * images = m_source.GetImages( );
+    for( size_t i = 0; i < m_source.GetImageCount( ); i++ )
+        m_blockCount += (int64)( ( images[i].width + 3 ) / 4 ) * (int64)( ( images[i].height + 3 ) / 4 );
+}
+
+bool vaTextureCompressionJobDX::SelectDestinationFormat( vaResourceFormat sourceFormat, vaTextureContentsType contentsType, DXGI_FORMAT & outFormat, vaTextureContentsType & outContentsType )
+{
+    outContentsType = contentsType;
+
+    // Already compressed?
+    if( (sourceFormat >= vaResourceFormat::BC1_TYPELESS && sourceFormat <= vaResourceFormat::BC5_SNORM)
+        || (sourceFormat >= vaResourceFormat::BC6H_TYPELESS && sourceFormat <= vaResourceFormat::BC7_UNORM_SRGB) )
+        return false;
+
+    // normals
+    if( ( contentsType == vaTextureContentsType::NormalsXYZ_UNORM ) || ( contentsType == vaTextureContentsType::NormalsXY_UNORM ) )
+    {
+        if( ( sourceFormat == vaResourceFormat::R8G8_UNORM ) || ( sourceFormat == vaResourceFormat::R8G8B8A8_UNORM ) || ( sourceFormat == vaResourceFormat::B8G8R8A8_UNORM ) || ( sourceFormat == vaResourceFormat::B8G8R8X8_UNORM ) )
+        {
+            outFormat = DXGI_FORMAT_BC5_UNORM;
+            outContentsType = vaTextureContentsType::NormalsXY_UNORM;
+            return true;
+        }
+    }
+    else if( contentsType == vaTextureContentsType::GenericColor )
+    {
+        if( ( sourceFormat == vaResourceFormat::R8G8B8A8_UNORM_SRGB ) || ( sourceFormat == vaResourceFormat::B8G8R8A8_UNORM_SRGB ) )
+        {
+            outFormat = DXGI_FORMAT_BC7_UNORM_SRGB;
+            return true;
+        }
+        // HDR color (environment maps & co.)
+        if( ( sourceFormat == vaResourceFormat::R16G16B16A16_FLOAT ) || ( sourceFormat == vaResourceFormat::R32G32B32A32_FLOAT ) )
+        {
+            outFormat = DXGI_FORMAT_BC6H_UF16;
+            return true;
+        }
+    } 
+    else if( contentsType == vaTextureContentsType::GenericLinear )
+    {
+        if( ( sourceFormat == vaResourceFormat::R8G8B8A8_UNORM ) || ( sourceFormat == vaResourceFormat::B8G8R8A8_UNORM ) )
+        {
+            outFormat = DXGI_FORMAT_BC7_UNORM;
+            return true;
+        }
+    }
+    else if( contentsType == vaTextureContentsType::SingleChannelLinearMask )
+    {
+        if( ( sourceFormat == vaResourceFormat::R8G8B8A8_UNORM ) || ( sourceFormat == vaResourceFormat::B8G8R8A8_UNORM ) || ( sourceFormat == vaResourceFormat::R8_UNORM ) )
+        {
+            outFormat = DXGI_FORMAT_BC4_UNORM;
+            return true;
+        }
+    }
+
+    // format might be ok just not tested - try out and see
+    VA_LOG_WARNING( "vaTextureCompressionJobDX - no compression path for format %s with contents type %d", vaResourceFormatHelpers::EnumToString( sourceFormat ).c_str( ), (int)contentsType );
+    return false;
+}
+
+bool vaTextureCompressionJobDX::IsSourceFormatSupported( DXGI_FORMAT format )
+{
+    switch( format )
+    {
+    case( DXGI_FORMAT_R8G8B8A8_UNORM ):     case( DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ):
+    case( DXGI_FORMAT_B8G8R8A8_UNORM ):     case( DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ):
+    case( DXGI_FORMAT_B8G8R8X8_UNORM ):     case( DXGI_FORMAT_B8G8R8X8_UNORM_SRGB ):
+    case( DXGI_FORMAT_R8G8_UNORM ):         case( DXGI_FORMAT_R8_UNORM ):
+    case( DXGI_FORMAT_R16G16B16A16_FLOAT ): case( DXGI_FORMAT_R32G32B32A32_FLOAT ):
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool vaTextureCompressionJobDX::Encode( const std::function<void( int64 blocksDone )> & progressCallback, const std::atomic_bool * cancel )
+{
+    VA_TRACE_CPU_SCOPE( TextureCompressionEncode );
+
+    assert( !m_encoded );
+    const TexMetadata & srcMetadata = m_source.GetMetadata( );
+    if( m_source.GetImageCount( ) == 0 || !IsSourceFormatSupported( srcMetadata.format ) )
+        { assert( false ); return false; }
+
+    TexMetadata dstMetadata = srcMetadata;
+    dstMetadata.format = m_destinationFormat;
+    HRESULT hr = m_compressed.Initialize( dstMetadata );
+    if( FAILED( hr ) || m_compressed.GetImageCount( ) != m_source.GetImageCount( ) )
+        { assert( false ); return false; }
+
+    // all block rows of all images (mips, slices, faces) in one flat range so that the small mips don't end up serialized at the end
+    const size_t imageCount = m_source.GetImageCount( );
+    vector<int64> firstBlockRow( imageCount + 1, 0 );
+    for( size_t i = 0; i < imageCount; i++ )
+        firstBlockRow[i+1] = firstBlockRow[i] + (int64)( ( m_source.GetImages( )[i].height + 3 ) / 4 );
+
+    const Image *   srcImages   = m_source.GetImages( );
+    const Image *   dstImages   = m_compressed.GetImages( );
+    const DWORD     flags       = EncoderFlags( m_preset );
+    const size_t    blockSize   = BitsPerPixel( m_destinationFormat ) * 2;     // 4 bpp -> 8 bytes, 8 bpp -> 16 bytes
+    std::atomic<int64> blocksDone   = 0;
+    std::atomic_bool   failed       = false;
+
+    vaParallel::For( 0, firstBlockRow.back( ), c_minBlockRowsPerChunk, [&]( int64 rowBegin, int64 rowEnd )
+    {
+        // 4 unpacked source rows, with room for the padding of the last partial block
+        vector<XMVECTOR> rows;
+        XMVECTOR pixels[NUM_PIXELS_PER_BLOCK];
+
+        int64 blocksSinceReport = 0;
+        for( int64 row = rowBegin; row < rowEnd; row++ )
+        {
+            if( cancel != nullptr && *cancel )
+                { failed = true; return; }
+
+            size_t imageIndex   = (size_t)( std::upper_bound( firstBlockRow.begin( ), firstBlockRow.end( ), row ) - firstBlockRow.begin( ) ) - 1;
+            const Image & src   = srcImages[imageIndex];
+            const Image & dst   = dstImages[imageIndex];
+            const int width     = (int)src.width;
+            const int height    = (int)src.height;
+            const int blocksX   = ( width + 3 ) / 4;
+            const int y0        = (int)( row - firstBlockRow[imageIndex] ) * 4;
+
+            rows.resize( (size_t)blocksX * 4 * 4 );
+            for( int y = 0; y < 4; y++ )
+            {
+                // partial blocks at the edges repeat the last row/column
+                int sy = vaMath::Min( y0 + y, height - 1 );
+                XMVECTOR * rowDst = &rows[(size_t)y * blocksX * 4];
+                UnpackRow( src.format, src.pixels + (size_t)sy * src.rowPitch, width, rowDst );
+                for( int x = width; x < blocksX * 4; x++ )
+                    rowDst[x] = rowDst[width - 1];
+            }
+
+            uint8 * dstRow = dst.pixels + (size_t)( y0 / 4 ) * dst.rowPitch;
+            for( int bx = 0; bx < blocksX; bx++ )
+            {
+                for( int y = 0; y < 4; y++ )
+                    for( int x = 0; x < 4; x++ )
+                        pixels[y * 4 + x] = rows[(size_t)y * blocksX * 4 + bx * 4 + x];
+                EncodeBlock( m_destinationFormat, dstRow + bx * blockSize, pixels, flags );
+            }
+
+            blocksSinceReport += blocksX;
+            if( ( ( row - rowBegin ) % c_progressReportInterval ) == c_progressReportInterval - 1 || row == rowEnd - 1 )
+            {
+                int64 total = blocksDone.fetch_add( blocksSinceReport ) + blocksSinceReport;
+                blocksSinceReport = 0;
+                if( progressCallback )
+                    progressCallback( total );
+            }
+        }
+    } );
+
+    if( failed )
+    {
+        m_compressed.Release( );
+        return false;
+    }
+    m_encoded = true;
+    m_source.Release( );    // no longer needed, could be big
+    return true;
+}
+
+shared_ptr<vaTexture> vaTextureCompressionJobDX::Finish( )
+{
+    if( !m_encoded )
+        { assert( false ); return nullptr; }
+
+    DirectX::Blob blob;
+    HRESULT hr = DirectX::SaveToDDSMemory( m_compressed.GetImages( ), m_compressed.GetImageCount( ), m_compressed.GetMetadata( ), DirectX::DDS_FLAGS_NONE, blob );
+    if( !SUCCEEDED( hr ) )
+        { assert( false ); return nullptr; }
+
+    return vaTexture::CreateFromImageBuffer( m_device, blob.GetBufferPointer( ), blob.GetBufferSize( ), vaTextureLoadFlags::Default, m_bindFlags, m_destinationContentsType );
+}
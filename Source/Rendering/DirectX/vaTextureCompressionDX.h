@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated 
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation 
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of 
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE 
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Core/vaCoreIncludes.h"
+
+#include "Rendering/DirectX/vaDirectXIncludes.h"
+#include "Rendering/DirectX/vaDirectXTools.h"
+
+#include "Rendering/vaTextureHelpers.h"
+
+#include "IntegratedExternals/DirectXTex/DirectXTex/DirectXTex.h"
+
+namespace Vanilla
+{
+    // CPU BC1-7 encoding shared by vaTextureDX11 and vaTextureDX12; same per-block encoders as DirectX::Compress (DirectXTex BC.h), but
+    // the blocks are spread over vaParallel workers (DirectXTex only goes parallel with OpenMP, which we don't build with) and source
+    // rows are unpacked with DirectXMath instead of going through a full image format conversion.
+    class vaTextureCompressionJobDX : public vaTextureCompressionJob
+    {
+        vaRenderDevice &                    m_device;
+        DirectX::ScratchImage               m_source;
+        DirectX::ScratchImage               m_compressed;
+        DXGI_FORMAT                         m_destinationFormat;
+        vaTextureContentsType               m_destinationContentsType;
+        vaResourceBindSupportFlags          m_bindFlags;
+        vaTextureCompressionPreset          m_preset;
+        int64                               m_blockCount            = 0;
+        bool                                m_encoded               = false;
+
+    public:
+        vaTextureCompressionJobDX( vaRenderDevice & device, DirectX::ScratchImage && source, DXGI_FORMAT destinationFormat, vaTextureContentsType destinationContentsType, vaResourceBindSupportFlags bindFlags, vaTextureCompressionPreset preset );
+        virtual ~vaTextureCompressionJobDX( ) { }
+
+        // picks the BC format for a given source format & contents type; returns false if compressed already or not supported
+        static bool                         SelectDestinationFormat( vaResourceFormat sourceFormat, vaTextureContentsType contentsType, DXGI_FORMAT & outFormat, vaTextureContentsType & outContentsType );
+
+        // can the source rows be unpacked (formats that SelectDestinationFormat can pick a BC format for)
+        static bool                         IsSourceFormatSupported( DXGI_FORMAT format );
+
+        virtual int64                       GetBlockCount( ) const override                 { return m_blockCount; }
+        virtual vaResourceFormat            GetDestinationFormat( ) const override          { return VAFormatFromDXGI( m_destinationFormat ); }
+
+        virtual bool                        Encode( const std::function<void( int64 blocksDone )> & progressCallback, const std::atomic_bool * cancel ) override;
+        virtual shared_ptr<vaTexture>       Finish( ) override;
+    };
+}
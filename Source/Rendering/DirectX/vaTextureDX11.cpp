@@ -20,6 +20,7 @@
 #include "vaTextureDX11.h"
 
 #include "Rendering/DirectX/vaRenderDeviceContextDX11.h"
+#include "Rendering/DirectX/vaTextureCompressionDX.h"
 
 
 #include "Core/System/vaFileTools.h"
@@ -1028,119 +1029,27 @@ void vaTextureDX11::UnsetFromAPISlotUAV_CS( vaRenderDeviceContext & renderContex
 //     dx11Context->UpdateSubresource( m_resource, (UINT)dstSubresourceIndex, &d3d11box, srcData, srcDataRowPitch, srcDataDepthPitch );
 // }
 
-shared_ptr<vaTexture> vaTextureDX11::TryCompress( )
+shared_ptr<vaTextureCompressionJob> vaTextureDX11::CreateCompressionJob( vaTextureCompressionPreset preset )
 {
-    // Already compressed?
-    if( (m_resourceFormat >= vaResourceFormat::BC1_TYPELESS && m_resourceFormat <= vaResourceFormat::BC5_SNORM)
-        || (m_resourceFormat >= vaResourceFormat::BC6H_TYPELESS && m_resourceFormat <= vaResourceFormat::BC7_UNORM_SRGB) )
-        return nullptr;
-
     DXGI_FORMAT             destinationFormat;
-    vaTextureContentsType   destinationContentsType = m_contentsType;
-    DWORD                   compressFlags       = DirectX::TEX_COMPRESS_DEFAULT; 
-
-#ifdef _OPENMP
-    compressFlags |= DirectX::TEX_COMPRESS_PARALLEL;
-#endif
-
-    // normals
-    if( ( m_contentsType == vaTextureContentsType::NormalsXYZ_UNORM ) || ( m_contentsType == vaTextureContentsType::NormalsXY_UNORM ) )
-    {
-        if( ( m_resourceFormat == vaResourceFormat::R8G8_UNORM ) || ( m_resourceFormat == vaResourceFormat::R8G8B8A8_UNORM ) || ( m_resourceFormat == vaResourceFormat::B8G8R8A8_UNORM ) || ( m_resourceFormat == vaResourceFormat::B8G8R8X8_UNORM ) )
-        {
-            destinationFormat = DXGI_FORMAT_BC5_UNORM;
-            destinationContentsType = vaTextureContentsType::NormalsXY_UNORM;
-        }
-        else
-        {
-            // format might be ok just not tested - try out and see
-            assert( false );
-            return nullptr;
-        }
-    }
-    else if( m_contentsType == vaTextureContentsType::GenericColor )
-    {
-        if( ( m_resourceFormat == vaResourceFormat::R8G8B8A8_UNORM_SRGB ) || ( m_resourceFormat == vaResourceFormat::B8G8R8A8_UNORM_SRGB ) )
-        {
-            destinationFormat = DXGI_FORMAT_BC7_UNORM_SRGB;
-        }
-        else
-        {
-            // format might be ok just not tested - try out and see
-            assert( false );
-            return nullptr;
-        }
-    } 
-    else if( m_contentsType == vaTextureContentsType::GenericLinear )
-    {
-        assert( false );
-        if( ( m_resourceFormat == vaResourceFormat::R8G8B8A8_UNORM ) || ( m_resourceFormat == vaResourceFormat::B8G8R8A8_UNORM ) )
-        {
-            destinationFormat = DXGI_FORMAT_BC7_UNORM;
-        }
-        else
-        {
-            // format might be ok just not tested - try out and see
-            assert( false );
-            return nullptr;
-        }
-    }
-    else if( m_contentsType == vaTextureContentsType::SingleChannelLinearMask )
-    {
-        if( ( m_resourceFormat == vaResourceFormat::R8G8B8A8_UNORM ) || ( m_resourceFormat == vaResourceFormat::B8G8R8A8_UNORM ) || ( m_resourceFormat == vaResourceFormat::R8_UNORM ) )
-        {
-            destinationFormat = DXGI_FORMAT_BC4_UNORM;
-        }
-        else
-        {
-            // format might be ok just not tested - try out and see
-            assert( false );
-            return nullptr;
-        }
-    }
-    else
-    {
-        // not supported yet!
-        assert( false );
+    vaTextureContentsType   destinationContentsType;
+    if( !vaTextureCompressionJobDX::SelectDestinationFormat( m_resourceFormat, m_contentsType, destinationFormat, destinationContentsType ) )
         return nullptr;
-    }
 
-
-    DirectX::TexMetadata info;
     DirectX::ScratchImage scratchImage;
-    DirectX::ScratchImage compressedScratchImage;
-
-    HRESULT hr;
     {
         vaMemoryStream memoryStream( (int64)0, 1024 * 1024 );
         vaDirectXTools11::SaveDDSTexture( GetRenderDevice().SafeCast<vaRenderDeviceDX11*>( )->GetPlatformDevice(), memoryStream, m_resource );
-        hr = DirectX::LoadFromDDSMemory( memoryStream.GetBuffer(), memoryStream.GetLength(), DirectX::DDS_FLAGS_NONE, &info, scratchImage );
+        HRESULT hr = DirectX::LoadFromDDSMemory( memoryStream.GetBuffer(), memoryStream.GetLength(), DirectX::DDS_FLAGS_NONE, nullptr, scratchImage );
         assert( SUCCEEDED( hr ) );
         if( !SUCCEEDED( hr ) )
-        {
             return nullptr;
-        }
     }
 
+    if( !vaTextureCompressionJobDX::IsSourceFormatSupported( scratchImage.GetMetadata( ).format ) )
+        { assert( false ); return nullptr; }
 
-
-
-    hr = DirectX::Compress( scratchImage.GetImages( ), scratchImage.GetImageCount( ), info, destinationFormat, compressFlags, DirectX::TEX_THRESHOLD_DEFAULT, compressedScratchImage );
-    assert( SUCCEEDED( hr ) );
-    if( !SUCCEEDED( hr ) )
-    {
-        return nullptr;
-    }
-    
-    DirectX::Blob blob;
-    hr = DirectX::SaveToDDSMemory( compressedScratchImage.GetImages( ), compressedScratchImage.GetImageCount( ), compressedScratchImage.GetMetadata( ), DirectX::DDS_FLAGS_NONE, blob );
-    assert( SUCCEEDED( hr ) );
-    if( !SUCCEEDED( hr ) )
-    {
-        return nullptr;
-    }
-
-    return vaTexture::CreateFromImageBuffer( GetRenderDevice(), blob.GetBufferPointer(), blob.GetBufferSize(), vaTextureLoadFlags::Default, GetBindSupportFlags(), destinationContentsType );
+    return std::make_shared<vaTextureCompressionJobDX>( GetRenderDevice( ), std::move( scratchImage ), destinationFormat, destinationContentsType, GetBindSupportFlags( ), preset );
 }
 
 bool vaTextureDX11::InternalCreate1D( vaResourceFormat format, int width, int mipLevels, int arraySize, vaResourceBindSupportFlags bindFlags, vaResourceAccessFlags accessFlags, vaResourceFormat srvFormat, vaResourceFormat rtvFormat, vaResourceFormat dsvFormat, vaResourceFormat uavFormat, vaTextureFlags flags, vaTextureContentsType contentsType, void * initialData )
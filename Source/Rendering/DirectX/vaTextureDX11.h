@@ -100,7 +100,7 @@ namespace Vanilla
         virtual bool                        SaveAPACK( vaStream & outStream ) override;
         virtual bool                        SerializeUnpacked( vaXMLSerializer & serializer, const wstring & assetFolder ) override;
 
-        virtual shared_ptr<vaTexture>       TryCompress( ) override;
+        virtual shared_ptr<vaTextureCompressionJob> CreateCompressionJob( vaTextureCompressionPreset preset ) override;
 
         virtual bool                        SaveToDDSFile( vaRenderDeviceContext & renderContext, const wstring & path ) override;
         virtual bool                        SaveToPNGFile( vaRenderDeviceContext & renderContext, const wstring & path ) override;
@@ -20,6 +20,7 @@
 #include "vaTextureDX12.h"
 
 #include "Rendering/DirectX/vaRenderDeviceContextDX12.h"
+#include "Rendering/DirectX/vaTextureCompressionDX.h"
 
 #include "IntegratedExternals/DirectXTex/DirectXTex/DirectXTex.h"
 
@@ -963,105 +964,22 @@ void vaTextureDX12::ResolveSubresource( vaRenderDeviceContext & renderContext, c
 // #endif
 // }
 
-shared_ptr<vaTexture> vaTextureDX12::TryCompress( )
+shared_ptr<vaTextureCompressionJob> vaTextureDX12::CreateCompressionJob( vaTextureCompressionPreset preset )
 {
-    // Already compressed?
-    if( (m_resourceFormat >= vaResourceFormat::BC1_TYPELESS && m_resourceFormat <= vaResourceFormat::BC5_SNORM)
-        || (m_resourceFormat >= vaResourceFormat::BC6H_TYPELESS && m_resourceFormat <= vaResourceFormat::BC7_UNORM_SRGB) )
-        return nullptr;
-
     DXGI_FORMAT             destinationFormat;
-    vaTextureContentsType   destinationContentsType = m_contentsType;
-    DWORD                   compressFlags       = DirectX::TEX_COMPRESS_DEFAULT; 
-
-#ifdef _OPENMP
-    compressFlags |= DirectX::TEX_COMPRESS_PARALLEL;
-#endif
-
-    // normals
-    if( ( m_contentsType == vaTextureContentsType::NormalsXYZ_UNORM ) || ( m_contentsType == vaTextureContentsType::NormalsXY_UNORM ) )
-    {
-        if( ( m_resourceFormat == vaResourceFormat::R8G8_UNORM ) || ( m_resourceFormat == vaResourceFormat::R8G8B8A8_UNORM ) || ( m_resourceFormat == vaResourceFormat::B8G8R8A8_UNORM ) || ( m_resourceFormat == vaResourceFormat::B8G8R8X8_UNORM ) )
-        {
-            destinationFormat = DXGI_FORMAT_BC5_UNORM;
-            destinationContentsType = vaTextureContentsType::NormalsXY_UNORM;
-        }
-        else
-        {
-            // format might be ok just not tested - try out and see
-            assert( false );
-            return nullptr;
-        }
-    }
-    else if( m_contentsType == vaTextureContentsType::GenericColor )
-    {
-        if( ( m_resourceFormat == vaResourceFormat::R8G8B8A8_UNORM_SRGB ) || ( m_resourceFormat == vaResourceFormat::B8G8R8A8_UNORM_SRGB ) )
-        {
-            destinationFormat = DXGI_FORMAT_BC7_UNORM_SRGB;
-        }
-        else
-        {
-            // format might be ok just not tested - try out and see
-            assert( false );
-            return nullptr;
-        }
-    } 
-    else if( m_contentsType == vaTextureContentsType::GenericLinear )
-    {
-        if( ( m_resourceFormat == vaResourceFormat::R8G8B8A8_UNORM ) || ( m_resourceFormat == vaResourceFormat::B8G8R8A8_UNORM ) )
-        {
-            destinationFormat = DXGI_FORMAT_BC7_UNORM;
-        }
-        else
-        {
-            // format might be ok just not tested - try out and see
-            assert( false );
-            return nullptr;
-        }
-    }
-    else if( m_contentsType == vaTextureContentsType::SingleChannelLinearMask )
-    {
-        if( ( m_resourceFormat == vaResourceFormat::R8G8B8A8_UNORM ) || ( m_resourceFormat == vaResourceFormat::B8G8R8A8_UNORM ) || ( m_resourceFormat == vaResourceFormat::R8_UNORM ) )
-        {
-            destinationFormat = DXGI_FORMAT_BC4_UNORM;
-        }
-        else
-        {
-            // format might be ok just not tested - try out and see
-            assert( false );
-            return nullptr;
-        }
-    }
-    else
-    {
-        // not supported yet!
-        assert( false );
+    vaTextureContentsType   destinationContentsType;
+    if( !vaTextureCompressionJobDX::SelectDestinationFormat( m_resourceFormat, m_contentsType, destinationFormat, destinationContentsType ) )
         return nullptr;
-    }
-
 
     DirectX::ScratchImage scratchImage;
-    DirectX::ScratchImage compressedScratchImage;
-
-    HRESULT hr;
-    {
-        hr = DirectX::CaptureTexture( AsDX12( GetRenderDevice() ).GetCommandQueue().Get(), m_resource.Get(), ( m_flags & ( vaTextureFlags::Cubemap | vaTextureFlags::CubemapButArraySRV ) ) != 0, scratchImage, m_rsth.RSTHGetCurrentState( ), m_rsth.RSTHGetCurrentState( ) );
-        if( !SUCCEEDED( hr ) )
-            { assert( false );  return nullptr; }
-    }
+    HRESULT hr = DirectX::CaptureTexture( AsDX12( GetRenderDevice() ).GetCommandQueue().Get(), m_resource.Get(), ( m_flags & ( vaTextureFlags::Cubemap | vaTextureFlags::CubemapButArraySRV ) ) != 0, scratchImage, m_rsth.RSTHGetCurrentState( ), m_rsth.RSTHGetCurrentState( ) );
+    if( !SUCCEEDED( hr ) )
+        { assert( false );  return nullptr; }
 
-    hr = DirectX::Compress( scratchImage.GetImages( ), scratchImage.GetImageCount( ), scratchImage.GetMetadata(), destinationFormat, compressFlags, DirectX::TEX_THRESHOLD_DEFAULT, compressedScratchImage );
-        if( !SUCCEEDED( hr ) )
-            { assert( false );  return nullptr; }
-    
-    DirectX::Blob blob;
-    hr = DirectX::SaveToDDSMemory( compressedScratchImage.GetImages( ), compressedScratchImage.GetImageCount( ), compressedScratchImage.GetMetadata( ), DirectX::DDS_FLAGS_NONE, blob );
-        if( !SUCCEEDED( hr ) )
-            { assert( false );  return nullptr; }
+    if( !vaTextureCompressionJobDX::IsSourceFormatSupported( scratchImage.GetMetadata( ).format ) )
+        { assert( false ); return nullptr; }
 
-    // drop unsupported bind flags if any - doesn't work with CreateFromImageBuffer
-    vaResourceBindSupportFlags bindFlags = GetBindSupportFlags( ) & ~(vaResourceBindSupportFlags::RenderTarget | vaResourceBindSupportFlags::UnorderedAccess | vaResourceBindSupportFlags::DepthStencil );
-    return vaTexture::CreateFromImageBuffer( GetRenderDevice(), blob.GetBufferPointer(), blob.GetBufferSize(), vaTextureLoadFlags::Default, bindFlags, destinationContentsType );
+    return std::make_shared<vaTextureCompressionJobDX>( GetRenderDevice( ), std::move( scratchImage ), destinationFormat, destinationContentsType, GetBindSupportFlags( ), preset );
 }
 
 vaTextureDX12::MappableTextureInfo::MappableTextureInfo( vaRenderDeviceDX12 & device, const D3D12_RESOURCE_DESC & resDesc ) 
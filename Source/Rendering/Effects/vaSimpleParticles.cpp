@@ -728,6 +728,7 @@ vaDrawResultFlags vaSimpleParticleSystem::Draw( vaSceneDrawContext & drawContext
 
         // this means 'do not override'
         instanceConsts.CustomColor = vaVector4( 0.0f, 0.0f, 0.0f, 0.0f );
+        instanceConsts.InstanceArrayEnabled = 0;
 
         bool isWireframe = ( ( drawContext.RenderFlags & vaDrawContextFlags::DebugWireframePass ) != 0 );// || materialSettings.Wireframe;
         if( isWireframe )
@@ -83,8 +83,135 @@ vaVector4 vaImageCompareTool::CompareWithReference( vaRenderDeviceContext & rend
     return postProcess.CompareImages( renderContext, m_referenceTexture, colorInOut );
 }
 
+bool vaImageCompareTool::CaptureCPUImage( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & source, const std::function<void( vaImageMetrics::Image && image )> & callback )
+{
+    CPUReadbackSlot * slot = nullptr;
+    for( int i = 0; i < _countof( m_cpuReadbackSlots ); i++ )
+        if( m_cpuReadbackSlots[i].IssuedFrame == -1 )
+        {
+            slot = &m_cpuReadbackSlots[i];
+            break;
+        }
+    if( slot == nullptr )
+        return false;
+
+    const shared_ptr< vaTexture > & viewedOriginal = ( !source->IsView( ) ) ? ( source ) : ( source->GetViewedOriginal( ) );
+    if( slot->Texture == nullptr || slot->Texture->GetSizeX( ) != source->GetSizeX( ) || slot->Texture->GetSizeY( ) != source->GetSizeY( ) 
+        || slot->Texture->GetResourceFormat( ) != viewedOriginal->GetResourceFormat( ) || slot->Texture->GetSRVFormat( ) != source->GetSRVFormat( ) )
+    {
+        slot->Texture = vaTexture::Create2D( GetRenderDevice( ), viewedOriginal->GetResourceFormat( ), source->GetSizeX( ), source->GetSizeY( ), 1, 1, 1, vaResourceBindSupportFlags::None, 
+            vaResourceAccessFlags::CPURead | vaResourceAccessFlags::CPUReadManuallySynced, source->GetSRVFormat( ) );
+    }
+
+    slot->Texture->CopyFrom( renderContext, source );
+    slot->IssuedFrame   = GetRenderDevice( ).GetCurrentFrameIndex( );
+    slot->Callback      = callback;
+    return true;
+}
+
+int vaImageCompareTool::GetFreeCPUReadbackSlotCount( ) const
+{
+    int count = 0;
+    for( int i = 0; i < _countof( m_cpuReadbackSlots ); i++ )
+        count += ( m_cpuReadbackSlots[i].IssuedFrame == -1 ) ? ( 1 ) : ( 0 );
+    return count;
+}
+
+void vaImageCompareTool::ResolveCPUReadbacks( vaRenderDeviceContext & renderContext )
+{
+    for( int i = 0; i < _countof( m_cpuReadbackSlots ); i++ )
+    {
+        CPUReadbackSlot & slot = m_cpuReadbackSlots[i];
+        // CPUReadManuallySynced textures are safe to map once c_BackbufferCount frames have passed
+        if( slot.IssuedFrame == -1 || ( GetRenderDevice( ).GetCurrentFrameIndex( ) - slot.IssuedFrame ) < vaRenderDevice::c_BackbufferCount )
+            continue;
+
+        // copy out so the readback texture can be reused right away
+        vaImageMetrics::Image image;
+        if( slot.Texture->TryMap( renderContext, vaResourceMapType::Read, false ) )
+        {
+            const vaTextureMappedSubresource & mapped = slot.Texture->GetMappedData( )[0];
+            shared_ptr<vector<uint8>> storage = std::make_shared<vector<uint8>>( (size_t)mapped.RowPitch * mapped.SizeY );
+            memcpy( storage->data( ), mapped.Buffer, storage->size( ) );
+            image           = vaImageMetrics::Image( storage->data( ), mapped.SizeX, mapped.SizeY, mapped.RowPitch, slot.Texture->GetSRVFormat( ) );
+            image.Storage   = storage;
+            slot.Texture->Unmap( renderContext );
+        }
+        else
+        {
+            VA_LOG_ERROR( "CompareTool: Couldn't map CPU readback texture" );
+        }
+
+        // free the slot before the callback so that it can issue new readbacks
+        auto callback = std::move( slot.Callback );
+        slot.Callback       = nullptr;
+        slot.IssuedFrame    = -1;
+        if( callback )
+            callback( std::move( image ) );
+    }
+}
+
+bool vaImageCompareTool::CompareWithReferenceCPU( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & colorInOut )
+{
+    if( ( m_referenceTexture == nullptr ) || ( m_referenceTexture->GetSizeX( ) != colorInOut->GetSizeX( ) ) || ( m_referenceTexture->GetSizeY( ) != colorInOut->GetSizeY( ) ) )
+        return false;
+    if( !vaImageMetrics::IsFormatSupported( m_referenceTexture->GetSRVFormat( ) ) || !vaImageMetrics::IsFormatSupported( colorInOut->GetSRVFormat( ) ) )
+    {
+        VA_LOG_ERROR( "CompareTool: image format not supported by vaImageMetrics" );
+        return false;
+    }
+    if( GetFreeCPUReadbackSlotCount( ) < 2 )
+        return false;
+
+    // both readbacks get resolved in the same RenderTick (in any order); the second one to arrive kicks off the comparison
+    struct PendingCompare
+    {
+        vaImageMetrics::Image       Reference;
+        vaImageMetrics::Image       Current;
+        int                         Remaining   = 2;
+    };
+    shared_ptr<PendingCompare> pending = std::make_shared<PendingCompare>( );
+    shared_ptr<CPUMetricsResults> lastResults = m_cpuMetricsLast;
+    vaImageMetrics::Settings settings = m_cpuMetricsSettings;
+
+    auto onImage = [ pending, lastResults, settings ]( vaImageMetrics::Image & dst, vaImageMetrics::Image && image )
+    {
+        dst = std::move( image );
+        if( --pending->Remaining > 0 )
+            return;
+
+        vaBackgroundTaskManager::GetInstance( ).Spawn( "CompareTool CPU metrics", vaBackgroundTaskManager::SpawnFlags::None, [ pending, lastResults, settings ]( vaBackgroundTaskManager::TaskContext & )
+        {
+            vaImageMetrics::Results results;
+            if( !vaImageMetrics::Compare( pending->Reference, pending->Current, settings, results ) )
+                return false;
+
+            VA_LOG_SUCCESS( "CompareTool: CPU metrics vs reference: PSNR: %.3f (MSE: %f), SSIM: %.5f, MS-SSIM: %.5f", results.PSNR, results.MSE, results.SSIM, results.MSSSIM );
+            if( settings.PerceptualErrorMap )
+                VA_LOG( "CompareTool: deltaE mean %.3f, max %.3f", results.MeanDeltaE, results.MaxDeltaE );
+
+            std::lock_guard<mutex> lock( lastResults->Mutex );
+            lastResults->Results = std::move( results );
+            return true;
+        } );
+    };
+
+    CaptureCPUImage( renderContext, m_referenceTexture, [ pending, onImage ]( vaImageMetrics::Image && image ) { onImage( pending->Reference, std::move( image ) ); } );
+    CaptureCPUImage( renderContext, colorInOut, [ pending, onImage ]( vaImageMetrics::Image && image ) { onImage( pending->Current, std::move( image ) ); } );
+    return true;
+}
+
+bool vaImageCompareTool::GetLastCPUMetrics( vaImageMetrics::Results & outResults ) const
+{
+    std::lock_guard<mutex> lock( m_cpuMetricsLast->Mutex );
+    outResults = m_cpuMetricsLast->Results;
+    return outResults.Valid;
+}
+
 void vaImageCompareTool::RenderTick( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & colorInOut )
 {
+    ResolveCPUReadbacks( renderContext );
+
     vaPostProcess & postProcess = GetRenderDevice().GetPostProcess();
     if( !m_initialized && m_referenceTexture == nullptr )
     {
@@ -179,6 +306,15 @@ void vaImageCompareTool::RenderTick( vaRenderDeviceContext & renderContext, cons
         m_compareReferenceScheduled = false;
     }
 
+    if( m_cpuCompareScheduled )
+    {
+        if( !CompareWithReferenceCPU( renderContext, colorInOut ) )
+        {
+            VA_LOG_ERROR( "CompareTool: Reference image not captured, size/format mismatch or too many CPU readbacks in flight." );
+        }
+        m_cpuCompareScheduled = false;
+    }
+
     if( m_visualizationType != vaImageCompareTool::VisType::None && m_referenceTexture != nullptr && m_helperTexture != nullptr )
     {
         if( !( ( m_referenceTexture == nullptr ) || ( m_referenceTexture->GetSizeX( ) != colorInOut->GetSizeX( ) ) || ( m_referenceTexture->GetSizeY( ) != colorInOut->GetSizeY( ) ) ) )// || ( m_referenceTexture->GetSRVFormat( ) != colorInOut->GetSRVFormat( ) ) ) )
@@ -227,6 +363,13 @@ void vaImageCompareTool::UIPanelTick( vaApplicationBase & )
     m_saveReferenceScheduled = ImGui::Button( "Save ref" );
     ImGui::SameLine( );
     m_compareReferenceScheduled = ImGui::Button( "Compare with ref" );
+    ImGui::SameLine( );
+    m_cpuCompareScheduled = ImGui::Button( "Compare (CPU metrics)" );
+    ImGui::Checkbox( "CPU: SSIM", &m_cpuMetricsSettings.SSIM );
+    ImGui::SameLine( );
+    ImGui::Checkbox( "MS-SSIM", &m_cpuMetricsSettings.MSSSIM );
+    ImGui::SameLine( );
+    ImGui::Checkbox( "deltaE", &m_cpuMetricsSettings.PerceptualErrorMap );
 
     if( m_referenceTexture == nullptr )
     {
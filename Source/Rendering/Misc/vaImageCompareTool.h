@@ -28,6 +28,8 @@
 
 #include "Core/vaUI.h"
 
+#include "Core/Misc/vaImageMetrics.h"
+
 namespace Vanilla
 {
     // will be moved to its own file at some point, if it ever grows into something more serious
@@ -62,6 +64,26 @@ namespace Vanilla
 
         bool                        m_initialized;
 
+        // CPU readbacks (used for CPU metrics and scripted captures): textures get copied into a ring of CPU readable textures
+        // that are only mapped once the GPU is done with them (no stall); callbacks get called from RenderTick
+        struct CPUReadbackSlot
+        {
+            shared_ptr<vaTexture>   Texture;
+            int64                   IssuedFrame     = -1;       // -1 means free
+            std::function<void( vaImageMetrics::Image && image )>
+                                    Callback;
+        };
+        struct CPUMetricsResults
+        {
+            mutex                   Mutex;
+            vaImageMetrics::Results Results;
+        };
+        CPUReadbackSlot             m_cpuReadbackSlots[(vaRenderDevice::c_BackbufferCount+1)*2];
+        bool                        m_cpuCompareScheduled               = false;
+        vaImageMetrics::Settings    m_cpuMetricsSettings;
+        shared_ptr<CPUMetricsResults>
+                                    m_cpuMetricsLast                    = std::make_shared<CPUMetricsResults>( );
+
     public: //protected:
         vaImageCompareTool( const vaRenderingModuleParams & params );
     public:
@@ -76,7 +98,18 @@ namespace Vanilla
         // See vaPostProcess::CompareImages for description of the results
         virtual vaVector4           CompareWithReference( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & colorInOut );
 
+        // Queues up a CPU side comparison (see vaImageMetrics); results get logged a couple of frames later and are available
+        // through GetLastCPUMetrics. Returns false if there's no matching reference or too many comparisons already in flight.
+        virtual bool                CompareWithReferenceCPU( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & colorInOut );
+        bool                        GetLastCPUMetrics( vaImageMetrics::Results & outResults ) const;
+
+        // Copies the texture into a CPU readable one and calls the callback (from a later RenderTick, on the render thread) with
+        // an image that owns a copy of the data. Returns false if all readback slots are in use.
+        bool                        CaptureCPUImage( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & source, const std::function<void( vaImageMetrics::Image && image )> & callback );
+        int                         GetFreeCPUReadbackSlotCount( ) const;
+
     protected:
+        void                        ResolveCPUReadbacks( vaRenderDeviceContext & renderContext );
 
     private:
         virtual void                UIPanelTickAlways( vaApplicationBase & application ) override;
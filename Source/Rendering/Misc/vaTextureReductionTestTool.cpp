@@ -28,6 +28,8 @@
 #include "Rendering/vaRenderMesh.h"
 #include "Rendering/vaRenderMaterial.h"
 
+#include "Scene/vaScene.h"
+
 using namespace Vanilla;
 
 // not maintained, needs update
@@ -51,6 +53,30 @@ static void LoadCamera( vaRenderCamera & camera, vaMemoryStream & memStream )
     memStream.ReadValue( camera.Settings( ) );
 }
 
+// sqrt( UV area / object space surface area ) for both UV sets - texture space to object space scale, averaged across the mesh
+static vaVector2 ComputeMeshUVDensity( const vaRenderMesh & mesh )
+{
+    auto & triMesh = mesh.GetTriangleMesh( );
+    if( triMesh == nullptr )
+        return vaVector2( 0.0f, 0.0f );
+
+    const auto & vertices   = triMesh->Vertices( );
+    const auto & indices    = triMesh->Indices( );
+    double surfaceArea = 0.0, uv0Area = 0.0, uv1Area = 0.0;
+    for( size_t i = 0; i + 2 < indices.size( ); i += 3 )
+    {
+        const auto & a = vertices[indices[i+0]];
+        const auto & b = vertices[indices[i+1]];
+        const auto & c = vertices[indices[i+2]];
+        surfaceArea += 0.5 * vaVector3::Cross( b.Position - a.Position, c.Position - a.Position ).Length( );
+        uv0Area     += 0.5 * std::abs( ( b.TexCoord0.x - a.TexCoord0.x ) * ( c.TexCoord0.y - a.TexCoord0.y ) - ( c.TexCoord0.x - a.TexCoord0.x ) * ( b.TexCoord0.y - a.TexCoord0.y ) );
+        uv1Area     += 0.5 * std::abs( ( b.TexCoord1.x - a.TexCoord1.x ) * ( c.TexCoord1.y - a.TexCoord1.y ) - ( c.TexCoord1.x - a.TexCoord1.x ) * ( b.TexCoord1.y - a.TexCoord1.y ) );
+    }
+    if( surfaceArea <= 0.0 )
+        return vaVector2( 0.0f, 0.0f );
+    return vaVector2( (float)std::sqrt( uv0Area / surfaceArea ), (float)std::sqrt( uv1Area / surfaceArea ) );
+}
+
 vaTextureReductionTestTool::vaTextureReductionTestTool( const vector<TestItemType> & textures, vector<shared_ptr<vaAssetTexture>> textureAssets )
 { 
 //    assert( vaRenderingCore::IsInitialized() );
@@ -220,16 +246,25 @@ void vaTextureReductionTestTool::TickGPU( vaRenderDeviceContext & renderContext,
         return;
     }
 
+    if( m_predictionRequested )
+    {
+        assert( !m_runningTests );
+        m_predictionRequested = false;
+        PredictReductions( renderContext, colorBuffer );
+        return;
+    }
+
     if( !m_runningTests )
         return;
 
     // we've just started - init and loop
     if( m_currentTexture == -1 )
     {
-        m_currentTexture    = 0;
+        m_currentTexture    = FindNextTextureToTest( 0 );
         m_currentCamera     = 0;
         m_cameraSlotSelectedIndex = 0;
-        m_texturesMaxFoundReduction[m_currentTexture] = vaMath::Clamp( m_maxLevelsToDrop, 0, m_textures[m_currentTexture].first->GetMipLevels( ) - 3 );
+        if( m_currentTexture < (int)m_textures.size( ) )
+            m_texturesMaxFoundReduction[m_currentTexture] = GetSearchLimit( m_currentTexture );
         m_currentSearchReductionCount = 0;
         ResetTextureOverrides( );
         return;
@@ -255,7 +290,7 @@ void vaTextureReductionTestTool::TickGPU( vaRenderDeviceContext & renderContext,
         if( m_currentCamera == 0 )
         {
             // we've just started? start with max and work down
-            m_texturesMaxFoundReduction[m_currentTexture] = vaMath::Clamp( m_maxLevelsToDrop, 0, m_textures[m_currentTexture].first->GetMipLevels( ) - 3 );
+            m_texturesMaxFoundReduction[m_currentTexture] = GetSearchLimit( m_currentTexture );
         }
         return;
     }
@@ -287,7 +322,8 @@ void vaTextureReductionTestTool::TickGPU( vaRenderDeviceContext & renderContext,
         
         if( !timeToEndThisCamera )
         {
-            m_currentSearchReductionCount++;
+            // levels that the CPU pre-pass is confident about don't need to be rendered
+            m_currentSearchReductionCount = ( m_currentSearchReductionCount == 0 ) ? ( GetFirstLevelToTest( m_currentTexture ) ) : ( m_currentSearchReductionCount + 1 );
 
             // set next reduction level (MIP)
             // assert( m_currentlyOverriddenTexture == nullptr );
@@ -316,7 +352,7 @@ void vaTextureReductionTestTool::TickGPU( vaRenderDeviceContext & renderContext,
         if( m_currentCamera == c_cameraSlotCount )
         {
             // next texture
-            m_currentTexture++;
+            m_currentTexture = FindNextTextureToTest( m_currentTexture + 1 );
             if( m_currentTexture == (int)m_textures.size( ) )
             {
                 // finished all? exit
@@ -331,7 +367,7 @@ void vaTextureReductionTestTool::TickGPU( vaRenderDeviceContext & renderContext,
                 // run next
                 m_currentCamera = 0;
                 m_cameraSlotSelectedIndex = 0;
-                m_texturesMaxFoundReduction[m_currentTexture] = vaMath::Clamp( m_maxLevelsToDrop, 0, m_textures[m_currentTexture].first->GetMipLevels( ) - 3 );
+                m_texturesMaxFoundReduction[m_currentTexture] = GetSearchLimit( m_currentTexture );
                 m_currentSearchReductionCount = 0;
                 ResetTextureOverrides( );
             }
@@ -341,6 +377,232 @@ void vaTextureReductionTestTool::TickGPU( vaRenderDeviceContext & renderContext,
 
 }
 
+int vaTextureReductionTestTool::GetSearchLimit( int textureIndex ) const
+{
+    int limit = vaMath::Clamp( m_maxLevelsToDrop, 0, m_textures[textureIndex].first->GetMipLevels( ) - 3 );
+    if( m_verifyAmbiguousOnly && m_texturesPredictionState[textureIndex] != PredictionState::NotPredicted )
+        limit = vaMath::Min( limit, m_texturesPredictedMax[textureIndex] );
+    return limit;
+}
+
+int vaTextureReductionTestTool::GetFirstLevelToTest( int textureIndex ) const
+{
+    if( m_verifyAmbiguousOnly && m_texturesPredictionState[textureIndex] == PredictionState::Ambiguous )
+        return m_texturesPredictedSafe[textureIndex] + 1;
+    return 1;
+}
+
+int vaTextureReductionTestTool::FindNextTextureToTest( int startIndex ) const
+{
+    int i = startIndex;
+    if( m_verifyAmbiguousOnly )
+        while( i < (int)m_textures.size( ) && m_texturesPredictionState[i] == PredictionState::Confident )
+            i++;
+    return i;
+}
+
+bool vaTextureReductionTestTool::ComputeMIPBandErrors( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & texture, int levelCount, vector<float> & outBandMSE )
+{
+    outBandMSE.clear( );
+    if( texture->GetType( ) != vaTextureType::Texture2D || texture->GetArrayCount( ) != 1 || texture->GetSampleCount( ) != 1 )
+        return false;
+
+    vaPostProcess & postProcess = renderContext.GetRenderDevice( ).GetPostProcess( );
+    bool compareInSRGB = vaResourceFormatHelpers::IsSRGB( texture->GetSRVFormat( ) );
+
+    // Band j is the detail that is lost when MIP j is no longer available and MIP j+1 gets magnified in its place; its MSE
+    // is what a pixel sampling at MIP j loses, and pixels sampling at MIP j and finer lose the sum of all dropped bands.
+    for( int j = 0; j < levelCount; j++ )
+    {
+        int sizeX = vaMath::Max( 1, texture->GetSizeX( ) >> j );
+        int sizeY = vaMath::Max( 1, texture->GetSizeY( ) >> j );
+
+        shared_ptr<vaTexture> mipView       = vaTexture::CreateView( texture, vaResourceBindSupportFlags::ShaderResource, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::None, j, 1 );
+        shared_ptr<vaTexture> nextMipView   = vaTexture::CreateView( texture, vaResourceBindSupportFlags::ShaderResource, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::None, j+1, 1 );
+        if( mipView == nullptr || nextMipView == nullptr )
+            return false;
+
+        shared_ptr<vaTexture> original  = vaTexture::Create2D( renderContext.GetRenderDevice( ), vaResourceFormat::R16G16B16A16_FLOAT, sizeX, sizeY, 1, 1, 1, vaResourceBindSupportFlags::ShaderResource | vaResourceBindSupportFlags::RenderTarget );
+        shared_ptr<vaTexture> reduced   = vaTexture::Create2D( renderContext.GetRenderDevice( ), vaResourceFormat::R16G16B16A16_FLOAT, sizeX, sizeY, 1, 1, 1, vaResourceBindSupportFlags::ShaderResource | vaResourceBindSupportFlags::RenderTarget );
+
+        vaVector4 dstRect( 0.0f, 0.0f, (float)sizeX, (float)sizeY );
+        postProcess.StretchRect( renderContext, original, mipView, vaVector4( 0.0f, 0.0f, (float)mipView->GetSizeX( ), (float)mipView->GetSizeY( ) ), dstRect, false );
+        postProcess.StretchRect( renderContext, reduced, nextMipView, vaVector4( 0.0f, 0.0f, (float)nextMipView->GetSizeX( ), (float)nextMipView->GetSizeY( ) ), dstRect, true );
+
+        vaVector4 val = postProcess.CompareImages( renderContext, original, reduced, compareInSRGB );
+        outBandMSE.push_back( val.x );
+    }
+    return true;
+}
+
+void vaTextureReductionTestTool::PredictReductions( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & colorBuffer )
+{
+    VA_TRACE_CPU_SCOPE( TextureReductionPrediction );
+
+    ResetTextureOverrides( );
+
+    shared_ptr<vaScene> scene = m_scene.lock( );
+    if( scene == nullptr )
+    {
+        VA_LOG_WARNING( "vaTextureReductionTestTool::PredictReductions - no scene set (see SetScene), can't predict" );
+        return;
+    }
+
+    VA_LOG( "vaTextureReductionTestTool::PredictReductions starting..." );
+
+    const int texCount      = (int)m_textures.size( );
+    const int bucketCount   = m_maxLevelsToDrop + 1;        // on-screen MIP level buckets; last one is 'unaffected by any reduction'
+
+    std::unordered_map<vaGUID, int, vaGUIDHasher> textureIndices;
+    for( int i = 0; i < texCount; i++ )
+        textureIndices[ m_textures[i].first->UIDObject_GetUID( ) ] = i;
+
+    std::unordered_map<const vaRenderMesh *, vaVector2> meshUVDensities;
+
+    // screen coverage of each texture split by the MIP level it's sampled at: [slot][texture][bucket]
+    vector<float> histograms( (size_t)c_cameraSlotCount * texCount * bucketCount, 0.0f );
+    vector<bool> textureVisible( texCount, false );
+
+    vaRenderCamera slotCamera( renderContext.GetRenderDevice( ), false );
+    for( int slot = 0; slot < c_cameraSlotCount; slot++ )
+    {
+        if( m_cameraSlots[slot] == nullptr )
+            continue;
+
+        LoadCamera( slotCamera, *m_cameraSlots[slot] );
+        slotCamera.SetViewportSize( colorBuffer->GetSizeX( ), colorBuffer->GetSizeY( ) );
+        slotCamera.Tick( 0.0f, false );
+
+        vaRenderSelection selectionOpaque, selectionTransparent;
+        scene->SelectForRendering( &selectionOpaque, &selectionTransparent, vaRenderSelection::FilterSettings::FrustumCull( slotCamera ) );
+
+        const float screenArea          = (float)slotCamera.GetViewportWidth( ) * (float)slotCamera.GetViewportHeight( );
+        const float pixelsPerWorldUnit  = (float)slotCamera.GetViewportHeight( ) / ( 2.0f * std::tan( slotCamera.GetYFOV( ) * 0.5f ) );    // at distance of 1
+        float * slotHistograms          = &histograms[ (size_t)slot * texCount * bucketCount ];
+
+        for( vaRenderSelection * selection : { &selectionOpaque, &selectionTransparent } )
+        {
+            const vaRenderMeshDrawList & drawList = *selection->MeshList;
+            for( int e = 0; e < drawList.Count( ); e++ )
+            {
+                const vaRenderMeshDrawList::Entry & entry = drawList[e];
+                if( entry.Mesh == nullptr || entry.Material == nullptr )
+                    continue;
+
+                auto densityIt = meshUVDensities.find( entry.Mesh.get( ) );
+                if( densityIt == meshUVDensities.end( ) )
+                    densityIt = meshUVDensities.insert( std::make_pair( entry.Mesh.get( ), ComputeMeshUVDensity( *entry.Mesh ) ) ).first;
+                const vaVector2 uvDensity = densityIt->second;
+
+                const float worldScale  = std::cbrt( std::abs( entry.Transform.Determinant( ) ) );
+                const vaVector3 center  = vaVector3::TransformCoord( entry.Mesh->GetAABB( ).Center( ), entry.Transform );
+                const float radius      = entry.Mesh->GetAABB( ).Size.Length( ) * 0.5f * worldScale;
+                const float distance    = vaMath::Max( ( center - slotCamera.GetPosition( ) ).Length( ), slotCamera.GetNearPlaneDistance( ) );
+                if( worldScale <= 0.0f || radius <= 0.0f )
+                    continue;
+
+                // bounding sphere based, no occlusion: overestimates the coverage which errs on the side of caution
+                const float radiusInPixels  = radius * pixelsPerWorldUnit / distance;
+                const float coverage        = vaMath::Min( 1.0f, VA_PIf * radiusInPixels * radiusInPixels / screenArea );
+
+                // object spans a range of distances - take a few samples across it
+                const float sampleDistances[3] = { vaMath::Max( distance - radius * 0.5f, slotCamera.GetNearPlaneDistance( ) ), distance, distance + radius * 0.5f };
+
+                entry.Material->EnumerateTextureNodes( [&]( const vaRenderMaterial::TextureNode & textureNode )
+                {
+                    auto indexIt = textureIndices.find( textureNode.GetTextureUID( ) );
+                    if( indexIt == textureIndices.end( ) )
+                        return;
+                    const int texIndex = indexIt->second;
+                    const vaTexture & texture = *m_textures[texIndex].first;
+
+                    const float texelsPerWorldUnit = ( ( textureNode.GetUVIndex( ) == 1 ) ? ( uvDensity.y ) : ( uvDensity.x ) ) * (float)vaMath::Max( texture.GetSizeX( ), texture.GetSizeY( ) ) / worldScale;
+                    if( texelsPerWorldUnit <= 0.0f )
+                        return;
+
+                    textureVisible[texIndex] = true;
+                    float * histogram = &slotHistograms[ (size_t)texIndex * bucketCount ];
+                    for( float sampleDistance : sampleDistances )
+                    {
+                        // MIP level the sampler picks (ignoring anisotropy); magnification counts as MIP 0
+                        float mip = vaMath::Clamp( vaMath::Log2( texelsPerWorldUnit * sampleDistance / pixelsPerWorldUnit ), 0.0f, (float)( bucketCount - 1 ) );
+                        int mipFloor = (int)mip;
+                        float frac = mip - (float)mipFloor;
+                        histogram[mipFloor] += coverage / 3.0f * ( 1.0f - frac );
+                        if( mipFloor + 1 < bucketCount )
+                            histogram[mipFloor + 1] += coverage / 3.0f * frac;
+                    }
+                } );
+            }
+        }
+    }
+
+    int confidentCount = 0, ambiguousCount = 0, unsupportedCount = 0;
+    for( int i = 0; i < texCount; i++ )
+    {
+        const int levelLimit = vaMath::Clamp( m_maxLevelsToDrop, 0, m_textures[i].first->GetMipLevels( ) - 3 );
+
+        vector<float> bandMSE;
+        if( textureVisible[i] && !ComputeMIPBandErrors( renderContext, m_textures[i].first, levelLimit, bandMSE ) )
+        {
+            m_texturesPredictionState[i] = PredictionState::NotPredicted;
+            m_texturesPredictedPSNR[i].clear( );
+            unsupportedCount++;
+            continue;
+        }
+
+        // worst case across camera slots, just like the render based test
+        vector<float> & predictedPSNR = m_texturesPredictedPSNR[i];
+        predictedPSNR.assign( levelLimit, 100.0f );
+        if( textureVisible[i] )
+        {
+            for( int slot = 0; slot < c_cameraSlotCount; slot++ )
+            {
+                const float * histogram = &histograms[ ( (size_t)slot * texCount + i ) * bucketCount ];
+                float totalCoverage = 0.0f;
+                for( int m = 0; m < bucketCount; m++ )
+                    totalCoverage += histogram[m];
+                if( totalCoverage <= 0.0f )
+                    continue;
+                const float coverageScale = ( totalCoverage > 1.0f ) ? ( 1.0f / totalCoverage ) : ( 1.0f );     // overlapping bounds
+
+                for( int k = 1; k <= levelLimit; k++ )
+                {
+                    // pixels sampling at MIP m < k lose bands m .. k-1
+                    double mse = 0.0;
+                    for( int m = 0; m < k; m++ )
+                    {
+                        double lostEnergy = 0.0;
+                        for( int j = m; j < k; j++ )
+                            lostEnergy += bandMSE[j];
+                        mse += histogram[m] * coverageScale * lostEnergy;
+                    }
+                    float psnr = ( mse > 1e-10 ) ? ( 10.0f * (float)log10( 1.0 / mse ) ) : ( 100.0f );
+                    predictedPSNR[k-1] = vaMath::Min( predictedPSNR[k-1], psnr );
+                }
+            }
+        }
+
+        int safe = 0, maxPossible = 0;
+        while( safe < levelLimit && predictedPSNR[safe] >= m_targetPSNRThreshold + m_predictionMarginPSNR )
+            safe++;
+        while( maxPossible < levelLimit && predictedPSNR[maxPossible] >= m_targetPSNRThreshold - m_predictionMarginPSNR )
+            maxPossible++;
+        maxPossible = vaMath::Max( safe, maxPossible );
+
+        m_texturesPredictedSafe[i]      = safe;
+        m_texturesPredictedMax[i]       = maxPossible;
+        m_texturesPredictionState[i]    = ( safe == maxPossible ) ? ( PredictionState::Confident ) : ( PredictionState::Ambiguous );
+        m_texturesMaxFoundReduction[i]  = safe;
+        if( m_texturesPredictionState[i] == PredictionState::Confident )
+            confidentCount++;
+        else
+            ambiguousCount++;
+    }
+
+    VA_LOG( "vaTextureReductionTestTool::PredictReductions finished: %d textures confident, %d ambiguous (need render based test), %d not supported.", confidentCount, ambiguousCount, unsupportedCount );
+}
+
 void vaTextureReductionTestTool::OverrideAllWithCurrentStates( )
 {
     assert( !m_overrideAll );
@@ -369,6 +631,15 @@ void vaTextureReductionTestTool::ResetData( )
     for( size_t i = 0; i < m_textures.size( ); i++ )
         m_texturesSorted[i] = (int)i;
 
+    m_texturesPredictionState.clear( );
+    m_texturesPredictionState.resize( m_textures.size( ), PredictionState::NotPredicted );
+    m_texturesPredictedSafe.clear( );
+    m_texturesPredictedSafe.resize( m_textures.size( ), 0 );
+    m_texturesPredictedMax.clear( );
+    m_texturesPredictedMax.resize( m_textures.size( ), 0 );
+    m_texturesPredictedPSNR.clear( );
+    m_texturesPredictedPSNR.resize( m_textures.size( ) );
+
     m_runningTests      = false;
     m_currentTexture    = -1;
     m_currentCamera     = -1;
@@ -540,7 +811,7 @@ void vaTextureReductionTestTool::TickUI( vaRenderDevice & device, const shared_p
         {
             //float availableWidth = ImGui::GetContentRegionAvailWidth( ) - ImGui::GetStyle().ScrollbarSize;
 
-            int columnCount = 2;
+            int columnCount = 3;
 
             ImGui::Columns( columnCount, "TextureListColumns", true );
 
@@ -554,6 +825,7 @@ void vaTextureReductionTestTool::TickUI( vaRenderDevice & device, const shared_p
             ImGui::Separator( );
             ImGui::Text( "Texture name" );  ImGui::NextColumn();
             ImGui::Text( "Levels to drop and still stay over threshold" );      ImGui::NextColumn();
+            ImGui::Text( "CPU prediction" );                                    ImGui::NextColumn();
             ImGui::Separator();
 
             for( size_t i = 0; i < m_textures.size(); i++ )
@@ -584,6 +856,17 @@ void vaTextureReductionTestTool::TickUI( vaRenderDevice & device, const shared_p
             {
                 ImGui::Text( "%d", m_texturesMaxFoundReduction[orderVector[i]] );
             }
+            ImGui::NextColumn();
+            for( size_t i = 0; i < m_textures.size( ); i++ )
+            {
+                int index = orderVector[i];
+                switch( m_texturesPredictionState[index] )
+                {
+                case( PredictionState::Confident ): ImGui::Text( "confident: %d", m_texturesPredictedSafe[index] ); break;
+                case( PredictionState::Ambiguous ): ImGui::Text( "ambiguous: %d - %d", m_texturesPredictedSafe[index], m_texturesPredictedMax[index] ); break;
+                default:                            ImGui::Text( "-" ); break;
+                }
+            }
         }
         ImGui::EndChild( );
 
@@ -603,6 +886,17 @@ void vaTextureReductionTestTool::TickUI( vaRenderDevice & device, const shared_p
                 m_targetPSNRThreshold = vaMath::Clamp( m_targetPSNRThreshold, 10.0f, 90.0f );
                 ImGui::InputInt( "Max levels to drop", &m_maxLevelsToDrop, 1 );
                 m_maxLevelsToDrop = vaMath::Clamp( m_maxLevelsToDrop, 1, 15 );
+                ImGui::InputFloat( "CPU prediction PSNR margin", &m_predictionMarginPSNR, 0.5f );
+                m_predictionMarginPSNR = vaMath::Clamp( m_predictionMarginPSNR, 0.0f, 30.0f );
+                ImGui::Checkbox( "Run tests only on textures with ambiguous prediction", &m_verifyAmbiguousOnly );
+
+                if( ImGui::Button( "Predict (CPU pre-pass)" ) )
+                {
+                    ResetTextureOverrides( );
+                    m_predictionRequested = true;
+                    m_downscaleTextureButtonClicks = 2;
+                }
+                ImGui::SameLine( );
 
                 vaVector4 col = vaVector4( 0.0f, 0.0f, 0.4f, 1.0f );
                 ImGui::PushStyleColor( ImGuiCol_Button, ImFromVA( col ) );
@@ -625,10 +919,12 @@ void vaTextureReductionTestTool::TickUI( vaRenderDevice & device, const shared_p
                     VA_LOG( "----------------------------------------------------------------------------------------------------------------------------------------" );
                     VA_LOG( "vaTextureReductionTestTool output:" );
                     VA_LOG( "Using target PSNR threshold of no less than %.1f", m_targetPSNRThreshold );
-                    VA_LOG( "Index, Texture name, Max found reduction" );
+                    VA_LOG( "Index, Texture name, Max found reduction, Predicted safe reduction, Predicted max reduction, Prediction state" );
                     for( size_t i = 0; i < m_textures.size( ); i++ )
                     {
-                        VA_LOG( "%d, %s, %d", i, m_textures[orderVector[i]].second.c_str(), m_texturesMaxFoundReduction[orderVector[i]] );
+                        int index = orderVector[i];
+                        const char * stateNames[] = { "not predicted", "confident", "ambiguous" };
+                        VA_LOG( "%d, %s, %d, %d, %d, %s", i, m_textures[index].second.c_str(), m_texturesMaxFoundReduction[index], m_texturesPredictedSafe[index], m_texturesPredictedMax[index], stateNames[(int)m_texturesPredictionState[index]] );
                     }
                     VA_LOG( "----------------------------------------------------------------------------------------------------------------------------------------" );
                     m_downscaleTextureButtonClicks = 2;
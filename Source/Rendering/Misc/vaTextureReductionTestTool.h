@@ -37,6 +37,7 @@
 namespace Vanilla
 {
     struct vaAssetTexture;
+    class vaScene;
 
     class vaTextureReductionTestTool : public vaSingletonBase<vaTextureReductionTestTool>
     {
@@ -45,6 +46,14 @@ namespace Vanilla
 
         //struct Camera
 
+        // result of the CPU pre-pass (see PredictReductions)
+        enum class PredictionState : int32
+        {
+            NotPredicted,           // no prediction, render based test searches the whole range
+            Confident,              // predicted PSNR clearly over/under the threshold for all levels; render based test can be skipped
+            Ambiguous,              // render based test only needs to search between m_texturesPredictedSafe and m_texturesPredictedMax
+        };
+
     protected:
         vector<TestItemType>                m_textures;
         vector<shared_ptr<vaAssetTexture>>  m_textureAssets;
@@ -85,6 +94,16 @@ namespace Vanilla
 
         bool                                m_overrideAll                   = false;
 
+        // CPU pre-pass data
+        vector<PredictionState>             m_texturesPredictionState;
+        vector<int>                         m_texturesPredictedSafe;        // levels that can be dropped with predicted PSNR over threshold + margin
+        vector<int>                         m_texturesPredictedMax;         // levels that can be dropped with predicted PSNR over threshold - margin
+        vector<vector<float>>               m_texturesPredictedPSNR;        // worst (across camera slots) predicted PSNR; [texture][levelsDropped-1]
+        float                               m_predictionMarginPSNR          = 4.0f;
+        bool                                m_verifyAmbiguousOnly           = true;
+        bool                                m_predictionRequested           = false;
+        weak_ptr<vaScene>                   m_scene;
+
         static bool                         s_supportedByApp;
 
     public:
@@ -101,6 +120,9 @@ namespace Vanilla
 
         bool                        IsEnabled( ) const              { return m_enabled; }
 
+        // required for the CPU pre-pass (texel density is gathered from the scene's render selection for each camera slot)
+        void                        SetScene( const shared_ptr<vaScene> & scene )   { m_scene = scene; }
+
         // ideally you want to automatically stop any scene movement during this
         bool                        IsRunningTests( ) const         { return m_runningTests; }
 
@@ -115,6 +137,16 @@ namespace Vanilla
 
         void                        ResetData( );
         void                        ResetTextureOverrides( );
+
+        // Predicts, without rendering the scene, how many MIP levels each texture can drop. Error of dropping levels is
+        // estimated from the energy of the discarded detail (MSE between each MIP and the upsampled next one) weighted by
+        // the screen coverage and on-screen MIP level of the texture, gathered from the selection of each camera slot.
+        void                        PredictReductions( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & colorBuffer );
+        bool                        ComputeMIPBandErrors( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & texture, int levelCount, vector<float> & outBandMSE );
+
+        int                         GetSearchLimit( int textureIndex ) const;
+        int                         GetFirstLevelToTest( int textureIndex ) const;
+        int                         FindNextTextureToTest( int startIndex ) const;
         //void                        ComputeAveragesAndSort( );
 
     public:
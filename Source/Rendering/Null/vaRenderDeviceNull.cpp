@@ -0,0 +1,544 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Rendering/Null/vaRenderDeviceNull.h"
+#include "Rendering/Null/vaRenderResourcesNull.h"
+
+#include "Core/System/vaFileTools.h"
+#include "Core/System/vaStream.h"
+#include "Core/Misc/vaXXHash.h"
+
+using namespace Vanilla;
+
+static_assert( sizeof( vaRenderRecording::Command ) == 48, "vaRenderRecording::Command is saved and hashed as raw memory - keep it tightly packed" );
+
+void vaRenderRecording::Reset( )
+{
+    m_commands.clear( );
+    m_counters  = Counters( );
+    m_lastWork  = Command( );
+}
+
+void vaRenderRecording::Accumulate( const Command & command )
+{
+    switch( command.Type )
+    {
+    case( CommandType::BeginFrame ):            m_counters.Frames++;                break;
+    case( CommandType::EndFrame ):                                                  break;
+    case( CommandType::SetRenderTargets ):      
+    case( CommandType::SetViewport ):           m_counters.OutputChanges++;         break;
+    case( CommandType::BeginItems ):                                                break;
+    case( CommandType::Draw ):
+    case( CommandType::DrawIndexed ):
+    case( CommandType::Dispatch ):
+    case( CommandType::DispatchIndirect ):
+    {
+        if( command.Type == CommandType::Draw || command.Type == CommandType::DrawIndexed )
+        {
+            int64 instanceCount = ( command.InstanceCount > 0 ) ? ( (int64)command.InstanceCount ) : ( 1 );
+            m_counters.Draws++;
+            m_counters.Instances += instanceCount;
+            if( command.InstanceCount > 0 )
+                m_counters.InstancedDraws++;
+            if( command.Type == CommandType::DrawIndexed )
+            {
+                m_counters.IndexedDraws++;
+                m_counters.Indices += command.Count * instanceCount;
+            }
+            else
+                m_counters.Vertices += command.Count * instanceCount;
+        }
+        else
+            m_counters.Dispatches++;
+
+        if( command.Type != m_lastWork.Type || command.Shaders != m_lastWork.Shaders )
+            m_counters.ShaderChanges++;
+        if( command.Topology != m_lastWork.Topology || command.BlendMode != m_lastWork.BlendMode || command.DepthFunc != m_lastWork.DepthFunc || command.FillMode != m_lastWork.FillMode 
+            || command.CullMode != m_lastWork.CullMode || command.ShadingRate != m_lastWork.ShadingRate || command.Flags != m_lastWork.Flags )
+            m_counters.StateChanges++;
+        if( command.Resources != m_lastWork.Resources )
+            m_counters.BindingChanges++;
+        m_lastWork = command;
+    } break;
+    case( CommandType::UpdateConstantBuffer ):  m_counters.ConstantBufferUpdates++; m_counters.ConstantBufferBytes += command.Count; break;
+    case( CommandType::UpdateBuffer ):          m_counters.BufferUpdates++;         break;
+    case( CommandType::UpdateTexture ):         m_counters.TextureUpdates++;        break;
+    case( CommandType::Clear ):                 m_counters.Clears++;                break;
+    case( CommandType::Copy ):                  m_counters.Copies++;                break;
+    default: assert( false ); break;
+    }
+}
+
+uint64 vaRenderRecording::ComputeHash( ) const
+{
+    return vaXXHash64::Compute( m_commands.data( ), (int64)( m_commands.size( ) * sizeof( Command ) ) );
+}
+
+bool vaRenderRecording::Save( vaStream & outStream ) const
+{
+    VERIFY_TRUE_RETURN_ON_FALSE( outStream.WriteValue<int32>( c_fileVersion ) );
+    VERIFY_TRUE_RETURN_ON_FALSE( outStream.WriteValue<int64>( (int64)m_commands.size( ) ) );
+    if( m_commands.size( ) > 0 )
+        VERIFY_TRUE_RETURN_ON_FALSE( outStream.Write( m_commands.data( ), (int64)( m_commands.size( ) * sizeof( Command ) ) ) );
+    return true;
+}
+
+bool vaRenderRecording::Load( vaStream & inStream )
+{
+    int32 fileVersion = 0;
+    VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<int32>( fileVersion ) );
+    if( fileVersion != c_fileVersion )
+    {
+        VA_LOG_ERROR( L"vaRenderRecording::Load(): unsupported file version" );
+        return false;
+    }
+    int64 commandCount = 0;
+    VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<int64>( commandCount ) );
+    if( commandCount < 0 )
+        return false;
+
+    vector<Command> commands( (size_t)commandCount );
+    if( commandCount > 0 )
+        VERIFY_TRUE_RETURN_ON_FALSE( inStream.Read( commands.data( ), commandCount * (int64)sizeof( Command ) ) );
+    for( const Command & command : commands )
+        if( command.Type >= CommandType::MaxValue )
+            return false;
+
+    Reset( );
+    m_commands = std::move( commands );
+    for( const Command & command : m_commands )
+        Accumulate( command );
+    return true;
+}
+
+void vaRenderRecording::Replay( const std::function<void( const Command & )> & callback ) const
+{
+    for( const Command & command : m_commands )
+        callback( command );
+}
+
+vaShaderResourceNull::vaShaderResourceNull( vaRenderDevice & device ) : m_resourceID( AsNull( device ).AllocateResourceID( ) )
+{
+}
+
+namespace Vanilla
+{
+    // no compiler, no cache - only the search paths (material code looks up shader files through these)
+    class vaShaderManagerNull : public vaShaderManager
+    {
+    public:
+        vaShaderManagerNull( vaRenderDevice & device ) : vaShaderManager( device ) { }
+        ~vaShaderManagerNull( ) { }
+
+    public:
+        virtual void                RegisterShaderSearchPath( const std::wstring & path, bool pushBack = true ) override
+        {
+            wstring cleanedSearchPath = vaFileTools::CleanupPath( path + L"\\", false );
+            if( pushBack )
+                m_searchPaths.push_back( cleanedSearchPath );
+            else
+                m_searchPaths.push_front( cleanedSearchPath );
+        }
+        virtual wstring             FindShaderFile( const wstring & fileName ) override
+        {
+            assert( m_searchPaths.size() > 0 ); // forgot to call RegisterShaderSearchPath?
+            for( unsigned int i = 0; i < m_searchPaths.size( ); i++ )
+            {
+                std::wstring filePath = m_searchPaths[i] + L"\\" + fileName;
+                if( vaFileTools::FileExists( filePath.c_str( ) ) )
+                    return vaFileTools::GetAbsolutePath( filePath );
+                if( vaFileTools::FileExists( ( vaCore::GetWorkingDirectory( ) + filePath ).c_str( ) ) )
+                    return vaFileTools::GetAbsolutePath( vaCore::GetWorkingDirectory( ) + filePath );
+            }
+            if( vaFileTools::FileExists( fileName ) )
+                return vaFileTools::GetAbsolutePath( fileName );
+            if( vaFileTools::FileExists( ( vaCore::GetWorkingDirectory( ) + fileName ).c_str( ) ) )
+                return vaFileTools::GetAbsolutePath( vaCore::GetWorkingDirectory( ) + fileName );
+            return L"";
+        }
+        virtual wstring             GetCacheStoragePath( ) const override                                       { return L""; }
+    };
+}
+
+void RegisterDeviceContextNull( );
+void RegisterRenderGlobalsNull( );
+void RegisterRenderMeshNull( );
+void RegisterRenderMaterialNull( );
+void RegisterLightingNull( );
+void RegisterShaderNull( );
+void RegisterBuffersNull( );
+
+void vaRenderDeviceNull::RegisterModules( )
+{
+    RegisterShaderNull( );
+    RegisterBuffersNull( );
+
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaTexture, vaTextureNull );
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaGPUContextTracer, vaGPUContextTracerNull );
+    RegisterDeviceContextNull( );
+    RegisterRenderGlobalsNull( );
+    RegisterRenderMaterialNull( );
+    RegisterRenderMeshNull( );
+    RegisterLightingNull( );
+}
+
+vaRenderDeviceNull::vaRenderDeviceNull( int backbufferWidth, int backbufferHeight, const vector<wstring> & shaderSearchPaths ) : vaRenderDevice( ),
+    m_backbufferSize( backbufferWidth, backbufferHeight )
+{
+    assert( IsRenderThread() );
+    static bool modulesRegistered = false;
+    if( !modulesRegistered )
+    {
+        modulesRegistered = true;
+        RegisterModules( );
+    }
+
+    Initialize( shaderSearchPaths );
+    InitializeBase( );
+
+    // same as the DX12 device - lets the initialization callbacks run in a frame
+    {
+        BeginFrame( 0.0f );
+        EndAndPresentFrame( );
+    }
+}
+
+vaRenderDeviceNull::~vaRenderDeviceNull( void )
+{
+    assert( IsRenderThread() );
+    assert( !m_frameStarted );
+
+    e_DeviceAboutToBeDestroyed.Invoke();
+
+    // context gets nuked here!
+    m_mainDeviceContext = nullptr;
+    m_backbuffer        = nullptr;
+
+    DeinitializeBase( );
+}
+
+void vaRenderDeviceNull::Initialize( const vector<wstring> & shaderSearchPaths )
+{
+    assert( IsRenderThread() );
+    assert( !m_frameStarted );
+
+    m_adapterNameShort  = "Null";
+    m_adapterNameID     = "Null";
+    m_adapterVendorID   = 0;
+
+    // Shader manager
+    {
+        m_shaderManager = shared_ptr<vaShaderManager>( new vaShaderManagerNull( *this ) );
+        for( auto s : shaderSearchPaths ) m_shaderManager->RegisterShaderSearchPath( s );
+    }
+
+    m_backbuffer = vaTexture::Create2D( *this, vaResourceFormat::R8G8B8A8_UNORM_SRGB, m_backbufferSize.x, m_backbufferSize.y, 1, 1, 1, vaResourceBindSupportFlags::RenderTarget | vaResourceBindSupportFlags::ShaderResource );
+
+    // main context
+    {
+        m_mainDeviceContext = std::shared_ptr< vaRenderDeviceContext >( VA_RENDERING_MODULE_CREATE( vaRenderDeviceContext, *this ) );
+    }
+
+    e_DeviceFullyInitialized.Invoke( *this );
+}
+
+void vaRenderDeviceNull::BeginFrame( float deltaTime )
+{
+    vaRenderDevice::BeginFrame( deltaTime );
+
+    uint32 deltaTimeBits;
+    memcpy( &deltaTimeBits, &deltaTime, sizeof( deltaTimeBits ) );
+
+    vaRenderRecording::Command command;
+    command.Type    = vaRenderRecording::CommandType::BeginFrame;
+    command.Payload = deltaTimeBits;
+    m_recording.Add( command );
+
+    m_mainDeviceContext->BeginFrame( );
+
+    ExecuteAsyncBeginFrameCallbacks( deltaTime );
+}
+
+void vaRenderDeviceNull::EndAndPresentFrame( int vsyncInterval )
+{
+    m_mainDeviceContext->EndFrame( );
+
+    vaRenderRecording::Command command;
+    command.Type    = vaRenderRecording::CommandType::EndFrame;
+    m_recording.Add( command );
+
+    vaRenderDevice::EndAndPresentFrame( vsyncInterval );
+}
+
+namespace
+{
+    // resource ID or 0 for unbound slots
+    template< typename ResourceType >
+    inline uint64 NullResourceID( const shared_ptr<ResourceType> & resource )
+    {
+        return ( resource == nullptr ) ? ( 0 ) : ( AsNull( static_cast<vaShaderResource*>( resource.get( ) ) )->GetResourceID( ) );
+    }
+}
+
+vaRenderDeviceContextNull::vaRenderDeviceContextNull( const vaRenderingModuleParams & params ) : vaRenderDeviceContext( params )
+{
+}
+
+vaRenderDeviceContextNull::~vaRenderDeviceContextNull( )
+{
+}
+
+void vaRenderDeviceContextNull::BeginFrame( )
+{
+    vaRenderDeviceContext::BeginFrame( );
+}
+
+void vaRenderDeviceContextNull::EndFrame( )
+{
+    vaRenderDeviceContext::EndFrame( );
+}
+
+void vaRenderDeviceContextNull::Record( const vaRenderRecording::Command & command )
+{
+    AsNull( GetRenderDevice( ) ).GetRecording( ).Add( command );
+}
+
+void vaRenderDeviceContextNull::BeginItems( vaRenderTypeFlags typeFlags, const vaShaderItemGlobals & shaderGlobals )
+{
+    vaRenderDeviceContext::BeginItems( typeFlags, shaderGlobals );
+    assert( GetRenderDevice( ).IsRenderThread( ) );
+
+    uint64 ids[ _countof( shaderGlobals.ShaderResourceViews ) + _countof( shaderGlobals.ConstantBuffers ) + _countof( shaderGlobals.UnorderedAccessViews ) ];
+    int count = 0;
+    for( int i = 0; i < _countof( shaderGlobals.ShaderResourceViews ); i++ )
+        ids[count++] = NullResourceID( shaderGlobals.ShaderResourceViews[i] );
+    for( int i = 0; i < _countof( shaderGlobals.ConstantBuffers ); i++ )
+        ids[count++] = NullResourceID( shaderGlobals.ConstantBuffers[i] );
+    for( int i = 0; i < _countof( shaderGlobals.UnorderedAccessViews ); i++ )
+        ids[count++] = NullResourceID( shaderGlobals.UnorderedAccessViews[i] );
+
+    vaRenderRecording::Command command;
+    command.Type        = vaRenderRecording::CommandType::BeginItems;
+    command.Count       = (uint32)typeFlags;
+    command.Resources   = vaXXHash64::Compute( ids, sizeof( ids ) );
+    Record( command );
+}
+
+vaDrawResultFlags vaRenderDeviceContextNull::ExecuteItem( const vaGraphicsItem & renderItem )
+{
+    assert( GetRenderDevice().IsRenderThread() );
+
+    // ExecuteTask can only be called in between BeginTasks and EndTasks - call ExecuteSingleItem 
+    assert( (m_itemsStarted & vaRenderTypeFlags::Graphics) != 0 );
+    if( (m_itemsStarted & vaRenderTypeFlags::Graphics) == 0 )
+        return vaDrawResultFlags::UnspecifiedError;
+
+    // must have a vertex shader at least
+    if( renderItem.VertexShader == nullptr || renderItem.VertexShader->IsEmpty() )
+        { assert( false ); return vaDrawResultFlags::UnspecifiedError; }
+
+    uint64 shaders[5] = { 0, 0, 0, 0, 0 };
+
+    vaShader::State shState;
+    if( (shState = AsNull(*renderItem.VertexShader).GetShader( shaders[0] ) ) != vaShader::State::Cooked )
+    {
+        assert( shState != vaShader::State::Empty ); // trying to render with empty vertex shader & this happened between here and the check few lines above? this is VERY weird and possibly a bug
+        return (shState == vaShader::State::Uncooked)?(vaDrawResultFlags::ShadersStillCompiling):(vaDrawResultFlags::UnspecifiedError);
+    }
+
+    // vaShader::State::Empty and vaShader::State::Cooked are both ok but we must abort for uncooked!
+    if( renderItem.PixelShader != nullptr && AsNull(*renderItem.PixelShader).GetShader( shaders[1] ) == vaShader::State::Uncooked )
+        return vaDrawResultFlags::ShadersStillCompiling;
+    if( renderItem.GeometryShader != nullptr && AsNull(*renderItem.GeometryShader).GetShader( shaders[2] ) == vaShader::State::Uncooked )
+        return vaDrawResultFlags::ShadersStillCompiling;
+    if( renderItem.HullShader != nullptr && AsNull(*renderItem.HullShader).GetShader( shaders[3] ) == vaShader::State::Uncooked )
+        return vaDrawResultFlags::ShadersStillCompiling;
+    if( renderItem.DomainShader != nullptr && AsNull(*renderItem.DomainShader).GetShader( shaders[4] ) == vaShader::State::Uncooked )
+        return vaDrawResultFlags::ShadersStillCompiling;
+
+    bool continueWithDraw = true;
+    if( renderItem.PreDrawHook != nullptr )
+        continueWithDraw = renderItem.PreDrawHook( renderItem, *this );
+
+    if( continueWithDraw )
+    {
+        uint64 ids[ _countof( renderItem.ConstantBuffers ) + _countof( renderItem.ShaderResourceViews ) + 3 ];
+        int count = 0;
+        for( int i = 0; i < _countof( renderItem.ConstantBuffers ); i++ )
+            ids[count++] = NullResourceID( renderItem.ConstantBuffers[i] );
+        for( int i = 0; i < _countof( renderItem.ShaderResourceViews ); i++ )
+            ids[count++] = NullResourceID( renderItem.ShaderResourceViews[i] );
+        ids[count++] = NullResourceID( renderItem.VertexBuffer );
+        ids[count++] = ( (uint64)renderItem.VertexBufferByteStride << 32 ) | (uint64)renderItem.VertexBufferByteOffset;
+        ids[count++] = NullResourceID( renderItem.IndexBuffer );
+        assert( count == _countof( ids ) );
+
+        vaRenderRecording::Command command;
+        command.Topology    = (uint8)renderItem.Topology;
+        command.BlendMode   = (uint8)renderItem.BlendMode;
+        command.DepthFunc   = (uint8)renderItem.DepthFunc;
+        command.FillMode    = (uint8)renderItem.FillMode;
+        command.CullMode    = (uint8)renderItem.CullMode;
+        command.ShadingRate = (uint8)renderItem.ShadingRate;
+        command.Flags       = (uint8)( ( renderItem.DepthEnable ? vaRenderRecording::DepthEnable : 0 ) | ( renderItem.DepthWriteEnable ? vaRenderRecording::DepthWriteEnable : 0 ) 
+                                        | ( renderItem.FrontCounterClockwise ? vaRenderRecording::FrontCounterClockwise : 0 ) );
+        command.Shaders     = vaXXHash64::Compute( shaders, sizeof( shaders ) );
+        command.Resources   = vaXXHash64::Compute( ids, sizeof( ids ) );
+
+        switch( renderItem.DrawType )
+        {
+        case( vaGraphicsItem::DrawType::DrawSimple ):
+            command.Type    = vaRenderRecording::CommandType::Draw;
+            command.Count   = renderItem.DrawSimpleParams.VertexCount;
+            command.Start   = renderItem.DrawSimpleParams.StartVertexLocation;
+            break;
+        case( vaGraphicsItem::DrawType::DrawIndexed ):
+            command.Type    = vaRenderRecording::CommandType::DrawIndexed;
+            command.Count   = renderItem.DrawIndexedParams.IndexCount;
+            command.Start   = renderItem.DrawIndexedParams.StartIndexLocation;
+            command.Base    = renderItem.DrawIndexedParams.BaseVertexLocation;
+            break;
+        case( vaGraphicsItem::DrawType::DrawInstanced ):
+            command.Type            = vaRenderRecording::CommandType::Draw;
+            command.Count           = renderItem.DrawSimpleParams.VertexCount;
+            command.Start           = renderItem.DrawSimpleParams.StartVertexLocation;
+            command.InstanceCount   = renderItem.DrawInstancedParams.InstanceCount;
+            command.Payload         = renderItem.DrawInstancedParams.StartInstanceLocation;
+            break;
+        case( vaGraphicsItem::DrawType::DrawIndexedInstanced ):
+            command.Type            = vaRenderRecording::CommandType::DrawIndexed;
+            command.Count           = renderItem.DrawIndexedParams.IndexCount;
+            command.Start           = renderItem.DrawIndexedParams.StartIndexLocation;
+            command.Base            = renderItem.DrawIndexedParams.BaseVertexLocation;
+            command.InstanceCount   = renderItem.DrawInstancedParams.InstanceCount;
+            command.Payload         = renderItem.DrawInstancedParams.StartInstanceLocation;
+            break;
+        default:
+            assert( false );
+            return vaDrawResultFlags::UnspecifiedError;
+        }
+        Record( command );
+    }
+
+    if( renderItem.PostDrawHook != nullptr )
+        renderItem.PostDrawHook( renderItem, *this );
+
+    return vaDrawResultFlags::None;
+}
+
+vaDrawResultFlags vaRenderDeviceContextNull::ExecuteItem( const vaComputeItem & computeItem )
+{
+    assert( GetRenderDevice().IsRenderThread() );
+    // ExecuteTask can only be called in between BeginTasks and EndTasks - call ExecuteSingleItem 
+    assert( (m_itemsStarted & vaRenderTypeFlags::Compute) != 0 );
+    if( (m_itemsStarted & vaRenderTypeFlags::Compute) == 0 )
+        return vaDrawResultFlags::UnspecifiedError;
+
+    // must have compute shader at least
+    if( computeItem.ComputeShader == nullptr || computeItem.ComputeShader->IsEmpty() )
+        { assert( false ); return vaDrawResultFlags::UnspecifiedError; }
+
+    uint64 shaderHash = 0;
+    vaShader::State shState;
+    if( ( shState = AsNull(*computeItem.ComputeShader).GetShader( shaderHash ) ) != vaShader::State::Cooked )
+    {
+        assert( shState != vaShader::State::Empty ); // trying to render with empty compute shader & this happened between here and the check few lines above? this is VERY weird and possibly a bug
+        return (shState == vaShader::State::Uncooked)?(vaDrawResultFlags::ShadersStillCompiling):(vaDrawResultFlags::UnspecifiedError);
+    }
+
+    bool continueWithDispatch = true;
+    if( computeItem.PreComputeHook != nullptr )
+        continueWithDispatch = computeItem.PreComputeHook( computeItem, *this );
+
+    if( continueWithDispatch )
+    {
+        uint64 ids[ _countof( computeItem.ConstantBuffers ) + _countof( computeItem.ShaderResourceViews ) + _countof( computeItem.UnorderedAccessViews ) ];
+        int count = 0;
+        for( int i = 0; i < _countof( computeItem.ConstantBuffers ); i++ )
+            ids[count++] = NullResourceID( computeItem.ConstantBuffers[i] );
+        for( int i = 0; i < _countof( computeItem.ShaderResourceViews ); i++ )
+            ids[count++] = NullResourceID( computeItem.ShaderResourceViews[i] );
+        for( int i = 0; i < _countof( computeItem.UnorderedAccessViews ); i++ )
+            ids[count++] = NullResourceID( computeItem.UnorderedAccessViews[i] );
+
+        vaRenderRecording::Command command;
+        command.Flags       = (uint8)( ( computeItem.GlobalUAVBarrierBefore ? vaRenderRecording::UAVBarrierBefore : 0 ) | ( computeItem.GlobalUAVBarrierAfter ? vaRenderRecording::UAVBarrierAfter : 0 ) );
+        command.Shaders     = shaderHash;
+        command.Resources   = vaXXHash64::Compute( ids, sizeof( ids ) );
+
+        switch( computeItem.ComputeType )
+        {
+        case( vaComputeItem::Dispatch ):
+            command.Type    = vaRenderRecording::CommandType::Dispatch;
+            command.Count   = computeItem.DispatchParams.ThreadGroupCountX;
+            command.Start   = computeItem.DispatchParams.ThreadGroupCountY;
+            command.Base    = (int32)computeItem.DispatchParams.ThreadGroupCountZ;
+            break;
+        case( vaComputeItem::DispatchIndirect ):
+            command.Type    = vaRenderRecording::CommandType::DispatchIndirect;
+            command.Start   = computeItem.DispatchIndirectParams.AlignedOffsetForArgs;
+            command.Payload = NullResourceID( computeItem.DispatchIndirectParams.BufferForArgs );
+            break;
+        default:
+            assert( false );
+            return vaDrawResultFlags::UnspecifiedError;
+        }
+        Record( command );
+    }
+
+    return vaDrawResultFlags::None;
+}
+
+void vaRenderDeviceContextNull::UpdateViewport( )
+{
+    const vaViewport & viewport = m_outputsState.Viewport;
+    vaRecti scissorRect = ( m_outputsState.ScissorRectEnabled ) ? ( m_outputsState.ScissorRect ) : ( vaRecti( 0, 0, 0, 0 ) );
+
+    vaRenderRecording::Command command;
+    command.Type        = vaRenderRecording::CommandType::SetViewport;
+    command.Flags       = (uint8)m_outputsState.ScissorRectEnabled;
+    command.Payload     = vaXXHash64::Compute( &scissorRect, sizeof( scissorRect ), vaXXHash64::Compute( &viewport, sizeof( viewport ) ) );
+    Record( command );
+}
+
+void vaRenderDeviceContextNull::UpdateRenderTargetsDepthStencilUAVs( )
+{
+    uint64 ids[ _countof( m_outputsState.RenderTargets ) + _countof( m_outputsState.UAVs ) + _countof( m_outputsState.UAVInitialCounts ) + 1 ];
+    int count = 0;
+    for( int i = 0; i < _countof( m_outputsState.RenderTargets ); i++ )
+        ids[count++] = NullResourceID( m_outputsState.RenderTargets[i] );
+    for( int i = 0; i < _countof( m_outputsState.UAVs ); i++ )
+        ids[count++] = NullResourceID( m_outputsState.UAVs[i] );
+    for( int i = 0; i < _countof( m_outputsState.UAVInitialCounts ); i++ )
+        ids[count++] = m_outputsState.UAVInitialCounts[i];
+    ids[count++] = NullResourceID( m_outputsState.DepthStencil );
+
+    vaRenderRecording::Command command;
+    command.Type        = vaRenderRecording::CommandType::SetRenderTargets;
+    command.Count       = m_outputsState.RenderTargetCount;
+    command.Start       = m_outputsState.UAVsStartSlot;
+    command.Base        = (int32)m_outputsState.UAVCount;
+    command.Resources   = vaXXHash64::Compute( ids, sizeof( ids ) );
+    Record( command );
+}
+
+void RegisterDeviceContextNull( )
+{
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaRenderDeviceContext, vaRenderDeviceContextNull );
+}
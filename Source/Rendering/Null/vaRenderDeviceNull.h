@@ -0,0 +1,248 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Core/vaCoreIncludes.h"
+
+#include "Rendering/vaRenderDevice.h"
+#include "Rendering/vaRenderDeviceContext.h"
+#include "Rendering/vaShader.h"
+
+namespace Vanilla
+{
+    class vaStream;
+
+    // Null rendering API: a vaRenderDevice (plus context, textures, buffers and shaders) that talks to no GPU and compiles
+    // no shaders, but keeps the whole platform independent rendering path - scene selection, mesh manager draw lists,
+    // material shader/state setup, render globals, constant buffer updates - running exactly as it would on DX12. Every
+    // vaGraphicsItem/vaComputeItem (and anything else the GPU would see: output changes, buffer/texture updates, clears,
+    // copies) is reduced to a small POD vaRenderRecording::Command, which makes it usable for headless CPU frame benchmarks
+    // and for verifying that two runs submitted the same work (compare vaRenderRecording::ComputeHash).
+    //
+    // Resources and shaders are identified by IDs that only depend on creation order (resources) or creation parameters
+    // (shaders), so recordings are stable across runs of the same code. Textures are not loaded (Import creates a 1x1
+    // placeholder) and only CPU-mappable textures and vertex buffers keep any memory.
+    //
+    // Effect modules that have only API specific implementations (post process, GBuffer, skybox, CMAA2, ...) are not
+    // registered for this device.
+    class vaRenderRecording
+    {
+    public:
+        enum class CommandType : uint8
+        {
+            BeginFrame,
+            EndFrame,
+            SetRenderTargets,           // Resources: RTs/DSV/UAVs, Count: RT count, Start: UAV start slot, Base: UAV count
+            SetViewport,                // Payload: viewport and scissor rect
+            BeginItems,                 // Resources: vaShaderItemGlobals, Count: vaRenderTypeFlags
+            Draw,                       // Count: vertex count, Start: start vertex, InstanceCount: 0 if not instanced, Payload: start instance
+            DrawIndexed,                // Count: index count, Start: start index, Base: base vertex, InstanceCount: 0 if not instanced, Payload: start instance
+            Dispatch,                   // Count/Start/Base: thread group count X/Y/Z
+            DispatchIndirect,           // Resources: args buffer, Start: args offset
+            UpdateConstantBuffer,       // Resources: buffer, Count: bytes, Payload: data hash
+            UpdateBuffer,               // Resources: buffer, Count: bytes, Payload: data hash
+            UpdateTexture,              // Resources: texture, Count: bytes, Start: first subresource, Payload: data hash
+            Clear,                      // Resources: texture, Count: 0 - RTV, 1 - UAV uint, 2 - UAV float, 3 - DSV, Payload: clear value hash
+            Copy,                       // Resources: src and dst, Count/Start: src/dst subresource for resolves
+
+            MaxValue
+        };
+
+        enum CommandFlags : uint8
+        {
+            DepthEnable             = ( 1 << 0 ),
+            DepthWriteEnable        = ( 1 << 1 ),
+            FrontCounterClockwise   = ( 1 << 2 ),
+            UAVBarrierBefore        = ( 1 << 3 ),
+            UAVBarrierAfter         = ( 1 << 4 ),
+        };
+
+        // 48 bytes, no padding - the whole recording gets hashed and saved as one block
+        struct Command
+        {
+            CommandType                     Type                = CommandType::MaxValue;
+            uint8                           Topology            = 0;
+            uint8                           BlendMode           = 0;
+            uint8                           DepthFunc           = 0;
+            uint8                           FillMode            = 0;
+            uint8                           CullMode            = 0;
+            uint8                           ShadingRate         = 0;
+            uint8                           Flags               = 0;        // CommandFlags
+            uint32                          Count               = 0;
+            uint32                          Start               = 0;
+            int32                           Base                = 0;
+            uint32                          InstanceCount       = 0;        // draws only; 0 for non-instanced draws
+            uint64                          Shaders             = 0;        // hash of all shader contents hashes used by the item
+            uint64                          Resources           = 0;        // hash of all bound resource IDs (or the resource ID for updates/clears)
+            uint64                          Payload             = 0;
+        };
+
+        struct Counters
+        {
+            int64                           Frames                  = 0;
+            int64                           Draws                   = 0;        // both indexed and non-indexed
+            int64                           IndexedDraws            = 0;
+            int64                           InstancedDraws          = 0;
+            int64                           Instances               = 0;        // all instances drawn (1 for non-instanced draws)
+            int64                           Dispatches              = 0;
+            int64                           Vertices                = 0;        // for all instances
+            int64                           Indices                 = 0;        // for all instances
+            int64                           ShaderChanges           = 0;        // draws/dispatches that use a different set of shaders than the previous one
+            int64                           StateChanges            = 0;        // draws/dispatches with different fixed function states than the previous one
+            int64                           BindingChanges          = 0;        // draws/dispatches with different bound resources than the previous one
+            int64                           ConstantBufferUpdates   = 0;
+            int64                           ConstantBufferBytes     = 0;
+            int64                           BufferUpdates           = 0;
+            int64                           TextureUpdates          = 0;
+            int64                           Clears                  = 0;
+            int64                           Copies                  = 0;
+            int64                           OutputChanges           = 0;        // render target and viewport changes
+        };
+
+    private:
+        vector<Command>                     m_commands;
+        Counters                            m_counters;
+        Command                             m_lastWork;                         // previous draw/dispatch, for the ...Changes counters
+        bool                                m_recordingEnabled  = true;
+
+        static const int32                  c_fileVersion       = 2;
+
+    public:
+        vaRenderRecording( )                { }
+
+        // drops the recorded commands (keeps the storage) and zeroes the counters
+        void                                Reset( );
+
+        // when disabled only the counters get updated
+        void                                SetRecordingEnabled( bool enabled )                 { m_recordingEnabled = enabled; }
+        bool                                IsRecordingEnabled( ) const                         { return m_recordingEnabled; }
+
+        void                                Add( const Command & command )                      { Accumulate( command ); if( m_recordingEnabled ) m_commands.push_back( command ); }
+
+        const vector<Command> &             GetCommands( ) const                                { return m_commands; }
+        const Counters &                    GetCounters( ) const                                { return m_counters; }
+
+        uint64                              ComputeHash( ) const;
+
+        bool                                Save( vaStream & outStream ) const;
+        // replaces the current contents; counters get recomputed from the loaded commands
+        bool                                Load( vaStream & inStream );
+
+        // calls the callback for each recorded command, in submission order
+        void                                Replay( const std::function<void( const Command & )> & callback ) const;
+
+    private:
+        void                                Accumulate( const Command & command );
+    };
+
+    // base for all null resources that can be bound - just an ID
+    class vaShaderResourceNull : public virtual vaShaderResource
+    {
+        uint64 const                        m_resourceID;
+
+    protected:
+        explicit vaShaderResourceNull( vaRenderDevice & device );
+
+    public:
+        virtual ~vaShaderResourceNull( )    { }
+
+        uint64                              GetResourceID( ) const                              { return m_resourceID; }
+    };
+
+    class vaRenderDeviceNull : public vaRenderDevice
+    {
+        shared_ptr<vaTexture>               m_backbuffer;
+        vaVector2i                          m_backbufferSize;
+
+        vaRenderRecording                   m_recording;
+        std::atomic_uint64_t                m_lastResourceID    = 0;
+
+    public:
+        vaRenderDeviceNull( int backbufferWidth = 1920, int backbufferHeight = 1080, const vector<wstring> & shaderSearchPaths = { vaCore::GetExecutableDirectory( ), vaCore::GetExecutableDirectory( ) + L"../Source/Rendering/Shaders" } );
+        virtual ~vaRenderDeviceNull( void );
+
+    private:
+        void                                Initialize( const vector<wstring> & shaderSearchPaths );
+
+    public:
+        // there is no swap chain - only a backbuffer texture of the size given at construction
+        virtual void                        CreateSwapChain( int width, int height, HWND hwnd, vaFullscreenState fullscreenState ) override    { width; height; hwnd; fullscreenState; assert( false ); }
+        virtual bool                        ResizeSwapChain( int width, int height, vaFullscreenState fullscreenState ) override               { width; height; fullscreenState; return false; }
+        virtual shared_ptr<vaTexture>       GetCurrentBackbuffer( ) const override                                          { return m_backbuffer; }
+        virtual bool                        IsSwapChainCreated( ) const override                                            { return false; }
+        virtual void                        SetWindowed( ) override                                                         { }
+
+        virtual void                        BeginFrame( float deltaTime ) override;
+        virtual void                        EndAndPresentFrame( int vsyncInterval = 0 ) override;
+
+        virtual vaShaderManager &           GetShaderManager( ) override                                                    { return *m_shaderManager; }
+
+        virtual string                      GetAPIName( ) const override                                                    { return StaticGetAPIName(); }
+        static string                       StaticGetAPIName( )                                                             { return "Null"; }
+
+        static void                         RegisterModules( );
+
+        vaRenderRecording &                 GetRecording( )                                                                 { return m_recording; }
+        const vaRenderRecording &           GetRecording( ) const                                                           { return m_recording; }
+
+        uint64                              AllocateResourceID( )                                                           { return ++m_lastResourceID; }
+
+    protected:
+        // no ImGui (no window to draw it to)
+        virtual void                        ImGuiCreate( ) override                                                         { }
+        virtual void                        ImGuiDestroy( ) override                                                        { }
+        virtual void                        ImGuiNewFrame( ) override                                                       { }
+        virtual void                        ImGuiEndFrameAndRender( vaRenderDeviceContext & renderContext ) override        { renderContext; }
+    };
+
+    class vaRenderDeviceContextNull : public vaRenderDeviceContext
+    {
+        VA_RENDERING_MODULE_MAKE_FRIENDS( );
+
+    protected:
+        explicit                            vaRenderDeviceContextNull( const vaRenderingModuleParams & params );
+        virtual                             ~vaRenderDeviceContextNull( );
+
+    public:
+        virtual void                        BeginFrame( ) override;
+        virtual void                        EndFrame( ) override;
+
+        virtual vaDrawResultFlags           ExecuteItem( const vaGraphicsItem & renderItem ) override;
+        virtual vaDrawResultFlags           ExecuteItem( const vaComputeItem & computeItem ) override;
+
+        // adds a command to the device's recording
+        void                                Record( const vaRenderRecording::Command & command );
+
+    protected:
+        virtual void                        BeginItems( vaRenderTypeFlags typeFlags, const vaShaderItemGlobals & shaderGlobals ) override;
+
+    private:
+        virtual void                        UpdateViewport( ) override;
+        virtual void                        UpdateRenderTargetsDepthStencilUAVs( ) override;
+    };
+
+    inline vaRenderDeviceNull &             AsNull( vaRenderDevice & device )                   { return *device.SafeCast<vaRenderDeviceNull*>(); }
+    inline vaRenderDeviceNull *             AsNull( vaRenderDevice * device )                   { return device->SafeCast<vaRenderDeviceNull*>(); }
+    inline vaRenderDeviceContextNull &      AsNull( vaRenderDeviceContext & context )           { return *context.SafeCast<vaRenderDeviceContextNull*>(); }
+    inline vaRenderDeviceContextNull *      AsNull( vaRenderDeviceContext * context )           { return context->SafeCast<vaRenderDeviceContextNull*>(); }
+    inline vaShaderResourceNull &           AsNull( vaShaderResource & resource )               { return *resource.SafeCast<vaShaderResourceNull*>(); }
+    inline vaShaderResourceNull *           AsNull( vaShaderResource * resource )               { return resource->SafeCast<vaShaderResourceNull*>(); }
+
+}
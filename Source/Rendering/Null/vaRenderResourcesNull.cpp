@@ -0,0 +1,702 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Rendering/Null/vaRenderResourcesNull.h"
+
+#include "Rendering/vaRenderGlobals.h"
+#include "Rendering/vaRenderMaterial.h"
+#include "Rendering/vaRenderMesh.h"
+#include "Rendering/vaLighting.h"
+
+#include "Core/Misc/vaXXHash.h"
+#include "Core/System/vaStream.h"
+
+namespace Vanilla
+{
+    class vaRenderGlobalsNull : public vaRenderGlobals
+    {
+        VA_RENDERING_MODULE_MAKE_FRIENDS( );
+
+    protected:
+        vaRenderGlobalsNull( const vaRenderingModuleParams & params ) : vaRenderGlobals( params ) { }
+        ~vaRenderGlobalsNull( ) { }
+
+    private:
+        // nothing ever gets written by the (non-existent) shaders
+        virtual void                    UpdateDebugOutputFloats( vaSceneDrawContext & drawContext ) override    { drawContext; }
+    };
+
+    class vaRenderMaterialNull : public vaRenderMaterial
+    {
+        VA_RENDERING_MODULE_MAKE_FRIENDS( );
+
+    protected:
+        vaRenderMaterialNull( const vaRenderingModuleParams & params ) : vaRenderMaterial( params ) { }
+        ~vaRenderMaterialNull( ) { }
+    };
+
+    class vaRenderMeshManagerNull : public vaRenderMeshManager
+    {
+        VA_RENDERING_MODULE_MAKE_FRIENDS( );
+
+    protected:
+        vaRenderMeshManagerNull( const vaRenderingModuleParams & params ) : vaRenderMeshManager( params ) { }
+        ~vaRenderMeshManagerNull( ) { }
+    };
+
+    class vaLightingNull : public vaLighting
+    {
+        VA_RENDERING_MODULE_MAKE_FRIENDS( );
+
+    protected:
+        explicit vaLightingNull( const vaRenderingModuleParams & params ) : vaLighting( params ) { }
+        ~vaLightingNull( ) { }
+    };
+}
+
+using namespace Vanilla;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// shaders
+
+vaShaderNull::vaShaderNull( const vaRenderingModuleParams & params ) : vaShader( params )
+{
+    assert( GetRenderDevice().IsRenderThread() );  // creation only supported from main thread for now
+}
+//
+vaShaderNull::~vaShaderNull( )
+{
+    std::unique_lock<mutex> allShaderDataLock( m_allShaderDataMutex );
+    assert( m_destroyed );
+}
+//
+void vaShaderNull::SafeDestruct( )
+{
+    assert( GetRenderDevice( ).IsRenderThread( ) );  // creation only supported from main thread for now
+    vaBackgroundTaskManager::GetInstance( ).WaitUntilFinished( m_backgroundCreationTask );
+
+    std::unique_lock<mutex> allShaderDataLock( m_allShaderDataMutex );
+    DestroyShaderBase( );
+    m_destroyed = true;
+}
+//
+void vaShaderNull::CreateShaderFromFile( const wstring & filePath, const string & shaderModel, const string & entryPoint, const vaShaderMacroContaner & macros, bool forceImmediateCompile )
+{
+    forceImmediateCompile; // unreferenced
+    vaShader::CreateShaderFromFile( filePath, shaderModel, entryPoint, macros, true );
+}
+//
+void vaShaderNull::CreateShaderFromBuffer( const string & shaderCode, const string & shaderModel, const string & entryPoint, const vaShaderMacroContaner & macros, bool forceImmediateCompile )
+{
+    forceImmediateCompile; // unreferenced
+    vaShader::CreateShaderFromBuffer( shaderCode, shaderModel, entryPoint, macros, true );
+}
+//
+void vaShaderNull::Clear( )
+{
+    assert( GetRenderDevice().IsRenderThread() );  // creation/cleaning only supported from main thread for now
+    vaBackgroundTaskManager::GetInstance().WaitUntilFinished( m_backgroundCreationTask );
+
+    std::unique_lock<mutex> allShaderDataLock( m_allShaderDataMutex ); 
+    m_state             = vaShader::State::Empty;
+    m_uniqueContentsID  = -1;
+    DestroyShader( );
+    m_entryPoint        = "";
+    m_shaderFilePath    = L"";
+    m_shaderCode        = "";
+    m_shaderModel       = "";
+}
+//
+void vaShaderNull::DestroyShaderBase( )
+{
+    m_allShaderDataMutex.assert_locked_by_caller();
+
+    m_lastLoadedFromCache   = false;
+    m_contentsHash          = 0;
+    if( m_state != State::Empty )
+    {
+        m_state             = State::Uncooked;
+        m_uniqueContentsID  = -1;
+        m_lastError         = "";
+    }
+}
+//
+void vaShaderNull::CreateShaderBase( const string & additionalKey )
+{
+    m_allShaderDataMutex.assert_locked_by_caller();
+
+    // unlike m_uniqueContentsID this only depends on what the shader was created from, so it is the same across runs
+    vaXXHash64 hash;
+    hash.AddString( m_shaderFilePath );
+    hash.AddString( m_shaderCode );
+    hash.AddString( m_entryPoint );
+    hash.AddString( m_shaderModel );
+    hash.AddValue( (int32)m_macros.size( ) );
+    for( const auto & macro : m_macros )
+    {
+        hash.AddString( macro.first );
+        hash.AddString( macro.second );
+    }
+    hash.AddString( additionalKey );
+    m_contentsHash = hash.Digest( );
+
+    m_state             = State::Cooked;
+    m_uniqueContentsID  = ++s_lastUniqueShaderContentsID;
+    m_lastError         = "";
+}
+//
+void vaVertexShaderNull::CreateShaderAndILFromFile( const wstring & filePath, const string & shaderModel, const string & entryPoint, const vector<vaVertexInputElementDesc> & inputLayoutElements, const vaShaderMacroContaner & macros, bool forceImmediateCompile )
+{
+    assert( filePath != L"" && entryPoint != "" && shaderModel != "" );
+    assert( GetRenderDevice().IsRenderThread() );  // creation only supported from main thread for now
+    vaBackgroundTaskManager::GetInstance().WaitUntilFinished( m_backgroundCreationTask );
+
+    {
+        std::unique_lock<mutex> allShaderDataLock( m_allShaderDataMutex ); 
+        m_inputLayout = vaVertexInputLayoutDesc( inputLayoutElements );
+    }
+
+    vaShaderNull::CreateShaderFromFile( filePath, shaderModel, entryPoint, macros, forceImmediateCompile );
+}
+//
+void vaVertexShaderNull::CreateShaderAndILFromBuffer( const string & shaderCode, const string & shaderModel, const string & entryPoint, const vector<vaVertexInputElementDesc> & inputLayoutElements, const vaShaderMacroContaner & macros, bool forceImmediateCompile )
+{
+    assert( shaderCode != "" && entryPoint != "" && shaderModel != "" );
+    assert( GetRenderDevice().IsRenderThread() );  // creation only supported from main thread for now
+    vaBackgroundTaskManager::GetInstance().WaitUntilFinished( m_backgroundCreationTask );
+
+    {
+        std::unique_lock<mutex> allShaderDataLock( m_allShaderDataMutex ); 
+        m_inputLayout = vaVertexInputLayoutDesc( inputLayoutElements );
+    }
+
+    vaShaderNull::CreateShaderFromBuffer( shaderCode, shaderModel, entryPoint, macros, forceImmediateCompile );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// textures
+
+vaTextureNull::vaTextureNull( const vaRenderingModuleParams & params ) : vaTexture( params ), vaShaderResourceNull( params.RenderDevice )
+{
+}
+
+vaTextureNull::~vaTextureNull( )
+{
+    Destroy( );
+}
+
+void vaTextureNull::Destroy( )
+{
+    assert( !IsMapped() );
+    m_CPUData.clear( );
+    m_mappedData.clear( );
+    // reset the keep-alive ptr - all weak_ptr-s pointing to this will become invalid from now!
+    m_smartThis = std::make_shared<vaTexture*>(this);
+}
+
+bool vaTextureNull::Import( const wstring & storageFilePath, vaTextureLoadFlags loadFlags, vaResourceBindSupportFlags binds, vaTextureContentsType contentsType )
+{
+    storageFilePath; // unreferenced - nothing gets loaded
+    return Import( nullptr, 0, loadFlags, binds, contentsType );
+}
+
+bool vaTextureNull::Import( void * buffer, uint64 bufferSize, vaTextureLoadFlags loadFlags, vaResourceBindSupportFlags binds, vaTextureContentsType contentsType )
+{
+    buffer; bufferSize; // unreferenced - nothing gets loaded
+
+    Destroy( );
+
+    // 1x1 placeholder so that everything that samples from it still gets a valid binding
+    vaResourceFormat format = ( ( loadFlags & vaTextureLoadFlags::PresumeDataIsLinear ) != 0 ) ? ( vaResourceFormat::R8G8B8A8_UNORM ) : ( vaResourceFormat::R8G8B8A8_UNORM_SRGB );
+    return InternalCreate( vaTextureType::Texture2D, format, 1, 1, 1, 1, 1, 1, binds, vaResourceAccessFlags::Default, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, 
+        vaTextureFlags::None, contentsType, nullptr, 0, 0 );
+}
+
+bool vaTextureNull::LoadAPACK( vaStream & inStream )
+{
+    Destroy( );
+    InitializePreLoadDefaults( );
+
+    int32 fileVersion = 0;
+    VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<int32>( fileVersion ) );
+
+    // support old format - the header is just skipped
+    if( fileVersion == 2 )
+    {
+        vaTextureFlags dummyFlags;                  VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<vaTextureFlags          >( dummyFlags ) );
+        vaResourceAccessFlags dummyAccessFlags;     VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<vaResourceAccessFlags   >( dummyAccessFlags ) );
+        vaTextureType dummyType;                    VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<vaTextureType           >( dummyType ) );
+        vaResourceBindSupportFlags dummyBindFlags;  VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<vaResourceBindSupportFlags >( dummyBindFlags ) );
+
+        VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<vaTextureContentsType   >( m_contentsType ) );
+
+        vaResourceFormat dummyFormats[5];
+        for( int i = 0; i < _countof( dummyFormats ); i++ )
+            VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<vaResourceFormat    >( dummyFormats[i] ) );
+        int dummySizes[5];
+        for( int i = 0; i < _countof( dummySizes ); i++ )
+            VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<int                 >( dummySizes[i] ) );
+    }
+    else if( fileVersion == c_fileVersion )
+    {
+        VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<vaTextureContentsType     >( m_contentsType ) );
+    }
+    else
+    {
+        VA_LOG( L"vaTextureNull::LoadAPACK(): unsupported file version" );
+        return false;
+    }
+
+    int64 textureDataSize;
+    VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<int64                     >( textureDataSize ) );
+    VERIFY_TRUE_RETURN_ON_FALSE( textureDataSize >= 0 && inStream.GetPosition( ) + textureDataSize <= inStream.GetLength( ) );
+    inStream.Seek( inStream.GetPosition( ) + textureDataSize );
+
+    return Import( nullptr, 0, vaTextureLoadFlags::Default, m_bindSupportFlags, m_contentsType );
+}
+
+bool vaTextureNull::SerializeUnpacked( vaXMLSerializer & serializer, const wstring & assetFolder )
+{
+    assetFolder; // unreferenced - Texture.dds never gets opened
+
+    if( !serializer.IsReading( ) )
+        return false;
+
+    InitializePreLoadDefaults( );
+
+    int32 fileVersion = c_fileVersion;
+    VERIFY_TRUE_RETURN_ON_FALSE( serializer.Serialize<int32>( "FileVersion", fileVersion ) );
+    VERIFY_TRUE_RETURN_ON_FALSE( fileVersion == c_fileVersion );
+    VERIFY_TRUE_RETURN_ON_FALSE( serializer.Serialize<int32>( "contentsType", (int32&)m_contentsType ) );
+
+    return Import( nullptr, 0, vaTextureLoadFlags::Default, m_bindSupportFlags, m_contentsType );
+}
+
+void vaTextureNull::ResolveAutomaticFormats( )
+{
+    if( ( m_bindSupportFlags & vaResourceBindSupportFlags::ShaderResource ) != 0 && m_srvFormat == vaResourceFormat::Automatic )
+        m_srvFormat = m_resourceFormat;
+    if( ( m_bindSupportFlags & vaResourceBindSupportFlags::RenderTarget ) != 0 && m_rtvFormat == vaResourceFormat::Automatic )
+        m_rtvFormat = m_resourceFormat;
+    if( ( m_bindSupportFlags & vaResourceBindSupportFlags::DepthStencil ) != 0 && m_dsvFormat == vaResourceFormat::Automatic )
+        m_dsvFormat = m_resourceFormat;
+    if( ( m_bindSupportFlags & vaResourceBindSupportFlags::UnorderedAccess ) != 0 && m_uavFormat == vaResourceFormat::Automatic )
+        m_uavFormat = m_resourceFormat;
+}
+
+bool vaTextureNull::InternalCreate( vaTextureType type, vaResourceFormat format, int sizeX, int sizeY, int sizeZ, int mipLevels, int arrayCount, int sampleCount, vaResourceBindSupportFlags bindFlags, vaResourceAccessFlags accessFlags, 
+    vaResourceFormat srvFormat, vaResourceFormat rtvFormat, vaResourceFormat dsvFormat, vaResourceFormat uavFormat, vaTextureFlags flags, vaTextureContentsType contentsType, void * initialData, int initialDataRowPitch, int initialDataSlicePitch )
+{
+    initialDataSlicePitch; // unreferenced - only the top 2D slice gets kept
+
+    Initialize( bindFlags, accessFlags, format, srvFormat, rtvFormat, dsvFormat, uavFormat, flags, 0, -1, 0, -1, contentsType );
+
+    // 0 means full MIP chain, same as on the GPU
+    if( mipLevels == 0 )
+    {
+        int largest = vaMath::Max( sizeX, vaMath::Max( sizeY, sizeZ ) );
+        mipLevels = 1;
+        while( largest > 1 ) { largest /= 2; mipLevels++; }
+    }
+
+    m_type                  = type;
+    m_sizeX                 = sizeX;
+    m_sizeY                 = sizeY;
+    m_sizeZ                 = sizeZ;
+    m_mipLevels             = mipLevels;
+    m_arrayCount            = arrayCount;
+    m_sampleCount           = sampleCount;
+    m_viewedMipSliceCount   = m_mipLevels;
+    m_viewedArraySliceCount = m_arrayCount;
+    ResolveAutomaticFormats( );
+
+    // If we support mapping, keep the CPU side copy
+    if( m_accessFlags != vaResourceAccessFlags::Default )
+    {
+        assert( (m_sizeZ == 1) && (m_arrayCount == 1) && (m_sampleCount == 1) );  // same restrictions as DX12
+        int bytesPerPixel = vaResourceFormatHelpers::GetPixelSizeInBytes( m_resourceFormat );
+        assert( bytesPerPixel != 0 );
+
+        if( bytesPerPixel > 0 )
+        {
+            m_mappedData.resize( m_mipLevels );
+            m_CPUData.resize( m_mipLevels );
+
+            int mipSizeX = m_sizeX;
+            int mipSizeY = m_sizeY;
+            for( int i = 0; i < m_mipLevels; i++ )
+            {
+                m_mappedData[i].SizeX           = mipSizeX;
+                m_mappedData[i].SizeY           = mipSizeY;
+                m_mappedData[i].BytesPerPixel   = bytesPerPixel;
+                m_CPUData[i].resize( (size_t)mipSizeX * mipSizeY * bytesPerPixel );
+
+                mipSizeX = vaMath::Max( 1, mipSizeX / 2 );
+                mipSizeY = vaMath::Max( 1, mipSizeY / 2 );
+            }
+
+            if( initialData != nullptr )
+            {
+                int rowSize = m_mappedData[0].SizeX * bytesPerPixel;
+                int srcRowPitch = ( initialDataRowPitch != 0 ) ? ( initialDataRowPitch ) : ( rowSize );
+                for( int y = 0; y < m_mappedData[0].SizeY; y++ )
+                    memcpy( m_CPUData[0].data( ) + (size_t)y * rowSize, (const byte *)initialData + (size_t)y * srcRowPitch, rowSize );
+            }
+        }
+    }
+    return true;
+}
+
+bool vaTextureNull::InternalCreate1D( vaResourceFormat format, int width, int mipLevels, int arraySize, vaResourceBindSupportFlags bindFlags, vaResourceAccessFlags accessFlags, vaResourceFormat srvFormat, vaResourceFormat rtvFormat, vaResourceFormat dsvFormat, vaResourceFormat uavFormat, vaTextureFlags flags, vaTextureContentsType contentsType, void * initialData )
+{
+    return InternalCreate( vaTextureType::Texture1D, format, width, 1, 1, mipLevels, arraySize, 1, bindFlags, accessFlags, srvFormat, rtvFormat, dsvFormat, uavFormat, flags, contentsType, initialData, 0, 0 );
+}
+
+bool vaTextureNull::InternalCreate2D( vaResourceFormat format, int width, int height, int mipLevels, int arraySize, int sampleCount, vaResourceBindSupportFlags bindFlags, vaResourceAccessFlags accessFlags, vaResourceFormat srvFormat, vaResourceFormat rtvFormat, vaResourceFormat dsvFormat, vaResourceFormat uavFormat, vaTextureFlags flags, vaTextureContentsType contentsType, void * initialData, int initialDataRowPitch )
+{
+    return InternalCreate( vaTextureType::Texture2D, format, width, height, 1, mipLevels, arraySize, sampleCount, bindFlags, accessFlags, srvFormat, rtvFormat, dsvFormat, uavFormat, flags, contentsType, initialData, initialDataRowPitch, 0 );
+}
+
+bool vaTextureNull::InternalCreate3D( vaResourceFormat format, int width, int height, int depth, int mipLevels, vaResourceBindSupportFlags bindFlags, vaResourceAccessFlags accessFlags, vaResourceFormat srvFormat, vaResourceFormat rtvFormat, vaResourceFormat dsvFormat, vaResourceFormat uavFormat, vaTextureFlags flags, vaTextureContentsType contentsType, void * initialData, int initialDataRowPitch, int initialDataSlicePitch )
+{
+    return InternalCreate( vaTextureType::Texture3D, format, width, height, depth, mipLevels, 1, 1, bindFlags, accessFlags, srvFormat, rtvFormat, dsvFormat, uavFormat, flags, contentsType, initialData, initialDataRowPitch, initialDataSlicePitch );
+}
+
+shared_ptr<vaTexture> vaTextureNull::CreateViewInternal( const shared_ptr<vaTexture> & thisTexture, vaResourceBindSupportFlags bindFlags, vaResourceFormat srvFormat, vaResourceFormat rtvFormat, vaResourceFormat dsvFormat, vaResourceFormat uavFormat, vaTextureFlags flags, int viewedMipSliceMin, int viewedMipSliceCount, int viewedArraySliceMin, int viewedArraySliceCount )
+{
+    assert( thisTexture.get() == static_cast<vaTexture*>(this) );
+
+    // -1 means all above min
+    if( viewedMipSliceCount == -1 )
+        viewedMipSliceCount = this->GetMipLevels() - viewedMipSliceMin;
+    if( viewedArraySliceCount == -1 )
+        viewedArraySliceCount = this->GetArrayCount() - viewedArraySliceMin;
+    assert( viewedMipSliceCount > 0 );
+    assert( viewedArraySliceCount > 0 );
+
+    assert( viewedMipSliceMin >= 0 && viewedMipSliceMin < this->GetMipLevels() );
+    assert( (viewedMipSliceMin+viewedMipSliceCount) > 0 && (viewedMipSliceMin+viewedMipSliceCount) <= this->GetMipLevels() );
+    assert( viewedArraySliceMin >= 0 && viewedArraySliceMin < this->GetArrayCount( ) );
+    assert( ( viewedArraySliceMin + viewedArraySliceCount ) > 0 && ( viewedArraySliceMin + viewedArraySliceCount ) <= this->GetArrayCount( ) );
+
+    // Can't request additional binding flags that were not supported in the original texture
+    vaResourceBindSupportFlags origFlags = this->GetBindSupportFlags();
+    assert( ((~origFlags) & bindFlags) == 0 );
+    origFlags; // unreferenced in Release
+
+    shared_ptr<vaTexture> newTexture = VA_RENDERING_MODULE_CREATE_SHARED( vaTexture, vaTextureConstructorParams( GetRenderDevice(), vaCore::GUIDCreate( ) ) );
+    vaTextureNull & newNullTexture = AsNull( *newTexture );
+    newNullTexture.Initialize( bindFlags, this->GetAccessFlags(), this->GetResourceFormat(), srvFormat, rtvFormat, dsvFormat, uavFormat, this->GetFlags(), viewedMipSliceMin, viewedMipSliceCount, viewedArraySliceMin, viewedArraySliceCount, this->GetContentsType() );
+    newNullTexture.SetViewedOriginal( thisTexture );
+    newNullTexture.m_flags = flags;            // override flags (currently only used for cubemaps)
+
+    int viewedSliceSizeX = m_sizeX;
+    int viewedSliceSizeY = m_sizeY;
+    int viewedSliceSizeZ = m_sizeZ;
+    for( int i = 0; i < viewedMipSliceMin; i++ )
+    {
+        viewedSliceSizeX = (viewedSliceSizeX) / 2;
+        viewedSliceSizeY = (viewedSliceSizeY) / 2;
+        viewedSliceSizeZ = (viewedSliceSizeZ) / 2;
+    }
+    newNullTexture.m_type           = m_type;
+    newNullTexture.m_sizeX          = vaMath::Max( viewedSliceSizeX, 1 );
+    newNullTexture.m_sizeY          = vaMath::Max( viewedSliceSizeY, 1 );
+    newNullTexture.m_sizeZ          = vaMath::Max( viewedSliceSizeZ, 1 );
+    newNullTexture.m_sampleCount    = m_sampleCount;
+    newNullTexture.m_mipLevels      = viewedMipSliceCount;
+    newNullTexture.m_arrayCount     = viewedArraySliceCount;
+    newNullTexture.ResolveAutomaticFormats( );
+
+    return newTexture;
+}
+
+void vaTextureNull::UpdateSubresources( vaRenderDeviceContext & renderContext, uint32 firstSubresource, std::vector<vaTextureSubresourceData> & subresources )
+{
+    assert( GetRenderDevice( ).IsRenderThread( ) );
+
+    int64  totalSize    = 0;
+    uint64 dataHash     = 0;
+    for( const vaTextureSubresourceData & subresource : subresources )
+    {
+        int64 size = ( subresource.SlicePitch != 0 ) ? ( subresource.SlicePitch ) : ( subresource.RowPitch );
+        dataHash    = vaXXHash64::Compute( subresource.pData, size, dataHash );
+        totalSize  += size;
+    }
+
+    vaRenderRecording::Command command;
+    command.Type        = vaRenderRecording::CommandType::UpdateTexture;
+    command.Count       = (uint32)totalSize;
+    command.Start       = firstSubresource;
+    command.Resources   = GetResourceID( );
+    command.Payload     = dataHash;
+    AsNull( renderContext ).Record( command );
+}
+
+bool vaTextureNull::TryMap( vaRenderDeviceContext & renderContext, vaResourceMapType mapType, bool doNotWait )
+{
+    assert( GetRenderDevice( ).IsRenderThread( ) );
+    assert( GetRenderDevice( ).IsFrameStarted( ) );
+    if( GetRenderDevice( ).GetMainContext( ) != &renderContext )
+    {
+        assert( false ); // must be main context
+        return false;
+    }
+    mapType; doNotWait; // unreferenced - CPU copy is always there
+
+    assert( !m_isMapped );
+    if( m_isMapped || m_CPUData.size( ) == 0 )
+        return false;
+
+    for( size_t i = 0; i < m_mappedData.size( ); i++ )
+    {
+        m_mappedData[i].Buffer      = m_CPUData[i].data( );
+        m_mappedData[i].RowPitch    = m_mappedData[i].SizeX * m_mappedData[i].BytesPerPixel;
+        m_mappedData[i].SizeInBytes = (int64)m_CPUData[i].size( );
+        m_mappedData[i].DepthPitch  = 0;
+    }
+    m_isMapped = true;
+    return true;
+}
+
+void vaTextureNull::Unmap( vaRenderDeviceContext & renderContext )
+{
+    assert( GetRenderDevice( ).IsRenderThread( ) );
+    if( GetRenderDevice( ).GetMainContext( ) != &renderContext )
+    {
+        assert( false ); // must be main context
+        return;
+    }
+
+    assert( m_isMapped );
+    if( !m_isMapped )
+        return;
+
+    // Buffer is owned by m_CPUData - must not be deleted by vaTextureMappedSubresource
+    for( size_t i = 0; i < m_mappedData.size( ); i++ )
+    {
+        m_mappedData[i].Buffer      = nullptr;
+        m_mappedData[i].SizeInBytes = 0;
+        m_mappedData[i].RowPitch    = 0;
+        m_mappedData[i].DepthPitch  = 0;
+    }
+    m_isMapped = false;
+}
+
+void vaTextureNull::RecordClear( vaRenderDeviceContext & renderContext, uint32 viewType, const void * clearValue, int clearValueSize )
+{
+    assert( GetRenderDevice( ).IsFrameStarted( ) );
+
+    vaRenderRecording::Command command;
+    command.Type        = vaRenderRecording::CommandType::Clear;
+    command.Count       = viewType;
+    command.Resources   = GetResourceID( );
+    command.Payload     = vaXXHash64::Compute( clearValue, clearValueSize );
+    AsNull( renderContext ).Record( command );
+}
+
+void vaTextureNull::ClearRTV( vaRenderDeviceContext & renderContext, const vaVector4 & clearValue )
+{
+    assert( ( GetBindSupportFlags( ) & vaResourceBindSupportFlags::RenderTarget ) != 0 );
+    RecordClear( renderContext, 0, &clearValue, sizeof( clearValue ) );
+}
+
+void vaTextureNull::ClearUAV( vaRenderDeviceContext & renderContext, const vaVector4ui & clearValue )
+{
+    assert( ( GetBindSupportFlags( ) & vaResourceBindSupportFlags::UnorderedAccess ) != 0 );
+    RecordClear( renderContext, 1, &clearValue, sizeof( clearValue ) );
+}
+
+void vaTextureNull::ClearUAV( vaRenderDeviceContext & renderContext, const vaVector4 & clearValue )
+{
+    assert( ( GetBindSupportFlags( ) & vaResourceBindSupportFlags::UnorderedAccess ) != 0 );
+    RecordClear( renderContext, 2, &clearValue, sizeof( clearValue ) );
+}
+
+void vaTextureNull::ClearDSV( vaRenderDeviceContext & renderContext, bool clearDepth, float depthValue, bool clearStencil, uint8 stencilValue )
+{
+    assert( ( GetBindSupportFlags( ) & vaResourceBindSupportFlags::DepthStencil ) != 0 );
+    float clearValue[3] = { (clearDepth)?(depthValue):(-1.0f), (clearStencil)?((float)stencilValue):(-1.0f), 0.0f };
+    RecordClear( renderContext, 3, clearValue, sizeof( clearValue ) );
+}
+
+void vaTextureNull::RecordCopy( vaRenderDeviceContext & renderContext, vaTexture & src, vaTexture & dst, uint32 srcSubresource, uint32 dstSubresource )
+{
+    assert( GetRenderDevice( ).IsFrameStarted( ) );
+
+    uint64 ids[2] = { AsNull( static_cast<vaShaderResource*>( &src ) )->GetResourceID( ), AsNull( static_cast<vaShaderResource*>( &dst ) )->GetResourceID( ) };
+
+    vaRenderRecording::Command command;
+    command.Type        = vaRenderRecording::CommandType::Copy;
+    command.Count       = srcSubresource;
+    command.Start       = dstSubresource;
+    command.Resources   = vaXXHash64::Compute( ids, sizeof( ids ) );
+    AsNull( renderContext ).Record( command );
+}
+
+void vaTextureNull::CopyFrom( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & srcTexture )
+{
+    assert( srcTexture != nullptr );
+    RecordCopy( renderContext, *srcTexture, *this, 0, 0 );
+}
+
+void vaTextureNull::CopyTo( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & dstTexture )
+{
+    assert( dstTexture != nullptr );
+    RecordCopy( renderContext, *this, *dstTexture, 0, 0 );
+}
+
+void vaTextureNull::ResolveSubresource( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & dstResource, uint dstSubresource, uint srcSubresource, vaResourceFormat format )
+{
+    format; // unreferenced
+    assert( dstResource != nullptr );
+    RecordCopy( renderContext, *this, *dstResource, srcSubresource, dstSubresource );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// buffers
+
+void vaConstantBufferNull::Update( vaRenderDeviceContext & renderContext, const void * data, uint32 dataSize )
+{
+    assert( dataSize <= m_dataSize );
+
+    vaRenderRecording::Command command;
+    command.Type        = vaRenderRecording::CommandType::UpdateConstantBuffer;
+    command.Count       = dataSize;
+    command.Resources   = GetResourceID( );
+    command.Payload     = vaXXHash64::Compute( data, dataSize );
+    AsNull( renderContext ).Record( command );
+}
+
+void vaIndexBufferNull::Update( vaRenderDeviceContext & renderContext, const void * data, uint32 dataSize )
+{
+    assert( dataSize <= m_dataSize );
+
+    vaRenderRecording::Command command;
+    command.Type        = vaRenderRecording::CommandType::UpdateBuffer;
+    command.Count       = dataSize;
+    command.Resources   = GetResourceID( );
+    command.Payload     = vaXXHash64::Compute( data, dataSize );
+    AsNull( renderContext ).Record( command );
+}
+
+void vaVertexBufferNull::Create( int vertexCount, int vertexSize, const void * initialData, bool dynamicUpload )
+{
+    assert( !IsMapped() );
+    m_vertexCount   = vertexCount;
+    m_vertexSize    = vertexSize;
+    m_dataSize      = vertexCount * vertexSize;
+    m_dynamicUpload = dynamicUpload;
+    m_CPUData.resize( m_dataSize );
+    if( initialData != nullptr )
+        memcpy( m_CPUData.data( ), initialData, m_dataSize );
+}
+
+void vaVertexBufferNull::Destroy( )
+{
+    assert( !IsMapped() );
+    m_CPUData.clear( );
+    m_vertexCount   = 0;
+    m_vertexSize    = 0;
+    m_dataSize      = 0;
+}
+
+void vaVertexBufferNull::Update( vaRenderDeviceContext & renderContext, const void * data, uint32 dataSize )
+{
+    assert( !IsMapped() );
+    assert( dataSize <= m_dataSize );
+    memcpy( m_CPUData.data( ), data, vaMath::Min( dataSize, m_dataSize ) );
+
+    vaRenderRecording::Command command;
+    command.Type        = vaRenderRecording::CommandType::UpdateBuffer;
+    command.Count       = dataSize;
+    command.Resources   = GetResourceID( );
+    command.Payload     = vaXXHash64::Compute( data, dataSize );
+    AsNull( renderContext ).Record( command );
+}
+
+bool vaVertexBufferNull::Map( vaRenderDeviceContext & renderContext, vaResourceMapType mapType )
+{
+    renderContext; mapType; // unreferenced
+    assert( !IsMapped() );
+    if( IsMapped() || m_CPUData.size( ) == 0 )
+        return false;
+    m_mappedData = m_CPUData.data( );
+    return true;
+}
+
+void vaVertexBufferNull::Unmap( vaRenderDeviceContext & renderContext )
+{
+    assert( IsMapped() );
+    if( !IsMapped() )
+        return;
+    m_mappedData = nullptr;
+
+    // the GPU would only see the new contents now
+    vaRenderRecording::Command command;
+    command.Type        = vaRenderRecording::CommandType::UpdateBuffer;
+    command.Count       = m_dataSize;
+    command.Resources   = GetResourceID( );
+    command.Payload     = vaXXHash64::Compute( m_CPUData.data( ), m_dataSize );
+    AsNull( renderContext ).Record( command );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// other
+
+vaGPUContextTracerNull::vaGPUContextTracerNull( const vaRenderingModuleParams & params ) : vaGPUContextTracer( vaSaferStaticCast< const vaGPUContextTracerParams &, const vaRenderingModuleParams &>( params ) )
+{
+}
+
+void RegisterShaderNull( )
+{
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaPixelShader,    vaPixelShaderNull     );
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaComputeShader,  vaComputeShaderNull   );
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaHullShader,     vaHullShaderNull      );
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaDomainShader,   vaDomainShaderNull    );
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaGeometryShader, vaGeometryShaderNull  );
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaVertexShader,   vaVertexShaderNull    );
+}
+
+void RegisterBuffersNull( )
+{
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaConstantBuffer, vaConstantBufferNull );
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaIndexBuffer, vaIndexBufferNull );
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaVertexBuffer, vaVertexBufferNull );
+}
+
+void RegisterRenderGlobalsNull( )
+{
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaRenderGlobals, vaRenderGlobalsNull );
+}
+
+void RegisterRenderMaterialNull( )
+{
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaRenderMaterial, vaRenderMaterialNull );
+}
+
+void RegisterRenderMeshNull( )
+{
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaRenderMeshManager, vaRenderMeshManagerNull );
+}
+
+void RegisterLightingNull( )
+{
+    VA_RENDERING_MODULE_REGISTER( vaRenderDeviceNull, vaLighting, vaLightingNull );
+}
@@ -0,0 +1,264 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Rendering/Null/vaRenderDeviceNull.h"
+
+#include "Rendering/vaRenderingIncludes.h"
+#include "Rendering/vaGPUTimer.h"
+
+namespace Vanilla
+{
+    // Null API resources - see vaRenderDeviceNull.h for the overview.
+
+    class vaShaderNull : public virtual vaShader
+    {
+    protected:
+        uint64                          m_contentsHash          = 0;    // hash of everything the shader was created from; only valid when Cooked
+
+    public:
+        vaShaderNull( const vaRenderingModuleParams & params );
+        virtual ~vaShaderNull( );
+        //
+        using vaShader::CreateShaderFromFile;
+        // there's nothing to compile so these always 'compile' immediately
+        virtual void                    CreateShaderFromFile( const wstring & filePath, const string & shaderModel, const string & entryPoint, const vaShaderMacroContaner & macros, bool forceImmediateCompile ) override;
+        virtual void                    CreateShaderFromBuffer( const string & shaderCode, const string & shaderModel, const string & entryPoint, const vaShaderMacroContaner & macros, bool forceImmediateCompile ) override;
+        //
+        virtual void                    Clear( ) override;
+        //
+        virtual bool                    IsCreated( ) override   { std::unique_lock<mutex> allShaderDataLock( m_allShaderDataMutex, std::try_to_lock ); return allShaderDataLock.owns_lock() && m_state == State::Cooked; }
+        //
+        vaShader::State                 GetShader( uint64 & outContentsHash );
+        //
+    protected:
+        virtual void                    DestroyShader( ) override { DestroyShaderBase( ); }
+        void                            DestroyShaderBase( );
+        //
+        virtual void                    CreateShader( ) override  { CreateShaderBase( "" ); }
+        void                            CreateShaderBase( const string & additionalKey );
+        //
+        void                            SafeDestruct( );
+    };
+
+#pragma warning ( push )
+#pragma warning ( disable : 4250 )
+
+    class vaPixelShaderNull : public vaShaderNull, public vaPixelShader
+    {
+        VA_RENDERING_MODULE_MAKE_FRIENDS( );
+    public:
+        vaPixelShaderNull( const vaRenderingModuleParams & params ) : vaShaderNull( params ), vaShader( params ) { }
+        virtual ~vaPixelShaderNull( ) { SafeDestruct(); }
+    };
+
+    class vaComputeShaderNull : public vaShaderNull, public vaComputeShader
+    {
+    public:
+        vaComputeShaderNull( const vaRenderingModuleParams & params ) : vaShaderNull( params ), vaShader( params ) { }
+        virtual ~vaComputeShaderNull( ) { SafeDestruct(); }
+    };
+
+    class vaHullShaderNull : public vaShaderNull, public vaHullShader
+    {
+    public:
+        vaHullShaderNull( const vaRenderingModuleParams & params ) : vaShaderNull( params ), vaShader( params ) { }
+        virtual ~vaHullShaderNull( ) { SafeDestruct(); }
+    };
+
+    class vaDomainShaderNull : public vaShaderNull, public vaDomainShader
+    {
+    public:
+        vaDomainShaderNull( const vaRenderingModuleParams & params ) : vaShaderNull( params ), vaShader( params ) { }
+        virtual ~vaDomainShaderNull( ) { SafeDestruct(); }
+    };
+
+    class vaGeometryShaderNull : public vaShaderNull, public vaGeometryShader
+    {
+    public:
+        vaGeometryShaderNull( const vaRenderingModuleParams & params ) : vaShaderNull( params ), vaShader( params ) { }
+        virtual ~vaGeometryShaderNull( ) { SafeDestruct(); }
+    };
+
+    class vaVertexShaderNull : public vaShaderNull, public vaVertexShader
+    {
+    public:
+        vaVertexShaderNull( const vaRenderingModuleParams & params ) : vaShaderNull( params ), vaShader( params ) { }
+        virtual ~vaVertexShaderNull( ) { SafeDestruct(); }
+
+    public:
+        virtual void                CreateShaderAndILFromFile( const wstring & filePath, const string & shaderModel, const string & entryPoint, const vector<vaVertexInputElementDesc> & inputLayoutElements, const vaShaderMacroContaner & macros, bool forceImmediateCompile ) override;
+        virtual void                CreateShaderAndILFromBuffer( const string & shaderCode, const string & shaderModel, const string & entryPoint, const vector<vaVertexInputElementDesc> & inputLayoutElements, const vaShaderMacroContaner & macros, bool forceImmediateCompile ) override;
+
+    protected:
+        // input layout is a part of the contents
+        virtual void                CreateShader( ) override    { CreateShaderBase( m_inputLayout.GetHashString() ); }
+    };
+
+#pragma warning ( pop )
+
+    class vaTextureNull : public vaTexture, public vaShaderResourceNull
+    {
+        VA_RENDERING_MODULE_MAKE_FRIENDS( );
+
+    private:
+        // only for CPU mappable textures - one per mip, same layout as m_mappedData
+        vector<vector<byte>>                m_CPUData;
+
+    protected:
+        friend class vaTexture;
+        explicit                            vaTextureNull( const vaRenderingModuleParams & params );
+        virtual                             ~vaTextureNull( );
+
+        virtual bool                        Import( const wstring & storageFilePath, vaTextureLoadFlags loadFlags, vaResourceBindSupportFlags binds, vaTextureContentsType contentsType = vaTextureContentsType::GenericColor ) override;
+        virtual bool                        Import( void * buffer, uint64 bufferSize, vaTextureLoadFlags loadFlags = vaTextureLoadFlags::Default, vaResourceBindSupportFlags binds = vaResourceBindSupportFlags::ShaderResource, vaTextureContentsType contentsType = vaTextureContentsType::GenericColor ) override;
+        virtual void                        Destroy( ) override;
+
+        // contents are skipped on load (texture becomes a placeholder) and can't be saved since there aren't any
+        virtual bool                        LoadAPACK( vaStream & inStream ) override;
+        virtual bool                        SaveAPACK( vaStream & outStream ) override                                          { outStream; return false; }
+        virtual bool                        SerializeUnpacked( vaXMLSerializer & serializer, const wstring & assetFolder ) override;
+
+        virtual shared_ptr<vaTexture>       CreateViewInternal( const shared_ptr<vaTexture> & thisTexture, vaResourceBindSupportFlags bindFlags, vaResourceFormat srvFormat, vaResourceFormat rtvFormat, vaResourceFormat dsvFormat, vaResourceFormat uavFormat, vaTextureFlags flags, int viewedMipSliceMin, int viewedMipSliceCount, int viewedArraySliceMin, int viewedArraySliceCount ) override;
+
+        virtual bool                        InternalCreate1D( vaResourceFormat format, int width, int mipLevels, int arraySize, vaResourceBindSupportFlags bindFlags, vaResourceAccessFlags accessFlags, vaResourceFormat srvFormat, vaResourceFormat rtvFormat, vaResourceFormat dsvFormat, vaResourceFormat uavFormat, vaTextureFlags flags, vaTextureContentsType contentsType, void * initialData ) override;
+        virtual bool                        InternalCreate2D( vaResourceFormat format, int width, int height, int mipLevels, int arraySize, int sampleCount, vaResourceBindSupportFlags bindFlags, vaResourceAccessFlags accessFlags, vaResourceFormat srvFormat, vaResourceFormat rtvFormat, vaResourceFormat dsvFormat, vaResourceFormat uavFormat, vaTextureFlags flags, vaTextureContentsType contentsType, void * initialData, int initialDataRowPitch ) override;
+        virtual bool                        InternalCreate3D( vaResourceFormat format, int width, int height, int depth, int mipLevels, vaResourceBindSupportFlags bindFlags, vaResourceAccessFlags accessFlags, vaResourceFormat srvFormat, vaResourceFormat rtvFormat, vaResourceFormat dsvFormat, vaResourceFormat uavFormat, vaTextureFlags flags, vaTextureContentsType contentsType, void * initialData, int initialDataRowPitch, int initialDataSlicePitch ) override;
+
+    public:
+        virtual void                        UpdateSubresources( vaRenderDeviceContext & renderContext, uint32 firstSubresource, /*const*/ std::vector<vaTextureSubresourceData> & subresources ) override;
+        virtual bool                        TryMap( vaRenderDeviceContext & renderContext, vaResourceMapType mapType, bool doNotWait = false ) override;
+        virtual void                        Unmap( vaRenderDeviceContext & renderContext ) override;
+
+        virtual void                        ClearRTV( vaRenderDeviceContext & renderContext, const vaVector4 & clearValue ) override;
+        virtual void                        ClearUAV( vaRenderDeviceContext & renderContext, const vaVector4ui & clearValue ) override;
+        virtual void                        ClearUAV( vaRenderDeviceContext & renderContext, const vaVector4 & clearValue ) override;
+        virtual void                        ClearDSV( vaRenderDeviceContext & renderContext, bool clearDepth, float depthValue, bool clearStencil, uint8 stencilValue ) override;
+
+        virtual void                        CopyFrom( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & srcTexture ) override;
+        virtual void                        CopyTo( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & dstTexture ) override;
+        virtual void                        ResolveSubresource( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & dstResource, uint dstSubresource, uint srcSubresource, vaResourceFormat format = vaResourceFormat::Automatic ) override;
+
+        virtual shared_ptr<vaTextureCompressionJob> CreateCompressionJob( vaTextureCompressionPreset preset ) override      { preset; return nullptr; }
+
+        virtual bool                        SaveToDDSFile( vaRenderDeviceContext & renderContext, const wstring & path ) override   { renderContext; path; return false; }
+        virtual bool                        SaveToPNGFile( vaRenderDeviceContext & renderContext, const wstring & path ) override   { renderContext; path; return false; }
+
+    private:
+        bool                                InternalCreate( vaTextureType type, vaResourceFormat format, int sizeX, int sizeY, int sizeZ, int mipLevels, int arrayCount, int sampleCount, vaResourceBindSupportFlags bindFlags, vaResourceAccessFlags accessFlags, vaResourceFormat srvFormat, vaResourceFormat rtvFormat, vaResourceFormat dsvFormat, vaResourceFormat uavFormat, vaTextureFlags flags, vaTextureContentsType contentsType, void * initialData, int initialDataRowPitch, int initialDataSlicePitch );
+        void                                ResolveAutomaticFormats( );
+        void                                RecordClear( vaRenderDeviceContext & renderContext, uint32 viewType, const void * clearValue, int clearValueSize );
+        void                                RecordCopy( vaRenderDeviceContext & renderContext, vaTexture & src, vaTexture & dst, uint32 srcSubresource, uint32 dstSubresource );
+    };
+
+    class vaConstantBufferNull : public vaConstantBuffer, public vaShaderResourceNull
+    {
+        VA_RENDERING_MODULE_MAKE_FRIENDS( );
+
+    protected:
+        explicit                            vaConstantBufferNull( const vaRenderingModuleParams & params ) : vaConstantBuffer( params ), vaShaderResourceNull( params.RenderDevice ) { }
+
+    public:
+        virtual void                        Update( vaRenderDeviceContext & renderContext, const void * data, uint32 dataSize ) override;
+        virtual void                        Create( int bufferSize, const void * initialData, bool dynamicUpload ) override     { initialData; dynamicUpload; m_dataSize = bufferSize; }
+        virtual void                        Destroy( ) override                                                                 { m_dataSize = 0; }
+    };
+
+    class vaIndexBufferNull : public vaIndexBuffer, public vaShaderResourceNull
+    {
+        VA_RENDERING_MODULE_MAKE_FRIENDS( );
+
+    protected:
+        explicit                            vaIndexBufferNull( const vaRenderingModuleParams & params ) : vaIndexBuffer( params ), vaShaderResourceNull( params.RenderDevice ) { }
+
+    public:
+        virtual void                        Update( vaRenderDeviceContext & renderContext, const void * data, uint32 dataSize ) override;
+        virtual void                        Create( int indexCount, const void * initialData = nullptr ) override              { initialData; m_indexCount = indexCount; m_dataSize = indexCount * sizeof(uint32); }
+        virtual void                        Destroy( ) override                                                                 { m_indexCount = 0; m_dataSize = 0; }
+        virtual bool                        IsCreated( ) const override                                                         { return m_dataSize > 0; }
+    };
+
+    // keeps a CPU copy so that it can be mapped
+    class vaVertexBufferNull : public vaVertexBuffer, public vaShaderResourceNull
+    {
+        VA_RENDERING_MODULE_MAKE_FRIENDS( );
+
+    private:
+        vector<byte>                        m_CPUData;
+
+    protected:
+        explicit                            vaVertexBufferNull( const vaRenderingModuleParams & params ) : vaVertexBuffer( params ), vaShaderResourceNull( params.RenderDevice ) { }
+        virtual                             ~vaVertexBufferNull( )                                                              { assert( !IsMapped() ); }
+
+    public:
+        virtual void                        Update( vaRenderDeviceContext & renderContext, const void * data, uint32 dataSize ) override;
+        virtual bool                        Map( vaRenderDeviceContext & renderContext, vaResourceMapType mapType ) override;
+        virtual void                        Unmap( vaRenderDeviceContext & renderContext ) override;
+        virtual void                        Create( int vertexCount, int vertexSize, const void * initialData, bool dynamicUpload ) override;
+        virtual void                        Destroy( ) override;
+        virtual bool                        IsCreated( ) const override                                                         { return m_dataSize > 0; }
+    };
+
+    // no GPU timings
+    class vaGPUContextTracerNull : public vaGPUContextTracer
+    {
+        VA_RENDERING_MODULE_MAKE_FRIENDS( );
+
+    protected:
+        vaGPUContextTracerNull( const vaRenderingModuleParams & params );
+        virtual ~vaGPUContextTracerNull( ) { }
+
+    public:
+        virtual int                         Begin( const string & name ) override                                               { name; return -1; }
+        virtual void                        End( int handle ) override                                                          { handle; }
+
+    protected:
+        virtual void                        BeginFrame( ) override                                                              { }
+        virtual void                        EndFrame( ) override                                                                { }
+    };
+
+    inline vaShader::State          vaShaderNull::GetShader( uint64 & outContentsHash )
+    { 
+        std::unique_lock<mutex> allShaderDataLock( m_allShaderDataMutex, std::try_to_lock ); 
+        if (!allShaderDataLock.owns_lock())     // don't block, don't wait
+        {
+            outContentsHash = 0;
+            return vaShader::State::Uncooked;   // same as for DX12 - being (re)created, will probably be available later
+        }
+        outContentsHash = m_contentsHash;
+        return m_state; 
+    }
+
+    inline vaTextureNull &          AsNull( vaTexture & texture )           { return *texture.vaRenderingModule::SafeCast<vaTextureNull*>(); }
+    inline vaTextureNull *          AsNull( vaTexture * texture )           { return texture->vaRenderingModule::SafeCast<vaTextureNull*>(); }
+
+    inline vaVertexShaderNull &     AsNull( vaVertexShader & shader )       { return *shader.SafeCast<vaVertexShaderNull*>(); }
+    inline vaVertexShaderNull *     AsNull( vaVertexShader * shader )       { return shader->SafeCast<vaVertexShaderNull*>(); }
+    inline vaPixelShaderNull &      AsNull( vaPixelShader & shader )        { return *shader.SafeCast<vaPixelShaderNull*>(); }
+    inline vaPixelShaderNull *      AsNull( vaPixelShader * shader )        { return shader->SafeCast<vaPixelShaderNull*>(); }
+    inline vaGeometryShaderNull &   AsNull( vaGeometryShader & shader )     { return *shader.SafeCast<vaGeometryShaderNull*>(); }
+    inline vaGeometryShaderNull *   AsNull( vaGeometryShader * shader )     { return shader->SafeCast<vaGeometryShaderNull*>(); }
+    inline vaDomainShaderNull &     AsNull( vaDomainShader & shader )       { return *shader.SafeCast<vaDomainShaderNull*>(); }
+    inline vaDomainShaderNull *     AsNull( vaDomainShader * shader )       { return shader->SafeCast<vaDomainShaderNull*>(); }
+    inline vaHullShaderNull &       AsNull( vaHullShader & shader )         { return *shader.SafeCast<vaHullShaderNull*>(); }
+    inline vaHullShaderNull *       AsNull( vaHullShader * shader )         { return shader->SafeCast<vaHullShaderNull*>(); }
+    inline vaComputeShaderNull &    AsNull( vaComputeShader & shader )      { return *shader.SafeCast<vaComputeShaderNull*>(); }
+    inline vaComputeShaderNull *    AsNull( vaComputeShader * shader )      { return shader->SafeCast<vaComputeShaderNull*>(); }
+}
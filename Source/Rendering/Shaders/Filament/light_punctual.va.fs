@@ -222,8 +222,19 @@ void evaluatePunctualLights( const RenderMaterialInterpolants vertex, const Shad
     // Iterate point lights
     // for ( ; index < end; index++) 
     // {
-    for( uint i = 0; i < g_Lighting.LightCountSpotAndPoint; i++ )
+
+    // only go through the lights that can reach this pixel's cluster (see vaLightClusters)
+    uint clusterHeader  = GetLightClusterHeader( vertex.Position.xy, dot( vertex.WorldspacePos.xyz - g_Global.CameraWorldPosition.xyz, g_Global.CameraDirection.xyz ) );
+    uint clusterOffset  = clusterHeader & 0xFFFF;
+    uint clusterCount   = clusterHeader >> 16;
+    bool allLights      = clusterCount == LIGHTCLUSTERS_ALL_LIGHTS;
+    uint lightCount     = (allLights)?(g_Lighting.LightCountSpotAndPoint):(clusterCount);
+
+    [loop]
+    for( uint li = 0; li < lightCount; li++ )
     {
+        uint i = (allLights)?(li):(GetLightClusterLightIndex( clusterOffset + li ));
+
         // Light light = getPointLight(index);
         LightParams light = getSpotLight( vertex, shading, i );
 
@@ -47,6 +47,32 @@ cbuffer LightingConstantsBuffer                 : register( B_CONCATENATER( LIGH
 //     IBLProbeConstants         g_DistantIBL;
 // }
 
+cbuffer LightClustersConstantsBuffer            : register( B_CONCATENATER( LIGHTINGGLOBAL_CLUSTERS_CONSTANTSBUFFERSLOT_V ) )
+{
+    LightClustersShaderConstants    g_LightClusters;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Clustered light lists (built on the CPU by vaLightClusters)
+//
+// Returns the light list header of the cluster containing the pixel: list offset in the lower 16 bits and light count in
+// the upper 16 bits; a count of LIGHTCLUSTERS_ALL_LIGHTS means there's no list and all spot/point lights should be used.
+uint GetLightClusterHeader( float2 svPosition, float viewspaceDepth )
+{
+    uint2 clusterXY = min( (uint2)( svPosition * g_Global.ViewportPixelSize * float2( LIGHTCLUSTERS_COUNT_X, LIGHTCLUSTERS_COUNT_Y ) ), uint2( LIGHTCLUSTERS_COUNT_X-1, LIGHTCLUSTERS_COUNT_Y-1 ) );
+    uint clusterZ   = (uint)clamp( log2( max( viewspaceDepth, 1e-6 ) ) * g_LightClusters.DepthSliceScale + g_LightClusters.DepthSliceBias, 0, LIGHTCLUSTERS_COUNT_Z-1 );
+    uint index      = ( clusterZ * LIGHTCLUSTERS_COUNT_Y + clusterXY.y ) * LIGHTCLUSTERS_COUNT_X + clusterXY.x;
+    return (uint)g_LightClusters.Headers[index >> 2][index & 3];
+}
+//
+// Index (into g_Lighting.LightsSpotAndPoint) of the i-th light in the cluster lists
+uint GetLightClusterLightIndex( uint i )
+{
+    uint packed = (uint)g_LightClusters.LightIndices[i >> 4][(i >> 2) & 3];
+    return ( packed >> ( ( i & 3 ) * 8 ) ) & 0xFF;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Per-shaded-pixel intermediate data structures
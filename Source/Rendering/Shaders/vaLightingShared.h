@@ -64,7 +64,7 @@ struct ShaderLightDirectional
 //};
 struct ShaderLightSpot
 {
-    static const int    MaxLights                       = 32;
+    static const int    MaxLights                       = 256;  // light cluster lists store 8 bit indices so this can't go above 256
 
     vaVector3           Color;							// stored as linear, tools should show srgb though
     float               Intensity;                      // premultiplied by exposure
@@ -144,6 +144,33 @@ struct LightingShaderConstants
     // vaVector4               ShadowCubes[MaxShadowCubes];    // .xyz is cube center and .w is unused at the moment
 };
 
+// Clustered (froxel) light culling: the view frustum is split into LIGHTCLUSTERS_COUNT_X x LIGHTCLUSTERS_COUNT_Y screen
+// tiles and LIGHTCLUSTERS_COUNT_Z exponential depth slices; for each cluster the CPU (vaLightClusters) stores the list of
+// spot/point lights (indices into LightingShaderConstants::LightsSpotAndPoint) that can affect it.
+#define LIGHTCLUSTERS_COUNT_X                       16
+#define LIGHTCLUSTERS_COUNT_Y                       8
+#define LIGHTCLUSTERS_COUNT_Z                       16
+#define LIGHTCLUSTERS_COUNT                         (LIGHTCLUSTERS_COUNT_X * LIGHTCLUSTERS_COUNT_Y * LIGHTCLUSTERS_COUNT_Z)
+#define LIGHTCLUSTERS_INDEX_VECTORS                 3520        // 16 8-bit light indices per vector; sized to keep the whole constant buffer under 64kb
+#define LIGHTCLUSTERS_MAX_INDICES                   (LIGHTCLUSTERS_INDEX_VECTORS * 16)
+#define LIGHTCLUSTERS_ALL_LIGHTS                    0xFFFF      // cluster light count meaning 'no list, use all lights' (clustering disabled or ran out of index space)
+
+struct LightClustersShaderConstants
+{
+    // cluster slice = clamp( floor( log2( viewspaceDepth ) * DepthSliceScale + DepthSliceBias ), 0, LIGHTCLUSTERS_COUNT_Z-1 )
+    float                   DepthSliceScale;
+    float                   DepthSliceBias;
+    float                   Dummy0;
+    float                   Dummy1;
+
+    // one header per cluster, 4 per vector: offset into the index list in the lower 16 bits, light count in the upper 16 bits;
+    // cluster index is ( z * LIGHTCLUSTERS_COUNT_Y + y ) * LIGHTCLUSTERS_COUNT_X + x with y going from the top of the screen
+    vaVector4i              Headers[LIGHTCLUSTERS_COUNT / 4];
+
+    // 8-bit light indices, 4 per component, 16 per vector
+    vaVector4i              LightIndices[LIGHTCLUSTERS_INDEX_VECTORS];
+};
+
 #ifndef VA_COMPILED_AS_SHADER_CODE
 } // namespace Vanilla
 #endif
@@ -30,16 +30,25 @@ struct RenderMeshStandardVertexInput
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-RenderMaterialInterpolants VS_Standard( const in RenderMeshStandardVertexInput input )
+RenderMaterialInterpolants VS_Standard( const in RenderMeshStandardVertexInput input, uint instanceID : SV_InstanceID )
 {
     RenderMaterialInterpolants ret;
 
+    float4x4 world          = g_Instance.World;
+    float4x4 normalWorld    = g_Instance.NormalWorld;
+    [branch]
+    if( g_Instance.InstanceArrayEnabled != 0 )
+    {
+        world               = g_InstanceArray.Instances[instanceID].World;
+        normalWorld         = g_InstanceArray.Instances[instanceID].NormalWorld;
+    }
+
     //ret.Color                   = input.Color;
     ret.Texcoord01          = float4( input.Texcoord0, input.Texcoord1 );
     // ret.Texcoord23          = float4( 0, 0, 0, 0 );
 
-    ret.WorldspacePos        = mul( g_Instance.World, float4( input.Position.xyz, 1) );
-    ret.WorldspaceNormal.xyz = normalize( mul( (float3x3)g_Instance.NormalWorld, input.Normal.xyz ).xyz );
+    ret.WorldspacePos        = mul( world, float4( input.Position.xyz, 1) );
+    ret.WorldspaceNormal.xyz = normalize( mul( (float3x3)normalWorld, input.Normal.xyz ).xyz );
 
 #if 0 // TODO: maybe upgrade this, see Real-Time Rendering (Fourth Edition), pg 237/238
     {
@@ -58,6 +58,7 @@ namespace Vanilla
 #define POSTPROCESS_CONSTANTSBUFFERSLOT                     1
 #define RENDERMESHMATERIAL_CONSTANTSBUFFERSLOT              1
 #define SHADERINSTANCE_CONSTANTSBUFFERSLOT                  2
+#define SHADERINSTANCEARRAY_CONSTANTSBUFFERSLOT             5
 #define SKYBOX_CONSTANTSBUFFERSLOT                          4
 #define ZOOMTOOL_CONSTANTSBUFFERSLOT                        4
 #define CDLOD2_CONSTANTS_BUFFERSLOT                         3
@@ -66,13 +67,16 @@ namespace Vanilla
 #define SHADERGLOBAL_CONSTANTSBUFFERSLOT                    (SHADERGLOBAL_CBV_SLOT_BASE + 0)
 #define LIGHTINGGLOBAL_CONSTANTSBUFFERSLOT                  (SHADERGLOBAL_CBV_SLOT_BASE + 1)
 // #define LIGHTINGGLOBAL_DISTANTIBL_CONSTANTSBUFFERSLOT      (SHADERGLOBAL_CBV_SLOT_BASE + 2)
+#define LIGHTINGGLOBAL_CLUSTERS_CONSTANTSBUFFERSLOT         (SHADERGLOBAL_CBV_SLOT_BASE + 2)
 //
 // need to do this so X_CONCATENATER-s work
 #define SHADERGLOBAL_CONSTANTSBUFFERSLOT_V                  8
 #define LIGHTINGGLOBAL_CONSTANTSBUFFERSLOT_V                9
 //#define LIGHTINGGLOBAL_DISTANTIBL_CONSTANTSBUFFERSLOT_V    10
+#define LIGHTINGGLOBAL_CLUSTERS_CONSTANTSBUFFERSLOT_V       10
 #if (SHADERGLOBAL_CONSTANTSBUFFERSLOT_V != SHADERGLOBAL_CONSTANTSBUFFERSLOT)                                            \
     || (LIGHTINGGLOBAL_CONSTANTSBUFFERSLOT_V != LIGHTINGGLOBAL_CONSTANTSBUFFERSLOT)                                     \
+    || (LIGHTINGGLOBAL_CLUSTERS_CONSTANTSBUFFERSLOT_V != LIGHTINGGLOBAL_CLUSTERS_CONSTANTSBUFFERSLOT)                   \
 //    || (LIGHTINGGLOBAL_DISTANTIBL_CONSTANTSBUFFERSLOT_V != LIGHTINGGLOBAL_DISTANTIBL_CONSTANTSBUFFERSLOT)                                                     
     #error _V values above not in sync, just fix them up please
 #endif
@@ -209,6 +213,26 @@ struct ShaderInstanceConstants
     vaMatrix4x4         NormalWorld;
 
     vaVector4           CustomColor;          // used for highlights, wireframe, etc - finalColor.rgb = lerp( finalColor.rgb, g_Instance.CustomColor.rgb, g_Instance.CustomColor.a )
+
+    // if non-zero, World and NormalWorld above are ignored and taken from g_InstanceArray.Instances[SV_InstanceID] instead (instanced draw)
+    uint                InstanceArrayEnabled;
+    float               Dummy0;
+    float               Dummy1;
+    float               Dummy2;
+};
+
+// used by instanced draws (see vaRenderMeshManager::Draw automatic instancing); everything else comes from g_Instance
+#define SHADERINSTANCE_MAX_INSTANCES_PER_DRAW               32
+
+struct ShaderInstanceTransform
+{
+    vaMatrix4x4         World;
+    vaMatrix4x4         NormalWorld;
+};
+
+struct ShaderInstanceArrayConstants
+{
+    ShaderInstanceTransform Instances[SHADERINSTANCE_MAX_INSTANCES_PER_DRAW];
 };
 
 // struct GBufferConstants
@@ -262,6 +286,11 @@ cbuffer ShaderInstanceConstantsBuffer                   : register( B_CONCATENAT
     ShaderInstanceConstants                 g_Instance;
 }
 
+cbuffer ShaderInstanceArrayConstantsBuffer              : register( B_CONCATENATER( SHADERINSTANCEARRAY_CONSTANTSBUFFERSLOT ) )
+{
+    ShaderInstanceArrayConstants            g_InstanceArray;
+}
+
 // cbuffer GBufferConstantsBuffer                      : register( B_CONCATENATER( GBUFFER_CONSTANTSBUFFERSLOT ) )
 // {
 //     GBufferConstants                        g_GBufferConstants;
@@ -28,6 +28,8 @@
 
 #include "Core/System/vaFileTools.h"
 
+#include "Core/vaMemory.h"
+
 #include "Core/vaApplicationBase.h"
 
 #include "IntegratedExternals/vaImguiIntegration.h"
@@ -421,6 +423,7 @@ bool vaAssetPack::SaveAPACK( const wstring & fileName, bool lockMutex )
 
 bool vaAssetPack::LoadAPACKInner( vaStream & inStream, vector< shared_ptr<vaAsset> > & loadedAssets, vaBackgroundTaskManager::TaskContext & taskContext )
 {
+    VA_MEMORY_TAG_SCOPE( "AssetLoading" );
     m_assetStorageMutex.assert_locked_by_caller();
 
     int32 numberOfAssets = 0;
@@ -504,6 +507,7 @@ bool vaAssetPack::LoadAPACK( const wstring & fileName, bool async, bool lockMute
     std::unique_lock<mutex> assetStorageMutexLock(m_assetStorageMutex, std::defer_lock );    if( lockMutex ) assetStorageMutexLock.lock(); else m_assetStorageMutex.assert_locked_by_caller();
 
     RemoveAll( false );
+    m_shaderPreWarmPending = true;
 
     int64 size = 0;
     VERIFY_TRUE_RETURN_ON_FALSE( inStream.ReadValue<int64>( size ) );
@@ -670,9 +674,11 @@ bool vaAssetPack::SaveUnpacked( const wstring & folderRoot, bool lockMutex )
 
 bool vaAssetPack::LoadUnpacked( const wstring & folderRoot, bool lockMutex )
 {
+    VA_MEMORY_TAG_SCOPE( "AssetLoading" );
     std::unique_lock<mutex> assetStorageMutexLock(m_assetStorageMutex, std::defer_lock );    if( lockMutex ) assetStorageMutexLock.lock(); else m_assetStorageMutex.assert_locked_by_caller();
 
     RemoveAll( false );
+    m_shaderPreWarmPending = true;
 
     vaFileStream headerFile;
     if( !headerFile.Open( folderRoot + L"\\AssetPack.xml", FileCreationMode::Open, FileAccessMode::Read ) )
@@ -809,6 +815,24 @@ bool vaAssetPack::LoadUnpacked( const wstring & folderRoot, bool lockMutex )
     }
 }
 
+int vaAssetPack::PreWarmShaders( )
+{
+    assert( GetRenderDevice().IsRenderThread() );
+    m_shaderPreWarmPending = false;
+
+    vector<shared_ptr<vaAsset>> materialAssets = Find( [ ]( vaAsset & asset ) { return asset.Type == vaAssetType::RenderMaterial; } );
+
+    // lowest priority: anything that's actually being drawn already will be asking for its shaders with its screen coverage
+    int notReadyCount = 0;
+    for( const shared_ptr<vaAsset> & asset : materialAssets )
+    {
+        shared_ptr<vaRenderMaterial> material = vaAssetRenderMaterial::SafeCast( asset )->GetRenderMaterial( );
+        if( material != nullptr && !material->PreWarmShaders( 0.0f ) )
+            notReadyCount++;
+    }
+    return notReadyCount;
+}
+
 shared_ptr<vaAsset> vaAsset::GetSharedPtr( ) const 
 { 
     return m_parentPack.AssetAt( m_parentPackStorageIndex, true ); 
@@ -1287,33 +1311,40 @@ void vaAssetPack::UIPanelTick( vaApplicationBase & )
         if( ImGui::CollapsingHeader( "Tools", ImGuiTreeNodeFlags_Framed /*| ImGuiTreeNodeFlags_DefaultOpen*/ ) )
         {
             ImGui::Indent( indentSize );
-            if( ImGui::Button( "Compress uncompressed textures" ) )
+            const char * presetNames[] = { "Fast", "Balanced", "High quality" };
+            int preset = (int)m_ui_compressPreset;
+            if( ImGui::Combo( "Compression preset", &preset, presetNames, _countof( presetNames ) ) )
+                m_ui_compressPreset = (vaTextureCompressionPreset)vaMath::Clamp( preset, 0, (int)vaTextureCompressionPreset::MaxValue - 1 );
+
+            bool compressInProgress = m_compressTask != nullptr && !vaBackgroundTaskManager::GetInstance( ).IsFinished( m_compressTask );
+            if( compressInProgress )
+                ImGui::Text( "Compressing textures, %.1f%% done", vaBackgroundTaskManager::GetInstance( ).GetProgress( m_compressTask ) * 100.0f );
+            else if( ImGui::Button( "Compress uncompressed textures" ) )
             {
-                vector< shared_ptr<vaAsset> > meshes, materials, textures;
+                // encoding is done in the background (see vaTextureBatchCompressor), textures get replaced as they finish
+                vector<vaTextureBatchCompressor::Item> items;
                 for( auto asset : m_assetList )
                 {
                     if( asset->Type == vaAssetType::Texture )
                     {
                         shared_ptr<vaAssetTexture> assetTexture = std::dynamic_pointer_cast<vaAssetTexture>(asset);
+                        weak_ptr<vaAssetTexture> assetTextureWeak = assetTexture;
 
+                        vaTextureBatchCompressor::Item item;
+                        item.Texture        = assetTexture->GetTexture();
+                        item.Name           = asset->Name();
+                        item.OnCompressed   = [assetTextureWeak]( const shared_ptr<vaTexture> & original, const shared_ptr<vaTexture> & compressed )
                         {
-                            vaSimpleScopeTimerLog timer( "Compressing texture '"+asset->Name()+"'" );
-                            shared_ptr<vaTexture> texture = assetTexture->GetTexture();
-
-                            shared_ptr<vaTexture> compressedTexture = shared_ptr<vaTexture>( texture->TryCompress() );
-                            if( compressedTexture != nullptr )
-                            {
-                                VA_LOG( "Conversion successful, replacing vaAssetTexture's old resource with the newly compressed." );
-                                assetTexture->ReplaceTexture( compressedTexture );
-                            }
-                            else
-                            {
-                                VA_LOG( "Conversion skipped or failed." );
-                            }
-                        }
-                        VA_LOG( "" );
+                            shared_ptr<vaAssetTexture> assetTexture = assetTextureWeak.lock();
+                            if( assetTexture == nullptr || assetTexture->GetTexture() != original )
+                                return; // asset gone or changed in the meantime
+                            VA_LOG( "Conversion of '%s' successful, replacing vaAssetTexture's old resource with the newly compressed.", assetTexture->Name().c_str() );
+                            assetTexture->ReplaceTexture( compressed );
+                        };
+                        items.push_back( item );
                     }
                 }
+                m_compressTask = vaTextureBatchCompressor::Spawn( GetRenderDevice(), items, m_ui_compressPreset );
             }
 
 // not maintained, needs update
@@ -1622,6 +1653,10 @@ vaAssetPackManager::vaAssetPackManager( vaRenderDevice & renderDevice ) : m_rend
         hadAsyncOpLastFrame = std::max( 0, hadAsyncOpLastFrame - 1 );
         if( thisPtr->AnyAsyncOpExecuting( ) )
             hadAsyncOpLastFrame = 2;
+
+        for( const shared_ptr<vaAssetPack> & pack : thisPtr->m_assetPacks )
+            if( pack->m_shaderPreWarmPending && !pack->IsBackgroundTaskActive( ) )
+                pack->PreWarmShaders( );
     }
     );
 }
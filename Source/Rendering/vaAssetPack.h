@@ -164,6 +164,8 @@ namespace Vanilla
         mutex                                               m_apackStorageMutex;
 
         shared_ptr<vaBackgroundTaskManager::Task>           m_ioTask;
+        shared_ptr<vaBackgroundTaskManager::Task>           m_compressTask;         // see vaTextureBatchCompressor; only holds weak references to the assets so no need to wait on it
+        std::atomic_bool                                    m_shaderPreWarmPending  = false;    // set on load, see PreWarmShaders
 
         string                                              m_uiNameFilter          = "";
         bool                                                m_uiShowMeshes          = true;
@@ -177,6 +179,8 @@ namespace Vanilla
         bool                                                m_ui_teximport_generateMIPs         = true;
         shared_ptr<string>                                  m_ui_teximport_lastImportedInfo;
 
+        vaTextureCompressionPreset                          m_ui_compressPreset                 = vaTextureCompressionPreset::Balanced;
+
     private:
         friend class vaAssetPackManager;
         explicit vaAssetPack( vaAssetPackManager & assetPackManager, const string & name );
@@ -224,6 +228,11 @@ namespace Vanilla
 
         shared_ptr<vaAsset>                                 AssetAt( size_t index, bool lockMutex )     { std::unique_lock<mutex> assetStorageMutexLock(m_assetStorageMutex, std::defer_lock ); if( lockMutex ) assetStorageMutexLock.lock(); else m_assetStorageMutex.assert_locked_by_caller(); if( index >= m_assetList.size() ) return nullptr; else return m_assetList[index]; }
 
+        // Creates shaders for all material permutations used by the pack so they compile in parallel (on the background task pool) before
+        // the assets get drawn; draws that need them get to raise their priority. Called automatically at the start of the first frame after
+        // loading is done; must be called on the render thread. Returns the number of materials whose shaders aren't ready yet.
+        int                                                 PreWarmShaders( );
+
         const shared_ptr<vaBackgroundTaskManager::Task> &   GetCurrentIOTask( )                         { return m_ioTask; }
         void                                                WaitUntilIOTaskFinished( bool breakIfSafe = false );
         bool                                                IsBackgroundTaskActive( ) const;
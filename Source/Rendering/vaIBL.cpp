@@ -58,6 +58,8 @@ vaIBLProbe::~vaIBLProbe( )
 
 void vaIBLProbe::Reset( )
 {
+    m_incrementalCapture    = nullptr;
+
     m_reflectionsMap        = nullptr;
     m_irradianceMap         = nullptr;
     m_skyboxTexture         = nullptr;
@@ -260,128 +262,211 @@ bool vaIBLProbe::Import( vaRenderDeviceContext & renderContext, const vaIBLProbe
     // m_capturedData.Location.Axis = vaMatrix3x3::Identity;
     m_intensity = 1.0f; // really arbitrary, possibly just keep it at 1?
     
+#if IBL_IRRADIANCE_SOURCE == IBL_IRRADIANCE_SH
+    // equirectangular .hdr files get projected to SH on the CPU straight from the source pixels, which avoids
+    // stalling on the GPU readback in vaIrradianceSHCalculator::GetSH; everything else goes through the GPU path
+    vaSphericalHarmonics::SH3 rawSH;
+    bool hasRawSH = false;
+    if( vaStringTools::ToLower( vaFileTools::SplitPathExt( srcFilePath ) ) == ".hdr" )
+    {
+        vaImageMetrics::Image image;
+        if( vaImageMetrics::LoadRadianceHDR( vaStringTools::SimpleWiden( srcFilePath ), image ) && image.Width == 2 * image.Height )
+            hasRawSH = vaSphericalHarmonics::Project( vaSphericalHarmonics::Probe( image ), rawSH );
+    }
+    auto retValue = Process( renderContext, srcCube, ( hasRawSH ) ? ( &rawSH ) : ( nullptr ) );
+#else
     auto retValue = Process( renderContext, srcCube );
+#endif
     if( !retValue )
         Reset();
     return retValue;
 }
 
-bool vaIBLProbe::Process( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & srcCube )
+bool vaIBLProbe::Process( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & srcCube, const vaSphericalHarmonics::SH3 * precomputedRawSH )
 {
-    int reflRes = vaIBLCubemapPreFilter::c_defaultReflRoughCubeFirstMIPSize;
+    ProcessedContents contents;
+    if( !ProcessSkybox( renderContext, srcCube, m_capturedData, contents ) )
+    {
+        Reset( ); return false;
+    }
+    ProcessIrradianceBegin( renderContext, m_capturedData, precomputedRawSH, contents );
+    ProcessIrradianceEnd( renderContext, contents, false );
+    int reflLevels = ProcessReflectionsBegin( renderContext, contents );
+    ProcessReflectionsLevels( renderContext, contents, 0, reflLevels );
 
-    m_skyboxTexture = vaTexture::Create2D( GetRenderDevice( ), m_skyboxFormat, srcCube->GetSizeX(), srcCube->GetSizeY(), 0, 6, 1, vaResourceBindSupportFlags::ShaderResource | vaResourceBindSupportFlags::RenderTarget,
+    // ok just for debugging show 1 level
+    //m_skyboxTexture = vaTexture::CreateView( m_reflectionsMap, vaTextureFlags::Cubemap, 7, 1 );
+    //m_skyboxTexture = vaTexture::CreateView( m_skyboxTexture, vaTextureFlags::Cubemap, 1, 1 );
+
+    ApplyContents( contents );
+    return true;
+}
+
+bool vaIBLProbe::ProcessSkybox( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & srcCube, const vaIBLProbeData & probeData, ProcessedContents & outContents )
+{
+    outContents.SkyboxTexture = vaTexture::Create2D( GetRenderDevice( ), m_skyboxFormat, srcCube->GetSizeX(), srcCube->GetSizeY(), 0, 6, 1, vaResourceBindSupportFlags::ShaderResource | vaResourceBindSupportFlags::RenderTarget,
         vaResourceAccessFlags::Default, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::Cubemap );
 
     vaRenderDeviceContext::RenderOutputsState backupOutputs = renderContext.GetOutputs( );
-    vaVector4 colorAdd = { m_capturedData.AmbientColor * m_capturedData.AmbientColorIntensity, 0.0f };
+    vaVector4 colorAdd = { probeData.AmbientColor * probeData.AmbientColorIntensity, 0.0f };
     for( int face = 0; face < 6; face++ )
     {
         auto facemip0ViewSrc = vaTexture::CreateView( srcCube, srcCube->GetBindSupportFlags( ), vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::None,
             0, 1, face, 1 );
-        auto facemip0ViewDst = vaTexture::CreateView( m_skyboxTexture, m_skyboxTexture->GetBindSupportFlags( ), vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::None,
+        auto facemip0ViewDst = vaTexture::CreateView( outContents.SkyboxTexture, outContents.SkyboxTexture->GetBindSupportFlags( ), vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::None,
             0, 1, face, 1 );
 
         renderContext.SetRenderTarget( facemip0ViewDst, nullptr, true );
         auto result = renderContext.StretchRect( facemip0ViewSrc, vaVector4::Zero, vaVector4::Zero, false, vaBlendMode::Opaque, {1,1,1,1}, colorAdd );
         if( result != vaDrawResultFlags::None )
         {
-            assert( false ); Reset( ); return false;
+            assert( false ); renderContext.SetOutputs( backupOutputs ); return false;
         }
     }
     renderContext.SetOutputs( backupOutputs );
 
-    GetRenderDevice( ).GetPostProcess( ).GenerateCubeMIPs( renderContext, m_skyboxTexture );
+    GetRenderDevice( ).GetPostProcess( ).GenerateCubeMIPs( renderContext, outContents.SkyboxTexture );
+    return true;
+}
 
-    //////////////////////////////////////////////////////////////////////////
-    // irradiance
-    {
 #if IBL_IRRADIANCE_SOURCE == IBL_IRRADIANCE_SH
-        const int irradianceSrcRes = 128;
-        int levelDiff = std::max( 0, vaMath::FloorLog2( m_skyboxTexture->GetSizeX( ) / irradianceSrcRes ) );
-        auto irradianceInputCubeView = vaTexture::CreateView( m_skyboxTexture, vaTextureFlags::None, levelDiff, 1, 0, 6 );
+// the SH computation doesn't need the full skybox resolution
+static shared_ptr<vaTexture> CreateIrradianceSHSourceView( const shared_ptr<vaTexture> & skybox )
+{
+    const int irradianceSrcRes = 128;
+    int levelDiff = std::max( 0, vaMath::FloorLog2( skybox->GetSizeX( ) / irradianceSrcRes ) );
+    return vaTexture::CreateView( skybox, vaTextureFlags::None, levelDiff, 1, 0, 6 );
+}
+#endif
 
-        m_irradianceSHCalculator->ComputeSH( renderContext, irradianceInputCubeView );
+void vaIBLProbe::ProcessIrradianceBegin( vaRenderDeviceContext & renderContext, const vaIBLProbeData & probeData, const vaSphericalHarmonics::SH3 * precomputedRawSH, ProcessedContents & inOutContents )
+{
+#if IBL_IRRADIANCE_SOURCE == IBL_IRRADIANCE_SH
+    if( precomputedRawSH != nullptr )
+    {
+        // the ambient color gets added to every skybox texel in ProcessSkybox, which only affects the constant term
+        // (basis is 1 and the solid angles sum up to 4*PI)
+        vaSphericalHarmonics::SH3 rawSH = *precomputedRawSH;
+        rawSH[0] += probeData.AmbientColor * probeData.AmbientColorIntensity * ( 4.0f * (float)VA_PI );
+        inOutContents.IrradianceCoefs = vaSphericalHarmonics::PreprocessForShader( rawSH );
+        return;
+    }
 
-        std::array<vaVector3, 9> SH = m_irradianceSHCalculator->GetSH( renderContext );
-        const int numCoefs = vaIrradianceSHCalculator::c_numSHBands * vaIrradianceSHCalculator::c_numSHBands;
-        for( int i = 0; i < numCoefs; i++ )
-        {
-            // assert( vaVector3::NearEqual( m_irradianceCoefs[i], SH[i], 0.0001f ) );
-            m_irradianceCoefs[i] = SH[i];
-        }
+    auto irradianceInputCubeView = CreateIrradianceSHSourceView( inOutContents.SkyboxTexture );
+    m_irradianceSHCalculator->ComputeSH( renderContext, irradianceInputCubeView );
+    m_irradianceSHCalculator->BeginReadback( renderContext );
+    inOutContents.SHReadbackPending = true;
 #elif IBL_IRRADIANCE_SOURCE == IBL_IRRADIANCE_CUBEMAP
-        const int irradianceRes = vaIBLCubemapPreFilter::c_defaultIrradianceBaseCubeSize;
-        int levelDiff = std::max( 0, vaMath::FloorLog2( m_skyboxTexture->GetSizeX( ) / irradianceRes ) );
-        auto irradianceInputCubeView = vaTexture::CreateView( m_skyboxTexture, vaTextureFlags::Cubemap, levelDiff );
+    probeData; precomputedRawSH;   // only used by the SH path
+    const int irradianceRes = vaIBLCubemapPreFilter::c_defaultIrradianceBaseCubeSize;
+    int levelDiff = std::max( 0, vaMath::FloorLog2( inOutContents.SkyboxTexture->GetSizeX( ) / irradianceRes ) );
+    auto irradianceInputCubeView = vaTexture::CreateView( inOutContents.SkyboxTexture, vaTextureFlags::Cubemap, levelDiff );
 
-        m_irradianceMap = vaTexture::Create2D( GetRenderDevice( ), m_irradianceMapFormat, irradianceRes, irradianceRes, 0, 6, 1, vaResourceBindSupportFlags::ShaderResource | vaResourceBindSupportFlags::UnorderedAccess | vaResourceBindSupportFlags::RenderTarget, vaResourceAccessFlags::Default
-            , vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::Cubemap );
+    inOutContents.IrradianceMap = vaTexture::Create2D( GetRenderDevice( ), m_irradianceMapFormat, irradianceRes, irradianceRes, 0, 6, 1, vaResourceBindSupportFlags::ShaderResource | vaResourceBindSupportFlags::UnorderedAccess | vaResourceBindSupportFlags::RenderTarget, vaResourceAccessFlags::Default
+        , vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::Cubemap );
 
-        vector<shared_ptr<vaTexture>> destCubeMIPLevels;
-        destCubeMIPLevels.push_back( vaTexture::CreateView( m_irradianceMap, vaTextureFlags::Cubemap, 0, 1, 0, 6 ) );
+    vector<shared_ptr<vaTexture>> destCubeMIPLevels;
+    destCubeMIPLevels.push_back( vaTexture::CreateView( inOutContents.IrradianceMap, vaTextureFlags::Cubemap, 0, 1, 0, 6 ) );
 
-        m_irradiancePreFilter->Init( irradianceRes, irradianceRes, vaIBLCubemapPreFilter::c_defaultSamplesPerTexel, vaIBLCubemapPreFilter::FilterType::Irradiance );
-        m_irradiancePreFilter->Process( renderContext, destCubeMIPLevels, irradianceInputCubeView );
+    m_irradiancePreFilter->Init( irradianceRes, irradianceRes, vaIBLCubemapPreFilter::c_defaultSamplesPerTexel, vaIBLCubemapPreFilter::FilterType::Irradiance );
+    m_irradiancePreFilter->Process( renderContext, destCubeMIPLevels, irradianceInputCubeView );
 
-        GetRenderDevice( ).GetPostProcess( ).GenerateCubeMIPs( renderContext, m_irradianceMap );
+    GetRenderDevice( ).GetPostProcess( ).GenerateCubeMIPs( renderContext, inOutContents.IrradianceMap );
 #else
 #error IBL_IRRADIANCE_SOURCE not correctly defined / supported
 #endif
-    }
-    //////////////////////////////////////////////////////////////////////////
+}
+
+bool vaIBLProbe::ProcessIrradianceEnd( vaRenderDeviceContext & renderContext, ProcessedContents & inOutContents, bool doNotWait )
+{
+    if( !inOutContents.SHReadbackPending )
+        return true;
 
-    //////////////////////////////////////////////////////////////////////////
-    // reflections
+    std::array<vaVector3, 9> SH;
+    if( !m_irradianceSHCalculator->TryGetReadback( renderContext, SH, doNotWait ) )
     {
-        //assert( m_skyboxTexture->GetSizeX( ) >= m_reflectionsMap->GetSizeX( ) );
-        int levelDiff = std::max( 0, vaMath::FloorLog2( m_skyboxTexture->GetSizeX( ) / reflRes ) );
-        shared_ptr<vaTexture> srcView = vaTexture::CreateView( m_skyboxTexture, vaTextureFlags::Cubemap, levelDiff );
-        int reflMIPs = vaMath::FloorLog2( reflRes ) + 1;
+        if( doNotWait )
+            return false;
+        assert( false );    // blocking map failed; coefs stay at zero
+        inOutContents.SHReadbackPending = false;
+        return true;
+    }
+    inOutContents.SHReadbackPending = false;
+
+    const int numCoefs = vaIrradianceSHCalculator::c_numSHBands * vaIrradianceSHCalculator::c_numSHBands;
+    for( int i = 0; i < numCoefs; i++ )
+        inOutContents.IrradianceCoefs[i] = SH[i];
+    return true;
+}
+
+int vaIBLProbe::ProcessReflectionsBegin( vaRenderDeviceContext & renderContext, ProcessedContents & inOutContents )
+{
+    int reflRes = vaIBLCubemapPreFilter::c_defaultReflRoughCubeFirstMIPSize;
+
+    //assert( m_skyboxTexture->GetSizeX( ) >= m_reflectionsMap->GetSizeX( ) );
+    int levelDiff = std::max( 0, vaMath::FloorLog2( inOutContents.SkyboxTexture->GetSizeX( ) / reflRes ) );
+    int reflMIPs = vaMath::FloorLog2( reflRes ) + 1;
 
 #if IBL_INTEGRATION_ALGORITHM == IBL_INTEGRATION_PREFILTERED_CUBEMAP
-        reflMIPs -= vaMath::FloorLog2( vaIBLCubemapPreFilter::c_defaultReflRoughCubeLastMIPSize );
-        m_reflectionsMap = vaTexture::Create2D( GetRenderDevice( ), m_reflectionsMapFormat, reflRes, reflRes, reflMIPs, 6, 1, vaResourceBindSupportFlags::ShaderResource | vaResourceBindSupportFlags::UnorderedAccess, vaResourceAccessFlags::Default
-            , vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::Cubemap );
-        m_maxReflMIPLevel = reflMIPs - 1;
-        vector<shared_ptr<vaTexture>> destCubeMIPLevels;
-        for( int i = 0; i < reflMIPs; i++ )
-            destCubeMIPLevels.push_back( vaTexture::CreateView( m_reflectionsMap, vaTextureFlags::Cubemap, i, 1, 0, 6 ) );
-        
-        m_reflectionsPreFilter->Init( reflRes, vaIBLCubemapPreFilter::c_defaultReflRoughCubeLastMIPSize, vaIBLCubemapPreFilter::c_defaultSamplesPerTexel, vaIBLCubemapPreFilter::FilterType::ReflectionsRoughness );
-        m_reflectionsPreFilter->Process( renderContext, destCubeMIPLevels, srcView );
+    renderContext;
+    levelDiff;
+    reflMIPs -= vaMath::FloorLog2( vaIBLCubemapPreFilter::c_defaultReflRoughCubeLastMIPSize );
+    inOutContents.ReflectionsMap = vaTexture::Create2D( GetRenderDevice( ), m_reflectionsMapFormat, reflRes, reflRes, reflMIPs, 6, 1, vaResourceBindSupportFlags::ShaderResource | vaResourceBindSupportFlags::UnorderedAccess, vaResourceAccessFlags::Default
+        , vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::Cubemap );
+    inOutContents.MaxReflMIPLevel = reflMIPs - 1;
+
+    // the filter is set up here (it's the expensive CPU part - sample generation); levels then get filtered in ProcessReflectionsLevels
+    m_reflectionsPreFilter->Init( reflRes, vaIBLCubemapPreFilter::c_defaultReflRoughCubeLastMIPSize, vaIBLCubemapPreFilter::c_defaultSamplesPerTexel, vaIBLCubemapPreFilter::FilterType::ReflectionsRoughness );
+    return (int)m_reflectionsPreFilter->GetMIPLevelCount( );
 
 #elif IBL_INTEGRATION_ALGORITHM == IBL_INTEGRATION_IMPORTANCE_SAMPLING
-        m_reflectionsMap = vaTexture::Create2D( GetRenderDevice( ), vaResourceFormat::R16G16B16A16_FLOAT, reflRes, reflRes, reflMIPs, 6, 1, vaResourceBindSupportFlags::ShaderResource | vaResourceBindSupportFlags::RenderTarget, vaResourceAccessFlags::Default
-            , vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::Cubemap );
-        m_maxReflMIPLevel = reflMIPs - 1;
+    inOutContents.ReflectionsMap = vaTexture::Create2D( GetRenderDevice( ), vaResourceFormat::R16G16B16A16_FLOAT, reflRes, reflRes, reflMIPs, 6, 1, vaResourceBindSupportFlags::ShaderResource | vaResourceBindSupportFlags::RenderTarget, vaResourceAccessFlags::Default
+        , vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::Cubemap );
+    inOutContents.MaxReflMIPLevel = reflMIPs - 1;
 
-        for( int face = 0; face < 6; face++ )
-        {
-            auto facemip0ViewSrc = vaTexture::CreateView( m_skyboxTexture, vaTextureFlags::None, levelDiff, 1, face, 1 );
-            auto facemip0ViewDst = vaTexture::CreateView( m_reflectionsMap, vaTextureFlags::None, 0, 1, face, 1 );
+    for( int face = 0; face < 6; face++ )
+    {
+        auto facemip0ViewSrc = vaTexture::CreateView( inOutContents.SkyboxTexture, vaTextureFlags::None, levelDiff, 1, face, 1 );
+        auto facemip0ViewDst = vaTexture::CreateView( inOutContents.ReflectionsMap, vaTextureFlags::None, 0, 1, face, 1 );
 
-            auto result = renderContext.CopySRVToRTV( facemip0ViewDst, facemip0ViewSrc );
-            if( result != vaDrawResultFlags::None )
-            {
-                assert( false ); Reset( ); return false;
-            }
-        }
-        GetRenderDevice( ).GetPostProcess( ).GenerateCubeMIPs( renderContext, m_reflectionsMap );
+        auto result = renderContext.CopySRVToRTV( facemip0ViewDst, facemip0ViewSrc );
+        assert( result == vaDrawResultFlags::None ); result;
+    }
+    GetRenderDevice( ).GetPostProcess( ).GenerateCubeMIPs( renderContext, inOutContents.ReflectionsMap );
+    return 0;   // all done, nothing left for ProcessReflectionsLevels
 #else
     #error IBL_INTEGRATION_ALGORITHM not correctly defined / supported
 #endif
-    }
-  
-    // ok just for debugging show 1 level
-    //m_skyboxTexture = vaTexture::CreateView( m_reflectionsMap, vaTextureFlags::Cubemap, 7, 1 );
-    //m_skyboxTexture = vaTexture::CreateView( m_skyboxTexture, vaTextureFlags::Cubemap, 1, 1 );
-    //
-    //////////////////////////////////////////////////////////////////////////
+}
 
-    m_hasContents = true;
-    
-    return true;
+void vaIBLProbe::ProcessReflectionsLevels( vaRenderDeviceContext & renderContext, ProcessedContents & inOutContents, int firstLevel, int levelCount )
+{
+    if( levelCount <= 0 )
+        return;
+#if IBL_INTEGRATION_ALGORITHM == IBL_INTEGRATION_PREFILTERED_CUBEMAP
+    int reflRes = vaIBLCubemapPreFilter::c_defaultReflRoughCubeFirstMIPSize;
+    int levelDiff = std::max( 0, vaMath::FloorLog2( inOutContents.SkyboxTexture->GetSizeX( ) / reflRes ) );
+    shared_ptr<vaTexture> srcView = vaTexture::CreateView( inOutContents.SkyboxTexture, vaTextureFlags::Cubemap, levelDiff );
+
+    vector<shared_ptr<vaTexture>> destCubeMIPLevels;
+    for( int i = 0; i <= inOutContents.MaxReflMIPLevel; i++ )
+        destCubeMIPLevels.push_back( vaTexture::CreateView( inOutContents.ReflectionsMap, vaTextureFlags::Cubemap, i, 1, 0, 6 ) );
+
+    m_reflectionsPreFilter->ProcessLevels( renderContext, destCubeMIPLevels, srcView, (uint32)firstLevel, (uint32)levelCount );
+#else
+    renderContext; inOutContents; firstLevel;
+    assert( false ); // ProcessReflectionsBegin does all the work for this path
+#endif
+}
+
+void vaIBLProbe::ApplyContents( ProcessedContents & contents )
+{
+    m_skyboxTexture     = contents.SkyboxTexture;
+    m_reflectionsMap    = contents.ReflectionsMap;
+    m_maxReflMIPLevel   = contents.MaxReflMIPLevel;
+    m_irradianceMap     = contents.IrradianceMap;
+    m_irradianceCoefs   = contents.IrradianceCoefs;
+    m_hasContents       = true;
 }
 
 void vaIBLProbe::SetToSkybox( vaSkybox & skybox )
@@ -401,42 +486,123 @@ void vaIBLProbe::UIPanelTick( vaApplicationBase& application )
 #ifdef VA_IMGUI_INTEGRATION_ENABLED
 
     ImGui::Text( "Enabled: %s", ((HasContents())?("true"):("false")) );
+    if( m_incrementalCapture != nullptr )
+        ImGui::Text( "Time-sliced capture in progress (stage %d)", (int)m_incrementalCapture->CurrentStage );
     if( ImGui::Button( "Reset", {-1, 0} ) )
         Reset();
+#if IBL_IRRADIANCE_SOURCE == IBL_IRRADIANCE_SH
+    if( HasSkybox( ) && ImGui::Button( "Compare irradiance SH with GPU", {-1, 0} ) )
+        m_lastGPUSHDifference = CompareIrradianceSHWithGPU( *GetRenderDevice( ).GetMainContext( ) );
+    if( m_lastGPUSHDifference >= 0 )
+        ImGui::Text( "Max SH difference to GPU: %.2f%%", m_lastGPUSHDifference * 100.0f );
+#endif
 #endif // VA_IMGUI_INTEGRATION_ENABLED
 }
 
-vaDrawResultFlags vaIBLProbe::Capture( vaRenderDeviceContext & renderContext, const vaIBLProbeData & captureData, const CubeFaceCaptureCallback & faceCapture, int cubeFaceResolution )
+float vaIBLProbe::CompareIrradianceSHWithGPU( vaRenderDeviceContext & renderContext )
 {
-    Reset( );
-    
-    m_capturedData                  = captureData;
-    const vaVector3 & position      = captureData.Position;
-    const vaMatrix3x3 & rotation    = vaMatrix3x3::Identity; rotation; // captureData.Orientation;
-    float clipNear                  = captureData.ClipNear;
-    float clipFar                   = captureData.ClipFar;
+#if IBL_IRRADIANCE_SOURCE == IBL_IRRADIANCE_SH
+    if( !HasSkybox( ) || m_incrementalCapture != nullptr )   // the calculator's readback may be in use by the capture
+        return -1.0f;
+
+    // same source and post-processing as the GPU path in ProcessIrradianceBegin / ProcessIrradianceEnd
+    auto irradianceInputCubeView = CreateIrradianceSHSourceView( m_skyboxTexture );
+    m_irradianceSHCalculator->ComputeSH( renderContext, irradianceInputCubeView );
+    std::array<vaVector3, 9> gpuSH = m_irradianceSHCalculator->GetSH( renderContext );
+
+    float scale = 0.0f;
+    for( int c = 0; c < 3; c++ )
+        scale = std::max( scale, std::abs( gpuSH[0][c] ) );
+    if( scale <= 0.0f )
+        return -1.0f;
+
+    float maxDiff = 0.0f;
+    for( int i = 0; i < (int)gpuSH.size( ); i++ )
+        for( int c = 0; c < 3; c++ )
+            maxDiff = std::max( maxDiff, std::abs( gpuSH[i][c] - m_irradianceCoefs[i][c] ) );
+    return maxDiff / scale;
+#else
+    renderContext;
+    return -1.0f;
+#endif
+}
 
-    auto captureCube = vaTexture::Create2D( GetRenderDevice( ), vaResourceFormat::R16G16B16A16_FLOAT, cubeFaceResolution, cubeFaceResolution, 1, 6, 1, vaResourceBindSupportFlags::ShaderResource | vaResourceBindSupportFlags::RenderTarget,
-        vaResourceAccessFlags::Default, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::Cubemap );
+void vaIBLProbe::SetCubeFaceCameraOrientation( vaCameraBase & camera, const vaVector3 & position, int face )
+{
+    vaVector3 lookAtDir, upVec;
 
-    shared_ptr<vaTexture> cubeFaceViews[6];
+    // see https://msdn.microsoft.com/en-us/library/windows/desktop/bb204881(v=vs.85).aspx
+    switch( face )
+    {
+    case 0: // positive x (+y up)
+        lookAtDir   = vaVector3( 1.0f, 0.0f, 0.0f );
+        upVec       = vaVector3( 0.0f, 1.0f, 0.0f );
+        break;
+    case 1: // negative x (+y up)
+        lookAtDir   = vaVector3( -1.0f, 0.0f, 0.0f );
+        upVec       = vaVector3( 0.0f, 1.0f, 0.0f );
+        break;
+    case 2: // positive y (-z up)
+        lookAtDir   = vaVector3( 0.0f, 1.0f, 0.0f );
+        upVec       = vaVector3( 0.0f, 0.0f, -1.0f );
+        break;
+    case 3: // negative y (z up)
+        lookAtDir   = vaVector3( 0.0f, -1.0f, 0.0f );
+        upVec       = vaVector3( 0.0f, 0.0f, 1.0f );
+        break;
+    case 4: // positive z (y up)
+        lookAtDir   = vaVector3( 0.0f, 0.0f, 1.0f );
+        upVec       = vaVector3( 0.0f, 1.0f, 0.0f );
+        break;
+    case 5: // negative z (y up)
+        lookAtDir   = vaVector3( 0.0f, 0.0f, -1.0f );
+        upVec       = vaVector3( 0.0f, 1.0f, 0.0f );
+        break;
+    default: assert( false ); return;
+    }
 
-    for( int face = 0; face < 6; face++ )
-        cubeFaceViews[face] = vaTexture::CreateView( captureCube, vaTextureFlags::None, 0, 1, face, 1 );
+    // 
+    // lookAtDir   = vaVector3::TransformNormal( lookAtDir, rotation );
+    // upVec       = vaVector3::TransformNormal( upVec, rotation );
+
+    camera.SetOrientationLookAt( position + lookAtDir, upVec );
+    camera.Tick( 0, false );
+}
+
+shared_ptr<vaTexture> vaIBLProbe::CreateCaptureCube( const vaIBLProbeData & captureData, int cubeFaceResolution, vaCameraBase & outFaceCamera )
+{
+    auto captureCube = vaTexture::Create2D( GetRenderDevice( ), vaResourceFormat::R16G16B16A16_FLOAT, cubeFaceResolution, cubeFaceResolution, 1, 6, 1, vaResourceBindSupportFlags::ShaderResource | vaResourceBindSupportFlags::RenderTarget,
+        vaResourceAccessFlags::Default, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaResourceFormat::Automatic, vaTextureFlags::Cubemap );
 
     if( m_cubeCaptureScratchDepth == nullptr || m_cubeCaptureScratchDepth->GetSizeX() != captureCube->GetSizeX() || m_cubeCaptureScratchDepth->GetSizeY() != captureCube->GetSizeY() )
     {
         m_cubeCaptureScratchDepth = vaTexture::Create2D( GetRenderDevice(), vaResourceFormat::D32_FLOAT, cubeFaceResolution, cubeFaceResolution, 1, 1, 1, vaResourceBindSupportFlags::DepthStencil );
     }
 
+    outFaceCamera.SetYFOV( 90.0f / 180.0f * VA_PIf );
+    outFaceCamera.SetNearPlaneDistance( captureData.ClipNear );
+    outFaceCamera.SetFarPlaneDistance( captureData.ClipFar );
+    outFaceCamera.SetViewportSize( captureCube->GetSizeX( ), captureCube->GetSizeY( ) );
+    outFaceCamera.SetPosition( captureData.Position );
+
+    return captureCube;
+}
+
+vaDrawResultFlags vaIBLProbe::Capture( vaRenderDeviceContext & renderContext, const vaIBLProbeData & captureData, const CubeFaceCaptureCallback & faceCapture, int cubeFaceResolution )
+{
+    Reset( );
+    
+    m_capturedData                  = captureData;
+    const vaVector3 & position      = captureData.Position;
+    const vaMatrix3x3 & rotation    = vaMatrix3x3::Identity; rotation; // captureData.Orientation;
 
     vaCameraBase cameraFrontCubeFace;
+    auto captureCube = CreateCaptureCube( captureData, cubeFaceResolution, cameraFrontCubeFace );
 
-    cameraFrontCubeFace.SetYFOV( 90.0f / 180.0f * VA_PIf );
-    cameraFrontCubeFace.SetNearPlaneDistance( clipNear );
-    cameraFrontCubeFace.SetFarPlaneDistance( clipFar );
-    cameraFrontCubeFace.SetViewportSize( captureCube->GetSizeX( ), captureCube->GetSizeY( ) );
-    cameraFrontCubeFace.SetPosition( position );
+    shared_ptr<vaTexture> cubeFaceViews[6];
+
+    for( int face = 0; face < 6; face++ )
+        cubeFaceViews[face] = vaTexture::CreateView( captureCube, vaTextureFlags::None, 0, 1, face, 1 );
 
     vaDrawResultFlags drawResults = vaDrawResultFlags::None;
 
@@ -453,43 +619,7 @@ vaDrawResultFlags vaIBLProbe::Capture( vaRenderDeviceContext & renderContext, co
         // draw all 6 faces - this should get optimized to GS in the future
         for( int i = 0; i < 6; i++ )
         {
-            vaVector3 lookAtDir, upVec;
-
-            // see https://msdn.microsoft.com/en-us/library/windows/desktop/bb204881(v=vs.85).aspx
-            switch( i )
-            {
-            case 0: // positive x (+y up)
-                lookAtDir   = vaVector3( 1.0f, 0.0f, 0.0f );
-                upVec       = vaVector3( 0.0f, 1.0f, 0.0f );
-                break;
-            case 1: // negative x (+y up)
-                lookAtDir   = vaVector3( -1.0f, 0.0f, 0.0f );
-                upVec       = vaVector3( 0.0f, 1.0f, 0.0f );
-                break;
-            case 2: // positive y (-z up)
-                lookAtDir   = vaVector3( 0.0f, 1.0f, 0.0f );
-                upVec       = vaVector3( 0.0f, 0.0f, -1.0f );
-                break;
-            case 3: // negative y (z up)
-                lookAtDir   = vaVector3( 0.0f, -1.0f, 0.0f );
-                upVec       = vaVector3( 0.0f, 0.0f, 1.0f );
-                break;
-            case 4: // positive z (y up)
-                lookAtDir   = vaVector3( 0.0f, 0.0f, 1.0f );
-                upVec       = vaVector3( 0.0f, 1.0f, 0.0f );
-                break;
-            case 5: // negative z (y up)
-                lookAtDir   = vaVector3( 0.0f, 0.0f, -1.0f );
-                upVec       = vaVector3( 0.0f, 1.0f, 0.0f );
-                break;
-            }
-
-            // 
-            // lookAtDir   = vaVector3::TransformNormal( lookAtDir, rotation );
-            // upVec       = vaVector3::TransformNormal( upVec, rotation );
-
-            tempCamera.SetOrientationLookAt( position + lookAtDir, upVec );
-            tempCamera.Tick( 0, false );
+            SetCubeFaceCameraOrientation( tempCamera, position, i );
 
             drawResults |= faceCapture( renderContext, tempCamera, m_cubeCaptureScratchDepth, cubeFaceViews[i] );
             if( drawResults != vaDrawResultFlags::None )
@@ -515,6 +645,121 @@ vaDrawResultFlags vaIBLProbe::Capture( vaRenderDeviceContext & renderContext, co
     return drawResults;
 }
 
+bool vaIBLProbe::IsIncrementalCaptureInProgress( const vaIBLProbeData & captureData ) const
+{
+    return m_incrementalCapture != nullptr && m_incrementalCapture->Data == captureData;
+}
+
+void vaIBLProbe::CancelIncrementalCapture( )
+{
+    m_incrementalCapture = nullptr;
+}
+
+vaDrawResultFlags vaIBLProbe::CaptureIncremental( vaRenderDeviceContext & renderContext, const vaIBLProbeData & captureData, const CubeFaceCaptureCallback & faceCapture, const IncrementalCaptureSettings & settings, bool & outCompleted )
+{
+    VA_TRACE_CPUGPU_SCOPE( IBLCaptureIncremental, renderContext );
+    outCompleted = false;
+
+    // (re)start if there's nothing in progress or if the capture parameters changed in the meantime
+    if( !IsIncrementalCaptureInProgress( captureData ) || m_incrementalCapture->CubeFaceResolution != settings.CubeFaceResolution )
+    {
+        m_incrementalCapture = std::make_unique<IncrementalCapture>( );
+        m_incrementalCapture->Data                  = captureData;
+        m_incrementalCapture->CubeFaceResolution    = settings.CubeFaceResolution;
+        m_incrementalCapture->CaptureCube           = CreateCaptureCube( captureData, settings.CubeFaceResolution, m_incrementalCapture->FaceCamera );
+    }
+    IncrementalCapture & capture = *m_incrementalCapture;
+
+    capture.Calls++;
+
+    vaDrawResultFlags drawResults = vaDrawResultFlags::None;
+    const double startTime = vaCore::TimeFromAppStart( );
+    bool yieldFrame = false;
+    for( int step = 0; capture.CurrentStage != IncrementalCapture::Stage::Done && !yieldFrame; step++ )
+    {
+        // always do at least one step so that the capture progresses regardless of the budget
+        if( step > 0 && ( ( settings.MaxStepsPerFrame > 0 && step >= settings.MaxStepsPerFrame ) || ( vaCore::TimeFromAppStart( ) - startTime ) * 1000.0 >= settings.FrameBudgetMs ) )
+            break;
+
+        switch( capture.CurrentStage )
+        {
+        case( IncrementalCapture::Stage::Faces ):
+        {
+            vaRenderDeviceContext::RenderOutputsState outputs = renderContext.GetOutputs( );
+            vaCameraBase faceCamera = capture.FaceCamera;
+            SetCubeFaceCameraOrientation( faceCamera, capture.Data.Position, capture.NextFace );
+            auto faceView = vaTexture::CreateView( capture.CaptureCube, vaTextureFlags::None, 0, 1, capture.NextFace, 1 );
+            drawResults |= faceCapture( renderContext, faceCamera, m_cubeCaptureScratchDepth, faceView );
+            renderContext.SetOutputs( outputs );
+
+            // assets still loading / shaders compiling: keep the state and redo this face next time
+            if( drawResults != vaDrawResultFlags::None )
+                return drawResults;
+            if( ++capture.NextFace == 6 )
+                capture.CurrentStage = IncrementalCapture::Stage::Skybox;
+        } break;
+        case( IncrementalCapture::Stage::Skybox ):
+        {
+            if( !ProcessSkybox( renderContext, capture.CaptureCube, capture.Data, capture.Contents ) )
+            {
+                m_incrementalCapture = nullptr;
+                return vaDrawResultFlags::UnspecifiedError;
+            }
+            capture.CaptureCube     = nullptr;
+            capture.CurrentStage    = IncrementalCapture::Stage::IrradianceBegin;
+        } break;
+        case( IncrementalCapture::Stage::IrradianceBegin ):
+        {
+            ProcessIrradianceBegin( renderContext, capture.Data, nullptr, capture.Contents );
+            capture.ReadbackIssueCall   = capture.Calls;
+            capture.CurrentStage        = IncrementalCapture::Stage::ReflectionsBegin;
+        } break;
+        case( IncrementalCapture::Stage::ReflectionsBegin ):
+        {
+            capture.ReflLevelCount  = ProcessReflectionsBegin( renderContext, capture.Contents );
+            capture.NextReflLevel   = 0;
+            capture.CurrentStage    = IncrementalCapture::Stage::ReflectionsLevels;
+        } break;
+        case( IncrementalCapture::Stage::ReflectionsLevels ):
+        {
+            if( capture.NextReflLevel < capture.ReflLevelCount )
+            {
+                ProcessReflectionsLevels( renderContext, capture.Contents, capture.NextReflLevel, 1 );
+                capture.NextReflLevel++;
+            }
+            if( capture.NextReflLevel >= capture.ReflLevelCount )
+                capture.CurrentStage = IncrementalCapture::Stage::IrradianceEnd;
+        } break;
+        case( IncrementalCapture::Stage::IrradianceEnd ):
+        {
+            // the readback copy got issued in IrradianceBegin; never map it in the same call (the GPU can't have finished it
+            // yet) and only poll - if it's not ready, try again next call
+            if( capture.ReadbackIssueCall == capture.Calls || !ProcessIrradianceEnd( renderContext, capture.Contents, true ) )
+                yieldFrame = true;
+            else
+                capture.CurrentStage = IncrementalCapture::Stage::Done;
+        } break;
+        default: assert( false ); break;
+        }
+    }
+
+    if( capture.CurrentStage != IncrementalCapture::Stage::Done )
+        return drawResults;
+
+    // the SH readback alone guarantees at least two calls - completing in one would mean the whole capture hitched a single frame
+    assert( capture.Calls > 1 );
+
+    // swap the new contents in all at once
+    capture.Contents.SkyboxTexture = nullptr; // don't use captured data as a skybox - doesn't really make much sense (same as Capture)
+    ApplyContents( capture.Contents );
+    m_capturedData      = capture.Data;
+    m_fullImportedPath  = "";
+    m_intensity         = 1.0f;
+    m_incrementalCapture = nullptr;
+    outCompleted = true;
+    return drawResults;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -785,6 +1030,11 @@ void vaIBLCubemapPreFilter::Init( uint32 outputBaseSize, uint32 outputMinSize, u
 }
 
 void vaIBLCubemapPreFilter::Process( vaRenderDeviceContext & renderContext, vector<shared_ptr<vaTexture>> destCubeMIPLevels, shared_ptr<vaTexture>& srcCube )
+{
+    ProcessLevels( renderContext, destCubeMIPLevels, srcCube, 0, m_numMIPLevels );
+}
+
+void vaIBLCubemapPreFilter::ProcessLevels( vaRenderDeviceContext & renderContext, const vector<shared_ptr<vaTexture>> & destCubeMIPLevels, shared_ptr<vaTexture> & srcCube, uint32 firstLevel, uint32 levelCount )
 {
     if( m_levels.size() == 0 )
         { assert( false ); VA_WARN( "vaIBLCubemapPreFilter::Process - filter not initialized, unable to run!" ); return; }    
@@ -802,7 +1052,8 @@ void vaIBLCubemapPreFilter::Process( vaRenderDeviceContext & renderContext, vect
     int srcMIPs = srcCube->GetMipLevels();
     assert( srcMIPs >= destCubeMIPLevels.size() ); srcMIPs;
 
-    for( uint32 level = 0; level < m_numMIPLevels; level++ )
+    assert( firstLevel + levelCount <= m_numMIPLevels );
+    for( uint32 level = firstLevel; level < std::min( firstLevel + levelCount, m_numMIPLevels ); level++ )
     {
         // first level is roughness == 0 so no filtering needed - but we use the same path which copies cube mip 0 from source
         LevelInfo& levelInfo = m_levels[level];
@@ -922,9 +1173,7 @@ void vaIrradianceSHCalculator::ComputeSH( vaRenderDeviceContext& renderContext,
     }
 #endif
 
-    // postprocess - previously done on the CPU like this:
-    //      WindowSH( SH, c_numSHBands, 0.0f );
-    //      PreprocessSHForShader( SH, c_numSHBands );
+    // postprocess - CPU equivalent is vaSphericalHarmonics::PreprocessForShader
     {
         m_CSPostProcessSH->WaitFinishIfBackgroundCreateActive( );
         vaComputeItem computeItem;
@@ -939,19 +1188,27 @@ void vaIrradianceSHCalculator::ComputeSH( vaRenderDeviceContext& renderContext,
 std::array<vaVector3, 9> vaIrradianceSHCalculator::GetSH( vaRenderDeviceContext& renderContext )
 {
     std::array<vaVector3, 9> SH;
-    m_SHCPUReadback->CopyFrom( renderContext, m_SH );
-    if( m_SHCPUReadback->TryMap( renderContext, vaResourceMapType::Read, false ) )
-    {
-        vector<vaTextureMappedSubresource>& mappedData = m_SHCPUReadback->GetMappedData( );
-        vaVector3* SHData = reinterpret_cast<vaVector3*>( mappedData[0].Buffer );
-        for( int i = 0; i < 9; i++ )
-            SH[i] = SHData[i];
-        m_SHCPUReadback->Unmap( renderContext );
-    }
+    BeginReadback( renderContext );
+    TryGetReadback( renderContext, SH, false );
     return SH;
 }
 
+void vaIrradianceSHCalculator::BeginReadback( vaRenderDeviceContext & renderContext )
+{
+    m_SHCPUReadback->CopyFrom( renderContext, m_SH );
+}
 
+bool vaIrradianceSHCalculator::TryGetReadback( vaRenderDeviceContext & renderContext, std::array<vaVector3, 9> & outSH, bool doNotWait )
+{
+    if( !m_SHCPUReadback->TryMap( renderContext, vaResourceMapType::Read, doNotWait ) )
+        return false;
+    vector<vaTextureMappedSubresource>& mappedData = m_SHCPUReadback->GetMappedData( );
+    vaVector3* SHData = reinterpret_cast<vaVector3*>( mappedData[0].Buffer );
+    for( int i = 0; i < 9; i++ )
+        outSH[i] = SHData[i];
+    m_SHCPUReadback->Unmap( renderContext );
+    return true;
+}
 
 
 
@@ -993,487 +1250,7 @@ std::array<vaVector3, 9> vaIrradianceSHCalculator::GetSH( vaRenderDeviceContext&
 
 
 
-#if 0
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// from "filament\libs\ibl\src\CubemapSH.cpp"
-static inline constexpr uint32 SHindex( int32 m, uint32 l ) 
-{
-    return l * ( l + 1 ) + m;
-}
-//
-/*
- * returns n! / d!
- */
-static constexpr float factorial(uint32 n, uint32 d) 
-{
-   d = std::max(uint32(1), d);
-   n = std::max(uint32(1), n);
-   float r = 1.0;
-   if (n == d) {
-       // intentionally left blank
-   } else if (n > d) {
-       for ( ; n>d ; n--) {
-           r *= n;
-       }
-   } else {
-       for ( ; d>n ; d--) {
-           r *= d;
-       }
-       r = 1.0f / r;
-   }
-   return r;
-}
-//
-constexpr const double F_2_SQRTPI = 1.12837916709551257389615890312154517;
-constexpr const double F_SQRT2    = 1.41421356237309504880168872420969808;
-constexpr const double F_PI       = 3.14159265358979323846264338327950288;
-constexpr const double F_1_PI     = 0.318309886183790671537767526745028724;
-constexpr const double F_SQRT1_2  = 0.707106781186547524400844362104849039;
-constexpr const float  M_SQRT_3   = 1.7320508076f;
-//
-/*
- * SH scaling factors:
- *  returns sqrt((2*l + 1) / 4*pi) * sqrt( (l-|m|)! / (l+|m|)! )
- */
-static float Kml(int32 m, uint32 l) 
-{
-    m = m < 0 ? -m : m;  // abs() is not constexpr
-    const float K = (2 * l + 1) * factorial(uint32(l - m), uint32(l + m));
-    return float(std::sqrt(K) * (F_2_SQRTPI * 0.25));
-}
-//
-static std::vector<float> Ki(uint32 numBands) 
-{
-    const uint32 numCoefs = numBands * numBands;
-    std::vector<float> K(numCoefs);
-    for (uint32 l = 0; l < numBands; l++) {
-        K[SHindex(0, l)] = Kml(0, l);
-        for (uint32 m = 1; m <= l; m++) {
-            K[SHindex(m, l)] =
-            K[SHindex(-int32(m), l)] = float(F_SQRT2 * Kml(m, l));
-        }
-    }
-    return K;
-}
-//
-// < cos(theta) > SH coefficients pre-multiplied by 1 / K(0,l)
-constexpr float ComputeTruncatedCosSh( uint32 l ) 
-{
-    if( l == 0 ) {
-        return (float)F_PI;
-    }
-    else if( l == 1 ) {
-        return float(2 * F_PI / 3);
-    }
-    else if( l & 1u ) {
-        return 0.0f;
-    }
-    const uint32 l_2 = l / 2;
-    float A0 = ( ( l_2 & 1u ) ? 1.0f : -1.0f ) / ( ( l + 2 ) * ( l - 1 ) );
-    float A1 = factorial( l, l_2 ) / ( factorial( l_2, 1 ) * ( 1 << l ) );
-    return float(2 * F_PI * A0 * A1);
-}
-//
-/*
- * SH from environment with high dynamic range (or high frequencies -- high dynamic range creates
- * high frequencies) exhibit "ringing" and negative values when reconstructed.
- * To mitigate this, we need to low-pass the input image -- or equivalently window the SH by
- * coefficient that tapper towards zero with the band.
- *
- * We use ideas and techniques from
- *    Stupid Spherical Harmonics (SH)
- *    Deringing Spherical Harmonics
- * by Peter-Pike Sloan
- * https://www.ppsloan.org/publications/shdering.pdf
- *
- */
-static float SincWindow(uint32 l, float w)
-{
-    if (l == 0) {
-        return 1.0f;
-    } else if (l >= w) {
-        return 0.0f;
-    }
-
-    // we use a sinc window scaled to the desired window size in bands units
-    // a sinc window only has zonal harmonics
-    float x = (float(F_PI) * l) / w;
-    x = std::sin(x) / x;
-
-    // The convolution of a SH function f and a ZH function h is just the product of both
-    // scaled by 1 / K(0,l) -- the window coefficients include this scale factor.
-
-    // Taking the window to power N is equivalent to applying the filter N times
-    return std::pow(x, 4);
-}
-//
-void multiply3( float out[3], const float M[3][3], const float x[3] ) 
-{
-    out[0] = M[0][0] * x[0] + M[1][0] * x[1] + M[2][0] * x[2];
-    out[1] = M[0][1] * x[0] + M[1][1] * x[1] + M[2][1] * x[2];
-    out[2] = M[0][2] * x[0] + M[1][2] * x[1] + M[2][2] * x[2];
-};
-/*
- * utilities to rotate very low order spherical harmonics (up to 3rd band)
- */
-void RotateSphericalHarmonicBand1(float out[3], const float band1[3], const float M[3][3]) 
-{
-    // inverse() is not constexpr -- so we pre-calculate it in mathematica
-    //
-    //    constexpr float3 N0{ 1, 0, 0 };
-    //    constexpr float3 N1{ 0, 1, 0 };
-    //    constexpr float3 N2{ 0, 0, 1 };
-    //
-    //    constexpr mat3f A1 = { // this is the projection of N0, N1, N2 to SH space
-    //            float3{ -N0.y, N0.z, -N0.x },
-    //            float3{ -N1.y, N1.z, -N1.x },
-    //            float3{ -N2.y, N2.z, -N2.x }
-    //    };
-    //
-    //    const mat3f invA1 = inverse(A1);
-
-    const float invA1TimesK[3][3] = {
-            {  0, -1,  0 },
-            {  0,  0,  1 },
-            { -1,  0,  0 }
-    };
-    
-    // below can't be constexpr
-    const float * MN0 = M[0];  // M * N0;
-    const float * MN1 = M[1];  // M * N1;
-    const float * MN2 = M[2];  // M * N2;
-    const float R1OverK[3][3] = {
-            { -MN0[1], MN0[2], -MN0[0] },
-            { -MN1[1], MN1[2], -MN1[0] },
-            { -MN2[1], MN2[2], -MN2[0] }
-    };
-
-    float temp0[3];
-    multiply3( temp0, invA1TimesK, band1 );
-    multiply3( out, R1OverK, temp0 );
-    //return R1OverK * (invA1TimesK * band1);
-}
-//
-static void multiply5( float out[5], const float M[5][5], const float x[5] )
-{
-    out[0] = M[0][0] * x[0] + M[1][0] * x[1] + M[2][0] * x[2] + M[3][0] * x[3] + M[4][0] * x[4];
-    out[1] = M[0][1] * x[0] + M[1][1] * x[1] + M[2][1] * x[2] + M[3][1] * x[3] + M[4][1] * x[4];
-    out[2] = M[0][2] * x[0] + M[1][2] * x[1] + M[2][2] * x[2] + M[3][2] * x[3] + M[4][2] * x[4];
-    out[3] = M[0][3] * x[0] + M[1][3] * x[1] + M[2][3] * x[2] + M[3][3] * x[3] + M[4][3] * x[4];
-    out[4] = M[0][4] * x[0] + M[1][4] * x[1] + M[2][4] * x[2] + M[3][4] * x[3] + M[4][4] * x[4];
-};
-//
-// This projects a vec3 to SH2/k space (i.e. we premultiply by 1/k)
-// below can't be constexpr
-void project5( float out[5], const float s[3] )
-{
-    out[0] = ( s[1] * s[0] );
-    out[1] = -( s[1] * s[2] );
-    out[2] = 1 / ( 2 * M_SQRT_3 ) * ( ( 3 * s[2] * s[2] - 1 ) );
-    out[3] = -( s[2] * s[0] );
-    out[4] = 0.5f * ( ( s[0] * s[0] - s[1] * s[1] ) );
-}
-//
-void RotateSphericalHarmonicBand2( float result[5], const float band2[5], const float M[3][3]) 
-{
-    //constexpr float M_SQRT_3  = 1.7320508076f;
-    constexpr float n = (float)F_SQRT1_2;
-
-    //  Below we precompute (with help of Mathematica):
-    //    constexpr float3 N0{ 1, 0, 0 };
-    //    constexpr float3 N1{ 0, 0, 1 };
-    //    constexpr float3 N2{ n, n, 0 };
-    //    constexpr float3 N3{ n, 0, n };
-    //    constexpr float3 N4{ 0, n, n };
-    //    constexpr float M_SQRT_PI = 1.7724538509f;
-    //    constexpr float M_SQRT_15 = 3.8729833462f;
-    //    constexpr float k = M_SQRT_15 / (2.0f * M_SQRT_PI);
-    //    --> k * inverse(mat5{project(N0), project(N1), project(N2), project(N3), project(N4)})
-    float invATimesK[5][5] = {
-            {    0,        1,   2,   0,  0 },
-            {   -1,        0,   0,   0, -2 },
-            {    0, M_SQRT_3,   0,   0,  0 },
-            {    1,        1,   0,  -2,  0 },
-            {    2,        1,   0,   0,  0 }
-    };
-
-    // this is: invA * k * band2
-    // 5x5 matrix by vec5 (this a lot of zeroes and constants, which the compiler should eliminate)
-    float invATimesKTimesBand2[5];
-    multiply5(invATimesKTimesBand2, invATimesK, band2);
-
-    // this is: mat5{project(N0), project(N1), project(N2), project(N3), project(N4)} / k
-    // (the 1/k comes from project(), see above)
-    float ROverK[5][5]; 
-    project5(ROverK[0], M[0]);                  // M * N0
-    project5(ROverK[1], M[2]);                  // M * N1
-    vaVector3 k0 = n * ( vaVector3( M[0] ) + vaVector3( M[1] ) );
-    vaVector3 k1 = n * ( vaVector3( M[0] ) + vaVector3( M[2] ) );
-    vaVector3 k2 = n * ( vaVector3( M[1] ) + vaVector3( M[2] ) );
-    project5( ROverK[2], &k0.x );     // M * N2
-    project5( ROverK[3], &k1.x );     // M * N3
-    project5( ROverK[4], &k2.x );     // M * N4
-
-    // notice how "k" disappears
-    // this is: (R / k) * (invA * k) * band2 == R * invA * band2
-    multiply5( result, ROverK, invATimesKTimesBand2 );
-}
-//
-void WindowSH_RotateSh3Bands( float sh[9], vaMatrix3x3 M ) 
-{
-    const float b0 = sh[0];
-    const vaVector3 band1{ sh[1], sh[2], sh[3] };
-    vaVector3 b1; 
-    RotateSphericalHarmonicBand1( &b1.x, &band1.x, M.m );
-    const float band2[5] = { sh[4], sh[5], sh[6], sh[7], sh[8] };
-    float b2[5];
-    RotateSphericalHarmonicBand2( b2, band2, M.m );
-    sh[0] = b0;
-    sh[1] = b1[0];
-    sh[2] = b1[1];
-    sh[3] = b1[2];
-    sh[4] = b2[0];
-    sh[5] = b2[1];
-    sh[6] = b2[2];
-    sh[7] = b2[3];
-    sh[8] = b2[4];
-};
-//
-// this is the function we're trying to minimize
-float WindowSH_func( float a, float b, float c, float d, float x ) 
-{
-    // first term accounts for ZH + |m| = 2, second terms for |m| = 1
-    return ( a * x * x + b * x + c ) + ( d * x * std::sqrt( 1 - x * x ) );
-};
-
-// This is func' / func'' -- this was computed with Mathematica
-float WindowSH_increment( float a, float b, float c, float d, float x ) 
-{   c;
-    return ( x * x - 1 ) * ( d - 2 * d * x * x + ( b + 2 * a * x ) * std::sqrt( 1 - x * x ) )
-        / ( 3 * d * x - 2 * d * x * x * x - 2 * a * std::pow( 1 - x * x, 1.5f ) );
-
-};
-//
-float WindowSH_SHMin( float f[9] ) 
-{
-    // See "Deringing Spherical Harmonics" by Peter-Pike Sloan
-    // https://www.ppsloan.org/publications/shdering.pdf
-
-    constexpr float M_SQRT_PI = 1.7724538509f;
-    constexpr float M_SQRT_5 = 2.2360679775f;
-    constexpr float M_SQRT_15 = 3.8729833462f;
-    constexpr float A[9] = {
-                  1.0f / ( 2.0f * M_SQRT_PI ),    // 0: 0  0
-            -M_SQRT_3 / ( 2.0f * M_SQRT_PI ),    // 1: 1 -1
-             M_SQRT_3 / ( 2.0f * M_SQRT_PI ),    // 2: 1  0
-            -M_SQRT_3 / ( 2.0f * M_SQRT_PI ),    // 3: 1  1
-             M_SQRT_15 / ( 2.0f * M_SQRT_PI ),    // 4: 2 -2
-            -M_SQRT_15 / ( 2.0f * M_SQRT_PI ),    // 5: 2 -1
-             M_SQRT_5 / ( 4.0f * M_SQRT_PI ),    // 6: 2  0
-            -M_SQRT_15 / ( 2.0f * M_SQRT_PI ),    // 7: 2  1
-             M_SQRT_15 / ( 4.0f * M_SQRT_PI )     // 8: 2  2
-    };
-
-    // first this to do is to rotate the SH to align Z with the optimal linear direction
-    const vaVector3 dir = vaVector3::Normalize( vaVector3{ -f[3], -f[1], f[2] } );
-    const vaVector3 z_axis = -dir;
-    const vaVector3 x_axis = vaVector3::Normalize( vaVector3::Cross( z_axis, vaVector3{ 0, 1, 0 } ) );
-    const vaVector3 y_axis = vaVector3::Cross( x_axis, z_axis );
-    const vaMatrix3x3 M = vaMatrix3x3{ x_axis, y_axis, -z_axis }.Transposed();
-
-    WindowSH_RotateSh3Bands( f, M );
-    // here we're guaranteed to have normalize(float3{ -f[3], -f[1], f[2] }) == { 0, 0, 1 }
-
-
-    // Find the min for |m| = 2
-    // ------------------------
-    //
-    // Peter-Pike Sloan shows that the minimum can be expressed as a function
-    // of z such as:  m2min = -m2max * (1 - z^2) =  m2max * z^2 - m2max
-    //      with m2max = A[8] * std::sqrt(f[8] * f[8] + f[4] * f[4]);
-    // We can therefore include this in the ZH min computation (which is function of z^2 as well)
-    float m2max = A[8] * std::sqrt( f[8] * f[8] + f[4] * f[4] );
-
-    // Find the min of the zonal harmonics
-    // -----------------------------------
-    //
-    // This comes from minimizing the function:
-    //      ZH(z) = (A[0] * f[0])
-    //            + (A[2] * f[2]) * z
-    //            + (A[6] * f[6]) * (3 * s.z * s.z - 1)
-    //
-    // We do that by finding where it's derivative d/dz is zero:
-    //      dZH(z)/dz = a * z^2 + b * z + c
-    //      which is zero for z = -b / 2 * a
-    //
-    // We also needs to check that -1 < z < 1, otherwise the min is either in z = -1 or 1
-    //
-    const float a = 3 * A[6] * f[6] + m2max;
-    const float b = A[2] * f[2];
-    const float c = A[0] * f[0] - A[6] * f[6] - m2max;
-
-    const float zmin = -b / ( 2.0f * a );
-    const float m0min_z = a * zmin * zmin + b * zmin + c;
-    const float m0min_b = std::min( a + b + c, a - b + c );
-
-    const float m0min = ( a > 0 && zmin >= -1 && zmin <= 1 ) ? m0min_z : m0min_b;
-
-    // Find the min for l = 2, |m| = 1
-    // -------------------------------
-    //
-    // Note l = 1, |m| = 1 is guaranteed to be 0 because of the rotation step
-    //
-    // The function considered is:
-    //        Y(x, y, z) = A[5] * f[5] * s.y * s.z
-    //                   + A[7] * f[7] * s.z * s.x
-    float d = A[4] * std::sqrt( f[5] * f[5] + f[7] * f[7] );
-
-    // the |m|=1 function is minimal in -0.5 -- use that to skip the Newton's loop when possible
-    float minimum = m0min - 0.5f * d;
-    if( minimum < 0 ) 
-    {
-        // We could be negative, to find the minimum we will use Newton's method
-        // See https://en.wikipedia.org/wiki/Newton%27s_method_in_optimization
-
-        float dz;
-        float z = float(-F_SQRT1_2);   // we start guessing at the min of |m|=1 function
-        int loopCount = 0;
-        do {
-            minimum = WindowSH_func( a, b, c, d, z ); // evaluate our function
-            dz = WindowSH_increment( a, b, c, d, z ); // refine our guess by this amount
-            z = z - dz;
-            // exit if z goes out of range, or if we have reached enough precision
-            loopCount++;
-        } while( (std::abs( z ) <= 1) && (std::abs( dz ) > 1e-5f) && (loopCount<16) );
-
-        if( std::abs( z ) > 1 ) {
-            // z was out of range
-            minimum = std::min( WindowSH_func( a, b, c, d, 1 ), WindowSH_func( a, b, c, d, -1 ) );
-        }
-    }
-    return minimum;
-};
-//
-static void WindowSH_Windowing( float out[9], float f[9], float cutoff, const uint32 numBands )
-{
-    for( int i = 0; i < 9; i++ )
-        out[i] = f[i];
-    for( int32 l = 0; l < (int32)numBands; l++ ) 
-    {
-        float w = SincWindow( l, cutoff );
-        out[SHindex( 0, l )] *= w;
-        for( uint32 m = 1; m <= (uint32)l; m++ ) 
-        {
-            out[SHindex( -int32(m), l )] *= w;
-            out[SHindex( int32(m), l )] *= w;
-        }
-    }
-}
-//
-static void WindowSH( std::unique_ptr<vaVector3[]>& sh, uint32 numBands, float cutoff ) 
-{
-    if( cutoff == 0 ) 
-    { 
-        // auto windowing (default)
-        if( numBands > 3 ) 
-        {
-            // auto-windowing works only for 1, 2 or 3 bands
-            assert( false );
-            //slog.e << "--sh-window=auto can't work with more than 3 bands. Disabling." << io::endl;
-            return;
-        }
-
-        cutoff = (float)numBands * 4 + 1; // start at a large band
-        // We need to process each channel separately
-        float SH[9];
-        for( uint32 channel = 0; channel < 3; channel++ ) 
-        {
-            for( uint32 i = 0; i < numBands * numBands; i++ ) 
-                SH[i] = sh[i][channel];
-
-            // find a cut-off band that works
-            float l = (float)numBands;
-            float r = cutoff;
-            for( uint32 i = 0; i < 16 && l + 0.1f < r; i++ ) 
-            {
-                float m = 0.5f * ( l + r );
-                float SHTemp[9];
-                WindowSH_Windowing( SHTemp, SH, m, numBands );
-                if( WindowSH_SHMin( SHTemp ) < 0 ) 
-                {
-                    r = m;
-                }
-                else 
-                {
-                    l = m;
-                }
-            }
-            cutoff = std::min( cutoff, l );
-        }
-    }
 
-    //slog.d << cutoff << io::endl;
-    for( int32 l = 0; l < (int32)numBands; l++ ) 
-    {
-        float w = SincWindow( l, cutoff );
-        sh[SHindex( 0, l )] *= w;
-        for( size_t m = 1; m <= l; m++ ) 
-        {
-            sh[SHindex( -int32(m), l )] *= w;
-            sh[SHindex( int32(m), l )] *= w;
-        }
-    }
-}
-//
-/*
- * This computes the 3-bands SH coefficients of the Cubemap convoluted by the
- * truncated cos(theta) (i.e.: saturate(s.z)), pre-scaled by the reconstruction
- * factors.
- */
-static void PreprocessSHForShader( std::unique_ptr<vaVector3[]>& SH, uint32 _numBands )
-{
-    constexpr size_t numBands = 3;
-    constexpr size_t numCoefs = numBands * numBands;
-    assert( _numBands == numBands ); _numBands;
-
-    // Coefficient for the polynomial form of the SH functions -- these were taken from
-    // "Stupid Spherical Harmonics (SH)" by Peter-Pike Sloan
-    // They simply come for expanding the computation of each SH function.
-    //
-    // To render spherical harmonics we can use the polynomial form, like this:
-    //          c += sh[0] * A[0];
-    //          c += sh[1] * A[1] * s.y;
-    //          c += sh[2] * A[2] * s.z;
-    //          c += sh[3] * A[3] * s.x;
-    //          c += sh[4] * A[4] * s.y * s.x;
-    //          c += sh[5] * A[5] * s.y * s.z;
-    //          c += sh[6] * A[6] * (3 * s.z * s.z - 1);
-    //          c += sh[7] * A[7] * s.z * s.x;
-    //          c += sh[8] * A[8] * (s.x * s.x - s.y * s.y);
-    //
-    // To save math in the shader, we pre-multiply our SH coefficient by the A[i] factors.
-    // Additionally, we include the lambertian diffuse BRDF 1/pi.
-
-    constexpr float M_SQRT_PI = 1.7724538509f;
-    constexpr float M_SQRT_5  = 2.2360679775f;
-    constexpr float M_SQRT_15 = 3.8729833462f;
-    constexpr float A[numCoefs] = {
-                  1.0f / (2.0f * M_SQRT_PI),    // 0  0
-            -M_SQRT_3  / (2.0f * M_SQRT_PI),    // 1 -1
-             M_SQRT_3  / (2.0f * M_SQRT_PI),    // 1  0
-            -M_SQRT_3  / (2.0f * M_SQRT_PI),    // 1  1
-             M_SQRT_15 / (2.0f * M_SQRT_PI),    // 2 -2
-            -M_SQRT_15 / (2.0f * M_SQRT_PI),    // 3 -1
-             M_SQRT_5  / (4.0f * M_SQRT_PI),    // 3  0
-            -M_SQRT_15 / (2.0f * M_SQRT_PI),    // 3  1
-             M_SQRT_15 / (4.0f * M_SQRT_PI)     // 3  2
-    };
-
-    for (size_t i = 0; i < numCoefs; i++)
-        SH[i] *= float(A[i] * F_1_PI);
-}
-#endif
 
 /*
 bool UIPanelTick( const string & uniqueID, vaIBLProbeData & probeData, vaIBLProbe::UIContext & probeUIContext, vaApplicationBase & application )
@@ -37,6 +37,8 @@
 
 #include "Core/vaXMLSerialization.h"
 
+#include "Core/Misc/vaSphericalHarmonics.h"
+
 #include "Rendering/Shaders/vaIBLShared.h"
 
 namespace Vanilla
@@ -70,7 +72,11 @@ namespace Vanilla
 
     public:
         void                                            ComputeSH( vaRenderDeviceContext & renderContext, shared_ptr<vaTexture> & sourceCube );
-        std::array<vaVector3, 9>                        GetSH( vaRenderDeviceContext& renderContext );   // will block
+        std::array<vaVector3, 9>                        GetSH( vaRenderDeviceContext& renderContext );   // will block (see vaSphericalHarmonics for a CPU path)
+
+        // non-blocking version of GetSH: issue the copy after ComputeSH, then poll until it returns true (frames later)
+        void                                            BeginReadback( vaRenderDeviceContext & renderContext );
+        bool                                            TryGetReadback( vaRenderDeviceContext & renderContext, std::array<vaVector3, 9> & outSH, bool doNotWait );
         //void                                            ConvertToIrradianceCube( vaRenderDeviceContext & renderContext, vector<shared_ptr<vaTexture>> destCubeMIPLevels );
 
     public:
@@ -144,6 +150,9 @@ namespace Vanilla
     public:
         void                                            Init( uint32 outputBaseSize, uint32 outputMinSize, uint32 samplesPerTexel, FilterType filterType );
         void                                            Process( vaRenderDeviceContext& renderContext, vector<shared_ptr<vaTexture>> destCubeMIPLevels, shared_ptr<vaTexture> & sourceCube );
+        // same as above but only filters [firstLevel, firstLevel+levelCount) - for spreading the work across frames
+        void                                            ProcessLevels( vaRenderDeviceContext& renderContext, const vector<shared_ptr<vaTexture>> & destCubeMIPLevels, shared_ptr<vaTexture> & sourceCube, uint32 firstLevel, uint32 levelCount );
+        uint32                                          GetMIPLevelCount( ) const                   { return m_numMIPLevels; }
         void                                            Reset( );
     };
 
@@ -210,6 +219,57 @@ namespace Vanilla
             UIContext( const weak_ptr<void>& aliveToken ) : AliveToken( aliveToken ) { }
         };
 
+        // Time-sliced capture: the work (one cube face render per step, skybox MIPs, irradiance, reflections pre-filter setup
+        // and then one pre-filter MIP level per step) is spread across frames. Each CaptureIncremental call runs up to
+        // MaxStepsPerFrame steps, stopping earlier once FrameBudgetMs is used up (always at least one step); current contents
+        // stay in use until the new capture completes and then get swapped in all at once.
+        // The budget only measures CPU recording time and most steps are far more expensive on the GPU, which is why the
+        // step limit defaults to 1. The SH readback is polled without blocking and finishes in a later call than its copy.
+        struct IncrementalCaptureSettings
+        {
+            float                       FrameBudgetMs           = 2.0f;     // CPU time only
+            int                         MaxStepsPerFrame        = 1;        // 0 - no limit
+            int                         CubeFaceResolution      = vaIBLCubemapPreFilter::c_defaultReflRoughCubeFirstMIPSize;
+        };
+
+    protected:
+        // output of the processing steps; built up separately so that the time-sliced capture can swap it in all at once
+        struct ProcessedContents
+        {
+            shared_ptr<vaTexture>                       SkyboxTexture;
+            shared_ptr<vaTexture>                       ReflectionsMap;
+            int                                         MaxReflMIPLevel         = 0;
+            shared_ptr<vaTexture>                       IrradianceMap;
+            std::array<vaVector3, 9>                    IrradianceCoefs         = { };
+            bool                                        SHReadbackPending       = false;
+        };
+
+        struct IncrementalCapture
+        {
+            enum class Stage
+            {
+                Faces,
+                Skybox,
+                IrradianceBegin,
+                ReflectionsBegin,
+                ReflectionsLevels,
+                IrradianceEnd,
+                Done
+            };
+
+            vaIBLProbeData                              Data;
+            int                                         CubeFaceResolution      = 0;
+            Stage                                       CurrentStage            = Stage::Faces;
+            int                                         NextFace                = 0;
+            int                                         NextReflLevel           = 0;
+            int                                         ReflLevelCount          = 0;
+            int                                         Calls                   = 0;        // CaptureIncremental calls so far
+            int                                         ReadbackIssueCall       = 0;        // call in which the SH readback copy was issued
+            vaCameraBase                                FaceCamera;
+            shared_ptr<vaTexture>                       CaptureCube;
+            ProcessedContents                           Contents;
+        };
+
     protected:
         vaIBLProbeData                                  m_capturedData;
         string                                          m_fullImportedPath;
@@ -246,6 +306,10 @@ namespace Vanilla
 
         shared_ptr<vaTexture>                           m_cubeCaptureScratchDepth;
 
+        unique_ptr<IncrementalCapture>                  m_incrementalCapture;
+
+        float                                           m_lastGPUSHDifference       = -1.0f;    // last CompareIrradianceSHWithGPU result, for the UI
+
     public:
         vaIBLProbe( vaRenderDevice & renderDevice );
         virtual ~vaIBLProbe( );
@@ -260,18 +324,41 @@ namespace Vanilla
         bool                                            Import( vaRenderDeviceContext & renderContext, const vaIBLProbeData & captureData );
         vaDrawResultFlags                               Capture( vaRenderDeviceContext & renderContext, const vaIBLProbeData & captureData, const CubeFaceCaptureCallback & faceCaptureCallback, int cubeFaceResolution = vaIBLCubemapPreFilter::c_defaultReflRoughCubeFirstMIPSize );
 
+        // see IncrementalCaptureSettings; call every frame until outCompleted - different captureData restarts the capture; Import,
+        // Capture and Reset cancel it
+        vaDrawResultFlags                               CaptureIncremental( vaRenderDeviceContext & renderContext, const vaIBLProbeData & captureData, const CubeFaceCaptureCallback & faceCaptureCallback, const IncrementalCaptureSettings & settings, bool & outCompleted );
+        bool                                            IsIncrementalCaptureInProgress( const vaIBLProbeData & captureData ) const;
+        void                                            CancelIncrementalCapture( );
+
         bool                                            HasContents( ) const                            { return m_hasContents; }
         const vaIBLProbeData &                          GetContentsData( ) const                        { return m_capturedData; }
 
         bool                                            HasSkybox( ) const                              { return m_hasContents && m_skyboxTexture != nullptr; }
         void                                            SetToSkybox( class vaSkybox & skybox );
 
+        // debugging aid: runs vaIrradianceSHCalculator on the current skybox and returns the largest difference to the irradiance
+        // SH in use (from vaSphericalHarmonics::Project for imported .hdr files), relative to the constant term; blocks on the readback,
+        // returns -1 if there's nothing to compare
+        float                                           CompareIrradianceSHWithGPU( vaRenderDeviceContext & renderContext );
+
     private:
         virtual void                                    UIPanelTick( vaApplicationBase & application ) override;
 
         shared_ptr<vaTexture>                           ImportCubemap( vaRenderDeviceContext & renderContext, const string & path, uint32 outputBaseSize );
 
-        bool                                            Process( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & srcCube );
+        // precomputedRawSH (vaSphericalHarmonics::Project output for the same source) skips the GPU SH computation and readback
+        bool                                            Process( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & srcCube, const vaSphericalHarmonics::SH3 * precomputedRawSH = nullptr );
+
+        // processing steps (Process just runs them all back to back)
+        bool                                            ProcessSkybox( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & srcCube, const vaIBLProbeData & probeData, ProcessedContents & outContents );
+        void                                            ProcessIrradianceBegin( vaRenderDeviceContext & renderContext, const vaIBLProbeData & probeData, const vaSphericalHarmonics::SH3 * precomputedRawSH, ProcessedContents & inOutContents );
+        bool                                            ProcessIrradianceEnd( vaRenderDeviceContext & renderContext, ProcessedContents & inOutContents, bool doNotWait );  // SH readback, if any; false if not ready yet (only with doNotWait)
+        int                                             ProcessReflectionsBegin( vaRenderDeviceContext & renderContext, ProcessedContents & inOutContents );    // returns the number of levels for ProcessReflectionsLevels
+        void                                            ProcessReflectionsLevels( vaRenderDeviceContext & renderContext, ProcessedContents & inOutContents, int firstLevel, int levelCount );
+        void                                            ApplyContents( ProcessedContents & contents );
+
+        shared_ptr<vaTexture>                           CreateCaptureCube( const vaIBLProbeData & captureData, int cubeFaceResolution, vaCameraBase & outFaceCamera );
+        static void                                     SetCubeFaceCameraOrientation( vaCameraBase & camera, const vaVector3 & position, int face );
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,349 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "vaLightClusters.h"
+
+#include "Scene/vaCameraBase.h"
+
+#include <algorithm>
+
+#include <emmintrin.h>
+
+using namespace Vanilla;
+
+// light prepared for culling, in camera view space
+struct vaLightClusters::CullLight
+{
+    vaVector3                       Center;
+    float                           Radius;         // max( Range, Size )
+    float                           Size;           // spot only: the special emissive part of the light is not limited by the cone
+    vaVector3                       Direction;      // spot only
+    float                           CosAngle;       // spot only, of the outer angle
+    float                           SinAngle;       // spot only, of the outer angle
+    bool                            IsSpot;
+    int                             Index;          // into the light array passed to Build
+};
+
+namespace
+{
+    inline int CountBits( uint32 v )
+    {
+        v = v - ( ( v >> 1 ) & 0x55555555 );
+        v = ( v & 0x33333333 ) + ( ( v >> 2 ) & 0x33333333 );
+        return (int)( ( ( ( v + ( v >> 4 ) ) & 0x0F0F0F0F ) * 0x01010101 ) >> 24 );
+    }
+
+    inline uint32 MakeClusterHeader( int offset, int count )
+    {
+        return (uint32)offset | ( (uint32)count << 16 );
+    }
+}
+
+vaLightClusters::vaLightClusters( )
+{
+    m_constants = new LightClustersShaderConstants;
+    memset( m_constants, 0, sizeof( *m_constants ) );
+
+    m_boundsMinX.resize( LIGHTCLUSTERS_COUNT );
+    m_boundsMinY.resize( LIGHTCLUSTERS_COUNT );
+    m_boundsMaxX.resize( LIGHTCLUSTERS_COUNT );
+    m_boundsMaxY.resize( LIGHTCLUSTERS_COUNT );
+    m_sphereCenterX.resize( LIGHTCLUSTERS_COUNT );
+    m_sphereCenterY.resize( LIGHTCLUSTERS_COUNT );
+    m_sphereCenterZ.resize( LIGHTCLUSTERS_COUNT );
+    m_sphereRadius.resize( LIGHTCLUSTERS_COUNT );
+    m_lightMasks.resize( LIGHTCLUSTERS_COUNT * c_maskWords );
+    for( int i = 0; i <= LIGHTCLUSTERS_COUNT_Z; i++ )
+        m_sliceDepths[i] = 0.0f;
+
+    BuildUnculled( );
+}
+
+vaLightClusters::~vaLightClusters( )
+{
+    delete m_constants;
+}
+
+bool vaLightClusters::BuildUnculled( )
+{
+    if( m_unculled )
+        return false;
+
+    m_constants->DepthSliceScale    = 0.0f;
+    m_constants->DepthSliceBias     = 0.0f;
+    m_constants->Dummy0             = 0.0f;
+    m_constants->Dummy1             = 0.0f;
+
+    uint32 * headers = (uint32 *)m_constants->Headers;
+    for( int i = 0; i < LIGHTCLUSTERS_COUNT; i++ )
+        headers[i] = MakeClusterHeader( 0, LIGHTCLUSTERS_ALL_LIGHTS );
+
+    m_stats = Stats( );
+    m_lastBuildValid = false;
+    m_unculled = true;
+    return true;
+}
+
+uint32 vaLightClusters::GetConstantsUsedSize( ) const
+{
+    const int indexVectors = ( m_stats.TotalIndices + 15 ) / 16;
+    return (uint32)( offsetof( LightClustersShaderConstants, LightIndices ) + sizeof( m_constants->LightIndices[0] ) * indexVectors );
+}
+
+void vaLightClusters::ComputeClusterBounds( float nearZ, float farZ )
+{
+    // exponential slices so that clusters stay roughly cube shaped with distance
+    for( int z = 0; z < LIGHTCLUSTERS_COUNT_Z; z++ )
+        m_sliceDepths[z] = nearZ * std::pow( farZ / nearZ, (float)z / (float)LIGHTCLUSTERS_COUNT_Z );
+    m_sliceDepths[LIGHTCLUSTERS_COUNT_Z] = farZ;
+
+    for( int z = 0; z < LIGHTCLUSTERS_COUNT_Z; z++ )
+    {
+        const float zn = m_sliceDepths[z];
+        const float zf = m_sliceDepths[z+1];
+        for( int y = 0; y < LIGHTCLUSTERS_COUNT_Y; y++ )
+        {
+            // view space x/z and y/z slopes of the tile edges; screen y goes down, view space y goes up
+            const float y0 = ( 1.0f - 2.0f * (float)( y + 1 ) / (float)LIGHTCLUSTERS_COUNT_Y ) * m_tanHalfFOV.y;
+            const float y1 = ( 1.0f - 2.0f * (float)( y     ) / (float)LIGHTCLUSTERS_COUNT_Y ) * m_tanHalfFOV.y;
+            for( int x = 0; x < LIGHTCLUSTERS_COUNT_X; x++ )
+            {
+                const float x0 = ( 2.0f * (float)( x     ) / (float)LIGHTCLUSTERS_COUNT_X - 1.0f ) * m_tanHalfFOV.x;
+                const float x1 = ( 2.0f * (float)( x + 1 ) / (float)LIGHTCLUSTERS_COUNT_X - 1.0f ) * m_tanHalfFOV.x;
+
+                const int index = ( z * LIGHTCLUSTERS_COUNT_Y + y ) * LIGHTCLUSTERS_COUNT_X + x;
+                m_boundsMinX[index] = x0 * ( ( x0 < 0 ) ? ( zf ) : ( zn ) );
+                m_boundsMaxX[index] = x1 * ( ( x1 > 0 ) ? ( zf ) : ( zn ) );
+                m_boundsMinY[index] = y0 * ( ( y0 < 0 ) ? ( zf ) : ( zn ) );
+                m_boundsMaxY[index] = y1 * ( ( y1 > 0 ) ? ( zf ) : ( zn ) );
+
+                vaVector3 halfSize( m_boundsMaxX[index] - m_boundsMinX[index], m_boundsMaxY[index] - m_boundsMinY[index], zf - zn );
+                halfSize *= 0.5f;
+                m_sphereCenterX[index]  = m_boundsMinX[index] + halfSize.x;
+                m_sphereCenterY[index]  = m_boundsMinY[index] + halfSize.y;
+                m_sphereCenterZ[index]  = zn + halfSize.z;
+                m_sphereRadius[index]   = halfSize.Length( );
+            }
+        }
+    }
+}
+
+void vaLightClusters::CullSlice( int slice, const vector<CullLight> & lights )
+{
+    const float sliceNear   = m_sliceDepths[slice];
+    const float sliceFar    = m_sliceDepths[slice+1];
+    const int   first       = slice * LIGHTCLUSTERS_COUNT_X * LIGHTCLUSTERS_COUNT_Y;
+    const int   last        = first + LIGHTCLUSTERS_COUNT_X * LIGHTCLUSTERS_COUNT_Y;
+    static_assert( ( LIGHTCLUSTERS_COUNT_X * LIGHTCLUSTERS_COUNT_Y ) % 4 == 0, "clusters are tested 4 at a time" );
+
+    const __m128 zero = _mm_setzero_ps( );
+    uint32 * masks = m_lightMasks.data( );
+
+    for( const CullLight & light : lights )
+    {
+        if( light.Center.z + light.Radius < sliceNear || light.Center.z - light.Radius > sliceFar )
+            continue;
+
+        // all clusters in a slice share the depth range so the z part of the sphere vs AABB distance is the same for all of them
+        const float dz          = std::max( 0.0f, std::max( sliceNear - light.Center.z, light.Center.z - sliceFar ) );
+        const __m128 cx         = _mm_set1_ps( light.Center.x );
+        const __m128 cy         = _mm_set1_ps( light.Center.y );
+        const __m128 cz         = _mm_set1_ps( light.Center.z );
+        const __m128 maxXYDistSq= _mm_set1_ps( light.Radius * light.Radius - dz * dz );
+        const __m128 sizeXYDistSq= _mm_set1_ps( light.Size * light.Size - dz * dz );
+        const __m128 dirX       = _mm_set1_ps( light.Direction.x );
+        const __m128 dirY       = _mm_set1_ps( light.Direction.y );
+        const __m128 dirZ       = _mm_set1_ps( light.Direction.z );
+        const __m128 cosAngle   = _mm_set1_ps( light.CosAngle );
+        const __m128 sinAngle   = _mm_set1_ps( light.SinAngle );
+        const __m128 range      = _mm_set1_ps( light.Radius );
+
+        const int       word    = light.Index >> 5;
+        const uint32    bit     = 1u << ( light.Index & 31 );
+
+        for( int c = first; c < last; c += 4 )
+        {
+            // sphere vs AABB
+            __m128 dx   = _mm_max_ps( _mm_max_ps( _mm_sub_ps( _mm_loadu_ps( &m_boundsMinX[c] ), cx ), _mm_sub_ps( cx, _mm_loadu_ps( &m_boundsMaxX[c] ) ) ), zero );
+            __m128 dy   = _mm_max_ps( _mm_max_ps( _mm_sub_ps( _mm_loadu_ps( &m_boundsMinY[c] ), cy ), _mm_sub_ps( cy, _mm_loadu_ps( &m_boundsMaxY[c] ) ) ), zero );
+            __m128 dxySq= _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) );
+            __m128 inside = _mm_cmple_ps( dxySq, maxXYDistSq );
+
+            if( light.IsSpot )
+            {
+                // cone vs cluster bounding sphere (see https://bartwronski.com/2017/04/13/cull-that-cone/)
+                __m128 radius   = _mm_loadu_ps( &m_sphereRadius[c] );
+                __m128 vx       = _mm_sub_ps( _mm_loadu_ps( &m_sphereCenterX[c] ), cx );
+                __m128 vy       = _mm_sub_ps( _mm_loadu_ps( &m_sphereCenterY[c] ), cy );
+                __m128 vz       = _mm_sub_ps( _mm_loadu_ps( &m_sphereCenterZ[c] ), cz );
+                __m128 vLenSq   = _mm_add_ps( _mm_add_ps( _mm_mul_ps( vx, vx ), _mm_mul_ps( vy, vy ) ), _mm_mul_ps( vz, vz ) );
+                __m128 v1Len    = _mm_add_ps( _mm_add_ps( _mm_mul_ps( vx, dirX ), _mm_mul_ps( vy, dirY ) ), _mm_mul_ps( vz, dirZ ) );
+                __m128 distanceClosestPoint = _mm_sub_ps( _mm_mul_ps( cosAngle, _mm_sqrt_ps( _mm_max_ps( _mm_sub_ps( vLenSq, _mm_mul_ps( v1Len, v1Len ) ), zero ) ) ), _mm_mul_ps( v1Len, sinAngle ) );
+                __m128 culled   = _mm_or_ps( _mm_cmpgt_ps( distanceClosestPoint, radius ), 
+                                  _mm_or_ps( _mm_cmpgt_ps( v1Len, _mm_add_ps( radius, range ) ), _mm_cmplt_ps( v1Len, _mm_sub_ps( zero, radius ) ) ) );
+                
+                // the special emissive part ignores the cone
+                __m128 insideSize = _mm_cmple_ps( dxySq, sizeXYDistSq );
+                inside = _mm_or_ps( _mm_andnot_ps( culled, inside ), insideSize );
+            }
+
+            int insideMask = _mm_movemask_ps( inside );
+            if( insideMask == 0 )
+                continue;
+            if( insideMask & 1 ) masks[ ( c + 0 ) * c_maskWords + word ] |= bit;
+            if( insideMask & 2 ) masks[ ( c + 1 ) * c_maskWords + word ] |= bit;
+            if( insideMask & 4 ) masks[ ( c + 2 ) * c_maskWords + word ] |= bit;
+            if( insideMask & 8 ) masks[ ( c + 3 ) * c_maskWords + word ] |= bit;
+        }
+    }
+}
+
+bool vaLightClusters::Build( const vaCameraBase & camera, const vaVector3 & worldBase, const ShaderLightSpot * lights, int lightCount )
+{
+    assert( lightCount <= ShaderLightSpot::MaxLights );
+    lightCount = std::min( lightCount, ShaderLightSpot::MaxLights );
+
+    const vaMatrix4x4 & proj = camera.GetProjMatrix( );
+    if( m_lastBuildValid && memcmp( &m_viewMatrix, &camera.GetViewMatrix( ), sizeof( m_viewMatrix ) ) == 0 && memcmp( &m_lastProjMatrix, &proj, sizeof( proj ) ) == 0
+        && m_lastWorldBase == worldBase && (int)m_lastLights.size( ) == lightCount && ( lightCount == 0 || memcmp( m_lastLights.data( ), lights, sizeof( ShaderLightSpot ) * lightCount ) == 0 ) )
+        return false;
+    m_lastBuildValid    = true;
+    m_unculled          = false;
+    m_lastProjMatrix    = proj;
+    m_lastWorldBase     = worldBase;
+    m_lastLights.assign( lights, lights + lightCount );
+
+    m_viewMatrix = camera.GetViewMatrix( );
+    m_tanHalfFOV = vaVector2( 1.0f / proj.m[0][0], 1.0f / proj.m[1][1] );
+
+    const float nearZ = camera.GetNearPlaneDistance( );
+
+    vector<CullLight> cullLights;
+    cullLights.reserve( lightCount );
+    float maxLightZ = 0.0f;
+    for( int i = 0; i < lightCount; i++ )
+    {
+        const ShaderLightSpot & light = lights[i];
+
+        CullLight cullLight;
+        cullLight.Center    = vaVector3::TransformCoord( light.Position + worldBase, m_viewMatrix );
+        cullLight.Radius    = std::max( light.Range, light.Size );
+        cullLight.Index     = i;
+        if( cullLight.Center.z + cullLight.Radius < nearZ )
+            continue;
+
+        // point lights come with outer angles above PI and the cone test isn't valid for wide spots anyway so test those as spheres
+        cullLight.IsSpot    = light.SpotOuterAngle < VA_PIf * 0.5f;
+        if( cullLight.IsSpot )
+        {
+            cullLight.Size      = light.Size;
+            cullLight.Direction = vaVector3::TransformNormal( light.Direction, m_viewMatrix ).Normalized( );
+            cullLight.CosAngle  = std::cos( light.SpotOuterAngle );
+            cullLight.SinAngle  = std::sin( light.SpotOuterAngle );
+        }
+        else
+        {
+            cullLight.Size      = cullLight.Radius;
+            cullLight.Direction = vaVector3( 0.0f, 0.0f, 0.0f );
+            cullLight.CosAngle  = 1.0f;
+            cullLight.SinAngle  = 0.0f;
+        }
+        maxLightZ = std::max( maxLightZ, cullLight.Center.z + cullLight.Radius );
+        cullLights.push_back( cullLight );
+    }
+
+    // slices only need to go as far as the lights do; anything behind the last slice is out of reach of all lights
+    const float farZ = std::max( std::min( maxLightZ, camera.GetFarPlaneDistance( ) ), nearZ * 2.0f );
+
+    ComputeClusterBounds( nearZ, farZ );
+    m_constants->DepthSliceScale    = (float)LIGHTCLUSTERS_COUNT_Z / std::log2( farZ / nearZ );
+    m_constants->DepthSliceBias     = -std::log2( nearZ ) * m_constants->DepthSliceScale;
+    m_constants->Dummy0             = 0.0f;
+    m_constants->Dummy1             = 0.0f;
+
+    std::fill( m_lightMasks.begin( ), m_lightMasks.end( ), 0u );
+    if( cullLights.size( ) > 0 )
+    {
+        vaParallel::For( 0, LIGHTCLUSTERS_COUNT_Z, 1, [this, &cullLights]( int64 begin, int64 end )
+        {
+            for( int64 slice = begin; slice < end; slice++ )
+                CullSlice( (int)slice, cullLights );
+        } );
+    }
+
+    // compact the masks into per-cluster index lists; clusters that don't fit anymore fall back to all lights
+    m_stats                     = Stats( );
+    m_stats.LightCount          = lightCount;
+    m_stats.ClusteredDepthRange = farZ;
+
+    uint32 * headers    = (uint32 *)m_constants->Headers;
+    uint8 * indices     = (uint8 *)m_constants->LightIndices;
+    int offset          = 0;
+    for( int c = 0; c < LIGHTCLUSTERS_COUNT; c++ )
+    {
+        const uint32 * mask = &m_lightMasks[ c * c_maskWords ];
+        int count = 0;
+        for( int w = 0; w < c_maskWords; w++ )
+            count += CountBits( mask[w] );
+
+        m_stats.MaxLightsPerCluster = std::max( m_stats.MaxLightsPerCluster, count );
+        if( offset + count > LIGHTCLUSTERS_MAX_INDICES )
+        {
+            headers[c] = MakeClusterHeader( 0, LIGHTCLUSTERS_ALL_LIGHTS );
+            m_stats.OverflowedClusters++;
+            continue;
+        }
+
+        headers[c] = MakeClusterHeader( offset, count );
+        for( int w = 0; w < c_maskWords; w++ )
+        {
+            for( uint32 bits = mask[w]; bits != 0; bits &= bits - 1 )
+                indices[offset++] = (uint8)( w * 32 + CountBits( ( bits & ( 0u - bits ) ) - 1 ) );
+        }
+        m_stats.TotalIndices += count;
+    }
+    return true;
+}
+
+bool vaLightClusters::FindClusterLights( const vaVector3 & worldPos, vector<int> & outLightIndices ) const
+{
+    outLightIndices.clear( );
+
+    vaVector3 viewPos = vaVector3::TransformCoord( worldPos, m_viewMatrix );
+    if( viewPos.z <= 0.0f )
+        return false;
+
+    // same as GetLightClusterHeader in vaLighting.hlsl
+    float u = ( viewPos.x / ( viewPos.z * m_tanHalfFOV.x ) ) * 0.5f + 0.5f;
+    float v = 0.5f - ( viewPos.y / ( viewPos.z * m_tanHalfFOV.y ) ) * 0.5f;
+    int x = vaMath::Clamp( (int)std::floor( u * LIGHTCLUSTERS_COUNT_X ), 0, LIGHTCLUSTERS_COUNT_X - 1 );
+    int y = vaMath::Clamp( (int)std::floor( v * LIGHTCLUSTERS_COUNT_Y ), 0, LIGHTCLUSTERS_COUNT_Y - 1 );
+    int z = vaMath::Clamp( (int)std::floor( std::log2( viewPos.z ) * m_constants->DepthSliceScale + m_constants->DepthSliceBias ), 0, LIGHTCLUSTERS_COUNT_Z - 1 );
+
+    const uint32 header = ( (const uint32 *)m_constants->Headers )[ ( z * LIGHTCLUSTERS_COUNT_Y + y ) * LIGHTCLUSTERS_COUNT_X + x ];
+    const int offset    = (int)( header & 0xFFFF );
+    const int count     = (int)( header >> 16 );
+    if( count == LIGHTCLUSTERS_ALL_LIGHTS )
+        return false;
+
+    const uint8 * indices = (const uint8 *)m_constants->LightIndices;
+    for( int i = 0; i < count; i++ )
+        outLightIndices.push_back( (int)indices[offset + i] );
+    return true;
+}
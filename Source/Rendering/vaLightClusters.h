@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Core/vaCoreIncludes.h"
+
+#include "Rendering/Shaders/vaLightingShared.h"
+
+namespace Vanilla
+{
+    class vaCameraBase;
+
+    // CPU clustered light culling: splits the camera frustum into LIGHTCLUSTERS_COUNT_X x _Y screen tiles and _Z exponential
+    // depth slices (from the near plane to the furthest light extent) and builds, for each cluster, a compact list of the
+    // spot/point lights that can reach it. Sphere (point) and cone (spot) vs cluster tests run with SSE, 4 clusters at a
+    // time, with depth slices spread across vaParallel workers. The result is laid out as LightClustersShaderConstants so
+    // it can be uploaded as-is; see GetLightClusterHeader in vaLighting.hlsl for the shader side lookup.
+    class vaLightClusters
+    {
+    public:
+        struct Stats
+        {
+            int                             LightCount              = 0;
+            int                             TotalIndices            = 0;        // sum of all per-cluster list lengths
+            int                             MaxLightsPerCluster     = 0;
+            int                             OverflowedClusters      = 0;        // clusters that didn't fit into the index list and use all lights
+            float                           ClusteredDepthRange     = 0.0f;     // far end of the last depth slice
+        };
+
+    private:
+        static const int                    c_maskWords             = ShaderLightSpot::MaxLights / 32;
+
+        LightClustersShaderConstants *      m_constants             = nullptr;      // ~64kb so it lives on the heap
+
+        // view space cluster bounds, structure of arrays so that they can be tested 4 at a time: AABBs for sphere tests and
+        // bounding spheres for spot cone tests
+        vector<float>                       m_boundsMinX;
+        vector<float>                       m_boundsMinY;
+        vector<float>                       m_boundsMaxX;
+        vector<float>                       m_boundsMaxY;
+        vector<float>                       m_sphereCenterX;
+        vector<float>                       m_sphereCenterY;
+        vector<float>                       m_sphereCenterZ;
+        vector<float>                       m_sphereRadius;
+        float                               m_sliceDepths[LIGHTCLUSTERS_COUNT_Z+1];
+
+        // LIGHTCLUSTERS_COUNT * c_maskWords bits, one per light per cluster
+        vector<uint32>                      m_lightMasks;
+
+        // camera state at the last Build, used by FindClusterLights
+        vaMatrix4x4                         m_viewMatrix            = vaMatrix4x4::Identity;
+        vaVector2                           m_tanHalfFOV            = { 1.0f, 1.0f };
+
+        // inputs of the last Build; the lighting constants get updated for every lit pass but the clusters only need
+        // rebuilding if something changed
+        bool                                m_lastBuildValid        = false;
+        bool                                m_unculled              = false;        // contents are the BuildUnculled ones
+        vaMatrix4x4                         m_lastProjMatrix        = vaMatrix4x4::Identity;
+        vaVector3                           m_lastWorldBase         = { 0.0f, 0.0f, 0.0f };
+        vector<ShaderLightSpot>             m_lastLights;
+
+        Stats                               m_stats;
+
+    public:
+        vaLightClusters( );
+        vaLightClusters( const vaLightClusters & ) = delete;
+        vaLightClusters & operator = ( const vaLightClusters & ) = delete;
+        ~vaLightClusters( );
+
+    public:
+        // lights are in the same space as the LightingShaderConstants ones (world space offset by -worldBase); spot lights
+        // are recognized by SpotOuterAngle < PI/2, everything else is culled as a sphere of max( Range, Size ); returns false
+        // if the inputs are the same as last time and the constants didn't change
+        bool                                Build( const vaCameraBase & camera, const vaVector3 & worldBase, const ShaderLightSpot * lights, int lightCount );
+
+        // sets all clusters to LIGHTCLUSTERS_ALL_LIGHTS so that shaders go through the whole light list; returns false if
+        // that was already the case
+        bool                                BuildUnculled( );
+
+        const LightClustersShaderConstants & GetConstants( ) const                  { return *m_constants; }
+
+        // used part of GetConstants( ): everything up to the last index vector in use (for partial constant buffer updates)
+        uint32                              GetConstantsUsedSize( ) const;
+        const Stats &                       GetStats( ) const                       { return m_stats; }
+
+        // CPU version of the shader lookup (using the camera from the last Build): fills the indices of lights assigned to
+        // the cluster containing the world space position; returns false if the cluster uses all lights or the position is
+        // behind the camera
+        bool                                FindClusterLights( const vaVector3 & worldPos, vector<int> & outLightIndices ) const;
+
+    private:
+        struct CullLight;
+        void                                ComputeClusterBounds( float nearZ, float farZ );
+        void                                CullSlice( int slice, const vector<CullLight> & lights );
+    };
+}
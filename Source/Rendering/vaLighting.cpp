@@ -260,6 +260,7 @@ void vaFogSphere::UIPropertiesItemTick( vaApplicationBase & )
 
 vaLighting::vaLighting( const vaRenderingModuleParams & params ) : vaRenderingModule( vaRenderingModuleParams(params) ), 
     m_constantsBuffer( params ),
+    m_clustersConstantsBuffer( params ),
     // m_applyDirectionalAmbientPS( params ),
     // m_applyDirectionalAmbientShadowedPS( params ),
     vaUIPanel( "Lighting", 0, false, vaUIPanel::DockLocation::DockedLeftBottom )
@@ -489,6 +490,19 @@ void vaLighting::UpdateShaderConstants( vaSceneDrawContext & drawContext )
         else { VA_WARN( "vaLighting - requested more than the max number of spot/point lights (%d)", ShaderLightSpot::MaxLights ); }
     }
 
+    // per-cluster lists of the spot/point lights above for forward shading; this runs for every lit pass so only upload
+    // when the clusters changed, and only the used part of the ~64kb index list
+    bool clustersChanged;
+    if( m_lightClusteringEnabled )
+        clustersChanged = m_lightClusters.Build( drawContext.Camera, drawContext.Settings.WorldBase, consts.LightsSpotAndPoint, (int)consts.LightCountSpotAndPoint );
+    else
+        clustersChanged = m_lightClusters.BuildUnculled( );
+    if( clustersChanged || !m_clustersConstantsUploaded )
+    {
+        m_clustersConstantsBuffer.Update( drawContext.RenderDeviceContext, m_lightClusters.GetConstants( ), m_lightClusters.GetConstantsUsedSize( ) );
+        m_clustersConstantsUploaded = true;
+    }
+
     memset( &consts.LocalIBL, 0, sizeof( consts.LocalIBL ) );
     memset( &consts.DistantIBL, 0, sizeof( consts.DistantIBL ) );
     if( !drawContext.Settings.DisableGI )
@@ -511,6 +525,9 @@ void vaLighting::UpdateAndSetToGlobals( vaSceneDrawContext & drawContext, vaShad
     assert( shaderItemGlobals.ConstantBuffers[ LIGHTINGGLOBAL_CONSTANTSBUFFERSLOT - vaShaderItemGlobals::ConstantBuffersShaderSlotBase ] == nullptr );
     shaderItemGlobals.ConstantBuffers[ LIGHTINGGLOBAL_CONSTANTSBUFFERSLOT - vaShaderItemGlobals::ConstantBuffersShaderSlotBase ] = m_constantsBuffer;
 
+    assert( shaderItemGlobals.ConstantBuffers[ LIGHTINGGLOBAL_CLUSTERS_CONSTANTSBUFFERSLOT - vaShaderItemGlobals::ConstantBuffersShaderSlotBase ] == nullptr );
+    shaderItemGlobals.ConstantBuffers[ LIGHTINGGLOBAL_CLUSTERS_CONSTANTSBUFFERSLOT - vaShaderItemGlobals::ConstantBuffersShaderSlotBase ] = m_clustersConstantsBuffer;
+
     // assert( shaderItemGlobals.ShaderResourceViews[ SHADERGLOBAL_LIGHTING_ENVMAP_TEXTURESLOT - vaShaderItemGlobals::ShaderResourceViewsShaderSlotBase ] == nullptr );
     // shaderItemGlobals.ShaderResourceViews[ SHADERGLOBAL_LIGHTING_ENVMAP_TEXTURESLOT - vaShaderItemGlobals::ShaderResourceViewsShaderSlotBase ] = m_envmapTexture;
 
@@ -714,6 +731,16 @@ void vaLighting::UIPanelTick( vaApplicationBase & application )
 #ifdef VA_IMGUI_INTEGRATION_ENABLED
     ImGui::Text( "Lights: %d", (int)m_lights.size() );
 
+    ImGui::Checkbox( "Clustered light culling", &m_lightClusteringEnabled );
+    if( m_lightClusteringEnabled )
+    {
+        const vaLightClusters::Stats & clusterStats = m_lightClusters.GetStats( );
+        ImGui::Text( "Clustered spot/point lights: %d, up to %.1f away", clusterStats.LightCount, clusterStats.ClusteredDepthRange );
+        ImGui::Text( "Average per cluster: %.2f, max: %d", clusterStats.TotalIndices / (float)LIGHTCLUSTERS_COUNT, clusterStats.MaxLightsPerCluster );
+        if( clusterStats.OverflowedClusters > 0 )
+            ImGui::Text( "Clusters over the index budget (using all lights): %d", clusterStats.OverflowedClusters );
+    }
+
     ImGui::Text( "Shadowmaps: %d", (int)m_shadowmaps.size() );
     vaUIPropertiesItem * ptrsToDisplay[4096];
     int countToShow = std::min( (int)m_shadowmaps.size( ), (int)_countof( ptrsToDisplay ) );
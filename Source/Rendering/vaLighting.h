@@ -37,6 +37,8 @@
 
 #include "vaIBL.h"
 
+#include "vaLightClusters.h"
+
 namespace Vanilla
 {
     class vaGBuffer;
@@ -201,6 +203,13 @@ namespace Vanilla
         vaTypedConstantBufferWrapper< LightingShaderConstants >
                                                         m_constantsBuffer;
 
+        // per-cluster spot/point light lists so that forward shading only goes through lights that can reach the pixel
+        bool                                            m_lightClusteringEnabled    = true;
+        vaLightClusters                                 m_lightClusters;
+        vaTypedConstantBufferWrapper< LightClustersShaderConstants >
+                                                        m_clustersConstantsBuffer;
+        bool                                            m_clustersConstantsUploaded = false;
+
 //        shared_ptr<vaLight>
 
         // vaAutoRMI<vaPixelShader>                        m_applyDirectionalAmbientPS;
@@ -243,6 +252,10 @@ namespace Vanilla
 
         void                                            SetAOMap( const shared_ptr<vaTexture> & texture )                                       { m_AOTexture = texture; }
 
+        void                                            SetLightClusteringEnabled( bool enabled )                                               { m_lightClusteringEnabled = enabled; }
+        bool                                            GetLightClusteringEnabled( ) const                                                      { return m_lightClusteringEnabled; }
+        const vaLightClusters::Stats &                  GetLightClusterStats( ) const                                                           { return m_lightClusters.GetStats( ); }
+
         void                                            Tick( float deltaTime );
 
         // call vaShadowmap::SetUpToDate() to make 'fresh' - 'fresh' ones will not get returned by this function, and if there's no dirty ones left it will return nullptr
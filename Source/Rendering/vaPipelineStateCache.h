@@ -0,0 +1,352 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Core/vaCoreIncludes.h"
+
+namespace Vanilla
+{
+    // Platform independent cache for pipeline state objects (or anything else that is expensive to create and gets looked
+    // up very often by a description of its state), built for the 'every draw call looks up its PSO' pattern.
+    //
+    // KeyType needs a precomputed, non-zero 'uint64 Hash' member and 'bool KeyEquals( const KeyType & ) const' for the
+    // full comparison (hash collisions are handled, they're just slower). The shared part is an open addressing table
+    // with atomic slots: lookups never lock, inserts (rare, and the creation is expensive anyway) take a mutex and growing
+    // publishes a new table while concurrent readers can still finish probing the old one. FrontCache is a small direct
+    // mapped cache owned by a single context (thread) that sits in front of the shared table; a hit there is just a hash
+    // compare and a KeyEquals.
+    //
+    // FindOrCreate (directly or through a FrontCache) can be called from any number of threads; IncrementalCleanup and
+    // Clear can not run at the same time as lookups (call them at a sync point, for ex. at the start of the frame).
+    // Returned pointers stay valid until the entry is removed by one of those.
+    template< typename KeyType, typename ValueType >
+    class vaPipelineStateCache
+    {
+    public:
+        struct Statistics
+        {
+            uint32                          Capacity        = 0;
+            uint32                          LiveCount       = 0;
+            uint32                          TombstoneCount  = 0;
+            int64                           Creations       = 0;
+            int64                           Removals        = 0;
+            int64                           Rebuilds        = 0;
+        };
+
+    private:
+        struct Entry
+        {
+            KeyType const                   Key;
+            shared_ptr<ValueType>           Value;
+
+            Entry( const KeyType & key ) : Key( key ) { }
+        };
+
+        struct Slot
+        {
+            atomic_uint64                   Hash;           // 0 - empty; removed entries leave a tombstone (Hash != 0, EntryPtr == nullptr)
+            std::atomic<Entry *>            EntryPtr;
+        };
+
+        struct Table
+        {
+            uint32 const                    Capacity;       // always a power of 2
+            Slot * const                    Slots;
+
+            explicit Table( uint32 capacity ) : Capacity( capacity ), Slots( new Slot[capacity] )
+            {
+                for( uint32 i = 0; i < capacity; i++ )
+                {
+                    Slots[i].Hash.store( 0, std::memory_order_relaxed );
+                    Slots[i].EntryPtr.store( nullptr, std::memory_order_relaxed );
+                }
+            }
+            ~Table( )                                   { delete[] Slots; }
+        };
+
+        static const uint32                 c_minCapacity   = 256;
+
+        std::atomic<Table *>                m_table;
+        vector<Table *>                     m_retiredTables;        // replaced tables that concurrent readers might still be probing
+        mutable mutex                       m_mutex;                // inserts / removals
+        uint32                              m_usedSlots     = 0;    // live + tombstones; kept under half of the capacity
+        uint32                              m_liveCount     = 0;
+        uint32                              m_cleanupCursor = 0;
+        atomic_uint64                       m_generation;           // changes whenever an entry is removed - front caches flush on change
+        Statistics                          m_stats;
+
+    public:
+        // Small direct mapped per-context (single thread) cache in front of the shared table
+        template< uint32 SlotCount = 64 >
+        class FrontCache
+        {
+            static_assert( SlotCount > 0 && ( SlotCount & ( SlotCount - 1 ) ) == 0, "SlotCount must be a power of 2" );
+
+            struct FrontSlot
+            {
+                uint64                      Hash            = 0;
+                Entry *                     EntryPtr        = nullptr;
+            };
+            FrontSlot                       m_slots[SlotCount];
+            uint64                          m_generation    = 0;
+            int64                           m_hits          = 0;
+            int64                           m_misses        = 0;
+
+        public:
+            template< typename CreateCallback >
+            ValueType *                     FindOrCreate( vaPipelineStateCache & cache, const KeyType & key, CreateCallback && createCallback )
+            {
+                uint64 generation = cache.m_generation.load( std::memory_order_acquire );
+                if( generation != m_generation )
+                {
+                    Reset( );
+                    m_generation = generation;
+                }
+                FrontSlot & slot = m_slots[ ( key.Hash ^ ( key.Hash >> 32 ) ) & ( SlotCount - 1 ) ];
+                if( slot.Hash == key.Hash && slot.EntryPtr->Key.KeyEquals( key ) )
+                {
+                    m_hits++;
+                    return slot.EntryPtr->Value.get( );
+                }
+                m_misses++;
+                slot.EntryPtr   = cache.FindOrCreateEntry( key, std::forward<CreateCallback>( createCallback ) );
+                slot.Hash       = key.Hash;
+                return slot.EntryPtr->Value.get( );
+            }
+
+            void                            Reset( )            { for( FrontSlot & slot : m_slots ) slot = FrontSlot( ); }
+
+            int64                           GetHitCount( ) const    { return m_hits; }
+            int64                           GetMissCount( ) const   { return m_misses; }
+        };
+
+    public:
+        vaPipelineStateCache( )
+        {
+            m_table.store( new Table( c_minCapacity ), std::memory_order_relaxed );
+            m_generation.store( 1, std::memory_order_relaxed );
+        }
+        ~vaPipelineStateCache( )
+        {
+            // values not released through Clear just get dropped here
+            Table * table = m_table.load( std::memory_order_relaxed );
+            for( uint32 i = 0; i < table->Capacity; i++ )
+                delete table->Slots[i].EntryPtr.load( std::memory_order_relaxed );
+            delete table;
+            FreeRetiredTables( );
+        }
+
+        vaPipelineStateCache( const vaPipelineStateCache & ) = delete;
+        vaPipelineStateCache & operator =( const vaPipelineStateCache & ) = delete;
+
+        // lock-free; nullptr if not in the cache
+        ValueType *                         Find( const KeyType & key ) const
+        {
+            Entry * entry = FindEntry( key );
+            return ( entry != nullptr ) ? ( entry->Value.get( ) ) : ( nullptr );
+        }
+
+        // lock-free if found; otherwise takes the lock and, if no one else added it in the meantime, calls
+        // 'shared_ptr<ValueType> createCallback( const KeyType & key )' to create the value (under the lock, so only once)
+        template< typename CreateCallback >
+        ValueType *                         FindOrCreate( const KeyType & key, CreateCallback && createCallback )
+        {
+            return FindOrCreateEntry( key, std::forward<CreateCallback>( createCallback ) )->Value.get( );
+        }
+
+        // Visits up to itemsToVisit entries, continuing where the previous call stopped, and removes the ones for which
+        // 'bool removeCallback( shared_ptr<ValueType> & value )' returns true; the callback is responsible for releasing
+        // the value (for ex. deferred until the GPU is done with it). Each removal extends the visit a bit so that a batch
+        // of unused entries goes away quickly but without a spike. Returns the number of removed entries.
+        template< typename RemoveCallback >
+        int                                 IncrementalCleanup( int itemsToVisit, RemoveCallback && removeCallback )
+        {
+            std::unique_lock<mutex> lock( m_mutex );
+            FreeRetiredTables( );
+
+            Table * table = m_table.load( std::memory_order_relaxed );
+            int removed = 0;
+            float remainingStepCount = (float)std::min( itemsToVisit, (int)m_liveCount );
+            for( uint32 step = 0; remainingStepCount > 0.0f && step < table->Capacity; step++ )
+            {
+                Slot & slot = table->Slots[ m_cleanupCursor & ( table->Capacity - 1 ) ];
+                m_cleanupCursor = ( m_cleanupCursor + 1 ) & ( table->Capacity - 1 );
+
+                Entry * entry = slot.EntryPtr.load( std::memory_order_relaxed );
+                if( entry == nullptr )
+                    continue;
+                if( removeCallback( entry->Value ) )
+                {
+                    RemoveLocked( slot );
+                    removed++;
+                    remainingStepCount += 0.8f;
+                }
+                remainingStepCount -= 1.0f;
+            }
+            return removed;
+        }
+
+        // removes everything; 'void releaseCallback( shared_ptr<ValueType> & value )' is called for each value
+        template< typename ReleaseCallback >
+        void                                Clear( ReleaseCallback && releaseCallback )
+        {
+            std::unique_lock<mutex> lock( m_mutex );
+            FreeRetiredTables( );
+
+            Table * table = m_table.load( std::memory_order_relaxed );
+            for( uint32 i = 0; i < table->Capacity; i++ )
+            {
+                Entry * entry = table->Slots[i].EntryPtr.load( std::memory_order_relaxed );
+                if( entry == nullptr )
+                    continue;
+                releaseCallback( entry->Value );
+                RemoveLocked( table->Slots[i] );
+            }
+            // start from scratch (no tombstones)
+            m_table.store( new Table( c_minCapacity ), std::memory_order_release );
+            delete table;
+            m_usedSlots     = 0;
+            m_cleanupCursor = 0;
+        }
+
+        uint32                              GetCount( ) const           { return m_liveCount; }
+
+        Statistics                          GetStatistics( ) const
+        {
+            std::unique_lock<mutex> lock( m_mutex );
+            Statistics stats        = m_stats;
+            stats.Capacity          = m_table.load( std::memory_order_relaxed )->Capacity;
+            stats.LiveCount         = m_liveCount;
+            stats.TombstoneCount    = m_usedSlots - m_liveCount;
+            return stats;
+        }
+
+    private:
+        Entry *                             FindEntry( const KeyType & key ) const
+        {
+            assert( key.Hash != 0 );    // hash not computed?
+            const Table * table = m_table.load( std::memory_order_acquire );
+            const uint32 mask   = table->Capacity - 1;
+            // the table is never more than half full so there's always an empty slot to stop at
+            for( uint32 i = (uint32)key.Hash & mask; ; i = ( i + 1 ) & mask )
+            {
+                const Slot & slot = table->Slots[i];
+                uint64 slotHash = slot.Hash.load( std::memory_order_acquire );
+                if( slotHash == 0 )
+                    return nullptr;
+                if( slotHash == key.Hash )
+                {
+                    Entry * entry = slot.EntryPtr.load( std::memory_order_acquire );
+                    if( entry != nullptr && entry->Key.KeyEquals( key ) )
+                        return entry;
+                }
+            }
+        }
+
+        template< typename CreateCallback >
+        Entry *                             FindOrCreateEntry( const KeyType & key, CreateCallback && createCallback )
+        {
+            Entry * entry = FindEntry( key );
+            if( entry != nullptr )
+                return entry;
+
+            std::unique_lock<mutex> lock( m_mutex );
+
+            // someone could have added it while we were waiting
+            entry = FindEntry( key );
+            if( entry != nullptr )
+                return entry;
+
+            entry = new Entry( key );
+            entry->Value = createCallback( entry->Key );
+            m_stats.Creations++;
+
+            if( ( m_usedSlots + 1 ) * 2 > m_table.load( std::memory_order_relaxed )->Capacity )
+                RebuildLocked( );
+            InsertLocked( *m_table.load( std::memory_order_relaxed ), entry );
+            return entry;
+        }
+
+        // takes the first empty slot or tombstone; the entry is written before the hash as the table can already be visible to readers
+        void                                InsertLocked( Table & table, Entry * entry )
+        {
+            m_mutex.assert_locked_by_caller( );
+            const uint32 mask = table.Capacity - 1;
+            for( uint32 i = (uint32)entry->Key.Hash & mask; ; i = ( i + 1 ) & mask )
+            {
+                Slot & slot = table.Slots[i];
+                uint64 slotHash = slot.Hash.load( std::memory_order_relaxed );
+                if( slotHash == 0 || slot.EntryPtr.load( std::memory_order_relaxed ) == nullptr )
+                {
+                    if( slotHash == 0 )
+                        m_usedSlots++;
+                    slot.EntryPtr.store( entry, std::memory_order_release );
+                    slot.Hash.store( entry->Key.Hash, std::memory_order_release );
+                    m_liveCount++;
+                    return;
+                }
+            }
+        }
+
+        void                                RemoveLocked( Slot & slot )
+        {
+            m_mutex.assert_locked_by_caller( );
+            Entry * entry = slot.EntryPtr.load( std::memory_order_relaxed );
+            assert( entry != nullptr );
+            slot.EntryPtr.store( nullptr, std::memory_order_release );
+            delete entry;
+            m_liveCount--;
+            m_stats.Removals++;
+            m_generation.fetch_add( 1, std::memory_order_release );
+        }
+
+        // new table with only the live entries (drops tombstones), doubled if needed to stay at most a quarter full
+        void                                RebuildLocked( )
+        {
+            m_mutex.assert_locked_by_caller( );
+            Table * oldTable = m_table.load( std::memory_order_relaxed );
+            uint32 newCapacity = c_minCapacity;
+            while( ( m_liveCount + 1 ) * 4 > newCapacity )
+                newCapacity *= 2;
+            newCapacity = std::max( newCapacity, oldTable->Capacity );
+
+            Table * newTable = new Table( newCapacity );
+            m_usedSlots = 0;
+            m_liveCount = 0;
+            for( uint32 i = 0; i < oldTable->Capacity; i++ )
+            {
+                Entry * entry = oldTable->Slots[i].EntryPtr.load( std::memory_order_relaxed );
+                if( entry != nullptr )
+                    InsertLocked( *newTable, entry );
+            }
+            m_table.store( newTable, std::memory_order_release );
+            m_retiredTables.push_back( oldTable );
+            m_cleanupCursor = 0;
+            m_stats.Rebuilds++;
+        }
+
+        void                                FreeRetiredTables( )
+        {
+            for( Table * table : m_retiredTables )
+                delete table;
+            m_retiredTables.clear( );
+        }
+    };
+}
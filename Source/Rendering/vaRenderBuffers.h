@@ -56,6 +56,7 @@ namespace Vanilla
         uint32                              GetDataSize( ) const                                                    { return m_dataSize; }
 
     public:
+        // dataSize can be smaller than the buffer - only the leading part gets updated and the rest becomes undefined
         virtual void                        Update( vaRenderDeviceContext & renderContext, const void * data, uint32 dataSize )                             = 0;
 
         virtual void                        Create( int bufferSize, const void * initialData, bool dynamicUpload )                                          = 0;
@@ -195,6 +196,8 @@ namespace Vanilla
         
         inline uint32                       GetDataSize( ) const                                            { assert(m_cbuffer != nullptr); return m_cbuffer->GetDataSize( ); }
         inline void                         Update( vaRenderDeviceContext & renderContext, const T & data ) { assert(m_cbuffer != nullptr); m_cbuffer->Update( renderContext, (void*)&data, sizeof( T ) ); }
+        // only the first dataSize bytes of data get uploaded (for ex. the used part of an array), the rest of the buffer is undefined
+        inline void                         Update( vaRenderDeviceContext & renderContext, const T & data, uint32 dataSize ) { assert(m_cbuffer != nullptr); assert( dataSize <= sizeof( T ) ); m_cbuffer->Update( renderContext, (void*)&data, dataSize ); }
 
         inline const shared_ptr<vaConstantBuffer> & 
                                             GetBuffer( ) const      { assert(m_cbuffer != nullptr); return m_cbuffer; }
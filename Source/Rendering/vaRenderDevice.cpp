@@ -240,6 +240,7 @@ void vaRenderDevice::BeginFrame( float deltaTime )
     assert( !m_frameStarted );
     m_frameStarted = true;
     m_currentFrameIndex++;
+    m_frameArena.BeginFrame( m_currentFrameIndex );
 
     if( m_mainDeviceContext != nullptr )
         m_mainDeviceContext->SetRenderTarget( GetCurrentBackbuffer(), nullptr, true );
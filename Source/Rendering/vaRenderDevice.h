@@ -21,6 +21,7 @@
 
 #include "Core/vaCoreIncludes.h"
 #include "Core/vaEvent.h"
+#include "Core/vaFrameArena.h"
 
 #include "Rendering/vaRendering.h"
 
@@ -146,6 +147,9 @@ namespace Vanilla
 
         vaRenderDeviceCapabilities              m_caps;
 
+        // transient per-frame CPU memory (draw lists, sort buffers, culling data...) - one region per frame in flight
+        vaFrameArena                            m_frameArena            { c_BackbufferCount + 1 };
+
         static thread_local vaRenderDeviceThreadLocal  s_threadLocal;
 
     public:
@@ -193,6 +197,7 @@ namespace Vanilla
 
         double                              GetTotalTime( ) const                                                       { return m_totalTime; }
         int64                               GetCurrentFrameIndex( ) const                                               { return m_currentFrameIndex; }
+        vaFrameArena &                      GetFrameArena( )                                                            { return m_frameArena; }
 
         vaRenderDeviceContext *             GetMainContext( ) const                                                     { assert( IsRenderThread() ); return m_mainDeviceContext.get(); }
                 
@@ -26,6 +26,7 @@
 #include "Rendering/vaRenderDevice.h"
 #include "Rendering/vaAssetPack.h"
 #include "Core/vaXMLSerialization.h"
+#include "Core/Misc/vaXXHash.h"
 
 #include "IntegratedExternals/vaImguiIntegration.h"
 
@@ -583,6 +584,7 @@ void vaRenderMaterial::UpdateShaderMacros( )
 
     m_shaderMacrosDirty = false;
     m_shadersDirty = prevShaderMacros != m_shaderMacros;
+    m_shaderKeyDirty |= m_shadersDirty;
 }
 
 void vaRenderMaterial::RemoveAllNodes( )
@@ -1151,7 +1153,12 @@ bool vaRenderMaterial::Update( )
 
     if( m_shadersDirty || (m_shaders == nullptr) )
     {
-        m_shaders = m_renderMaterialManager.FindOrCreateShaders( IsAlphaTested(), m_shaderSettings, m_shaderMacros );
+        if( m_shaderKeyDirty )
+        {
+            m_renderMaterialManager.BuildShaderKey( IsAlphaTested(), m_shaderSettings, m_shaderMacros, m_shaderKey );
+            m_shaderKeyDirty = false;
+        }
+        m_shaders = m_renderMaterialManager.FindOrCreateShaders( m_shaderKey, IsAlphaTested(), m_shaderSettings, m_shaderMacros );
         m_shadersDirty = m_shaders == nullptr;
         assert( m_shaders != nullptr );
 
@@ -1200,7 +1207,7 @@ void vaRenderMaterial::GetShaderState_PS_CustomShadow( vaShader::State & outStat
     m_shaders->PS_CustomShadow->GetState( outState, outErrorString );
 }
 
-bool vaRenderMaterial::SetToRenderItem( vaGraphicsItem & renderItem, vaRenderMaterialShaderType shaderType, vaDrawResultFlags & inoutDrawResults )
+bool vaRenderMaterial::SetToRenderItem( vaGraphicsItem & renderItem, vaRenderMaterialShaderType shaderType, vaDrawResultFlags & inoutDrawResults, float screenCoverage )
 {
     if( !Update( ) )
     {
@@ -1208,6 +1215,23 @@ bool vaRenderMaterial::SetToRenderItem( vaGraphicsItem & renderItem, vaRenderMat
         return false;
     }
 
+    // this permutation is still compiling: the bigger the draw the sooner it should get compiled, and draw it with the generic fallback meanwhile (if there is one)
+    if( m_shaders->IsCompiling( shaderType ) )
+    {
+        m_shaders->RaiseCompilePriority( shaderType, screenCoverage );
+
+        shared_ptr<vaRenderMaterial> fallback = m_renderMaterialManager.GetFallbackMaterial( m_materialSettings.LayerMode, shaderType );
+        if( fallback != nullptr && fallback.get( ) != this )
+        {
+            vaDrawResultFlags fallbackDrawResults = vaDrawResultFlags::None;
+            if( fallback->SetToRenderItem( renderItem, shaderType, fallbackDrawResults ) )
+            {
+                inoutDrawResults |= vaDrawResultFlags::ShadersStillCompiling;
+                return true;
+            }
+        }
+    }
+
     bool retVal = true;
 
     renderItem.VertexShader     = GetVS( shaderType );
@@ -1244,6 +1268,28 @@ bool vaRenderMaterial::SetToRenderItem( vaGraphicsItem & renderItem, vaRenderMat
     return retVal;
 }
 
+bool vaRenderMaterial::AreShadersReady( vaRenderMaterialShaderType shaderType )
+{
+    return Update( ) && !m_shaders->IsCompiling( shaderType );
+}
+
+bool vaRenderMaterial::PreWarmShaders( float compilePriority )
+{
+    if( !Update( ) )
+        return false;
+
+    bool ready = true;
+    for( vaRenderMaterialShaderType shaderType : { vaRenderMaterialShaderType::Forward, vaRenderMaterialShaderType::DepthOnly, vaRenderMaterialShaderType::CustomShadow } )
+    {
+        if( m_shaders->IsCompiling( shaderType ) )
+        {
+            m_shaders->RaiseCompilePriority( shaderType, compilePriority );
+            ready = false;
+        }
+    }
+    return ready;
+}
+
 bool vaRenderMaterial::TextureNode::UIDraw( vaApplicationBase & , vaRenderMaterial & ownerMaterial )
 {
     bool inputsChanged = false;
@@ -1598,6 +1644,32 @@ bool vaRenderMaterial::UIPropertiesDraw( vaApplicationBase& application )
 }
 
 
+bool vaRenderMaterialCachedShaders::IsCompiling( vaRenderMaterialShaderType shaderType ) const
+{
+    if( VS_Standard->IsBackgroundCreateActive( ) || GS_Standard->IsBackgroundCreateActive( ) )
+        return true;
+    switch( shaderType )
+    {
+    case vaRenderMaterialShaderType::Forward:       return PS_Forward->IsBackgroundCreateActive( );
+    case vaRenderMaterialShaderType::DepthOnly:     return PS_DepthOnly->IsBackgroundCreateActive( );
+    case vaRenderMaterialShaderType::CustomShadow:  return PS_CustomShadow->IsBackgroundCreateActive( );
+    default: assert( false ); return false;
+    }
+}
+
+void vaRenderMaterialCachedShaders::RaiseCompilePriority( vaRenderMaterialShaderType shaderType, float priority )
+{
+    VS_Standard->RaiseCompilePriority( priority );
+    GS_Standard->RaiseCompilePriority( priority );
+    switch( shaderType )
+    {
+    case vaRenderMaterialShaderType::Forward:       PS_Forward->RaiseCompilePriority( priority );       break;
+    case vaRenderMaterialShaderType::DepthOnly:     PS_DepthOnly->RaiseCompilePriority( priority );     break;
+    case vaRenderMaterialShaderType::CustomShadow:  PS_CustomShadow->RaiseCompilePriority( priority );  break;
+    default: assert( false ); break;
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // vaRenderMaterialManager
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1617,6 +1689,18 @@ vaRenderMaterialManager::vaRenderMaterialManager( const vaRenderingModuleParams
 
     m_defaultMaterial->SetImmutable( true );
 
+    // not tracked (not visible to asset/UI systems); shaders are created on the first UpdateAndSetToGlobals as the shader manager doesn't exist yet at this point
+    for( vaLayerMode layerMode : { vaLayerMode::Opaque, vaLayerMode::Transparent } )
+    {
+        shared_ptr<vaRenderMaterial> fallback = CreateRenderMaterial( vaCore::GUIDCreate( ), false );
+        fallback->SetupFromPreset( c_FilamentStandard );
+        vaRenderMaterial::MaterialSettings settings = fallback->GetMaterialSettings( );
+        settings.LayerMode = layerMode;
+        fallback->SetMaterialSettings( settings );
+        fallback->SetImmutable( true );
+        m_fallbackMaterials[(int)layerMode] = fallback;
+    }
+
     m_texturingDisabled = false;
 
     // from filament CMakeLists.txt:
@@ -1637,6 +1721,8 @@ vaRenderMaterialManager::~vaRenderMaterialManager( )
     //m_renderMeshesMap.clear();
 
     m_defaultMaterial = nullptr;
+    for( shared_ptr<vaRenderMaterial> & fallback : m_fallbackMaterials )
+        fallback = nullptr;
     // this must absolutely be true as they contain direct reference to this object
     assert( m_renderMaterials.size( ) == 0 );
 }
@@ -1677,42 +1763,56 @@ shared_ptr<vaRenderMaterial> vaRenderMaterialManager::CreateRenderMaterial( cons
     return ret;
 }
 
+shared_ptr<vaRenderMaterial> vaRenderMaterialManager::GetFallbackMaterial( vaLayerMode layerMode, vaRenderMaterialShaderType shaderType )
+{
+    assert( (int)layerMode >= 0 && layerMode < vaLayerMode::MaxValue );
+    const shared_ptr<vaRenderMaterial> & fallback = m_fallbackMaterials[(int)layerMode];
+    if( fallback == nullptr || !m_fallbackMaterialsWarmed || !fallback->AreShadersReady( shaderType ) )
+        return nullptr;
+    return fallback;
+}
+
 void vaRenderMaterialManager::UIPanelTick( vaApplicationBase & )
 {
 #ifdef VA_IMGUI_INTEGRATION_ENABLED
-    static int selected = 0;
-    ImGui::BeginChild( "left pane", ImVec2( 150, 0 ), true );
-    for( int i = 0; i < 7; i++ )
-    {
-        char label[128];
-        sprintf_s( label, _countof( label ), "MyObject %d", i );
-        if( ImGui::Selectable( label, selected == i ) )
-            selected = i;
-    }
-    ImGui::EndChild( );
-    ImGui::SameLine( );
-
-    // right
-    ImGui::BeginGroup( );
-    ImGui::BeginChild( "item view", ImVec2( 0, -ImGui::GetFrameHeightWithSpacing( ) ) ); // Leave room for 1 line below us
-    ImGui::Text( "MyObject: %d", selected );
+    ImGui::Text( "Materials: %d", (int)m_renderMaterials.size( ) );
     ImGui::Separator( );
-    ImGui::TextWrapped( "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. " );
-    ImGui::EndChild( );
-    ImGui::BeginChild( "buttons" );
-    if( ImGui::Button( "Revert" ) ) { }
-    ImGui::SameLine( );
-    if( ImGui::Button( "Save" ) ) { }
-    ImGui::EndChild( );
-    ImGui::EndGroup( );
+
+    const ShaderPermutationStats & stats = m_shaderPermutationStats;
+    ImGui::Text( "Shader permutations: %d (%d interned strings)", GetShaderPermutationCount( ), (int)m_shaderKeyStrings.size( ) );
+    ImGui::Text( "Lookups: %lld, hits: %lld (%.1f%%)", stats.Lookups, stats.Hits, ( stats.Lookups > 0 ) ? ( 100.0 * stats.Hits / stats.Lookups ) : ( 0.0 ) );
+    ImGui::Text( "Misses: %lld (of which %lld expired)", stats.Misses, stats.Expired );
+    if( ImGui::Button( "Reset stats" ) )
+        m_shaderPermutationStats = ShaderPermutationStats( );
 #endif
 }
 
+void vaRenderMaterialManager::BuildShaderKey( bool alphaTest, const vaRenderMaterial::ShaderSettings & shaderSettings, const vector< pair< string, string > > & shaderMacros, vaRenderMaterialShaderKey & outKey )
+{
+    assert( GetRenderDevice().IsRenderThread() );
+
+    outKey.IDs.clear( );
+    outKey.IDs.push_back( (alphaTest)?(1):(0) );
+    for( const pair< string, string > * fileEntry : { &shaderSettings.VS_Standard, &shaderSettings.PS_DepthOnly, &shaderSettings.PS_Forward, &shaderSettings.PS_CustomShadow, &shaderSettings.GS_Standard } )
+    {
+        outKey.IDs.push_back( InternShaderKeyString( fileEntry->first ) );
+        outKey.IDs.push_back( InternShaderKeyString( fileEntry->second ) );
+    }
+    for( const pair< string, string > & macro : shaderMacros )
+    {
+        outKey.IDs.push_back( InternShaderKeyString( macro.first ) );
+        outKey.IDs.push_back( InternShaderKeyString( macro.second ) );
+    }
+    outKey.Hash = vaXXHash64::Compute( outKey.IDs.data( ), outKey.IDs.size( ) * sizeof( uint32 ) );
+}
+
 shared_ptr<vaRenderMaterialCachedShaders>
-vaRenderMaterialManager::FindOrCreateShaders( bool alphaTest, const vaRenderMaterial::ShaderSettings & shaderSettings, const vector< pair< string, string > > & shaderMacros )
+vaRenderMaterialManager::FindOrCreateShaders( const vaRenderMaterialShaderKey & cacheKey, bool alphaTest, const vaRenderMaterial::ShaderSettings & shaderSettings, const vector< pair< string, string > > & shaderMacros )
 {
-    vaRenderMaterialCachedShaders::Key cacheKey( alphaTest, shaderSettings, shaderMacros );
+    assert( GetRenderDevice().IsRenderThread() );
+    assert( !cacheKey.IDs.empty( ) && cacheKey.IDs[0] == ( (alphaTest)?(1u):(0u) ) );
 
+    m_shaderPermutationStats.Lookups++;
     auto it = m_cachedShaders.find( cacheKey );
     
     // in cache but no longer used by anyone so it was destroyed
@@ -1720,6 +1820,7 @@ vaRenderMaterialManager::FindOrCreateShaders( bool alphaTest, const vaRenderMate
     {
         m_cachedShaders.erase( it );
         it = m_cachedShaders.end();
+        m_shaderPermutationStats.Expired++;
     }
 
     // not in cache
@@ -1771,15 +1872,29 @@ vaRenderMaterialManager::FindOrCreateShaders( bool alphaTest, const vaRenderMate
             newShaders->PS_CustomShadow->CreateShaderFromFile( shaderSettings.PS_CustomShadow.first,    "ps_5_0", shaderSettings.PS_CustomShadow.second.c_str( ), shaderMacros, false );
         
         m_cachedShaders.insert( std::make_pair( cacheKey, newShaders ) );
+        m_shaderPermutationStats.Misses++;
 
         return newShaders;
     }
     else
     {
+        m_shaderPermutationStats.Hits++;
         return it->second.lock();
     }
 }
 
+uint32 vaRenderMaterialManager::InternShaderKeyString( const string & str )
+{
+    auto it = m_shaderKeyStrings.find( str );
+    if( it != m_shaderKeyStrings.end( ) )
+        return it->second;
+
+    // 0 and 1 are reserved for the alpha test flag
+    uint32 id = (uint32)m_shaderKeyStrings.size( ) + 2;
+    m_shaderKeyStrings.insert( std::make_pair( str, id ) );
+    return id;
+}
+
 void vaRenderMaterialManager::SetGlobalShaderMacros( const vector< pair< string, string > > & globalShaderMacros ) 
 {
     assert( GetRenderDevice().IsRenderThread() );
@@ -1808,6 +1923,15 @@ void vaRenderMaterialManager::SetGlobalGSOverride( bool enabled )
 void vaRenderMaterialManager::UpdateAndSetToGlobals( vaSceneDrawContext & drawContext, vaShaderItemGlobals & shaderItemGlobals )
 {   
     drawContext;
+
+    if( !m_fallbackMaterialsWarmed )
+    {
+        for( const shared_ptr<vaRenderMaterial> & fallback : m_fallbackMaterials )
+            if( fallback != nullptr )
+                fallback->PreWarmShaders( c_fallbackCompilePriority );
+        m_fallbackMaterialsWarmed = true;
+    }
+
     assert( shaderItemGlobals.ShaderResourceViews[SHADERGLOBAL_MATERIAL_DFG_LOOKUPTABLE - vaShaderItemGlobals::ShaderResourceViewsShaderSlotBase] == nullptr );
     shaderItemGlobals.ShaderResourceViews[SHADERGLOBAL_MATERIAL_DFG_LOOKUPTABLE - vaShaderItemGlobals::ShaderResourceViewsShaderSlotBase] = m_DFG_LUT;
 }
@@ -2122,6 +2246,16 @@ bool vaRenderMaterial::InputSlot::Serialize( vaXMLSerializer& serializer )
 
 }
 
+void vaRenderMaterial::EnumerateTextureNodes( const std::function<void( const TextureNode & node )> & callback ) const
+{
+    for( int i = 0; i < m_nodes.size( ); i++ )
+    {
+        auto snode = std::dynamic_pointer_cast<TextureNode, Node>( m_nodes[i] );
+        if( snode != nullptr && snode->GetTextureUID( ) != vaGUID::Null )
+            callback( *snode );
+    }
+}
+
 void vaRenderMaterial::EnumerateUsedAssets( const std::function<void( vaAsset * asset )> & callback )
 {
     callback( GetParentAsset() );
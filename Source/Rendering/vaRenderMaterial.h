@@ -35,6 +35,7 @@
 #include "Core/vaXMLSerialization.h"
 
 #include <optional>
+#include <unordered_map>
 
 // for PBR, reading material:
 // - http://blog.selfshadow.com/publications/s2015-shading-course/
@@ -70,6 +71,23 @@ namespace Vanilla
 {
     class vaRenderMaterialManager;
 
+    // Shader file/entry names and macro names/values are interned (see vaRenderMaterialManager::BuildShaderKey) so a
+    // shader permutation is identified by a short list of IDs; Hash is computed from them once and used for lookups,
+    // the IDs are only compared on hash match.
+    struct vaRenderMaterialShaderKey
+    {
+        uint64                      Hash            = 0;
+        vector<uint32>              IDs;
+
+        bool                        operator == ( const vaRenderMaterialShaderKey & cmp ) const   { return this->Hash == cmp.Hash && this->IDs == cmp.IDs; }
+        bool                        operator != ( const vaRenderMaterialShaderKey & cmp ) const   { return !( *this == cmp ); }
+
+        struct Hasher
+        {
+            size_t                  operator( ) ( const vaRenderMaterialShaderKey & key ) const   { return (size_t)key.Hash; }
+        };
+    };
+
     struct vaRenderMaterialConstructorParams : vaRenderingModuleParams
     {
         vaRenderMaterialManager &   RenderMaterialManager;
@@ -188,6 +206,7 @@ namespace Vanilla
 
             shared_ptr<vaTexture>       GetTexture( ) const;
             const vaGUID &              GetTextureUID( ) const                          { return UID; };
+            int                         GetUVIndex( ) const                             { return UVIndex; };
         };
 
         // for editing defaults to an input slot a constant value node
@@ -336,6 +355,8 @@ namespace Vanilla
         int64                                           m_lastUpdateFrame = 0;
 
         shared_ptr<vaRenderMaterialCachedShaders>       m_shaders;
+        vaRenderMaterialShaderKey                       m_shaderKey;                    // rebuilt only when m_shaderKeyDirty
+        bool                                            m_shaderKeyDirty            = true;     // shader settings or macros changed since m_shaderKey was built
 
         // vaTypedConstantBufferWrapper< RenderMeshMaterialConstants >
         //                                                 m_constantsBuffer;
@@ -363,7 +384,7 @@ namespace Vanilla
         void                                            SetMaterialSettings( const MaterialSettings & settings )        { assert( !m_immutable ); if( m_materialSettings != settings ) m_shaderMacrosDirty = true; m_materialSettings = settings; }
 
         const ShaderSettings &                          GetShaderSettings( ) const                                      { return m_shaderSettings; }
-        void                                            SetShaderSettings( const ShaderSettings & settings )            { assert( !m_immutable ); if( m_shaderSettings != settings ) m_shadersDirty = true; m_shaderSettings = settings; }
+        void                                            SetShaderSettings( const ShaderSettings & settings )            { assert( !m_immutable ); if( m_shaderSettings != settings ) { m_shadersDirty = true; m_shaderKeyDirty = true; } m_shaderSettings = settings; }
 
         void                                            SetSettingsDirty( )                                             { m_shaderMacrosDirty = true; }
         void                                            SetShadersDirty( )                                              { m_shaderMacrosDirty = true; m_shadersDirty = true; }
@@ -426,7 +447,14 @@ namespace Vanilla
         // for default or protected materials used by multiple systems that should not be changed - will assert on any attempt to change
         void                                            SetImmutable( bool immutable )          { m_immutable = immutable; }
 
-        bool                                            SetToRenderItem( vaGraphicsItem & renderItem, vaRenderMaterialShaderType shaderType, vaDrawResultFlags & inoutDrawResults );
+        // screenCoverage (fraction of the screen covered by the draw, roughly) is used as the compile priority if the shaders are not ready yet; in that case
+        // the manager's fallback material for the same layer mode is set instead (if available) and ShadersStillCompiling is reported
+        bool                                            SetToRenderItem( vaGraphicsItem & renderItem, vaRenderMaterialShaderType shaderType, vaDrawResultFlags & inoutDrawResults, float screenCoverage = 0.0f );
+
+        // creates the shaders for the current permutation if needed (they compile in the background) and raises their compile priority; returns true if they're ready to use
+        bool                                            PreWarmShaders( float compilePriority );
+        // false if the shaders for the current permutation are still compiling (or the material can't be updated yet)
+        bool                                            AreShadersReady( vaRenderMaterialShaderType shaderType );
 
         // Maybe it's time to refactor this to a big switch & enum? the enum is different from vaRenderMaterialShaderType though and requires indication on whether it's a VS/GS/PS too
         void                                            GetShaderState_VS_Standard    ( vaShader::State & outState, string & outErrorString );
@@ -464,6 +492,7 @@ namespace Vanilla
         bool                                            SetupFromOther( const vaRenderMaterial & other );
 
         void                                            EnumerateUsedAssets( const std::function<void(vaAsset * asset)> & callback );
+        void                                            EnumerateTextureNodes( const std::function<void(const TextureNode & node)> & callback ) const;
 
     public:
         bool                                            UIPropertiesDraw( vaApplicationBase & application ) override;
@@ -473,32 +502,7 @@ namespace Vanilla
 
     struct vaRenderMaterialCachedShaders
     {
-        struct Key
-        {
-            //wstring                     WStringPart;
-            string                      AStringPart;
-
-            bool                        operator == ( const Key & cmp ) const { return this->AStringPart == cmp.AStringPart; }
-            bool                        operator >( const Key & cmp ) const { return this->AStringPart > cmp.AStringPart; }
-            bool                        operator < ( const Key & cmp ) const { return this->AStringPart < cmp.AStringPart; }
-
-            // alphaTest is part of the key because it determines whether PS_DepthOnly is needed at all; all other shader parameters are contained in shaderMacros
-            Key( bool alphaTest, const vaRenderMaterial::ShaderSettings & shaderSettings, const vector< pair< string, string > > & shaderMacros )
-            {
-                //WStringPart = fileName;
-                AStringPart = "";
-                AStringPart += "&" + shaderSettings.VS_Standard.first       + "&" + shaderSettings.VS_Standard.second;
-                AStringPart += "&" + shaderSettings.PS_DepthOnly.first      + "&" + shaderSettings.PS_DepthOnly.second;
-                AStringPart += "&" + shaderSettings.PS_Forward.first        + "&" + shaderSettings.PS_Forward.second;
-                // AStringPart += "&" + shaderSettings.PS_Deferred.first       + "&" + shaderSettings.PS_Deferred.second;
-                AStringPart += "&" + shaderSettings.PS_CustomShadow.first   + "&" + shaderSettings.PS_CustomShadow.second;
-                AStringPart += "&" + shaderSettings.GS_Standard.first       + "&" + shaderSettings.GS_Standard.second;
-
-                AStringPart += ((alphaTest)?("a&"):("b&"));
-                for( int i = 0; i < shaderMacros.size(); i++ )
-                    AStringPart += shaderMacros[i].first + "&" + shaderMacros[i].second + "&";
-            }
-        };
+        typedef vaRenderMaterialShaderKey   Key;
 
         vaRenderMaterialCachedShaders( vaRenderDevice & device ) : VS_Standard( device ), GS_Standard( device ), PS_DepthOnly( device ), PS_Forward( device ), /*PS_Deferred( device ),*/ PS_CustomShadow( device ) { }
 
@@ -509,6 +513,10 @@ namespace Vanilla
         vaAutoRMI<vaPixelShader>           PS_Forward;
         //vaAutoRMI<vaPixelShader>           PS_Deferred;
         vaAutoRMI<vaPixelShader>           PS_CustomShadow;
+
+        // any of the shaders used for shaderType still being compiled in the background
+        bool                               IsCompiling( vaRenderMaterialShaderType shaderType ) const;
+        void                               RaiseCompilePriority( vaRenderMaterialShaderType shaderType, float priority );
     };
 
     class vaRenderMaterialManager : public vaRenderingModule, public vaUIPanel
@@ -522,10 +530,28 @@ namespace Vanilla
         shared_ptr< vaRenderMaterial >                  m_defaultMaterial;
         bool                                            m_isDestructing;
 
+        // generic materials drawn instead of ones whose shaders are still compiling; only Opaque and Transparent have one as the look of
+        // AlphaTest and Decal materials depends on their textures so drawing them with a generic shader would be worse than skipping them
+        shared_ptr< vaRenderMaterial >                  m_fallbackMaterials[(int)vaLayerMode::MaxValue];
+        bool                                            m_fallbackMaterialsWarmed       = false;
+
         bool                                            m_texturingDisabled;
 
-        map< vaRenderMaterialCachedShaders::Key, weak_ptr<vaRenderMaterialCachedShaders> >
+    public:
+        struct ShaderPermutationStats
+        {
+            int64                                       Lookups             = 0;
+            int64                                       Hits                = 0;        // an existing permutation was shared
+            int64                                       Misses              = 0;        // new permutation created (shaders compiled)
+            int64                                       Expired             = 0;        // misses because the previous instance was no longer used by any material
+        };
+
+    protected:
+        // shader permutations shared by all materials, see vaRenderMaterialCachedShaders::Key
+        std::unordered_map< vaRenderMaterialCachedShaders::Key, weak_ptr<vaRenderMaterialCachedShaders>, vaRenderMaterialCachedShaders::Key::Hasher >
                                                         m_cachedShaders;
+        std::unordered_map< string, uint32 >            m_shaderKeyStrings;                             // interned file/entry/macro strings
+        ShaderPermutationStats                          m_shaderPermutationStats;
 
         vector< pair< string, string > >                m_globalShaderMacros;
 
@@ -544,6 +570,12 @@ namespace Vanilla
     public:
         shared_ptr<vaRenderMaterial>                    GetDefaultMaterial( ) const                             { return m_defaultMaterial; }
 
+        // returns nullptr if there's no fallback for the layer mode or if its own shaders aren't ready yet
+        shared_ptr<vaRenderMaterial>                    GetFallbackMaterial( vaLayerMode layerMode, vaRenderMaterialShaderType shaderType );
+
+        // compile priority used for the fallback materials' shaders - higher than any draw's screen coverage
+        static constexpr float                          c_fallbackCompilePriority       = 2.0f;
+
         // warning: changing global shader macros will force recompile of all shaders; this is mostly useful for debugging and similar purposes
         const vector< pair< string, string > > &        GetGlobalShaderMacros( ) const                          { return m_globalShaderMacros; }
         void                                            SetGlobalShaderMacros( const vector< pair< string, string > > & globalShaderMacros = vector< pair< string, string > >() );
@@ -564,8 +596,16 @@ namespace Vanilla
         void                                            UpdateAndSetToGlobals( vaSceneDrawContext & drawContext, vaShaderItemGlobals & shaderItemGlobals );
 
     public:
-        // alphaTest is part of the key because it determines whether PS_DepthOnly is needed at all; all other shader parameters are contained in shaderMacros
-        shared_ptr<vaRenderMaterialCachedShaders>       FindOrCreateShaders( bool alphaTest, const vaRenderMaterial::ShaderSettings & shaderSettings, const vector< pair< string, string > > & shaderMacros );
+        // alphaTest is part of the key because it determines whether PS_DepthOnly is needed at all; all other shader parameters are contained in shaderMacros;
+        // materials build their key only when their shader settings or macros change and keep it for the lookups
+        void                                            BuildShaderKey( bool alphaTest, const vaRenderMaterial::ShaderSettings & shaderSettings, const vector< pair< string, string > > & shaderMacros, vaRenderMaterialShaderKey & outKey );
+        shared_ptr<vaRenderMaterialCachedShaders>       FindOrCreateShaders( const vaRenderMaterialShaderKey & key, bool alphaTest, const vaRenderMaterial::ShaderSettings & shaderSettings, const vector< pair< string, string > > & shaderMacros );
+
+        const ShaderPermutationStats &                  GetShaderPermutationStats( ) const                      { return m_shaderPermutationStats; }
+        int                                             GetShaderPermutationCount( ) const                      { return (int)m_cachedShaders.size( ); }
+
+    private:
+        uint32                                          InternShaderKeyString( const string & str );
 
     protected:
         virtual string                                  UIPanelGetDisplayName( ) const override { return "Materials"; } //vaStringTools::Format( "vaRenderMaterialManager (%d meshes)", m_renderMaterials.size( ) ); }
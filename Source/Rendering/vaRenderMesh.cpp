@@ -29,6 +29,8 @@
 
 #include "Core/vaXMLSerialization.h"
 
+#include "Core/vaMemory.h"
+
 #include "IntegratedExternals/vaImguiIntegration.h"
 
 #include "Rendering/vaAssetPack.h"
@@ -109,7 +111,8 @@ void vaRenderMesh::RebuildNormals( )
 vaRenderMeshManager::vaRenderMeshManager( const vaRenderingModuleParams & params ) : 
     vaRenderingModule( params ), 
     vaUIPanel( "RenderMeshManager", 0, false, vaUIPanel::DockLocation::DockedLeftBottom ),
-    m_constantsBuffer( params )
+    m_constantsBuffer( params ),
+    m_instanceArrayBuffer( params )
 {
     m_isDestructing = false;
     m_renderMeshes.SetAddedCallback( std::bind( &vaRenderMeshManager::RenderMeshesTrackeeAddedCallback, this, std::placeholders::_1 ) );
@@ -767,8 +770,42 @@ vaRenderMeshDrawList::Entry::Entry( const std::shared_ptr<vaRenderMesh> & mesh,
     assert( material != nullptr );
 }
 
+void vaRenderMeshDrawList::Reset( )
+{
+    Event_PreReset.Invoke( *this );
+    Event_PreReset.RemoveAll( );
+
+    if( m_drawList.size( ) > 0 )
+        m_lastCount = (int)m_drawList.size( );
+
+    // with the arena this drops the storage (it's reclaimed wholesale by the arena), otherwise just clears and keeps the capacity
+    vaFrameArenaVectorReset( m_drawList, m_frameArena );
+    vaFrameArenaVectorReset( m_sortState.SortDistances, m_frameArena );
+    vaFrameArenaVectorReset( m_sortState.SortedIndices, m_frameArena );
+    vaFrameArenaVectorReset( m_batchState.Leaders, m_frameArena );
+    vaFrameArenaVectorReset( m_batchState.Members, m_frameArena );
+    vaFrameArenaVectorReset( m_batchState.Batches, m_frameArena );
+    m_sortState.Sorted  = false;
+    m_arenaFrame        = -1;
+}
+
+void vaRenderMeshDrawList::SetFrameArena( vaFrameArena * frameArena )
+{
+    Reset( );
+    m_frameArena = frameArena;
+    // re-bind the (now empty) containers to the new allocator
+    vaFrameArenaVectorReset( m_drawList, m_frameArena );
+    vaFrameArenaVectorReset( m_sortState.SortDistances, m_frameArena );
+    vaFrameArenaVectorReset( m_sortState.SortedIndices, m_frameArena );
+    vaFrameArenaVectorReset( m_batchState.Leaders, m_frameArena );
+    vaFrameArenaVectorReset( m_batchState.Members, m_frameArena );
+    vaFrameArenaVectorReset( m_batchState.Batches, m_frameArena );
+}
+
 void vaRenderMeshDrawList::StartSort( const vaRenderSelection::SortSettings& sortSettings ) const
 {
+    VA_MEMORY_TAG_SCOPE( "Rendering.DrawList" );
+    assert( m_frameArena == nullptr || m_drawList.size( ) == 0 || m_frameArena->IsFrameAlive( m_arenaFrame ) );   // list not Reset for too many frames - arena storage no longer valid!
     if( sortSettings.SortByDistanceToPoint && sortSettings.ReferencePoint.x == std::numeric_limits<float>::infinity( ) )
     {
         assert( false ); // you haven't updated sortSettings.ReferencePoint
@@ -787,6 +824,7 @@ void vaRenderMeshDrawList::StartSort( const vaRenderSelection::SortSettings& sor
 
 void vaRenderMeshDrawList::FinalizeSort( const vaRenderSelection::SortSettings & sortSettings ) const
 {
+    VA_MEMORY_TAG_SCOPE( "Rendering.DrawList" );
     // all good, we're sorted
     if( m_sortState.Sorted )
         return;
@@ -830,9 +868,169 @@ void vaRenderMeshDrawList::FinalizeSort( const vaRenderSelection::SortSettings &
     m_sortState.Sorted = true;
 }
 
+// only the standard vertex shader knows how to read per-instance transforms
+static bool SupportsAutoInstancing( const vaRenderMeshDrawList::Entry & entry )
+{
+    if( entry.Mesh == nullptr || entry.CustomHandler != nullptr )
+        return false;
+    const auto & vsStandard = entry.Material->GetShaderSettings( ).VS_Standard;
+    return vsStandard.second == "VS_Standard" && vsStandard.first == "vaRenderMesh.hlsl";
+}
+
+// decals and transparencies rely on draw order so they can only merge with the directly preceding draw
+static bool IsDrawOrderDependent( const vaRenderMeshDrawList::Entry & entry )
+{
+    vaLayerMode layerMode = entry.Material->GetMaterialSettings( ).LayerMode;
+    return layerMode == vaLayerMode::Decal || layerMode == vaLayerMode::Transparent;
+}
+
+static bool IsSameInstanceKey( const vaRenderMeshDrawList::Entry & a, const vaRenderMeshDrawList::Entry & b )
+{
+    return a.Mesh == b.Mesh && a.Material == b.Material && a.ShadingRate == b.ShadingRate && a.CustomColor == b.CustomColor;
+}
+
+static bool InstanceKeyLess( const vaRenderMeshDrawList::Entry & a, const vaRenderMeshDrawList::Entry & b )
+{
+    if( a.Mesh != b.Mesh )                  return std::less<vaRenderMesh*>( )( a.Mesh.get( ), b.Mesh.get( ) );
+    if( a.Material != b.Material )          return std::less<vaRenderMaterial*>( )( a.Material.get( ), b.Material.get( ) );
+    if( a.ShadingRate != b.ShadingRate )    return a.ShadingRate < b.ShadingRate;
+    if( a.CustomColor.x != b.CustomColor.x )  return a.CustomColor.x < b.CustomColor.x;
+    if( a.CustomColor.y != b.CustomColor.y )  return a.CustomColor.y < b.CustomColor.y;
+    if( a.CustomColor.z != b.CustomColor.z )  return a.CustomColor.z < b.CustomColor.z;
+    return a.CustomColor.w < b.CustomColor.w;
+}
+
+void vaRenderMeshDrawList::BuildBatches( bool mergeInstances, int maxInstancesPerBatch ) const
+{
+    VA_MEMORY_TAG_SCOPE( "Rendering.DrawList" );
+    assert( !m_sortState.Enabled || m_sortState.Sorted );
+
+    const int count = (int)m_drawList.size( );
+    auto & leaders  = m_batchState.Leaders;
+    auto & members  = m_batchState.Members;
+    auto & batches  = m_batchState.Batches;
+    leaders.resize( count );
+    members.resize( count );
+    batches.clear( );
+
+    auto entryAt = [this]( int position ) -> int { return ( m_sortState.Enabled ) ? ( m_sortState.SortedIndices[position] ) : ( position ); };
+
+    // every draw position points to the position of the first entry of its batch (which is always at or before it)
+    for( int p = 0; p < count; p++ )
+        leaders[p] = p;
+
+    if( mergeInstances && maxInstancesPerBatch > 1 )
+    {
+        // the depth buffer takes care of opaque/alpha tested ones so they can merge with any earlier draw with the same key: sort
+        // their positions by key (ties by position) and split the runs into batches; the batch is drawn at its first entry's position
+        int mergeableCount = 0;
+        for( int p = 0; p < count; p++ )
+        {
+            const Entry & entry = m_drawList[entryAt( p )];
+            if( SupportsAutoInstancing( entry ) && !IsDrawOrderDependent( entry ) )
+                members[mergeableCount++] = p;      // used as temporary storage here
+        }
+        std::sort( members.begin( ), members.begin( ) + mergeableCount, [this, &entryAt]( int pa, int pb )
+        {
+            const Entry & a = m_drawList[entryAt( pa )];
+            const Entry & b = m_drawList[entryAt( pb )];
+            if( !IsSameInstanceKey( a, b ) )
+                return InstanceKeyLess( a, b );
+            return pa < pb;
+        } );
+        for( int i = 0; i < mergeableCount; )
+        {
+            int leader = members[i];
+            int j = i + 1;
+            for( ; j < mergeableCount && ( j - i ) < maxInstancesPerBatch && IsSameInstanceKey( m_drawList[entryAt( members[j] )], m_drawList[entryAt( leader )] ); j++ )
+                leaders[members[j]] = leader;
+            i = j;
+        }
+
+        // order dependent ones only merge into runs of consecutive draws
+        int runLeader = -1, runLength = 0;
+        for( int p = 0; p < count; p++ )
+        {
+            const Entry & entry = m_drawList[entryAt( p )];
+            if( !SupportsAutoInstancing( entry ) || !IsDrawOrderDependent( entry ) )
+            {
+                runLeader = -1;
+                continue;
+            }
+            if( runLeader != -1 && runLength < maxInstancesPerBatch && IsSameInstanceKey( entry, m_drawList[entryAt( runLeader )] ) )
+            {
+                leaders[p] = runLeader;
+                runLength++;
+            }
+            else
+            {
+                runLeader = p;
+                runLength = 1;
+            }
+        }
+    }
+
+    // count batch sizes; leaders get replaced by -(batchIndex+1) as we go (a leader is always visited before its members)
+    for( int p = 0; p < count; p++ )
+    {
+        int batchIndex;
+        if( leaders[p] == p )
+        {
+            batchIndex = (int)batches.size( );
+            batches.push_back( { 0, 0 } );
+        }
+        else
+            batchIndex = -leaders[leaders[p]] - 1;
+        batches[batchIndex].second++;
+        leaders[p] = -batchIndex - 1;
+    }
+    int first = 0;
+    for( auto & batch : batches )
+    {
+        batch.first = first;
+        first += batch.second;
+        batch.second = 0;
+    }
+    for( int p = 0; p < count; p++ )
+    {
+        auto & batch = batches[-leaders[p] - 1];
+        members[batch.first + batch.second++] = entryAt( p );
+    }
+}
+
+// World and 'normal matrix' for an entry transform
+static void ComputeInstanceTransforms( const vaMatrix4x4 & transform, vaMatrix4x4 & outWorld, vaMatrix4x4 & outNormalWorld )
+{
+    outWorld = transform;
+
+    // since we now support non-uniform scale, we need the 'normal matrix' to keep normals correct 
+    // (for more info see : https://www.scratchapixel.com/lessons/mathematics-physics-for-computer-graphics/geometry/transforming-normals or http://www.lighthouse3d.com/tutorials/glsl-12-tutorial/the-normal-matrix/ )
+    outNormalWorld = transform.Inversed( nullptr, false ).Transposed( );
+    outNormalWorld.Row(0).w = 0.0f; outNormalWorld.Row(1).w = 0.0f; outNormalWorld.Row(2).w = 0.0f;
+    outNormalWorld.Row(3).x = 0.0f; outNormalWorld.Row(3).y = 0.0f; outNormalWorld.Row(3).z = 0.0f; outNormalWorld.Row(3).w = 1.0f;
+}
+
+// Rough fraction of the viewport covered by the mesh's (transformed) bounding sphere; it's only used to decide which shaders to compile first
+// so it ignores the frustum and overlaps
+static float EstimateScreenCoverage( const vaCameraBase & camera, const vaBoundingBox & localAABB, const vaMatrix4x4 & transform )
+{
+    vaVector3 center    = vaVector3::TransformCoord( localAABB.Center( ), transform );
+    float maxScale      = vaMath::Max( vaMath::Max( vaVector3( transform.m[0][0], transform.m[0][1], transform.m[0][2] ).Length( ), 
+                                                    vaVector3( transform.m[1][0], transform.m[1][1], transform.m[1][2] ).Length( ) ), 
+                                                    vaVector3( transform.m[2][0], transform.m[2][1], transform.m[2][2] ).Length( ) );
+    float radius        = 0.5f * localAABB.Size.Length( ) * maxScale;
+    float distance      = ( center - camera.GetPosition( ) ).Length( );
+    if( distance <= radius )
+        return 1.0f;
+    const vaMatrix4x4 & proj = camera.GetProjMatrix( );
+    // projected circle area over the NDC area (which is 2x2)
+    return vaMath::Min( 1.0f, (float)VA_PI * radius * radius * vaMath::Abs( proj.m[0][0] * proj.m[1][1] ) / ( 4.0f * distance * distance ) );
+}
+
 vaDrawResultFlags vaRenderMeshManager::Draw( vaSceneDrawContext & drawContext, const vaRenderMeshDrawList & list, vaBlendMode blendMode, vaRenderMeshDrawFlags drawFlags, 
     const vaRenderSelection::SortSettings & sortSettings, std::function< void( const vaRenderMeshDrawList::Entry & entry, const vaRenderMaterial & material, vaGraphicsItem & renderItem ) > globalCustomizer )
 {
+    VA_MEMORY_TAG_SCOPE( "Rendering.DrawList" );
     vaDrawResultFlags drawResults = vaDrawResultFlags::None;
 
     vaRenderMaterialShaderType shaderType;
@@ -851,7 +1049,7 @@ vaDrawResultFlags vaRenderMeshManager::Draw( vaSceneDrawContext & drawContext, c
     int ratechanges = 0;
     vaShadingRate lastrate = vaShadingRate::ShadingRate1X1;
 
-    bool reverseOrder           = false; //(drawFlags & vaRenderMeshDrawFlags::ReverseDrawOrder )        != 0;  <- this messes with the decals 
+    // bool reverseOrder           = false; //(drawFlags & vaRenderMeshDrawFlags::ReverseDrawOrder )        != 0;  <- this messes with the decals 
     // bool skipTransparencies     = (drawFlags & vaRenderMeshDrawFlags::SkipTransparencies    )   != 0;
     // bool skipNonTransparencies  = (drawFlags & vaRenderMeshDrawFlags::SkipNonTransparencies )   != 0;
     bool skipNonShadowCasters   = (drawFlags & vaRenderMeshDrawFlags::SkipNonShadowCasters  )   != 0;
@@ -900,14 +1098,18 @@ vaDrawResultFlags vaRenderMeshManager::Draw( vaSceneDrawContext & drawContext, c
         assert( listSortState.SortDistances.size() == list.Count() && listSortState.SortedIndices.size() == list.Count() );
     }
 
+    // a global customizer could modify each entry's render item differently so no instancing in that case
+    list.BuildBatches( m_autoInstancing && !globalCustomizer, SHADERINSTANCE_MAX_INSTANCES_PER_DRAW );
+    auto const & listBatchState = list.BatchState();
+
     drawContext.RenderDeviceContext.BeginItems( vaRenderTypeFlags::Graphics, &drawContext );
     vaGraphicsItem renderItem;
-    for( int i = 0; i < list.Count(); i++ )
+    for( int bi = 0; bi < (int)listBatchState.Batches.size(); bi++ )
     {
-        int ii = i;
-        if( list.m_sortState.Enabled )
-            ii = listSortState.SortedIndices[(reverseOrder)?(list.Count()-1-i):(i)];
-        const vaRenderMeshDrawList::Entry & entry = list[ii];
+        // all entries in a batch share everything but the transform, so the first one stands in for the rest
+        const int * batchMembers    = &listBatchState.Members[listBatchState.Batches[bi].first];
+        const int instanceCount     = listBatchState.Batches[bi].second;
+        const vaRenderMeshDrawList::Entry & entry = list[batchMembers[0]];
 
         if( entry.Mesh == nullptr ) 
         { VA_WARN( "vaRenderMeshManagerDX11::Draw - drawing empty mesh" ); continue; }
@@ -979,16 +1181,14 @@ vaDrawResultFlags vaRenderMeshManager::Draw( vaSceneDrawContext & drawContext, c
         // update per-instance constants
         ShaderInstanceConstants instanceConsts;
         {
-            instanceConsts.World = entry.Transform;
+            ComputeInstanceTransforms( entry.Transform, instanceConsts.World, instanceConsts.NormalWorld );
             
             // this means 'do not override'
             instanceConsts.CustomColor = entry.CustomColor;
 
-            // since we now support non-uniform scale, we need the 'normal matrix' to keep normals correct 
-            // (for more info see : https://www.scratchapixel.com/lessons/mathematics-physics-for-computer-graphics/geometry/transforming-normals or http://www.lighthouse3d.com/tutorials/glsl-12-tutorial/the-normal-matrix/ )
-            instanceConsts.NormalWorld = entry.Transform.Inversed( nullptr, false ).Transposed( );
-            instanceConsts.NormalWorld.Row(0).w = 0.0f; instanceConsts.NormalWorld.Row(1).w = 0.0f; instanceConsts.NormalWorld.Row(2).w = 0.0f;
-            instanceConsts.NormalWorld.Row(3).x = 0.0f; instanceConsts.NormalWorld.Row(3).y = 0.0f; instanceConsts.NormalWorld.Row(3).z = 0.0f; instanceConsts.NormalWorld.Row(3).w = 1.0f;
+            // instanced draws take transforms from the instance array
+            instanceConsts.InstanceArrayEnabled = ( instanceCount > 1 ) ? ( 1 ) : ( 0 );
+            instanceConsts.Dummy0 = instanceConsts.Dummy1 = instanceConsts.Dummy2 = 0.0f;
 
             //if( drawType != vaDrawType::ShadowmapGenerate )
             {
@@ -1016,7 +1216,16 @@ vaDrawResultFlags vaRenderMeshManager::Draw( vaSceneDrawContext & drawContext, c
             instanceConsts.CustomColor = vaVector4( highlight, highlight, highlight, 1.0f - highlight );
         }
 
-        if( !material->SetToRenderItem( renderItem, shaderType, drawResults ) )
+        // only needed to prioritize compiles if the material's shaders aren't ready; instanced batches cover the sum of their members
+        float screenCoverage = 0.0f;
+        if( vaShader::GetNumberOfCompilingShaders( ) > 0 )
+        {
+            for( int m = 0; m < instanceCount && screenCoverage < 1.0f; m++ )
+                screenCoverage += EstimateScreenCoverage( drawContext.Camera, mesh.GetAABB( ), list[batchMembers[m]].Transform );
+            screenCoverage = vaMath::Min( 1.0f, screenCoverage );
+        }
+
+        if( !material->SetToRenderItem( renderItem, shaderType, drawResults, screenCoverage ) )
         {
             // VA_WARN( "material->SetToRenderItem returns false, using default material instead" );
             material = nullptr;
@@ -1030,7 +1239,20 @@ vaDrawResultFlags vaRenderMeshManager::Draw( vaSceneDrawContext & drawContext, c
         renderItem.CullMode                 = materialSettings.FaceCull;
         renderItem.FrontCounterClockwise    = mesh.GetFrontFaceWindingOrder() == vaWindingOrder::CounterClockwise;
 
-        renderItem.SetDrawIndexed( subPart.IndexCount, subPart.IndexStart, 0 );
+        if( instanceCount > 1 )
+        {
+            assert( instanceCount <= SHADERINSTANCE_MAX_INSTANCES_PER_DRAW );
+            ShaderInstanceArrayConstants instanceArray;
+            for( int m = 0; m < instanceCount; m++ )
+                ComputeInstanceTransforms( list[batchMembers[m]].Transform, instanceArray.Instances[m].World, instanceArray.Instances[m].NormalWorld );
+            // only the used part of the array
+            m_instanceArrayBuffer.Update( drawContext.RenderDeviceContext, instanceArray, (uint32)( instanceCount * sizeof( ShaderInstanceTransform ) ) );
+            renderItem.ConstantBuffers[ SHADERINSTANCEARRAY_CONSTANTSBUFFERSLOT ] = m_instanceArrayBuffer;
+
+            renderItem.SetDrawIndexedInstanced( subPart.IndexCount, instanceCount, subPart.IndexStart, 0 );
+        }
+        else
+            renderItem.SetDrawIndexed( subPart.IndexCount, subPart.IndexStart, 0 );
 
         // apply overrides, if any
         if( entry.CustomHandler != nullptr )
@@ -240,7 +240,7 @@ namespace Vanilla
         };
 
     private:
-        vector< Entry >                                 m_drawList;
+        vaFrameArenaVector< Entry >                     m_drawList;
         //vaRenderSelectionCullFlags                      m_usedFilter;
 
         struct SortState
@@ -248,10 +248,23 @@ namespace Vanilla
             vaRenderSelection::SortSettings             SortSettings;
             bool                                        Enabled             = false;
             bool                                        Sorted              = false;
-            vector<pair<int,float>>                     SortDistances;      // first is a sort group - items first get sorted by it and then by distance
-            vector<int>                                 SortedIndices;
+            vaFrameArenaVector<pair<int,float>>         SortDistances;      // first is a sort group - items first get sorted by it and then by distance
+            vaFrameArenaVector<int>                     SortedIndices;
         } mutable                                       m_sortState;
 
+        // draw batches (in draw order); entries that only differ by transform get merged so they can be drawn with one instanced draw
+        struct BatchState
+        {
+            vaFrameArenaVector<int>                     Leaders;            // per draw position (temporary)
+            vaFrameArenaVector<int>                     Members;            // entry indices grouped by batch, in draw order within each batch
+            vaFrameArenaVector<pair<int,int>>           Batches;            // first index into Members and member count
+        } mutable                                       m_batchState;
+
+        // if set, all storage comes from the per-frame arena and the list must be Reset at least once every 'frames in flight' frames
+        vaFrameArena *                                  m_frameArena        = nullptr;
+        int64                                           m_arenaFrame        = -1;       // frame during which the current (arena) storage was allocated
+        int                                             m_lastCount         = 0;        // used to reserve the whole list in one go after a Reset
+
     public:
         // can be useful to deallocate / dispose of any per-list temporary storage, for ex. anything pointed to by the CustomPayload-s
         // only called once before m_drawList.clear() and then cleared as well!
@@ -259,13 +272,18 @@ namespace Vanilla
 
     public:
         vaRenderMeshDrawList( )                         { }
-        vaRenderMeshDrawList( const vaRenderMeshDrawList & src ) : m_drawList( src.m_drawList ) { }
+        explicit vaRenderMeshDrawList( vaFrameArena * frameArena ) { SetFrameArena( frameArena ); }
+        vaRenderMeshDrawList( const vaRenderMeshDrawList & src ) : m_drawList( src.m_drawList ) { }     // copies always use heap storage
         vaRenderMeshDrawList & operator = ( const vaRenderMeshDrawList & src ) { Reset(); m_drawList = src.m_drawList; return *this; }
         ~vaRenderMeshDrawList( )                        { Reset( ); }
 
     public:
-        void                                            Reset( )                            { Event_PreReset.Invoke( *this ); Event_PreReset.RemoveAll(); m_drawList.clear(); }
+        void                                            Reset( );
         int                                             Count( ) const                      { return (int)m_drawList.size(); }
+
+        // use the per-frame arena (usually vaRenderDevice::GetFrameArena) for all list storage, or nullptr for the heap; resets the list
+        void                                            SetFrameArena( vaFrameArena * frameArena );
+        vaFrameArena *                                  GetFrameArena( ) const              { return m_frameArena; }
         
         // shadingRateOffset gets combined with material shading rate offset and, based on material horizontal/vertical preference converted into actual shading rate 
         void                                            Insert( const std::shared_ptr<vaRenderMesh> & mesh, const std::shared_ptr<vaRenderMaterial> & material, const vaMatrix4x4 & transform, vaShadingRate shadingRate, const vaVector4 & customColor );
@@ -283,6 +301,10 @@ namespace Vanilla
         const SortState &                               SortState( ) const                  { return m_sortState; }
         void                                            StartSort( const vaRenderSelection::SortSettings & sortSettings ) const;
         void                                            FinalizeSort( const vaRenderSelection::SortSettings & sortSettings ) const;
+
+        // must be called after the sort; with mergeInstances false every entry ends up in its own batch
+        const BatchState &                              BatchState( ) const                 { return m_batchState; }
+        void                                            BuildBatches( bool mergeInstances, int maxInstancesPerBatch ) const;
     };
 
     struct vaRenderMeshCustomHandler
@@ -321,6 +343,11 @@ namespace Vanilla
 
         vaTypedConstantBufferWrapper< ShaderInstanceConstants, true >
                                                         m_constantsBuffer;
+        vaTypedConstantBufferWrapper< ShaderInstanceArrayConstants, true >
+                                                        m_instanceArrayBuffer;
+
+        // merge draw list entries that share mesh, material and shading rate into instanced draws (see vaRenderMeshDrawList::BuildBatches)
+        bool                                            m_autoInstancing        = true;
 
     public:
 //        friend class vaRenderingCore;
@@ -340,6 +367,9 @@ namespace Vanilla
 
         vaTT_Tracker< vaRenderMesh * > *                GetRenderMeshTracker( )                                                     { return &m_renderMeshes; }
 
+        bool                                            GetAutoInstancing( ) const                                                  { return m_autoInstancing; }
+        void                                            SetAutoInstancing( bool enable )                                            { m_autoInstancing = enable; }
+
         shared_ptr<vaRenderMesh>                        CreateRenderMesh( const vaGUID & uid = vaCore::GUIDCreate(), bool startTrackingUIDObject = true );
 
     protected:
@@ -360,6 +390,14 @@ namespace Vanilla
             return;
         }
         m_sortState.Sorted = false;
+
+        // arena storage gets dropped on every Reset so grab the whole of last frame's worth at once instead of growing into it
+        if( m_frameArena != nullptr && m_drawList.capacity( ) == 0 )
+        {
+            m_arenaFrame = m_frameArena->GetCurrentFrame( );
+            m_drawList.reserve( std::max( m_lastCount, 64 ) );
+        }
+        assert( m_frameArena == nullptr || m_frameArena->IsFrameAlive( m_arenaFrame ) );   // list not Reset for too many frames - arena storage no longer valid!
         
         m_drawList.push_back( Entry( mesh, material, transform, shadingRate, customColor ) );
     }
@@ -32,6 +32,8 @@
 
 #include "Rendering/vaTextureHelpers.h"
 
+#include "Rendering/vaIBL.h"
+
 #include "Core/System/vaFileTools.h"
 
 
@@ -105,10 +107,17 @@ vaRenderSelection::FilterSettings vaRenderSelection::FilterSettings::Environment
 {
     FilterSettings ret;
 
-    probeData;
-    // make a frustum cube based on
-    // probeData.Position
-    // probeData.ClipFar
+    // One omnidirectional cull shared by all 6 faces: together the 90deg face frustums cover exactly the axis aligned cube
+    // around the probe position with the far clip as its half-size, so that's what gets culled against (planes facing in).
+    const vaVector3 & center = probeData.Position;
+    const float halfSize = probeData.ClipFar;
+    ret.FrustumPlanes.resize( 6 );
+    ret.FrustumPlanes[0] = vaPlane::FromPointNormal( center + vaVector3( halfSize, 0, 0 ), vaVector3( -1,  0,  0 ) );
+    ret.FrustumPlanes[1] = vaPlane::FromPointNormal( center - vaVector3( halfSize, 0, 0 ), vaVector3(  1,  0,  0 ) );
+    ret.FrustumPlanes[2] = vaPlane::FromPointNormal( center + vaVector3( 0, halfSize, 0 ), vaVector3(  0, -1,  0 ) );
+    ret.FrustumPlanes[3] = vaPlane::FromPointNormal( center - vaVector3( 0, halfSize, 0 ), vaVector3(  0,  1,  0 ) );
+    ret.FrustumPlanes[4] = vaPlane::FromPointNormal( center + vaVector3( 0, 0, halfSize ), vaVector3(  0,  0, -1 ) );
+    ret.FrustumPlanes[5] = vaPlane::FromPointNormal( center - vaVector3( 0, 0, halfSize ), vaVector3(  0,  0,  1 ) );
 
     return ret;
 }
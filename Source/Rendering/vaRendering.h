@@ -24,6 +24,7 @@
 #include "Scene/vaCameraBase.h"
 
 #include "Core/vaUIDObject.h"
+#include "Core/vaFrameArena.h"
 
 #include "Core/Misc/vaProfiler.h"
 
@@ -226,9 +227,9 @@ namespace Vanilla
             DrawSimple,                   // Draw non-indexed, non-instanced primitives.
             // DrawAuto,                       // Draw geometry of an unknown size.
             DrawIndexed,                    // Draw indexed, non-instanced primitives.
-            // DrawIndexedInstanced,           // Draw indexed, instanced primitives.
+            DrawIndexedInstanced,           // Draw indexed, instanced primitives.
             // DrawIndexedInstancedIndirect,   // Draw indexed, instanced, GPU-generated primitives.
-            // DrawInstanced,                  // Draw non-indexed, instanced primitives.
+            DrawInstanced,                  // Draw non-indexed, instanced primitives.
             // DrawInstancedIndirect,          //  Draw instanced, GPU-generated primitives.
         };
 
@@ -297,6 +298,11 @@ namespace Vanilla
             uint32                              StartIndexLocation  = 0;    // (DrawIndexed only) The location of the first index read by the GPU from the index buffer.
             int32                               BaseVertexLocation  = 0;    // (DrawIndexed only) A value added to each index before reading a vertex from the vertex buffer.
         }                                   DrawIndexedParams;
+        struct DrawInstancedParams
+        {
+            uint32                              InstanceCount           = 1;    // (DrawInstanced and DrawIndexedInstanced only) Number of instances to draw; DrawSimpleParams/DrawIndexedParams are used for the rest.
+            uint32                              StartInstanceLocation   = 0;    // (DrawInstanced and DrawIndexedInstanced only) A value added to each index before reading per-instance data from a vertex buffer (doesn't affect SV_InstanceID).
+        }                                   DrawInstancedParams;
         
         // Callback to insert any API-specific overrides or additional tweaks
         std::function<bool( const vaGraphicsItem &, vaRenderDeviceContext & )> PreDrawHook;
@@ -305,6 +311,10 @@ namespace Vanilla
         // Helpers
         void                                SetDrawSimple( int vertexCount, int startVertexLocation )                           { this->DrawType = DrawType::DrawSimple; DrawSimpleParams.VertexCount = vertexCount; DrawSimpleParams.StartVertexLocation = startVertexLocation; }
         void                                SetDrawIndexed( uint indexCount, uint startIndexLocation, int baseVertexLocation )  { this->DrawType = DrawType::DrawIndexed; DrawIndexedParams.IndexCount = indexCount; DrawIndexedParams.StartIndexLocation = startIndexLocation; DrawIndexedParams.BaseVertexLocation = baseVertexLocation; }
+        void                                SetDrawInstanced( int vertexCount, int instanceCount, int startVertexLocation, int startInstanceLocation = 0 )
+                                                                                                                                { SetDrawSimple( vertexCount, startVertexLocation ); this->DrawType = DrawType::DrawInstanced; DrawInstancedParams.InstanceCount = instanceCount; DrawInstancedParams.StartInstanceLocation = startInstanceLocation; }
+        void                                SetDrawIndexedInstanced( uint indexCount, uint instanceCount, uint startIndexLocation, int baseVertexLocation, uint startInstanceLocation = 0 )
+                                                                                                                                { SetDrawIndexed( indexCount, startIndexLocation, baseVertexLocation ); this->DrawType = DrawType::DrawIndexedInstanced; DrawInstancedParams.InstanceCount = instanceCount; DrawInstancedParams.StartInstanceLocation = startInstanceLocation; }
     };
 
     struct vaComputeItem   // todo: maybe rename to vaShaderGraphicsItem?
@@ -370,12 +380,13 @@ namespace Vanilla
         {
             vaBoundingSphere                    BoundingSphereFrom      = vaBoundingSphere::Degenerate; //( { 0, 0, 0 }, 0.0f );
             vaBoundingSphere                    BoundingSphereTo        = vaBoundingSphere::Degenerate; //( { 0, 0, 0 }, 0.0f );
-            vector<vaPlane>                     FrustumPlanes;
+            vaFrameArenaVector<vaPlane>         FrustumPlanes;
 
             FilterSettings( ) { }
+            explicit FilterSettings( vaFrameArena * frameArena ) : FrustumPlanes( vaFrameArenaAllocator<vaPlane>( frameArena ) ) { }
 
-            // settings for frustum culling for a regular draw based on a given camera
-            static FilterSettings               FrustumCull( const vaCameraBase & camera ) { FilterSettings ret; ret.FrustumPlanes.resize( 6 ); camera.CalcFrustumPlanes( &ret.FrustumPlanes[0] ); return ret; }
+            // settings for frustum culling for a regular draw based on a given camera; pass the frame arena if only used within the frame
+            static FilterSettings               FrustumCull( const vaCameraBase & camera, vaFrameArena * frameArena = nullptr ) { FilterSettings ret( frameArena ); ret.FrustumPlanes.resize( 6 ); camera.CalcFrustumPlanes( &ret.FrustumPlanes[0] ); return ret; }
             static FilterSettings               ShadowmapCull( const vaShadowmap & shadowmap );
             static FilterSettings               EnvironmentProbeCull( const vaIBLProbeData & probeData );
         };
@@ -21,6 +21,8 @@
 
 #include "Rendering/vaRenderDevice.h"
 
+#include "Core/System/vaFileTools.h"
+
 using namespace Vanilla;
 
 std::vector<vaShader *> vaShader::s_allShaderList;
@@ -278,4 +280,32 @@ vaShaderManager::~vaShaderManager( )
 #endif
 }
 
+bool vaShaderManager::GetShaderFileTimeStamp( const wstring & filePath, int64 & outTimeStamp )
+{
+    wstring fullFileName = FindShaderFile( filePath );
+    if( fullFileName == L"" )
+    {
+        vaFileTools::EmbeddedFileData embeddedData = vaFileTools::EmbeddedFilesFind( wstring( L"shaders:\\" ) + filePath );
+        if( !embeddedData.HasContents( ) )
+            return false;
+        outTimeStamp = embeddedData.TimeStamp;
+        return true;
+    }
+
+    // maybe add some CRC64 here too? that would require reading contents of every file and every dependency which would be costly! 
+    return vaFileTools::GetFileLastWriteTime( fullFileName, outTimeStamp );
+}
+
+vaShaderFileDependency vaShaderManager::MakeFileDependency( const wstring & filePath )
+{
+    int64 timeStamp = 0;
+    if( !GetShaderFileTimeStamp( filePath, timeStamp ) )
+    {
+        VA_ERROR( L"Error trying to find shader file '%s'!", filePath.c_str() );
+        assert( false );
+        return vaShaderFileDependency( );
+    }
+    return vaShaderFileDependency( filePath, timeStamp );
+}
+
 
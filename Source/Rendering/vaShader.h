@@ -27,6 +27,8 @@
 
 #include "vaRendering.h"
 
+#include "vaShaderCache.h"
+
 #define LOG_COLORS_SHADERS  (vaVector4( 0.4f, 0.9f, 1.0f, 1.0f ) )
 
 #ifdef _DEBUG
@@ -112,6 +114,11 @@ namespace Vanilla
         virtual void                    Reload( );
         static void                     ReloadAll( );
         virtual void                    WaitFinishIfBackgroundCreateActive( );  // sometimes you absolutely need the shader and don't care about blocking / sync point
+        // true from CreateShaderFromXXX/Reload until the background compile finishes (regardless of whether it succeeded)
+        bool                            IsBackgroundCreateActive( ) const           { return m_backgroundCreationTask != nullptr && !vaBackgroundTaskManager::GetInstance().IsFinished( m_backgroundCreationTask ); }
+        // if the background compile hasn't started yet (all pool threads busy), make it start sooner; used to prioritize shaders needed by draws that cover a lot of the screen
+        // (render thread only, same as CreateShaderFromXXX)
+        void                            RaiseCompilePriority( float priority )      { vaBackgroundTaskManager::GetInstance().RaisePriority( m_backgroundCreationTask, priority ); }
 
         // IsEmpty returns 'true' before CreateShaderFromXXX is called at which point it returns 'false'; if multithreaded compilation is enabled, IsCreated will still return 'false' until the compile finishes
         virtual bool                    IsEmpty( )      { return m_state == State::Empty; } // if locked it's not empty!
@@ -337,6 +344,11 @@ namespace Vanilla
 
         virtual wstring     GetCacheStoragePath( ) const                                                    = 0;
 
+        // time stamp of a shader file found through the search paths or, failing that, of the embedded one
+        bool                GetShaderFileTimeStamp( const wstring & filePath, int64 & outTimeStamp );
+        // dependency with the current time stamp of the file; logs an error if it can't be found
+        vaShaderFileDependency MakeFileDependency( const wstring & filePath );
+
         Settings &          Settings( ) { return m_settings; }
     };
 
@@ -0,0 +1,578 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "vaShaderCache.h"
+
+#include "Core/System/vaFileTools.h"
+#include "Core/System/vaMemoryStream.h"
+#include "Core/Misc/vaXXHash.h"
+
+#include <algorithm>
+
+using namespace Vanilla;
+
+#ifdef NDEBUG
+#define           STILL_LOAD_FROM_CACHE_IF_ORIGINAL_FILE_MISSING
+#endif
+
+namespace
+{
+    static const uint32     c_indexMagic                = 0x49435356;   // 'VSCI'
+    static const uint32     c_indexVersion              = 1;
+    static const uint32     c_recordMagic               = 0x52435356;   // 'VSCR'
+    static const int64      c_removedOffset             = -1;
+    static const uint32     c_minIndexCapacity          = 256;
+    static const int        c_maxRecordDependencies     = 4096;         // anything above is a corrupted record
+
+    // not worth rewriting the blob file for less than this much dead space
+    static const int64      c_compactionMinDeadBytes    = 4 * 1024 * 1024;
+}
+
+uint64 vaShaderCacheKey::Hash( ) const
+{
+    uint64 hash = vaXXHash64::Compute( StringPart.data( ), (int64)StringPart.size( ) );
+    return ( hash != 0 ) ? ( hash ) : ( 1 );
+}
+
+void vaShaderCacheKey::Save( vaStream & outStream ) const
+{
+    outStream.WriteString( this->StringPart );
+}
+
+bool vaShaderCacheKey::Load( vaStream & inStream )
+{
+    return inStream.ReadString( this->StringPart );
+}
+
+bool vaShaderFileDependency::IsModified( const TimeStampResolver & resolver ) const
+{
+    int64 timeStamp = 0;
+    if( !resolver( this->FilePath, timeStamp ) )    // can't find the file?
+    {
+#ifdef STILL_LOAD_FROM_CACHE_IF_ORIGINAL_FILE_MISSING
+        return false;
+#else
+        VA_ERROR( L"Error trying to find shader file '%s'!", this->FilePath.c_str( ) );
+        return true;
+#endif
+    }
+    return this->ModifiedTimeDate != timeStamp;
+}
+
+void vaShaderFileDependency::Save( vaStream & outStream ) const
+{
+    outStream.WriteString( this->FilePath );
+    outStream.WriteValue<int64>( this->ModifiedTimeDate );
+}
+
+bool vaShaderFileDependency::Load( vaStream & inStream )
+{
+    return inStream.ReadString( this->FilePath ) && inStream.ReadValue<int64>( this->ModifiedTimeDate );
+}
+
+bool vaShaderCacheStore::Open( const wstring & basePath )
+{
+    Close( );
+
+    std::unique_lock<mutex> lock( m_mutex );
+
+    m_indexPath = basePath + L".index";
+    m_blobPath  = basePath + L".blobs";
+
+    wstring cacheDir;
+    vaFileTools::SplitPath( basePath, &cacheDir, nullptr, nullptr );
+    if( cacheDir != L"" )
+        vaFileTools::EnsureDirectoryExists( cacheDir );
+
+    if( !m_blobFile.Open( m_blobPath, FileCreationMode::OpenOrCreate, FileAccessMode::ReadWrite ) )
+    {
+        VA_LOG_WARNING( L"vaShaderCacheStore - unable to open '%s', shader cache disabled", m_blobPath.c_str( ) );
+        return false;
+    }
+    m_blobFileLength = m_blobFile.GetLength( );
+
+    if( MapIndexInternal( ) )
+    {
+        m_entryCount    = (int)m_indexHeader->EntryCount;
+        m_liveBytes     = m_indexHeader->LiveBytes;
+    }
+    else
+    {
+        if( m_blobFileLength > 0 || vaFileTools::FileExists( m_indexPath ) )
+            VA_WARN( "Shader cache index missing, corrupted or from an older version, resetting and starting from scratch!" );
+        if( !ResetFilesInternal( ) )
+        {
+            CloseFilesInternal( );
+            return false;
+        }
+    }
+
+    m_isOpen = true;
+    return true;
+}
+
+void vaShaderCacheStore::Close( )
+{
+    std::unique_lock<std::mutex> compactionLock( m_compactionMutex );
+    std::unique_lock<mutex> lock( m_mutex );
+    if( !m_isOpen )
+        return;
+
+    if( !m_overlay.empty( ) || m_indexHeader == nullptr )
+    {
+        std::vector<IndexSlot> liveSlots;
+        CollectLiveSlotsInternal( liveSlots );
+        WriteIndexInternal( liveSlots );
+    }
+    CloseFilesInternal( );
+    m_overlay.clear( );
+    m_loadedCount = 0;
+    m_isOpen = false;
+}
+
+bool vaShaderCacheStore::Flush( )
+{
+    std::unique_lock<std::mutex> compactionLock( m_compactionMutex );
+    std::unique_lock<mutex> lock( m_mutex );
+    if( !m_isOpen )
+        return false;
+    if( m_overlay.empty( ) && m_indexHeader != nullptr )
+        return true;
+
+    std::vector<IndexSlot> liveSlots;
+    CollectLiveSlotsInternal( liveSlots );
+    return WriteIndexInternal( liveSlots );
+}
+
+void vaShaderCacheStore::Clear( )
+{
+    std::unique_lock<std::mutex> compactionLock( m_compactionMutex );
+    std::unique_lock<mutex> lock( m_mutex );
+    if( m_isOpen && !ResetFilesInternal( ) )
+    {
+        CloseFilesInternal( );
+        m_isOpen = false;
+    }
+}
+
+shared_ptr<const vaShaderCacheStore::Entry> vaShaderCacheStore::Find( const vaShaderCacheKey & key, const vaShaderFileDependency::TimeStampResolver & resolver, bool & outFoundButModified )
+{
+    outFoundButModified = false;
+    const uint64 keyHash = key.Hash( );
+
+    shared_ptr<const Entry> entry;
+    IndexSlot slot;
+    {
+        std::unique_lock<mutex> lock( m_mutex );
+        if( !m_isOpen )
+            return nullptr;
+
+        if( !FindSlotInternal( keyHash, slot ) )
+            return nullptr;
+
+        entry = ReadRecordInternal( slot, key );
+        if( entry == nullptr )
+        {
+            // hash collision or a damaged record - drop it so that the caller's AddToCache can replace it
+            m_overlay[keyHash] = { keyHash, c_removedOffset, 0, 0 };
+            m_entryCount--;
+            m_liveBytes -= slot.Size;
+            if( m_compactionActive )
+                m_removedDuringCompaction.push_back( keyHash );
+            return nullptr;
+        }
+        m_loadedCount++;
+    }
+
+    // dependency checks hit the file system so they're done outside of the lock
+    for( const vaShaderFileDependency & dependency : entry->Dependencies )
+    {
+        if( !dependency.IsModified( resolver ) )
+            continue;
+
+        outFoundButModified = true;
+
+        std::unique_lock<mutex> lock( m_mutex );
+        IndexSlot currentSlot;
+        // only remove if no-one has replaced (or compacted) it in the meantime
+        if( FindSlotInternal( keyHash, currentSlot ) && currentSlot.Offset == slot.Offset )
+        {
+            m_overlay[keyHash] = { keyHash, c_removedOffset, 0, 0 };
+            m_entryCount--;
+            m_liveBytes -= currentSlot.Size;
+            if( m_compactionActive )
+                m_removedDuringCompaction.push_back( keyHash );
+        }
+        return nullptr;
+    }
+    return entry;
+}
+
+void vaShaderCacheStore::Add( const vaShaderCacheKey & key, const std::vector<vaShaderFileDependency> & dependencies, const void * blobData, int64 blobSize )
+{
+    assert( blobSize > 0 && blobSize < INT_MAX );
+    const uint64 keyHash = key.Hash( );
+
+    // build the record before taking the lock
+    vaMemoryStream record( (int64)0, blobSize + 1024 );
+    record.WriteValue<uint32>( c_recordMagic );
+    record.WriteValue<uint32>( 0 );                                 // total record size, patched below
+    record.WriteValue<uint64>( keyHash );
+    key.Save( record );
+    record.WriteValue<int32>( (int32)dependencies.size( ) );
+    for( const vaShaderFileDependency & dependency : dependencies )
+        dependency.Save( record );
+    record.WriteValue<int32>( (int32)blobSize );
+    record.Write( blobData, blobSize );
+    const uint32 recordSize = (uint32)record.GetLength( );
+    memcpy( record.GetBuffer( ) + sizeof( uint32 ), &recordSize, sizeof( recordSize ) );
+
+    std::unique_lock<mutex> lock( m_mutex );
+    if( !m_isOpen )
+        return;
+
+    // Already in? can happen with parallel compilation - just keep the existing one
+    IndexSlot slot;
+    if( FindSlotInternal( keyHash, slot ) )
+        return;
+
+    const int64 offset = m_blobFileLength;
+    if( !m_blobFile.WriteAt( offset, record.GetBuffer( ), recordSize ) )
+    {
+        VA_LOG_WARNING( L"vaShaderCacheStore - unable to write to '%s'", m_blobPath.c_str( ) );
+        return;
+    }
+    m_blobFileLength += recordSize;
+
+    m_overlay[keyHash]  = { keyHash, offset, recordSize, 0 };
+    m_entryCount++;
+    m_liveBytes += recordSize;
+}
+
+bool vaShaderCacheStore::NeedsCompaction( ) const
+{
+    std::unique_lock<mutex> lock( m_mutex );
+    const int64 deadBytes = m_blobFileLength - m_liveBytes;
+    return m_isOpen && deadBytes >= c_compactionMinDeadBytes && deadBytes > m_liveBytes;
+}
+
+bool vaShaderCacheStore::Compact( )
+{
+    std::unique_lock<std::mutex> compactionLock( m_compactionMutex );
+
+    std::vector<IndexSlot> snapshot;
+    int64 snapshotEnd = 0;
+    {
+        std::unique_lock<mutex> lock( m_mutex );
+        if( !m_isOpen )
+            return false;
+        CollectLiveSlotsInternal( snapshot );
+        snapshotEnd         = m_blobFileLength;
+        m_compactionActive  = true;
+        m_removedDuringCompaction.clear( );
+    }
+
+    // Copy the snapshot without holding m_mutex: Close/Flush/Clear can't touch the files while we hold m_compactionMutex,
+    // Add only appends past snapshotEnd and positional reads don't disturb it.
+    const wstring tempBlobPath = m_blobPath + L".tmp";
+    vaFileStream newBlobFile;
+    bool success = newBlobFile.Open( tempBlobPath, FileCreationMode::Create, FileAccessMode::ReadWrite );
+
+    std::sort( snapshot.begin( ), snapshot.end( ), [ ]( const IndexSlot & a, const IndexSlot & b ) { return a.Offset < b.Offset; } );
+    std::unordered_map<uint64, IndexSlot> compacted;
+    compacted.reserve( snapshot.size( ) );
+    std::vector<uint8> buffer;
+    int64 newLength = 0;
+    for( size_t i = 0; success && i < snapshot.size( ); i++ )
+    {
+        IndexSlot slot = snapshot[i];
+        buffer.resize( slot.Size );
+        success = m_blobFile.ReadAt( slot.Offset, buffer.data( ), slot.Size ) && newBlobFile.Write( buffer.data( ), slot.Size );
+        slot.Offset = newLength;
+        newLength += slot.Size;
+        compacted[slot.KeyHash] = slot;
+    }
+
+    std::unique_lock<mutex> lock( m_mutex );
+    m_compactionActive = false;
+
+    if( success )
+    {
+        // catch up with what happened while we were copying
+        for( uint64 keyHash : m_removedDuringCompaction )
+            compacted.erase( keyHash );
+        for( const auto & it : m_overlay )
+        {
+            IndexSlot slot = it.second;
+            if( slot.Offset < snapshotEnd )
+                continue;
+            buffer.resize( slot.Size );
+            if( !m_blobFile.ReadAt( slot.Offset, buffer.data( ), slot.Size ) || !newBlobFile.Write( buffer.data( ), slot.Size ) )
+            {
+                success = false;
+                break;
+            }
+            slot.Offset = newLength;
+            newLength += slot.Size;
+            compacted[slot.KeyHash] = slot;
+        }
+    }
+    m_removedDuringCompaction.clear( );
+    newBlobFile.Close( );
+
+    if( !success )
+    {
+        vaFileTools::DeleteFile( tempBlobPath );
+        VA_LOG_WARNING( L"vaShaderCacheStore - compaction of '%s' failed", m_blobPath.c_str( ) );
+        return false;
+    }
+
+    m_blobFile.Close( );
+    vaFileTools::DeleteFile( m_blobPath );
+    if( !vaFileTools::MoveFile( tempBlobPath, m_blobPath ) || !m_blobFile.Open( m_blobPath, FileCreationMode::OpenOrCreate, FileAccessMode::ReadWrite ) || m_blobFile.GetLength( ) != newLength )
+    {
+        VA_LOG_WARNING( L"vaShaderCacheStore - unable to replace '%s' after compaction, resetting", m_blobPath.c_str( ) );
+        if( !ResetFilesInternal( ) )
+        {
+            CloseFilesInternal( );
+            m_isOpen = false;
+        }
+        return false;
+    }
+    m_blobFileLength = newLength;
+
+    std::vector<IndexSlot> liveSlots;
+    liveSlots.reserve( compacted.size( ) );
+    for( const auto & it : compacted )
+        liveSlots.push_back( it.second );
+    return WriteIndexInternal( liveSlots );
+}
+
+vaShaderCacheStore::Statistics vaShaderCacheStore::GetStatistics( ) const
+{
+    std::unique_lock<mutex> lock( m_mutex );
+    Statistics stats;
+    stats.EntryCount        = m_entryCount;
+    stats.LoadedEntryCount  = m_loadedCount;
+    stats.BlobFileSize      = m_blobFileLength;
+    stats.LiveBytes         = m_liveBytes;
+    return stats;
+}
+
+bool vaShaderCacheStore::FindSlotInternal( uint64 keyHash, IndexSlot & outSlot ) const
+{
+    m_mutex.assert_locked_by_caller( );
+
+    auto it = m_overlay.find( keyHash );
+    if( it != m_overlay.end( ) )
+    {
+        if( it->second.Offset == c_removedOffset )
+            return false;
+        outSlot = it->second;
+        return true;
+    }
+
+    if( m_indexSlots == nullptr )
+        return false;
+
+    // linear probing; the table is always at most half full so there's always an empty slot to stop at
+    const uint32 mask = m_indexHeader->Capacity - 1;
+    for( uint32 i = (uint32)keyHash & mask, probes = 0; probes < m_indexHeader->Capacity; i = ( i + 1 ) & mask, probes++ )
+    {
+        const IndexSlot & slot = m_indexSlots[i];
+        if( slot.KeyHash == 0 )
+            return false;
+        if( slot.KeyHash == keyHash )
+        {
+            outSlot = slot;
+            return true;
+        }
+    }
+    return false;
+}
+
+void vaShaderCacheStore::CollectLiveSlotsInternal( std::vector<IndexSlot> & outSlots ) const
+{
+    m_mutex.assert_locked_by_caller( );
+
+    outSlots.clear( );
+    outSlots.reserve( m_entryCount );
+    if( m_indexSlots != nullptr )
+    {
+        for( uint32 i = 0; i < m_indexHeader->Capacity; i++ )
+            if( m_indexSlots[i].KeyHash != 0 && m_overlay.find( m_indexSlots[i].KeyHash ) == m_overlay.end( ) )
+                outSlots.push_back( m_indexSlots[i] );
+    }
+    for( const auto & it : m_overlay )
+        if( it.second.Offset != c_removedOffset )
+            outSlots.push_back( it.second );
+}
+
+bool vaShaderCacheStore::WriteIndexInternal( const std::vector<IndexSlot> & liveSlots )
+{
+    m_mutex.assert_locked_by_caller( );
+
+    uint32 capacity = c_minIndexCapacity;
+    while( (size_t)capacity < liveSlots.size( ) * 2 )
+        capacity *= 2;
+
+    std::vector<IndexSlot> table( capacity, IndexSlot{ 0, 0, 0, 0 } );
+    int64 liveBytes = 0;
+    for( const IndexSlot & slot : liveSlots )
+    {
+        uint32 i = (uint32)slot.KeyHash & ( capacity - 1 );
+        while( table[i].KeyHash != 0 )
+            i = ( i + 1 ) & ( capacity - 1 );
+        table[i] = slot;
+        liveBytes += slot.Size;
+    }
+
+    IndexHeader header;
+    header.Magic            = c_indexMagic;
+    header.Version          = c_indexVersion;
+    header.Capacity         = capacity;
+    header.EntryCount       = (uint32)liveSlots.size( );
+    header.BlobFileLength   = m_blobFileLength;
+    header.LiveBytes        = liveBytes;
+
+    // write to a temp file first so that a crash half-way doesn't leave a broken index behind
+    const wstring tempIndexPath = m_indexPath + L".tmp";
+    {
+        vaFileStream outFile;
+        if( !outFile.Open( tempIndexPath, FileCreationMode::Create ) || !outFile.Write( &header, sizeof( header ) ) || !outFile.Write( table.data( ), sizeof( IndexSlot ) * capacity ) )
+        {
+            VA_LOG_WARNING( L"vaShaderCacheStore - unable to write '%s'", tempIndexPath.c_str( ) );
+            return false;
+        }
+    }
+
+    // the old index is still mapped - has to go before it can be replaced
+    m_indexFile.Close( );
+    m_indexHeader   = nullptr;
+    m_indexSlots    = nullptr;
+    vaFileTools::DeleteFile( m_indexPath );
+    bool success = vaFileTools::MoveFile( tempIndexPath, m_indexPath ) && MapIndexInternal( );
+
+    m_overlay.clear( );
+    m_entryCount    = (int)liveSlots.size( );
+    m_liveBytes     = liveBytes;
+
+    if( !success )
+    {
+        // can keep on working from the overlay, it'll get written again on the next Flush/Close
+        for( const IndexSlot & slot : liveSlots )
+            m_overlay[slot.KeyHash] = slot;
+        VA_LOG_WARNING( L"vaShaderCacheStore - unable to replace '%s'", m_indexPath.c_str( ) );
+    }
+    return success;
+}
+
+bool vaShaderCacheStore::MapIndexInternal( )
+{
+    m_indexHeader   = nullptr;
+    m_indexSlots    = nullptr;
+    if( !vaFileTools::FileExists( m_indexPath ) || !m_indexFile.Open( m_indexPath, FileCreationMode::Open, FileAccessMode::Read ) )
+        return false;
+
+    const int64 fileLength = m_indexFile.GetLength( );
+    const uint8 * mapped = ( fileLength >= (int64)sizeof( IndexHeader ) ) ? ( (const uint8 *)m_indexFile.MapForReading( ) ) : ( nullptr );
+    const IndexHeader * header = (const IndexHeader *)mapped;
+
+    bool valid = header != nullptr
+        && header->Magic == c_indexMagic && header->Version == c_indexVersion
+        && header->Capacity >= c_minIndexCapacity && ( header->Capacity & ( header->Capacity - 1 ) ) == 0
+        && fileLength == (int64)sizeof( IndexHeader ) + (int64)sizeof( IndexSlot ) * header->Capacity
+        && (uint64)header->EntryCount * 2 <= header->Capacity
+        && header->BlobFileLength <= m_blobFileLength && header->LiveBytes <= header->BlobFileLength;
+    if( !valid )
+    {
+        m_indexFile.Close( );
+        return false;
+    }
+
+    m_indexHeader   = header;
+    m_indexSlots    = (const IndexSlot *)( mapped + sizeof( IndexHeader ) );
+    return true;
+}
+
+void vaShaderCacheStore::CloseFilesInternal( )
+{
+    m_indexFile.Close( );
+    m_indexHeader   = nullptr;
+    m_indexSlots    = nullptr;
+    m_blobFile.Close( );
+    m_blobFileLength = 0;
+}
+
+bool vaShaderCacheStore::ResetFilesInternal( )
+{
+    m_mutex.assert_locked_by_caller( );
+
+    CloseFilesInternal( );
+    m_overlay.clear( );
+    m_loadedCount   = 0;
+    m_entryCount    = 0;
+    m_liveBytes     = 0;
+
+    if( !m_blobFile.Open( m_blobPath, FileCreationMode::Create, FileAccessMode::ReadWrite ) )
+    {
+        VA_LOG_WARNING( L"vaShaderCacheStore - unable to create '%s'", m_blobPath.c_str( ) );
+        return false;
+    }
+    return WriteIndexInternal( std::vector<IndexSlot>( ) );
+}
+
+shared_ptr<const vaShaderCacheStore::Entry> vaShaderCacheStore::ReadRecordInternal( const IndexSlot & slot, const vaShaderCacheKey & key )
+{
+    m_mutex.assert_locked_by_caller( );
+
+    if( slot.Size < sizeof( uint32 ) * 2 + sizeof( uint64 ) || slot.Offset + (int64)slot.Size > m_blobFileLength )
+        return nullptr;
+
+    std::vector<uint8> buffer( slot.Size );
+    if( !m_blobFile.ReadAt( slot.Offset, buffer.data( ), slot.Size ) )
+        return nullptr;
+
+    vaMemoryStream record( buffer.data( ), (int64)buffer.size( ) );
+    uint32 magic = 0, recordSize = 0;
+    uint64 keyHash = 0;
+    vaShaderCacheKey storedKey;
+    if( !record.ReadValue<uint32>( magic ) || !record.ReadValue<uint32>( recordSize ) || !record.ReadValue<uint64>( keyHash ) || !storedKey.Load( record ) )
+        return nullptr;
+    if( magic != c_recordMagic || recordSize != slot.Size || keyHash != slot.KeyHash || !( storedKey == key ) )
+        return nullptr;
+
+    shared_ptr<Entry> entry = std::make_shared<Entry>( );
+    int32 dependencyCount = 0;
+    if( !record.ReadValue<int32>( dependencyCount ) || dependencyCount < 0 || dependencyCount > c_maxRecordDependencies )
+        return nullptr;
+    entry->Dependencies.resize( dependencyCount );
+    for( vaShaderFileDependency & dependency : entry->Dependencies )
+        if( !dependency.Load( record ) )
+            return nullptr;
+
+    int32 blobSize = 0;
+    if( !record.ReadValue<int32>( blobSize ) || blobSize <= 0 || blobSize > record.GetLength( ) - record.GetPosition( ) )
+        return nullptr;
+    entry->Blob.resize( blobSize );
+    if( !record.Read( entry->Blob.data( ), blobSize ) )
+        return nullptr;
+
+    return entry;
+}
@@ -0,0 +1,177 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2019, Intel Corporation
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+// documentation files (the "Software"), to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to the following conditions:
+// The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+// the Software.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Author(s):  Filip Strugar (filip.strugar@intel.com)
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Core/vaCoreIncludes.h"
+
+#include "Core/System/vaFileStream.h"
+
+#include <unordered_map>
+
+namespace Vanilla
+{
+    // Everything that affects the compiled shader output (macros, shader model, entry point, file, input layout, ...),
+    // filled in by vaShaderDX11/vaShaderDX12::CreateCacheKey.
+    struct vaShaderCacheKey
+    {
+        std::string                 StringPart;
+
+        bool                        operator == ( const vaShaderCacheKey & cmp ) const  { return this->StringPart == cmp.StringPart; }
+        bool                        operator < ( const vaShaderCacheKey & cmp ) const   { return this->StringPart < cmp.StringPart; }
+        bool                        operator >( const vaShaderCacheKey & cmp ) const    { return this->StringPart > cmp.StringPart; }
+
+        // never 0 (0 marks an empty vaShaderCacheStore index slot)
+        uint64                      Hash( ) const;
+
+        void                        Save( vaStream & outStream ) const;
+        bool                        Load( vaStream & inStream );
+    };
+
+    // A source (or embedded) file that a compiled shader depends on and its time stamp at the time of compilation.
+    struct vaShaderFileDependency
+    {
+        // Returns false if the file can't be found; time stamps are opaque and only ever compared for equality. The
+        // shader managers resolve through their search paths and embedded files (see vaShaderManager::GetShaderFileTimeStamp).
+        typedef std::function<bool( const wstring & filePath, int64 & outTimeStamp )>   TimeStampResolver;
+
+        std::wstring                FilePath;
+        int64                       ModifiedTimeDate    = 0;
+
+        vaShaderFileDependency( ) { }
+        vaShaderFileDependency( const wstring & filePath, int64 modifiedTimeDate ) : FilePath( filePath ), ModifiedTimeDate( modifiedTimeDate ) { }
+
+        bool                        IsModified( const TimeStampResolver & resolver ) const;
+
+        void                        Save( vaStream & outStream ) const;
+        bool                        Load( vaStream & inStream );
+    };
+
+    // Persistent compiled shader cache, shared by the DX11 and DX12 shader managers. Two files on disk:
+    //  - '<path>.blobs' is append-only: every Add writes one self-contained record (key, dependencies, compiled blob);
+    //  - '<path>.index' is an open addressing hash table (key hash -> record offset & size) that gets memory mapped on
+    //    Open, so opening costs the same regardless of how many shaders are cached.
+    // Records are read and parsed on Find and handed out without being retained - the caller owns the only copy (shader
+    // managers create the shader object from it and drop it), so the store never holds compiled blobs. Changes since the index was last written are kept in a small
+    // in-memory overlay until Flush/Close. Records that went stale (dependency modified) or got replaced stay in the
+    // blob file as dead space until Compact rewrites it - NeedsCompaction tells when it's worth it and Compact can run
+    // on a background thread while Find/Add keep working.
+    class vaShaderCacheStore
+    {
+    public:
+        struct Entry
+        {
+            std::vector<vaShaderFileDependency>     Dependencies;
+            std::vector<uint8>                      Blob;
+        };
+
+        struct Statistics
+        {
+            int                         EntryCount          = 0;
+            int                         LoadedEntryCount    = 0;        // records read from the disk during this session
+            int64                       BlobFileSize        = 0;
+            int64                       LiveBytes           = 0;        // BlobFileSize - LiveBytes is dead space, see NeedsCompaction
+        };
+
+    private:
+        struct IndexHeader
+        {
+            uint32                      Magic;
+            uint32                      Version;
+            uint32                      Capacity;                       // slot count, power of 2
+            uint32                      EntryCount;
+            int64                       BlobFileLength;                 // blob file length at the time the index was written
+            int64                       LiveBytes;
+        };
+
+        struct IndexSlot
+        {
+            uint64                      KeyHash;                        // 0 for empty slots
+            int64                       Offset;                         // c_removedOffset in the overlay for removed entries
+            uint32                      Size;
+            uint32                      Padding;
+        };
+
+        mutable mutex                   m_mutex;
+        std::mutex                      m_compactionMutex;              // taken for the whole Compact; Flush/Close/Clear wait on it too
+
+        bool                            m_isOpen            = false;
+        wstring                         m_indexPath;
+        wstring                         m_blobPath;
+
+        vaFileStream                    m_indexFile;
+        const IndexHeader *             m_indexHeader       = nullptr;  // points into the mapped index file
+        const IndexSlot *               m_indexSlots        = nullptr;
+
+        vaFileStream                    m_blobFile;
+        int64                           m_blobFileLength    = 0;
+
+        int                             m_entryCount        = 0;
+        int64                           m_liveBytes         = 0;
+
+        std::unordered_map<uint64, IndexSlot>                       m_overlay;      // added or removed since the index was written
+        int                             m_loadedCount       = 0;
+
+        bool                            m_compactionActive  = false;
+        std::vector<uint64>             m_removedDuringCompaction;
+
+    public:
+        vaShaderCacheStore( ) { }
+        ~vaShaderCacheStore( )          { Close( ); }
+
+        vaShaderCacheStore( const vaShaderCacheStore & ) = delete;
+        vaShaderCacheStore & operator = ( const vaShaderCacheStore & ) = delete;
+
+    public:
+        // opens or creates '<basePath>.index' and '<basePath>.blobs'; invalid or old version files get discarded
+        bool                            Open( const wstring & basePath );
+        // writes the index and closes the files
+        void                            Close( );
+        bool                            IsOpen( ) const                     { std::unique_lock<mutex> lock( m_mutex ); return m_isOpen; }
+
+        // writes the index (the blob file is always up to date)
+        bool                            Flush( );
+
+        // drops all entries and truncates both files
+        void                            Clear( );
+
+        // reads the record from the disk; returns nullptr if not found or if any of the dependencies got modified - in
+        // the latter case the entry is removed and outFoundButModified is set
+        shared_ptr<const Entry>         Find( const vaShaderCacheKey & key, const vaShaderFileDependency::TimeStampResolver & resolver, bool & outFoundButModified );
+
+        // if the key is already in, the existing entry is kept (can happen with parallel compilation)
+        void                            Add( const vaShaderCacheKey & key, const std::vector<vaShaderFileDependency> & dependencies, const void * blobData, int64 blobSize );
+
+        bool                            NeedsCompaction( ) const;
+
+        // rewrites the blob file with only the live records and writes a fresh index
+        bool                            Compact( );
+
+        Statistics                      GetStatistics( ) const;
+
+    private:
+        bool                            FindSlotInternal( uint64 keyHash, IndexSlot & outSlot ) const;
+        void                            CollectLiveSlotsInternal( std::vector<IndexSlot> & outSlots ) const;
+        bool                            WriteIndexInternal( const std::vector<IndexSlot> & liveSlots );
+        bool                            MapIndexInternal( );
+        void                            CloseFilesInternal( );
+        bool                            ResetFilesInternal( );
+        shared_ptr<const Entry>         ReadRecordInternal( const IndexSlot & slot, const vaShaderCacheKey & key );
+    };
+}
@@ -359,6 +359,14 @@ void vaTexture::SetNextCreateFastClearDSV( vaResourceFormat format, float clearD
 
 }
 
+shared_ptr<vaTexture> vaTexture::TryCompress( vaTextureCompressionPreset preset )
+{
+    shared_ptr<vaTextureCompressionJob> job = CreateCompressionJob( preset );
+    if( job == nullptr || !job->Encode( ) )
+        return nullptr;
+    return job->Finish( );
+}
+
 shared_ptr<vaTexture> vaTexture::TryCreateMIPs( vaRenderDeviceContext& renderContext, shared_ptr<vaTexture> & texture )
 {
     // if( texture->GetMipLevels( ) != 1 )  // already has MIPs? Do nothing!
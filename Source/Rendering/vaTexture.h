@@ -87,6 +87,18 @@ namespace Vanilla
         MaxValue
     };
 
+    // BC encoder quality/speed tradeoff used by vaTexture::TryCompress and vaTextureBatchCompressor
+    enum class vaTextureCompressionPreset : int32
+    {
+        Fast                        = 0,    // BC7 mode 6 only, uniform BC1-3 weighting - for quick iteration
+        Balanced                    = 1,    // encoder defaults (BC7 skips the 3-subset modes 0 and 2)
+        HighQuality                 = 2,    // all BC7 modes, dithered BC1-3 - for final asset packs
+
+        MaxValue
+    };
+
+    class vaTextureCompressionJob;
+
     BITFLAG_ENUM_CLASS_HELPER( vaResourceAccessFlags );
     BITFLAG_ENUM_CLASS_HELPER( vaTextureLoadFlags );
     BITFLAG_ENUM_CLASS_HELPER( vaTextureFlags );
@@ -271,8 +283,13 @@ namespace Vanilla
         // virtual void                        UpdateSubresource( vaRenderDeviceContext & renderContext, int dstSubresourceIndex, const vaBoxi & dstBox, void * srcData, int srcDataRowPitch, int srcDataDepthPitch = 0 ) = 0;
         virtual void                        ResolveSubresource( vaRenderDeviceContext & renderContext, const shared_ptr<vaTexture> & dstResource, uint dstSubresource, uint srcSubresource, vaResourceFormat format = vaResourceFormat::Automatic ) = 0;
 
-        // Will try to create a BC5-6-7 compressed copy of the texture to the best of its abilities or if it can't then return nullptr; very rudimentary at the moment, future upgrades required.
-        virtual shared_ptr<vaTexture>       TryCompress( )                                                                                                              = 0;
+        // Will try to create a BC4-5-7 compressed copy of the texture to the best of its abilities or if it can't then return nullptr; blocks are encoded on all 
+        // vaParallel workers but the call still blocks until done - see vaTextureBatchCompressor for compressing many textures in the background.
+        shared_ptr<vaTexture>               TryCompress( vaTextureCompressionPreset preset = vaTextureCompressionPreset::Balanced );
+
+        // First (render thread) step of compression: picks the destination format and reads back the contents; the returned job can then be encoded on any 
+        // thread. Returns nullptr if already compressed or the format/contents type combination isn't supported.
+        virtual shared_ptr<vaTextureCompressionJob> CreateCompressionJob( vaTextureCompressionPreset preset )                                                          = 0;
 
         static shared_ptr<vaTexture>        TryCreateMIPs( vaRenderDeviceContext & renderContext, shared_ptr<vaTexture> & texture );
 
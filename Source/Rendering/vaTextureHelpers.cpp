@@ -772,3 +772,72 @@ bool vaTextureTools::UITickImGui( const shared_ptr<vaTexture> & texture )
 
     return hadChanges;
 }
+
+shared_ptr<vaBackgroundTaskManager::Task> vaTextureBatchCompressor::Spawn( vaRenderDevice & device, const vector<Item> & items, vaTextureCompressionPreset preset )
+{
+    if( items.size( ) == 0 )
+        return nullptr;
+
+    return vaBackgroundTaskManager::GetInstance( ).Spawn( vaStringTools::Format( "Compressing %d textures", (int)items.size( ) ), vaBackgroundTaskManager::SpawnFlags::ShowInUI, 
+        [ &device, items, preset ]( vaBackgroundTaskManager::TaskContext & context ) -> bool
+    {
+        VA_TRACE_CPU_SCOPE( TextureBatchCompress );
+
+        const float itemCount = (float)items.size( );
+        int compressedCount = 0;
+        for( int i = 0; i < (int)items.size( ) && !context.ForceStop; i++ )
+        {
+            const Item & item = items[i];
+            context.Progress = (float)i / itemCount;
+            if( item.Texture == nullptr )
+                continue;
+
+            // readback needs the render thread
+            shared_ptr<vaTextureCompressionJob> job;
+            bool ok = device.AsyncInvokeAtBeginFrame( [ &job, &item, preset ]( vaRenderDevice &, float deltaTime ) -> bool
+            {
+                if( deltaTime == std::numeric_limits<float>::lowest( ) )    // shutting down
+                    return false;
+                job = item.Texture->CreateCompressionJob( preset );
+                return true;
+            } ).get( );
+            if( !ok )
+                return false;
+            if( job == nullptr )
+            {
+                VA_LOG( "vaTextureBatchCompressor: '%s' skipped (already compressed or format not supported)", item.Name.c_str( ) );
+                continue;
+            }
+
+            const int64 blockCount = vaMath::Max( (int64)1, job->GetBlockCount( ) );
+            double timeStart = vaCore::TimeFromAppStart( );
+            if( !job->Encode( [ &context, i, itemCount, blockCount ]( int64 blocksDone ) { context.Progress = ( (float)i + (float)blocksDone / (float)blockCount ) / itemCount; }, &context.ForceStop ) )
+            {
+                if( !context.ForceStop )
+                    VA_LOG_WARNING( "vaTextureBatchCompressor: unable to compress '%s'", item.Name.c_str( ) );
+                continue;
+            }
+            VA_LOG( "vaTextureBatchCompressor: '%s' encoded to %s in %.2fs", item.Name.c_str( ), vaResourceFormatHelpers::EnumToString( job->GetDestinationFormat( ) ).c_str( ), vaCore::TimeFromAppStart( ) - timeStart );
+
+            // not waiting on this one - callbacks run in order so it will be done before the next readback
+            device.AsyncInvokeAtBeginFrame( [ job, item ]( vaRenderDevice &, float deltaTime ) -> bool
+            {
+                if( deltaTime == std::numeric_limits<float>::lowest( ) )
+                    return false;
+                shared_ptr<vaTexture> compressed = job->Finish( );
+                if( compressed == nullptr )
+                {
+                    VA_LOG_WARNING( "vaTextureBatchCompressor: unable to create compressed texture for '%s'", item.Name.c_str( ) );
+                    return false;
+                }
+                if( item.OnCompressed )
+                    item.OnCompressed( item.Texture, compressed );
+                return true;
+            } );
+            compressedCount++;
+        }
+        context.Progress = 1.0f;
+        VA_LOG( "vaTextureBatchCompressor: %d out of %d textures compressed", compressedCount, (int)items.size( ) );
+        return true;
+    } );
+}
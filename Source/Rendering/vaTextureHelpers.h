@@ -268,4 +268,49 @@ namespace Vanilla
 
     };
 
+    //////////////////////////////////////////////////////////////////////////
+    // One texture being BC compressed: created (with the contents read back) on the render thread by 
+    // vaTexture::CreateCompressionJob, Encode can then run on any thread and spreads block rows of all 
+    // mips/slices over vaParallel workers; Finish creates the compressed texture (render thread only).
+    //////////////////////////////////////////////////////////////////////////
+    class vaTextureCompressionJob
+    {
+    public:
+        virtual                                 ~vaTextureCompressionJob( ) { }
+
+        // number of 4x4 blocks across all mips & slices
+        virtual int64                           GetBlockCount( ) const = 0;
+        virtual vaResourceFormat                GetDestinationFormat( ) const = 0;
+
+        // progressCallback gets called from the worker threads with the total number of blocks done so far; returns false on failure or if cancelled
+        virtual bool                            Encode( const std::function<void( int64 blocksDone )> & progressCallback = nullptr, const std::atomic_bool * cancel = nullptr ) = 0;
+
+        virtual shared_ptr<vaTexture>           Finish( ) = 0;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // Compresses a list of textures in a background task (with progress in the vaBackgroundTaskManager UI) 
+    // so that the app stays responsive; readback and creation of the new textures are done through 
+    // vaRenderDevice::AsyncInvokeAtBeginFrame while encoding keeps all cores busy.
+    //////////////////////////////////////////////////////////////////////////
+    class vaTextureBatchCompressor
+    {
+    public:
+        struct Item
+        {
+            shared_ptr<vaTexture>               Texture;
+            string                              Name;               // for logging
+
+            // called on the render thread once the compressed texture is created
+            std::function<void( const shared_ptr<vaTexture> & original, const shared_ptr<vaTexture> & compressed )>
+                                                OnCompressed;
+        };
+
+    private:
+        vaTextureBatchCompressor( ) { }
+
+    public:
+        static shared_ptr<vaBackgroundTaskManager::Task> Spawn( vaRenderDevice & device, const vector<Item> & items, vaTextureCompressionPreset preset = vaTextureCompressionPreset::Balanced );
+    };
+
 }
\ No newline at end of file
@@ -300,7 +300,7 @@ vaDrawResultFlags vaSceneObject::SelectForRendering( vaRenderSelection * opaqueL
 
     // first and easy one, global filter by frustum planes
     if( filter.FrustumPlanes.size() > 0 )
-        if( m_computedGlobalBoundingBox.IntersectFrustum( filter.FrustumPlanes ) == vaIntersectType::Outside )
+        if( m_computedGlobalBoundingBox.IntersectFrustum( filter.FrustumPlanes.data( ), (int)filter.FrustumPlanes.size( ) ) == vaIntersectType::Outside )
             return vaDrawResultFlags::None;
 
     vaMatrix4x4 worldTransform = GetWorldTransform( );
@@ -323,7 +323,7 @@ vaDrawResultFlags vaSceneObject::SelectForRendering( vaRenderSelection * opaqueL
         vaOrientedBoundingBox obb = vaOrientedBoundingBox::FromAABBAndTransform( renderMesh->GetAABB(), worldTransform );
 
         if( filter.FrustumPlanes.size() > 0 )
-            if( obb.IntersectFrustum( filter.FrustumPlanes ) == vaIntersectType::Outside )
+            if( obb.IntersectFrustum( filter.FrustumPlanes.data( ), (int)filter.FrustumPlanes.size( ) ) == vaIntersectType::Outside )
                 continue;
 
         int baseShadingRate = 0;
@@ -897,6 +897,7 @@ void vaScene::DestroyObjectImmediate( const shared_ptr<vaSceneObject> & obj, boo
 void vaScene::Tick( float deltaTime )
 {
     VA_TRACE_CPU_SCOPE( vaScene_Tick );
+    VA_MEMORY_TAG_SCOPE( "Scene.Tick" );
     ApplyDeferredObjectActions();
 
     if( deltaTime > 0 )
@@ -1705,6 +1706,7 @@ void vaScene::SetSkybox( vaRenderDevice & device, const string & texturePath, co
 vaDrawResultFlags vaScene::SelectForRendering( vaRenderSelection * opaqueList, vaRenderSelection * transparentList, const vaRenderSelection::FilterSettings & filter, const SelectionFilterCallback & customFilter )
 {
     VA_TRACE_CPU_SCOPE( vaScene_SelectForRendering );
+    VA_MEMORY_TAG_SCOPE( "Scene.Selection" );
 
     vaDrawResultFlags drawResults = vaDrawResultFlags::None;
 
@@ -35,4 +35,9 @@
 
 //#define VA_USE_PIX3
 
-//#define VA_INTEL_GRADFILTER_ENABLED
\ No newline at end of file
+//#define VA_INTEL_GRADFILTER_ENABLED
+
+// replaces global new/delete with a thin wrapper that can attribute heap allocations to tags (see vaMemory); the 
+// tracking itself is off by default and toggled at runtime with vaMemory::SetTrackingEnabled. Only takes effect in
+// executables that also compile Core/vaMemoryTracking.cpp - the Benchmarks project defines it in its project settings.
+//#define VA_MEMORY_TRACKING_ENABLED